@@ -371,6 +371,34 @@ SELECT dblink_cancel_query('dtest1');
 SELECT dblink_error_message('dtest1');
 SELECT dblink_disconnect('dtest1');
 
+-- test concurrent inserts into one table, which queue up on its relation
+-- extension lock and make the lock holder extend it by several pages
+CREATE TABLE bulk_ext (f1 int, f2 text);
+
+SELECT dblink_connect('dtest1', 'dbname=contrib_regression');
+SELECT * from
+ dblink_send_query('dtest1', 'INSERT INTO bulk_ext SELECT i, repeat(''x'', 500) FROM generate_series(1, 20000) i') as t1;
+
+SELECT dblink_connect('dtest2', 'dbname=contrib_regression');
+SELECT * from
+ dblink_send_query('dtest2', 'INSERT INTO bulk_ext SELECT i, repeat(''x'', 500) FROM generate_series(20001, 40000) i') as t1;
+
+SELECT dblink_connect('dtest3', 'dbname=contrib_regression');
+SELECT * from
+ dblink_send_query('dtest3', 'INSERT INTO bulk_ext SELECT i, repeat(''x'', 500) FROM generate_series(40001, 60000) i') as t1;
+
+SELECT * from dblink_get_result('dtest1') as t1(status text);
+SELECT * from dblink_get_result('dtest2') as t2(status text);
+SELECT * from dblink_get_result('dtest3') as t3(status text);
+
+SELECT dblink_disconnect('dtest1');
+SELECT dblink_disconnect('dtest2');
+SELECT dblink_disconnect('dtest3');
+
+SELECT count(*), count(DISTINCT f1), min(f1), max(f1) FROM bulk_ext;
+
+DROP TABLE bulk_ext;
+
 -- test foreign data wrapper functionality
 CREATE USER dblink_regression_test;
 
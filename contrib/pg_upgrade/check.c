@@ -93,6 +93,16 @@ check_old_cluster(migratorContext *ctx, bool live_check,
 	if (GET_MAJOR_VERSION(ctx->old.major_version) <= 804)
 		new_9_0_populate_pg_largeobject_metadata(ctx, true, CLUSTER_OLD);
 
+	/*
+	 * GIN posting lists were compressed during PG 9.1 development.  8.3
+	 * clusters already have all their gin indexes invalidated above.
+	 */
+	if (GET_MAJOR_VERSION(ctx->old.major_version) > 803 &&
+		ctx->old.controldata.cat_ver < GIN_COMPRESSED_POSTING_CAT_VER &&
+		ctx->new.controldata.cat_ver >= GIN_COMPRESSED_POSTING_CAT_VER &&
+		ctx->check)
+		new_9_1_invalidate_gin_indexes(ctx, true, CLUSTER_OLD);
+
 	/*
 	 * While not a check option, we do this now because this is the only time
 	 * the old server is running.
@@ -178,6 +188,16 @@ issue_warnings(migratorContext *ctx, char *sequence_script_file_name)
 		new_9_0_populate_pg_largeobject_metadata(ctx, false, CLUSTER_NEW);
 		stop_postmaster(ctx, false, true);
 	}
+
+	/* Invalidate gin indexes copied from a pre-compression cluster? */
+	if (GET_MAJOR_VERSION(ctx->old.major_version) > 803 &&
+		ctx->old.controldata.cat_ver < GIN_COMPRESSED_POSTING_CAT_VER &&
+		ctx->new.controldata.cat_ver >= GIN_COMPRESSED_POSTING_CAT_VER)
+	{
+		start_postmaster(ctx, CLUSTER_NEW, true);
+		new_9_1_invalidate_gin_indexes(ctx, false, CLUSTER_NEW);
+		stop_postmaster(ctx, false, true);
+	}
 }
 
 
@@ -55,6 +55,12 @@
 /* OID system catalog preservation added during PG 9.0 development */
 #define TABLE_SPACE_SUBDIRS 201001111
 
+/* visibility map changed to two bits per heap page during PG 9.1 development */
+#define VISIBILITY_MAP_FROZEN_BIT_CAT_VER 201009026
+
+/* GIN posting lists became compressed during PG 9.1 development */
+#define GIN_COMPRESSED_POSTING_CAT_VER 201009025
+
 /*
  * Each relation is represented by a relinfo structure.
  */
@@ -381,6 +387,8 @@ const char *getErrorText(int errNum);
 
 void new_9_0_populate_pg_largeobject_metadata(migratorContext *ctx,
 									  bool check_mode, Cluster whichCluster);
+void new_9_1_invalidate_gin_indexes(migratorContext *ctx,
+									  bool check_mode, Cluster whichCluster);
 
 /* version_old_8_3.c */
 
@@ -138,6 +138,15 @@ transfer_single_new_db(migratorContext *ctx, pageCnvCtx *pageConverter,
 		/* fsm/vm files added in PG 8.4 */
 		if (GET_MAJOR_VERSION(ctx->old.major_version) >= 804)
 		{
+			/*
+			 * Visibility map files of clusters older than the two-bit format
+			 * can't be used as-is.  Skip them; a missing map just means that
+			 * no page is known all-visible, and VACUUM rebuilds it.
+			 */
+			bool		vm_must_be_skipped =
+			(ctx->old.controldata.cat_ver < VISIBILITY_MAP_FROZEN_BIT_CAT_VER &&
+			 ctx->new.controldata.cat_ver >= VISIBILITY_MAP_FROZEN_BIT_CAT_VER);
+
 			/*
 			 * Now copy/link any fsm and vm files, if they exist
 			 */
@@ -146,6 +155,13 @@ transfer_single_new_db(migratorContext *ctx, pageCnvCtx *pageConverter,
 
 			while (numFiles--)
 			{
+				if (vm_must_be_skipped &&
+					strncmp(strchr(namelist[numFiles]->d_name, '_'), "_vm", 3) == 0)
+				{
+					pg_free(namelist[numFiles]);
+					continue;
+				}
+
 				snprintf(old_file, sizeof(old_file), "%s/%s", maps[mapnum].old_file,
 						 namelist[numFiles]->d_name);
 				snprintf(new_file, sizeof(new_file), "%s/%u%s", maps[mapnum].new_file,
@@ -91,3 +91,117 @@ new_9_0_populate_pg_largeobject_metadata(migratorContext *ctx, bool check_mode,
 	else
 		check_ok(ctx);
 }
+
+
+/*
+ * new_9_1_invalidate_gin_indexes()
+ *	new >= GIN_COMPRESSED_POSTING_CAT_VER, old < GIN_COMPRESSED_POSTING_CAT_VER
+ *	GIN posting lists and posting tree leaf pages are now compressed, so
+ *	indexes copied from the old cluster cannot be read
+ */
+void
+new_9_1_invalidate_gin_indexes(migratorContext *ctx, bool check_mode,
+							   Cluster whichCluster)
+{
+	ClusterInfo *active_cluster = (whichCluster == CLUSTER_OLD) ?
+	&ctx->old : &ctx->new;
+	int			dbnum;
+	FILE	   *script = NULL;
+	bool		found = false;
+	char		output_path[MAXPGPATH];
+
+	prep_status(ctx, "Checking for gin indexes");
+
+	snprintf(output_path, sizeof(output_path), "%s/reindex_gin.sql",
+			 ctx->cwd);
+
+	for (dbnum = 0; dbnum < active_cluster->dbarr.ndbs; dbnum++)
+	{
+		PGresult   *res;
+		bool		db_used = false;
+		int			ntups;
+		int			rowno;
+		int			i_nspname,
+					i_relname;
+		DbInfo	   *active_db = &active_cluster->dbarr.dbs[dbnum];
+		PGconn	   *conn = connectToServer(ctx, active_db->db_name, whichCluster);
+
+		/* find gin indexes */
+		res = executeQueryOrDie(ctx, conn,
+								"SELECT n.nspname, c.relname "
+								"FROM	pg_catalog.pg_class c, "
+								"		pg_catalog.pg_index i, "
+								"		pg_catalog.pg_am a, "
+								"		pg_catalog.pg_namespace n "
+								"WHERE	i.indexrelid = c.oid AND "
+								"		c.relam = a.oid AND "
+								"		c.relnamespace = n.oid AND "
+								"		a.amname = 'gin'");
+
+		ntups = PQntuples(res);
+		i_nspname = PQfnumber(res, "nspname");
+		i_relname = PQfnumber(res, "relname");
+		for (rowno = 0; rowno < ntups; rowno++)
+		{
+			found = true;
+			if (!check_mode)
+			{
+				if (script == NULL && (script = fopen(output_path, "w")) == NULL)
+					pg_log(ctx, PG_FATAL, "Could not create necessary file:  %s\n", output_path);
+				if (!db_used)
+				{
+					fprintf(script, "\\connect %s\n",
+							quote_identifier(ctx, active_db->db_name));
+					db_used = true;
+				}
+				fprintf(script, "REINDEX INDEX %s.%s;\n",
+					quote_identifier(ctx, PQgetvalue(res, rowno, i_nspname)),
+				   quote_identifier(ctx, PQgetvalue(res, rowno, i_relname)));
+			}
+		}
+
+		PQclear(res);
+
+		if (!check_mode && found)
+			/* mark gin indexes as invalid */
+			PQclear(executeQueryOrDie(ctx, conn,
+									  "UPDATE pg_catalog.pg_index i "
+									  "SET	indisvalid = false "
+									  "FROM	pg_catalog.pg_class c, "
+									  "		pg_catalog.pg_am a "
+									  "WHERE	i.indexrelid = c.oid AND "
+									  "		c.relam = a.oid AND "
+									  "		a.amname = 'gin'"));
+
+		PQfinish(conn);
+	}
+
+	if (found)
+	{
+		if (!check_mode)
+			fclose(script);
+		report_status(ctx, PG_WARNING, "warning");
+		if (check_mode)
+			pg_log(ctx, PG_WARNING, "\n"
+				   "| Your installation contains gin indexes.\n"
+				   "| These indexes have different internal\n"
+				   "| formats between your old and new clusters\n"
+				   "| so they must be reindexed with the REINDEX\n"
+				   "| command. After migration, you will be given\n"
+				   "| REINDEX instructions.\n\n");
+		else
+			pg_log(ctx, PG_WARNING, "\n"
+				   "| Your installation contains gin indexes.\n"
+				   "| These indexes have different internal formats\n"
+				   "| between your old and new clusters so they must\n"
+				   "| be reindexed with the REINDEX command.\n"
+				   "| The file:\n"
+				   "| \t%s\n"
+				   "| when executed by psql by the database super-user\n"
+				   "| will recreate all invalid indexes; until then,\n"
+				   "| none of these indexes will be used.\n\n",
+				   output_path);
+	}
+	else
+		check_ok(ctx);
+}
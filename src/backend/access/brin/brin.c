@@ -0,0 +1,578 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin.c
+ *	  Index build, insertion and VACUUM for BRIN indexes
+ *
+ * A BRIN index keeps, for each range of pagesPerRange heap pages, the
+ * minimum and maximum of every indexed column over the rows in those
+ * pages.  See src/backend/access/brin/README.
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "catalog/index.h"
+#include "commands/vacuum.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/procarray.h"
+#include "utils/memutils.h"
+#include "utils/tqual.h"
+
+
+typedef struct
+{
+	BrinDesc   *desc;			/* index's slot layout */
+	Relation	index;
+	BlockNumber currRange;		/* range being accumulated, or Invalid */
+	BrinSlot	currSlot;		/* summary of currRange so far */
+	double		indtuples;		/* # tuples summarized */
+} BrinBuildState;
+
+
+/*
+ * Fold the summary accumulated for a range during the build into its slot,
+ * and mark the range summarized.
+ */
+static void
+brinFlushBuildRange(BrinBuildState *buildstate)
+{
+	BrinDesc   *desc = buildstate->desc;
+	BlockNumber range = buildstate->currRange;
+	Buffer		buffer;
+	BrinSlot	slot;
+	BrinSlot	newslot;
+	int			slotno;
+
+	if (range == InvalidBlockNumber)
+		return;
+	slotno = BrinRangeGetSlotno(desc, range);
+
+	buffer = brinGetSlotBuffer(buildstate->index, desc,
+							   BrinRangeGetBlkno(desc, range));
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	/*
+	 * The slot is already summarized if a synchronized heap scan wrapped
+	 * around in the middle of this range, so merge rather than overwrite.
+	 */
+	slot = BrinPageGetSlot(BufferGetPage(buffer), desc->slotSize, slotno);
+	newslot = palloc(desc->slotSize);
+	memcpy(newslot, slot, desc->slotSize);
+	brinSlotUnion(desc, newslot, buildstate->currSlot);
+	BrinSlotState(newslot) = BRIN_SLOT_SUMMARIZED;
+
+	brinWriteSlot(buildstate->index, desc, buffer, slotno, newslot);
+
+	UnlockReleaseBuffer(buffer);
+	pfree(newslot);
+
+	memset(buildstate->currSlot, 0, desc->slotSize);
+	buildstate->currRange = InvalidBlockNumber;
+}
+
+/* Callback to process one heap tuple during IndexBuildHeapScan */
+static void
+brinBuildCallback(Relation index, HeapTuple htup, Datum *values,
+				  bool *isnull, bool tupleIsAlive, void *state)
+{
+	BrinBuildState *buildstate = (BrinBuildState *) state;
+	BrinDesc   *desc = buildstate->desc;
+	BlockNumber range;
+	int			i;
+
+	range = BrinHeapBlkGetRange(desc,
+								ItemPointerGetBlockNumber(&htup->t_self));
+
+	/* The heap is scanned in physical order, so ranges come one by one */
+	if (range != buildstate->currRange)
+	{
+		brinFlushBuildRange(buildstate);
+		buildstate->currRange = range;
+	}
+
+	for (i = 0; i < desc->natts; i++)
+		brinSlotAddValue(desc, buildstate->currSlot, i, values[i], isnull[i]);
+
+	buildstate->indtuples += 1;
+}
+
+/*
+ * Build a BRIN index.
+ */
+Datum
+brinbuild(PG_FUNCTION_ARGS)
+{
+	Relation	heap = (Relation) PG_GETARG_POINTER(0);
+	Relation	index = (Relation) PG_GETARG_POINTER(1);
+	IndexInfo  *indexInfo = (IndexInfo *) PG_GETARG_POINTER(2);
+	IndexBuildResult *result;
+	double		reltuples;
+	BrinBuildState buildstate;
+	BrinDesc   *desc;
+	Buffer		metabuffer;
+	Buffer		buffer;
+	BrinSlot	newslot;
+	BlockNumber pagesPerRange;
+	BlockNumber nranges;
+	BlockNumber range;
+
+	/*
+	 * We expect to be called exactly once for any index relation. If that's
+	 * not the case, big trouble's what we have.
+	 */
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	/*
+	 * Initialize the meta page.  Its contents are fixed for the life of the
+	 * index, so everything about the layout is in the WAL record.
+	 */
+	pagesPerRange = BrinGetPagesPerRange(index);
+
+	metabuffer = ReadBuffer(index, P_NEW);
+	Assert(BufferGetBlockNumber(metabuffer) == BRIN_METAPAGE_BLKNO);
+	LockBuffer(metabuffer, BUFFER_LOCK_EXCLUSIVE);
+
+	START_CRIT_SECTION();
+
+	brinInitMetapage(BufferGetPage(metabuffer), pagesPerRange,
+					 brinComputeSlotSize(RelationGetDescr(index)));
+	MarkBufferDirty(metabuffer);
+
+	if (!index->rd_istemp)
+	{
+		xl_brin_createidx xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata;
+
+		xlrec.node = index->rd_node;
+		xlrec.meta = *BrinPageGetMeta(BufferGetPage(metabuffer));
+
+		rdata.data = (char *) &xlrec;
+		rdata.len = sizeof(xl_brin_createidx);
+		rdata.buffer = InvalidBuffer;
+		rdata.next = NULL;
+
+		recptr = XLogInsert(RM_BRIN_ID, XLOG_BRIN_CREATE_INDEX, &rdata);
+
+		PageSetLSN(BufferGetPage(metabuffer), recptr);
+		PageSetTLI(BufferGetPage(metabuffer), ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(metabuffer);
+
+	/*
+	 * Now summarize the heap, one range at a time.
+	 */
+	desc = brinGetDesc(index);
+
+	buildstate.desc = desc;
+	buildstate.index = index;
+	buildstate.currRange = InvalidBlockNumber;
+	buildstate.currSlot = palloc0(desc->slotSize);
+	buildstate.indtuples = 0;
+
+	reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+								   brinBuildCallback, (void *) &buildstate);
+
+	brinFlushBuildRange(&buildstate);
+
+	/*
+	 * Ranges that hold no tuples at all haven't been seen by the callback.
+	 * Mark them summarized too, as empty, so that scans can skip them; the
+	 * slot of a range past the end of the heap stays unsummarized until a
+	 * VACUUM gets to it.
+	 */
+	nranges = (RelationGetNumberOfBlocks(heap) + pagesPerRange - 1) /
+		pagesPerRange;
+	newslot = palloc0(desc->slotSize);
+	BrinSlotState(newslot) = BRIN_SLOT_SUMMARIZED;
+	buffer = InvalidBuffer;
+
+	for (range = 0; range < nranges; range++)
+	{
+		BlockNumber blkno = BrinRangeGetBlkno(desc, range);
+		int			slotno = BrinRangeGetSlotno(desc, range);
+		BrinSlot	slot;
+
+		if (!BufferIsValid(buffer) || BufferGetBlockNumber(buffer) != blkno)
+		{
+			if (BufferIsValid(buffer))
+				UnlockReleaseBuffer(buffer);
+			buffer = brinGetSlotBuffer(index, desc, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		}
+
+		slot = BrinPageGetSlot(BufferGetPage(buffer), desc->slotSize, slotno);
+		if (BrinSlotState(slot) == BRIN_SLOT_UNSUMMARIZED)
+			brinWriteSlot(index, desc, buffer, slotno, newslot);
+	}
+
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+
+	/*
+	 * Return statistics
+	 */
+	result = (IndexBuildResult *) palloc0(sizeof(IndexBuildResult));
+	result->heap_tuples = reltuples;
+	result->index_tuples = buildstate.indtuples;
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Insert one new tuple into a BRIN index.
+ *
+ * If the tuple's block range is summarized, widen the summary to cover the
+ * new values; otherwise there's nothing to do, since scans return all of an
+ * unsummarized range anyway.  In an append-mostly table most insertions
+ * land within the current summary, and are settled under a share lock.
+ */
+Datum
+brininsert(PG_FUNCTION_ARGS)
+{
+	Relation	index = (Relation) PG_GETARG_POINTER(0);
+	Datum	   *values = (Datum *) PG_GETARG_POINTER(1);
+	bool	   *isnull = (bool *) PG_GETARG_POINTER(2);
+	ItemPointer ht_ctid = (ItemPointer) PG_GETARG_POINTER(3);
+
+#ifdef NOT_USED
+	Relation	heapRel = (Relation) PG_GETARG_POINTER(4);
+	IndexUniqueCheck checkUnique = (IndexUniqueCheck) PG_GETARG_INT32(5);
+#endif
+	BrinDesc   *desc;
+	BlockNumber range;
+	BlockNumber blkno;
+	int			slotno;
+	Buffer		buffer;
+	Page		page;
+	BrinSlot	slot;
+	BrinSlot	newslot;
+	bool		changed;
+	int			i;
+
+	desc = brinGetDesc(index);
+	range = BrinHeapBlkGetRange(desc, ItemPointerGetBlockNumber(ht_ctid));
+	blkno = BrinRangeGetBlkno(desc, range);
+	slotno = BrinRangeGetSlotno(desc, range);
+
+	/*
+	 * A range whose slot page doesn't exist yet isn't summarized.  The index
+	 * never shrinks, so we only need to look at its length again when the
+	 * slot page is past where it ended the last time we looked.
+	 */
+	if (blkno >= desc->knownBlocks)
+	{
+		desc->knownBlocks = RelationGetNumberOfBlocks(index);
+		if (blkno >= desc->knownBlocks)
+			PG_RETURN_BOOL(false);
+	}
+
+	buffer = ReadBuffer(index, blkno);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+
+	if (PageIsNew(page))
+	{
+		UnlockReleaseBuffer(buffer);
+		PG_RETURN_BOOL(false);
+	}
+
+	slot = BrinPageGetSlot(page, desc->slotSize, slotno);
+	if (BrinSlotState(slot) == BRIN_SLOT_UNSUMMARIZED)
+	{
+		UnlockReleaseBuffer(buffer);
+		PG_RETURN_BOOL(false);
+	}
+
+	newslot = palloc(desc->slotSize);
+	memcpy(newslot, slot, desc->slotSize);
+	changed = false;
+	for (i = 0; i < desc->natts; i++)
+		changed |= brinSlotAddValue(desc, newslot, i, values[i], isnull[i]);
+
+	if (changed)
+	{
+		/*
+		 * Someone else may widen the slot while we wait for the exclusive
+		 * lock, so start over from its contents then.  A slot never goes
+		 * back to being unsummarized, so there's no need to check that.
+		 */
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+		memcpy(newslot, slot, desc->slotSize);
+		changed = false;
+		for (i = 0; i < desc->natts; i++)
+			changed |= brinSlotAddValue(desc, newslot, i,
+										values[i], isnull[i]);
+
+		if (changed)
+			brinWriteSlot(index, desc, buffer, slotno, newslot);
+	}
+
+	UnlockReleaseBuffer(buffer);
+	pfree(newslot);
+
+	/* return false since we've not done any unique check */
+	PG_RETURN_BOOL(false);
+}
+
+/*
+ * Compute the summary of one block range by reading its heap pages, adding
+ * it into *newslot.
+ */
+static void
+brinSummarizeRange(Relation index, Relation heapRel, BrinDesc *desc,
+				   IndexInfo *indexInfo, EState *estate,
+				   TupleTableSlot *tupslot, List *predicate,
+				   TransactionId OldestXmin, BufferAccessStrategy strategy,
+				   BlockNumber range, BrinSlot newslot)
+{
+	ExprContext *econtext = GetPerTupleExprContext(estate);
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	BlockNumber startBlk;
+	BlockNumber endBlk;
+	BlockNumber blk;
+
+	/*
+	 * Insertions into the range are folded into its placeholder slot from
+	 * now on, so we need only look at what's in the heap right now.
+	 */
+	startBlk = range * desc->pagesPerRange;
+	endBlk = Min(startBlk + desc->pagesPerRange,
+				 RelationGetNumberOfBlocks(heapRel));
+
+	for (blk = startBlk; blk < endBlk; blk++)
+	{
+		Buffer		hbuffer;
+		Page		hpage;
+		OffsetNumber offnum,
+					maxoff;
+		OffsetNumber tocheck[MaxHeapTuplesPerPage];
+		int			ntocheck = 0;
+		int			i;
+
+		vacuum_delay_point();
+
+		hbuffer = ReadBufferExtended(heapRel, MAIN_FORKNUM, blk,
+									 RBM_NORMAL, strategy);
+
+		/*
+		 * Collect the tuples on the page that might still be visible to
+		 * someone.  Our pin keeps the page from being pruned, so their
+		 * contents stay put after we release the lock; evaluating index
+		 * expressions while holding a buffer lock would be unwise.
+		 */
+		LockBuffer(hbuffer, BUFFER_LOCK_SHARE);
+		hpage = BufferGetPage(hbuffer);
+		maxoff = PageGetMaxOffsetNumber(hpage);
+
+		for (offnum = FirstOffsetNumber; offnum <= maxoff;
+			 offnum = OffsetNumberNext(offnum))
+		{
+			ItemId		itemid = PageGetItemId(hpage, offnum);
+			HeapTupleHeader htup;
+
+			if (!ItemIdIsNormal(itemid))
+				continue;
+
+			htup = (HeapTupleHeader) PageGetItem(hpage, itemid);
+			if (HeapTupleSatisfiesVacuum(htup, OldestXmin, hbuffer) ==
+				HEAPTUPLE_DEAD)
+				continue;
+
+			tocheck[ntocheck++] = offnum;
+		}
+
+		LockBuffer(hbuffer, BUFFER_LOCK_UNLOCK);
+
+		for (i = 0; i < ntocheck; i++)
+		{
+			ItemId		itemid = PageGetItemId(hpage, tocheck[i]);
+			HeapTupleData tuple;
+			int			j;
+
+			tuple.t_data = (HeapTupleHeader) PageGetItem(hpage, itemid);
+			tuple.t_len = ItemIdGetLength(itemid);
+			tuple.t_tableOid = RelationGetRelid(heapRel);
+			ItemPointerSet(&tuple.t_self, blk, tocheck[i]);
+
+			ExecStoreTuple(&tuple, tupslot, InvalidBuffer, false);
+
+			if (predicate == NIL || ExecQual(predicate, econtext, false))
+			{
+				FormIndexDatum(indexInfo, tupslot, estate, values, isnull);
+
+				for (j = 0; j < desc->natts; j++)
+					brinSlotAddValue(desc, newslot, j, values[j], isnull[j]);
+			}
+
+			ResetExprContext(econtext);
+		}
+
+		ExecClearTuple(tupslot);
+		ReleaseBuffer(hbuffer);
+	}
+}
+
+/*
+ * Summarize all the block ranges of the heap that aren't summarized yet.
+ *
+ * Each range is first marked with a placeholder, which brininsert widens
+ * like a summarized slot, so that rows inserted while we read the heap
+ * are not lost; the placeholder is then merged with what we read.  If we
+ * fail half-way, the placeholder stays behind and the next VACUUM picks
+ * it up again.
+ */
+static void
+brinsummarize(Relation index, Relation heapRel,
+			  BufferAccessStrategy strategy)
+{
+	BrinDesc   *desc = brinGetDesc(index);
+	IndexInfo  *indexInfo;
+	EState	   *estate;
+	ExprContext *econtext;
+	TupleTableSlot *tupslot;
+	List	   *predicate;
+	TransactionId OldestXmin;
+	BlockNumber nranges;
+	BlockNumber range;
+	BrinSlot	newslot;
+
+	indexInfo = BuildIndexInfo(index);
+
+	/*
+	 * Need an EState for evaluation of index expressions and partial-index
+	 * predicates.  Also a slot to hold the current tuple.
+	 */
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	tupslot = MakeSingleTupleTableSlot(RelationGetDescr(heapRel));
+	econtext->ecxt_scantuple = tupslot;
+	predicate = (List *)
+		ExecPrepareExpr((Expr *) indexInfo->ii_Predicate, estate);
+
+	/* okay to ignore lazy VACUUMs here */
+	OldestXmin = GetOldestXmin(heapRel->rd_rel->relisshared, true);
+
+	nranges = (RelationGetNumberOfBlocks(heapRel) + desc->pagesPerRange - 1) /
+		desc->pagesPerRange;
+	newslot = palloc(desc->slotSize);
+
+	for (range = 0; range < nranges; range++)
+	{
+		BlockNumber blkno = BrinRangeGetBlkno(desc, range);
+		int			slotno = BrinRangeGetSlotno(desc, range);
+		Buffer		buffer;
+		BrinSlot	slot;
+
+		vacuum_delay_point();
+
+		buffer = brinGetSlotBuffer(index, desc, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		slot = BrinPageGetSlot(BufferGetPage(buffer), desc->slotSize, slotno);
+
+		if (BrinSlotState(slot) == BRIN_SLOT_SUMMARIZED)
+		{
+			UnlockReleaseBuffer(buffer);
+			continue;
+		}
+
+		/* Only VACUUM changes the state, and we're the only VACUUM */
+		if (BrinSlotState(slot) == BRIN_SLOT_UNSUMMARIZED)
+		{
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			memset(newslot, 0, desc->slotSize);
+			BrinSlotState(newslot) = BRIN_SLOT_PLACEHOLDER;
+			brinWriteSlot(index, desc, buffer, slotno, newslot);
+		}
+		UnlockReleaseBuffer(buffer);
+
+		memset(newslot, 0, desc->slotSize);
+		brinSummarizeRange(index, heapRel, desc, indexInfo, estate, tupslot,
+						   predicate, OldestXmin, strategy, range, newslot);
+
+		/* Merge in what was inserted meanwhile, and we're done */
+		buffer = brinGetSlotBuffer(index, desc, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		slot = BrinPageGetSlot(BufferGetPage(buffer), desc->slotSize, slotno);
+		Assert(BrinSlotState(slot) == BRIN_SLOT_PLACEHOLDER);
+		brinSlotUnion(desc, newslot, slot);
+		BrinSlotState(newslot) = BRIN_SLOT_SUMMARIZED;
+		brinWriteSlot(index, desc, buffer, slotno, newslot);
+		UnlockReleaseBuffer(buffer);
+	}
+
+	pfree(newslot);
+	ExecDropSingleTupleTableSlot(tupslot);
+	FreeExecutorState(estate);
+}
+
+/*
+ * Bulk deletion of all index entries pointing to a set of heap tuples.
+ *
+ * A summary is still correct, if less precise, after rows within it go
+ * away, so there is never anything to delete.  Summaries are only ever
+ * rebuilt tighter by REINDEX.
+ */
+Datum
+brinbulkdelete(PG_FUNCTION_ARGS)
+{
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+
+	/* allocate stats if first time through, else re-use existing struct */
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	PG_RETURN_POINTER(stats);
+}
+
+/*
+ * Post-VACUUM cleanup: summarize the block ranges that have been added to
+ * the heap since the index was built or last vacuumed.
+ */
+Datum
+brinvacuumcleanup(PG_FUNCTION_ARGS)
+{
+	IndexVacuumInfo *info = (IndexVacuumInfo *) PG_GETARG_POINTER(0);
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+	Relation	index = info->index;
+	Relation	heapRel;
+
+	/* No-op in ANALYZE ONLY mode */
+	if (info->analyze_only)
+		PG_RETURN_POINTER(stats);
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	/* VACUUM already holds a lock on the heap */
+	heapRel = heap_open(index->rd_index->indrelid, AccessShareLock);
+	brinsummarize(index, heapRel, info->strategy);
+	heap_close(heapRel, AccessShareLock);
+
+	stats->num_pages = RelationGetNumberOfBlocks(index);
+	stats->num_index_tuples = info->num_heap_tuples;
+	stats->estimated_count = info->estimated_count;
+
+	PG_RETURN_POINTER(stats);
+}
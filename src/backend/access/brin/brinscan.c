@@ -0,0 +1,203 @@
+/*-------------------------------------------------------------------------
+ *
+ * brinscan.c
+ *	  routines for scanning BRIN indexes
+ *
+ * A BRIN scan can only produce a lossy bitmap: every page of each block
+ * range whose summary might match the scan keys, plus every page of the
+ * ranges that aren't summarized yet.
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "access/heapam.h"
+#include "access/relscan.h"
+#include "miscadmin.h"
+#include "nodes/tidbitmap.h"
+#include "storage/bufmgr.h"
+
+
+Datum
+brinbeginscan(PG_FUNCTION_ARGS)
+{
+	Relation	rel = (Relation) PG_GETARG_POINTER(0);
+	int			keysz = PG_GETARG_INT32(1);
+	ScanKey		scankey = (ScanKey) PG_GETARG_POINTER(2);
+	IndexScanDesc scan;
+	BrinScanOpaque so;
+
+	scan = RelationGetIndexScan(rel, keysz, scankey);
+
+	so = (BrinScanOpaque) palloc0(sizeof(BrinScanOpaqueData));
+	so->desc = brinGetDesc(scan->indexRelation);
+	scan->opaque = so;
+
+	PG_RETURN_POINTER(scan);
+}
+
+Datum
+brinrescan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	ScanKey		scankey = (ScanKey) PG_GETARG_POINTER(1);
+
+	/* Update scan key, if a new one is given */
+	if (scankey && scan->numberOfKeys > 0)
+	{
+		memmove(scan->keyData,
+				scankey,
+				scan->numberOfKeys * sizeof(ScanKeyData));
+	}
+
+	PG_RETURN_VOID();
+}
+
+Datum
+brinendscan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	BrinScanOpaque so = (BrinScanOpaque) scan->opaque;
+
+	pfree(so);
+	scan->opaque = NULL;
+
+	PG_RETURN_VOID();
+}
+
+Datum
+brinmarkpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "BRIN does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+Datum
+brinrestrpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "BRIN does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+/*
+ * Add all the heap pages of the block ranges marked in matches[] to the
+ * bitmap; the first of them is range firstRange.  Returns the number of
+ * pages added.
+ */
+static int64
+brinAddRanges(BrinDesc *desc, TIDBitmap *tbm, BlockNumber heapBlocks,
+			  BlockNumber firstRange, bool *matches, int nranges)
+{
+	int64		npages = 0;
+	int			i;
+
+	for (i = 0; i < nranges; i++)
+	{
+		BlockNumber blk;
+		BlockNumber endBlk;
+
+		if (!matches[i])
+			continue;
+
+		blk = (firstRange + i) * desc->pagesPerRange;
+		endBlk = Min(blk + desc->pagesPerRange, heapBlocks);
+
+		for (; blk < endBlk; blk++)
+		{
+			tbm_add_page(tbm, blk);
+			npages++;
+		}
+	}
+
+	return npages;
+}
+
+Datum
+bringetbitmap(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	TIDBitmap  *tbm = (TIDBitmap *) PG_GETARG_POINTER(1);
+	Relation	index = scan->indexRelation;
+	BrinDesc   *desc = ((BrinScanOpaque) scan->opaque)->desc;
+	Relation	heapRel;
+	BlockNumber heapBlocks;
+	BlockNumber indexBlocks;
+	BlockNumber nranges;
+	BlockNumber range;
+	bool	   *matches;
+	int64		npages = 0;
+	int			i;
+
+	/* The operators are strict, so a null comparison value matches nothing */
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		if (scan->keyData[i].sk_flags & SK_ISNULL)
+			PG_RETURN_INT64(0);
+	}
+
+	/* The executor already holds a lock on the heap */
+	heapRel = heap_open(index->rd_index->indrelid, AccessShareLock);
+	heapBlocks = RelationGetNumberOfBlocks(heapRel);
+	heap_close(heapRel, AccessShareLock);
+
+	nranges = (heapBlocks + desc->pagesPerRange - 1) / desc->pagesPerRange;
+	indexBlocks = RelationGetNumberOfBlocks(index);
+	matches = (bool *) palloc(sizeof(bool) * desc->slotsPerPage);
+
+	/*
+	 * Visit the slot pages in order, evaluating the keys against all the
+	 * slots on a page while we hold its lock, then add the matching ranges
+	 * to the bitmap after releasing it.
+	 */
+	for (range = 0; range < nranges; range += desc->slotsPerPage)
+	{
+		BlockNumber blkno = BrinRangeGetBlkno(desc, range);
+		int			nslots = Min(desc->slotsPerPage, nranges - range);
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Ranges that aren't summarized must be returned in full */
+		memset(matches, true, sizeof(bool) * nslots);
+
+		if (blkno < indexBlocks)
+		{
+			Buffer		buffer;
+			Page		page;
+
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+			page = BufferGetPage(buffer);
+
+			if (!PageIsNew(page))
+			{
+				for (i = 0; i < nslots; i++)
+				{
+					BrinSlot	slot;
+
+					slot = BrinPageGetSlot(page, desc->slotSize, i);
+					if (BrinSlotState(slot) == BRIN_SLOT_SUMMARIZED)
+						matches[i] = brinSlotConsistent(desc, slot,
+														scan->keyData,
+														scan->numberOfKeys);
+				}
+			}
+
+			UnlockReleaseBuffer(buffer);
+		}
+
+		npages += brinAddRanges(desc, tbm, heapBlocks, range, matches, nslots);
+	}
+
+	pfree(matches);
+
+	/* we can only report a page count, since the bitmap is lossy */
+	PG_RETURN_INT64(npages);
+}
@@ -0,0 +1,487 @@
+/*-------------------------------------------------------------------------
+ *
+ * brinutil.c
+ *	  various support functions for BRIN
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "access/genam.h"
+#include "access/reloptions.h"
+#include "access/tupmacs.h"
+#include "miscadmin.h"
+#include "storage/lmgr.h"
+#include "utils/memutils.h"
+
+
+/*
+ * Lay out the slot for an index with the given tuple descriptor: a state
+ * byte, a flag byte per column, then each column's minimum and maximum.
+ * Fills in the offsets in cols[] if it's not NULL, and returns the slot
+ * size.
+ */
+static uint16
+brinLayoutSlot(TupleDesc tupdesc, BrinColumnDesc *cols)
+{
+	Size		off;
+	int			i;
+
+	off = 1 + tupdesc->natts;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = tupdesc->attrs[i];
+
+		if (att->attlen <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("BRIN indexes support only fixed-length data types")));
+
+		off = att_align_nominal(off, att->attalign);
+		if (cols)
+			cols[i].minOffset = off;
+		off += att->attlen;
+
+		off = att_align_nominal(off, att->attalign);
+		if (cols)
+			cols[i].maxOffset = off;
+		off += att->attlen;
+
+		if (cols)
+		{
+			cols[i].attlen = att->attlen;
+			cols[i].attbyval = att->attbyval;
+		}
+	}
+
+	return MAXALIGN(off);
+}
+
+/*
+ * Compute the slot size for an index being built
+ */
+uint16
+brinComputeSlotSize(TupleDesc tupdesc)
+{
+	return brinLayoutSlot(tupdesc, NULL);
+}
+
+/*
+ * Fetch the slot layout of the index, building it from the tuple descriptor
+ * and the metapage the first time through.
+ */
+BrinDesc *
+brinGetDesc(Relation index)
+{
+	BrinDesc   *desc;
+	Buffer		metabuffer;
+	BrinMetaPageData *meta;
+	uint16		slotSize;
+	int			i;
+
+	if (index->rd_amcache != NULL)
+		return (BrinDesc *) index->rd_amcache;
+
+	desc = MemoryContextAllocZero(index->rd_indexcxt, sizeof(BrinDesc));
+	desc->natts = index->rd_att->natts;
+	slotSize = brinLayoutSlot(index->rd_att, desc->cols);
+
+	for (i = 0; i < desc->natts; i++)
+		desc->cols[i].cmpFn = index_getprocinfo(index, i + 1,
+												BRIN_COMPARE_PROC);
+
+	metabuffer = ReadBuffer(index, BRIN_METAPAGE_BLKNO);
+	LockBuffer(metabuffer, BUFFER_LOCK_SHARE);
+	meta = BrinPageGetMeta(BufferGetPage(metabuffer));
+
+	if (meta->magicNumber != BRIN_MAGIC_NUMBER)
+		elog(ERROR, "index \"%s\" is not a BRIN index",
+			 RelationGetRelationName(index));
+	if (meta->slotSize != slotSize)
+		elog(ERROR, "BRIN index \"%s\" has slot size %u, expected %u",
+			 RelationGetRelationName(index), meta->slotSize, slotSize);
+
+	desc->pagesPerRange = meta->pagesPerRange;
+	desc->slotSize = meta->slotSize;
+	desc->slotsPerPage = meta->slotsPerPage;
+
+	UnlockReleaseBuffer(metabuffer);
+
+	index->rd_amcache = (void *) desc;
+
+	return desc;
+}
+
+/*
+ * Initialize the metapage
+ */
+void
+brinInitMetapage(Page page, BlockNumber pagesPerRange, uint16 slotSize)
+{
+	BrinPageOpaque opaque;
+	BrinMetaPageData *meta;
+
+	PageInit(page, BLCKSZ, MAXALIGN(sizeof(BrinPageOpaqueData)));
+	opaque = BrinPageGetOpaque(page);
+	opaque->flags = BRIN_META;
+	opaque->brin_page_id = BRIN_PAGE_ID;
+
+	meta = BrinPageGetMeta(page);
+	memset(meta, 0, sizeof(BrinMetaPageData));
+	meta->magicNumber = BRIN_MAGIC_NUMBER;
+	meta->pagesPerRange = pagesPerRange;
+	meta->slotSize = slotSize;
+	meta->slotsPerPage = BrinSlotsPerPage(slotSize);
+
+	/* Set pd_lower just past the end of the metadata */
+	((PageHeader) page)->pd_lower =
+		((char *) meta + sizeof(BrinMetaPageData)) - (char *) page;
+}
+
+/*
+ * Initialize a slot page, with every slot unsummarized
+ */
+void
+brinInitSlotPage(Page page, uint16 slotSize, uint16 slotsPerPage)
+{
+	BrinPageOpaque opaque;
+
+	/* PageInit zeroes the page, which makes all the slots unsummarized */
+	PageInit(page, BLCKSZ, MAXALIGN(sizeof(BrinPageOpaqueData)));
+	opaque = BrinPageGetOpaque(page);
+	opaque->flags = 0;
+	opaque->brin_page_id = BRIN_PAGE_ID;
+
+	((PageHeader) page)->pd_lower =
+		BrinSlotArrayOffset + (Size) slotsPerPage * slotSize;
+}
+
+/*
+ * Initialize the slot page in an exclusively locked buffer, and WAL-log it.
+ */
+static void
+brinInitSlotBuffer(Relation index, BrinDesc *desc, Buffer buffer)
+{
+	Page		page = BufferGetPage(buffer);
+
+	START_CRIT_SECTION();
+
+	brinInitSlotPage(page, desc->slotSize, desc->slotsPerPage);
+	MarkBufferDirty(buffer);
+
+	if (!index->rd_istemp)
+	{
+		xl_brin_newpage xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata;
+
+		xlrec.node = index->rd_node;
+		xlrec.blkno = BufferGetBlockNumber(buffer);
+		xlrec.slotSize = desc->slotSize;
+		xlrec.slotsPerPage = desc->slotsPerPage;
+
+		rdata.data = (char *) &xlrec;
+		rdata.len = sizeof(xl_brin_newpage);
+		rdata.buffer = InvalidBuffer;
+		rdata.next = NULL;
+
+		recptr = XLogInsert(RM_BRIN_ID, XLOG_BRIN_NEW_PAGE, &rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetTLI(page, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+}
+
+/*
+ * Get a pin on the given slot page, extending the index with empty slot
+ * pages up to it if necessary.  The buffer is returned unlocked.
+ *
+ * Only index build and VACUUM create slot pages; brininsert never needs
+ * one, since a range without a slot page isn't summarized yet.
+ */
+Buffer
+brinGetSlotBuffer(Relation index, BrinDesc *desc, BlockNumber blkno)
+{
+	Buffer		buffer;
+
+	if (blkno >= desc->knownBlocks)
+		desc->knownBlocks = RelationGetNumberOfBlocks(index);
+
+	if (blkno >= desc->knownBlocks)
+	{
+		LockRelationForExtension(index, ExclusiveLock);
+
+		while (RelationGetNumberOfBlocks(index) <= blkno)
+		{
+			buffer = ReadBuffer(index, P_NEW);
+			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			brinInitSlotBuffer(index, desc, buffer);
+			UnlockReleaseBuffer(buffer);
+		}
+
+		UnlockRelationForExtension(index, ExclusiveLock);
+
+		desc->knownBlocks = blkno + 1;
+	}
+
+	buffer = ReadBuffer(index, blkno);
+
+	/*
+	 * A slot page can be all zeroes if we crashed after extending the index
+	 * but before the new page got written out.  Initialize it again.
+	 */
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	if (PageIsNew(BufferGetPage(buffer)))
+	{
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		if (PageIsNew(BufferGetPage(buffer)))
+			brinInitSlotBuffer(index, desc, buffer);
+	}
+	LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+	return buffer;
+}
+
+/* Fetch a minimum or maximum stored in a slot */
+static Datum
+brinSlotGetDatum(BrinColumnDesc *col, BrinSlot slot, uint16 offset)
+{
+	return fetch_att(slot + offset, col->attbyval, col->attlen);
+}
+
+/* Store a minimum or maximum into a slot */
+static void
+brinSlotSetDatum(BrinColumnDesc *col, BrinSlot slot, uint16 offset,
+				 Datum value)
+{
+	if (col->attbyval)
+		store_att_byval(slot + offset, value, col->attlen);
+	else
+		memcpy(slot + offset, DatumGetPointer(value), col->attlen);
+}
+
+static int
+brinCompare(BrinColumnDesc *col, Datum a, Datum b)
+{
+	return DatumGetInt32(FunctionCall2(col->cmpFn, a, b));
+}
+
+/*
+ * Widen the summary of column attno (counting from zero) in the slot to
+ * cover the given value.  Returns true if the slot was changed.
+ */
+bool
+brinSlotAddValue(BrinDesc *desc, BrinSlot slot, int attno,
+				 Datum value, bool isnull)
+{
+	BrinColumnDesc *col = &desc->cols[attno];
+	uint8	   *flags = &BrinSlotColFlags(slot, attno);
+
+	if (isnull)
+	{
+		if (*flags & BRIN_COL_HASNULLS)
+			return false;
+		*flags |= BRIN_COL_HASNULLS;
+		return true;
+	}
+
+	if (!(*flags & BRIN_COL_HASVALUES))
+	{
+		brinSlotSetDatum(col, slot, col->minOffset, value);
+		brinSlotSetDatum(col, slot, col->maxOffset, value);
+		*flags |= BRIN_COL_HASVALUES;
+		return true;
+	}
+
+	if (brinCompare(col, value,
+					brinSlotGetDatum(col, slot, col->minOffset)) < 0)
+	{
+		brinSlotSetDatum(col, slot, col->minOffset, value);
+		return true;
+	}
+	if (brinCompare(col, value,
+					brinSlotGetDatum(col, slot, col->maxOffset)) > 0)
+	{
+		brinSlotSetDatum(col, slot, col->maxOffset, value);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Widen the summaries in dst to cover everything summarized in src.  The
+ * slot states are not looked at.  Returns true if dst was changed.
+ */
+bool
+brinSlotUnion(BrinDesc *desc, BrinSlot dst, BrinSlot src)
+{
+	bool		changed = false;
+	int			i;
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		BrinColumnDesc *col = &desc->cols[i];
+		uint8		flags = BrinSlotColFlags(src, i);
+
+		if (flags & BRIN_COL_HASNULLS)
+			changed |= brinSlotAddValue(desc, dst, i, (Datum) 0, true);
+		if (flags & BRIN_COL_HASVALUES)
+		{
+			changed |= brinSlotAddValue(desc, dst, i,
+							 brinSlotGetDatum(col, src, col->minOffset),
+										false);
+			changed |= brinSlotAddValue(desc, dst, i,
+							 brinSlotGetDatum(col, src, col->maxOffset),
+										false);
+		}
+	}
+
+	return changed;
+}
+
+/*
+ * Could the summarized block range contain rows satisfying all the scan
+ * keys?  The keys' comparison values must not be null.
+ */
+bool
+brinSlotConsistent(BrinDesc *desc, BrinSlot slot, ScanKey keys, int nkeys)
+{
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		ScanKey		key = &keys[i];
+		int			attno = key->sk_attno - 1;
+		BrinColumnDesc *col = &desc->cols[attno];
+		Datum		min,
+					max;
+		bool		match;
+
+		/* the operators are strict, so a range of only nulls can't match */
+		if (!(BrinSlotColFlags(slot, attno) & BRIN_COL_HASVALUES))
+			return false;
+
+		min = brinSlotGetDatum(col, slot, col->minOffset);
+		max = brinSlotGetDatum(col, slot, col->maxOffset);
+
+		switch (key->sk_strategy)
+		{
+			case BTLessStrategyNumber:
+				match = brinCompare(col, min, key->sk_argument) < 0;
+				break;
+			case BTLessEqualStrategyNumber:
+				match = brinCompare(col, min, key->sk_argument) <= 0;
+				break;
+			case BTEqualStrategyNumber:
+				match = brinCompare(col, min, key->sk_argument) <= 0 &&
+					brinCompare(col, max, key->sk_argument) >= 0;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				match = brinCompare(col, max, key->sk_argument) >= 0;
+				break;
+			case BTGreaterStrategyNumber:
+				match = brinCompare(col, max, key->sk_argument) > 0;
+				break;
+			default:
+				elog(ERROR, "unrecognized strategy number: %d",
+					 key->sk_strategy);
+				match = false;	/* keep compiler quiet */
+				break;
+		}
+
+		if (!match)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Overwrite a slot with new contents, and WAL-log the change.  The caller
+ * must hold an exclusive lock on the buffer.
+ */
+void
+brinWriteSlot(Relation index, BrinDesc *desc, Buffer buffer,
+			  int slotno, BrinSlot newslot)
+{
+	Page		page = BufferGetPage(buffer);
+
+	START_CRIT_SECTION();
+
+	memcpy(BrinPageGetSlot(page, desc->slotSize, slotno), newslot,
+		   desc->slotSize);
+	MarkBufferDirty(buffer);
+
+	if (!index->rd_istemp)
+	{
+		xl_brin_update xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+
+		xlrec.node = index->rd_node;
+		xlrec.blkno = BufferGetBlockNumber(buffer);
+		xlrec.slotno = slotno;
+		xlrec.slotSize = desc->slotSize;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_brin_update);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		rdata[1].data = newslot;
+		rdata[1].len = desc->slotSize;
+		rdata[1].buffer = buffer;
+		rdata[1].buffer_std = true;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_BRIN_ID, XLOG_BRIN_UPDATE_SLOT, rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetTLI(page, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+}
+
+Datum
+brinoptions(PG_FUNCTION_ARGS)
+{
+	Datum		reloptions = PG_GETARG_DATUM(0);
+	bool		validate = PG_GETARG_BOOL(1);
+	relopt_value *options;
+	BrinOptions *rdopts;
+	int			numoptions;
+	static const relopt_parse_elt tab[] = {
+		{"pages_per_range", RELOPT_TYPE_INT, offsetof(BrinOptions, pagesPerRange)}
+	};
+
+	options = parseRelOptions(reloptions, validate, RELOPT_KIND_BRIN,
+							  &numoptions);
+
+	/* if none set, we're done */
+	if (numoptions == 0)
+		PG_RETURN_NULL();
+
+	rdopts = allocateReloptStruct(sizeof(BrinOptions), options, numoptions);
+
+	fillRelOptions((void *) rdopts, sizeof(BrinOptions), options, numoptions,
+				   validate, tab, lengthof(tab));
+
+	pfree(options);
+
+	PG_RETURN_BYTEA_P(rdopts);
+}
@@ -0,0 +1,145 @@
+/*-------------------------------------------------------------------------
+ *
+ * brinxlog.c
+ *	  WAL replay logic for BRIN
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			 $PostgreSQL$
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "access/xlogutils.h"
+#include "storage/bufmgr.h"
+
+
+static void
+brinRedoCreateIndex(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_createidx *xlrec = (xl_brin_createidx *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	buffer = XLogReadBuffer(xlrec->node, BRIN_METAPAGE_BLKNO, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+
+	brinInitMetapage(page, xlrec->meta.pagesPerRange, xlrec->meta.slotSize);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+brinRedoNewPage(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_newpage *xlrec = (xl_brin_newpage *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->blkno, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+
+	brinInitSlotPage(page, xlrec->slotSize, xlrec->slotsPerPage);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+brinRedoUpdateSlot(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_update *xlrec = (xl_brin_update *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	/* nothing else to do if the page was backed up */
+	if (record->xl_info & XLR_BKP_BLOCK_1)
+		return;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->blkno, false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (!XLByteLE(lsn, PageGetLSN(page)))
+	{
+		memcpy(BrinPageGetSlot(page, xlrec->slotSize, xlrec->slotno),
+			   (char *) xlrec + sizeof(xl_brin_update),
+			   xlrec->slotSize);
+
+		PageSetLSN(page, lsn);
+		PageSetTLI(page, ThisTimeLineID);
+		MarkBufferDirty(buffer);
+	}
+	UnlockReleaseBuffer(buffer);
+}
+
+void
+brin_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	RestoreBkpBlocks(lsn, record, false);
+
+	switch (info)
+	{
+		case XLOG_BRIN_CREATE_INDEX:
+			brinRedoCreateIndex(lsn, record);
+			break;
+		case XLOG_BRIN_NEW_PAGE:
+			brinRedoNewPage(lsn, record);
+			break;
+		case XLOG_BRIN_UPDATE_SLOT:
+			brinRedoUpdateSlot(lsn, record);
+			break;
+		default:
+			elog(PANIC, "brin_redo: unknown op code %u", info);
+	}
+}
+
+static void
+out_target(StringInfo buf, RelFileNode node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u ",
+					 node.spcNode, node.dbNode, node.relNode);
+}
+
+void
+brin_desc(StringInfo buf, uint8 xl_info, char *rec)
+{
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_BRIN_CREATE_INDEX:
+			out_target(buf, ((xl_brin_createidx *) rec)->node);
+			appendStringInfo(buf, "create_index: pages per range %u",
+							 ((xl_brin_createidx *) rec)->meta.pagesPerRange);
+			break;
+		case XLOG_BRIN_NEW_PAGE:
+			out_target(buf, ((xl_brin_newpage *) rec)->node);
+			appendStringInfo(buf, "new slot page: %u",
+							 ((xl_brin_newpage *) rec)->blkno);
+			break;
+		case XLOG_BRIN_UPDATE_SLOT:
+			out_target(buf, ((xl_brin_update *) rec)->node);
+			appendStringInfo(buf, "update slot: %u/%u",
+							 ((xl_brin_update *) rec)->blkno,
+							 ((xl_brin_update *) rec)->slotno);
+			break;
+		default:
+			appendStringInfo(buf, "unknown brin op code %u", info);
+			break;
+	}
+}
@@ -15,10 +15,13 @@
 
 #include "postgres.h"
 
+#include "access/brin.h"
 #include "access/gist_private.h"
 #include "access/hash.h"
 #include "access/nbtree.h"
 #include "access/reloptions.h"
+#include "access/spgist.h"
+#include "access/tuptoaster.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
 #include "commands/tablespace.h"
@@ -104,6 +107,22 @@ static relopt_int intRelOpts[] =
 		},
 		GIST_DEFAULT_FILLFACTOR, GIST_MIN_FILLFACTOR, 100
 	},
+	{
+		{
+			"fillfactor",
+			"Packs spgist index pages only to this percentage",
+			RELOPT_KIND_SPGIST
+		},
+		SPGIST_DEFAULT_FILLFACTOR, SPGIST_MIN_FILLFACTOR, 100
+	},
+	{
+		{
+			"pages_per_range",
+			"Number of heap pages summarized by each brin index entry",
+			RELOPT_KIND_BRIN
+		},
+		BRIN_DEFAULT_PAGES_PER_RANGE, 1, BRIN_MAX_PAGES_PER_RANGE
+	},
 	{
 		{
 			"autovacuum_vacuum_threshold",
@@ -219,6 +238,28 @@ static relopt_real realRelOpts[] =
 
 static relopt_string stringRelOpts[] =
 {
+	{
+		{
+			"buffering",
+			"Enables buffering build for this GiST index",
+			RELOPT_KIND_GIST
+		},
+		4,
+		false,
+		gistValidateBufferingOption,
+		"auto"
+	},
+	{
+		{
+			"compression",
+			"Sets the method used to compress values of a column",
+			RELOPT_KIND_ATTRIBUTE
+		},
+		0,
+		true,
+		toast_validate_compression_option,
+		NULL
+	},
 	/* list terminator */
 	{{NULL}}
 };
@@ -483,7 +524,7 @@ add_string_reloption(bits32 kinds, char *name, char *desc, char *default_val,
 	if (default_val)
 		default_len = strlen(default_val);
 
-	newoption = palloc0(sizeof(relopt_string) + default_len);
+	newoption = palloc0(sizeof(relopt_string));
 
 	newoption->gen.name = pstrdup(name);
 	if (desc)
@@ -496,13 +537,13 @@ add_string_reloption(bits32 kinds, char *name, char *desc, char *default_val,
 	newoption->validate_cb = validator;
 	if (default_val)
 	{
-		strcpy(newoption->default_val, default_val);
+		newoption->default_val = pstrdup(default_val);
 		newoption->default_len = default_len;
 		newoption->default_isnull = false;
 	}
 	else
 	{
-		newoption->default_val[0] = '\0';
+		newoption->default_val = "";
 		newoption->default_len = 0;
 		newoption->default_isnull = true;
 	}
@@ -1229,7 +1270,8 @@ attribute_reloptions(Datum reloptions, bool validate)
 	int			numoptions;
 	static const relopt_parse_elt tab[] = {
 		{"n_distinct", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct)},
-		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)}
+		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)},
+		{"compression", RELOPT_TYPE_STRING, offsetof(AttributeOpts, compression_offset)}
 	};
 
 	options = parseRelOptions(reloptions, validate, RELOPT_KIND_ATTRIBUTE,
@@ -16,8 +16,21 @@
 
 #include "access/gin.h"
 #include "storage/bufmgr.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
+/*
+ * The new contents of a leaf page, prepared by dataIsEnoughSpace for the
+ * dataPlaceToPage call that follows it on the same locked page.  Merging
+ * the items and compressing the result is done up front, both because it's
+ * what tells whether the items fit, and to keep the work out of the
+ * critical section.
+ */
+static char leafData[BLCKSZ];
+static Size leafDataSize;		/* bytes used in leafData */
+static uint32 leafNItems;		/* number of items encoded in leafData */
+static uint32 leafNInserted;	/* number of btree->items merged into it */
+
 int
 compareItemPointers(ItemPointer a, ItemPointer b)
 {
@@ -156,13 +169,18 @@ dataLocateItem(GinBtree btree, GinBtreeStack *stack)
  * Searches correct position for value on leaf page.
  * Page should be correctly chosen.
  * Returns true if value found on page.
+ *
+ * The items are compressed, so they have to be decoded in order until we
+ * reach the value or pass it.
  */
 static bool
 dataLocateLeafItem(GinBtree btree, GinBtreeStack *stack)
 {
 	Page		page = BufferGetPage(stack->buffer);
-	OffsetNumber low,
-				high;
+	OffsetNumber i,
+				maxoff;
+	ItemPointerData item;
+	char	   *ptr;
 	int			result;
 
 	Assert(GinPageIsLeaf(page));
@@ -174,35 +192,25 @@ dataLocateLeafItem(GinBtree btree, GinBtreeStack *stack)
 		return TRUE;
 	}
 
-	low = FirstOffsetNumber;
-	high = GinPageGetOpaque(page)->maxoff;
-
-	if (high < low)
-	{
-		stack->off = FirstOffsetNumber;
-		return false;
-	}
-
-	high++;
+	maxoff = GinPageGetOpaque(page)->maxoff;
+	ptr = GinDataPageGetData(page);
+	ItemPointerSetMin(&item);
 
-	while (high > low)
+	for (i = FirstOffsetNumber; i <= maxoff; i++)
 	{
-		OffsetNumber mid = low + ((high - low) / 2);
-
-		result = compareItemPointers(btree->items + btree->curitem, (ItemPointer) GinDataPageGetItem(page, mid));
+		ptr = ginDecodeItemPointer(ptr, &item);
 
+		result = compareItemPointers(btree->items + btree->curitem, &item);
 		if (result == 0)
 		{
-			stack->off = mid;
+			stack->off = i;
 			return true;
 		}
-		else if (result > 0)
-			low = mid + 1;
-		else
-			high = mid;
+		else if (result < 0)
+			break;
 	}
 
-	stack->off = high;
+	stack->off = i;
 	return false;
 }
 
@@ -269,8 +277,8 @@ dataGetLeftMostPage(GinBtree btree, Page page)
 }
 
 /*
- * add ItemPointer or PostingItem to page. data should point to
- * correct value! depending on leaf or non-leaf page
+ * add PostingItem to non-leaf page. data should point to
+ * correct value!
  */
 void
 GinDataPageAddItem(Page page, void *data, OffsetNumber offset)
@@ -278,6 +286,8 @@ GinDataPageAddItem(Page page, void *data, OffsetNumber offset)
 	OffsetNumber maxoff = GinPageGetOpaque(page)->maxoff;
 	char	   *ptr;
 
+	Assert(!GinPageIsLeaf(page));
+
 	if (offset == InvalidOffsetNumber)
 	{
 		ptr = GinDataPageGetItem(page, maxoff + 1);
@@ -293,6 +303,45 @@ GinDataPageAddItem(Page page, void *data, OffsetNumber offset)
 	GinPageGetOpaque(page)->maxoff++;
 }
 
+/*
+ * Decodes the items of a leaf page into items[], which must have room for
+ * GinPageGetOpaque(page)->maxoff of them.  Returns the number of items.
+ */
+uint32
+GinDataLeafPageGetItems(Page page, ItemPointerData *items)
+{
+	uint32		nitems = GinPageGetOpaque(page)->maxoff;
+
+	Assert(GinPageIsLeaf(page));
+	Assert(GinPageIsData(page));
+
+	ginDecompressPostingList(GinDataPageGetData(page), nitems, items);
+
+	return nitems;
+}
+
+/*
+ * Replaces the contents of a leaf page with the given items, which must be
+ * in ascending order.  This is also used in critical sections, so it must
+ * not allocate memory.
+ */
+void
+GinDataLeafPageSetItems(Page page, ItemPointerData *items, uint32 nitems)
+{
+	Size		size;
+
+	Assert(GinPageIsLeaf(page));
+	Assert(GinPageIsData(page));
+
+	if (ginCompressPostingList(items, nitems, GinDataPageGetData(page),
+							   GinDataLeafMaxContentSize, &size) != nitems)
+		elog(ERROR, "too many items for GIN posting tree leaf page");
+
+	GinPageGetOpaque(page)->maxoff = nitems;
+	((PageHeader) page)->pd_lower =
+		(GinDataPageGetData(page) - (char *) page) + size;
+}
+
 /*
  * Deletes posting item from non-leaf page
  */
@@ -311,9 +360,73 @@ PageDeletePostingItem(Page page, OffsetNumber offset)
 	GinPageGetOpaque(page)->maxoff--;
 }
 
+/*
+ * Merges the items already on a leaf page with the items to insert that
+ * belong on it: the current one and the following ones up to the page's
+ * right bound (all of them, if it's the rightmost page), but no more than
+ * maxcand of them.  Returns the merged items in a palloc'd array, with
+ * their number in *nmerged.  *ncand is set to the number of items to
+ * insert that were merged, and *lastPageItem to the last item that was on
+ * the page, if there were any.
+ */
+static ItemPointerData *
+dataMergeLeafItems(GinBtree btree, Page page, uint32 maxcand,
+				   uint32 *nmerged, uint32 *ncand, ItemPointer lastPageItem)
+{
+	ItemPointer bound = GinDataPageGetRightBound(page);
+	uint32		npage = GinPageGetOpaque(page)->maxoff;
+	ItemPointerData *pageItems;
+	ItemPointerData *merged;
+	uint32		i;
+
+	for (i = btree->curitem; i < btree->nitem && i - btree->curitem < maxcand; i++)
+	{
+		if (!GinPageRightMost(page) &&
+			compareItemPointers(btree->items + i, bound) > 0)
+			break;
+	}
+	*ncand = i - btree->curitem;
+
+	pageItems = (ItemPointerData *) palloc(sizeof(ItemPointerData) * (npage + 1));
+	GinDataLeafPageGetItems(page, pageItems);
+	if (npage > 0)
+		*lastPageItem = pageItems[npage - 1];
+
+	merged = (ItemPointerData *) palloc(sizeof(ItemPointerData) * (npage + *ncand));
+	*nmerged = MergeItemPointers(merged, pageItems, npage,
+								 btree->items + btree->curitem, *ncand);
+	pfree(pageItems);
+
+	return merged;
+}
+
+/*
+ * Returns how many of the first ncand items to insert are not beyond
+ * lastItem, that is, were stored by placing merged items up to lastItem.
+ */
+static uint32
+dataCountPlacedItems(GinBtree btree, uint32 ncand, ItemPointer lastItem)
+{
+	uint32		i;
+
+	for (i = 0; i < ncand; i++)
+	{
+		if (compareItemPointers(btree->items + btree->curitem + i, lastItem) > 0)
+			break;
+	}
+
+	return i;
+}
+
 /*
  * checks space to install new value,
  * item pointer never deletes!
+ *
+ * For a leaf page, the only way to tell is to merge the items and compress
+ * the result, so this also prepares the page's new contents for
+ * dataPlaceToPage.  Any prefix of the merged items that includes all the
+ * items already on the page will do; the items to insert that don't fit
+ * are left for the next descent.
  */
 static bool
 dataIsEnoughSpace(GinBtree btree, Buffer buf, OffsetNumber off)
@@ -325,13 +438,32 @@ dataIsEnoughSpace(GinBtree btree, Buffer buf, OffsetNumber off)
 
 	if (GinPageIsLeaf(page))
 	{
-		if (GinPageRightMost(page) && off > GinPageGetOpaque(page)->maxoff)
-		{
-			if ((btree->nitem - btree->curitem) * sizeof(ItemPointerData) <= GinDataPageGetFreeSpace(page))
-				return true;
-		}
-		else if (sizeof(ItemPointerData) <= GinDataPageGetFreeSpace(page))
-			return true;
+		ItemPointerData *merged;
+		ItemPointerData lastPageItem;
+		uint32		nmerged,
+					ncand;
+
+		/* every item takes at least one byte, so that's plenty of them */
+		merged = dataMergeLeafItems(btree, page, GinDataLeafMaxContentSize,
+									&nmerged, &ncand, &lastPageItem);
+
+		leafNItems = ginCompressPostingList(merged, nmerged, leafData,
+											GinDataLeafMaxContentSize,
+											&leafDataSize);
+
+		if (leafNItems == nmerged)
+			leafNInserted = ncand;
+		else if (leafNItems > 0 &&
+				 (GinPageGetOpaque(page)->maxoff == 0 ||
+				compareItemPointers(&merged[leafNItems - 1], &lastPageItem) >= 0))
+			leafNInserted = dataCountPlacedItems(btree, ncand,
+												 &merged[leafNItems - 1]);
+		else
+			leafNInserted = 0;
+
+		pfree(merged);
+
+		return (leafNInserted > 0);
 	}
 	else if (sizeof(PostingItem) <= GinDataPageGetFreeSpace(page))
 		return true;
@@ -365,8 +497,9 @@ dataPrepareData(GinBtree btree, Page page, OffsetNumber off)
 }
 
 /*
- * Places keys to page and fills WAL record. In case leaf page and
- * build mode puts all ItemPointers to page.
+ * Places keys to page and fills WAL record. For a leaf page, the new
+ * contents were already prepared by dataIsEnoughSpace, and the WAL record
+ * carries the items that were merged into the page.
  */
 static void
 dataPlaceToPage(GinBtree btree, Buffer buf, OffsetNumber off, XLogRecData **prdata)
@@ -420,35 +553,146 @@ dataPlaceToPage(GinBtree btree, Buffer buf, OffsetNumber off, XLogRecData **prda
 
 	if (GinPageIsLeaf(page))
 	{
-		if (GinPageRightMost(page) && off > GinPageGetOpaque(page)->maxoff)
-		{
-			/* usually, create index... */
-			uint32		savedPos = btree->curitem;
-
-			while (btree->curitem < btree->nitem)
-			{
-				GinDataPageAddItem(page, btree->items + btree->curitem, off);
-				off++;
-				btree->curitem++;
-			}
-			data.nitem = btree->curitem - savedPos;
-			rdata[cnt].len = sizeofitem * data.nitem;
-		}
+		memcpy(GinDataPageGetData(page), leafData, leafDataSize);
+		((PageHeader) page)->pd_lower =
+			(GinDataPageGetData(page) - (char *) page) + leafDataSize;
+		GinPageGetOpaque(page)->maxoff = leafNItems;
+
+		data.nitem = leafNInserted;
+		rdata[cnt].len = sizeof(ItemPointerData) * leafNInserted;
+		btree->curitem += leafNInserted;
+	}
+	else
+		GinDataPageAddItem(page, &(btree->pitem), off);
+}
+
+/*
+ * Splits a leaf page; see dataSplitPage.  The items on the page are merged
+ * with the items to insert that belong on it, and divided so that the left
+ * page gets about half of the compressed data.  In build mode, we suppose
+ * that the table is scanned from begin to end, so ItemPointers are
+ * monotonically increased, and the rightmost page is split by filling the
+ * left page completely.
+ *
+ * The WAL record carries the compressed posting lists of both pages.
+ */
+static Page
+dataSplitLeafPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRecData **prdata)
+{
+	static ginxlogSplit data;
+	static XLogRecData rdata[2];
+	static char vector[2 * BLCKSZ];
+	Page		lpage = PageGetTempPageCopy(BufferGetPage(lbuf));
+	Page		rpage = BufferGetPage(rbuf);
+	uint32		flags = GinPageGetOpaque(lpage)->flags;
+	ItemPointerData oldbound = *GinDataPageGetRightBound(lpage);
+	ItemPointerData lastPageItem;
+	Size		pageSize = PageGetPageSize(lpage);
+	ItemPointerData *merged;
+	uint32		nmerged,
+				ncand,
+				nleft,
+				nright,
+				ninserted;
+	Size		totalSize,
+				lsize,
+				rsize;
+	ItemPointer bound;
+
+	*prdata = rdata;
+	data.leftChildBlkno = InvalidOffsetNumber;
+	data.updateBlkno = dataPrepareData(btree, lpage, off);
+
+	merged = dataMergeLeafItems(btree, lpage, GinDataLeafMaxContentSize,
+								&nmerged, &ncand, &lastPageItem);
+	for (;;)
+	{
+		Size		leftSize;
+
+		if (btree->isBuild && GinPageRightMost(lpage))
+			leftSize = GinDataLeafMaxContentSize;
 		else
 		{
-			GinDataPageAddItem(page, btree->items + btree->curitem, off);
-			btree->curitem++;
+			ginCompressPostingList(merged, nmerged, NULL, MaxAllocSize,
+								   &totalSize);
+			leftSize = Min(totalSize / 2, GinDataLeafMaxContentSize);
 		}
+
+		nleft = ginCompressPostingList(merged, nmerged, vector,
+									   leftSize, &lsize);
+		nright = ginCompressPostingList(merged + nleft, nmerged - nleft,
+										vector + lsize,
+										GinDataLeafMaxContentSize, &rsize);
+		Assert(nleft > 0 && nright > 0);
+
+		/*
+		 * Stop if all the items of the page, and at least one of the items
+		 * to insert, have found a place.  Otherwise, which can only happen
+		 * if a lot of the items to insert belong on this page, settle for
+		 * inserting just the current one.
+		 */
+		ninserted = dataCountPlacedItems(btree, ncand,
+										 &merged[nleft + nright - 1]);
+		if (ninserted > 0 &&
+			(GinPageGetOpaque(lpage)->maxoff == 0 ||
+		compareItemPointers(&merged[nleft + nright - 1], &lastPageItem) >= 0))
+			break;
+
+		Assert(ncand > 1);
+		pfree(merged);
+		merged = dataMergeLeafItems(btree, lpage, 1,
+									&nmerged, &ncand, &lastPageItem);
 	}
-	else
-		GinDataPageAddItem(page, &(btree->pitem), off);
+
+	GinInitPage(rpage, flags, pageSize);
+	GinInitPage(lpage, flags, pageSize);
+
+	GinDataLeafPageSetItems(lpage, merged, nleft);
+	GinDataLeafPageSetItems(rpage, merged + nleft, nright);
+	btree->curitem += ninserted;
+
+	PostingItemSetBlockNumber(&(btree->pitem), BufferGetBlockNumber(lbuf));
+	btree->pitem.key = merged[nleft - 1];
+	btree->rightblkno = BufferGetBlockNumber(rbuf);
+
+	/* set up right bound for left page */
+	bound = GinDataPageGetRightBound(lpage);
+	*bound = btree->pitem.key;
+
+	/* set up right bound for right page */
+	bound = GinDataPageGetRightBound(rpage);
+	*bound = oldbound;
+
+	pfree(merged);
+
+	data.node = btree->index->rd_node;
+	data.rootBlkno = InvalidBlockNumber;
+	data.lblkno = BufferGetBlockNumber(lbuf);
+	data.rblkno = BufferGetBlockNumber(rbuf);
+	data.separator = nleft;
+	data.nitem = nleft + nright;
+	data.isData = TRUE;
+	data.isLeaf = TRUE;
+	data.isRootSplit = FALSE;
+	data.rightbound = oldbound;
+
+	rdata[0].buffer = InvalidBuffer;
+	rdata[0].data = (char *) &data;
+	rdata[0].len = sizeof(ginxlogSplit);
+	rdata[0].next = &rdata[1];
+
+	rdata[1].buffer = InvalidBuffer;
+	rdata[1].data = vector;
+	rdata[1].len = lsize + rsize;
+	rdata[1].next = NULL;
+
+	return lpage;
 }
 
 /*
  * split page and fills WAL record. original buffer(lbuf) leaves untouched,
- * returns shadow page of lbuf filled new data. In leaf page and build mode puts all
- * ItemPointers to pages. Also, in build mode splits data by way to full fulled
- * left page
+ * returns shadow page of lbuf filled new data. Leaf pages are handled by
+ * dataSplitLeafPage.
  */
 static Page
 dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRecData **prdata)
@@ -459,62 +703,36 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	char	   *ptr;
 	OffsetNumber separator;
 	ItemPointer bound;
-	Page		lpage = PageGetTempPageCopy(BufferGetPage(lbuf));
-	ItemPointerData oldbound = *GinDataPageGetRightBound(lpage);
-	int			sizeofitem = GinSizeOfItem(lpage);
-	OffsetNumber maxoff = GinPageGetOpaque(lpage)->maxoff;
+	Page		lpage;
+	ItemPointerData oldbound;
+	int			sizeofitem = sizeof(PostingItem);
+	OffsetNumber maxoff;
 	Page		rpage = BufferGetPage(rbuf);
-	Size		pageSize = PageGetPageSize(lpage);
-	Size		freeSpace;
-	uint32		nCopied = 1;
+	Size		pageSize;
 
-	GinInitPage(rpage, GinPageGetOpaque(lpage)->flags, pageSize);
-	freeSpace = GinDataPageGetFreeSpace(rpage);
+	if (GinPageIsLeaf(BufferGetPage(lbuf)))
+		return dataSplitLeafPage(btree, lbuf, rbuf, off, prdata);
+
+	lpage = PageGetTempPageCopy(BufferGetPage(lbuf));
+	oldbound = *GinDataPageGetRightBound(lpage);
+	maxoff = GinPageGetOpaque(lpage)->maxoff;
+	pageSize = PageGetPageSize(lpage);
 
 	*prdata = rdata;
-	data.leftChildBlkno = (GinPageIsLeaf(lpage)) ?
-		InvalidOffsetNumber : PostingItemGetBlockNumber(&(btree->pitem));
+	data.leftChildBlkno = PostingItemGetBlockNumber(&(btree->pitem));
 	data.updateBlkno = dataPrepareData(btree, lpage, off);
 
 	memcpy(vector, GinDataPageGetItem(lpage, FirstOffsetNumber),
 		   maxoff * sizeofitem);
 
-	if (GinPageIsLeaf(lpage) && GinPageRightMost(lpage) && off > GinPageGetOpaque(lpage)->maxoff)
-	{
-		nCopied = 0;
-		while (btree->curitem < btree->nitem && maxoff * sizeof(ItemPointerData) < 2 * (freeSpace - sizeof(ItemPointerData)))
-		{
-			memcpy(vector + maxoff * sizeof(ItemPointerData), btree->items + btree->curitem,
-				   sizeof(ItemPointerData));
-			maxoff++;
-			nCopied++;
-			btree->curitem++;
-		}
-	}
-	else
-	{
-		ptr = vector + (off - 1) * sizeofitem;
-		if (maxoff + 1 - off != 0)
-			memmove(ptr + sizeofitem, ptr, (maxoff - off + 1) * sizeofitem);
-		if (GinPageIsLeaf(lpage))
-		{
-			memcpy(ptr, btree->items + btree->curitem, sizeofitem);
-			btree->curitem++;
-		}
-		else
-			memcpy(ptr, &(btree->pitem), sizeofitem);
+	ptr = vector + (off - 1) * sizeofitem;
+	if (maxoff + 1 - off != 0)
+		memmove(ptr + sizeofitem, ptr, (maxoff - off + 1) * sizeofitem);
+	memcpy(ptr, &(btree->pitem), sizeofitem);
 
-		maxoff++;
-	}
+	maxoff++;
 
-	/*
-	 * we suppose that during index creation table scaned from begin to end,
-	 * so ItemPointers are monotonically increased..
-	 */
-	if (btree->isBuild && GinPageRightMost(lpage))
-		separator = freeSpace / sizeofitem;
-	else
-		separator = maxoff / 2;
+	separator = maxoff / 2;
 
 	GinInitPage(rpage, GinPageGetOpaque(lpage)->flags, pageSize);
 	GinInitPage(lpage, GinPageGetOpaque(rpage)->flags, pageSize);
@@ -526,11 +744,7 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	GinPageGetOpaque(rpage)->maxoff = maxoff - separator;
 
 	PostingItemSetBlockNumber(&(btree->pitem), BufferGetBlockNumber(lbuf));
-	if (GinPageIsLeaf(lpage))
-		btree->pitem.key = *(ItemPointerData *) GinDataPageGetItem(lpage,
-											GinPageGetOpaque(lpage)->maxoff);
-	else
-		btree->pitem.key = ((PostingItem *) GinDataPageGetItem(lpage,
+	btree->pitem.key = ((PostingItem *) GinDataPageGetItem(lpage,
 									  GinPageGetOpaque(lpage)->maxoff))->key;
 	btree->rightblkno = BufferGetBlockNumber(rbuf);
 
@@ -549,7 +763,7 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	data.separator = separator;
 	data.nitem = maxoff;
 	data.isData = TRUE;
-	data.isLeaf = GinPageIsLeaf(lpage) ? TRUE : FALSE;
+	data.isLeaf = FALSE;
 	data.isRootSplit = FALSE;
 	data.rightbound = oldbound;
 
@@ -16,6 +16,7 @@
 
 #include "access/gin.h"
 #include "storage/bufmgr.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
 /*
@@ -35,9 +36,9 @@
  *		- ItemPointerGetOffsetNumber(&itup->t_tid) contains number
  *		  of elements in posting list (number of heap itempointers)
  *		  Macros: GinGetNPosting(itup) / GinSetNPosting(itup,n)
- *		- After standard part of tuple there is a posting list, ie, array
- *		  of heap itempointers
- *		  Macros: GinGetPosting(itup)
+ *		- After standard part of tuple there is a posting list of heap
+ *		  itempointers, compressed as described in ginpostinglist.c
+ *		  Macros: GinGetPosting(itup), ginReadTuple() decodes it
  * 2) Posting tree
  *		- itup->t_info & INDEX_SIZE_MASK contains size of tuple as usual
  *		- ItemPointerGetBlockNumber(&itup->t_tid) contains block number of
@@ -74,7 +75,10 @@ GinFormTuple(Relation index, GinState *ginstate,
 
 	if (nipd > 0)
 	{
-		newsize = MAXALIGN(SHORTALIGN(IndexTupleSize(itup)) + sizeof(ItemPointerData) * nipd);
+		Size		listsize;
+
+		ginCompressPostingList(ipd, nipd, NULL, MaxAllocSize, &listsize);
+		newsize = MAXALIGN(SHORTALIGN(IndexTupleSize(itup)) + listsize);
 		if (newsize > Min(INDEX_SIZE_MASK, GinMaxItemSize))
 		{
 			if (errorTooBig)
@@ -89,27 +93,29 @@ GinFormTuple(Relation index, GinState *ginstate,
 		}
 
 		itup = repalloc(itup, newsize);
+		memset((char *) itup + IndexTupleSize(itup), 0,
+			   newsize - IndexTupleSize(itup));
 
 		/* set new size */
 		itup->t_info &= ~INDEX_SIZE_MASK;
 		itup->t_info |= newsize;
 
-		if (ipd)
-			memcpy(GinGetPosting(itup), ipd, sizeof(ItemPointerData) * nipd);
+		ginCompressPostingList(ipd, nipd, GinGetPosting(itup), listsize, NULL);
 		GinSetNPosting(itup, nipd);
 	}
 	else
 	{
 		/*
-		 * Gin tuple without any ItemPointers should be large enough to keep
+		 * Gin tuple without any ItemPointers should be small enough to keep
 		 * one ItemPointer, to prevent inconsistency between
 		 * ginHeapTupleFastCollect and ginEntryInsert called by
 		 * ginHeapTupleInsert.	ginHeapTupleFastCollect forms tuple without
 		 * extra pointer to heap, but ginEntryInsert (called for pending list
 		 * cleanup during vacuum) will form the same tuple with one
-		 * ItemPointer.
+		 * ItemPointer, which takes up to GinPostingListMaxItemSize bytes
+		 * when compressed.
 		 */
-		newsize = MAXALIGN(SHORTALIGN(IndexTupleSize(itup)) + sizeof(ItemPointerData));
+		newsize = MAXALIGN(SHORTALIGN(IndexTupleSize(itup)) + GinPostingListMaxItemSize);
 		if (newsize > Min(INDEX_SIZE_MASK, GinMaxItemSize))
 		{
 			if (errorTooBig)
@@ -129,25 +135,22 @@ GinFormTuple(Relation index, GinState *ginstate,
 }
 
 /*
- * Sometimes we reduce the number of posting list items in a tuple after
- * having built it with GinFormTuple.  This function adjusts the size
- * fields to match.
+ * Decodes the posting list of a tuple formed by GinFormTuple into a
+ * palloc'd array.  The number of items is returned in *nitems.
  */
-void
-GinShortenTuple(IndexTuple itup, uint32 nipd)
+ItemPointer
+ginReadTuple(IndexTuple itup, uint32 *nitems)
 {
-	uint32		newsize;
-
-	Assert(nipd <= GinGetNPosting(itup));
-
-	newsize = MAXALIGN(SHORTALIGN(GinGetOrigSizePosting(itup)) + sizeof(ItemPointerData) * nipd);
+	uint32		nipd = GinGetNPosting(itup);
+	ItemPointer ipd;
 
-	Assert(newsize <= (itup->t_info & INDEX_SIZE_MASK));
+	Assert(!GinIsPostingTree(itup));
 
-	itup->t_info &= ~INDEX_SIZE_MASK;
-	itup->t_info |= newsize;
+	ipd = (ItemPointer) palloc(sizeof(ItemPointerData) * (nipd + 1));
+	ginDecompressPostingList(GinGetPosting(itup), nipd, ipd);
 
-	GinSetNPosting(itup, nipd);
+	*nitems = nipd;
+	return ipd;
 }
 
 /*
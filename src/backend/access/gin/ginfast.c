@@ -3,7 +3,8 @@
  * ginfast.c
  *	  Fast insert routines for the Postgres inverted index access method.
  *	  Pending entries are stored in linear list of pages.  Later on
- *	  (typically during VACUUM), ginInsertCleanup() will be invoked to
+ *	  (typically during VACUUM, or by autovacuum once the list exceeds
+ *	  gin_pending_list_limit), ginInsertCleanup() will be invoked to
  *	  transfer pending entries into the regular index structure.  This
  *	  wins because bulk insertion is much more efficient than retail.
  *
@@ -23,13 +24,27 @@
 #include "catalog/index.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
+#include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "utils/memutils.h"
 
 
+/* GUC parameter */
+int			gin_pending_list_limit = 0;
+
 #define GIN_PAGE_FREESIZE \
 	( BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(GinPageOpaqueData)) )
 
+/*
+ * Once the pending list is this many times gin_pending_list_limit, new
+ * entries bypass it and go straight into the main structure, so that the
+ * list can't grow without bound while autovacuum catches up with it.
+ */
+#define GIN_PENDING_LIST_HARD_FACTOR	4
+
+#define GinPendingListSize(metadata) \
+	((int64) (metadata)->nPendingPages * GIN_PAGE_FREESIZE)
+
 typedef struct DatumArray
 {
 	Datum	   *values;			/* expansible array */
@@ -405,15 +420,17 @@ ginHeapTupleFastInsert(Relation index, GinState *ginstate,
 		UnlockReleaseBuffer(buffer);
 
 	/*
-	 * Force pending list cleanup when it becomes too long. And,
-	 * ginInsertCleanup could take significant amount of time, so we prefer to
-	 * call it when it can do all the work in a single collection cycle. In
-	 * non-vacuum mode, it shouldn't require maintenance_work_mem, so fire it
-	 * while pending list is still small enough to fit into work_mem.
+	 * Force pending list cleanup when it becomes too long.  Normally that's
+	 * left to autovacuum, which looks for GIN indexes whose pending list has
+	 * grown past gin_pending_list_limit, so that no inserting backend has to
+	 * stall for the time ginInsertCleanup takes.  Without autovacuum we must
+	 * do it ourselves, the same way, while the list is still small enough to
+	 * be processed in a single collection cycle.
 	 *
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
 	 */
-	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > work_mem * 1024L)
+	if (GinPendingListSize(metadata) > (int64) gin_pending_list_limit * 1024 &&
+		!AutoVacuumingActive())
 		needCleanup = true;
 
 	UnlockReleaseBuffer(metabuffer);
@@ -882,3 +899,52 @@ ginInsertCleanup(Relation index, GinState *ginstate,
 	MemoryContextSwitchTo(oldCtx);
 	MemoryContextDelete(opCtx);
 }
+
+/*
+ * Has the pending list grown so long that new entries should bypass it?
+ *
+ * This is only a hint, so we don't worry about the list changing right
+ * after we look.
+ */
+bool
+ginPendingListIsFull(Relation index)
+{
+	Buffer		metabuffer;
+	int64		size;
+
+	metabuffer = ReadBuffer(index, GIN_METAPAGE_BLKNO);
+	LockBuffer(metabuffer, GIN_SHARE);
+	size = GinPendingListSize(GinPageGetMeta(BufferGetPage(metabuffer)));
+	UnlockReleaseBuffer(metabuffer);
+
+	return size > GIN_PENDING_LIST_HARD_FACTOR * (int64) gin_pending_list_limit * 1024;
+}
+
+/*
+ * Move the pending list into the regular index structure if it has grown
+ * past gin_pending_list_limit.  This is done by autovacuum, which calls it
+ * for every GIN index, with the index and its table locked against
+ * schema changes.
+ *
+ * Returns true if the list was cleaned up.
+ */
+bool
+ginPendingListAutoCleanup(Relation index)
+{
+	Buffer		metabuffer;
+	int64		size;
+	GinState	ginstate;
+
+	metabuffer = ReadBuffer(index, GIN_METAPAGE_BLKNO);
+	LockBuffer(metabuffer, GIN_SHARE);
+	size = GinPendingListSize(GinPageGetMeta(BufferGetPage(metabuffer)));
+	UnlockReleaseBuffer(metabuffer);
+
+	if (size <= (int64) gin_pending_list_limit * 1024)
+		return false;
+
+	initGinState(&ginstate, index);
+	ginInsertCleanup(index, &ginstate, true, NULL);
+
+	return true;
+}
@@ -34,12 +34,13 @@ typedef struct pendingPosition
 
 
 /*
- * Tries to refind previously taken ItemPointer on page.
+ * Tries to refind previously taken ItemPointer on page, whose items have
+ * already been decoded into items[].
  */
 static bool
-findItemInPage(Page page, ItemPointer item, OffsetNumber *off)
+findItemInPage(Page page, ItemPointerData *items, uint32 nitems,
+			   ItemPointer item, OffsetNumber *off)
 {
-	OffsetNumber maxoff = GinPageGetOpaque(page)->maxoff;
 	int			res;
 
 	if (GinPageGetOpaque(page)->flags & GIN_DELETED)
@@ -49,9 +50,9 @@ findItemInPage(Page page, ItemPointer item, OffsetNumber *off)
 	/*
 	 * scan page to find equal or first greater value
 	 */
-	for (*off = FirstOffsetNumber; *off <= maxoff; (*off)++)
+	for (*off = FirstOffsetNumber; *off <= nitems; (*off)++)
 	{
-		res = compareItemPointers(item, (ItemPointer) GinDataPageGetItem(page, *off));
+		res = compareItemPointers(item, items + *off - 1);
 
 		if (res <= 0)
 			return true;
@@ -98,6 +99,7 @@ scanForItems(Relation index, GinScanEntry scanEntry, BlockNumber rootPostingTree
 	Buffer		buffer;
 	Page		page;
 	BlockNumber blkno;
+	ItemPointerData *items;
 
 	gdi = prepareScanPostingTree(index, rootPostingTree, TRUE);
 
@@ -107,6 +109,9 @@ scanForItems(Relation index, GinScanEntry scanEntry, BlockNumber rootPostingTree
 	freeGinBtreeStack(gdi->stack);
 	pfree(gdi);
 
+	/* room for the decoded items of any leaf page */
+	items = (ItemPointerData *) palloc(sizeof(ItemPointerData) * GinDataLeafMaxContentSize);
+
 	/*
 	 * Goes through all leaves
 	 */
@@ -116,16 +121,17 @@ scanForItems(Relation index, GinScanEntry scanEntry, BlockNumber rootPostingTree
 
 		if ((GinPageGetOpaque(page)->flags & GIN_DELETED) == 0 && GinPageGetOpaque(page)->maxoff >= FirstOffsetNumber)
 		{
-			tbm_add_tuples(scanEntry->partialMatch,
-				   (ItemPointer) GinDataPageGetItem(page, FirstOffsetNumber),
-						   GinPageGetOpaque(page)->maxoff, false);
-			scanEntry->predictNumberResult += GinPageGetOpaque(page)->maxoff;
+			uint32		nitems = GinDataLeafPageGetItems(page, items);
+
+			tbm_add_tuples(scanEntry->partialMatch, items, nitems, false);
+			scanEntry->predictNumberResult += nitems;
 		}
 
 		blkno = GinPageGetOpaque(page)->rightlink;
 		if (GinPageRightMost(page))
 		{
 			UnlockReleaseBuffer(buffer);
+			pfree(items);
 			return;				/* no more pages */
 		}
 
@@ -254,8 +260,12 @@ computePartialMatchList(GinBtreeData *btree, GinBtreeStack *stack, GinScanEntry
 		}
 		else
 		{
-			tbm_add_tuples(scanEntry->partialMatch, GinGetPosting(itup), GinGetNPosting(itup), false);
-			scanEntry->predictNumberResult += GinGetNPosting(itup);
+			uint32		nitems;
+			ItemPointerData *items = ginReadTuple(itup, &nitems);
+
+			tbm_add_tuples(scanEntry->partialMatch, items, nitems, false);
+			scanEntry->predictNumberResult += nitems;
+			pfree(items);
 		}
 
 		/*
@@ -374,12 +384,12 @@ startScanEntry(Relation index, GinState *ginstate, GinScanEntry entry)
 			entry->predictNumberResult = gdi->stack->predictNumber * GinPageGetOpaque(page)->maxoff;
 
 			/*
-			 * Keep page content in memory to prevent durable page locking
+			 * Keep page content in memory to prevent durable page locking.
+			 * The list is decoded from each leaf page in turn, so it needs
+			 * room for as many items as a leaf page can hold.
 			 */
-			entry->list = (ItemPointerData *) palloc(BLCKSZ);
-			entry->nlist = GinPageGetOpaque(page)->maxoff;
-			memcpy(entry->list, GinDataPageGetItem(page, FirstOffsetNumber),
-				   GinPageGetOpaque(page)->maxoff * sizeof(ItemPointerData));
+			entry->list = (ItemPointerData *) palloc(sizeof(ItemPointerData) * GinDataLeafMaxContentSize);
+			entry->nlist = GinDataLeafPageGetItems(page, entry->list);
 
 			LockBuffer(entry->buffer, GIN_UNLOCK);
 			freeGinBtreeStack(gdi->stack);
@@ -388,9 +398,7 @@ startScanEntry(Relation index, GinState *ginstate, GinScanEntry entry)
 		}
 		else if (GinGetNPosting(itup) > 0)
 		{
-			entry->nlist = GinGetNPosting(itup);
-			entry->list = (ItemPointerData *) palloc(sizeof(ItemPointerData) * entry->nlist);
-			memcpy(entry->list, GinGetPosting(itup), sizeof(ItemPointerData) * entry->nlist);
+			entry->list = ginReadTuple(itup, &entry->nlist);
 			entry->isFinished = FALSE;
 		}
 	}
@@ -491,16 +499,14 @@ entryGetNextItem(Relation index, GinScanEntry entry)
 			page = BufferGetPage(entry->buffer);
 
 			entry->offset = InvalidOffsetNumber;
+			entry->nlist = GinDataLeafPageGetItems(page, entry->list);
 			if (!ItemPointerIsValid(&entry->curItem) ||
-				findItemInPage(page, &entry->curItem, &entry->offset))
+				findItemInPage(page, entry->list, entry->nlist,
+							   &entry->curItem, &entry->offset))
 			{
 				/*
 				 * Found position equal to or greater than stored
 				 */
-				entry->nlist = GinPageGetOpaque(page)->maxoff;
-				memcpy(entry->list, GinDataPageGetItem(page, FirstOffsetNumber),
-				   GinPageGetOpaque(page)->maxoff * sizeof(ItemPointerData));
-
 				LockBuffer(entry->buffer, GIN_UNLOCK);
 
 				if (!ItemPointerIsValid(&entry->curItem) ||
@@ -49,8 +49,7 @@ createPostingTree(Relation index, ItemPointerData *items, uint32 nitems)
 	page = BufferGetPage(buffer);
 	blkno = BufferGetBlockNumber(buffer);
 
-	memcpy(GinDataPageGetData(page), items, sizeof(ItemPointerData) * nitems);
-	GinPageGetOpaque(page)->maxoff = nitems;
+	GinDataLeafPageSetItems(page, items, nitems);
 
 	MarkBufferDirty(buffer);
 
@@ -102,29 +101,28 @@ addItemPointersToTuple(Relation index, GinState *ginstate, GinBtreeStack *stack,
 {
 	Datum		key = gin_index_getattr(ginstate, old);
 	OffsetNumber attnum = gintuple_get_attrnum(ginstate, old);
-	IndexTuple	res = GinFormTuple(index, ginstate, attnum, key,
-								   NULL, nitem + GinGetNPosting(old),
-								   false);
+	ItemPointerData *oldItems;
+	ItemPointerData *newItems;
+	uint32		noldItems;
+	uint32		nnewItems;
+	IndexTuple	res;
 
-	if (res)
-	{
-		/* good, small enough */
-		uint32		newnitem;
-
-		newnitem = MergeItemPointers(GinGetPosting(res),
-									 GinGetPosting(old), GinGetNPosting(old),
-									 items, nitem);
-		/* merge might have eliminated some duplicate items */
-		GinShortenTuple(res, newnitem);
-	}
-	else
+	/* the posting list is compressed, so decode and merge in a copy */
+	oldItems = ginReadTuple(old, &noldItems);
+	newItems = (ItemPointerData *) palloc(sizeof(ItemPointerData) * (noldItems + nitem));
+	nnewItems = MergeItemPointers(newItems, oldItems, noldItems, items, nitem);
+
+	res = GinFormTuple(index, ginstate, attnum, key,
+					   newItems, nnewItems, false);
+
+	if (!res)
 	{
 		BlockNumber postingRoot;
 		GinPostingTreeScan *gdi;
 
 		/* posting list becomes big, so we need to make posting's tree */
 		res = GinFormTuple(index, ginstate, attnum, key, NULL, 0, true);
-		postingRoot = createPostingTree(index, GinGetPosting(old), GinGetNPosting(old));
+		postingRoot = createPostingTree(index, oldItems, noldItems);
 		GinSetPostingTree(res, postingRoot);
 
 		gdi = prepareScanPostingTree(index, postingRoot, FALSE);
@@ -135,6 +133,9 @@ addItemPointersToTuple(Relation index, GinState *ginstate, GinBtreeStack *stack,
 		pfree(gdi);
 	}
 
+	pfree(oldItems);
+	pfree(newItems);
+
 	return res;
 }
 
@@ -433,7 +434,11 @@ gininsert(PG_FUNCTION_ARGS)
 
 	initGinState(&ginstate, index);
 
-	if (GinGetUseFastUpdate(index))
+	/*
+	 * Use the pending list if fast update is enabled, unless the list has
+	 * grown so long that autovacuum is evidently not keeping up with it.
+	 */
+	if (GinGetUseFastUpdate(index) && !ginPendingListIsFull(index))
 	{
 		GinTupleCollector collector;
 
@@ -0,0 +1,184 @@
+/*-------------------------------------------------------------------------
+ *
+ * ginpostinglist.c
+ *	  routines for dealing with compressed posting lists.
+ *
+ * Posting lists, in entry tuples and on posting tree leaf pages, are
+ * stored in a compressed format.  The item pointers are converted to 64-bit
+ * integers, with the offset number in the low MaxHeapTuplesPerPageBits
+ * bits and the block number in the bits above those, and each item is
+ * stored as the difference from the previous one (the first item as the
+ * difference from zero).  The differences are written in variable-byte
+ * encoding: 7 bits in each byte, least significant group first, with the
+ * high bit set in every byte except the last one of a value.  Since the
+ * items of a list are in ascending order, the differences between
+ * neighbouring items on the same or nearby heap pages fit in one or two
+ * bytes, instead of the six of an ItemPointerData.
+ *
+ * A block number uses at most 32 bits, so an encoded item never takes more
+ * than GinPostingListMaxItemSize bytes.  The encoding of a prefix of a list
+ * is a prefix of the encoding of the whole list, which lets callers find
+ * out how many items fit in a given space with a single pass.
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/gin.h"
+
+/*
+ * Number of bits needed for an offset number.  The special item pointers
+ * used by the GIN search logic never appear in a posting list, so only
+ * real heap offsets need to fit.
+ */
+#define MaxHeapTuplesPerPageBits	11
+
+static uint64
+itemptr_to_uint64(const ItemPointerData *iptr)
+{
+	uint64		val;
+
+	Assert(GinItemPointerGetOffsetNumber(iptr) < (1 << MaxHeapTuplesPerPageBits));
+
+	val = GinItemPointerGetBlockNumber(iptr);
+	val <<= MaxHeapTuplesPerPageBits;
+	val |= GinItemPointerGetOffsetNumber(iptr);
+
+	return val;
+}
+
+static void
+uint64_to_itemptr(uint64 val, ItemPointer iptr)
+{
+	ItemPointerSet(iptr,
+				   (BlockNumber) (val >> MaxHeapTuplesPerPageBits),
+			 (OffsetNumber) (val & ((1 << MaxHeapTuplesPerPageBits) - 1)));
+}
+
+/*
+ * Varbyte-encode 'val' into *ptr, and advance *ptr past it.
+ */
+static void
+encode_varbyte(uint64 val, unsigned char **ptr)
+{
+	unsigned char *p = *ptr;
+
+	while (val > 0x7F)
+	{
+		*(p++) = 0x80 | (val & 0x7F);
+		val >>= 7;
+	}
+	*(p++) = (unsigned char) val;
+
+	*ptr = p;
+}
+
+/*
+ * Decode varbyte-encoded integer at *ptr, and advance *ptr past it.
+ */
+static uint64
+decode_varbyte(unsigned char **ptr)
+{
+	unsigned char *p = *ptr;
+	uint64		val = 0;
+	int			shift = 0;
+	unsigned char c;
+
+	do
+	{
+		c = *(p++);
+		val |= ((uint64) (c & 0x7F)) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	*ptr = p;
+
+	return val;
+}
+
+/*
+ * Encode as many of the nipd items of ipd[], which must be in ascending
+ * order without duplicates, as fit in maxsize bytes.  The encoded list is
+ * written to dst, unless dst is NULL, in which case the items are only
+ * measured.  Returns the number of items encoded, and stores the number of
+ * bytes used in *nbytes if it's not NULL.
+ */
+uint32
+ginCompressPostingList(const ItemPointerData *ipd, uint32 nipd,
+					   char *dst, Size maxsize, Size *nbytes)
+{
+	uint64		prev = 0;
+	Size		size = 0;
+	uint32		i;
+
+	for (i = 0; i < nipd; i++)
+	{
+		unsigned char buf[GinPostingListMaxItemSize];
+		unsigned char *endptr = buf;
+		uint64		val = itemptr_to_uint64(&ipd[i]);
+		Size		len;
+
+		Assert(i == 0 || val > prev);
+
+		encode_varbyte(val - prev, &endptr);
+		len = endptr - buf;
+
+		if (size + len > maxsize)
+			break;
+
+		if (dst)
+			memcpy(dst + size, buf, len);
+		size += len;
+		prev = val;
+	}
+
+	if (nbytes)
+		*nbytes = size;
+
+	return i;
+}
+
+/*
+ * Decode nipd items from the compressed list at ptr into dst[].  Returns
+ * a pointer just past the end of the encoded items.
+ */
+char *
+ginDecompressPostingList(char *ptr, uint32 nipd, ItemPointerData *dst)
+{
+	unsigned char *p = (unsigned char *) ptr;
+	uint64		val = 0;
+	uint32		i;
+
+	for (i = 0; i < nipd; i++)
+	{
+		val += decode_varbyte(&p);
+		uint64_to_itemptr(val, &dst[i]);
+	}
+
+	return (char *) p;
+}
+
+/*
+ * Decode a single item from the compressed list at ptr, for callers that
+ * walk through a list one item at a time.  On entry, *item must hold the
+ * previous item of the list, or be set with ItemPointerSetMin before the
+ * first one; it's replaced with the decoded item.  Returns a pointer to
+ * the next encoded item.
+ */
+char *
+ginDecodeItemPointer(char *ptr, ItemPointer item)
+{
+	unsigned char *p = (unsigned char *) ptr;
+	uint64		val;
+
+	val = itemptr_to_uint64(item) + decode_varbyte(&p);
+	uint64_to_itemptr(val, item);
+
+	return (char *) p;
+}
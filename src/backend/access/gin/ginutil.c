@@ -205,6 +205,10 @@ GinInitPage(Page page, uint32 f, Size pageSize)
 	memset(opaque, 0, sizeof(GinPageOpaqueData));
 	opaque->flags = f;
 	opaque->rightlink = InvalidBlockNumber;
+
+	/* the compressed posting list of a data leaf page ends at pd_lower */
+	if ((f & (GIN_DATA | GIN_LEAF)) == (GIN_DATA | GIN_LEAF))
+		((PageHeader) page)->pd_lower = GinDataPageGetData(page) - (char *) page;
 }
 
 void
@@ -103,8 +103,7 @@ xlogVacuumPage(Relation index, Buffer buffer)
 	{
 		backup = GinDataPageGetData(page);
 		data.nitem = GinPageGetOpaque(page)->maxoff;
-		if (data.nitem)
-			len = MAXALIGN(sizeof(ItemPointerData) * data.nitem);
+		len = GinDataLeafPageGetPostingListSize(page);
 	}
 	else
 	{
@@ -182,10 +181,15 @@ ginVacuumPostingTreeLeaves(GinVacuumState *gvs, BlockNumber blkno, bool isRoot,
 	{
 		OffsetNumber newMaxOff,
 					oldMaxOff = GinPageGetOpaque(page)->maxoff;
-		ItemPointerData *cleaned = NULL;
+		ItemPointerData *items;
+		ItemPointerData *cleaned;
 
-		newMaxOff = ginVacuumPostingList(gvs,
-				(ItemPointer) GinDataPageGetData(page), oldMaxOff, &cleaned);
+		/* the items are compressed, so clean a decoded copy in place */
+		items = (ItemPointerData *) palloc(sizeof(ItemPointerData) * (oldMaxOff + 1));
+		GinDataLeafPageGetItems(page, items);
+		cleaned = items;
+
+		newMaxOff = ginVacuumPostingList(gvs, items, oldMaxOff, &cleaned);
 
 		/* saves changes about deleted tuple ... */
 		if (oldMaxOff != newMaxOff)
@@ -193,10 +197,7 @@ ginVacuumPostingTreeLeaves(GinVacuumState *gvs, BlockNumber blkno, bool isRoot,
 
 			START_CRIT_SECTION();
 
-			if (newMaxOff > 0)
-				memcpy(GinDataPageGetData(page), cleaned, sizeof(ItemPointerData) * newMaxOff);
-			pfree(cleaned);
-			GinPageGetOpaque(page)->maxoff = newMaxOff;
+			GinDataLeafPageSetItems(page, cleaned, newMaxOff);
 
 			MarkBufferDirty(buffer);
 			xlogVacuumPage(gvs->index, buffer);
@@ -207,6 +208,8 @@ ginVacuumPostingTreeLeaves(GinVacuumState *gvs, BlockNumber blkno, bool isRoot,
 			if (!isRoot && GinPageGetOpaque(page)->maxoff < FirstOffsetNumber)
 				hasVoidPage = TRUE;
 		}
+
+		pfree(items);
 	}
 	else
 	{
@@ -525,20 +528,23 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 		else if (GinGetNPosting(itup) > 0)
 		{
 			/*
-			 * if we already create temporary page, we will make changes in
-			 * place
+			 * The posting list is compressed, so we clean a decoded copy of
+			 * it in place
 			 */
-			ItemPointerData *cleaned = (tmppage == origpage) ? NULL : GinGetPosting(itup);
-			uint32		newN = ginVacuumPostingList(gvs, GinGetPosting(itup), GinGetNPosting(itup), &cleaned);
+			uint32		nitems;
+			ItemPointerData *items = ginReadTuple(itup, &nitems);
+			ItemPointerData *cleaned = items;
+			uint32		newN = ginVacuumPostingList(gvs, items, nitems, &cleaned);
 
-			if (GinGetNPosting(itup) != newN)
+			if (nitems != newN)
 			{
 				Datum		value;
 				OffsetNumber attnum;
 
 				/*
 				 * Some ItemPointers was deleted, so we should remake our
-				 * tuple
+				 * tuple.  Removing items never makes the compressed list
+				 * longer, so the new tuple fits in place of the old one.
 				 */
 
 				if (tmppage == origpage)
@@ -549,15 +555,6 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 					 */
 					tmppage = PageGetTempPageCopy(origpage);
 
-					if (newN > 0)
-					{
-						Size		pos = ((char *) GinGetPosting(itup)) - ((char *) origpage);
-
-						memcpy(tmppage + pos, cleaned, sizeof(ItemPointerData) * newN);
-					}
-
-					pfree(cleaned);
-
 					/* set itup pointer to new page */
 					itup = (IndexTuple) PageGetItem(tmppage, PageGetItemId(tmppage, i));
 				}
@@ -565,7 +562,7 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 				value = gin_index_getattr(&gvs->ginstate, itup);
 				attnum = gintuple_get_attrnum(&gvs->ginstate, itup);
 				itup = GinFormTuple(gvs->index, &gvs->ginstate, attnum, value,
-									GinGetPosting(itup), newN, true);
+									cleaned, newN, true);
 				PageIndexTupleDelete(tmppage, i);
 
 				if (PageAddItem(tmppage, (Item) itup, IndexTupleSize(itup), i, false, false) != i)
@@ -574,6 +571,8 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 
 				pfree(itup);
 			}
+
+			pfree(items);
 		}
 	}
 
@@ -111,8 +111,7 @@ ginRedoCreatePTree(XLogRecPtr lsn, XLogRecord *record)
 	page = (Page) BufferGetPage(buffer);
 
 	GinInitBuffer(buffer, GIN_DATA | GIN_LEAF);
-	memcpy(GinDataPageGetData(page), items, sizeof(ItemPointerData) * data->nitem);
-	GinPageGetOpaque(page)->maxoff = data->nitem;
+	GinDataLeafPageSetItems(page, items, data->nitem);
 
 	PageSetLSN(page, lsn);
 	PageSetTLI(page, ThisTimeLineID);
@@ -145,14 +144,24 @@ ginRedoInsert(XLogRecPtr lsn, XLogRecord *record)
 		{
 			if (data->isLeaf)
 			{
-				OffsetNumber i;
 				ItemPointerData *items = (ItemPointerData *) (XLogRecGetData(record) + sizeof(ginxlogInsert));
+				ItemPointerData *oldItems;
+				ItemPointerData *newItems;
+				uint32		noldItems = GinPageGetOpaque(page)->maxoff;
+				uint32		nnewItems;
 
 				Assert(GinPageIsLeaf(page));
 				Assert(data->updateBlkno == InvalidBlockNumber);
 
-				for (i = 0; i < data->nitem; i++)
-					GinDataPageAddItem(page, items + i, data->offset + i);
+				/* merge the items into the page, as dataPlaceToPage did */
+				oldItems = (ItemPointerData *) palloc(sizeof(ItemPointerData) * (noldItems + 1));
+				GinDataLeafPageGetItems(page, oldItems);
+				newItems = (ItemPointerData *) palloc(sizeof(ItemPointerData) * (noldItems + data->nitem));
+				nnewItems = MergeItemPointers(newItems, oldItems, noldItems,
+											  items, data->nitem);
+				GinDataLeafPageSetItems(page, newItems, nnewItems);
+				pfree(oldItems);
+				pfree(newItems);
 			}
 			else
 			{
@@ -257,7 +266,32 @@ ginRedoSplit(XLogRecPtr lsn, XLogRecord *record)
 	GinPageGetOpaque(lpage)->rightlink = BufferGetBlockNumber(rbuffer);
 	GinPageGetOpaque(rpage)->rightlink = data->rrlink;
 
-	if (data->isData)
+	if (data->isData && data->isLeaf)
+	{
+		char	   *ptr = XLogRecGetData(record) + sizeof(ginxlogSplit);
+		ItemPointerData *items;
+		ItemPointer bound;
+
+		/* the compressed lists of the left and the right page follow */
+		items = (ItemPointerData *) palloc(sizeof(ItemPointerData) * data->nitem);
+		ptr = ginDecompressPostingList(ptr, data->separator, items);
+		ginDecompressPostingList(ptr, data->nitem - data->separator,
+								 items + data->separator);
+
+		GinDataLeafPageSetItems(lpage, items, data->separator);
+		GinDataLeafPageSetItems(rpage, items + data->separator,
+								data->nitem - data->separator);
+
+		/* set up right key */
+		bound = GinDataPageGetRightBound(lpage);
+		*bound = items[data->separator - 1];
+
+		bound = GinDataPageGetRightBound(rpage);
+		*bound = data->rightbound;
+
+		pfree(items);
+	}
+	else if (data->isData)
 	{
 		char	   *ptr = XLogRecGetData(record) + sizeof(ginxlogSplit);
 		Size		sizeofitem = GinSizeOfItem(lpage);
@@ -278,10 +312,7 @@ ginRedoSplit(XLogRecPtr lsn, XLogRecord *record)
 
 		/* set up right key */
 		bound = GinDataPageGetRightBound(lpage);
-		if (data->isLeaf)
-			*bound = *(ItemPointerData *) GinDataPageGetItem(lpage, GinPageGetOpaque(lpage)->maxoff);
-		else
-			*bound = ((PostingItem *) GinDataPageGetItem(lpage, GinPageGetOpaque(lpage)->maxoff))->key;
+		*bound = ((PostingItem *) GinDataPageGetItem(lpage, GinPageGetOpaque(lpage)->maxoff))->key;
 
 		bound = GinDataPageGetRightBound(rpage);
 		*bound = data->rightbound;
@@ -365,7 +396,18 @@ ginRedoVacuumPage(XLogRecPtr lsn, XLogRecord *record)
 	Assert(BufferIsValid(buffer));
 	page = (Page) BufferGetPage(buffer);
 
-	if (GinPageIsData(page))
+	if (GinPageIsData(page) && GinPageIsLeaf(page))
+	{
+		/* the record carries the compressed posting list */
+		Size		len = record->xl_len - sizeof(ginxlogVacuumPage);
+
+		memcpy(GinDataPageGetData(page), XLogRecGetData(record) + sizeof(ginxlogVacuumPage),
+			   len);
+		GinPageGetOpaque(page)->maxoff = data->nitem;
+		((PageHeader) page)->pd_lower =
+			(GinDataPageGetData(page) - (char *) page) + len;
+	}
+	else if (GinPageIsData(page))
 	{
 		memcpy(GinDataPageGetData(page), XLogRecGetData(record) + sizeof(ginxlogVacuumPage),
 			   GinSizeOfItem(page) *data->nitem);
@@ -770,8 +812,10 @@ ginContinueSplit(ginIncompleteSplit *split)
 
 		PostingItemSetBlockNumber(&(btree.pitem), split->leftBlkno);
 		if (GinPageIsLeaf(page))
-			btree.pitem.key = *(ItemPointerData *) GinDataPageGetItem(page,
-											 GinPageGetOpaque(page)->maxoff);
+		{
+			/* the last item on the page, which is also its right bound */
+			btree.pitem.key = *GinDataPageGetRightBound(page);
+		}
 		else
 			btree.pitem.key = ((PostingItem *) GinDataPageGetItem(page,
 									   GinPageGetOpaque(page)->maxoff))->key;
@@ -26,6 +26,8 @@ static bool gist_box_leaf_consistent(BOX *key, BOX *query,
 static double size_box(Datum dbox);
 static bool rtree_internal_consistent(BOX *key, BOX *query,
 						  StrategyNumber strategy);
+static uint32 float_to_ordered_uint32(float4 f);
+static uint64 spread_bits32(uint32 x);
 
 
 /**************************************************
@@ -555,6 +557,77 @@ gist_box_same(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(result);
 }
 
+/*
+ * Sort key method
+ *
+ * Returns the Z-order (Morton code) of the center of the box, so that a
+ * sorted build packs nearby objects onto the same leaf pages.  This is used
+ * for boxes, polygons, circles and points, whose keys are all boxes.
+ */
+Datum
+gist_box_sortkey(PG_FUNCTION_ARGS)
+{
+	GISTENTRY  *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+	int64	   *result = (int64 *) PG_GETARG_POINTER(1);
+	BOX		   *key = DatumGetBoxP(entry->key);
+	uint32		x;
+	uint32		y;
+	uint64		z;
+
+	/*
+	 * Single precision is plenty for ordering, and lets both coordinates fit
+	 * in the 64-bit key.
+	 */
+	x = float_to_ordered_uint32((float4) ((key->low.x + key->high.x) / 2.0));
+	y = float_to_ordered_uint32((float4) ((key->low.y + key->high.y) / 2.0));
+
+	z = spread_bits32(x) | (spread_bits32(y) << 1);
+
+	/* Flip the top bit, so that signed comparison gives the unsigned order */
+	*result = (int64) (z ^ UINT64CONST(0x8000000000000000));
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Map a float4 to a uint32 whose unsigned order matches the numeric order
+ * of the floats.  NaNs sort after everything else.
+ */
+static uint32
+float_to_ordered_uint32(float4 f)
+{
+	union
+	{
+		float4		f;
+		uint32		i;
+	}			u;
+
+	if (isnan(f))
+		return 0xFFFFFFFF;
+
+	u.f = f;
+	if (u.i & 0x80000000)
+		return ~u.i;			/* negative: reverse the order */
+	else
+		return u.i | 0x80000000;
+}
+
+/*
+ * Spread the bits of x out to the even bit positions of a uint64.
+ */
+static uint64
+spread_bits32(uint32 x)
+{
+	uint64		n = x;
+
+	n = (n | (n << 16)) & UINT64CONST(0x0000FFFF0000FFFF);
+	n = (n | (n << 8)) & UINT64CONST(0x00FF00FF00FF00FF);
+	n = (n | (n << 4)) & UINT64CONST(0x0F0F0F0F0F0F0F0F);
+	n = (n | (n << 2)) & UINT64CONST(0x3333333333333333);
+	n = (n | (n << 1)) & UINT64CONST(0x5555555555555555);
+	return n;
+}
+
 /*
  * Leaf-level consistency for boxes: just apply the query operator
  */
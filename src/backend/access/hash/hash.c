@@ -22,6 +22,7 @@
 #include "access/relscan.h"
 #include "catalog/index.h"
 #include "commands/vacuum.h"
+#include "miscadmin.h"
 #include "optimizer/cost.h"
 #include "optimizer/plancat.h"
 #include "storage/bufmgr.h"
@@ -375,6 +376,8 @@ hashbeginscan(PG_FUNCTION_ARGS)
 	so = (HashScanOpaque) palloc(sizeof(HashScanOpaqueData));
 	so->hashso_bucket_valid = false;
 	so->hashso_bucket_blkno = 0;
+	so->hashso_old_bucket_blkno = 0;
+	so->hashso_in_old_bucket = false;
 	so->hashso_curbuf = InvalidBuffer;
 	/* set position invalid (this will cause _hash_first call) */
 	ItemPointerSetInvalid(&(so->hashso_curpos));
@@ -412,6 +415,12 @@ hashrescan(PG_FUNCTION_ARGS)
 			_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
 		so->hashso_bucket_blkno = 0;
 
+		/* and on the bucket being split into it, if any */
+		if (so->hashso_old_bucket_blkno)
+			_hash_droplock(rel, so->hashso_old_bucket_blkno, HASH_SHARE);
+		so->hashso_old_bucket_blkno = 0;
+		so->hashso_in_old_bucket = false;
+
 		/* set position invalid (this will cause _hash_first call) */
 		ItemPointerSetInvalid(&(so->hashso_curpos));
 		ItemPointerSetInvalid(&(so->hashso_heappos));
@@ -453,6 +462,11 @@ hashendscan(PG_FUNCTION_ARGS)
 		_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
 	so->hashso_bucket_blkno = 0;
 
+	/* and on the bucket being split into it, if any */
+	if (so->hashso_old_bucket_blkno)
+		_hash_droplock(rel, so->hashso_old_bucket_blkno, HASH_SHARE);
+	so->hashso_old_bucket_blkno = 0;
+
 	pfree(so);
 	scan->opaque = NULL;
 
@@ -543,6 +557,48 @@ loop_top:
 		if (_hash_has_active_scan(rel, cur_bucket))
 			elog(ERROR, "hash index has active scan during VACUUM");
 
+		/*
+		 * If the bucket is the old half of a split that was interrupted,
+		 * finish the split first, if we can get the lock on the new half
+		 * without waiting.  (If not, someone is already working on it.)
+		 * We must read the current bucket mapping to find the new bucket,
+		 * since the split may have been started after we read the metapage.
+		 */
+		{
+			Buffer		buf;
+			HashPageOpaque opaque;
+
+			buf = _hash_getbuf_with_strategy(rel, bucket_blkno, HASH_READ,
+											 LH_BUCKET_PAGE, info->strategy);
+			opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+			if (opaque->hasho_flag & LH_BUCKET_BEING_SPLIT)
+			{
+				Bucket		new_bucket;
+				BlockNumber new_bucket_blkno;
+
+				_hash_relbuf(rel, buf);
+
+				metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ,
+									   LH_META_PAGE);
+				metap = HashPageGetMeta(BufferGetPage(metabuf));
+				new_bucket = _hash_get_newbucket(cur_bucket,
+												 metap->hashm_maxbucket);
+				new_bucket_blkno = BUCKET_TO_BLKNO(metap, new_bucket);
+				_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+				if (!_hash_has_active_scan(rel, new_bucket) &&
+					_hash_try_getlock(rel, new_bucket_blkno, HASH_EXCLUSIVE))
+				{
+					_hash_finish_split(rel, metabuf, cur_bucket, new_bucket,
+									   info->strategy);
+					_hash_droplock(rel, new_bucket_blkno, HASH_EXCLUSIVE);
+				}
+				_hash_dropbuf(rel, metabuf);
+			}
+			else
+				_hash_relbuf(rel, buf);
+		}
+
 		/* Scan each page in bucket */
 		blkno = bucket_blkno;
 		while (BlockNumberIsValid(blkno))
@@ -593,8 +649,40 @@ loop_top:
 
 			if (ndeletable > 0)
 			{
+				START_CRIT_SECTION();
+
 				PageIndexMultiDelete(page, deletable, ndeletable);
-				_hash_wrtbuf(rel, buf);
+				MarkBufferDirty(buf);
+
+				if (!rel->rd_istemp)
+				{
+					xl_hash_delete xlrec;
+					XLogRecPtr	recptr;
+					XLogRecData rdata[2];
+
+					xlrec.node = rel->rd_node;
+					xlrec.blkno = BufferGetBlockNumber(buf);
+
+					rdata[0].data = (char *) &xlrec;
+					rdata[0].len = sizeof(xl_hash_delete);
+					rdata[0].buffer = InvalidBuffer;
+					rdata[0].next = &rdata[1];
+
+					rdata[1].data = (char *) deletable;
+					rdata[1].len = ndeletable * sizeof(OffsetNumber);
+					rdata[1].buffer = buf;
+					rdata[1].buffer_std = true;
+					rdata[1].next = NULL;
+
+					recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_DELETE, rdata);
+
+					PageSetLSN(page, recptr);
+					PageSetTLI(page, ThisTimeLineID);
+				}
+
+				END_CRIT_SECTION();
+
+				_hash_relbuf(rel, buf);
 				bucket_dirty = true;
 			}
 			else
@@ -652,7 +740,12 @@ loop_top:
 		num_index_tuples = metap->hashm_ntuples;
 	}
 
-	_hash_wrtbuf(rel, metabuf);
+	START_CRIT_SECTION();
+	MarkBufferDirty(metabuf);
+	_hash_log_metapage(rel, metabuf);
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, metabuf);
 
 	/* return statistics */
 	if (stats == NULL)
@@ -690,14 +783,3 @@ hashvacuumcleanup(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(stats);
 }
 
-
-void
-hash_redo(XLogRecPtr lsn, XLogRecord *record)
-{
-	elog(PANIC, "hash_redo: unimplemented");
-}
-
-void
-hash_desc(StringInfo buf, uint8 xl_info, char *rec)
-{
-}
@@ -16,6 +16,7 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "utils/rel.h"
 
@@ -36,6 +37,7 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 	Page		page;
 	HashPageOpaque pageopaque;
 	Size		itemsz;
+	OffsetNumber itup_off;
 	bool		do_expand;
 	uint32		hashkey;
 	Bucket		bucket;
@@ -141,29 +143,72 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 		Assert(pageopaque->hasho_bucket == bucket);
 	}
 
-	/* found page with enough space, so add the item here */
-	(void) _hash_pgaddtup(rel, buf, itemsz, itup);
-
-	/* write and release the modified page */
-	_hash_wrtbuf(rel, buf);
-
-	/* We can drop the bucket lock now */
-	_hash_droplock(rel, blkno, HASH_SHARE);
-
 	/*
-	 * Write-lock the metapage so we can increment the tuple count. After
-	 * incrementing it, check to see if it's time for a split.
+	 * Found page with enough space.  Write-lock the metapage too, so that
+	 * the tuple count is incremented by the same WAL record that adds the
+	 * item.  (Nobody who holds the metapage lock waits for a lock on a page
+	 * of a bucket we hold share lock on, so this can't deadlock.)
 	 */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
 
+	START_CRIT_SECTION();
+
+	itup_off = _hash_pgaddtup(rel, buf, itemsz, itup);
 	metap->hashm_ntuples += 1;
 
+	MarkBufferDirty(buf);
+	MarkBufferDirty(metabuf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_insert xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+
+		xlrec.node = rel->rd_node;
+		xlrec.blkno = BufferGetBlockNumber(buf);
+		xlrec.offnum = itup_off;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_hash_insert);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		rdata[1].data = (char *) itup;
+		rdata[1].len = IndexTupleDSize(*itup);
+		rdata[1].buffer = buf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &rdata[2];
+
+		/* the metapage contents are in the "hole", so it's not standard */
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = metabuf;
+		rdata[2].buffer_std = false;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_INSERT, rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetTLI(page, ThisTimeLineID);
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+		PageSetTLI(BufferGetPage(metabuf), ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	/* release the modified page */
+	_hash_relbuf(rel, buf);
+
 	/* Make sure this stays in sync with _hash_expandtable() */
 	do_expand = metap->hashm_ntuples >
 		(double) metap->hashm_ffactor * (metap->hashm_maxbucket + 1);
 
-	/* Write out the metapage and drop lock, but keep pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	/* Drop lock on the metapage, but keep pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	/* We can drop the bucket lock now */
+	_hash_droplock(rel, blkno, HASH_SHARE);
 
 	/* Attempt to split if a split is needed */
 	if (do_expand)
@@ -176,9 +221,9 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 /*
  *	_hash_pgaddtup() -- add a tuple to a particular page in the index.
  *
- * This routine adds the tuple to the page as requested; it does not write out
- * the page.  It is an error to call pgaddtup() without pin and write lock on
- * the target buffer.
+ * This routine adds the tuple to the page as requested; it does not mark the
+ * buffer dirty or WAL-log the change.  It is an error to call pgaddtup()
+ * without pin and write lock on the target buffer.
  *
  * Returns the offset number at which the tuple was inserted.  This function
  * is responsible for preserving the condition that tuples in a hash index
@@ -205,3 +250,96 @@ _hash_pgaddtup(Relation rel, Buffer buf, Size itemsize, IndexTuple itup)
 
 	return itup_off;
 }
+
+/*
+ *	_hash_move_tuples() -- move tuples from one page of a bucket to another.
+ *
+ * The ntups tuples in itups[], which are on rbuf at the offsets given in
+ * offsets[] (in ascending order), are added to wbuf and deleted from rbuf,
+ * in one WAL-logged action.  This is used both to move tuples to the new
+ * bucket in a split and to squeeze a bucket.  The caller must hold write
+ * locks on both buffers, and must have made sure the tuples fit on wbuf.
+ * Deleting the tuples renumbers the ones after them on rbuf, and
+ * invalidates any pointers the caller holds into rbuf.
+ */
+void
+_hash_move_tuples(Relation rel, Buffer wbuf, Buffer rbuf,
+				  IndexTuple *itups, OffsetNumber *offsets, uint16 ntups)
+{
+	Page		wpage = BufferGetPage(wbuf);
+	Page		rpage = BufferGetPage(rbuf);
+	char	   *tupdata = NULL;
+	Size		tupsize = 0;
+	uint16		i;
+
+	Assert(ntups > 0);
+
+	/*
+	 * Gather a copy of the tuples for the WAL record now, since they won't
+	 * stay put on rbuf once we start deleting.
+	 */
+	if (!rel->rd_istemp)
+	{
+		for (i = 0; i < ntups; i++)
+			tupsize += MAXALIGN(IndexTupleDSize(*itups[i]));
+		tupdata = palloc0(tupsize);
+		tupsize = 0;
+		for (i = 0; i < ntups; i++)
+		{
+			memcpy(tupdata + tupsize, itups[i], IndexTupleDSize(*itups[i]));
+			tupsize += MAXALIGN(IndexTupleDSize(*itups[i]));
+		}
+	}
+
+	START_CRIT_SECTION();
+
+	for (i = 0; i < ntups; i++)
+		(void) _hash_pgaddtup(rel, wbuf,
+							  MAXALIGN(IndexTupleDSize(*itups[i])),
+							  itups[i]);
+	PageIndexMultiDelete(rpage, offsets, ntups);
+
+	MarkBufferDirty(wbuf);
+	MarkBufferDirty(rbuf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_move_tuples xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+
+		xlrec.node = rel->rd_node;
+		xlrec.wblkno = BufferGetBlockNumber(wbuf);
+		xlrec.rblkno = BufferGetBlockNumber(rbuf);
+		xlrec.ntups = ntups;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = MAXALIGN(sizeof(xl_hash_move_tuples));
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		rdata[1].data = tupdata;
+		rdata[1].len = tupsize;
+		rdata[1].buffer = wbuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &rdata[2];
+
+		rdata[2].data = (char *) offsets;
+		rdata[2].len = ntups * sizeof(OffsetNumber);
+		rdata[2].buffer = rbuf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_MOVE_TUPLES, rdata);
+
+		PageSetLSN(wpage, recptr);
+		PageSetTLI(wpage, ThisTimeLineID);
+		PageSetLSN(rpage, recptr);
+		PageSetTLI(rpage, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	if (tupdata)
+		pfree(tupdata);
+}
@@ -18,6 +18,7 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "utils/rel.h"
 
@@ -140,6 +141,9 @@ _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf)
 	/* now that we have correct backlink, initialize new overflow page */
 	ovflpage = BufferGetPage(ovflbuf);
 	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+
+	START_CRIT_SECTION();
+
 	ovflopaque->hasho_prevblkno = BufferGetBlockNumber(buf);
 	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
 	ovflopaque->hasho_bucket = pageopaque->hasho_bucket;
@@ -150,7 +154,43 @@ _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf)
 
 	/* logically chain overflow page to previous page */
 	pageopaque->hasho_nextblkno = BufferGetBlockNumber(ovflbuf);
-	_hash_wrtbuf(rel, buf);
+
+	MarkBufferDirty(buf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_add_ovfl_page xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+
+		xlrec.node = rel->rd_node;
+		xlrec.ovflblkno = BufferGetBlockNumber(ovflbuf);
+		xlrec.prevblkno = BufferGetBlockNumber(buf);
+		xlrec.bucket = pageopaque->hasho_bucket;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_hash_add_ovfl_page);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		/* the overflow page is rebuilt from scratch, so only log buf */
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = buf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_ADD_OVFL_PAGE, rdata);
+
+		PageSetLSN(ovflpage, recptr);
+		PageSetTLI(ovflpage, ThisTimeLineID);
+		PageSetLSN(page, recptr);
+		PageSetTLI(page, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, buf);
 
 	return ovflbuf;
 }
@@ -282,6 +322,8 @@ _hash_getovflpage(Relation rel, Buffer metabuf)
 	 */
 	newbuf = _hash_getnewbuf(rel, blkno);
 
+	START_CRIT_SECTION();
+
 	metap->hashm_spares[splitnum]++;
 
 	/*
@@ -291,8 +333,13 @@ _hash_getovflpage(Relation rel, Buffer metabuf)
 	if (metap->hashm_firstfree == orig_firstfree)
 		metap->hashm_firstfree = bit + 1;
 
-	/* Write updated metapage and release lock, but not pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	MarkBufferDirty(metabuf);
+	_hash_log_metapage(rel, metabuf);
+
+	END_CRIT_SECTION();
+
+	/* Release metapage lock, but not pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
 
 	return newbuf;
 
@@ -301,8 +348,42 @@ found:
 	bit += _hash_firstfreebit(freep[j]);
 
 	/* mark page "in use" in the bitmap */
+	START_CRIT_SECTION();
+
 	SETBIT(freep, bit);
-	_hash_wrtbuf(rel, mapbuf);
+	MarkBufferDirty(mapbuf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_alloc_bitmap_bit xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+
+		xlrec.node = rel->rd_node;
+		xlrec.blkno = BufferGetBlockNumber(mapbuf);
+		xlrec.bitno = bit;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_hash_alloc_bitmap_bit);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		/* the bitmap is in the "hole", so the page is not standard */
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = mapbuf;
+		rdata[1].buffer_std = false;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_ALLOC_BITMAP_BIT, rdata);
+
+		PageSetLSN(BufferGetPage(mapbuf), recptr);
+		PageSetTLI(BufferGetPage(mapbuf), ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, mapbuf);
 
 	/* Reacquire exclusive lock on the meta page */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
@@ -319,17 +400,19 @@ found:
 	 */
 	if (metap->hashm_firstfree == orig_firstfree)
 	{
+		START_CRIT_SECTION();
+
 		metap->hashm_firstfree = bit + 1;
 
-		/* Write updated metapage and release lock, but not pin */
-		_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
-	}
-	else
-	{
-		/* We didn't change the metapage, so no need to write */
-		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+		MarkBufferDirty(metabuf);
+		_hash_log_metapage(rel, metabuf);
+
+		END_CRIT_SECTION();
 	}
 
+	/* Release metapage lock, but not pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
 	/* Fetch, init, and return the recycled page */
 	return _hash_getinitbuf(rel, blkno);
 }
@@ -381,6 +464,8 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 	HashMetaPage metap;
 	Buffer		metabuf;
 	Buffer		mapbuf;
+	Buffer		prevbuf = InvalidBuffer;
+	Buffer		nextbuf = InvalidBuffer;
 	BlockNumber ovflblkno;
 	BlockNumber prevblkno;
 	BlockNumber blkno;
@@ -403,49 +488,6 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 	prevblkno = ovflopaque->hasho_prevblkno;
 	bucket = ovflopaque->hasho_bucket;
 
-	/*
-	 * Zero the page for debugging's sake; then write and release it. (Note:
-	 * if we failed to zero the page here, we'd have problems with the Assert
-	 * in _hash_pageinit() when the page is reused.)
-	 */
-	MemSet(ovflpage, 0, BufferGetPageSize(ovflbuf));
-	_hash_wrtbuf(rel, ovflbuf);
-
-	/*
-	 * Fix up the bucket chain.  this is a doubly-linked list, so we must fix
-	 * up the bucket chain members behind and ahead of the overflow page being
-	 * deleted.  No concurrency issues since we hold exclusive lock on the
-	 * entire bucket.
-	 */
-	if (BlockNumberIsValid(prevblkno))
-	{
-		Buffer		prevbuf = _hash_getbuf_with_strategy(rel,
-														 prevblkno,
-														 HASH_WRITE,
-										   LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
-														 bstrategy);
-		Page		prevpage = BufferGetPage(prevbuf);
-		HashPageOpaque prevopaque = (HashPageOpaque) PageGetSpecialPointer(prevpage);
-
-		Assert(prevopaque->hasho_bucket == bucket);
-		prevopaque->hasho_nextblkno = nextblkno;
-		_hash_wrtbuf(rel, prevbuf);
-	}
-	if (BlockNumberIsValid(nextblkno))
-	{
-		Buffer		nextbuf = _hash_getbuf_with_strategy(rel,
-														 nextblkno,
-														 HASH_WRITE,
-														 LH_OVERFLOW_PAGE,
-														 bstrategy);
-		Page		nextpage = BufferGetPage(nextbuf);
-		HashPageOpaque nextopaque = (HashPageOpaque) PageGetSpecialPointer(nextpage);
-
-		Assert(nextopaque->hasho_bucket == bucket);
-		nextopaque->hasho_prevblkno = prevblkno;
-		_hash_wrtbuf(rel, nextbuf);
-	}
-
 	/* Note: bstrategy is intentionally not used for metapage and bitmap */
 
 	/* Read the metapage so we can determine which bitmap page to use */
@@ -462,16 +504,143 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 		elog(ERROR, "invalid overflow bit number %u", ovflbitno);
 	blkno = metap->hashm_mapp[bitmappage];
 
-	/* Release metapage lock while we access the bitmap page */
+	/* Release metapage lock while we access the other pages */
 	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
 
-	/* Clear the bitmap bit to indicate that this overflow page is free */
+	/*
+	 * Lock the bucket chain members behind and ahead of the overflow page
+	 * being deleted, and the bitmap page, so that fixing up the chain and
+	 * freeing the page can be WAL-logged as one action.  No concurrency
+	 * issues with the bucket pages since we hold exclusive lock on the
+	 * entire bucket.
+	 */
+	if (BlockNumberIsValid(prevblkno))
+		prevbuf = _hash_getbuf_with_strategy(rel,
+											 prevblkno,
+											 HASH_WRITE,
+										   LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
+											 bstrategy);
+	if (BlockNumberIsValid(nextblkno))
+		nextbuf = _hash_getbuf_with_strategy(rel,
+											 nextblkno,
+											 HASH_WRITE,
+											 LH_OVERFLOW_PAGE,
+											 bstrategy);
 	mapbuf = _hash_getbuf(rel, blkno, HASH_WRITE, LH_BITMAP_PAGE);
 	mappage = BufferGetPage(mapbuf);
 	freep = HashPageGetBitmap(mappage);
 	Assert(ISSET(freep, bitmapbit));
+
+	START_CRIT_SECTION();
+
+	/*
+	 * Reinitialize the doomed page as an empty, unused page.  (It's
+	 * reinitialized once more by _hash_getinitbuf when it's reused.)
+	 */
+	MemSet(ovflpage, 0, BufferGetPageSize(ovflbuf));
+	_hash_pageinit(ovflpage, BufferGetPageSize(ovflbuf));
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+	ovflopaque->hasho_prevblkno = InvalidBlockNumber;
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = -1;
+	ovflopaque->hasho_flag = LH_UNUSED_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
+	MarkBufferDirty(ovflbuf);
+
+	if (BufferIsValid(prevbuf))
+	{
+		Page		prevpage = BufferGetPage(prevbuf);
+		HashPageOpaque prevopaque = (HashPageOpaque) PageGetSpecialPointer(prevpage);
+
+		Assert(prevopaque->hasho_bucket == bucket);
+		prevopaque->hasho_nextblkno = nextblkno;
+		MarkBufferDirty(prevbuf);
+	}
+	if (BufferIsValid(nextbuf))
+	{
+		Page		nextpage = BufferGetPage(nextbuf);
+		HashPageOpaque nextopaque = (HashPageOpaque) PageGetSpecialPointer(nextpage);
+
+		Assert(nextopaque->hasho_bucket == bucket);
+		nextopaque->hasho_prevblkno = prevblkno;
+		MarkBufferDirty(nextbuf);
+	}
+
+	/* Clear the bitmap bit to indicate that this overflow page is free */
 	CLRBIT(freep, bitmapbit);
-	_hash_wrtbuf(rel, mapbuf);
+	MarkBufferDirty(mapbuf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_free_ovfl_page xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[4];
+		int			n = 0;
+
+		xlrec.node = rel->rd_node;
+		xlrec.ovflblkno = ovflblkno;
+		xlrec.prevblkno = prevblkno;
+		xlrec.nextblkno = nextblkno;
+		xlrec.mapblkno = blkno;
+		xlrec.bitno = bitmapbit;
+
+		rdata[n].data = (char *) &xlrec;
+		rdata[n].len = sizeof(xl_hash_free_ovfl_page);
+		rdata[n].buffer = InvalidBuffer;
+
+		/* the freed page is rebuilt from scratch; log the others */
+		if (BufferIsValid(prevbuf))
+		{
+			rdata[n].next = &rdata[n + 1];
+			n++;
+			rdata[n].data = NULL;
+			rdata[n].len = 0;
+			rdata[n].buffer = prevbuf;
+			rdata[n].buffer_std = true;
+		}
+		if (BufferIsValid(nextbuf))
+		{
+			rdata[n].next = &rdata[n + 1];
+			n++;
+			rdata[n].data = NULL;
+			rdata[n].len = 0;
+			rdata[n].buffer = nextbuf;
+			rdata[n].buffer_std = true;
+		}
+		rdata[n].next = &rdata[n + 1];
+		n++;
+		rdata[n].data = NULL;
+		rdata[n].len = 0;
+		rdata[n].buffer = mapbuf;
+		rdata[n].buffer_std = false;
+		rdata[n].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_FREE_OVFL_PAGE, rdata);
+
+		PageSetLSN(ovflpage, recptr);
+		PageSetTLI(ovflpage, ThisTimeLineID);
+		if (BufferIsValid(prevbuf))
+		{
+			PageSetLSN(BufferGetPage(prevbuf), recptr);
+			PageSetTLI(BufferGetPage(prevbuf), ThisTimeLineID);
+		}
+		if (BufferIsValid(nextbuf))
+		{
+			PageSetLSN(BufferGetPage(nextbuf), recptr);
+			PageSetTLI(BufferGetPage(nextbuf), ThisTimeLineID);
+		}
+		PageSetLSN(mappage, recptr);
+		PageSetTLI(mappage, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, ovflbuf);
+	if (BufferIsValid(prevbuf))
+		_hash_relbuf(rel, prevbuf);
+	if (BufferIsValid(nextbuf))
+		_hash_relbuf(rel, nextbuf);
+	_hash_relbuf(rel, mapbuf);
 
 	/* Get write-lock on metapage to update firstfree */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
@@ -479,15 +648,18 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 	/* if this is now the first free page, update hashm_firstfree */
 	if (ovflbitno < metap->hashm_firstfree)
 	{
+		START_CRIT_SECTION();
+
 		metap->hashm_firstfree = ovflbitno;
-		_hash_wrtbuf(rel, metabuf);
-	}
-	else
-	{
-		/* no need to change metapage */
-		_hash_relbuf(rel, metabuf);
+
+		MarkBufferDirty(metabuf);
+		_hash_log_metapage(rel, metabuf);
+
+		END_CRIT_SECTION();
 	}
 
+	_hash_relbuf(rel, metabuf);
+
 	return nextblkno;
 }
 
@@ -496,7 +668,8 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
  *	_hash_initbitmap()
  *
  *	 Initialize a new bitmap page.	The metapage has a write-lock upon
- *	 entering the function, and must be written by caller after return.
+ *	 entering the function, and must be written and WAL-logged by caller
+ *	 after return.
  *
  * 'blkno' is the block number of the new bitmap page.
  *
@@ -535,8 +708,35 @@ _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno)
 	freep = HashPageGetBitmap(pg);
 	MemSet(freep, 0xFF, BMPGSZ_BYTE(metap));
 
-	/* write out the new bitmap page (releasing write lock and pin) */
-	_hash_wrtbuf(rel, buf);
+	START_CRIT_SECTION();
+
+	MarkBufferDirty(buf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_init_bitmap xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[1];
+
+		xlrec.node = rel->rd_node;
+		xlrec.blkno = blkno;
+		xlrec.bmsize = BMPGSZ_BYTE(metap);
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_hash_init_bitmap);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_INIT_BITMAP_PAGE, rdata);
+
+		PageSetLSN(pg, recptr);
+		PageSetTLI(pg, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	/* release the new bitmap page */
+	_hash_relbuf(rel, buf);
 
 	/* add the new bitmap page to the metapage's list of bitmaps */
 	/* metapage already has a write lock */
@@ -590,7 +790,6 @@ _hash_squeezebucket(Relation rel,
 	Page		rpage;
 	HashPageOpaque wopaque;
 	HashPageOpaque ropaque;
-	bool		wbuf_dirty;
 
 	/*
 	 * start squeezing into the base bucket page.
@@ -639,15 +838,19 @@ _hash_squeezebucket(Relation rel,
 	/*
 	 * squeeze the tuples.
 	 */
-	wbuf_dirty = false;
 	for (;;)
 	{
 		OffsetNumber roffnum;
 		OffsetNumber maxroffnum;
-		OffsetNumber deletable[MaxOffsetNumber];
-		int			ndeletable = 0;
+		OffsetNumber deletable[MaxIndexTuplesPerPage];
+		IndexTuple	itups[MaxIndexTuplesPerPage];
+		uint16		nitups = 0;
+		Size		wfreespace = PageGetExactFreeSpace(wpage);
 
-		/* Scan each tuple in "read" page */
+		/*
+		 * Scan each tuple in "read" page.  The tuples that fit on the current
+		 * "write" page are collected and moved there together.
+		 */
 		maxroffnum = PageGetMaxOffsetNumber(rpage);
 		for (roffnum = FirstOffsetNumber;
 			 roffnum <= maxroffnum;
@@ -665,29 +868,34 @@ _hash_squeezebucket(Relation rel,
 			 * Walk up the bucket chain, looking for a page big enough for
 			 * this item.  Exit if we reach the read page.
 			 */
-			while (PageGetFreeSpace(wpage) < itemsz)
+			while (wfreespace < itemsz + sizeof(ItemIdData))
 			{
+				if (nitups > 0)
+				{
+					/*
+					 * Move the tuples collected for this "write" page.  That
+					 * renumbers the tuples after them on the "read" page,
+					 * including the current one.
+					 */
+					_hash_move_tuples(rel, wbuf, rbuf, itups, deletable, nitups);
+					roffnum -= nitups;
+					maxroffnum -= nitups;
+					nitups = 0;
+					itup = (IndexTuple) PageGetItem(rpage,
+												PageGetItemId(rpage, roffnum));
+				}
+
 				Assert(!PageIsEmpty(wpage));
 
 				wblkno = wopaque->hasho_nextblkno;
 				Assert(BlockNumberIsValid(wblkno));
 
-				if (wbuf_dirty)
-					_hash_wrtbuf(rel, wbuf);
-				else
-					_hash_relbuf(rel, wbuf);
+				_hash_relbuf(rel, wbuf);
 
 				/* nothing more to do if we reached the read page */
 				if (rblkno == wblkno)
 				{
-					if (ndeletable > 0)
-					{
-						/* Delete tuples we already moved off read page */
-						PageIndexMultiDelete(rpage, deletable, ndeletable);
-						_hash_wrtbuf(rel, rbuf);
-					}
-					else
-						_hash_relbuf(rel, rbuf);
+					_hash_relbuf(rel, rbuf);
 					return;
 				}
 
@@ -699,27 +907,24 @@ _hash_squeezebucket(Relation rel,
 				wpage = BufferGetPage(wbuf);
 				wopaque = (HashPageOpaque) PageGetSpecialPointer(wpage);
 				Assert(wopaque->hasho_bucket == bucket);
-				wbuf_dirty = false;
+				wfreespace = PageGetExactFreeSpace(wpage);
 			}
 
-			/*
-			 * we have found room so insert on the "write" page, being careful
-			 * to preserve hashkey ordering.  (If we insert many tuples into
-			 * the same "write" page it would be worth qsort'ing instead of
-			 * doing repeated _hash_pgaddtup.)
-			 */
-			(void) _hash_pgaddtup(rel, wbuf, itemsz, itup);
-			wbuf_dirty = true;
-
-			/* remember tuple for deletion from "read" page */
-			deletable[ndeletable++] = roffnum;
+			/* we have found room, so remember the tuple for moving */
+			itups[nitups] = itup;
+			deletable[nitups] = roffnum;
+			nitups++;
+			wfreespace -= itemsz + sizeof(ItemIdData);
 		}
 
+		/* move the rest of the tuples, emptying the "read" page */
+		if (nitups > 0)
+			_hash_move_tuples(rel, wbuf, rbuf, itups, deletable, nitups);
+
 		/*
 		 * If we reach here, there are no live tuples on the "read" page ---
 		 * it was empty when we got to it, or we moved them all.  So we can
-		 * just free the page without bothering with deleting tuples
-		 * individually.  Then advance to the previous "read" page.
+		 * free the page.  Then advance to the previous "read" page.
 		 *
 		 * Tricky point here: if our read and write pages are adjacent in the
 		 * bucket chain, our write lock on wbuf will conflict with
@@ -734,10 +939,7 @@ _hash_squeezebucket(Relation rel,
 		if (rblkno == wblkno)
 		{
 			/* yes, so release wbuf lock first */
-			if (wbuf_dirty)
-				_hash_wrtbuf(rel, wbuf);
-			else
-				_hash_relbuf(rel, wbuf);
+			_hash_relbuf(rel, wbuf);
 			/* free this overflow page (releases rbuf) */
 			_hash_freeovflpage(rel, rbuf, bstrategy);
 			/* done */
@@ -44,7 +44,8 @@ static void _hash_splitbucket(Relation rel, Buffer metabuf,
 				  BlockNumber start_oblkno,
 				  BlockNumber start_nblkno,
 				  uint32 maxbucket,
-				  uint32 highmask, uint32 lowmask);
+				  uint32 highmask, uint32 lowmask,
+				  BufferAccessStrategy bstrategy);
 
 
 /*
@@ -265,25 +266,6 @@ _hash_dropbuf(Relation rel, Buffer buf)
 	ReleaseBuffer(buf);
 }
 
-/*
- *	_hash_wrtbuf() -- write a hash page to disk.
- *
- *		This routine releases the lock held on the buffer and our refcount
- *		for it.  It is an error to call _hash_wrtbuf() without a write lock
- *		and a pin on the buffer.
- *
- * NOTE: this routine should go away when/if hash indexes are WAL-ified.
- * The correct sequence of operations is to mark the buffer dirty, then
- * write the WAL record, then release the lock and pin; so marking dirty
- * can't be combined with releasing.
- */
-void
-_hash_wrtbuf(Relation rel, Buffer buf)
-{
-	MarkBufferDirty(buf);
-	UnlockReleaseBuffer(buf);
-}
-
 /*
  * _hash_chgbufaccess() -- Change the lock type on a buffer, without
  *			dropping our pin on it.
@@ -459,7 +441,8 @@ _hash_metapinit(Relation rel, double num_tuples)
 		pageopaque->hasho_bucket = i;
 		pageopaque->hasho_flag = LH_BUCKET_PAGE;
 		pageopaque->hasho_page_id = HASHO_PAGE_ID;
-		_hash_wrtbuf(rel, buf);
+		MarkBufferDirty(buf);
+		_hash_relbuf(rel, buf);
 	}
 
 	/* Now reacquire buffer lock on metapage */
@@ -470,12 +453,76 @@ _hash_metapinit(Relation rel, double num_tuples)
 	 */
 	_hash_initbitmap(rel, metap, num_buckets + 1);
 
+	/*
+	 * WAL-log the metapage.  Its record also covers the bucket pages, which
+	 * we didn't log as we went.
+	 */
+	START_CRIT_SECTION();
+
+	MarkBufferDirty(metabuf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_metapage xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[1];
+
+		xlrec.node = rel->rd_node;
+		xlrec.num_buckets = num_buckets;
+		memcpy(&xlrec.meta, metap, sizeof(HashMetaPageData));
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_hash_metapage);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_INIT_META_PAGE, rdata);
+
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+		PageSetTLI(BufferGetPage(metabuf), ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
 	/* all done */
-	_hash_wrtbuf(rel, metabuf);
+	_hash_relbuf(rel, metabuf);
 
 	return num_buckets;
 }
 
+/*
+ *	_hash_log_metapage() -- WAL-log the current contents of the metapage.
+ *
+ * The caller must hold write lock on metabuf, and must have marked it dirty
+ * within the critical section it changed the metapage in.  The record
+ * carries the whole metapage, which is small, rather than the change.
+ */
+void
+_hash_log_metapage(Relation rel, Buffer metabuf)
+{
+	Page		page = BufferGetPage(metabuf);
+	xl_hash_metapage xlrec;
+	XLogRecPtr	recptr;
+	XLogRecData rdata[1];
+
+	if (rel->rd_istemp)
+		return;
+
+	xlrec.node = rel->rd_node;
+	xlrec.num_buckets = 0;
+	memcpy(&xlrec.meta, HashPageGetMeta(page), sizeof(HashMetaPageData));
+
+	rdata[0].data = (char *) &xlrec;
+	rdata[0].len = sizeof(xl_hash_metapage);
+	rdata[0].buffer = InvalidBuffer;
+	rdata[0].next = NULL;
+
+	recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_UPDATE_META_PAGE, rdata);
+
+	PageSetLSN(page, recptr);
+	PageSetTLI(page, ThisTimeLineID);
+}
+
 /*
  *	_hash_pageinit() -- Initialize a new hash index page.
  */
@@ -491,6 +538,10 @@ _hash_pageinit(Page page, Size size)
  *
  * This will silently do nothing if it cannot get the needed locks.
  *
+ * If the bucket that's next in line to be split is still involved in an
+ * interrupted split, we finish that split instead, and leave the new one
+ * to the next insertion that finds the table overfull.
+ *
  * The caller should hold no locks on the hash index.
  *
  * The caller must hold a pin, but no lock, on the metapage buffer.
@@ -505,6 +556,13 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	uint32		spare_ndx;
 	BlockNumber start_oblkno;
 	BlockNumber start_nblkno;
+	BlockNumber lastblkno;
+	Buffer		obuf;
+	Buffer		nbuf;
+	Page		opage;
+	Page		npage;
+	HashPageOpaque oopaque;
+	HashPageOpaque nopaque;
 	uint32		maxbucket;
 	uint32		highmask;
 	uint32		lowmask;
@@ -577,6 +635,48 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	if (!_hash_try_getlock(rel, start_oblkno, HASH_EXCLUSIVE))
 		goto fail;
 
+	/*
+	 * If the old bucket is marked as taking part in a split, that split was
+	 * interrupted (whoever was doing it would still hold the bucket lock
+	 * otherwise).  The bucket's tuples aren't all where the bucket mapping
+	 * says they belong until it's finished, so do that now, in place of the
+	 * split we came for.  We don't need the split lock for it.
+	 */
+	obuf = _hash_getbuf(rel, start_oblkno, HASH_READ, LH_BUCKET_PAGE);
+	opage = BufferGetPage(obuf);
+	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+
+	if (oopaque->hasho_flag & (LH_BUCKET_BEING_SPLIT | LH_BUCKET_BEING_POPULATED))
+	{
+		bool		being_split = (oopaque->hasho_flag & LH_BUCKET_BEING_SPLIT) != 0;
+		Bucket		partner;
+		BlockNumber partner_blkno;
+
+		_hash_relbuf(rel, obuf);
+
+		if (being_split)
+			partner = _hash_get_newbucket(old_bucket, metap->hashm_maxbucket);
+		else
+			partner = _hash_get_oldbucket(old_bucket);
+		partner_blkno = BUCKET_TO_BLKNO(metap, partner);
+
+		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+		_hash_droplock(rel, 0, HASH_EXCLUSIVE);
+
+		if (!_hash_has_active_scan(rel, partner) &&
+			_hash_try_getlock(rel, partner_blkno, HASH_EXCLUSIVE))
+		{
+			if (being_split)
+				_hash_finish_split(rel, metabuf, old_bucket, partner, NULL);
+			else
+				_hash_finish_split(rel, metabuf, partner, old_bucket, NULL);
+			_hash_droplock(rel, partner_blkno, HASH_EXCLUSIVE);
+		}
+
+		_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+		return;
+	}
+
 	/*
 	 * Likewise lock the new bucket (should never fail).
 	 *
@@ -598,6 +698,7 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	 * increases), we need to allocate a new batch of bucket pages.
 	 */
 	spare_ndx = _hash_log2(new_bucket + 1);
+	lastblkno = InvalidBlockNumber;
 	if (spare_ndx > metap->hashm_ovflpoint)
 	{
 		Assert(spare_ndx == metap->hashm_ovflpoint + 1);
@@ -611,12 +712,25 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 		if (!_hash_alloc_buckets(rel, start_nblkno, new_bucket))
 		{
 			/* can't split due to BlockNumber overflow */
+			_hash_relbuf(rel, obuf);
 			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
 			_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
 			goto fail;
 		}
+		lastblkno = start_nblkno + new_bucket - 1;
 	}
 
+	/*
+	 * Get write lock on the old bucket's primary page, and the new bucket's
+	 * primary page, so that we can mark them as being split as part of the
+	 * same action that updates the metapage.
+	 */
+	_hash_chgbufaccess(rel, obuf, HASH_READ, HASH_NOLOCK);
+	_hash_chgbufaccess(rel, obuf, HASH_NOLOCK, HASH_WRITE);
+	nbuf = _hash_getnewbuf(rel, start_nblkno);
+	npage = BufferGetPage(nbuf);
+	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+
 	/*
 	 * Okay to proceed with split.	Update the metapage bucket mapping info.
 	 *
@@ -649,9 +763,61 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 		metap->hashm_ovflpoint = spare_ndx;
 	}
 
+	MarkBufferDirty(metabuf);
+
+	/* mark the old bucket, and initialize the new bucket's primary page */
+	oopaque->hasho_flag |= LH_BUCKET_BEING_SPLIT;
+	MarkBufferDirty(obuf);
+
+	nopaque->hasho_prevblkno = InvalidBlockNumber;
+	nopaque->hasho_nextblkno = InvalidBlockNumber;
+	nopaque->hasho_bucket = new_bucket;
+	nopaque->hasho_flag = LH_BUCKET_PAGE | LH_BUCKET_BEING_POPULATED;
+	nopaque->hasho_page_id = HASHO_PAGE_ID;
+	MarkBufferDirty(nbuf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_split_begin xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+
+		xlrec.node = rel->rd_node;
+		xlrec.old_bucket = old_bucket;
+		xlrec.new_bucket = new_bucket;
+		xlrec.oblkno = start_oblkno;
+		xlrec.nblkno = start_nblkno;
+		xlrec.lastblkno = lastblkno;
+		memcpy(&xlrec.meta, metap, sizeof(HashMetaPageData));
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_hash_split_begin);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		/* the new bucket's page is rebuilt from scratch; log the old one */
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = obuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_SPLIT_BEGIN, rdata);
+
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+		PageSetTLI(BufferGetPage(metabuf), ThisTimeLineID);
+		PageSetLSN(opage, recptr);
+		PageSetTLI(opage, ThisTimeLineID);
+		PageSetLSN(npage, recptr);
+		PageSetTLI(npage, ThisTimeLineID);
+	}
+
 	/* Done mucking with metapage */
 	END_CRIT_SECTION();
 
+	_hash_relbuf(rel, obuf);
+	_hash_relbuf(rel, nbuf);
+
 	/*
 	 * Copy bucket mapping info now; this saves re-accessing the meta page
 	 * inside _hash_splitbucket's inner loop.  Note that once we drop the
@@ -663,8 +829,8 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	highmask = metap->hashm_highmask;
 	lowmask = metap->hashm_lowmask;
 
-	/* Write out the metapage and drop lock, but keep pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	/* Drop lock on the metapage, but keep pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
 
 	/* Release split lock; okay for other splits to occur now */
 	_hash_droplock(rel, 0, HASH_EXCLUSIVE);
@@ -672,7 +838,7 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	/* Relocate records to the new bucket */
 	_hash_splitbucket(rel, metabuf, old_bucket, new_bucket,
 					  start_oblkno, start_nblkno,
-					  maxbucket, highmask, lowmask);
+					  maxbucket, highmask, lowmask, NULL);
 
 	/* Release bucket locks, allowing others to access them */
 	_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
@@ -690,6 +856,39 @@ fail:
 	_hash_droplock(rel, 0, HASH_EXCLUSIVE);
 }
 
+/*
+ * _hash_finish_split -- finish an interrupted split of obucket into nbucket
+ *
+ * The caller must hold exclusive locks on both buckets, and a pin but no
+ * lock on the metapage buffer, which is returned in the same state.  Since
+ * neither bucket can be split again until this is done, the current bucket
+ * mapping sends each of obucket's tuples to one of the two buckets.
+ */
+void
+_hash_finish_split(Relation rel, Buffer metabuf, Bucket obucket,
+				   Bucket nbucket, BufferAccessStrategy bstrategy)
+{
+	HashMetaPage metap;
+	BlockNumber start_oblkno;
+	BlockNumber start_nblkno;
+	uint32		maxbucket;
+	uint32		highmask;
+	uint32		lowmask;
+
+	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_READ);
+	metap = HashPageGetMeta(BufferGetPage(metabuf));
+	start_oblkno = BUCKET_TO_BLKNO(metap, obucket);
+	start_nblkno = BUCKET_TO_BLKNO(metap, nbucket);
+	maxbucket = metap->hashm_maxbucket;
+	highmask = metap->hashm_highmask;
+	lowmask = metap->hashm_lowmask;
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	_hash_splitbucket(rel, metabuf, obucket, nbucket,
+					  start_oblkno, start_nblkno,
+					  maxbucket, highmask, lowmask, bstrategy);
+}
+
 
 /*
  * _hash_alloc_buckets -- allocate a new splitpoint's worth of bucket pages
@@ -747,6 +946,13 @@ _hash_alloc_buckets(Relation rel, BlockNumber firstblock, uint32 nblocks)
  * belong in the new bucket, and compress out any free space in the old
  * bucket.
  *
+ * The primary pages of both buckets must already be marked as being split.
+ * The tuples are moved a page's worth at a time, each move being a single
+ * WAL-logged action, so if we're interrupted, every tuple is still in
+ * exactly one of the buckets, and calling this again finishes the job;
+ * tuples are appended to whatever the new bucket already holds.  When all
+ * the tuples have been moved, the marks are cleared.
+ *
  * The caller must hold exclusive locks on both buckets to ensure that
  * no one else is trying to access them (see README).
  *
@@ -763,7 +969,8 @@ _hash_splitbucket(Relation rel,
 				  BlockNumber start_nblkno,
 				  uint32 maxbucket,
 				  uint32 highmask,
-				  uint32 lowmask)
+				  uint32 lowmask,
+				  BufferAccessStrategy bstrategy)
 {
 	BlockNumber oblkno;
 	BlockNumber nblkno;
@@ -773,28 +980,39 @@ _hash_splitbucket(Relation rel,
 	Page		npage;
 	HashPageOpaque oopaque;
 	HashPageOpaque nopaque;
+	Size		nfreespace;
 
 	/*
 	 * It should be okay to simultaneously write-lock pages from each bucket,
 	 * since no one else can be trying to acquire buffer lock on pages of
 	 * either bucket.
+	 *
+	 * Start adding tuples at the end of the new bucket, which is its primary
+	 * page unless we're finishing an interrupted split.
 	 */
-	oblkno = start_oblkno;
-	obuf = _hash_getbuf(rel, oblkno, HASH_WRITE, LH_BUCKET_PAGE);
-	opage = BufferGetPage(obuf);
-	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
-
 	nblkno = start_nblkno;
-	nbuf = _hash_getnewbuf(rel, nblkno);
+	nbuf = _hash_getbuf_with_strategy(rel, nblkno, HASH_WRITE,
+									  LH_BUCKET_PAGE, bstrategy);
 	npage = BufferGetPage(nbuf);
-
-	/* initialize the new bucket's primary page */
 	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
-	nopaque->hasho_prevblkno = InvalidBlockNumber;
-	nopaque->hasho_nextblkno = InvalidBlockNumber;
-	nopaque->hasho_bucket = nbucket;
-	nopaque->hasho_flag = LH_BUCKET_PAGE;
-	nopaque->hasho_page_id = HASHO_PAGE_ID;
+	Assert(nopaque->hasho_flag & LH_BUCKET_BEING_POPULATED);
+	while (BlockNumberIsValid(nopaque->hasho_nextblkno))
+	{
+		nblkno = nopaque->hasho_nextblkno;
+		_hash_relbuf(rel, nbuf);
+		nbuf = _hash_getbuf_with_strategy(rel, nblkno, HASH_WRITE,
+										  LH_OVERFLOW_PAGE, bstrategy);
+		npage = BufferGetPage(nbuf);
+		nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+	}
+	nfreespace = PageGetExactFreeSpace(npage);
+
+	oblkno = start_oblkno;
+	obuf = _hash_getbuf_with_strategy(rel, oblkno, HASH_WRITE,
+									  LH_BUCKET_PAGE, bstrategy);
+	opage = BufferGetPage(obuf);
+	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+	Assert(oopaque->hasho_flag & LH_BUCKET_BEING_SPLIT);
 
 	/*
 	 * Partition the tuples in the old bucket between the old bucket and the
@@ -806,8 +1024,9 @@ _hash_splitbucket(Relation rel,
 	{
 		OffsetNumber ooffnum;
 		OffsetNumber omaxoffnum;
-		OffsetNumber deletable[MaxOffsetNumber];
-		int			ndeletable = 0;
+		OffsetNumber moved[MaxIndexTuplesPerPage];
+		IndexTuple	itups[MaxIndexTuplesPerPage];
+		uint16		nmoved = 0;
 
 		/* Scan each tuple in old page */
 		omaxoffnum = PageGetMaxOffsetNumber(opage);
@@ -828,80 +1047,136 @@ _hash_splitbucket(Relation rel,
 			bucket = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
 										  maxbucket, highmask, lowmask);
 
-			if (bucket == nbucket)
+			if (bucket != nbucket)
 			{
 				/*
-				 * insert the tuple into the new bucket.  if it doesn't fit on
-				 * the current page in the new bucket, we must allocate a new
-				 * overflow page and place the tuple on that page instead.
+				 * the tuple stays on this page, so nothing to do.
 				 */
-				itemsz = IndexTupleDSize(*itup);
-				itemsz = MAXALIGN(itemsz);
+				Assert(bucket == obucket);
+				continue;
+			}
 
-				if (PageGetFreeSpace(npage) < itemsz)
+			/*
+			 * The tuple goes to the new bucket.  If it doesn't fit on the
+			 * current page in the new bucket along with the tuples already
+			 * collected for it, move those, and allocate a new overflow page
+			 * for this one.  Moving the tuples deletes them from the old
+			 * page, which renumbers the tuples after them, including this
+			 * one.
+			 */
+			itemsz = IndexTupleDSize(*itup);
+			itemsz = MAXALIGN(itemsz);
+
+			if (nfreespace < itemsz + sizeof(ItemIdData))
+			{
+				if (nmoved > 0)
 				{
-					/* write out nbuf and drop lock, but keep pin */
-					_hash_chgbufaccess(rel, nbuf, HASH_WRITE, HASH_NOLOCK);
-					/* chain to a new overflow page */
-					nbuf = _hash_addovflpage(rel, metabuf, nbuf);
-					npage = BufferGetPage(nbuf);
-					/* we don't need nblkno or nopaque within the loop */
+					_hash_move_tuples(rel, nbuf, obuf, itups, moved, nmoved);
+					ooffnum -= nmoved;
+					omaxoffnum -= nmoved;
+					nmoved = 0;
+					itup = (IndexTuple) PageGetItem(opage,
+												PageGetItemId(opage, ooffnum));
 				}
 
-				/*
-				 * Insert tuple on new page, using _hash_pgaddtup to ensure
-				 * correct ordering by hashkey.  This is a tad inefficient
-				 * since we may have to shuffle itempointers repeatedly.
-				 * Possible future improvement: accumulate all the items for
-				 * the new page and qsort them before insertion.
-				 */
-				(void) _hash_pgaddtup(rel, nbuf, itemsz, itup);
-
-				/*
-				 * Mark tuple for deletion from old page.
-				 */
-				deletable[ndeletable++] = ooffnum;
-			}
-			else
-			{
-				/*
-				 * the tuple stays on this page, so nothing to do.
-				 */
-				Assert(bucket == obucket);
+				/* drop lock on nbuf, but keep pin */
+				_hash_chgbufaccess(rel, nbuf, HASH_READ, HASH_NOLOCK);
+				/* chain to a new overflow page */
+				nbuf = _hash_addovflpage(rel, metabuf, nbuf);
+				npage = BufferGetPage(nbuf);
+				nfreespace = PageGetExactFreeSpace(npage);
 			}
+
+			itups[nmoved] = itup;
+			moved[nmoved] = ooffnum;
+			nmoved++;
+			nfreespace -= itemsz + sizeof(ItemIdData);
 		}
 
-		oblkno = oopaque->hasho_nextblkno;
+		/* Done scanning this old page; move the tuples we collected */
+		if (nmoved > 0)
+			_hash_move_tuples(rel, nbuf, obuf, itups, moved, nmoved);
 
-		/*
-		 * Done scanning this old page.  If we moved any tuples, delete them
-		 * from the old page.
-		 */
-		if (ndeletable > 0)
-		{
-			PageIndexMultiDelete(opage, deletable, ndeletable);
-			_hash_wrtbuf(rel, obuf);
-		}
-		else
-			_hash_relbuf(rel, obuf);
+		oblkno = oopaque->hasho_nextblkno;
+		_hash_relbuf(rel, obuf);
 
 		/* Exit loop if no more overflow pages in old bucket */
 		if (!BlockNumberIsValid(oblkno))
 			break;
 
 		/* Else, advance to next old page */
-		obuf = _hash_getbuf(rel, oblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
+		obuf = _hash_getbuf_with_strategy(rel, oblkno, HASH_WRITE,
+										  LH_OVERFLOW_PAGE, bstrategy);
 		opage = BufferGetPage(obuf);
 		oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
 	}
 
+	_hash_relbuf(rel, nbuf);
+
 	/*
 	 * We're at the end of the old bucket chain, so we're done partitioning
-	 * the tuples.	Before quitting, call _hash_squeezebucket to ensure the
-	 * tuples remaining in the old bucket (including the overflow pages) are
-	 * packed as tightly as possible.  The new bucket is already tight.
+	 * the tuples.  Clear the split marks on both buckets' primary pages.
 	 */
-	_hash_wrtbuf(rel, nbuf);
+	obuf = _hash_getbuf_with_strategy(rel, start_oblkno, HASH_WRITE,
+									  LH_BUCKET_PAGE, bstrategy);
+	opage = BufferGetPage(obuf);
+	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+	nbuf = _hash_getbuf_with_strategy(rel, start_nblkno, HASH_WRITE,
+									  LH_BUCKET_PAGE, bstrategy);
+	npage = BufferGetPage(nbuf);
+	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+
+	START_CRIT_SECTION();
 
-	_hash_squeezebucket(rel, obucket, start_oblkno, NULL);
+	oopaque->hasho_flag &= ~LH_BUCKET_BEING_SPLIT;
+	nopaque->hasho_flag &= ~LH_BUCKET_BEING_POPULATED;
+	MarkBufferDirty(obuf);
+	MarkBufferDirty(nbuf);
+
+	if (!rel->rd_istemp)
+	{
+		xl_hash_split_complete xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+
+		xlrec.node = rel->rd_node;
+		xlrec.oblkno = start_oblkno;
+		xlrec.nblkno = start_nblkno;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_hash_split_complete);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = obuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &rdata[2];
+
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = nbuf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_SPLIT_COMPLETE, rdata);
+
+		PageSetLSN(opage, recptr);
+		PageSetTLI(opage, ThisTimeLineID);
+		PageSetLSN(npage, recptr);
+		PageSetTLI(npage, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, obuf);
+	_hash_relbuf(rel, nbuf);
+
+	/*
+	 * Before quitting, call _hash_squeezebucket to ensure the tuples
+	 * remaining in the old bucket (including the overflow pages) are packed
+	 * as tightly as possible.  The new bucket is already tight.
+	 */
+	_hash_squeezebucket(rel, obucket, start_oblkno, bstrategy);
 }
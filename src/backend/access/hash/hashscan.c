@@ -146,6 +146,9 @@ _hash_has_active_scan(Relation rel, Bucket bucket)
 			if (so->hashso_bucket_valid &&
 				so->hashso_bucket == bucket)
 				return true;
+			if (so->hashso_old_bucket_blkno &&
+				so->hashso_old_bucket == bucket)
+				return true;
 		}
 	}
 
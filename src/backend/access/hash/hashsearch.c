@@ -65,11 +65,17 @@ _hash_next(IndexScanDesc scan, ScanDirection dir)
 
 /*
  * Advance to next page in a bucket, if any.
+ *
+ * If the bucket is being populated by a split, the old bucket's chain is
+ * logically appended to it, so when we run off the end of the bucket we
+ * continue with the old bucket's primary page.
  */
 static void
-_hash_readnext(Relation rel,
+_hash_readnext(IndexScanDesc scan,
 			   Buffer *bufp, Page *pagep, HashPageOpaque *opaquep)
 {
+	Relation	rel = scan->indexRelation;
+	HashScanOpaque so = (HashScanOpaque) scan->opaque;
 	BlockNumber blkno;
 
 	blkno = (*opaquep)->hasho_nextblkno;
@@ -83,15 +89,28 @@ _hash_readnext(Relation rel,
 		*pagep = BufferGetPage(*bufp);
 		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
 	}
+	else if (so->hashso_old_bucket_blkno && !so->hashso_in_old_bucket)
+	{
+		*bufp = _hash_getbuf(rel, so->hashso_old_bucket_blkno, HASH_READ,
+							 LH_BUCKET_PAGE);
+		*pagep = BufferGetPage(*bufp);
+		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
+		so->hashso_in_old_bucket = true;
+	}
 }
 
 /*
  * Advance to previous page in a bucket, if any.
+ *
+ * This is the reverse of _hash_readnext: going back from the old bucket's
+ * primary page takes us to the last page of the bucket being populated.
  */
 static void
-_hash_readprev(Relation rel,
+_hash_readprev(IndexScanDesc scan,
 			   Buffer *bufp, Page *pagep, HashPageOpaque *opaquep)
 {
+	Relation	rel = scan->indexRelation;
+	HashScanOpaque so = (HashScanOpaque) scan->opaque;
 	BlockNumber blkno;
 
 	blkno = (*opaquep)->hasho_prevblkno;
@@ -106,6 +125,22 @@ _hash_readprev(Relation rel,
 		*pagep = BufferGetPage(*bufp);
 		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
 	}
+	else if (so->hashso_in_old_bucket)
+	{
+		so->hashso_in_old_bucket = false;
+		*bufp = _hash_getbuf(rel, so->hashso_bucket_blkno, HASH_READ,
+							 LH_BUCKET_PAGE);
+		*pagep = BufferGetPage(*bufp);
+		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
+		while (BlockNumberIsValid((*opaquep)->hasho_nextblkno))
+		{
+			blkno = (*opaquep)->hasho_nextblkno;
+			_hash_relbuf(rel, *bufp);
+			*bufp = _hash_getbuf(rel, blkno, HASH_READ, LH_OVERFLOW_PAGE);
+			*pagep = BufferGetPage(*bufp);
+			*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
+		}
+	}
 }
 
 /*
@@ -126,6 +161,7 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 	uint32		hashkey;
 	Bucket		bucket;
 	BlockNumber blkno;
+	BlockNumber old_blkno;
 	Buffer		buf;
 	Buffer		metabuf;
 	Page		page;
@@ -205,6 +241,15 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 
 	blkno = BUCKET_TO_BLKNO(metap, bucket);
 
+	/*
+	 * Also find the bucket it was split from, in case the split hasn't been
+	 * completed.  The old bucket's address can't change under us either.
+	 */
+	if (bucket > 0)
+		old_blkno = BUCKET_TO_BLKNO(metap, _hash_get_oldbucket(bucket));
+	else
+		old_blkno = InvalidBlockNumber;
+
 	/* done with the metapage */
 	_hash_relbuf(rel, metabuf);
 
@@ -226,11 +271,43 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
 	Assert(opaque->hasho_bucket == bucket);
 
-	/* If a backwards scan is requested, move to the end of the chain */
+	/*
+	 * If the bucket is still being populated by a split, some of the tuples
+	 * we're looking for may not have been moved out of the old bucket yet,
+	 * so we must scan that too.  The flag can't change while we hold the
+	 * bucket lock, since finishing the split needs an exclusive lock.  Don't
+	 * hold the buffer lock while waiting for the old bucket's lock, though.
+	 */
+	if (opaque->hasho_flag & LH_BUCKET_BEING_POPULATED)
+	{
+		Assert(BlockNumberIsValid(old_blkno));
+		_hash_relbuf(rel, buf);
+
+		_hash_getlock(rel, old_blkno, HASH_SHARE);
+		so->hashso_old_bucket = _hash_get_oldbucket(bucket);
+		so->hashso_old_bucket_blkno = old_blkno;
+
+		buf = _hash_getbuf(rel, blkno, HASH_READ, LH_BUCKET_PAGE);
+		page = BufferGetPage(buf);
+		opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	}
+
+	/*
+	 * If a backwards scan is requested, move to the end of the chain, which
+	 * is the end of the old bucket's chain if we're scanning that too.
+	 */
 	if (ScanDirectionIsBackward(dir))
 	{
+		if (so->hashso_old_bucket_blkno)
+		{
+			_hash_relbuf(rel, buf);
+			buf = _hash_getbuf(rel, old_blkno, HASH_READ, LH_BUCKET_PAGE);
+			page = BufferGetPage(buf);
+			opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+			so->hashso_in_old_bucket = true;
+		}
 		while (BlockNumberIsValid(opaque->hasho_nextblkno))
-			_hash_readnext(rel, &buf, &page, &opaque);
+			_hash_readnext(scan, &buf, &page, &opaque);
 	}
 
 	/* Now find the first tuple satisfying the qualification */
@@ -326,7 +403,7 @@ _hash_step(IndexScanDesc scan, Buffer *bufP, ScanDirection dir)
 					/*
 					 * ran off the end of this page, try the next
 					 */
-					_hash_readnext(rel, &buf, &page, &opaque);
+					_hash_readnext(scan, &buf, &page, &opaque);
 					if (BufferIsValid(buf))
 					{
 						maxoff = PageGetMaxOffsetNumber(page);
@@ -367,7 +444,7 @@ _hash_step(IndexScanDesc scan, Buffer *bufP, ScanDirection dir)
 					/*
 					 * ran off the end of this page, try the next
 					 */
-					_hash_readprev(rel, &buf, &page, &opaque);
+					_hash_readprev(scan, &buf, &page, &opaque);
 					if (BufferIsValid(buf))
 					{
 						maxoff = PageGetMaxOffsetNumber(page);
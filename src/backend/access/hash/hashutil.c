@@ -142,6 +142,43 @@ _hash_log2(uint32 num)
 	return i;
 }
 
+/*
+ * _hash_get_oldbucket -- the bucket that new_bucket was split from
+ *
+ * _hash_expandtable always splits the bucket whose number is the new one's
+ * with the most significant bit cleared.
+ */
+Bucket
+_hash_get_oldbucket(Bucket new_bucket)
+{
+	Assert(new_bucket > 0);
+
+	return new_bucket & ~(((Bucket) 1) << (_hash_log2(new_bucket + 1) - 1));
+}
+
+/*
+ * _hash_get_newbucket -- the bucket most recently split from old_bucket
+ *
+ * old_bucket is split again at each doubling of the table, into the bucket
+ * with the next higher bit set, so this is the highest such bucket that
+ * exists, given the current maxbucket.
+ */
+Bucket
+_hash_get_newbucket(Bucket old_bucket, uint32 maxbucket)
+{
+	Bucket		new_bucket = old_bucket;
+	uint32		mask;
+
+	for (mask = ((uint32) 1) << _hash_log2(old_bucket + 1);
+		 mask != 0 && old_bucket + mask <= maxbucket;
+		 mask <<= 1)
+		new_bucket = old_bucket + mask;
+
+	Assert(new_bucket != old_bucket);
+
+	return new_bucket;
+}
+
 /*
  * _hash_checkpage -- sanity checks on the format of all hash pages
  *
@@ -0,0 +1,681 @@
+/*-------------------------------------------------------------------------
+ *
+ * hashxlog.c
+ *	  WAL replay logic for hash indexes
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			 $PostgreSQL$
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/xlogutils.h"
+#include "storage/bufmgr.h"
+
+
+/*
+ * Initialize an empty hash page with the given special space contents.
+ */
+static void
+hashInitPage(Buffer buffer, BlockNumber prevblkno, BlockNumber nextblkno,
+			 Bucket bucket, uint16 flag)
+{
+	Page		page = (Page) BufferGetPage(buffer);
+	HashPageOpaque opaque;
+
+	_hash_pageinit(page, BufferGetPageSize(buffer));
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	opaque->hasho_prevblkno = prevblkno;
+	opaque->hasho_nextblkno = nextblkno;
+	opaque->hasho_bucket = bucket;
+	opaque->hasho_flag = flag;
+	opaque->hasho_page_id = HASHO_PAGE_ID;
+}
+
+/*
+ * Rebuild the metapage from the image in a WAL record.
+ */
+static void
+hashRestoreMetapage(XLogRecPtr lsn, RelFileNode node, HashMetaPage meta)
+{
+	Buffer		buffer;
+	Page		page;
+
+	buffer = XLogReadBuffer(node, HASH_METAPAGE, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+
+	hashInitPage(buffer, InvalidBlockNumber, InvalidBlockNumber, -1,
+				 LH_META_PAGE);
+	memcpy(HashPageGetMeta(page), meta, sizeof(HashMetaPageData));
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+hashRedoInitMetapage(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_metapage *xlrec = (xl_hash_metapage *) XLogRecGetData(record);
+	uint32		i;
+
+	hashRestoreMetapage(lsn, xlrec->node, &xlrec->meta);
+
+	for (i = 0; i < xlrec->num_buckets; i++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		buffer = XLogReadBuffer(xlrec->node,
+								BUCKET_TO_BLKNO(&xlrec->meta, i), true);
+		Assert(BufferIsValid(buffer));
+		page = (Page) BufferGetPage(buffer);
+
+		hashInitPage(buffer, InvalidBlockNumber, InvalidBlockNumber, i,
+					 LH_BUCKET_PAGE);
+
+		PageSetLSN(page, lsn);
+		PageSetTLI(page, ThisTimeLineID);
+		MarkBufferDirty(buffer);
+		UnlockReleaseBuffer(buffer);
+	}
+}
+
+static void
+hashRedoUpdateMetapage(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_metapage *xlrec = (xl_hash_metapage *) XLogRecGetData(record);
+
+	hashRestoreMetapage(lsn, xlrec->node, &xlrec->meta);
+}
+
+static void
+hashRedoInitBitmapPage(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_init_bitmap *xlrec = (xl_hash_init_bitmap *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->blkno, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+
+	hashInitPage(buffer, InvalidBlockNumber, InvalidBlockNumber, -1,
+				 LH_BITMAP_PAGE);
+	MemSet(HashPageGetBitmap(page), 0xFF, xlrec->bmsize);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+hashRedoAllocBitmapBit(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_alloc_bitmap_bit *xlrec = (xl_hash_alloc_bitmap_bit *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	/* nothing else to do if the page was backed up */
+	if (record->xl_info & XLR_BKP_BLOCK_1)
+		return;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->blkno, false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (!XLByteLE(lsn, PageGetLSN(page)))
+	{
+		SETBIT(HashPageGetBitmap(page), xlrec->bitno);
+
+		PageSetLSN(page, lsn);
+		PageSetTLI(page, ThisTimeLineID);
+		MarkBufferDirty(buffer);
+	}
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+hashRedoInsert(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_insert *xlrec = (xl_hash_insert *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	if (!(record->xl_info & XLR_BKP_BLOCK_1))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->blkno, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				Item		itup = (Item) ((char *) xlrec + sizeof(xl_hash_insert));
+				Size		itemsz = record->xl_len - sizeof(xl_hash_insert);
+
+				if (PageAddItem(page, itup, MAXALIGN(itemsz), xlrec->offnum,
+								false, false) == InvalidOffsetNumber)
+					elog(PANIC, "hash_redo: failed to add item");
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+
+	/* update the tuple count in the metapage */
+	if (!(record->xl_info & XLR_BKP_BLOCK_2))
+	{
+		buffer = XLogReadBuffer(xlrec->node, HASH_METAPAGE, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				HashPageGetMeta(page)->hashm_ntuples += 1;
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+static void
+hashRedoAddOvflPage(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_add_ovfl_page *xlrec = (xl_hash_add_ovfl_page *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	/* the new overflow page is always rebuilt from scratch */
+	buffer = XLogReadBuffer(xlrec->node, xlrec->ovflblkno, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+
+	hashInitPage(buffer, xlrec->prevblkno, InvalidBlockNumber, xlrec->bucket,
+				 LH_OVERFLOW_PAGE);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+
+	/* link it to the previous page */
+	if (record->xl_info & XLR_BKP_BLOCK_1)
+		return;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->prevblkno, false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (!XLByteLE(lsn, PageGetLSN(page)))
+	{
+		HashPageOpaque opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+		opaque->hasho_nextblkno = xlrec->ovflblkno;
+
+		PageSetLSN(page, lsn);
+		PageSetTLI(page, ThisTimeLineID);
+		MarkBufferDirty(buffer);
+	}
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+hashRedoFreeOvflPage(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_free_ovfl_page *xlrec = (xl_hash_free_ovfl_page *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+	int			bkpblock = 0;
+
+	/* the freed page is reinitialized as an unused page */
+	buffer = XLogReadBuffer(xlrec->node, xlrec->ovflblkno, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+
+	hashInitPage(buffer, InvalidBlockNumber, InvalidBlockNumber, -1,
+				 LH_UNUSED_PAGE);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+
+	/*
+	 * The remaining pages are referenced by the record in the order previous
+	 * page, next page (if any), bitmap page.
+	 */
+	if (BlockNumberIsValid(xlrec->prevblkno))
+	{
+		if (!(record->xl_info & XLR_SET_BKP_BLOCK(bkpblock)))
+		{
+			buffer = XLogReadBuffer(xlrec->node, xlrec->prevblkno, false);
+			if (BufferIsValid(buffer))
+			{
+				page = (Page) BufferGetPage(buffer);
+
+				if (!XLByteLE(lsn, PageGetLSN(page)))
+				{
+					HashPageOpaque opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+					opaque->hasho_nextblkno = xlrec->nextblkno;
+
+					PageSetLSN(page, lsn);
+					PageSetTLI(page, ThisTimeLineID);
+					MarkBufferDirty(buffer);
+				}
+				UnlockReleaseBuffer(buffer);
+			}
+		}
+		bkpblock++;
+	}
+
+	if (BlockNumberIsValid(xlrec->nextblkno))
+	{
+		if (!(record->xl_info & XLR_SET_BKP_BLOCK(bkpblock)))
+		{
+			buffer = XLogReadBuffer(xlrec->node, xlrec->nextblkno, false);
+			if (BufferIsValid(buffer))
+			{
+				page = (Page) BufferGetPage(buffer);
+
+				if (!XLByteLE(lsn, PageGetLSN(page)))
+				{
+					HashPageOpaque opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+					opaque->hasho_prevblkno = xlrec->prevblkno;
+
+					PageSetLSN(page, lsn);
+					PageSetTLI(page, ThisTimeLineID);
+					MarkBufferDirty(buffer);
+				}
+				UnlockReleaseBuffer(buffer);
+			}
+		}
+		bkpblock++;
+	}
+
+	if (!(record->xl_info & XLR_SET_BKP_BLOCK(bkpblock)))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->mapblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				CLRBIT(HashPageGetBitmap(page), xlrec->bitno);
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+static void
+hashRedoMoveTuples(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_move_tuples *xlrec = (xl_hash_move_tuples *) XLogRecGetData(record);
+	char	   *ptr = (char *) xlrec + MAXALIGN(sizeof(xl_hash_move_tuples));
+	Buffer		buffer;
+	Page		page;
+	uint16		i;
+
+	/*
+	 * Add the tuples to the write page, in the same order as the original
+	 * insertions, so that they get the same offsets.  If the write page was
+	 * backed up, the tuples were left out of the record.
+	 */
+	if (!(record->xl_info & XLR_BKP_BLOCK_1))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->wblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				char	   *tupptr = ptr;
+
+				for (i = 0; i < xlrec->ntups; i++)
+				{
+					IndexTuple	itup = (IndexTuple) tupptr;
+					Size		itemsz = MAXALIGN(IndexTupleDSize(*itup));
+					OffsetNumber offnum;
+
+					offnum = _hash_binsearch(page,
+										 _hash_get_indextuple_hashkey(itup));
+					if (PageAddItem(page, (Item) itup, itemsz, offnum,
+									false, false) == InvalidOffsetNumber)
+						elog(PANIC, "hash_redo: failed to add item");
+					tupptr += itemsz;
+				}
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+
+		/* skip over the tuples to the offset numbers */
+		for (i = 0; i < xlrec->ntups; i++)
+			ptr += MAXALIGN(IndexTupleDSize(*(IndexTuple) ptr));
+	}
+
+	/* Delete the tuples from the read page */
+	if (!(record->xl_info & XLR_BKP_BLOCK_2))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->rblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				PageIndexMultiDelete(page, (OffsetNumber *) ptr, xlrec->ntups);
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+static void
+hashRedoDelete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_delete *xlrec = (xl_hash_delete *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	/* nothing else to do if the page was backed up */
+	if (record->xl_info & XLR_BKP_BLOCK_1)
+		return;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->blkno, false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (!XLByteLE(lsn, PageGetLSN(page)))
+	{
+		OffsetNumber *offsets;
+		int			noffsets;
+
+		offsets = (OffsetNumber *) ((char *) xlrec + sizeof(xl_hash_delete));
+		noffsets = (record->xl_len - sizeof(xl_hash_delete)) /
+			sizeof(OffsetNumber);
+		PageIndexMultiDelete(page, offsets, noffsets);
+
+		PageSetLSN(page, lsn);
+		PageSetTLI(page, ThisTimeLineID);
+		MarkBufferDirty(buffer);
+	}
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+hashRedoSplitBegin(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_begin *xlrec = (xl_hash_split_begin *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	/*
+	 * If a new splitpoint's worth of bucket pages was allocated, extend the
+	 * index over all of them, as _hash_alloc_buckets did; overflow pages are
+	 * allocated beyond them.  Like the original, leave the last page zeroed;
+	 * the page of each bucket in the splitpoint is initialized by the record
+	 * that starts splitting into it.
+	 */
+	if (BlockNumberIsValid(xlrec->lastblkno))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->lastblkno, true);
+		Assert(BufferIsValid(buffer));
+		MarkBufferDirty(buffer);
+		UnlockReleaseBuffer(buffer);
+	}
+
+	/* mark the old bucket as being split */
+	if (!(record->xl_info & XLR_BKP_BLOCK_1))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->oblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				HashPageOpaque opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+				opaque->hasho_flag |= LH_BUCKET_BEING_SPLIT;
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+
+	/* initialize the new bucket's primary page */
+	buffer = XLogReadBuffer(xlrec->node, xlrec->nblkno, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+
+	hashInitPage(buffer, InvalidBlockNumber, InvalidBlockNumber,
+				 xlrec->new_bucket,
+				 LH_BUCKET_PAGE | LH_BUCKET_BEING_POPULATED);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+
+	hashRestoreMetapage(lsn, xlrec->node, &xlrec->meta);
+}
+
+static void
+hashRedoSplitComplete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_complete *xlrec = (xl_hash_split_complete *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	if (!(record->xl_info & XLR_BKP_BLOCK_1))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->oblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				HashPageOpaque opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+				opaque->hasho_flag &= ~LH_BUCKET_BEING_SPLIT;
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+
+	if (!(record->xl_info & XLR_BKP_BLOCK_2))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->nblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				HashPageOpaque opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+				opaque->hasho_flag &= ~LH_BUCKET_BEING_POPULATED;
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+void
+hash_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	RestoreBkpBlocks(lsn, record, false);
+
+	switch (info)
+	{
+		case XLOG_HASH_INIT_META_PAGE:
+			hashRedoInitMetapage(lsn, record);
+			break;
+		case XLOG_HASH_INIT_BITMAP_PAGE:
+			hashRedoInitBitmapPage(lsn, record);
+			break;
+		case XLOG_HASH_UPDATE_META_PAGE:
+			hashRedoUpdateMetapage(lsn, record);
+			break;
+		case XLOG_HASH_INSERT:
+			hashRedoInsert(lsn, record);
+			break;
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			hashRedoAddOvflPage(lsn, record);
+			break;
+		case XLOG_HASH_FREE_OVFL_PAGE:
+			hashRedoFreeOvflPage(lsn, record);
+			break;
+		case XLOG_HASH_ALLOC_BITMAP_BIT:
+			hashRedoAllocBitmapBit(lsn, record);
+			break;
+		case XLOG_HASH_MOVE_TUPLES:
+			hashRedoMoveTuples(lsn, record);
+			break;
+		case XLOG_HASH_DELETE:
+			hashRedoDelete(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_BEGIN:
+			hashRedoSplitBegin(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_COMPLETE:
+			hashRedoSplitComplete(lsn, record);
+			break;
+		default:
+			elog(PANIC, "hash_redo: unknown op code %u", info);
+	}
+}
+
+static void
+out_target(StringInfo buf, RelFileNode node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u ",
+					 node.spcNode, node.dbNode, node.relNode);
+}
+
+void
+hash_desc(StringInfo buf, uint8 xl_info, char *rec)
+{
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_HASH_INIT_META_PAGE:
+			out_target(buf, ((xl_hash_metapage *) rec)->node);
+			appendStringInfo(buf, "init metapage: %u buckets",
+							 ((xl_hash_metapage *) rec)->num_buckets);
+			break;
+		case XLOG_HASH_INIT_BITMAP_PAGE:
+			out_target(buf, ((xl_hash_init_bitmap *) rec)->node);
+			appendStringInfo(buf, "init bitmap page: %u",
+							 ((xl_hash_init_bitmap *) rec)->blkno);
+			break;
+		case XLOG_HASH_UPDATE_META_PAGE:
+			out_target(buf, ((xl_hash_metapage *) rec)->node);
+			appendStringInfo(buf, "update metapage");
+			break;
+		case XLOG_HASH_INSERT:
+			out_target(buf, ((xl_hash_insert *) rec)->node);
+			appendStringInfo(buf, "insert: %u/%u",
+							 ((xl_hash_insert *) rec)->blkno,
+							 ((xl_hash_insert *) rec)->offnum);
+			break;
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			out_target(buf, ((xl_hash_add_ovfl_page *) rec)->node);
+			appendStringInfo(buf, "add overflow page: %u after %u, bucket %u",
+							 ((xl_hash_add_ovfl_page *) rec)->ovflblkno,
+							 ((xl_hash_add_ovfl_page *) rec)->prevblkno,
+							 ((xl_hash_add_ovfl_page *) rec)->bucket);
+			break;
+		case XLOG_HASH_FREE_OVFL_PAGE:
+			out_target(buf, ((xl_hash_free_ovfl_page *) rec)->node);
+			appendStringInfo(buf, "free overflow page: %u, prev %u, next %u",
+							 ((xl_hash_free_ovfl_page *) rec)->ovflblkno,
+							 ((xl_hash_free_ovfl_page *) rec)->prevblkno,
+							 ((xl_hash_free_ovfl_page *) rec)->nextblkno);
+			break;
+		case XLOG_HASH_ALLOC_BITMAP_BIT:
+			out_target(buf, ((xl_hash_alloc_bitmap_bit *) rec)->node);
+			appendStringInfo(buf, "allocate bitmap bit: %u/%u",
+							 ((xl_hash_alloc_bitmap_bit *) rec)->blkno,
+							 ((xl_hash_alloc_bitmap_bit *) rec)->bitno);
+			break;
+		case XLOG_HASH_MOVE_TUPLES:
+			out_target(buf, ((xl_hash_move_tuples *) rec)->node);
+			appendStringInfo(buf, "move %u tuples: %u to %u",
+							 ((xl_hash_move_tuples *) rec)->ntups,
+							 ((xl_hash_move_tuples *) rec)->rblkno,
+							 ((xl_hash_move_tuples *) rec)->wblkno);
+			break;
+		case XLOG_HASH_DELETE:
+			out_target(buf, ((xl_hash_delete *) rec)->node);
+			appendStringInfo(buf, "delete: %u",
+							 ((xl_hash_delete *) rec)->blkno);
+			break;
+		case XLOG_HASH_SPLIT_BEGIN:
+			out_target(buf, ((xl_hash_split_begin *) rec)->node);
+			appendStringInfo(buf, "split begin: bucket %u into %u",
+							 ((xl_hash_split_begin *) rec)->old_bucket,
+							 ((xl_hash_split_begin *) rec)->new_bucket);
+			break;
+		case XLOG_HASH_SPLIT_COMPLETE:
+			out_target(buf, ((xl_hash_split_complete *) rec)->node);
+			appendStringInfo(buf, "split complete: %u into %u",
+							 ((xl_hash_split_complete *) rec)->oblkno,
+							 ((xl_hash_split_complete *) rec)->nblkno);
+			break;
+		default:
+			appendStringInfo(buf, "unknown hash op code %u", info);
+			break;
+	}
+}
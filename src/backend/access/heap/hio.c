@@ -95,6 +95,79 @@ ReadBufferBI(Relation relation, BlockNumber targetBlock,
 	return buffer;
 }
 
+/*
+ * Extend a relation by multiple blocks to avoid future contention on the
+ * relation extension lock.  Our caller holds the lock and has seen other
+ * backends queue up behind it, so we add a number of blocks proportional to
+ * the number of waiters, and enter them in the free space map at once so
+ * that the waiters find them there instead of extending the relation one
+ * page at a time themselves.
+ */
+static void
+RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+{
+	BlockNumber blockNum,
+				firstBlock = InvalidBlockNumber;
+	int			extraBlocks;
+	int			lockWaiters;
+	Size		freespace = 0;
+
+	/* Use the length of the lock wait queue to judge how much to extend. */
+	lockWaiters = RelationExtensionLockWaiterCount(relation);
+	if (lockWaiters <= 0)
+		return;
+
+	/*
+	 * Each waiter will fill the page it gets and then come back for another,
+	 * queueing behind the lock again.  Giving every waiter enough pages for
+	 * a good number of round trips lets them keep inserting while the next
+	 * extender does its work, instead of all of them serializing on the lock
+	 * one page at a time.  The cap of 512 blocks (4MB with the default block
+	 * size) bounds how long we hold the lock, and how much space we leave
+	 * empty if the load stops right after.
+	 */
+	extraBlocks = Min(512, lockWaiters * 20);
+
+	do
+	{
+		Buffer		buffer;
+		Page		page;
+
+		/*
+		 * Extend by one page.  This should generally match the main-line
+		 * extension code in RelationGetBufferForTuple, except that we hold
+		 * the relation extension lock throughout.
+		 */
+		buffer = ReadBufferExtended(relation, MAIN_FORKNUM, P_NEW, RBM_NORMAL,
+									bistate ? bistate->strategy : NULL);
+
+		/* Initialize the new page.  It's not WAL-logged, like the others. */
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (!PageIsNew(page))
+			elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
+				 BufferGetBlockNumber(buffer),
+				 RelationGetRelationName(relation));
+
+		PageInit(page, BufferGetPageSize(buffer), 0);
+		MarkBufferDirty(buffer);
+		blockNum = BufferGetBlockNumber(buffer);
+		freespace = PageGetHeapFreeSpace(page);
+		UnlockReleaseBuffer(buffer);
+
+		/* Remember first block number thus added. */
+		if (firstBlock == InvalidBlockNumber)
+			firstBlock = blockNum;
+	} while (--extraBlocks > 0);
+
+	/*
+	 * Record the free space of all the new pages in the FSM, including the
+	 * upper levels, so that other backends can find them.
+	 */
+	RecordNewPagesWithFreeSpace(relation, firstBlock, blockNum, freespace);
+}
+
 /*
  * RelationGetBufferForTuple
  *
@@ -231,6 +304,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		}
 	}
 
+loop:
 	while (targetBlock != InvalidBlockNumber)
 	{
 		/*
@@ -314,11 +388,46 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	 * same time, else we will both try to initialize the same new page.  We
 	 * can skip locking for new or temp relations, however, since no one else
 	 * could be accessing them.
+	 *
+	 * If we have to wait for the lock, other backends are extending the
+	 * relation concurrently.  One of them may have added pages to the FSM
+	 * while we waited, so look there again first.  If there's still nothing,
+	 * extend by several pages while we hold the lock, so that the backends
+	 * queued up behind us don't all have to take their turn for one page
+	 * each.  We don't bother when not using the FSM, since the extra pages
+	 * would only be found through it.
 	 */
 	needLock = !RELATION_IS_LOCAL(relation);
 
 	if (needLock)
-		LockRelationForExtension(relation, ExclusiveLock);
+	{
+		if (!use_fsm)
+			LockRelationForExtension(relation, ExclusiveLock);
+		else if (!ConditionalLockRelationForExtension(relation, ExclusiveLock))
+		{
+			/* Couldn't get the lock immediately; wait for it. */
+			LockRelationForExtension(relation, ExclusiveLock);
+
+			/*
+			 * Check if some other backend has extended a block for us while
+			 * we were waiting on the lock.
+			 */
+			targetBlock = GetPageWithFreeSpace(relation, len + saveFreeSpace);
+
+			/*
+			 * If some other waiter has already extended the relation, we
+			 * don't need to do so; just use the existing freespace.
+			 */
+			if (targetBlock != InvalidBlockNumber)
+			{
+				UnlockRelationForExtension(relation, ExclusiveLock);
+				goto loop;
+			}
+
+			/* Time to bulk-extend. */
+			RelationAddExtraBlocks(relation, bistate);
+		}
+	}
 
 	/*
 	 * XXX This does an lseek - rather expensive - but at the moment it is the
@@ -25,6 +25,9 @@
 #include "utils/tqual.h"
 
 
+/* GUC variable */
+int			prune_freeze_min_age = 50000000;
+
 /* Working data for heap_page_prune and subroutines */
 typedef struct
 {
@@ -52,6 +55,8 @@ static void heap_prune_record_redirect(PruneState *prstate,
 						   OffsetNumber offnum, OffsetNumber rdoffnum);
 static void heap_prune_record_dead(PruneState *prstate, OffsetNumber offnum);
 static void heap_prune_record_unused(PruneState *prstate, OffsetNumber offnum);
+static TransactionId heap_prune_freeze_limit(Page page, PruneState *prstate,
+						TransactionId OldestXmin);
 
 
 /*
@@ -160,6 +165,9 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 	OffsetNumber offnum,
 				maxoff;
 	PruneState	prstate;
+	TransactionId freezeLimit = InvalidTransactionId;
+	OffsetNumber frozen[MaxHeapTuplesPerPage];
+	int			nfrozen = 0;
 
 	/*
 	 * Our strategy is to scan the page and make lists of items to change,
@@ -200,6 +208,14 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 									 &prstate);
 	}
 
+	/*
+	 * If we're going to dirty and WAL-log the page anyway, see whether we can
+	 * freeze its remaining tuples too, sparing a later VACUUM a write of the
+	 * whole page just for that.
+	 */
+	if (prstate.nredirected > 0 || prstate.ndead > 0 || prstate.nunused > 0)
+		freezeLimit = heap_prune_freeze_limit(page, &prstate, OldestXmin);
+
 	/* Any error while applying the changes is critical */
 	START_CRIT_SECTION();
 
@@ -228,6 +244,28 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 		 */
 		PageClearFull(page);
 
+		/*
+		 * Freeze the tuples that survived pruning, if we decided to.  The
+		 * items we just redirected or marked dead or unused don't have
+		 * tuples anymore; all the others on the page are normal ones.
+		 */
+		if (TransactionIdIsValid(freezeLimit))
+		{
+			maxoff = PageGetMaxOffsetNumber(page);
+			for (offnum = FirstOffsetNumber;
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				ItemId		itemid = PageGetItemId(page, offnum);
+
+				if (!ItemIdIsNormal(itemid))
+					continue;
+				if (heap_freeze_tuple((HeapTupleHeader) PageGetItem(page, itemid),
+									  freezeLimit, InvalidBuffer))
+					frozen[nfrozen++] = offnum;
+			}
+		}
+
 		MarkBufferDirty(buffer);
 
 		/*
@@ -246,6 +284,19 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 
 			PageSetLSN(BufferGetPage(buffer), recptr);
 			PageSetTLI(BufferGetPage(buffer), ThisTimeLineID);
+
+			/*
+			 * Log the freezing separately, after the page's LSN has been
+			 * advanced so that this record doesn't need its own full-page
+			 * image.
+			 */
+			if (nfrozen > 0)
+			{
+				recptr = log_heap_freeze(relation, buffer, freezeLimit,
+										 frozen, nfrozen);
+				PageSetLSN(BufferGetPage(buffer), recptr);
+				PageSetTLI(BufferGetPage(buffer), ThisTimeLineID);
+			}
 		}
 	}
 	else
@@ -303,6 +354,60 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 }
 
 
+/*
+ * Decide whether pruning should also freeze the page's tuples.
+ *
+ * Returns the cutoff xid to pass to heap_freeze_tuple, or
+ * InvalidTransactionId if the page should not be frozen.  We freeze only if
+ * every tuple that will remain on the page has a committed xmin older than
+ * prune_freeze_min_age transactions before OldestXmin.  A page that still
+ * has younger tuples is likely to be modified again soon, and would just
+ * have to be visited by VACUUM anyway.
+ *
+ * Tuples that pruning is about to remove are marked in prstate; all other
+ * used items that aren't redirects or dead are normal, surviving tuples.
+ */
+static TransactionId
+heap_prune_freeze_limit(Page page, PruneState *prstate,
+						TransactionId OldestXmin)
+{
+	TransactionId limit;
+	OffsetNumber offnum,
+				maxoff;
+
+	if (prune_freeze_min_age < 0)
+		return InvalidTransactionId;
+
+	/* Compute the cutoff the same way vacuum_set_xid_limits() does */
+	limit = OldestXmin - prune_freeze_min_age;
+	if (!TransactionIdIsNormal(limit))
+		limit = FirstNormalTransactionId;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
+		TransactionId xmin;
+
+		if (prstate->marked[offnum] || !ItemIdIsNormal(itemid))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, itemid);
+		xmin = HeapTupleHeaderGetXmin(htup);
+		if (!TransactionIdIsNormal(xmin))
+			continue;			/* already frozen */
+		if (!(htup->t_infomask & HEAP_XMIN_COMMITTED) ||
+			!TransactionIdPrecedes(xmin, limit))
+			return InvalidTransactionId;
+	}
+
+	return limit;
+}
+
+
 /*
  * Prune specified item pointer or a HOT chain originating at that item.
  *
@@ -22,6 +22,9 @@
  *		heap_tuple_untoast_attr -
  *			Fetch back a given value from the "secondary" relation
  *
+ *		detoast_begin_iterate, detoast_iterate, detoast_end_iterate -
+ *			Fetch back a given value piece by piece, as far as needed
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -35,7 +38,9 @@
 #include "access/tuptoaster.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "utils/attoptcache.h"
 #include "utils/fmgroids.h"
+#include "utils/pg_lz4compress.h"
 #include "utils/pg_lzcompress.h"
 #include "utils/rel.h"
 #include "utils/typcache.h"
@@ -44,6 +49,12 @@
 
 #undef TOAST_DEBUG
 
+/* GUC variable */
+int			default_toast_compression = TOAST_PGLZ_COMPRESSION;
+
+/* Size of the header of a compressed-in-line datum, raw size word included */
+#define TOAST_COMPRESS_HDRSZ	((int32) offsetof(varattrib_4b, va_compressed.va_data))
+
 /* Size of an EXTERNAL datum that contains a standard TOAST pointer */
 #define TOAST_POINTER_SIZE (VARHDRSZ_EXTERNAL + sizeof(struct varatt_external))
 
@@ -57,6 +68,18 @@
 #define VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) \
 	((toast_pointer).va_extsize < (toast_pointer).va_rawsize - VARHDRSZ)
 
+/*
+ * The most compressed data, raw size word included, that can be needed to
+ * decompress the first n bytes of a value.  pglz spends at most 9 bits per
+ * output byte plus a 3-byte tag that might reach just past the wanted data;
+ * LZ4 needs less than that plus a little for its sequence headers.  The
+ * exception is an LZ4 match with a huge length, whose continuation bytes
+ * can run past this, in which case the caller must be ready to fall back
+ * on fetching all of the data.
+ */
+#define TOAST_COMPRESSED_PREFIX_SIZE(n) \
+	((int64) sizeof(int32) + ((int64) (n) * 9 + 7) / 8 + 16)
+
 /*
  * Macro to fetch the possibly-unaligned contents of an EXTERNAL datum
  * into a local "struct varatt_external" toast pointer.  This should be
@@ -73,9 +96,46 @@ do { \
 } while (0)
 
 
+/*
+ * Private state of a DetoastIterator, for values that aren't simply in
+ * memory in plain form.
+ */
+typedef struct DetoastIteratorState
+{
+	/* For external values: the toast chunks fetched so far */
+	struct varatt_external toast_pointer;
+	Relation	toastrel;		/* NULL when not (or no longer) fetching */
+	Relation	toastidx;
+	SysScanDesc toastscan;
+	ScanKeyData toastkey;
+	int32		numchunks;
+	int32		nextidx;		/* next chunk number to be fetched */
+
+	/* The stored data, possibly compressed, and how much of it we have */
+	bool		external;		/* data is palloc'd, else it's in the datum */
+	char	   *data;
+	int32		datasize;
+	int32		avail;
+
+	/* For compressed values: the decompression in progress */
+	bool		compressed;
+	int			method;			/* -1 until the raw size word is seen */
+	union
+	{
+		PGLZ_DecompressState pglz;
+		PG_LZ4_DecompressState lz4;
+	}			dstate;
+} DetoastIteratorState;
+
+static void detoast_iterator_fetch_chunk(DetoastIteratorState *state);
 static void toast_delete_datum(Relation rel, Datum value);
 static Datum toast_save_datum(Relation rel, Datum value, int options);
 static struct varlena *toast_fetch_datum(struct varlena * attr);
+static struct varlena *toast_decompress_datum(struct varlena * attr);
+static struct varlena *toast_decompress_datum_slice(struct varlena * attr,
+							 int32 sliceoffset, int32 slicelength,
+							 bool complete);
+static int	toast_get_compression_method(Relation rel, AttrNumber attnum);
 static struct varlena *toast_fetch_datum_slice(struct varlena * attr,
 						int32 sliceoffset, int32 length);
 
@@ -134,11 +194,9 @@ heap_tuple_untoast_attr(struct varlena * attr)
 		/* If it's compressed, decompress it */
 		if (VARATT_IS_COMPRESSED(attr))
 		{
-			PGLZ_Header *tmp = (PGLZ_Header *) attr;
+			struct varlena *tmp = attr;
 
-			attr = (struct varlena *) palloc(PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-			SET_VARSIZE(attr, PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-			pglz_decompress(tmp, VARDATA(attr));
+			attr = toast_decompress_datum(tmp);
 			pfree(tmp);
 		}
 	}
@@ -147,11 +205,7 @@ heap_tuple_untoast_attr(struct varlena * attr)
 		/*
 		 * This is a compressed value inside of the main tuple
 		 */
-		PGLZ_Header *tmp = (PGLZ_Header *) attr;
-
-		attr = (struct varlena *) palloc(PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-		SET_VARSIZE(attr, PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-		pglz_decompress(tmp, VARDATA(attr));
+		attr = toast_decompress_datum(attr);
 	}
 	else if (VARATT_IS_SHORT(attr))
 	{
@@ -198,6 +252,28 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 		if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
 			return toast_fetch_datum_slice(attr, sliceoffset, slicelength);
 
+		/*
+		 * Decompressing the start of a value needs only the start of the
+		 * compressed data, so if the slice doesn't reach far into the value,
+		 * try with just as many chunks as could be needed for it.
+		 */
+		if (slicelength >= 0 &&
+			TOAST_COMPRESSED_PREFIX_SIZE((int64) sliceoffset + slicelength) <
+			toast_pointer.va_extsize)
+		{
+			int32		prefixsize;
+
+			prefixsize = TOAST_COMPRESSED_PREFIX_SIZE((int64) sliceoffset +
+													  slicelength);
+			preslice = toast_fetch_datum_slice(attr, 0, prefixsize);
+			result = toast_decompress_datum_slice(preslice,
+												  sliceoffset, slicelength,
+												  false);
+			pfree(preslice);
+			if (result != NULL)
+				return result;
+		}
+
 		/* fetch it back (compressed marker will get set automatically) */
 		preslice = toast_fetch_datum(attr);
 	}
@@ -206,15 +282,15 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 
 	if (VARATT_IS_COMPRESSED(preslice))
 	{
-		PGLZ_Header *tmp = (PGLZ_Header *) preslice;
-		Size		size = PGLZ_RAW_SIZE(tmp) + VARHDRSZ;
+		/* decompress no further than the end of the slice */
+		result = toast_decompress_datum_slice(preslice,
+											  sliceoffset, slicelength,
+											  true);
 
-		preslice = (struct varlena *) palloc(size);
-		SET_VARSIZE(preslice, size);
-		pglz_decompress(tmp, VARDATA(preslice));
+		if (preslice != attr)
+			pfree(preslice);
 
-		if (tmp != (PGLZ_Header *) attr)
-			pfree(tmp);
+		return result;
 	}
 
 	if (VARATT_IS_SHORT(preslice))
@@ -251,6 +327,297 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 }
 
 
+/* ----------
+ * detoast_begin_iterate -
+ *
+ *	Set up to detoast a value incrementally.  Nothing is fetched or
+ *	decompressed yet, except that a value that's neither external nor
+ *	compressed is available in full straight away.
+ * ----------
+ */
+DetoastIterator
+detoast_begin_iterate(struct varlena * attr)
+{
+	DetoastIterator iter = (DetoastIterator) palloc0(sizeof(DetoastIteratorData));
+	DetoastIteratorState *state;
+
+	if (!VARATT_IS_EXTERNAL(attr) && !VARATT_IS_COMPRESSED(attr))
+	{
+		/* plain or short-header value: there's nothing to do */
+		iter->buf = VARDATA_ANY(attr);
+		iter->rawsize = VARSIZE_ANY_EXHDR(attr);
+		iter->avail = iter->rawsize;
+		iter->state = NULL;
+		return iter;
+	}
+
+	state = (DetoastIteratorState *) palloc0(sizeof(DetoastIteratorState));
+	iter->state = state;
+
+	if (VARATT_IS_EXTERNAL(attr))
+	{
+		/* Must copy to access aligned fields */
+		VARATT_EXTERNAL_GET_POINTER(state->toast_pointer, attr);
+
+		state->external = true;
+		state->datasize = state->toast_pointer.va_extsize;
+		state->numchunks = ((state->datasize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
+		state->data = palloc(state->datasize);
+		state->avail = 0;
+		state->compressed = VARATT_EXTERNAL_IS_COMPRESSED(state->toast_pointer);
+		iter->rawsize = state->toast_pointer.va_rawsize - VARHDRSZ;
+
+		state->toastrel = heap_open(state->toast_pointer.va_toastrelid,
+									AccessShareLock);
+		state->toastidx = index_open(state->toastrel->rd_rel->reltoastidxid,
+									 AccessShareLock);
+		ScanKeyInit(&state->toastkey,
+					(AttrNumber) 1,
+					BTEqualStrategyNumber, F_OIDEQ,
+					ObjectIdGetDatum(state->toast_pointer.va_valueid));
+		state->toastscan = systable_beginscan_ordered(state->toastrel,
+													  state->toastidx,
+													  SnapshotToast, 1,
+													  &state->toastkey);
+	}
+	else
+	{
+		/*
+		 * Compressed in-line value: all of the compressed data is here, laid
+		 * out just like the chunks of an external one, raw size word first.
+		 */
+		state->external = false;
+		state->data = (char *) attr + VARHDRSZ;
+		state->datasize = VARSIZE(attr) - VARHDRSZ;
+		state->avail = state->datasize;
+		state->compressed = true;
+		iter->rawsize = VARRAWSIZE_4B_C(attr);
+	}
+
+	state->method = -1;
+	if (state->compressed)
+		iter->buf = palloc(iter->rawsize);
+	else
+		iter->buf = state->data;
+	iter->avail = 0;
+
+	return iter;
+}
+
+
+/* ----------
+ * detoast_iterate -
+ *
+ *	Make at least the first upto bytes of the value available in iter->buf,
+ *	or all of it if it's shorter.  Chunks are fetched one at a time, and
+ *	compressed data is decompressed a chunk's worth ahead of what was asked
+ *	for, so that callers can ask for a little more at a time cheaply.
+ * ----------
+ */
+void
+detoast_iterate(DetoastIterator iter, int32 upto)
+{
+	DetoastIteratorState *state = iter->state;
+
+	if (upto > iter->rawsize)
+		upto = iter->rawsize;
+
+	while (iter->avail < upto)
+	{
+		Assert(state != NULL);
+
+		if (state->compressed && state->avail > (int32) sizeof(int32))
+		{
+			/* The compressed data starts after the raw size word */
+			const char *source = state->data + sizeof(int32);
+			int32		srclen = state->avail - sizeof(int32);
+			bool		complete = (state->avail == state->datasize);
+			int32		dlen;
+
+			if (state->method < 0)
+			{
+				uint32		rawsizeword;
+
+				memcpy(&rawsizeword, state->data, sizeof(rawsizeword));
+				state->method = rawsizeword >> VARRAWSIZE_BITS;
+				if (state->method == TOAST_LZ4_COMPRESSION)
+					pg_lz4_decompress_init(&state->dstate.lz4);
+				else
+					pglz_decompress_init(&state->dstate.pglz);
+			}
+
+			dlen = Min(iter->rawsize,
+					   Max(upto, iter->avail + TOAST_MAX_CHUNK_SIZE));
+
+			switch (state->method)
+			{
+				case TOAST_PGLZ_COMPRESSION:
+					pglz_decompress_partial(&state->dstate.pglz,
+											source, srclen, complete,
+											iter->buf, dlen);
+					iter->avail = state->dstate.pglz.dstpos;
+					break;
+				case TOAST_LZ4_COMPRESSION:
+					if (!pg_lz4_decompress_partial(&state->dstate.lz4,
+												   source, srclen, complete,
+												   iter->buf, dlen))
+						ereport(ERROR,
+								(errcode(ERRCODE_DATA_CORRUPTED),
+								 errmsg("compressed data is corrupt")));
+					iter->avail = state->dstate.lz4.dstpos;
+					break;
+				default:
+					elog(ERROR, "invalid compression method %d",
+						 state->method);
+					break;
+			}
+
+			if (iter->avail >= upto)
+				break;
+			if (complete)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("compressed data is corrupt")));
+		}
+
+		/* Need more of the stored data */
+		detoast_iterator_fetch_chunk(state);
+		if (!state->compressed)
+			iter->avail = state->avail;
+	}
+}
+
+
+/* ----------
+ * detoast_end_iterate -
+ *
+ *	Release the resources of a DetoastIterator.  Its buffer goes too, unless
+ *	it pointed into the original datum.
+ * ----------
+ */
+void
+detoast_end_iterate(DetoastIterator iter)
+{
+	DetoastIteratorState *state = iter->state;
+
+	if (state != NULL)
+	{
+		if (state->toastrel != NULL)
+		{
+			systable_endscan_ordered(state->toastscan);
+			index_close(state->toastidx, AccessShareLock);
+			heap_close(state->toastrel, AccessShareLock);
+		}
+		if (state->compressed)
+			pfree(iter->buf);
+		if (state->external)
+			pfree(state->data);
+		pfree(state);
+	}
+	pfree(iter);
+}
+
+
+/* ----------
+ * detoast_iterator_fetch_chunk -
+ *
+ *	Append the next chunk of an external value to state->data.  The checks
+ *	are the same as in toast_fetch_datum().
+ * ----------
+ */
+static void
+detoast_iterator_fetch_chunk(DetoastIteratorState *state)
+{
+	TupleDesc	toasttupDesc;
+	HeapTuple	ttup;
+	int32		residx;
+	Pointer		chunk;
+	bool		isnull;
+	char	   *chunkdata;
+	int32		chunksize;
+
+	if (state->toastrel == NULL)
+		elog(ERROR, "no more toast chunks to fetch");
+
+	toasttupDesc = state->toastrel->rd_att;
+	ttup = systable_getnext_ordered(state->toastscan, ForwardScanDirection);
+	if (ttup == NULL)
+		elog(ERROR, "missing chunk number %d for toast value %u in %s",
+			 state->nextidx,
+			 state->toast_pointer.va_valueid,
+			 RelationGetRelationName(state->toastrel));
+
+	residx = DatumGetInt32(fastgetattr(ttup, 2, toasttupDesc, &isnull));
+	Assert(!isnull);
+	chunk = DatumGetPointer(fastgetattr(ttup, 3, toasttupDesc, &isnull));
+	Assert(!isnull);
+	if (!VARATT_IS_EXTENDED(chunk))
+	{
+		chunksize = VARSIZE(chunk) - VARHDRSZ;
+		chunkdata = VARDATA(chunk);
+	}
+	else if (VARATT_IS_SHORT(chunk))
+	{
+		/* could happen due to heap_form_tuple doing its thing */
+		chunksize = VARSIZE_SHORT(chunk) - VARHDRSZ_SHORT;
+		chunkdata = VARDATA_SHORT(chunk);
+	}
+	else
+	{
+		/* should never happen */
+		elog(ERROR, "found toasted toast chunk for toast value %u in %s",
+			 state->toast_pointer.va_valueid,
+			 RelationGetRelationName(state->toastrel));
+		chunksize = 0;			/* keep compiler quiet */
+		chunkdata = NULL;
+	}
+
+	if (residx != state->nextidx)
+		elog(ERROR, "unexpected chunk number %d (expected %d) for toast value %u in %s",
+			 residx, state->nextidx,
+			 state->toast_pointer.va_valueid,
+			 RelationGetRelationName(state->toastrel));
+	if (residx < state->numchunks - 1)
+	{
+		if (chunksize != TOAST_MAX_CHUNK_SIZE)
+			elog(ERROR, "unexpected chunk size %d (expected %d) in chunk %d of %d for toast value %u in %s",
+				 chunksize, (int) TOAST_MAX_CHUNK_SIZE,
+				 residx, state->numchunks,
+				 state->toast_pointer.va_valueid,
+				 RelationGetRelationName(state->toastrel));
+	}
+	else if (residx == state->numchunks - 1)
+	{
+		if ((residx * TOAST_MAX_CHUNK_SIZE + chunksize) != state->datasize)
+			elog(ERROR, "unexpected chunk size %d (expected %d) in final chunk %d for toast value %u in %s",
+				 chunksize,
+				 (int) (state->datasize - residx * TOAST_MAX_CHUNK_SIZE),
+				 residx,
+				 state->toast_pointer.va_valueid,
+				 RelationGetRelationName(state->toastrel));
+	}
+	else
+		elog(ERROR, "unexpected chunk number %d (out of range %d..%d) for toast value %u in %s",
+			 residx,
+			 0, state->numchunks - 1,
+			 state->toast_pointer.va_valueid,
+			 RelationGetRelationName(state->toastrel));
+
+	memcpy(state->data + state->avail, chunkdata, chunksize);
+	state->avail += chunksize;
+	state->nextidx++;
+
+	/* Once we have it all, there's no need to hang onto the scan */
+	if (state->nextidx == state->numchunks)
+	{
+		systable_endscan_ordered(state->toastscan);
+		index_close(state->toastidx, AccessShareLock);
+		heap_close(state->toastrel, AccessShareLock);
+		state->toastrel = NULL;
+	}
+}
+
+
 /* ----------
  * toast_raw_datum_size -
  *
@@ -638,7 +1005,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		if (att[i]->attstorage == 'x')
 		{
 			old_value = toast_values[i];
-			new_value = toast_compress_datum(old_value);
+			new_value = toast_compress_datum(old_value,
+							 toast_get_compression_method(rel, att[i]->attnum));
 
 			if (DatumGetPointer(new_value) != NULL)
 			{
@@ -775,7 +1143,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		 */
 		i = biggest_attno;
 		old_value = toast_values[i];
-		new_value = toast_compress_datum(old_value);
+		new_value = toast_compress_datum(old_value,
+							 toast_get_compression_method(rel, att[i]->attnum));
 
 		if (DatumGetPointer(new_value) != NULL)
 		{
@@ -1063,12 +1432,15 @@ toast_flatten_tuple_attribute(Datum value,
  *	then return NULL.  We must not use compressed data if it'd expand
  *	the tuple!
  *
+ *	method is one of the TOAST_*_COMPRESSION methods; the choice is
+ *	recorded in the result, so decompression doesn't need to be told.
+ *
  *	We use VAR{SIZE,DATA}_ANY so we can handle short varlenas here without
  *	copying them.  But we can't handle external or compressed datums.
  * ----------
  */
 Datum
-toast_compress_datum(Datum value)
+toast_compress_datum(Datum value, int method)
 {
 	struct varlena *tmp;
 	int32		valsize = VARSIZE_ANY_EXHDR(DatumGetPointer(value));
@@ -1076,6 +1448,40 @@ toast_compress_datum(Datum value)
 	Assert(!VARATT_IS_EXTERNAL(DatumGetPointer(value)));
 	Assert(!VARATT_IS_COMPRESSED(DatumGetPointer(value)));
 
+	if (method == TOAST_LZ4_COMPRESSION)
+	{
+		int32		len;
+
+		if (valsize < PG_LZ4_MIN_INPUT_SIZE)
+			return PointerGetDatum(NULL);
+
+		tmp = (struct varlena *) palloc(TOAST_COMPRESS_HDRSZ + valsize);
+
+		/*
+		 * As explained below for pglz, we insist on saving more than 2 bytes
+		 * overall, so tell the compressor to give up as soon as its output
+		 * can't be that small.
+		 */
+		len = pg_lz4_compress(VARDATA_ANY(DatumGetPointer(value)), valsize,
+							  VARDATA_4B_C(tmp),
+							  valsize - TOAST_COMPRESS_HDRSZ - 3);
+		if (len >= 0)
+		{
+			/* successful compression */
+			SET_VARSIZE_COMPRESSED(tmp, TOAST_COMPRESS_HDRSZ + len);
+			SET_VARRAWSIZE_4B_C(tmp, valsize, TOAST_LZ4_COMPRESSION);
+			return PointerGetDatum(tmp);
+		}
+		else
+		{
+			/* incompressible data */
+			pfree(tmp);
+			return PointerGetDatum(NULL);
+		}
+	}
+
+	Assert(method == TOAST_PGLZ_COMPRESSION);
+
 	/*
 	 * No point in wasting a palloc cycle if value size is out of the allowed
 	 * range for compression
@@ -1112,6 +1518,203 @@ toast_compress_datum(Datum value)
 }
 
 
+/* ----------
+ * toast_decompress_datum -
+ *
+ *	Decompress a compressed-in-line datum, with whichever method it was
+ *	compressed with.  The result is a palloc'd plain varlena.
+ * ----------
+ */
+static struct varlena *
+toast_decompress_datum(struct varlena * attr)
+{
+	struct varlena *result;
+	int32		rawsize = VARRAWSIZE_4B_C(attr);
+
+	Assert(VARATT_IS_COMPRESSED(attr));
+
+	result = (struct varlena *) palloc(rawsize + VARHDRSZ);
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
+
+	switch (VARCOMPRESSMETHOD_4B_C(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION:
+			pglz_decompress((PGLZ_Header *) attr, VARDATA(result));
+			break;
+		case TOAST_LZ4_COMPRESSION:
+			if (pg_lz4_decompress(VARDATA_4B_C(attr),
+								  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+								  VARDATA(result), rawsize) != rawsize)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("compressed data is corrupt")));
+			break;
+		default:
+			elog(ERROR, "invalid compression method %u",
+				 VARCOMPRESSMETHOD_4B_C(attr));
+			break;
+	}
+
+	return result;
+}
+
+
+/* ----------
+ * toast_decompress_datum_slice -
+ *
+ *	Decompress just enough of a compressed-in-line datum to return the
+ *	given slice of it, as a palloc'd plain varlena.  A negative slicelength
+ *	means the rest of the value.
+ *
+ *	If complete is false, attr holds only a prefix of the compressed data
+ *	(its varlena size says how long the prefix is).  If that turns out not
+ *	to be enough for the slice, NULL is returned.
+ * ----------
+ */
+static struct varlena *
+toast_decompress_datum_slice(struct varlena * attr,
+							 int32 sliceoffset, int32 slicelength,
+							 bool complete)
+{
+	struct varlena *result;
+	int32		rawsize = VARRAWSIZE_4B_C(attr);
+	int32		srclen = VARSIZE(attr) - TOAST_COMPRESS_HDRSZ;
+	int32		sliceend;
+	int32		produced;
+
+	Assert(VARATT_IS_COMPRESSED(attr));
+
+	if (sliceoffset >= rawsize)
+	{
+		sliceoffset = 0;
+		slicelength = 0;
+	}
+
+	if (slicelength < 0 || (int64) sliceoffset + slicelength > rawsize)
+		slicelength = rawsize - sliceoffset;
+	sliceend = sliceoffset + slicelength;
+
+	/*
+	 * Decompress from the start up to the end of the slice, then move the
+	 * slice down to the start of the result.
+	 */
+	result = (struct varlena *) palloc(sliceend + VARHDRSZ);
+
+	switch (VARCOMPRESSMETHOD_4B_C(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION:
+			{
+				PGLZ_DecompressState state;
+
+				pglz_decompress_init(&state);
+				pglz_decompress_partial(&state, VARDATA_4B_C(attr), srclen,
+										complete, VARDATA(result), sliceend);
+				produced = state.dstpos;
+			}
+			break;
+		case TOAST_LZ4_COMPRESSION:
+			{
+				PG_LZ4_DecompressState state;
+
+				pg_lz4_decompress_init(&state);
+				if (!pg_lz4_decompress_partial(&state, VARDATA_4B_C(attr),
+											   srclen, complete,
+											   VARDATA(result), sliceend))
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("compressed data is corrupt")));
+				produced = state.dstpos;
+			}
+			break;
+		default:
+			elog(ERROR, "invalid compression method %u",
+				 VARCOMPRESSMETHOD_4B_C(attr));
+			produced = 0;		/* keep compiler quiet */
+			break;
+	}
+
+	if (produced != sliceend)
+	{
+		if (complete)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed data is corrupt")));
+		pfree(result);
+		return NULL;
+	}
+
+	if (sliceoffset > 0)
+		memmove(VARDATA(result), VARDATA(result) + sliceoffset, slicelength);
+	SET_VARSIZE(result, slicelength + VARHDRSZ);
+
+	return result;
+}
+
+
+/* ----------
+ * toast_get_compression_method -
+ *
+ *	Return the compression method to use for a column of a relation: its
+ *	"compression" attribute option if it has one, else the default.
+ * ----------
+ */
+static int
+toast_get_compression_method(Relation rel, AttrNumber attnum)
+{
+	AttributeOpts *aopts;
+	int			method = default_toast_compression;
+
+	aopts = get_attribute_options(RelationGetRelid(rel), attnum);
+	if (aopts != NULL)
+	{
+		if (aopts->compression_offset != 0)
+			method = toast_compression_method((char *) aopts +
+											  aopts->compression_offset);
+		pfree(aopts);
+	}
+
+	/* the option was validated when it was set, but be safe */
+	if (method < 0)
+		method = default_toast_compression;
+
+	return method;
+}
+
+
+/* ----------
+ * toast_compression_method -
+ *
+ *	Look up a compression method by name
+ * ----------
+ */
+int
+toast_compression_method(const char *name)
+{
+	if (strcmp(name, "pglz") == 0)
+		return TOAST_PGLZ_COMPRESSION;
+	if (strcmp(name, "lz4") == 0)
+		return TOAST_LZ4_COMPRESSION;
+	return -1;
+}
+
+
+/* ----------
+ * toast_validate_compression_option -
+ *
+ *	Check the value given for a column's "compression" option
+ * ----------
+ */
+void
+toast_validate_compression_option(char *value)
+{
+	if (value == NULL || toast_compression_method(value) < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for \"compression\" option"),
+				 errdetail("Valid values are \"pglz\" and \"lz4\".")));
+}
+
+
 /* ----------
  * toast_save_datum -
  *
@@ -1538,10 +2141,10 @@ toast_fetch_datum_slice(struct varlena * attr, int32 sliceoffset, int32 length)
 	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
 
 	/*
-	 * It's nonsense to fetch slices of a compressed datum -- this isn't lo_*
-	 * we can't return a compressed datum which is meaningful to toast later
+	 * A slice of compressed data is only meaningful if it's a prefix, which
+	 * can be used to decompress the start of the value.
 	 */
-	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
+	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) || sliceoffset == 0);
 
 	attrsize = toast_pointer.va_extsize;
 	totalchunks = ((attrsize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
@@ -11,30 +11,39 @@
  *	  $PostgreSQL$
  *
  * INTERFACE ROUTINES
- *		visibilitymap_clear - clear a bit in the visibility map
- *		visibilitymap_pin	- pin a map page for setting a bit
- *		visibilitymap_set	- set a bit in a previously pinned page
- *		visibilitymap_test	- test if a bit is set
+ *		visibilitymap_clear - clear bits in the visibility map
+ *		visibilitymap_pin	- pin a map page for setting bits
+ *		visibilitymap_set	- set bits in a previously pinned page
+ *		visibilitymap_test	- test if the all-visible bit is set
+ *		visibilitymap_get_status - get the bits for a heap page
  *
  * NOTES
  *
- * The visibility map is a bitmap with one bit per heap page. A set bit means
- * that all tuples on the page are known visible to all transactions, and
- * therefore the page doesn't need to be vacuumed. The map is conservative in
- * the sense that we make sure that whenever a bit is set, we know the
- * condition is true, but if a bit is not set, it might or might not be true.
+ * The visibility map is a bitmap with two bits per heap page. The
+ * all-visible bit means that all tuples on the page are known visible to
+ * all transactions, and therefore the page doesn't need to be vacuumed.
+ * The all-frozen bit, which is only ever set together with the all-visible
+ * bit, means that in addition all tuples on the page are frozen, so that
+ * even an anti-wraparound vacuum doesn't need to visit the page. The map
+ * is conservative in the sense that we make sure that whenever a bit is
+ * set, we know the condition is true, but if a bit is not set, it might or
+ * might not be true.
  *
  * There's no explicit WAL logging in the functions in this file. The callers
  * must make sure that whenever a bit is cleared, the bit is cleared on WAL
- * replay of the updating operation as well. Setting bits during recovery
- * isn't necessary for correctness.
+ * replay of the updating operation as well. Setting the all-visible bit
+ * alone during recovery isn't necessary for correctness; VACUUM WAL-logs
+ * setting the all-frozen bit (see log_heap_visible), because that bit is
+ * trusted by anti-wraparound vacuums.
  *
- * Currently, the visibility map is only used as a hint, to speed up VACUUM.
- * A corrupted visibility map won't cause data corruption, although it can
+ * The all-visible bit is only used as a hint, to speed up VACUUM. A
+ * corrupted all-visible bit won't cause data corruption, although it can
  * make VACUUM skip pages that need vacuuming, until the next anti-wraparound
- * vacuum. The visibility map is not used for anti-wraparound vacuums, because
- * an anti-wraparound vacuum needs to freeze tuples and observe the latest xid
- * present in the table, even on pages that don't have any dead tuples.
+ * vacuum. The all-frozen bit is different: anti-wraparound vacuums skip
+ * pages that have it set, and still advance relfrozenxid, so a wrongly set
+ * all-frozen bit could leave unfrozen xids behind in the table.  Any change
+ * that puts an xid on the page clears it: inserts, updates and deletes
+ * clear both bits, and row locks clear the all-frozen bit.
  *
  * Although the visibility map is just a hint at the moment, the PD_ALL_VISIBLE
  * flag on heap pages *must* be correct, because it is used to skip visibility
@@ -106,10 +115,10 @@
 #define MAPSIZE (BLCKSZ - MAXALIGN(SizeOfPageHeaderData))
 
 /* Number of bits allocated for each heap block. */
-#define BITS_PER_HEAPBLOCK 1
+#define BITS_PER_HEAPBLOCK 2
 
 /* Number of heap blocks we can represent in one byte. */
-#define HEAPBLOCKS_PER_BYTE 8
+#define HEAPBLOCKS_PER_BYTE (BITS_PER_BYTE / BITS_PER_HEAPBLOCK)
 
 /* Number of heap blocks we can represent in one visibility map page. */
 #define HEAPBLOCKS_PER_PAGE (MAPSIZE * HEAPBLOCKS_PER_BYTE)
@@ -117,7 +126,7 @@
 /* Mapping from heap block number to the right bit in the visibility map */
 #define HEAPBLK_TO_MAPBLOCK(x) ((x) / HEAPBLOCKS_PER_PAGE)
 #define HEAPBLK_TO_MAPBYTE(x) (((x) % HEAPBLOCKS_PER_PAGE) / HEAPBLOCKS_PER_BYTE)
-#define HEAPBLK_TO_MAPBIT(x) ((x) % HEAPBLOCKS_PER_BYTE)
+#define HEAPBLK_TO_OFFSET(x) (((x) % HEAPBLOCKS_PER_BYTE) * BITS_PER_HEAPBLOCK)
 
 /* prototypes for internal routines */
 static Buffer vm_readbuf(Relation rel, BlockNumber blkno, bool extend);
@@ -125,25 +134,33 @@ static void vm_extend(Relation rel, BlockNumber nvmblocks);
 
 
 /*
- *	visibilitymap_clear - clear a bit in visibility map
+ *	visibilitymap_clear - clear bits in visibility map
  *
- * Clear a bit in the visibility map, marking that not all tuples are
- * visible to all transactions anymore.
+ * Clear the given flag bits in the visibility map.  Clearing
+ * VISIBILITYMAP_ALL_VISIBLE marks that not all tuples are visible to all
+ * transactions anymore; since a page that isn't all-visible can't be
+ * all-frozen either, that clears VISIBILITYMAP_ALL_FROZEN as well.
  */
 void
-visibilitymap_clear(Relation rel, BlockNumber heapBlk)
+visibilitymap_clear(Relation rel, BlockNumber heapBlk, uint8 flags)
 {
 	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
 	int			mapByte = HEAPBLK_TO_MAPBYTE(heapBlk);
-	int			mapBit = HEAPBLK_TO_MAPBIT(heapBlk);
-	uint8		mask = 1 << mapBit;
+	int			mapOffset = HEAPBLK_TO_OFFSET(heapBlk);
+	uint8		mask;
 	Buffer		mapBuffer;
 	char	   *map;
 
 #ifdef TRACE_VISIBILITYMAP
-	elog(DEBUG1, "vm_clear %s %d", RelationGetRelationName(rel), heapBlk);
+	elog(DEBUG1, "vm_clear %s %d %u", RelationGetRelationName(rel), heapBlk,
+		 flags);
 #endif
 
+	Assert((flags & ~VISIBILITYMAP_VALID_BITS) == 0);
+	if (flags & VISIBILITYMAP_ALL_VISIBLE)
+		flags |= VISIBILITYMAP_ALL_FROZEN;
+	mask = flags << mapOffset;
+
 	mapBuffer = vm_readbuf(rel, mapBlock, false);
 	if (!BufferIsValid(mapBuffer))
 		return;					/* nothing to do */
@@ -162,7 +179,7 @@ visibilitymap_clear(Relation rel, BlockNumber heapBlk)
 }
 
 /*
- *	visibilitymap_pin - pin a map page for setting a bit
+ *	visibilitymap_pin - pin a map page for setting bits
  *
  * Setting a bit in the visibility map is a two-phase operation. First, call
  * visibilitymap_pin, to pin the visibility map page containing the bit for
@@ -194,30 +211,38 @@ visibilitymap_pin(Relation rel, BlockNumber heapBlk, Buffer *buf)
 }
 
 /*
- *	visibilitymap_set - set a bit on a previously pinned page
+ *	visibilitymap_set - set bits on a previously pinned page
+ *
+ * flags is VISIBILITYMAP_ALL_VISIBLE, possibly ORed with
+ * VISIBILITYMAP_ALL_FROZEN.  Bits already set are left alone.
  *
- * recptr is the LSN of the heap page. The LSN of the visibility map page is
- * advanced to that, to make sure that the visibility map doesn't get flushed
- * to disk before the update to the heap page that made all tuples visible.
+ * recptr is the LSN of the heap page, or of the WAL record that logged
+ * setting the bits. The LSN of the visibility map page is advanced to that,
+ * to make sure that the visibility map doesn't get flushed to disk before
+ * the update to the heap page that made all tuples visible.
  *
  * This is an opportunistic function. It does nothing, unless *buf
- * contains the bit for heapBlk. Call visibilitymap_pin first to pin
+ * contains the bits for heapBlk. Call visibilitymap_pin first to pin
  * the right map page. This function doesn't do any I/O.
  */
 void
 visibilitymap_set(Relation rel, BlockNumber heapBlk, XLogRecPtr recptr,
-				  Buffer *buf)
+				  Buffer *buf, uint8 flags)
 {
 	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
 	uint32		mapByte = HEAPBLK_TO_MAPBYTE(heapBlk);
-	uint8		mapBit = HEAPBLK_TO_MAPBIT(heapBlk);
+	uint8		mapOffset = HEAPBLK_TO_OFFSET(heapBlk);
 	Page		page;
 	char	   *map;
 
 #ifdef TRACE_VISIBILITYMAP
-	elog(DEBUG1, "vm_set %s %d", RelationGetRelationName(rel), heapBlk);
+	elog(DEBUG1, "vm_set %s %d %u", RelationGetRelationName(rel), heapBlk,
+		 flags);
 #endif
 
+	Assert(flags & VISIBILITYMAP_ALL_VISIBLE);
+	Assert((flags & ~VISIBILITYMAP_VALID_BITS) == 0);
+
 	/* Check that we have the right page pinned */
 	if (!BufferIsValid(*buf) || BufferGetBlockNumber(*buf) != mapBlock)
 		return;
@@ -226,9 +251,9 @@ visibilitymap_set(Relation rel, BlockNumber heapBlk, XLogRecPtr recptr,
 	map = PageGetContents(page);
 	LockBuffer(*buf, BUFFER_LOCK_EXCLUSIVE);
 
-	if (!(map[mapByte] & (1 << mapBit)))
+	if (flags != ((map[mapByte] >> mapOffset) & flags))
 	{
-		map[mapByte] |= (1 << mapBit);
+		map[mapByte] |= (flags << mapOffset);
 
 		if (XLByteLT(PageGetLSN(page), recptr))
 			PageSetLSN(page, recptr);
@@ -240,27 +265,41 @@ visibilitymap_set(Relation rel, BlockNumber heapBlk, XLogRecPtr recptr,
 }
 
 /*
- *	visibilitymap_test - test if a bit is set
+ *	visibilitymap_test - test if the all-visible bit is set
  *
  * Are all tuples on heapBlk visible to all, according to the visibility map?
  *
  * On entry, *buf should be InvalidBuffer or a valid buffer returned by an
- * earlier call to visibilitymap_pin or visibilitymap_test on the same
- * relation. On return, *buf is a valid buffer with the map page containing
- * the bit for heapBlk, or InvalidBuffer. The caller is responsible for
- * releasing *buf after it's done testing and setting bits.
+ * earlier call to visibilitymap_pin, visibilitymap_test or
+ * visibilitymap_get_status on the same relation. On return, *buf is a valid
+ * buffer with the map page containing the bits for heapBlk, or
+ * InvalidBuffer. The caller is responsible for releasing *buf after it's
+ * done testing and setting bits.
  */
 bool
 visibilitymap_test(Relation rel, BlockNumber heapBlk, Buffer *buf)
+{
+	return (visibilitymap_get_status(rel, heapBlk, buf) &
+			VISIBILITYMAP_ALL_VISIBLE) != 0;
+}
+
+/*
+ *	visibilitymap_get_status - get the visibility map bits for a heap page
+ *
+ * Returns the flag bits (VISIBILITYMAP_ALL_VISIBLE etc.) currently set for
+ * heapBlk.  *buf is handled the same way as in visibilitymap_test.
+ */
+uint8
+visibilitymap_get_status(Relation rel, BlockNumber heapBlk, Buffer *buf)
 {
 	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
 	uint32		mapByte = HEAPBLK_TO_MAPBYTE(heapBlk);
-	uint8		mapBit = HEAPBLK_TO_MAPBIT(heapBlk);
-	bool		result;
+	uint8		mapOffset = HEAPBLK_TO_OFFSET(heapBlk);
+	uint8		result;
 	char	   *map;
 
 #ifdef TRACE_VISIBILITYMAP
-	elog(DEBUG1, "vm_test %s %d", RelationGetRelationName(rel), heapBlk);
+	elog(DEBUG1, "vm_get_status %s %d", RelationGetRelationName(rel), heapBlk);
 #endif
 
 	/* Reuse the old pinned buffer if possible */
@@ -277,15 +316,16 @@ visibilitymap_test(Relation rel, BlockNumber heapBlk, Buffer *buf)
 	{
 		*buf = vm_readbuf(rel, mapBlock, false);
 		if (!BufferIsValid(*buf))
-			return false;
+			return 0;
 	}
 
 	map = PageGetContents(BufferGetPage(*buf));
 
 	/*
-	 * We don't need to lock the page, as we're only looking at a single bit.
+	 * We don't need to lock the page, as we're only looking at a single
+	 * byte, which is read atomically.
 	 */
-	result = (map[mapByte] & (1 << mapBit)) ? true : false;
+	result = ((map[mapByte] >> mapOffset) & VISIBILITYMAP_VALID_BITS);
 
 	return result;
 }
@@ -304,10 +344,10 @@ visibilitymap_truncate(Relation rel, BlockNumber nheapblocks)
 {
 	BlockNumber newnblocks;
 
-	/* last remaining block, byte, and bit */
+	/* last remaining block, byte, and bits */
 	BlockNumber truncBlock = HEAPBLK_TO_MAPBLOCK(nheapblocks);
 	uint32		truncByte = HEAPBLK_TO_MAPBYTE(nheapblocks);
-	uint8		truncBit = HEAPBLK_TO_MAPBIT(nheapblocks);
+	uint8		truncOffset = HEAPBLK_TO_OFFSET(nheapblocks);
 
 #ifdef TRACE_VISIBILITYMAP
 	elog(DEBUG1, "vm_truncate %s %d", RelationGetRelationName(rel), nheapblocks);
@@ -329,7 +369,7 @@ visibilitymap_truncate(Relation rel, BlockNumber nheapblocks)
 	 * because we don't get a chance to clear the bits if the heap is extended
 	 * again.
 	 */
-	if (truncByte != 0 || truncBit != 0)
+	if (truncByte != 0 || truncOffset != 0)
 	{
 		Buffer		mapBuffer;
 		Page		page;
@@ -355,10 +395,10 @@ visibilitymap_truncate(Relation rel, BlockNumber nheapblocks)
 		/*
 		 * Mask out the unwanted bits of the last remaining byte.
 		 *
-		 * ((1 << 0) - 1) = 00000000 ((1 << 1) - 1) = 00000001 ... ((1 << 6) -
-		 * 1) = 00111111 ((1 << 7) - 1) = 01111111
+		 * ((1 << 0) - 1) = 00000000 ((1 << 2) - 1) = 00000011 ((1 << 4) -
+		 * 1) = 00001111 ((1 << 6) - 1) = 00111111
 		 */
-		map[truncByte] &= (1 << truncBit) - 1;
+		map[truncByte] &= (1 << truncOffset) - 1;
 
 		MarkBufferDirty(mapBuffer);
 		UnlockReleaseBuffer(mapBuffer);
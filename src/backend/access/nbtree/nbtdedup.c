@@ -0,0 +1,358 @@
+/*-------------------------------------------------------------------------
+ *
+ * nbtdedup.c
+ *	  Deduplication of btree leaf items into posting list tuples.
+ *
+ * When a leaf page is about to be split, we first try to make room by
+ * merging runs of items with identical keys into posting list tuples,
+ * which store the key only once.  This makes indexes on low-cardinality
+ * columns much smaller.  Index builds produce posting list tuples directly
+ * (see nbtsort.c).  See the comments in nbtree.h for the tuple format.
+ *
+ * We consider two keys equal for this purpose only if their stored
+ * representations are bitwise identical.  That is stricter than opclass
+ * equality, but it is cheap to test and never merges values that the
+ * opclass could tell apart.
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/nbtree.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "utils/rel.h"
+
+
+static int	_bt_itemptr_cmp(const void *a, const void *b);
+
+
+/*
+ *	_bt_dedup_one_page() -- Merge duplicate items on a leaf page.
+ *
+ *		The caller must hold an exclusive lock on buf, which must be a leaf
+ *		page.  Runs of adjacent items with identical keys are replaced by
+ *		posting list tuples, as long as the result stays within
+ *		BTMaxPostingSize.  Items marked LP_DEAD are left alone.
+ *
+ *		Returns true if the page was changed.  Note that item offsets on the
+ *		page change when that happens, so any saved insert location is
+ *		invalid afterwards.
+ */
+bool
+_bt_dedup_one_page(Relation rel, Buffer buf)
+{
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	Size		maxpostingsize = BTMaxPostingSize(page);
+	BTDedupInterval intervals[MaxIndexTuplesPerPage];
+	int			nintervals = 0;
+	IndexTuple	base = NULL;
+	OffsetNumber baseoff = InvalidOffsetNumber;
+	Size		basekeysize = 0;
+	int			nitems = 0;
+	int			nhtids = 0;
+	OffsetNumber offnum,
+				minoff,
+				maxoff;
+	Page		newpage;
+
+	Assert(P_ISLEAF(opaque));
+
+	/*
+	 * Find the runs of items to merge.
+	 */
+	minoff = P_FIRSTDATAKEY(opaque);
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = minoff; offnum <= maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+
+		if (base != NULL && !ItemIdIsDead(itemid) &&
+			_bt_keys_identical(base, itup) &&
+			MAXALIGN(basekeysize + (nhtids + BTreeTupleGetNHeapTids(itup)) *
+					 sizeof(ItemPointerData)) <= maxpostingsize)
+		{
+			/* itup can join the current run */
+			nitems++;
+			nhtids += BTreeTupleGetNHeapTids(itup);
+			continue;
+		}
+
+		/* Close out the current run, if it's worth merging */
+		if (nitems > 1)
+		{
+			intervals[nintervals].baseoff = baseoff;
+			intervals[nintervals].nitems = nitems;
+			nintervals++;
+		}
+
+		/* Start a new run at itup, unless it's dead */
+		if (ItemIdIsDead(itemid))
+		{
+			base = NULL;
+			nitems = 0;
+		}
+		else
+		{
+			base = itup;
+			baseoff = offnum;
+			basekeysize = BTreeTupleGetKeySize(itup);
+			nitems = 1;
+			nhtids = BTreeTupleGetNHeapTids(itup);
+		}
+	}
+	if (nitems > 1)
+	{
+		intervals[nintervals].baseoff = baseoff;
+		intervals[nintervals].nitems = nitems;
+		nintervals++;
+	}
+
+	if (nintervals == 0)
+		return false;
+
+	/* Build the new page contents before entering the critical section */
+	newpage = _bt_dedup_page(page, intervals, nintervals);
+
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+	MarkBufferDirty(buf);
+
+	/* XLOG stuff */
+	if (!rel->rd_istemp)
+	{
+		xl_btree_dedup xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+
+		xlrec.node = rel->rd_node;
+		xlrec.block = BufferGetBlockNumber(buf);
+		xlrec.nintervals = nintervals;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfBtreeDedup;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		/*
+		 * The intervals array is not in the buffer, but pretend that it is.
+		 * When XLogInsert stores the whole buffer, the array need not be
+		 * stored too.
+		 */
+		rdata[1].data = (char *) intervals;
+		rdata[1].len = nintervals * sizeof(BTDedupInterval);
+		rdata[1].buffer = buf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_DEDUP, rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetTLI(page, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	return true;
+}
+
+/*
+ *	_bt_dedup_page() -- Build a deduplicated copy of a leaf page.
+ *
+ *		Returns a temporary page, in the format of PageGetTempPage, holding
+ *		the contents of page with each of the given runs of items replaced
+ *		by one posting list tuple.  The caller is expected to install it
+ *		with PageRestoreTempPage.  This is shared by _bt_dedup_one_page and
+ *		WAL replay, so both produce the same page.
+ */
+Page
+_bt_dedup_page(Page page, BTDedupInterval *intervals, int nintervals)
+{
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	Page		newpage;
+	ItemPointer htids;
+	OffsetNumber offnum,
+				maxoff;
+	int			i = 0;
+
+	newpage = PageGetTempPageCopySpecial(page);
+
+	/*
+	 * Copy the original page's LSN and TLI into the new page, so that
+	 * XLogInsert sees the right values when deciding whether to dump a full
+	 * page image.
+	 */
+	PageSetLSN(newpage, PageGetLSN(page));
+	PageSetTLI(newpage, PageGetTLI(page));
+
+	htids = (ItemPointer) palloc(MaxBTreeTIDsPerPage * sizeof(ItemPointerData));
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	offnum = P_HIKEY;
+	while (offnum <= maxoff)
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+
+		if (i < nintervals && intervals[i].baseoff == offnum)
+		{
+			IndexTuple	posting;
+			int			nhtids = 0;
+			int			j;
+
+			Assert(offnum >= P_FIRSTDATAKEY(opaque));
+
+			/* Collect the heap TIDs of the whole run */
+			for (j = 0; j < intervals[i].nitems; j++)
+			{
+				IndexTuple	curitup;
+				int			k;
+
+				curitup = (IndexTuple)
+					PageGetItem(page, PageGetItemId(page, offnum + j));
+				for (k = 0; k < BTreeTupleGetNHeapTids(curitup); k++)
+					htids[nhtids++] = *BTreeTupleGetHeapTidN(curitup, k);
+			}
+
+			posting = _bt_form_posting(itup, htids, nhtids);
+			if (PageAddItem(newpage, (Item) posting, IndexTupleSize(posting),
+							InvalidOffsetNumber,
+							false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add posting list item to the index page");
+			pfree(posting);
+
+			offnum += intervals[i].nitems;
+			i++;
+		}
+		else
+		{
+			OffsetNumber newoff;
+
+			newoff = PageAddItem(newpage, (Item) itup, ItemIdGetLength(itemid),
+								 InvalidOffsetNumber, false, false);
+			if (newoff == InvalidOffsetNumber)
+				elog(ERROR, "failed to add item to the index page");
+			/* keep the LP_DEAD hint */
+			if (ItemIdIsDead(itemid))
+				ItemIdMarkDead(PageGetItemId(newpage, newoff));
+
+			offnum = OffsetNumberNext(offnum);
+		}
+	}
+	Assert(i == nintervals);
+
+	pfree(htids);
+
+	return newpage;
+}
+
+/*
+ *	_bt_keys_identical() -- Are the keys of two leaf items bitwise equal?
+ *
+ *		Either tuple may be a posting list tuple; only the key parts are
+ *		compared.
+ */
+bool
+_bt_keys_identical(IndexTuple itup1, IndexTuple itup2)
+{
+	Size		keysize = BTreeTupleGetKeySize(itup1);
+
+	if (BTreeTupleGetKeySize(itup2) != keysize)
+		return false;
+	if ((itup1->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)) !=
+		(itup2->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)))
+		return false;
+
+	return memcmp((char *) itup1 + sizeof(IndexTupleData),
+				  (char *) itup2 + sizeof(IndexTupleData),
+				  keysize - sizeof(IndexTupleData)) == 0;
+}
+
+/*
+ *	_bt_form_posting() -- Make a leaf item with base's key and given TIDs.
+ *
+ *		The htids array is sorted in place if it isn't in order already.
+ *		If there is just one heap TID, a plain tuple is returned; otherwise a
+ *		posting list tuple.  base may itself be a posting list tuple, whose
+ *		posting list is ignored.  The result is palloc'd.
+ */
+IndexTuple
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+{
+	Size		keysize = BTreeTupleGetKeySize(base);
+	Size		newsize;
+	IndexTuple	itup;
+
+	Assert(nhtids > 0);
+
+	if (nhtids > 1)
+	{
+		newsize = MAXALIGN(keysize + nhtids * sizeof(ItemPointerData));
+		qsort(htids, nhtids, sizeof(ItemPointerData), _bt_itemptr_cmp);
+	}
+	else
+		newsize = keysize;
+
+	itup = (IndexTuple) palloc0(newsize);
+	memcpy(itup, base, keysize);
+	itup->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+	itup->t_info |= newsize;
+
+	if (nhtids > 1)
+	{
+		Assert(nhtids <= BT_OFFSET_MASK);
+		BTreeTupleSetPosting(itup, nhtids, keysize);
+		memcpy(BTreeTupleGetPosting(itup), htids,
+			   nhtids * sizeof(ItemPointerData));
+	}
+	else
+		itup->t_tid = htids[0];
+
+	return itup;
+}
+
+/*
+ *	_bt_strip_posting() -- Make a plain copy of a posting list tuple's key.
+ *
+ *		This is used wherever a leaf item is copied to serve as a high key
+ *		or downlink, which only need the key.  The result is palloc'd and
+ *		points at the first heap TID of the posting list, just like the
+ *		first of the original items would have.
+ */
+IndexTuple
+_bt_strip_posting(IndexTuple itup)
+{
+	Size		keysize = BTreeTupleGetPostingOffset(itup);
+	IndexTuple	result;
+
+	Assert(BTreeTupleIsPosting(itup));
+
+	result = (IndexTuple) palloc(keysize);
+	memcpy(result, itup, keysize);
+	result->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+	result->t_info |= keysize;
+	result->t_tid = *BTreeTupleGetPostingN(itup, 0);
+
+	return result;
+}
+
+/*
+ * qsort comparator for heap TIDs
+ */
+static int
+_bt_itemptr_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer) a, (ItemPointer) b);
+}
@@ -25,6 +25,14 @@
 #include "utils/tqual.h"
 
 
+/* A feasible split point, as remembered by _bt_checksplitloc */
+typedef struct
+{
+	OffsetNumber firstright;	/* first old item on right page */
+	bool		newitemonleft;	/* new item on left or right? */
+	int			delta;			/* size delta, as for best_delta */
+} SplitPoint;
+
 typedef struct
 {
 	/* context data for _bt_checksplitloc */
@@ -43,6 +51,10 @@ typedef struct
 	bool		newitemonleft;	/* new item on left or right of best split */
 	OffsetNumber firstright;	/* best split point */
 	int			best_delta;		/* best size delta so far */
+
+	/* all feasible split points, if we're collecting them (else NULL) */
+	SplitPoint *splits;
+	int			nsplits;
 } FindSplitData;
 
 
@@ -70,10 +82,13 @@ static Buffer _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 static OffsetNumber _bt_findsplitloc(Relation rel, Page page,
 				 OffsetNumber newitemoff,
 				 Size newitemsz,
+				 IndexTuple newitem,
 				 bool *newitemonleft);
 static void _bt_checksplitloc(FindSplitData *state,
 				  OffsetNumber firstoldonright, bool newitemonleft,
 				  int dataitemstoleft, Size firstoldonrightsz);
+static void _bt_shortsplitloc(Relation rel, Page page, FindSplitData *state,
+				  IndexTuple newitem, int tolerance);
 static bool _bt_pgaddtup(Page page, Size itemsize, IndexTuple itup,
 			 OffsetNumber itup_off);
 static bool _bt_isequal(TupleDesc itupdesc, Page page, OffsetNumber offnum,
@@ -220,6 +235,9 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 	BTPageOpaque opaque;
 	Buffer		nbuf = InvalidBuffer;
 	bool		found = false;
+	int			curposti = 0;
+	int			nposting = 0;
+	bool		posting_all_dead = true;
 
 	/* Assume unique until we find a duplicate */
 	*is_unique = true;
@@ -231,7 +249,9 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 	maxoff = PageGetMaxOffsetNumber(page);
 
 	/*
-	 * Scan over all equal tuples, looking for live conflicts.
+	 * Scan over all equal tuples, looking for live conflicts.  A posting
+	 * list tuple is visited once for each of its heap TIDs; curposti says
+	 * which one we're at.
 	 */
 	for (;;)
 	{
@@ -272,12 +292,22 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 				 * in real comparison, but only for ordering/finding items on
 				 * pages. - vadim 03/24/97
 				 */
-				if (!_bt_isequal(itupdesc, page, offset, natts, itup_scankey))
+				if (curposti == 0 &&
+					!_bt_isequal(itupdesc, page, offset, natts, itup_scankey))
 					break;		/* we're past all the equal tuples */
 
 				/* okay, we gotta fetch the heap tuple ... */
 				curitup = (IndexTuple) PageGetItem(page, curitemid);
-				htid = curitup->t_tid;
+				if (BTreeTupleIsPosting(curitup))
+				{
+					nposting = BTreeTupleGetNPosting(curitup);
+					htid = *BTreeTupleGetPostingN(curitup, curposti);
+				}
+				else
+				{
+					nposting = 0;
+					htid = curitup->t_tid;
+				}
 
 				/*
 				 * If we are doing a recheck, we expect to find the tuple we
@@ -288,6 +318,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 					ItemPointerCompare(&htid, &itup->t_tid) == 0)
 				{
 					found = true;
+					posting_all_dead = false;
 				}
 
 				/*
@@ -388,12 +419,15 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 														  values, isnull))));
 					}
 				}
-				else if (all_dead)
+				else if (all_dead &&
+						 (nposting == 0 ||
+						  (posting_all_dead && curposti == nposting - 1)))
 				{
 					/*
 					 * The conflicting tuple (or whole HOT chain) is dead to
 					 * everyone, so we may as well mark the index entry
-					 * killed.
+					 * killed.  For a posting list tuple, that's only allowed
+					 * once we've seen that all of its heap TIDs are dead.
 					 */
 					ItemIdMarkDead(curitemid);
 					opaque->btpo_flags |= BTP_HAS_GARBAGE;
@@ -403,12 +437,21 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 					else
 						SetBufferCommitInfoNeedsSave(buf);
 				}
+				else if (!all_dead)
+					posting_all_dead = false;
 			}
 		}
 
 		/*
-		 * Advance to next tuple to continue checking.
+		 * Advance to next heap TID of a posting list tuple, or else to next
+		 * tuple to continue checking.
 		 */
+		if (nposting > 0 && ++curposti < nposting)
+			continue;
+		curposti = 0;
+		nposting = 0;
+		posting_all_dead = true;
+
 		if (offset < maxoff)
 			offset = OffsetNumberNext(offset);
 		else
@@ -471,7 +514,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
  *		any existing equal keys because of the way _bt_binsrch() works.
  *
  *		If there's not enough room in the space, we try to make room by
- *		removing any LP_DEAD tuples.
+ *		removing any LP_DEAD tuples, and then by deduplicating the page.
  *
  *		On entry, *buf and *offsetptr point to the first legal position
  *		where the new tuple could be inserted.	The caller should hold an
@@ -569,6 +612,18 @@ _bt_findinsertloc(Relation rel,
 				break;			/* OK, now we have enough space */
 		}
 
+		/*
+		 * Next, try to obtain enough space by merging duplicate keys into
+		 * posting list tuples.  This also invalidates the caller's hint.
+		 */
+		if (P_ISLEAF(lpageop) && _bt_dedup_one_page(rel, buf))
+		{
+			vacuumed = true;
+
+			if (PageGetFreeSpace(page) >= itemsz)
+				break;			/* OK, now we have enough space */
+		}
+
 		/*
 		 * nope, so check conditions (b) and (c) enumerated above
 		 */
@@ -690,7 +745,7 @@ _bt_insertonpg(Relation rel,
 
 		/* Choose the split point */
 		firstright = _bt_findsplitloc(rel, page,
-									  newitemoff, itemsz,
+									  newitemoff, itemsz, itup,
 									  &newitemonleft);
 
 		/* split the buffer into left and right halves */
@@ -790,7 +845,8 @@ _bt_insertonpg(Relation rel,
 			else
 			{
 				xldownlink = ItemPointerGetBlockNumber(&(itup->t_tid));
-				Assert(ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
+				Assert(BTreeTupleIsTruncated(itup) ||
+					   ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
 
 				nextrdata->data = (char *) &xldownlink;
 				nextrdata->len = sizeof(BlockNumber);
@@ -994,6 +1050,34 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 		itemsz = ItemIdGetLength(itemid);
 		item = (IndexTuple) PageGetItem(origpage, itemid);
 	}
+
+	/*
+	 * On the leaf level, we don't need the whole first right key as the high
+	 * key, just enough of it to tell it apart from the last key that stays on
+	 * the left.  This also gets rid of any posting list.  The high key is
+	 * copied into the parent as the downlink for the right page, so keeping
+	 * it short keeps the upper levels of the tree small.  (On upper levels,
+	 * the first right key is a pivot tuple already.)
+	 */
+	if (P_ISLEAF(oopaque))
+	{
+		IndexTuple	lastleft;
+
+		if (newitemonleft && newitemoff == firstright)
+		{
+			/* incoming tuple will become last on left page */
+			lastleft = newitem;
+		}
+		else
+		{
+			Assert(firstright > P_FIRSTDATAKEY(oopaque));
+			itemid = PageGetItemId(origpage, OffsetNumberPrev(firstright));
+			lastleft = (IndexTuple) PageGetItem(origpage, itemid);
+		}
+
+		item = _bt_truncate(rel, lastleft, item);
+		itemsz = IndexTupleSize(item);
+	}
 	if (PageAddItem(leftpage, (Item) item, itemsz, leftoff,
 					false, false) == InvalidOffsetNumber)
 	{
@@ -1195,24 +1279,24 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 			lastrdata->data = (char *) &newitem->t_tid.ip_blkid;
 			lastrdata->len = sizeof(BlockIdData);
 			lastrdata->buffer = InvalidBuffer;
+		}
 
-			/*
-			 * We must also log the left page's high key, because the right
-			 * page's leftmost key is suppressed on non-leaf levels.  Show it
-			 * as belonging to the left page buffer, so that it is not stored
-			 * if XLogInsert decides it needs a full-page image of the left
-			 * page.
-			 */
-			lastrdata->next = lastrdata + 1;
-			lastrdata++;
+		/*
+		 * We must also log the left page's high key, because the right page's
+		 * leftmost key is suppressed on non-leaf levels, and on the leaf
+		 * level the high key is a truncated copy of it.  Show it as belonging
+		 * to the left page buffer, so that it is not stored if XLogInsert
+		 * decides it needs a full-page image of the left page.
+		 */
+		lastrdata->next = lastrdata + 1;
+		lastrdata++;
 
-			itemid = PageGetItemId(origpage, P_HIKEY);
-			item = (IndexTuple) PageGetItem(origpage, itemid);
-			lastrdata->data = (char *) item;
-			lastrdata->len = MAXALIGN(IndexTupleSize(item));
-			lastrdata->buffer = buf;	/* backup block 1 */
-			lastrdata->buffer_std = true;
-		}
+		itemid = PageGetItemId(origpage, P_HIKEY);
+		item = (IndexTuple) PageGetItem(origpage, itemid);
+		lastrdata->data = (char *) item;
+		lastrdata->len = MAXALIGN(IndexTupleSize(item));
+		lastrdata->buffer = buf;	/* backup block 1 */
+		lastrdata->buffer_std = true;
 
 		/*
 		 * Log the new item and its offset, if it was inserted on the left
@@ -1240,22 +1324,6 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 			lastrdata->buffer = buf;	/* backup block 1 */
 			lastrdata->buffer_std = true;
 		}
-		else if (ropaque->btpo.level == 0)
-		{
-			/*
-			 * Although we don't need to WAL-log the new item, we still need
-			 * XLogInsert to consider storing a full-page image of the left
-			 * page, so make an empty entry referencing that buffer. This also
-			 * ensures that the left page is always backup block 1.
-			 */
-			lastrdata->next = lastrdata + 1;
-			lastrdata++;
-
-			lastrdata->data = NULL;
-			lastrdata->len = 0;
-			lastrdata->buffer = buf;	/* backup block 1 */
-			lastrdata->buffer_std = true;
-		}
 
 		/*
 		 * Log the contents of the right page in the format understood by
@@ -1336,6 +1404,13 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
  * This is the same as nbtsort.c produces for a newly-created tree.  Note
  * that leaf and nonleaf pages use different fillfactors.
  *
+ * On leaf pages of multi-column indexes, the left page's new high key is
+ * truncated to the attributes needed to separate the two halves (see
+ * _bt_truncate), and that key also becomes the downlink in the parent.  So
+ * among the split points that are nearly as good as the best one, we prefer
+ * one where the last left and first right items differ in as early an
+ * attribute as possible, to keep the upper levels of the tree small.
+ *
  * We are passed the intended insert position of the new tuple, expressed as
  * the offsetnumber of the tuple it must go in front of.  (This could be
  * maxoff+1 if the tuple is to go at the end.)
@@ -1350,6 +1425,7 @@ _bt_findsplitloc(Relation rel,
 				 Page page,
 				 OffsetNumber newitemoff,
 				 Size newitemsz,
+				 IndexTuple newitem,
 				 bool *newitemonleft)
 {
 	BTPageOpaque opaque;
@@ -1401,6 +1477,18 @@ _bt_findsplitloc(Relation rel,
 	state.rightspace = rightspace;
 	state.olddataitemstotal = olddataitemstotal;
 	state.newitemoff = newitemoff;
+	maxoff = PageGetMaxOffsetNumber(page);
+
+	/*
+	 * If the new high key could be truncated, remember every feasible split
+	 * point, so that we can look for one that allows a shorter high key.
+	 */
+	if (state.is_leaf && RelationGetNumberOfAttributes(rel) > 1)
+		state.splits = (SplitPoint *)
+			palloc(2 * (maxoff + 1) * sizeof(SplitPoint));
+	else
+		state.splits = NULL;
+	state.nsplits = 0;
 
 	/*
 	 * Finding the best possible split would require checking all the possible
@@ -1409,7 +1497,8 @@ _bt_findsplitloc(Relation rel,
 	 * find a "good-enough" split, where good-enough is defined as an
 	 * imbalance in free space of no more than pagesize/16 (arbitrary...) This
 	 * should let us stop near the middle on most pages, instead of plowing to
-	 * the end.
+	 * the end.  When we're collecting split points for truncation, though,
+	 * we have to look at all of them.
 	 */
 	goodenough = leftspace / 16;
 
@@ -1419,7 +1508,6 @@ _bt_findsplitloc(Relation rel,
 	 */
 	olddataitemstoleft = 0;
 	goodenoughfound = false;
-	maxoff = PageGetMaxOffsetNumber(page);
 
 	for (offnum = P_FIRSTDATAKEY(opaque);
 		 offnum <= maxoff;
@@ -1451,7 +1539,8 @@ _bt_findsplitloc(Relation rel,
 		}
 
 		/* Abort scan once we find a good-enough choice */
-		if (state.have_split && state.best_delta <= goodenough)
+		if (state.have_split && state.best_delta <= goodenough &&
+			state.splits == NULL)
 		{
 			goodenoughfound = true;
 			break;
@@ -1476,6 +1565,18 @@ _bt_findsplitloc(Relation rel,
 		elog(ERROR, "could not find a feasible split point for index \"%s\"",
 			 RelationGetRelationName(rel));
 
+	/*
+	 * Now look for a short high key among the split points whose delta is
+	 * within goodenough of the best one.  On a rightmost page, delta is
+	 * weighted by percentages, so scale the tolerance accordingly.
+	 */
+	if (state.splits != NULL)
+	{
+		_bt_shortsplitloc(rel, page, &state, newitem,
+						  state.is_rightmost ? goodenough * 100 : goodenough);
+		pfree(state.splits);
+	}
+
 	*newitemonleft = state.newitemonleft;
 	return state.firstright;
 }
@@ -1570,6 +1671,63 @@ _bt_checksplitloc(FindSplitData *state,
 			state->firstright = firstoldonright;
 			state->best_delta = delta;
 		}
+		if (state->splits != NULL)
+		{
+			SplitPoint *split = &state->splits[state->nsplits++];
+
+			split->firstright = firstoldonright;
+			split->newitemonleft = newitemonleft;
+			split->delta = delta;
+		}
+	}
+}
+
+/*
+ * Subroutine to pick the split point that allows the shortest high key for
+ * the left page, among the split points remembered in *state whose delta is
+ * at most tolerance worse than the best one.  Ties go to the split point
+ * with the smaller delta.  The choice is stored back into *state.
+ */
+static void
+_bt_shortsplitloc(Relation rel, Page page, FindSplitData *state,
+				  IndexTuple newitem, int tolerance)
+{
+	int			best_natts = INDEX_MAX_KEYS + 1;
+	int			best_delta = 0;
+	int			i;
+
+	for (i = 0; i < state->nsplits; i++)
+	{
+		SplitPoint *split = &state->splits[i];
+		IndexTuple	lastleft;
+		IndexTuple	firstright;
+		int			keepnatts;
+
+		if (split->delta > state->best_delta + tolerance)
+			continue;
+
+		/* Identify the items on either side of this split point */
+		if (split->newitemonleft && split->firstright == state->newitemoff)
+			lastleft = newitem;
+		else
+			lastleft = (IndexTuple)
+				PageGetItem(page, PageGetItemId(page,
+											OffsetNumberPrev(split->firstright)));
+		if (!split->newitemonleft && split->firstright == state->newitemoff)
+			firstright = newitem;
+		else
+			firstright = (IndexTuple)
+				PageGetItem(page, PageGetItemId(page, split->firstright));
+
+		keepnatts = _bt_keep_natts(rel, lastleft, firstright);
+		if (keepnatts < best_natts ||
+			(keepnatts == best_natts && split->delta < best_delta))
+		{
+			best_natts = keepnatts;
+			best_delta = split->delta;
+			state->newitemonleft = split->newitemonleft;
+			state->firstright = split->firstright;
+		}
 	}
 }
 
@@ -1658,7 +1816,7 @@ _bt_insert_parent(Relation rel,
 
 		/* form an index tuple that points at the new right page */
 		new_item = CopyIndexTuple(ritem);
-		ItemPointerSet(&(new_item->t_tid), rbknum, P_HIKEY);
+		BTreeTupleSetDownLink(new_item, rbknum);
 
 		/*
 		 * Find the parent buffer and get the parent page.
@@ -1898,7 +2056,7 @@ _bt_newroot(Relation rel, Buffer lbuf, Buffer rbuf)
 	itemsz = ItemIdGetLength(itemid);
 	item = (IndexTuple) PageGetItem(lpage, itemid);
 	new_item = CopyIndexTuple(item);
-	ItemPointerSet(&(new_item->t_tid), rbkno, P_HIKEY);
+	BTreeTupleSetDownLink(new_item, rbkno);
 
 	/*
 	 * insert the right page pointer into the new root page.
@@ -2016,6 +2174,13 @@ _bt_isequal(TupleDesc itupdesc, Page page, OffsetNumber offnum,
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
 
+	/*
+	 * A truncated high key is strictly greater than every item on its page,
+	 * so it can't equal a full key that belongs there.
+	 */
+	if (BTreeTupleIsTruncated(itup))
+		return false;
+
 	for (i = 1; i <= keysz; i++)
 	{
 		AttrNumber	attno;
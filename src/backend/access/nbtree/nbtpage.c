@@ -708,6 +708,11 @@ _bt_page_recyclable(Page page)
  * This routine assumes that the caller has pinned and locked the buffer.
  * Also, the given itemnos *must* appear in increasing order in the array.
  *
+ * VACUUM can also remove just some of the heap TIDs of a posting list tuple.
+ * Each such tuple at updatenos[i] is replaced by updated[i], which has the
+ * same key and the surviving TIDs.  The replacement is never larger than the
+ * original, so it always fits.
+ *
  * We record VACUUMs and b-tree deletes differently in WAL. InHotStandby
  * we need to be able to pin all of the blocks in the btree in physical
  * order when replaying the effects of a VACUUM, just as we do for the
@@ -720,15 +725,51 @@ _bt_page_recyclable(Page page)
  */
 void
 _bt_delitems_vacuum(Relation rel, Buffer buf,
-			OffsetNumber *itemnos, int nitems, BlockNumber lastBlockVacuumed)
+					OffsetNumber *itemnos, int nitems,
+					OffsetNumber *updatenos, IndexTuple *updated,
+					int nupdated, BlockNumber lastBlockVacuumed)
 {
 	Page		page = BufferGetPage(buf);
 	BTPageOpaque opaque;
+	char	   *updatedbuf = NULL;
+	Size		updatedlen = 0;
+	int			i;
+
+	/*
+	 * Flatten the replacement tuples into one chunk for the WAL record; do
+	 * this before entering the critical section.
+	 */
+	if (nupdated > 0 && !rel->rd_istemp)
+	{
+		for (i = 0; i < nupdated; i++)
+			updatedlen += MAXALIGN(IndexTupleSize(updated[i]));
+		updatedbuf = palloc(updatedlen);
+		updatedlen = 0;
+		for (i = 0; i < nupdated; i++)
+		{
+			Size		itemsz = MAXALIGN(IndexTupleSize(updated[i]));
+
+			memcpy(updatedbuf + updatedlen, updated[i], itemsz);
+			updatedlen += itemsz;
+		}
+	}
 
 	/* No ereport(ERROR) until changes are logged */
 	START_CRIT_SECTION();
 
-	/* Fix the page */
+	/*
+	 * Fix the page.  Replace the shrunken posting list tuples first, while
+	 * the item numbers are still valid.
+	 */
+	for (i = 0; i < nupdated; i++)
+	{
+		PageIndexTupleDelete(page, updatenos[i]);
+		if (PageAddItem(page, (Item) updated[i],
+						MAXALIGN(IndexTupleSize(updated[i])), updatenos[i],
+						false, false) == InvalidOffsetNumber)
+			elog(PANIC, "failed to add updated posting list item to block %u in index \"%s\"",
+				 BufferGetBlockNumber(buf), RelationGetRelationName(rel));
+	}
 	if (nitems > 0)
 		PageIndexMultiDelete(page, itemnos, nitems);
 
@@ -754,7 +795,7 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	if (!rel->rd_istemp)
 	{
 		XLogRecPtr	recptr;
-		XLogRecData rdata[2];
+		XLogRecData rdata[4];
 
 		xl_btree_vacuum xlrec_vacuum;
 
@@ -762,6 +803,8 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		xlrec_vacuum.block = BufferGetBlockNumber(buf);
 
 		xlrec_vacuum.lastBlockVacuumed = lastBlockVacuumed;
+		xlrec_vacuum.ndeleted = nitems;
+		xlrec_vacuum.nupdated = nupdated;
 		rdata[0].data = (char *) &xlrec_vacuum;
 		rdata[0].len = SizeOfBtreeVacuum;
 		rdata[0].buffer = InvalidBuffer;
@@ -770,7 +813,7 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		/*
 		 * The target-offsets array is not in the buffer, but pretend that it
 		 * is.	When XLogInsert stores the whole buffer, the offsets array
-		 * need not be stored too.
+		 * need not be stored too.  Likewise for the updated tuples.
 		 */
 		if (nitems > 0)
 		{
@@ -784,7 +827,27 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		}
 		rdata[1].buffer = buf;
 		rdata[1].buffer_std = true;
-		rdata[1].next = NULL;
+		rdata[1].next = &(rdata[2]);
+
+		if (nupdated > 0)
+		{
+			rdata[2].data = (char *) updatenos;
+			rdata[2].len = nupdated * sizeof(OffsetNumber);
+		}
+		else
+		{
+			rdata[2].data = NULL;
+			rdata[2].len = 0;
+		}
+		rdata[2].buffer = buf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = &(rdata[3]);
+
+		rdata[3].data = updatedbuf;
+		rdata[3].len = updatedlen;
+		rdata[3].buffer = buf;
+		rdata[3].buffer_std = true;
+		rdata[3].next = NULL;
 
 		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_VACUUM, rdata);
 
@@ -793,6 +856,8 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	}
 
 	END_CRIT_SECTION();
+	if (updatedbuf != NULL)
+		pfree(updatedbuf);
 }
 
 void
@@ -1055,8 +1120,8 @@ _bt_pagedel(Relation rel, Buffer buf, BTStack stack)
 			/* we need an insertion scan key to do our search, so build one */
 			itup_scankey = _bt_mkscankey(rel, targetkey);
 			/* find the leftmost leaf page containing this key */
-			stack = _bt_search(rel, rel->rd_rel->relnatts, itup_scankey, false,
-							   &lbuf, BT_READ);
+			stack = _bt_search(rel, BTreeTupleGetNAtts(targetkey, rel),
+							   itup_scankey, false, &lbuf, BT_READ);
 			/* don't need a pin on that either */
 			_bt_relbuf(rel, lbuf);
 
@@ -1315,7 +1380,7 @@ _bt_pagedel(Relation rel, Buffer buf, BTStack stack)
 
 		itemid = PageGetItemId(page, poffset);
 		itup = (IndexTuple) PageGetItem(page, itemid);
-		ItemPointerSet(&(itup->t_tid), rightsib, P_HIKEY);
+		BTreeTupleSetDownLink(itup, rightsib);
 
 		nextoffset = OffsetNumberNext(poffset);
 		PageIndexTupleDelete(page, nextoffset);
@@ -75,6 +75,8 @@ static void btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 			 BTCycleId cycleid);
 static void btvacuumpage(BTVacState *vstate, BlockNumber blkno,
 			 BlockNumber orig_blkno);
+static IndexTuple btvacuumposting(BTVacState *vstate, IndexTuple posting,
+				int *nremaining);
 
 
 /*
@@ -269,8 +271,8 @@ btgettuple(PG_FUNCTION_ARGS)
 			 */
 			if (so->killedItems == NULL)
 				so->killedItems = (int *)
-					palloc(MaxIndexTuplesPerPage * sizeof(int));
-			if (so->numKilled < MaxIndexTuplesPerPage)
+					palloc(MaxBTreeTIDsPerPage * sizeof(int));
+			if (so->numKilled < MaxBTreeTIDsPerPage)
 				so->killedItems[so->numKilled++] = so->currPos.itemIndex;
 		}
 
@@ -708,7 +710,8 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 		buf = ReadBufferExtended(rel, MAIN_FORKNUM, num_pages - 1, RBM_NORMAL,
 								 info->strategy);
 		LockBufferForCleanup(buf);
-		_bt_delitems_vacuum(rel, buf, NULL, 0, vstate.lastBlockVacuumed);
+		_bt_delitems_vacuum(rel, buf, NULL, 0, NULL, NULL, 0,
+							vstate.lastBlockVacuumed);
 		_bt_relbuf(rel, buf);
 	}
 
@@ -808,6 +811,10 @@ restart:
 	{
 		OffsetNumber deletable[MaxOffsetNumber];
 		int			ndeletable;
+		OffsetNumber updatable[MaxOffsetNumber];
+		IndexTuple	updated[MaxOffsetNumber];
+		int			nupdatable;
+		double		nremoved;
 		OffsetNumber offnum,
 					minoff,
 					maxoff;
@@ -837,9 +844,13 @@ restart:
 
 		/*
 		 * Scan over all items to see which ones need deleted according to the
-		 * callback function.
+		 * callback function.  A posting list tuple is deleted only if all of
+		 * its heap TIDs are; if just some are, it is replaced by a smaller
+		 * one holding the rest.
 		 */
 		ndeletable = 0;
+		nupdatable = 0;
+		nremoved = 0;
 		minoff = P_FIRSTDATAKEY(opaque);
 		maxoff = PageGetMaxOffsetNumber(page);
 		if (callback)
@@ -853,6 +864,23 @@ restart:
 
 				itup = (IndexTuple) PageGetItem(page,
 												PageGetItemId(page, offnum));
+				if (BTreeTupleIsPosting(itup))
+				{
+					IndexTuple	newitup;
+					int			nremaining;
+
+					newitup = btvacuumposting(vstate, itup, &nremaining);
+					if (nremaining == 0)
+						deletable[ndeletable++] = offnum;
+					else if (newitup != NULL)
+					{
+						updatable[nupdatable] = offnum;
+						updated[nupdatable++] = newitup;
+					}
+					nremoved += BTreeTupleGetNPosting(itup) - nremaining;
+					continue;
+				}
+
 				htup = &(itup->t_tid);
 
 				/*
@@ -877,7 +905,10 @@ restart:
 				 * killed.
 				 */
 				if (callback(htup, callback_state))
+				{
 					deletable[ndeletable++] = offnum;
+					nremoved++;
+				}
 			}
 		}
 
@@ -885,11 +916,16 @@ restart:
 		 * Apply any needed deletes.  We issue just one _bt_delitems() call
 		 * per page, so as to minimize WAL traffic.
 		 */
-		if (ndeletable > 0)
+		if (ndeletable > 0 || nupdatable > 0)
 		{
 			BlockNumber lastBlockVacuumed = BufferGetBlockNumber(buf);
+			int			i;
 
-			_bt_delitems_vacuum(rel, buf, deletable, ndeletable, vstate->lastBlockVacuumed);
+			_bt_delitems_vacuum(rel, buf, deletable, ndeletable,
+								updatable, updated, nupdatable,
+								vstate->lastBlockVacuumed);
+			for (i = 0; i < nupdatable; i++)
+				pfree(updated[i]);
 
 			/*
 			 * Keep track of the block number of the lastBlockVacuumed, so we
@@ -900,7 +936,7 @@ restart:
 			if (lastBlockVacuumed > vstate->lastBlockVacuumed)
 				vstate->lastBlockVacuumed = lastBlockVacuumed;
 
-			stats->tuples_removed += ndeletable;
+			stats->tuples_removed += nremoved;
 			/* must recompute maxoff */
 			maxoff = PageGetMaxOffsetNumber(page);
 		}
@@ -924,15 +960,27 @@ restart:
 		}
 
 		/*
-		 * If it's now empty, try to delete; else count the live tuples. We
-		 * don't delete when recursing, though, to avoid putting entries into
-		 * freePages out-of-order (doesn't seem worth any extra code to handle
-		 * the case).
+		 * If it's now empty, try to delete; else count the live tuples,
+		 * that is the heap TIDs they point to. We don't delete when
+		 * recursing, though, to avoid putting entries into freePages
+		 * out-of-order (doesn't seem worth any extra code to handle the
+		 * case).
 		 */
 		if (minoff > maxoff)
 			delete_now = (blkno == orig_blkno);
 		else
-			stats->num_index_tuples += maxoff - minoff + 1;
+		{
+			for (offnum = minoff;
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				IndexTuple	itup;
+
+				itup = (IndexTuple) PageGetItem(page,
+												PageGetItemId(page, offnum));
+				stats->num_index_tuples += BTreeTupleGetNHeapTids(itup);
+			}
+		}
 	}
 
 	if (delete_now)
@@ -969,3 +1017,39 @@ restart:
 		goto restart;
 	}
 }
+
+/*
+ * btvacuumposting --- determine which heap TIDs of a posting list survive
+ *
+ * Calls the vacuum callback for each heap TID of the posting list tuple.
+ * Sets *nremaining to the number of TIDs that are to be kept.  If some, but
+ * not all, TIDs are to be removed, returns a palloc'd replacement tuple
+ * holding just the remaining ones; otherwise returns NULL.
+ */
+static IndexTuple
+btvacuumposting(BTVacState *vstate, IndexTuple posting, int *nremaining)
+{
+	int			nposting = BTreeTupleGetNPosting(posting);
+	ItemPointer htids;
+	IndexTuple	result = NULL;
+	int			nlive = 0;
+	int			i;
+
+	htids = (ItemPointer) palloc(nposting * sizeof(ItemPointerData));
+
+	for (i = 0; i < nposting; i++)
+	{
+		ItemPointer htid = BTreeTupleGetPostingN(posting, i);
+
+		if (!vstate->callback(htid, vstate->callback_state))
+			htids[nlive++] = *htid;
+	}
+
+	if (nlive > 0 && nlive < nposting)
+		result = _bt_form_posting(posting, htids, nlive);
+
+	pfree(htids);
+
+	*nremaining = nlive;
+	return result;
+}
@@ -27,6 +27,8 @@
 
 static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 			 OffsetNumber offnum);
+static int _bt_saveitems(BTScanOpaque so, Page page, OffsetNumber offnum,
+			  int itemIndex, bool forward);
 static bool _bt_steppage(IndexScanDesc scan, ScanDirection dir);
 static Buffer _bt_walk_left(Relation rel, Buffer buf);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
@@ -331,7 +333,9 @@ _bt_binsrch(Relation rel,
  * scankey.  The actual key value stored (if any, which there probably isn't)
  * does not matter.  This convention allows us to implement the Lehman and
  * Yao convention that the first down-link pointer is before the first key.
- * See backend/access/nbtree/README for details.
+ * Similarly, attributes that have been truncated away from a pivot tuple
+ * are treated as minus infinity.  See backend/access/nbtree/README for
+ * details.
  *----------
  */
 int32
@@ -344,6 +348,7 @@ _bt_compare(Relation rel,
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
 	IndexTuple	itup;
+	int			ntupatts;
 	int			i;
 
 	/*
@@ -354,6 +359,7 @@ _bt_compare(Relation rel,
 		return 1;
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	ntupatts = BTreeTupleGetNAtts(itup, rel);
 
 	/*
 	 * The scan key is set up with the attribute number associated with each
@@ -373,6 +379,13 @@ _bt_compare(Relation rel,
 		bool		isNull;
 		int32		result;
 
+		/*
+		 * The attributes that a truncated pivot tuple lacks are "minus
+		 * infinity", so a scankey that got this far is greater than it.
+		 */
+		if (scankey->sk_attno > ntupatts)
+			return 1;
+
 		datum = index_getattr(itup, scankey->sk_attno, itupdesc, &isNull);
 
 		/* see comments about NULLs handling in btbuild */
@@ -1016,10 +1029,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (_bt_checkkeys(scan, page, offnum, dir, &continuescan))
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				/* _bt_checkkeys put the heap ptr into scan->xs_ctup.t_self */
-				so->currPos.items[itemIndex].heapTid = scan->xs_ctup.t_self;
-				so->currPos.items[itemIndex].indexOffset = offnum;
-				itemIndex++;
+				itemIndex = _bt_saveitems(so, page, offnum, itemIndex, true);
 			}
 			if (!continuescan)
 			{
@@ -1031,7 +1041,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			offnum = OffsetNumberNext(offnum);
 		}
 
-		Assert(itemIndex <= MaxIndexTuplesPerPage);
+		Assert(itemIndex <= MaxBTreeTIDsPerPage);
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
@@ -1039,7 +1049,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	else
 	{
 		/* load items[] in descending order */
-		itemIndex = MaxIndexTuplesPerPage;
+		itemIndex = MaxBTreeTIDsPerPage;
 
 		offnum = Min(offnum, maxoff);
 
@@ -1048,10 +1058,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (_bt_checkkeys(scan, page, offnum, dir, &continuescan))
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				/* _bt_checkkeys put the heap ptr into scan->xs_ctup.t_self */
-				itemIndex--;
-				so->currPos.items[itemIndex].heapTid = scan->xs_ctup.t_self;
-				so->currPos.items[itemIndex].indexOffset = offnum;
+				itemIndex = _bt_saveitems(so, page, offnum, itemIndex, false);
 			}
 			if (!continuescan)
 			{
@@ -1065,13 +1072,47 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 		Assert(itemIndex >= 0);
 		so->currPos.firstItem = itemIndex;
-		so->currPos.lastItem = MaxIndexTuplesPerPage - 1;
-		so->currPos.itemIndex = MaxIndexTuplesPerPage - 1;
+		so->currPos.lastItem = MaxBTreeTIDsPerPage - 1;
+		so->currPos.itemIndex = MaxBTreeTIDsPerPage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
 }
 
+/*
+ * _bt_saveitems() -- Remember the heap TIDs of a matching index tuple
+ *
+ * Saves one entry in currPos.items[] for each heap TID of the tuple at
+ * offnum: just one for a plain tuple, or one per posting list entry.  When
+ * filling forwards, the entries go at itemIndex and up; when filling
+ * backwards, they go just below itemIndex.  Either way, the entries of a
+ * posting list end up in ascending TID order.  Returns the new itemIndex.
+ */
+static int
+_bt_saveitems(BTScanOpaque so, Page page, OffsetNumber offnum,
+			  int itemIndex, bool forward)
+{
+	IndexTuple	itup;
+	int			nhtids;
+	int			i;
+
+	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	nhtids = BTreeTupleGetNHeapTids(itup);
+
+	if (!forward)
+		itemIndex -= nhtids;
+	for (i = 0; i < nhtids; i++)
+	{
+		so->currPos.items[itemIndex + i].heapTid =
+			*BTreeTupleGetHeapTidN(itup, i);
+		so->currPos.items[itemIndex + i].indexOffset = offnum;
+	}
+	if (forward)
+		itemIndex += nhtids;
+
+	return itemIndex;
+}
+
 /*
  *	_bt_steppage() -- Step to next page containing valid data for scan
  *
@@ -110,6 +110,19 @@ typedef struct BTPageState
 	struct BTPageState *btps_next;		/* link to parent level, if any */
 } BTPageState;
 
+/*
+ * Run of identical keys being collected into a posting list during the
+ * load phase.  base is a copy of the run's first tuple, or NULL if no run
+ * is pending.
+ */
+typedef struct BTBuildDedup
+{
+	IndexTuple	base;			/* first tuple of the run */
+	ItemPointer htids;			/* heap TIDs of the run */
+	int			nhtids;			/* number of heap TIDs in the run */
+	Size		maxpostingsize; /* limit on posting list tuple size */
+} BTBuildDedup;
+
 /*
  * Overall status record for index writing phase.
  */
@@ -130,6 +143,10 @@ static void _bt_sortaddtup(Page page, Size itemsize,
 			   IndexTuple itup, OffsetNumber itup_off);
 static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 			 IndexTuple itup);
+static void _bt_buildadd_dedup(BTWriteState *wstate, BTPageState *state,
+				   BTBuildDedup *dedup, IndexTuple itup);
+static void _bt_buildflush_dedup(BTWriteState *wstate, BTPageState *state,
+					 BTBuildDedup *dedup);
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
@@ -530,6 +547,27 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		ItemIdSetUnused(ii);	/* redundant */
 		((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
 
+		if (state->btps_level == 0)
+		{
+			IndexTuple	lastleft;
+
+			/*
+			 * On the leaf level, the high key needs only enough of 'last' to
+			 * tell it apart from the item before it (see _bt_truncate).
+			 * Replace it with a truncated copy, which also gets rid of any
+			 * posting list.  The copy is also what we use as the new page's
+			 * downlink below.
+			 */
+			ii = PageGetItemId(opage, OffsetNumberPrev(last_off));
+			lastleft = (IndexTuple) PageGetItem(opage, ii);
+			oitup = _bt_truncate(wstate->index, lastleft, oitup);
+
+			PageIndexTupleDelete(opage, P_HIKEY);
+			if (PageAddItem(opage, (Item) oitup, IndexTupleSize(oitup),
+							P_HIKEY, false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add high key to the index page");
+		}
+
 		/*
 		 * Link the old page into its parent, using its minimum key. If we
 		 * don't have a parent, we have to create one; this adds a new btree
@@ -539,7 +577,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 			state->btps_next = _bt_pagestate(wstate, state->btps_level + 1);
 
 		Assert(state->btps_minkey != NULL);
-		ItemPointerSet(&(state->btps_minkey->t_tid), oblkno, P_HIKEY);
+		BTreeTupleSetDownLink(state->btps_minkey, oblkno);
 		_bt_buildadd(wstate, state->btps_next, state->btps_minkey);
 		pfree(state->btps_minkey);
 
@@ -583,7 +621,10 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	if (last_off == P_HIKEY)
 	{
 		Assert(state->btps_minkey == NULL);
-		state->btps_minkey = CopyIndexTuple(itup);
+		if (BTreeTupleIsPosting(itup))
+			state->btps_minkey = _bt_strip_posting(itup);
+		else
+			state->btps_minkey = CopyIndexTuple(itup);
 	}
 
 	/*
@@ -597,6 +638,64 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	state->btps_lastoff = last_off;
 }
 
+/*
+ * Add a leaf item from the sort output, merging runs of identical keys
+ * into posting list tuples.
+ *
+ * The item is only remembered here; it's passed on to _bt_buildadd once we
+ * know that the next item doesn't have the same key, or that the posting
+ * list can't grow any bigger.
+ */
+static void
+_bt_buildadd_dedup(BTWriteState *wstate, BTPageState *state,
+				   BTBuildDedup *dedup, IndexTuple itup)
+{
+	if (dedup->maxpostingsize == 0)
+		dedup->maxpostingsize = BTMaxPostingSize(state->btps_page);
+
+	if (dedup->base != NULL &&
+		_bt_keys_identical(dedup->base, itup) &&
+		MAXALIGN(IndexTupleSize(dedup->base) +
+				 (dedup->nhtids + 1) * sizeof(ItemPointerData)) <=
+		dedup->maxpostingsize)
+	{
+		dedup->htids[dedup->nhtids++] = itup->t_tid;
+		return;
+	}
+
+	_bt_buildflush_dedup(wstate, state, dedup);
+
+	dedup->base = CopyIndexTuple(itup);
+	dedup->htids[0] = itup->t_tid;
+	dedup->nhtids = 1;
+}
+
+/*
+ * Pass the pending run of identical keys, if any, on to _bt_buildadd.
+ */
+static void
+_bt_buildflush_dedup(BTWriteState *wstate, BTPageState *state,
+					 BTBuildDedup *dedup)
+{
+	if (dedup->base == NULL)
+		return;
+
+	if (dedup->nhtids == 1)
+		_bt_buildadd(wstate, state, dedup->base);
+	else
+	{
+		IndexTuple	posting;
+
+		posting = _bt_form_posting(dedup->base, dedup->htids, dedup->nhtids);
+		_bt_buildadd(wstate, state, posting);
+		pfree(posting);
+	}
+
+	pfree(dedup->base);
+	dedup->base = NULL;
+	dedup->nhtids = 0;
+}
+
 /*
  * Finish writing out the completed btree.
  */
@@ -636,7 +735,7 @@ _bt_uppershutdown(BTWriteState *wstate, BTPageState *state)
 		else
 		{
 			Assert(s->btps_minkey != NULL);
-			ItemPointerSet(&(s->btps_minkey->t_tid), blkno, P_HIKEY);
+			BTreeTupleSetDownLink(s->btps_minkey, blkno);
 			_bt_buildadd(wstate, s->btps_next, s->btps_minkey);
 			pfree(s->btps_minkey);
 			s->btps_minkey = NULL;
@@ -680,6 +779,13 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 	int			i,
 				keysz = RelationGetNumberOfAttributes(wstate->index);
 	ScanKey		indexScanKey = NULL;
+	BTBuildDedup dedup;
+
+	dedup.base = NULL;
+	dedup.htids = (ItemPointer)
+		palloc(MaxBTreeTIDsPerPage * sizeof(ItemPointerData));
+	dedup.nhtids = 0;
+	dedup.maxpostingsize = 0;
 
 	if (merge)
 	{
@@ -760,7 +866,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 
 			if (load1)
 			{
-				_bt_buildadd(wstate, state, itup);
+				_bt_buildadd_dedup(wstate, state, &dedup, itup);
 				if (should_free)
 					pfree(itup);
 				itup = tuplesort_getindextuple(btspool->sortstate,
@@ -768,7 +874,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			}
 			else
 			{
-				_bt_buildadd(wstate, state, itup2);
+				_bt_buildadd_dedup(wstate, state, &dedup, itup2);
 				if (should_free2)
 					pfree(itup2);
 				itup2 = tuplesort_getindextuple(btspool2->sortstate,
@@ -787,12 +893,17 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			if (state == NULL)
 				state = _bt_pagestate(wstate, 0);
 
-			_bt_buildadd(wstate, state, itup);
+			_bt_buildadd_dedup(wstate, state, &dedup, itup);
 			if (should_free)
 				pfree(itup);
 		}
 	}
 
+	/* Add the last run of identical keys */
+	if (state != NULL)
+		_bt_buildflush_dedup(wstate, state, &dedup);
+	pfree(dedup.htids);
+
 	/* Close down final pages and write the metapage */
 	_bt_uppershutdown(wstate, state);
 
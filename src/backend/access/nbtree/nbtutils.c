@@ -34,6 +34,7 @@ static bool _bt_compare_scankey_args(IndexScanDesc scan, ScanKey op,
 						 bool *result);
 static bool _bt_fix_scankey_strategy(ScanKey skey, int16 *indoption);
 static void _bt_mark_scankey_required(ScanKey skey);
+static int	_bt_int_cmp(const void *a, const void *b);
 static bool _bt_check_rowcompare(ScanKey skey,
 					 IndexTuple tuple, TupleDesc tupdesc,
 					 ScanDirection dir, bool *continuescan);
@@ -44,7 +45,9 @@ static bool _bt_check_rowcompare(ScanKey skey,
  *		Build an insertion scan key that contains comparison data from itup
  *		as well as comparator routines appropriate to the key datatypes.
  *
- *		The result is intended for use with _bt_compare().
+ *		The result is intended for use with _bt_compare().  If itup is a
+ *		truncated pivot tuple, there are entries only for the attributes
+ *		it has; the caller must pass BTreeTupleGetNAtts() as the key size.
  */
 ScanKey
 _bt_mkscankey(Relation rel, IndexTuple itup)
@@ -56,7 +59,7 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 	int			i;
 
 	itupdesc = RelationGetDescr(rel);
-	natts = RelationGetNumberOfAttributes(rel);
+	natts = BTreeTupleGetNAtts(itup, rel);
 	indoption = rel->rd_indoption;
 
 	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
@@ -1178,7 +1181,13 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
  * the page, and so there is no need to search left from the recorded offset.
  * (This observation also guarantees that the item is still the right one
  * to delete, which might otherwise be questionable since heap TIDs can get
- * recycled.)
+ * recycled.)  Deduplication can move items left, but then we merely fail
+ * to find them, which is harmless.
+ *
+ * A posting list tuple can only be marked dead if every one of its heap
+ * TIDs was killed.  Its TIDs were saved in consecutive items[] entries in
+ * ascending order, so after sorting killedItems, they must all show up
+ * in a row.
  */
 void
 _bt_killitems(IndexScanDesc scan, bool haveLock)
@@ -1201,6 +1210,23 @@ _bt_killitems(IndexScanDesc scan, bool haveLock)
 	minoff = P_FIRSTDATAKEY(opaque);
 	maxoff = PageGetMaxOffsetNumber(page);
 
+	/*
+	 * Put the killed items into index order, and drop any duplicates (which
+	 * can occur if the caller reversed the scan direction).
+	 */
+	if (so->numKilled > 1)
+	{
+		int			nunique = 1;
+
+		qsort(so->killedItems, so->numKilled, sizeof(int), _bt_int_cmp);
+		for (i = 1; i < so->numKilled; i++)
+		{
+			if (so->killedItems[i] != so->killedItems[nunique - 1])
+				so->killedItems[nunique++] = so->killedItems[i];
+		}
+		so->numKilled = nunique;
+	}
+
 	for (i = 0; i < so->numKilled; i++)
 	{
 		int			itemIndex = so->killedItems[i];
@@ -1216,6 +1242,49 @@ _bt_killitems(IndexScanDesc scan, bool haveLock)
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
 
+			if (BTreeTupleIsPosting(ituple))
+			{
+				int			nposting = BTreeTupleGetNPosting(ituple);
+				int			j;
+
+				for (j = 0; j < nposting; j++)
+				{
+					if (ItemPointerEquals(BTreeTupleGetPostingN(ituple, j),
+										  &kitem->heapTid))
+						break;
+				}
+				if (j == nposting)
+				{
+					/* not this one, keep looking */
+					offnum = OffsetNumberNext(offnum);
+					continue;
+				}
+
+				/*
+				 * Found the item.  See if the following killed items account
+				 * for all the rest of its heap TIDs.
+				 */
+				if (j == 0)
+				{
+					for (j = 1; j < nposting && i + j < so->numKilled; j++)
+					{
+						BTScanPosItem *nextkitem;
+
+						nextkitem = &so->currPos.items[so->killedItems[i + j]];
+						if (!ItemPointerEquals(BTreeTupleGetPostingN(ituple, j),
+											   &nextkitem->heapTid))
+							break;
+					}
+					if (j == nposting)
+					{
+						ItemIdMarkDead(iid);
+						killedsomething = true;
+						i += nposting - 1;
+					}
+				}
+				break;			/* out of inner search loop */
+			}
+
 			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
 			{
 				/* found the item */
@@ -1251,6 +1320,114 @@ _bt_killitems(IndexScanDesc scan, bool haveLock)
 	so->numKilled = 0;
 }
 
+/*
+ * qsort comparator for killedItems
+ */
+static int
+_bt_int_cmp(const void *a, const void *b)
+{
+	int			av = *(const int *) a;
+	int			bv = *(const int *) b;
+
+	if (av < bv)
+		return -1;
+	if (av > bv)
+		return 1;
+	return 0;
+}
+
+/*
+ * _bt_keep_natts() -- How many attributes must a separator keep?
+ *
+ * Returns the number of leading attributes of firstright that are needed
+ * to tell it apart from lastleft, that is the number of the first attribute
+ * on which the two tuples are unequal.  If they are equal on all the
+ * attributes, or differ only in the last one, the result is the index's
+ * number of attributes and nothing can be truncated.
+ *
+ * Equality is decided by the opclass comparison functions, with NULLs
+ * equal to each other and unequal to everything else, which matches the
+ * ordering used by _bt_compare.
+ */
+int
+_bt_keep_natts(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	int			natts = RelationGetNumberOfAttributes(rel);
+	int			attnum;
+
+	for (attnum = 1; attnum < natts; attnum++)
+	{
+		Datum		datum1,
+					datum2;
+		bool		isNull1,
+					isNull2;
+
+		datum1 = index_getattr(lastleft, attnum, itupdesc, &isNull1);
+		datum2 = index_getattr(firstright, attnum, itupdesc, &isNull2);
+
+		if (isNull1 != isNull2)
+			break;
+		if (!isNull1 &&
+			DatumGetInt32(FunctionCall2(index_getprocinfo(rel, attnum,
+														  BTORDER_PROC),
+										datum1, datum2)) != 0)
+			break;
+	}
+
+	return attnum;
+}
+
+/*
+ * _bt_truncate() -- Make a pivot tuple separating lastleft and firstright.
+ *
+ * lastleft and firstright are the last item on the left half and the first
+ * item on the right half of a leaf page split.  The result will become the
+ * high key of the left half, and later the downlink to the right half, so
+ * it must be strictly greater than lastleft and no greater than firstright.
+ * We get that by keeping only the attributes of firstright up to the first
+ * one that differs from lastleft; the rest are truncated away and treated
+ * as minus infinity by _bt_compare.  With wide multi-column keys this
+ * makes for much smaller pivot tuples, and thus a higher fan-out in the
+ * upper levels of the tree.
+ *
+ * If no attributes can be truncated, the result is a plain copy of the key
+ * of firstright.  The result is palloc'd.
+ */
+IndexTuple
+_bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	int			keepnatts;
+	TupleDesc	truncdesc;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	IndexTuple	pivot;
+
+	keepnatts = _bt_keep_natts(rel, lastleft, firstright);
+	if (keepnatts >= RelationGetNumberOfAttributes(rel))
+	{
+		if (BTreeTupleIsPosting(firstright))
+			return _bt_strip_posting(firstright);
+		return CopyIndexTuple(firstright);
+	}
+
+	/*
+	 * Form a new tuple from the leading attributes of firstright.  A tuple
+	 * descriptor that just has fewer attributes lays them out exactly as the
+	 * index's own descriptor does, so index_getattr() works on the result.
+	 */
+	index_deform_tuple(firstright, itupdesc, values, isnull);
+	truncdesc = CreateTupleDesc(keepnatts, false, itupdesc->attrs);
+	pivot = index_form_tuple(truncdesc, values, isnull);
+	pfree(truncdesc);
+
+	ItemPointerSetInvalid(&pivot->t_tid);
+	BTreeTupleSetNAtts(pivot, keepnatts);
+
+	return pivot;
+}
+
 
 /*
  * The following routines manage a shared-memory area in which we track
@@ -1474,3 +1651,4 @@ btoptions(PG_FUNCTION_ARGS)
 		PG_RETURN_BYTEA_P(result);
 	PG_RETURN_NULL();
 }
+
@@ -290,17 +290,17 @@ btree_xlog_split(bool onleft, bool isroot,
 		datalen -= sizeof(BlockIdData);
 
 		forget_matching_split(xlrec->node, downlink, false);
+	}
 
-		/* Extract left hikey and its size (still assuming 16-bit alignment) */
-		if (!(record->xl_info & XLR_BKP_BLOCK_1))
-		{
-			/* We assume 16-bit alignment is enough for IndexTupleSize */
-			left_hikey = (Item) datapos;
-			left_hikeysz = MAXALIGN(IndexTupleSize(left_hikey));
+	/* Extract left hikey and its size (still assuming 16-bit alignment) */
+	if (!(record->xl_info & XLR_BKP_BLOCK_1))
+	{
+		/* We assume 16-bit alignment is enough for IndexTupleSize */
+		left_hikey = (Item) datapos;
+		left_hikeysz = MAXALIGN(IndexTupleSize(left_hikey));
 
-			datapos += left_hikeysz;
-			datalen -= left_hikeysz;
-		}
+		datapos += left_hikeysz;
+		datalen -= left_hikeysz;
 	}
 
 	/* Extract newitem and newitemoff, if present */
@@ -341,23 +341,11 @@ btree_xlog_split(bool onleft, bool isroot,
 
 	_bt_restore_page(rpage, datapos, datalen);
 
-	/*
-	 * On leaf level, the high key of the left page is equal to the first key
-	 * on the right page.
-	 */
-	if (xlrec->level == 0)
-	{
-		ItemId		hiItemId = PageGetItemId(rpage, P_FIRSTDATAKEY(ropaque));
-
-		left_hikey = PageGetItem(rpage, hiItemId);
-		left_hikeysz = ItemIdGetLength(hiItemId);
-	}
-
 	PageSetLSN(rpage, lsn);
 	PageSetTLI(rpage, ThisTimeLineID);
 	MarkBufferDirty(rbuf);
 
-	/* don't release the buffer yet; we touch right page's first item below */
+	/* don't release the buffer until the left page has been fixed up, too */
 
 	/*
 	 * Reconstruct left (original) sibling if needed.  Note that this code
@@ -531,13 +519,29 @@ btree_xlog_vacuum(XLogRecPtr lsn, XLogRecord *record)
 	if (record->xl_len > SizeOfBtreeVacuum)
 	{
 		OffsetNumber *unused;
-		OffsetNumber *unend;
+		OffsetNumber *updatenos;
+		char	   *updated;
+		int			i;
 
 		unused = (OffsetNumber *) ((char *) xlrec + SizeOfBtreeVacuum);
-		unend = (OffsetNumber *) ((char *) xlrec + record->xl_len);
+		updatenos = unused + xlrec->ndeleted;
+		updated = (char *) (updatenos + xlrec->nupdated);
+
+		/* Replace shrunken posting list tuples, as in _bt_delitems_vacuum */
+		for (i = 0; i < xlrec->nupdated; i++)
+		{
+			/* We assume 16-bit alignment is enough for IndexTupleSize */
+			Size		itemsz = MAXALIGN(IndexTupleSize((IndexTuple) updated));
 
-		if ((unend - unused) > 0)
-			PageIndexMultiDelete(page, unused, unend - unused);
+			PageIndexTupleDelete(page, updatenos[i]);
+			if (PageAddItem(page, (Item) updated, itemsz, updatenos[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "btree_xlog_vacuum: failed to add updated item");
+			updated += itemsz;
+		}
+
+		if (xlrec->ndeleted > 0)
+			PageIndexMultiDelete(page, unused, xlrec->ndeleted);
 	}
 
 	/*
@@ -581,7 +585,8 @@ btree_xlog_delete_get_latestRemovedXid(XLogRecord *record)
 	OffsetNumber hoffnum;
 	TransactionId latestRemovedXid = InvalidTransactionId;
 	TransactionId htupxid = InvalidTransactionId;
-	int			i;
+	int			i,
+				j;
 
 	/*
 	 * If there's nothing running on the standby we don't need to derive a
@@ -615,69 +620,78 @@ btree_xlog_delete_get_latestRemovedXid(XLogRecord *record)
 		itup = (IndexTuple) PageGetItem(ipage, iitemid);
 
 		/*
-		 * Locate the heap page that the index tuple points at
+		 * A posting list tuple points at several heap tuples; look at all
+		 * of them.
 		 */
-		hblkno = ItemPointerGetBlockNumber(&(itup->t_tid));
-		hbuffer = XLogReadBuffer(xlrec->hnode, hblkno, false);
-		if (!BufferIsValid(hbuffer))
+		for (j = 0; j < BTreeTupleGetNHeapTids(itup); j++)
 		{
-			UnlockReleaseBuffer(ibuffer);
-			return InvalidTransactionId;
-		}
-		hpage = (Page) BufferGetPage(hbuffer);
+			ItemPointer htid = BTreeTupleGetHeapTidN(itup, j);
 
-		/*
-		 * Look up the heap tuple header that the index tuple points at by
-		 * using the heap node supplied with the xlrec. We can't use
-		 * heap_fetch, since it uses ReadBuffer rather than XLogReadBuffer.
-		 * Note that we are not looking at tuple data here, just headers.
-		 */
-		hoffnum = ItemPointerGetOffsetNumber(&(itup->t_tid));
-		hitemid = PageGetItemId(hpage, hoffnum);
+			/*
+			 * Locate the heap page that the heap TID points at
+			 */
+			hblkno = ItemPointerGetBlockNumber(htid);
+			hbuffer = XLogReadBuffer(xlrec->hnode, hblkno, false);
+			if (!BufferIsValid(hbuffer))
+			{
+				UnlockReleaseBuffer(ibuffer);
+				return InvalidTransactionId;
+			}
+			hpage = (Page) BufferGetPage(hbuffer);
 
-		/*
-		 * Follow any redirections until we find something useful.
-		 */
-		while (ItemIdIsRedirected(hitemid))
-		{
-			hoffnum = ItemIdGetRedirect(hitemid);
+			/*
+			 * Look up the heap tuple header that the heap TID points at by
+			 * using the heap node supplied with the xlrec. We can't use
+			 * heap_fetch, since it uses ReadBuffer rather than XLogReadBuffer.
+			 * Note that we are not looking at tuple data here, just headers.
+			 */
+			hoffnum = ItemPointerGetOffsetNumber(htid);
 			hitemid = PageGetItemId(hpage, hoffnum);
-			CHECK_FOR_INTERRUPTS();
-		}
-
-		/*
-		 * If the heap item has storage, then read the header. Some LP_DEAD
-		 * items may not be accessible, so we ignore them.
-		 */
-		if (ItemIdHasStorage(hitemid))
-		{
-			htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
 
 			/*
-			 * Get the heap tuple's xmin/xmax and ratchet up the
-			 * latestRemovedXid. No need to consider xvac values here.
+			 * Follow any redirections until we find something useful.
 			 */
-			htupxid = HeapTupleHeaderGetXmin(htuphdr);
-			if (TransactionIdFollows(htupxid, latestRemovedXid))
-				latestRemovedXid = htupxid;
+			while (ItemIdIsRedirected(hitemid))
+			{
+				hoffnum = ItemIdGetRedirect(hitemid);
+				hitemid = PageGetItemId(hpage, hoffnum);
+				CHECK_FOR_INTERRUPTS();
+			}
 
-			htupxid = HeapTupleHeaderGetXmax(htuphdr);
-			if (TransactionIdFollows(htupxid, latestRemovedXid))
-				latestRemovedXid = htupxid;
-		}
-		else if (ItemIdIsDead(hitemid))
-		{
 			/*
-			 * Conjecture: if hitemid is dead then it had xids before the xids
-			 * marked on LP_NORMAL items. So we just ignore this item and move
-			 * onto the next, for the purposes of calculating
-			 * latestRemovedxids.
+			 * If the heap item has storage, then read the header. Some LP_DEAD
+			 * items may not be accessible, so we ignore them.
 			 */
-		}
-		else
-			Assert(!ItemIdIsUsed(hitemid));
+			if (ItemIdHasStorage(hitemid))
+			{
+				htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
+
+				/*
+				 * Get the heap tuple's xmin/xmax and ratchet up the
+				 * latestRemovedXid. No need to consider xvac values here.
+				 */
+				htupxid = HeapTupleHeaderGetXmin(htuphdr);
+				if (TransactionIdFollows(htupxid, latestRemovedXid))
+					latestRemovedXid = htupxid;
 
-		UnlockReleaseBuffer(hbuffer);
+				htupxid = HeapTupleHeaderGetXmax(htuphdr);
+				if (TransactionIdFollows(htupxid, latestRemovedXid))
+					latestRemovedXid = htupxid;
+			}
+			else if (ItemIdIsDead(hitemid))
+			{
+				/*
+				 * Conjecture: if hitemid is dead then it had xids before the xids
+				 * marked on LP_NORMAL items. So we just ignore this item and move
+				 * onto the next, for the purposes of calculating
+				 * latestRemovedxids.
+				 */
+			}
+			else
+				Assert(!ItemIdIsUsed(hitemid));
+
+			UnlockReleaseBuffer(hbuffer);
+		}
 	}
 
 	UnlockReleaseBuffer(ibuffer);
@@ -743,6 +757,40 @@ btree_xlog_delete(XLogRecPtr lsn, XLogRecord *record)
 	UnlockReleaseBuffer(buffer);
 }
 
+static void
+btree_xlog_dedup(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_btree_dedup *xlrec = (xl_btree_dedup *) XLogRecGetData(record);
+	BTDedupInterval *intervals;
+	Buffer		buffer;
+	Page		page;
+
+	/* If we have a full-page image, restore it and we're done */
+	if (record->xl_info & XLR_BKP_BLOCK_1)
+		return;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->block, false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (XLByteLE(lsn, PageGetLSN(page)))
+	{
+		UnlockReleaseBuffer(buffer);
+		return;
+	}
+
+	/* SizeOfBtreeDedup keeps the intervals array 16-bit aligned */
+	intervals = (BTDedupInterval *) ((char *) xlrec + SizeOfBtreeDedup);
+	PageRestoreTempPage(_bt_dedup_page(page, intervals, xlrec->nintervals),
+						page);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
 static void
 btree_xlog_delete_page(uint8 info, XLogRecPtr lsn, XLogRecord *record)
 {
@@ -793,7 +841,7 @@ btree_xlog_delete_page(uint8 info, XLogRecPtr lsn, XLogRecord *record)
 					Assert(info != XLOG_BTREE_DELETE_PAGE_HALF);
 					itemid = PageGetItemId(page, poffset);
 					itup = (IndexTuple) PageGetItem(page, itemid);
-					ItemPointerSet(&(itup->t_tid), rightsib, P_HIKEY);
+					BTreeTupleSetDownLink(itup, rightsib);
 					nextoffset = OffsetNumberNext(poffset);
 					PageIndexTupleDelete(page, nextoffset);
 				}
@@ -929,7 +977,8 @@ btree_xlog_newroot(XLogRecPtr lsn, XLogRecord *record)
 		/* extract downlink to the right-hand split page */
 		itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, P_FIRSTKEY));
 		downlink = ItemPointerGetBlockNumber(&(itup->t_tid));
-		Assert(ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
+		Assert(BTreeTupleIsTruncated(itup) ||
+			   ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
 	}
 
 	PageSetLSN(page, lsn);
@@ -1040,6 +1089,9 @@ btree_redo(XLogRecPtr lsn, XLogRecord *record)
 		case XLOG_BTREE_REUSE_PAGE:
 			/* Handled above before restoring bkp block */
 			break;
+		case XLOG_BTREE_DEDUP:
+			btree_xlog_dedup(lsn, record);
+			break;
 		default:
 			elog(PANIC, "btree_redo: unknown op code %u", info);
 	}
@@ -1137,10 +1189,11 @@ btree_desc(StringInfo buf, uint8 xl_info, char *rec)
 			{
 				xl_btree_vacuum *xlrec = (xl_btree_vacuum *) rec;
 
-				appendStringInfo(buf, "vacuum: rel %u/%u/%u; blk %u, lastBlockVacuumed %u",
+				appendStringInfo(buf, "vacuum: rel %u/%u/%u; blk %u, lastBlockVacuumed %u, deleted %u, updated %u",
 								 xlrec->node.spcNode, xlrec->node.dbNode,
 								 xlrec->node.relNode, xlrec->block,
-								 xlrec->lastBlockVacuumed);
+								 xlrec->lastBlockVacuumed,
+								 xlrec->ndeleted, xlrec->nupdated);
 				break;
 			}
 		case XLOG_BTREE_DELETE:
@@ -1184,6 +1237,16 @@ btree_desc(StringInfo buf, uint8 xl_info, char *rec)
 							   xlrec->node.relNode, xlrec->latestRemovedXid);
 				break;
 			}
+		case XLOG_BTREE_DEDUP:
+			{
+				xl_btree_dedup *xlrec = (xl_btree_dedup *) rec;
+
+				appendStringInfo(buf, "dedup: rel %u/%u/%u; blk %u, intervals %u",
+								 xlrec->node.spcNode, xlrec->node.dbNode,
+								 xlrec->node.relNode, xlrec->block,
+								 xlrec->nintervals);
+				break;
+			}
 		default:
 			appendStringInfo(buf, "UNKNOWN");
 			break;
@@ -0,0 +1,1204 @@
+/*-------------------------------------------------------------------------
+ *
+ * spgdoinsert.c
+ *	  implementation of insert algorithm
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/spgist_private.h"
+#include "access/transam.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+
+
+/*
+ * SPPageDesc tracks all info about a page we are inserting into.  In some
+ * situations it actually identifies a tuple, or even a specific node within
+ * an inner tuple.  But any of the fields can be invalid.  If the buffer
+ * field is valid, it implies we hold pin and exclusive lock on that buffer.
+ * page pointer should be valid exactly when buffer is.
+ */
+typedef struct SPPageDesc
+{
+	BlockNumber blkno;			/* block number, or InvalidBlockNumber */
+	Buffer		buffer;			/* page's buffer number, or InvalidBuffer */
+	Page		page;			/* pointer to page buffer, or NULL */
+	OffsetNumber offnum;		/* offset of tuple, or InvalidOffsetNumber */
+	int			node;			/* node number within inner tuple, or -1 */
+} SPPageDesc;
+
+
+/*
+ * Set the item pointer in the nodeN'th entry in inner tuple tup.  This
+ * is used to update the parent inner tuple's downlink after a move or
+ * split operation.
+ */
+void
+spgUpdateNodeLink(SpGistInnerTuple tup, int nodeN,
+				  BlockNumber blkno, OffsetNumber offset)
+{
+	int			i;
+	SpGistNodeTuple node;
+
+	SGITITERATE(tup, i, node)
+	{
+		if (i == nodeN)
+		{
+			ItemPointerSet(&node->t_tid, blkno, offset);
+			return;
+		}
+	}
+
+	elog(ERROR, "failed to find requested node %d in SPGiST inner tuple",
+		 nodeN);
+}
+
+/*
+ * Form a new inner tuple containing one more node than the given one, with
+ * the specified label datum, inserted at offset "offset" in the node array.
+ * The new tuple's prefix is the same as the old one's.
+ *
+ * Note that the new node initially has an invalid downlink.  We'll find a
+ * page to point it to later.
+ */
+static SpGistInnerTuple
+addNode(SpGistState *state, SpGistInnerTuple tuple, Datum label, int offset)
+{
+	SpGistNodeTuple node,
+			   *nodes;
+	int			i;
+
+	/* if offset is negative, insert at end */
+	if (offset < 0)
+		offset = tuple->nNodes;
+	else if (offset > tuple->nNodes)
+		elog(ERROR, "invalid offset for adding node to SPGiST inner tuple");
+
+	nodes = palloc(sizeof(SpGistNodeTuple) * (tuple->nNodes + 1));
+	SGITITERATE(tuple, i, node)
+	{
+		if (i < offset)
+			nodes[i] = node;
+		else
+			nodes[i + 1] = node;
+	}
+
+	nodes[offset] = spgFormNodeTuple(state, label, false);
+
+	return spgFormInnerTuple(state,
+							 (tuple->prefixSize > 0),
+							 SGITDATUM(tuple, state),
+							 tuple->nNodes + 1,
+							 nodes);
+}
+
+/*
+ * Space needed on a page for a leaf tuple holding the given datum,
+ * including its line pointer
+ */
+static int
+leafTupleSpace(SpGistState *state, Datum datum)
+{
+	int			size;
+
+	size = SGLTHDRSZ + SpGistGetTypeSize(&state->attType, datum);
+	if (size < SGDTSIZE)
+		size = SGDTSIZE;
+
+	return size + sizeof(ItemIdData);
+}
+
+/*
+ * Write a full-page-images WAL record covering the distinct buffers among
+ * those given.  Invalid buffers are ignored.  Must be called inside the
+ * critical section of the operation that changed the pages.
+ */
+static void
+logPages(Relation index, Buffer b1, Buffer b2, Buffer b3, Buffer b4)
+{
+	Buffer		in[SPGIST_MAX_XLOG_PAGES];
+	Buffer		buffers[SPGIST_MAX_XLOG_PAGES];
+	int			nbuffers = 0;
+	int			i,
+				j;
+
+	in[0] = b1;
+	in[1] = b2;
+	in[2] = b3;
+	in[3] = b4;
+
+	for (i = 0; i < SPGIST_MAX_XLOG_PAGES; i++)
+	{
+		if (in[i] == InvalidBuffer)
+			continue;
+		for (j = 0; j < nbuffers; j++)
+		{
+			if (buffers[j] == in[i])
+				break;
+		}
+		if (j == nbuffers)
+			buffers[nbuffers++] = in[i];
+	}
+
+	spgLogPages(index, buffers, nbuffers, InvalidTransactionId);
+}
+
+/*
+ * Add a leaf tuple to a leaf page where there is known to be room for it
+ *
+ * This covers adding to the root leaf page, starting a new chain for an
+ * empty node (in which case the parent's downlink is set), appending to an
+ * existing chain, and replacing a DEAD chain head.  isNew is true if the
+ * leaf page was freshly initialized for this tuple.
+ */
+static void
+addLeafTuple(Relation index, SpGistState *state, SpGistLeafTuple leafTuple,
+			 SPPageDesc *current, SPPageDesc *parent, bool isNew)
+{
+	spgxlogAddLeaf xlrec;
+	OffsetNumber offnum;
+
+	xlrec.node = index->rd_node;
+	xlrec.blknoLeaf = current->blkno;
+	xlrec.newPage = isNew;
+	xlrec.offnumHeadLeaf = InvalidOffsetNumber;
+	xlrec.blknoParent = InvalidBlockNumber;
+	xlrec.offnumParent = InvalidOffsetNumber;
+	xlrec.nodeI = 0;
+
+	START_CRIT_SECTION();
+
+	if (current->offnum == InvalidOffsetNumber ||
+		current->blkno == SPGIST_ROOT_BLKNO)
+	{
+		/* Tuple is not part of a chain */
+		leafTuple->nextOffset = InvalidOffsetNumber;
+		offnum = SpGistPageAddNewItem(current->page, (Item) leafTuple,
+									  leafTuple->size);
+
+		/* Must update parent's downlink if any */
+		if (parent->buffer != InvalidBuffer)
+		{
+			SpGistInnerTuple innerTuple;
+
+			xlrec.blknoParent = parent->blkno;
+			xlrec.offnumParent = parent->offnum;
+			xlrec.nodeI = parent->node;
+
+			innerTuple = (SpGistInnerTuple) PageGetItem(parent->page,
+								  PageGetItemId(parent->page, parent->offnum));
+			spgUpdateNodeLink(innerTuple, parent->node,
+							  current->blkno, offnum);
+			MarkBufferDirty(parent->buffer);
+		}
+	}
+	else
+	{
+		SpGistLeafTuple head;
+
+		head = (SpGistLeafTuple) PageGetItem(current->page,
+								PageGetItemId(current->page, current->offnum));
+		if (head->tupstate == SPGIST_LIVE)
+		{
+			/*
+			 * Link the new tuple in just after the head, so that the
+			 * parent's downlink needn't change.
+			 */
+			leafTuple->nextOffset = head->nextOffset;
+			offnum = SpGistPageAddNewItem(current->page, (Item) leafTuple,
+										  leafTuple->size);
+
+			/* adding the item may have moved the head tuple's data */
+			head = (SpGistLeafTuple) PageGetItem(current->page,
+								PageGetItemId(current->page, current->offnum));
+			head->nextOffset = offnum;
+
+			xlrec.offnumHeadLeaf = current->offnum;
+		}
+		else if (head->tupstate == SPGIST_DEAD)
+		{
+			/* Replace the dead head; the downlink already points here */
+			leafTuple->nextOffset = InvalidOffsetNumber;
+			SpGistPageReplaceItem(current->page, current->offnum,
+								  (Item) leafTuple, leafTuple->size);
+			offnum = current->offnum;
+		}
+		else
+		{
+			elog(ERROR, "unexpected SPGiST tuple state: %d",
+				 head->tupstate);
+			offnum = InvalidOffsetNumber;	/* keep compiler quiet */
+		}
+	}
+
+	xlrec.offnumLeaf = offnum;
+
+	MarkBufferDirty(current->buffer);
+
+	if (!index->rd_istemp)
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xlrec);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = (char *) leafTuple;
+		rdata[1].len = leafTuple->size;
+		rdata[1].buffer = isNew ? InvalidBuffer : current->buffer;
+		rdata[1].buffer_std = true;
+		rdata[1].next = NULL;
+
+		if (xlrec.blknoParent != InvalidBlockNumber)
+		{
+			rdata[1].next = &(rdata[2]);
+
+			rdata[2].data = NULL;
+			rdata[2].len = 0;
+			rdata[2].buffer = parent->buffer;
+			rdata[2].buffer_std = true;
+			rdata[2].next = NULL;
+		}
+
+		recptr = XLogInsert(RM_SPGIST_ID, XLOG_SPGIST_ADD_LEAF, rdata);
+
+		PageSetLSN(current->page, recptr);
+		PageSetTLI(current->page, ThisTimeLineID);
+
+		if (xlrec.blknoParent != InvalidBlockNumber)
+		{
+			PageSetLSN(parent->page, recptr);
+			PageSetTLI(parent->page, ThisTimeLineID);
+		}
+	}
+
+	END_CRIT_SECTION();
+}
+
+/*
+ * Move the chain at current, plus the new leaf tuple, to another leaf page
+ *
+ * This is used when the chain is still small but its page is full; rather
+ * than splitting the chain, we give it a page with more room.  The old head
+ * becomes a REDIRECT to the new location (for the benefit of concurrent
+ * scans) and the other old chain members become placeholders.
+ */
+static void
+moveLeafs(Relation index, SpGistState *state,
+		  SPPageDesc *current, SPPageDesc *parent,
+		  SpGistLeafTuple newLeafTuple)
+{
+	OffsetNumber toMove[MaxIndexTuplesPerPage];
+	SpGistLeafTuple *moved;
+	int			nToMove = 0,
+				nMoved = 0,
+				i;
+	int			size;
+	OffsetNumber offnum;
+	Buffer		nbuf;
+	Page		npage;
+	BlockNumber nblkno;
+	bool		xxNew;
+	SpGistDeadTuple placeholder,
+				redirect;
+	SpGistInnerTuple innerTuple;
+
+	/* This doesn't work on the root page, and needs a parent */
+	Assert(current->blkno != SPGIST_ROOT_BLKNO);
+	Assert(parent->buffer != InvalidBuffer);
+
+	/* Locate the tuples to be moved, and count up the space needed */
+	moved = (SpGistLeafTuple *) palloc(sizeof(SpGistLeafTuple) *
+									   (MaxIndexTuplesPerPage + 1));
+	size = newLeafTuple->size + sizeof(ItemIdData);
+
+	offnum = current->offnum;
+	while (offnum != InvalidOffsetNumber)
+	{
+		SpGistLeafTuple it;
+
+		Assert(offnum >= FirstOffsetNumber &&
+			   offnum <= PageGetMaxOffsetNumber(current->page));
+
+		it = (SpGistLeafTuple) PageGetItem(current->page,
+										   PageGetItemId(current->page, offnum));
+		toMove[nToMove++] = offnum;
+
+		if (it->tupstate == SPGIST_LIVE)
+		{
+			/* copy it, since we'll overwrite the original below */
+			moved[nMoved] = (SpGistLeafTuple) palloc(it->size);
+			memcpy(moved[nMoved], it, it->size);
+			size += it->size + sizeof(ItemIdData);
+			nMoved++;
+		}
+		else
+		{
+			/* only a dead head can get here, and it has no successors */
+			Assert(it->tupstate == SPGIST_DEAD);
+		}
+
+		offnum = it->nextOffset;
+	}
+	moved[nMoved++] = newLeafTuple;
+
+	/* Find a leaf page that will hold them */
+	nbuf = SpGistGetBuffer(index, state, SPGIST_LEAF, size, &xxNew);
+	npage = BufferGetPage(nbuf);
+	nblkno = BufferGetBlockNumber(nbuf);
+	Assert(nblkno != current->blkno);
+
+	placeholder = spgFormDeadTuple(state, SPGIST_PLACEHOLDER,
+								   InvalidBlockNumber, InvalidOffsetNumber);
+	redirect = spgFormDeadTuple(state, SPGIST_REDIRECT,
+								InvalidBlockNumber, InvalidOffsetNumber);
+
+	START_CRIT_SECTION();
+
+	/* Build the new chain, linking each tuple to the one added before it */
+	offnum = InvalidOffsetNumber;
+	for (i = 0; i < nMoved; i++)
+	{
+		moved[i]->nextOffset = offnum;
+		offnum = SpGistPageAddNewItem(npage, (Item) moved[i], moved[i]->size);
+	}
+
+	/* Replace the old chain: the head redirects, the rest are placeholders */
+	for (i = 1; i < nToMove; i++)
+		SpGistPageReplaceItem(current->page, toMove[i],
+							  (Item) placeholder, SGDTSIZE);
+	ItemPointerSet(&redirect->pointer, nblkno, offnum);
+	SpGistPageReplaceItem(current->page, toMove[0],
+						  (Item) redirect, SGDTSIZE);
+
+	/* Update parent's downlink */
+	innerTuple = (SpGistInnerTuple) PageGetItem(parent->page,
+								  PageGetItemId(parent->page, parent->offnum));
+	spgUpdateNodeLink(innerTuple, parent->node, nblkno, offnum);
+
+	MarkBufferDirty(current->buffer);
+	MarkBufferDirty(nbuf);
+	MarkBufferDirty(parent->buffer);
+
+	logPages(index, current->buffer, nbuf, parent->buffer, InvalidBuffer);
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(nbuf);
+}
+
+/*
+ * Check whether picksplit put all the tuples into the same node.  If so,
+ * replace its decisions with an allTheSame inner tuple: the node label is
+ * duplicated SPGIST_ALLTHESAME_NNODES times and the tuples are spread over
+ * the nodes round-robin, so that later insertions of the same value can
+ * go into several different chains.
+ *
+ * Returns true if the result was forced to be allTheSame.
+ */
+static bool
+checkAllTheSame(spgPickSplitIn *in, spgPickSplitOut *out)
+{
+	int			theNode;
+	int			i;
+
+	theNode = out->mapTuplesToNodes[0];
+	for (i = 1; i < in->nTuples; i++)
+	{
+		if (out->mapTuplesToNodes[i] != theNode)
+			return false;
+	}
+
+	/* Nope, so override the picksplit function's decisions */
+	if (out->nodeLabels)
+	{
+		Datum		theLabel = out->nodeLabels[theNode];
+
+		out->nodeLabels = (Datum *) palloc(sizeof(Datum) *
+										   SPGIST_ALLTHESAME_NNODES);
+		for (i = 0; i < SPGIST_ALLTHESAME_NNODES; i++)
+			out->nodeLabels[i] = theLabel;
+	}
+	out->nNodes = SPGIST_ALLTHESAME_NNODES;
+
+	for (i = 0; i < in->nTuples; i++)
+		out->mapTuplesToNodes[i] = i % SPGIST_ALLTHESAME_NNODES;
+
+	return true;
+}
+
+/*
+ * Split the leaf tuples at current into a new inner tuple and new chains
+ *
+ * If current is the root page, all of its tuples are split and the root
+ * page is reinitialized as an inner page holding just the new inner tuple.
+ * Otherwise the chain at current is split; the new inner tuple goes on the
+ * parent's page if there is room (else another inner page), the old chain
+ * head becomes a REDIRECT to it, and the parent's downlink is updated.
+ *
+ * The tuple being inserted is not included: on return, current identifies
+ * the new inner tuple, and the caller continues the descent from there.
+ */
+static void
+doPickSplit(Relation index, SpGistState *state,
+			SPPageDesc *current, SPPageDesc *parent, int level)
+{
+	bool		isRoot = (current->blkno == SPGIST_ROOT_BLKNO);
+	spgPickSplitIn in;
+	spgPickSplitOut out;
+	SpGistLeafTuple it;
+	SpGistLeafTuple *newLeafs;
+	SpGistNodeTuple *nodes;
+	SpGistNodeTuple node;
+	SpGistInnerTuple innerTuple;
+	SpGistDeadTuple placeholder = NULL,
+				redirect = NULL;
+	ItemPointerData *heapPtrs;
+	OffsetNumber *toDelete;
+	OffsetNumber *leafHeads;
+	OffsetNumber max,
+				offnum,
+				innerOffnum;
+	int			n = 0,
+				nToDelete = 0,
+				totalLeafSize,
+				innerSize,
+				i;
+	bool		allTheSame;
+	bool		xxNew;
+	Buffer		leafBuffer,
+				innerBuffer;
+	Page		leafPage,
+				innerPage;
+	BlockNumber leafBlkno,
+				innerBlkno;
+
+	/* Collect the datums and heap pointers of the tuples to be split */
+	max = PageGetMaxOffsetNumber(current->page);
+	in.datums = (Datum *) palloc(sizeof(Datum) * max);
+	heapPtrs = (ItemPointerData *) palloc(sizeof(ItemPointerData) * max);
+	toDelete = (OffsetNumber *) palloc(sizeof(OffsetNumber) * max);
+
+	if (isRoot)
+	{
+		for (offnum = FirstOffsetNumber; offnum <= max; offnum++)
+		{
+			it = (SpGistLeafTuple) PageGetItem(current->page,
+										PageGetItemId(current->page, offnum));
+			if (it->tupstate != SPGIST_LIVE)
+				elog(ERROR, "unexpected SPGiST tuple state: %d",
+					 it->tupstate);
+			in.datums[n] = SGLTDATUM(it, state);
+			heapPtrs[n] = it->heapPtr;
+			n++;
+		}
+	}
+	else
+	{
+		offnum = current->offnum;
+		while (offnum != InvalidOffsetNumber)
+		{
+			Assert(offnum >= FirstOffsetNumber && offnum <= max);
+			it = (SpGistLeafTuple) PageGetItem(current->page,
+										PageGetItemId(current->page, offnum));
+			if (it->tupstate != SPGIST_LIVE)
+				elog(ERROR, "unexpected SPGiST tuple state: %d",
+					 it->tupstate);
+			in.datums[n] = SGLTDATUM(it, state);
+			heapPtrs[n] = it->heapPtr;
+			toDelete[nToDelete++] = offnum;
+			n++;
+			offnum = it->nextOffset;
+		}
+	}
+
+	in.nTuples = n;
+	in.level = level;
+
+	/* Call the opclass's picksplit method */
+	memset(&out, 0, sizeof(out));
+	FunctionCall2(index_getprocinfo(index, 1, SPGIST_PICKSPLIT_PROC),
+				  PointerGetDatum(&in),
+				  PointerGetDatum(&out));
+
+	if (out.nNodes <= 0 || out.nNodes > SGITMAXNNODES)
+		elog(ERROR, "invalid number of nodes returned by SPGiST picksplit: %d",
+			 out.nNodes);
+
+	allTheSame = checkAllTheSame(&in, &out);
+
+	/* Form the new inner tuple; its downlinks are filled in below */
+	nodes = (SpGistNodeTuple *) palloc(sizeof(SpGistNodeTuple) * out.nNodes);
+	for (i = 0; i < out.nNodes; i++)
+	{
+		Datum		label = (Datum) 0;
+		bool		labelisnull = (out.nodeLabels == NULL);
+
+		if (!labelisnull)
+			label = out.nodeLabels[i];
+		nodes[i] = spgFormNodeTuple(state, label, labelisnull);
+	}
+	innerTuple = spgFormInnerTuple(state,
+								   out.hasPrefix, out.prefixDatum,
+								   out.nNodes, nodes);
+	innerTuple->allTheSame = allTheSame;
+	innerSize = innerTuple->size + sizeof(ItemIdData);
+
+	/* Form the new leaf tuples, and add up the space they need */
+	newLeafs = (SpGistLeafTuple *) palloc(sizeof(SpGistLeafTuple) * n);
+	totalLeafSize = 0;
+	for (i = 0; i < n; i++)
+	{
+		newLeafs[i] = spgFormLeafTuple(state, &heapPtrs[i],
+									   out.leafTupleDatums[i]);
+		totalLeafSize += newLeafs[i]->size + sizeof(ItemIdData);
+	}
+
+	/*
+	 * The new leaf tuples must all go onto one page, since we don't want to
+	 * have to deal with several new leaf pages at once.  They fit on an
+	 * empty page unless picksplit made the datums bigger than it was given,
+	 * which opclasses must not do.
+	 */
+	if (totalLeafSize > SPGIST_PAGE_CAPACITY)
+		elog(ERROR, "SPGiST picksplit result is too large to fit on a page");
+
+	/*
+	 * Put the new chains on the current page if they fit even before the
+	 * old chain is removed; otherwise get another leaf page.  The root page
+	 * is about to become an inner page, so it's never used for them.
+	 */
+	if (!isRoot && PageGetExactFreeSpace(current->page) >= totalLeafSize)
+	{
+		leafBuffer = current->buffer;
+		xxNew = false;
+	}
+	else
+		leafBuffer = SpGistGetBuffer(index, state, SPGIST_LEAF,
+									 totalLeafSize, &xxNew);
+	leafPage = BufferGetPage(leafBuffer);
+	leafBlkno = BufferGetBlockNumber(leafBuffer);
+
+	/*
+	 * The new inner tuple replaces the root tuple if we're splitting the
+	 * root; otherwise try to keep it on the parent's page, for locality of
+	 * descents.  The root page holds only the root tuple, though.
+	 */
+	if (isRoot)
+		innerBuffer = current->buffer;
+	else if (parent->blkno != SPGIST_ROOT_BLKNO &&
+			 SpGistPageGetFreeSpace(parent->page, 1) >= innerSize)
+		innerBuffer = parent->buffer;
+	else
+		innerBuffer = SpGistGetBuffer(index, state, 0, innerSize, &xxNew);
+	innerPage = BufferGetPage(innerBuffer);
+	innerBlkno = BufferGetBlockNumber(innerBuffer);
+
+	if (!isRoot)
+	{
+		placeholder = spgFormDeadTuple(state, SPGIST_PLACEHOLDER,
+									 InvalidBlockNumber, InvalidOffsetNumber);
+		redirect = spgFormDeadTuple(state, SPGIST_REDIRECT,
+									InvalidBlockNumber, InvalidOffsetNumber);
+	}
+	leafHeads = (OffsetNumber *) palloc(sizeof(OffsetNumber) * out.nNodes);
+	for (i = 0; i < out.nNodes; i++)
+		leafHeads[i] = InvalidOffsetNumber;
+
+	START_CRIT_SECTION();
+
+	/* Get rid of the old tuples, except for the head of a chain */
+	if (isRoot)
+		SpGistInitBuffer(current->buffer, 0);
+	else
+	{
+		for (i = 1; i < nToDelete; i++)
+			SpGistPageReplaceItem(current->page, toDelete[i],
+								  (Item) placeholder, SGDTSIZE);
+	}
+
+	/* Build a chain for each node that got any tuples */
+	for (i = 0; i < n; i++)
+	{
+		int			nodeN = out.mapTuplesToNodes[i];
+
+		Assert(nodeN >= 0 && nodeN < out.nNodes);
+		newLeafs[i]->nextOffset = leafHeads[nodeN];
+		leafHeads[nodeN] = SpGistPageAddNewItem(leafPage, (Item) newLeafs[i],
+												newLeafs[i]->size);
+	}
+
+	/* Point the nodes at their chains, and place the inner tuple */
+	SGITITERATE(innerTuple, i, node)
+	{
+		if (leafHeads[i] != InvalidOffsetNumber)
+			ItemPointerSet(&node->t_tid, leafBlkno, leafHeads[i]);
+	}
+	innerOffnum = SpGistPageAddNewItem(innerPage, (Item) innerTuple,
+									   innerTuple->size);
+	Assert(!isRoot || innerOffnum == FirstOffsetNumber);
+
+	if (!isRoot)
+	{
+		SpGistInnerTuple parentTuple;
+
+		/* The old chain head redirects to the new inner tuple */
+		ItemPointerSet(&redirect->pointer, innerBlkno, innerOffnum);
+		SpGistPageReplaceItem(current->page, toDelete[0],
+							  (Item) redirect, SGDTSIZE);
+
+		/* ... and so does the parent's downlink */
+		parentTuple = (SpGistInnerTuple) PageGetItem(parent->page,
+								  PageGetItemId(parent->page, parent->offnum));
+		spgUpdateNodeLink(parentTuple, parent->node, innerBlkno, innerOffnum);
+		MarkBufferDirty(parent->buffer);
+	}
+
+	MarkBufferDirty(current->buffer);
+	MarkBufferDirty(leafBuffer);
+	MarkBufferDirty(innerBuffer);
+
+	logPages(index, current->buffer, leafBuffer, innerBuffer,
+			 isRoot ? InvalidBuffer : parent->buffer);
+
+	END_CRIT_SECTION();
+
+	/* Continue the descent at the new inner tuple */
+	if (leafBuffer != current->buffer)
+		UnlockReleaseBuffer(leafBuffer);
+
+	if (!isRoot)
+	{
+		UnlockReleaseBuffer(current->buffer);
+		current->buffer = innerBuffer;
+		current->blkno = innerBlkno;
+		current->page = innerPage;
+	}
+	current->offnum = innerOffnum;
+	current->node = -1;
+}
+
+/*
+ * Add a node to the inner tuple at current, as directed by the opclass's
+ * choose method.  On return, current identifies the enlarged tuple.
+ */
+static void
+spgAddNodeAction(Relation index, SpGistState *state,
+				 SpGistInnerTuple innerTuple,
+				 SPPageDesc *current, SPPageDesc *parent,
+				 int nodeN, Datum nodeLabel)
+{
+	SpGistInnerTuple newInnerTuple;
+
+	/* Construct new inner tuple with additional node */
+	newInnerTuple = addNode(state, innerTuple, nodeLabel, nodeN);
+
+	if (PageGetExactFreeSpace(current->page) >=
+		newInnerTuple->size - innerTuple->size)
+	{
+		/* We can replace the inner tuple by new version in-place */
+		START_CRIT_SECTION();
+
+		SpGistPageReplaceItem(current->page, current->offnum,
+							  (Item) newInnerTuple, newInnerTuple->size);
+		MarkBufferDirty(current->buffer);
+
+		logPages(index, current->buffer,
+				 InvalidBuffer, InvalidBuffer, InvalidBuffer);
+
+		END_CRIT_SECTION();
+	}
+	else
+	{
+		SpGistDeadTuple redirect;
+		SpGistInnerTuple parentTuple;
+		Buffer		newBuffer;
+		Page		newPage;
+		BlockNumber newBlkno;
+		OffsetNumber newOffnum;
+		bool		xxNew;
+
+		/*
+		 * The root tuple is alone on its page, so it can only fail to fit
+		 * if it has outgrown the page altogether.
+		 */
+		if (current->blkno == SPGIST_ROOT_BLKNO)
+			elog(ERROR, "cannot enlarge root tuple any more");
+		Assert(parent->buffer != InvalidBuffer);
+
+		/* Move the tuple to another inner page, leaving a redirect */
+		newBuffer = SpGistGetBuffer(index, state, 0,
+									newInnerTuple->size + sizeof(ItemIdData),
+									&xxNew);
+		newPage = BufferGetPage(newBuffer);
+		newBlkno = BufferGetBlockNumber(newBuffer);
+
+		redirect = spgFormDeadTuple(state, SPGIST_REDIRECT,
+									InvalidBlockNumber, InvalidOffsetNumber);
+
+		START_CRIT_SECTION();
+
+		newOffnum = SpGistPageAddNewItem(newPage, (Item) newInnerTuple,
+										 newInnerTuple->size);
+
+		ItemPointerSet(&redirect->pointer, newBlkno, newOffnum);
+		SpGistPageReplaceItem(current->page, current->offnum,
+							  (Item) redirect, SGDTSIZE);
+
+		/* The parent might be on the same page; it's refetched either way */
+		parentTuple = (SpGistInnerTuple) PageGetItem(parent->page,
+								  PageGetItemId(parent->page, parent->offnum));
+		spgUpdateNodeLink(parentTuple, parent->node, newBlkno, newOffnum);
+
+		MarkBufferDirty(current->buffer);
+		MarkBufferDirty(newBuffer);
+		MarkBufferDirty(parent->buffer);
+
+		logPages(index, current->buffer, newBuffer, parent->buffer,
+				 InvalidBuffer);
+
+		END_CRIT_SECTION();
+
+		/* Continue at the tuple's new location */
+		if (current->buffer != parent->buffer)
+			UnlockReleaseBuffer(current->buffer);
+		current->buffer = newBuffer;
+		current->blkno = newBlkno;
+		current->page = newPage;
+		current->offnum = newOffnum;
+	}
+}
+
+/*
+ * Split the inner tuple at current into a "prefix" tuple with a single node,
+ * which replaces it in place, and a "postfix" tuple holding all the old
+ * nodes, to which the single node points.  On return, current identifies
+ * the prefix tuple.
+ */
+static void
+spgSplitNodeAction(Relation index, SpGistState *state,
+				   SpGistInnerTuple innerTuple,
+				   SPPageDesc *current, spgChooseOut *out)
+{
+	SpGistInnerTuple prefixTuple,
+				postfixTuple;
+	SpGistNodeTuple node,
+			   *nodes;
+	Buffer		newBuffer = InvalidBuffer;
+	Page		postfixPage;
+	BlockNumber postfixBlkno;
+	OffsetNumber postfixOffnum;
+	int			i;
+
+	/* Construct new prefix tuple, containing a single node */
+	node = spgFormNodeTuple(state, out->result.splitTuple.nodeLabel, false);
+
+	prefixTuple = spgFormInnerTuple(state,
+									out->result.splitTuple.prefixHasPrefix,
+									out->result.splitTuple.prefixPrefixDatum,
+									1, &node);
+
+	/* it must fit in the space that innerTuple now occupies */
+	if (prefixTuple->size > innerTuple->size)
+		elog(ERROR, "SPGiST inner-tuple split must not produce longer prefix");
+
+	/* Construct new postfix tuple, containing all nodes of innerTuple */
+	nodes = (SpGistNodeTuple *) palloc(sizeof(SpGistNodeTuple) *
+									   innerTuple->nNodes);
+	SGITITERATE(innerTuple, i, node)
+	{
+		nodes[i] = node;
+	}
+
+	postfixTuple = spgFormInnerTuple(state,
+									 out->result.splitTuple.postfixHasPrefix,
+								   out->result.splitTuple.postfixPrefixDatum,
+									 innerTuple->nNodes, nodes);
+
+	/* Postfix tuple is allTheSame if original tuple was */
+	postfixTuple->allTheSame = innerTuple->allTheSame;
+
+	/*
+	 * Keep the postfix tuple on the current page if it fits, except on the
+	 * root page, which is reserved for the root tuple.
+	 */
+	if (current->blkno != SPGIST_ROOT_BLKNO &&
+		SpGistPageGetFreeSpace(current->page, 1) >=
+		postfixTuple->size + sizeof(ItemIdData))
+	{
+		postfixPage = current->page;
+		postfixBlkno = current->blkno;
+	}
+	else
+	{
+		bool		xxNew;
+
+		newBuffer = SpGistGetBuffer(index, state, 0,
+									postfixTuple->size + sizeof(ItemIdData),
+									&xxNew);
+		postfixPage = BufferGetPage(newBuffer);
+		postfixBlkno = BufferGetBlockNumber(newBuffer);
+	}
+
+	START_CRIT_SECTION();
+
+	postfixOffnum = SpGistPageAddNewItem(postfixPage, (Item) postfixTuple,
+										 postfixTuple->size);
+
+	ItemPointerSet(&SGITNODEPTR(prefixTuple)->t_tid,
+				   postfixBlkno, postfixOffnum);
+	SpGistPageReplaceItem(current->page, current->offnum,
+						  (Item) prefixTuple, prefixTuple->size);
+
+	MarkBufferDirty(current->buffer);
+	if (newBuffer != InvalidBuffer)
+		MarkBufferDirty(newBuffer);
+
+	logPages(index, current->buffer, newBuffer, InvalidBuffer, InvalidBuffer);
+
+	END_CRIT_SECTION();
+
+	if (newBuffer != InvalidBuffer)
+		UnlockReleaseBuffer(newBuffer);
+}
+
+/*
+ * Insert one item into the index.
+ *
+ * Insertions into an SP-GiST index are serialized: the caller must hold
+ * the index's insertion lock (or be building the index), so that no other
+ * backend moves or splits the tuples we work on.  Scans and VACUUM hold at
+ * most one buffer lock at a time, so it's safe for us to keep the parent
+ * page locked while we modify a child.
+ */
+void
+spgdoinsert(Relation index, SpGistState *state,
+			ItemPointer heapPtr, Datum datum)
+{
+	int			level = 0;
+	Datum		leafDatum;
+	int			leafSize;
+	SPPageDesc	current,
+				parent;
+	FmgrInfo   *procinfo;
+
+	/* Look up FmgrInfo of the user-defined choose function once */
+	procinfo = index_getprocinfo(index, 1, SPGIST_CHOOSE_PROC);
+
+	/*
+	 * Since we don't use index_form_tuple in this AM, we have to make sure
+	 * value to be inserted is not toasted; FormIndexDatum doesn't guarantee
+	 * that.
+	 */
+	if (state->attType.attlen == -1)
+		datum = PointerGetDatum(PG_DETOAST_DATUM(datum));
+
+	leafDatum = datum;
+
+	/*
+	 * Compute space needed for a leaf tuple containing the given datum.
+	 * We can't cope with leaf tuples that don't fit on a page, since
+	 * picksplit works on one page's worth of tuples at a time.
+	 */
+	leafSize = leafTupleSpace(state, leafDatum);
+	if (leafSize > SPGIST_PAGE_CAPACITY)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+			errmsg("index row size %lu exceeds maximum %lu for index \"%s\"",
+				   (unsigned long) (leafSize - sizeof(ItemIdData)),
+				 (unsigned long) (SPGIST_PAGE_CAPACITY - sizeof(ItemIdData)),
+				   RelationGetRelationName(index)),
+			errhint("Values larger than a buffer page cannot be indexed.")));
+
+	/* Initialize "current" to the root page */
+	current.blkno = SPGIST_ROOT_BLKNO;
+	current.buffer = InvalidBuffer;
+	current.page = NULL;
+	current.offnum = FirstOffsetNumber;
+	current.node = -1;
+
+	/* "parent" is invalid for the moment */
+	parent.blkno = InvalidBlockNumber;
+	parent.buffer = InvalidBuffer;
+	parent.page = NULL;
+	parent.offnum = InvalidOffsetNumber;
+	parent.node = -1;
+
+	for (;;)
+	{
+		bool		isNew = false;
+
+		/*
+		 * Bail out if query cancel is pending.  We must have this somewhere
+		 * in the loop since a broken opclass could produce an infinite
+		 * picksplit loop.
+		 */
+		CHECK_FOR_INTERRUPTS();
+
+		if (current.buffer == InvalidBuffer)
+		{
+			if (current.blkno == InvalidBlockNumber)
+			{
+				/*
+				 * Create a leaf page.  If leafSize is too large to fit on a
+				 * page, we won't get here; we'll have split the chain.
+				 */
+				current.buffer = SpGistGetBuffer(index, state, SPGIST_LEAF,
+												 leafSize, &isNew);
+				current.blkno = BufferGetBlockNumber(current.buffer);
+			}
+			else if (parent.buffer != InvalidBuffer &&
+					 current.blkno == parent.blkno)
+			{
+				/* inner tuple can be stored on the same page as parent one */
+				current.buffer = parent.buffer;
+			}
+			else
+			{
+				current.buffer = ReadBuffer(index, current.blkno);
+				LockBuffer(current.buffer, BUFFER_LOCK_EXCLUSIVE);
+			}
+			current.page = BufferGetPage(current.buffer);
+		}
+
+		if (SpGistPageIsLeaf(current.page))
+		{
+			SpGistLeafTuple leafTuple;
+
+			leafTuple = spgFormLeafTuple(state, heapPtr, leafDatum);
+
+			if (current.blkno == SPGIST_ROOT_BLKNO)
+			{
+				/* The root leaf page just holds unchained tuples */
+				if (SpGistPageGetFreeSpace(current.page, 1) >= leafSize)
+				{
+					addLeafTuple(index, state, leafTuple,
+								 &current, &parent, false);
+					break;
+				}
+
+				doPickSplit(index, state, &current, &parent, level);
+				continue;
+			}
+			else if (current.offnum == InvalidOffsetNumber)
+			{
+				/* Start a new chain for an empty node */
+				addLeafTuple(index, state, leafTuple,
+							 &current, &parent, isNew);
+				break;
+			}
+			else
+			{
+				SpGistLeafTuple head;
+				OffsetNumber offnum;
+				int			chainSize = 0,
+							nChain = 0;
+
+				head = (SpGistLeafTuple) PageGetItem(current.page,
+								 PageGetItemId(current.page, current.offnum));
+
+				if (head->tupstate == SPGIST_REDIRECT)
+				{
+					/* Follow it to wherever the chain went */
+					ItemPointer ptr = &((SpGistDeadTuple) head)->pointer;
+
+					UnlockReleaseBuffer(current.buffer);
+					current.blkno = ItemPointerGetBlockNumber(ptr);
+					current.offnum = ItemPointerGetOffsetNumber(ptr);
+					current.buffer = InvalidBuffer;
+					current.page = NULL;
+					continue;
+				}
+
+				if (head->tupstate == SPGIST_DEAD &&
+					PageGetExactFreeSpace(current.page) + head->size >=
+					leafTuple->size)
+				{
+					/* Re-use the dead head's slot */
+					addLeafTuple(index, state, leafTuple,
+								 &current, &parent, false);
+					break;
+				}
+
+				if (head->tupstate == SPGIST_LIVE &&
+					SpGistPageGetFreeSpace(current.page, 1) >= leafSize)
+				{
+					/* Add to the chain */
+					addLeafTuple(index, state, leafTuple,
+								 &current, &parent, false);
+					break;
+				}
+
+				/* Measure the chain, to decide whether to move or split it */
+				offnum = current.offnum;
+				while (offnum != InvalidOffsetNumber)
+				{
+					SpGistLeafTuple it;
+
+					it = (SpGistLeafTuple) PageGetItem(current.page,
+										 PageGetItemId(current.page, offnum));
+					if (it->tupstate == SPGIST_LIVE)
+					{
+						chainSize += it->size + sizeof(ItemIdData);
+						nChain++;
+					}
+					offnum = it->nextOffset;
+				}
+
+				if (chainSize < SPGIST_PAGE_CAPACITY / 2 &&
+					nChain < 64 &&
+					chainSize + leafSize <= SPGIST_PAGE_CAPACITY)
+				{
+					/* Small enough to give it a page with more room */
+					moveLeafs(index, state, &current, &parent, leafTuple);
+					break;
+				}
+
+				doPickSplit(index, state, &current, &parent, level);
+				continue;
+			}
+		}
+		else
+		{
+			/*
+			 * Apply the opclass choose function to figure out how to insert
+			 * the given datum into the current inner tuple.
+			 */
+			SpGistInnerTuple innerTuple;
+			spgChooseIn in;
+			spgChooseOut out;
+
+			innerTuple = (SpGistInnerTuple) PageGetItem(current.page,
+								 PageGetItemId(current.page, current.offnum));
+
+			if (innerTuple->tupstate != SPGIST_LIVE)
+			{
+				ItemPointer ptr;
+
+				if (innerTuple->tupstate != SPGIST_REDIRECT)
+					elog(ERROR, "unexpected SPGiST tuple state: %d",
+						 innerTuple->tupstate);
+
+				/* The tuple was moved; go look for it at its new place */
+				ptr = &((SpGistDeadTuple) innerTuple)->pointer;
+				if (current.buffer != parent.buffer)
+					UnlockReleaseBuffer(current.buffer);
+				current.blkno = ItemPointerGetBlockNumber(ptr);
+				current.offnum = ItemPointerGetOffsetNumber(ptr);
+				current.buffer = InvalidBuffer;
+				current.page = NULL;
+				continue;
+			}
+
+			in.datum = datum;
+			in.leafDatum = leafDatum;
+			in.level = level;
+			in.allTheSame = innerTuple->allTheSame;
+			in.hasPrefix = (innerTuple->prefixSize > 0);
+			in.prefixDatum = SGITDATUM(innerTuple, state);
+			in.nNodes = innerTuple->nNodes;
+			in.nodeLabels = spgExtractNodeLabels(state, innerTuple);
+
+			memset(&out, 0, sizeof(out));
+
+			FunctionCall2(procinfo,
+						  PointerGetDatum(&in),
+						  PointerGetDatum(&out));
+
+			switch (out.resultType)
+			{
+				case spgMatchNode:
+					{
+						int			nodeN = out.result.matchNode.nodeN;
+						SpGistNodeTuple node;
+						int			i;
+
+						/*
+						 * For an allTheSame tuple, any node will do; pick one
+						 * at random, to spread the tuples out.
+						 */
+						if (innerTuple->allTheSame)
+							nodeN = random() % innerTuple->nNodes;
+
+						if (nodeN < 0 || nodeN >= innerTuple->nNodes)
+							elog(ERROR, "SPGiST choose returned invalid node number %d",
+								 nodeN);
+
+						level += out.result.matchNode.levelAdd;
+						leafDatum = out.result.matchNode.restDatum;
+						leafSize = leafTupleSpace(state, leafDatum);
+
+						/* Descend to the chosen node */
+						if (parent.buffer != InvalidBuffer &&
+							parent.buffer != current.buffer)
+							UnlockReleaseBuffer(parent.buffer);
+						parent = current;
+						parent.node = nodeN;
+
+						SGITITERATE(innerTuple, i, node)
+						{
+							if (i == nodeN)
+								break;
+						}
+
+						if (ItemPointerIsValid(&node->t_tid))
+						{
+							current.blkno = ItemPointerGetBlockNumber(&node->t_tid);
+							current.offnum = ItemPointerGetOffsetNumber(&node->t_tid);
+						}
+						else
+						{
+							/* Node has no child yet; we'll make a chain */
+							current.blkno = InvalidBlockNumber;
+							current.offnum = InvalidOffsetNumber;
+						}
+						current.buffer = InvalidBuffer;
+						current.page = NULL;
+						current.node = -1;
+					}
+					break;
+				case spgAddNode:
+					/* AddNode is not sensible if nodes don't have labels */
+					if (in.nodeLabels == NULL)
+						elog(ERROR, "cannot add a node to an inner tuple without node labels");
+					/* Add node to inner tuple, then retry choose there */
+					if (innerTuple->allTheSame)
+						elog(ERROR, "cannot add a node to an allTheSame inner tuple");
+					spgAddNodeAction(index, state, innerTuple,
+									 &current, &parent,
+									 out.result.addNode.nodeN,
+									 out.result.addNode.nodeLabel);
+					break;
+				case spgSplitTuple:
+					/* Split inner tuple, then retry choose at the prefix */
+					spgSplitNodeAction(index, state, innerTuple,
+									   &current, &out);
+					break;
+				default:
+					elog(ERROR, "unrecognized SPGiST choose result: %d",
+						 (int) out.resultType);
+					break;
+			}
+		}
+	}
+
+	/* Release any buffers we're still holding */
+	if (current.buffer != InvalidBuffer)
+		UnlockReleaseBuffer(current.buffer);
+	if (parent.buffer != InvalidBuffer &&
+		parent.buffer != current.buffer)
+		UnlockReleaseBuffer(parent.buffer);
+}
@@ -0,0 +1,500 @@
+/*-------------------------------------------------------------------------
+ *
+ * spgscan.c
+ *	  routines for scanning SP-GiST indexes
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/relscan.h"
+#include "access/spgist_private.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+
+
+typedef void (*storeRes_func) (SpGistScanOpaque so, ItemPointer heapPtr,
+										   bool recheck);
+
+typedef struct ScanStackEntry
+{
+	Datum		reconstructedValue;		/* value reconstructed from parent */
+	int			level;			/* level of items on this page */
+	ItemPointerData ptr;		/* block and offset to scan from */
+} ScanStackEntry;
+
+
+/* Free a ScanStackEntry */
+static void
+freeScanStackEntry(SpGistScanOpaque so, ScanStackEntry *stackEntry)
+{
+	if (!so->state.attType.attbyval &&
+		DatumGetPointer(stackEntry->reconstructedValue) != NULL)
+		pfree(DatumGetPointer(stackEntry->reconstructedValue));
+	pfree(stackEntry);
+}
+
+/*
+ * Initialize scanStack to search the root page, and check whether the
+ * scan keys can be satisfied at all
+ */
+static void
+resetSpGistScanOpaque(IndexScanDesc scan)
+{
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+	ScanStackEntry *startEntry;
+	MemoryContext oldCtx;
+	int			i;
+
+	/* Throw away whatever was left of the previous scan */
+	MemoryContextReset(so->traversalCxt);
+	MemoryContextReset(so->tempCxt);
+
+	oldCtx = MemoryContextSwitchTo(so->traversalCxt);
+
+	startEntry = (ScanStackEntry *) palloc0(sizeof(ScanStackEntry));
+	ItemPointerSet(&startEntry->ptr, SPGIST_ROOT_BLKNO, FirstOffsetNumber);
+	so->scanStack = list_make1(startEntry);
+
+	MemoryContextSwitchTo(oldCtx);
+
+	/* SPGiST doesn't index nulls, so a NULL comparison value can't match */
+	so->qualImpossible = false;
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		if (scan->keyData[i].sk_flags & SK_ISNULL)
+			so->qualImpossible = true;
+	}
+
+	so->nPtrs = so->iPtr = 0;
+}
+
+Datum
+spgbeginscan(PG_FUNCTION_ARGS)
+{
+	Relation	rel = (Relation) PG_GETARG_POINTER(0);
+	int			keysz = PG_GETARG_INT32(1);
+	ScanKey		scankey = (ScanKey) PG_GETARG_POINTER(2);
+	IndexScanDesc scan;
+	SpGistScanOpaque so;
+
+	scan = RelationGetIndexScan(rel, keysz, scankey);
+
+	so = (SpGistScanOpaque) palloc0(sizeof(SpGistScanOpaqueData));
+	initSpGistState(&so->state, scan->indexRelation);
+	so->tempCxt = AllocSetContextCreate(CurrentMemoryContext,
+										"SP-GiST search temporary context",
+										ALLOCSET_DEFAULT_MINSIZE,
+										ALLOCSET_DEFAULT_INITSIZE,
+										ALLOCSET_DEFAULT_MAXSIZE);
+	so->traversalCxt = AllocSetContextCreate(CurrentMemoryContext,
+											 "SP-GiST traversal context",
+											 ALLOCSET_DEFAULT_MINSIZE,
+											 ALLOCSET_DEFAULT_INITSIZE,
+											 ALLOCSET_DEFAULT_MAXSIZE);
+	scan->opaque = so;
+
+	/* the keys were already copied in by RelationGetIndexScan */
+	resetSpGistScanOpaque(scan);
+
+	PG_RETURN_POINTER(scan);
+}
+
+Datum
+spgrescan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+	ScanKey		scankey = (ScanKey) PG_GETARG_POINTER(1);
+
+	/* Update scan key, if a new one is given */
+	if (scankey && scan->numberOfKeys > 0)
+	{
+		memmove(scan->keyData,
+				scankey,
+				scan->numberOfKeys * sizeof(ScanKeyData));
+	}
+
+	/* if we are called from beginscan, so is still NULL */
+	if (so)
+		resetSpGistScanOpaque(scan);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+spgendscan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+
+	MemoryContextDelete(so->tempCxt);
+	MemoryContextDelete(so->traversalCxt);
+
+	pfree(so);
+	scan->opaque = NULL;
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Test whether a leaf tuple satisfies all the scan keys
+ */
+static bool
+spgLeafTest(IndexScanDesc scan, SpGistLeafTuple leafTuple,
+			int level, Datum reconstructedValue, bool *recheck)
+{
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+	bool		result;
+	spgLeafConsistentIn in;
+	spgLeafConsistentOut out;
+	FmgrInfo   *procinfo;
+	MemoryContext oldCtx;
+
+	/* use temp context for calling leaf_consistent */
+	oldCtx = MemoryContextSwitchTo(so->tempCxt);
+
+	in.scankeys = scan->keyData;
+	in.nkeys = scan->numberOfKeys;
+	in.reconstructedValue = reconstructedValue;
+	in.level = level;
+	in.leafDatum = SGLTDATUM(leafTuple, &so->state);
+
+	out.recheck = false;
+
+	procinfo = index_getprocinfo(scan->indexRelation, 1,
+								 SPGIST_LEAF_CONSISTENT_PROC);
+	result = DatumGetBool(FunctionCall2(procinfo,
+										PointerGetDatum(&in),
+										PointerGetDatum(&out)));
+
+	*recheck = out.recheck;
+
+	MemoryContextSwitchTo(oldCtx);
+
+	return result;
+}
+
+/*
+ * Walk the tree and report all tuples passing the scan quals to storeRes
+ *
+ * If scanWholeIndex is true, we'll do just that.  If not, we'll stop after
+ * the first scan stack entry that reports any tuples, which means at most a
+ * page's worth of them.
+ */
+static void
+spgWalk(IndexScanDesc scan, bool scanWholeIndex, storeRes_func storeRes)
+{
+	Relation	index = scan->indexRelation;
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+	Buffer		buffer = InvalidBuffer;
+	bool		reportedSome = false;
+
+	while (scanWholeIndex || !reportedSome)
+	{
+		ScanStackEntry *stackEntry;
+		BlockNumber blkno;
+		OffsetNumber offset;
+		Page		page;
+
+		/* Pull next to-do item from the list */
+		if (so->scanStack == NIL)
+			break;				/* there are no more pages to scan */
+
+		stackEntry = (ScanStackEntry *) linitial(so->scanStack);
+		so->scanStack = list_delete_first(so->scanStack);
+
+redirect:
+		/* Check for interrupts, just in case of infinite loop */
+		CHECK_FOR_INTERRUPTS();
+
+		blkno = ItemPointerGetBlockNumber(&stackEntry->ptr);
+		offset = ItemPointerGetOffsetNumber(&stackEntry->ptr);
+
+		if (buffer == InvalidBuffer)
+		{
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		}
+		else if (blkno != BufferGetBlockNumber(buffer))
+		{
+			UnlockReleaseBuffer(buffer);
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		}
+		/* else new pointer points to the same page, no work needed */
+
+		page = BufferGetPage(buffer);
+
+		if (SpGistPageIsLeaf(page))
+		{
+			SpGistLeafTuple leafTuple;
+			OffsetNumber max = PageGetMaxOffsetNumber(page);
+			bool		recheck = false;
+
+			if (blkno == SPGIST_ROOT_BLKNO)
+			{
+				/* When root is a leaf, examine all its tuples */
+				for (offset = FirstOffsetNumber; offset <= max; offset++)
+				{
+					leafTuple = (SpGistLeafTuple)
+						PageGetItem(page, PageGetItemId(page, offset));
+					if (leafTuple->tupstate != SPGIST_LIVE)
+						elog(ERROR, "unexpected SPGiST tuple state: %d",
+							 leafTuple->tupstate);
+
+					Assert(ItemPointerIsValid(&leafTuple->heapPtr));
+					if (spgLeafTest(scan, leafTuple,
+									stackEntry->level,
+									stackEntry->reconstructedValue,
+									&recheck))
+					{
+						storeRes(so, &leafTuple->heapPtr, recheck);
+						reportedSome = true;
+					}
+				}
+			}
+			else
+			{
+				/* Normal case: just examine the chain we arrived at */
+				while (offset != InvalidOffsetNumber)
+				{
+					Assert(offset >= FirstOffsetNumber && offset <= max);
+					leafTuple = (SpGistLeafTuple)
+						PageGetItem(page, PageGetItemId(page, offset));
+					if (leafTuple->tupstate != SPGIST_LIVE)
+					{
+						if (leafTuple->tupstate == SPGIST_REDIRECT)
+						{
+							/* redirection tuple should be first in chain */
+							Assert(offset == ItemPointerGetOffsetNumber(&stackEntry->ptr));
+							/* transfer attention to redirect point */
+							stackEntry->ptr = ((SpGistDeadTuple) leafTuple)->pointer;
+							Assert(ItemPointerGetBlockNumber(&stackEntry->ptr) != SPGIST_METAPAGE_BLKNO);
+							goto redirect;
+						}
+						if (leafTuple->tupstate == SPGIST_DEAD)
+						{
+							/* dead tuple should be first in chain */
+							Assert(offset == ItemPointerGetOffsetNumber(&stackEntry->ptr));
+							/* No live entries on this page */
+							Assert(leafTuple->nextOffset == InvalidOffsetNumber);
+							break;
+						}
+						/* We should not arrive at a placeholder */
+						elog(ERROR, "unexpected SPGiST tuple state: %d",
+							 leafTuple->tupstate);
+					}
+
+					Assert(ItemPointerIsValid(&leafTuple->heapPtr));
+					if (spgLeafTest(scan, leafTuple,
+									stackEntry->level,
+									stackEntry->reconstructedValue,
+									&recheck))
+					{
+						storeRes(so, &leafTuple->heapPtr, recheck);
+						reportedSome = true;
+					}
+
+					offset = leafTuple->nextOffset;
+				}
+			}
+		}
+		else	/* page is inner */
+		{
+			SpGistInnerTuple innerTuple;
+			spgInnerConsistentIn in;
+			spgInnerConsistentOut out;
+			FmgrInfo   *procinfo;
+			SpGistNodeTuple *nodes;
+			SpGistNodeTuple node;
+			int			i;
+			MemoryContext oldCtx;
+
+			innerTuple = (SpGistInnerTuple) PageGetItem(page,
+												PageGetItemId(page, offset));
+
+			if (innerTuple->tupstate != SPGIST_LIVE)
+			{
+				if (innerTuple->tupstate == SPGIST_REDIRECT)
+				{
+					/* transfer attention to redirect point */
+					stackEntry->ptr = ((SpGistDeadTuple) innerTuple)->pointer;
+					Assert(ItemPointerGetBlockNumber(&stackEntry->ptr) != SPGIST_METAPAGE_BLKNO);
+					goto redirect;
+				}
+				elog(ERROR, "unexpected SPGiST tuple state: %d",
+					 innerTuple->tupstate);
+			}
+
+			/* use temp context for calling inner_consistent */
+			oldCtx = MemoryContextSwitchTo(so->tempCxt);
+
+			in.scankeys = scan->keyData;
+			in.nkeys = scan->numberOfKeys;
+			in.reconstructedValue = stackEntry->reconstructedValue;
+			in.level = stackEntry->level;
+			in.allTheSame = innerTuple->allTheSame;
+			in.hasPrefix = (innerTuple->prefixSize > 0);
+			in.prefixDatum = SGITDATUM(innerTuple, &so->state);
+			in.nNodes = innerTuple->nNodes;
+			in.nodeLabels = spgExtractNodeLabels(&so->state, innerTuple);
+
+			/* collect node pointers */
+			nodes = (SpGistNodeTuple *) palloc(sizeof(SpGistNodeTuple) * in.nNodes);
+			SGITITERATE(innerTuple, i, node)
+			{
+				nodes[i] = node;
+			}
+
+			memset(&out, 0, sizeof(out));
+
+			procinfo = index_getprocinfo(index, 1,
+										 SPGIST_INNER_CONSISTENT_PROC);
+			FunctionCall2(procinfo,
+						  PointerGetDatum(&in),
+						  PointerGetDatum(&out));
+
+			MemoryContextSwitchTo(oldCtx);
+
+			/* If allTheSame, they should all or none of 'em match */
+			if (innerTuple->allTheSame)
+				if (out.nNodes != 0 && out.nNodes != in.nNodes)
+					elog(ERROR, "inconsistent inner_consistent results for allTheSame inner tuple");
+
+			for (i = 0; i < out.nNodes; i++)
+			{
+				int			nodeN = out.nodeNumbers[i];
+
+				Assert(nodeN >= 0 && nodeN < in.nNodes);
+				if (ItemPointerIsValid(&nodes[nodeN]->t_tid))
+				{
+					ScanStackEntry *newEntry;
+
+					/* Create new work item for this node */
+					oldCtx = MemoryContextSwitchTo(so->traversalCxt);
+
+					newEntry = palloc(sizeof(ScanStackEntry));
+					newEntry->ptr = nodes[nodeN]->t_tid;
+					if (out.levelAdds)
+						newEntry->level = stackEntry->level + out.levelAdds[i];
+					else
+						newEntry->level = stackEntry->level;
+					/* Must copy value out of temp context */
+					if (out.reconstructedValues)
+						newEntry->reconstructedValue =
+							datumCopy(out.reconstructedValues[i],
+									  so->state.attType.attbyval,
+									  so->state.attType.attlen);
+					else
+						newEntry->reconstructedValue = (Datum) 0;
+
+					so->scanStack = lcons(newEntry, so->scanStack);
+
+					MemoryContextSwitchTo(oldCtx);
+				}
+			}
+		}
+
+		/* done with this scan stack entry */
+		freeScanStackEntry(so, stackEntry);
+		/* clear temp context before proceeding to the next one */
+		MemoryContextReset(so->tempCxt);
+	}
+
+	if (buffer != InvalidBuffer)
+		UnlockReleaseBuffer(buffer);
+}
+
+/* storeRes subroutine for getbitmap case */
+static void
+storeBitmap(SpGistScanOpaque so, ItemPointer heapPtr, bool recheck)
+{
+	tbm_add_tuples(so->tbm, heapPtr, 1, recheck);
+	so->ntids++;
+}
+
+Datum
+spggetbitmap(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	TIDBitmap  *tbm = (TIDBitmap *) PG_GETARG_POINTER(1);
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+
+	so->tbm = tbm;
+	so->ntids = 0;
+
+	if (!so->qualImpossible)
+		spgWalk(scan, true, storeBitmap);
+
+	PG_RETURN_INT64(so->ntids);
+}
+
+/* storeRes subroutine for gettuple case */
+static void
+storeGettuple(SpGistScanOpaque so, ItemPointer heapPtr, bool recheck)
+{
+	Assert(so->nPtrs < MaxIndexTuplesPerPage);
+	so->heapPtrs[so->nPtrs] = *heapPtr;
+	so->recheck[so->nPtrs] = recheck;
+	so->nPtrs++;
+}
+
+Datum
+spggettuple(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	ScanDirection dir = (ScanDirection) PG_GETARG_INT32(1);
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+
+	if (dir != ForwardScanDirection)
+		elog(ERROR, "SP-GiST only supports forward scan direction");
+
+	if (so->qualImpossible)
+		PG_RETURN_BOOL(false);
+
+	for (;;)
+	{
+		if (so->iPtr < so->nPtrs)
+		{
+			/* continuing to return tuples from a leaf page */
+			scan->xs_ctup.t_self = so->heapPtrs[so->iPtr];
+			scan->xs_recheck = so->recheck[so->iPtr];
+			so->iPtr++;
+			PG_RETURN_BOOL(true);
+		}
+
+		so->iPtr = so->nPtrs = 0;
+		spgWalk(scan, false, storeGettuple);
+
+		if (so->nPtrs == 0)
+			break;				/* must have completed scan */
+	}
+
+	PG_RETURN_BOOL(false);
+}
+
+Datum
+spgmarkpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "SP-GiST does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+Datum
+spgrestrpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "SP-GiST does not support mark/restore");
+	PG_RETURN_VOID();
+}
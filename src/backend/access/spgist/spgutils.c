@@ -0,0 +1,649 @@
+/*-------------------------------------------------------------------------
+ *
+ * spgutils.c
+ *	  various support functions for SP-GiST
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/reloptions.h"
+#include "access/spgist_private.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "utils/lsyscache.h"
+
+
+/* Fill in a SpGistTypeDesc struct with info about the specified data type */
+static void
+fillTypeDesc(SpGistTypeDesc *desc, Oid type)
+{
+	desc->type = type;
+	get_typlenbyval(type, &desc->attlen, &desc->attbyval);
+}
+
+/*
+ * Fetch local cache of AM-specific info about the index, initializing it
+ * if necessary
+ */
+static SpGistCache *
+spgGetCache(Relation index)
+{
+	SpGistCache *cache;
+
+	if (index->rd_amcache == NULL)
+	{
+		Oid			atttype;
+		spgConfigIn in;
+
+		cache = MemoryContextAllocZero(index->rd_indexcxt,
+									   sizeof(SpGistCache));
+
+		/* SPGiST doesn't support multi-column indexes */
+		Assert(index->rd_att->natts == 1);
+
+		/*
+		 * Get the actual data type of the indexed column from the index
+		 * tupdesc.  We pass this to the opclass config function so that
+		 * polymorphic opclasses are possible.
+		 */
+		atttype = index->rd_att->attrs[0]->atttypid;
+
+		/* Call the config function to get config info for the opclass */
+		in.attType = atttype;
+
+		FunctionCall2(index_getprocinfo(index, 1, SPGIST_CONFIG_PROC),
+					  PointerGetDatum(&in),
+					  PointerGetDatum(&cache->config));
+
+		/* Get the information we need about each relevant datatype */
+		fillTypeDesc(&cache->attType, atttype);
+		fillTypeDesc(&cache->attPrefixType, cache->config.prefixType);
+		fillTypeDesc(&cache->attLabelType, cache->config.labelType);
+
+		index->rd_amcache = (void *) cache;
+	}
+	else
+	{
+		/* assume it's up to date */
+		cache = (SpGistCache *) index->rd_amcache;
+	}
+
+	return cache;
+}
+
+/* Initialize SpGistState for working with the given index */
+void
+initSpGistState(SpGistState *state, Relation index)
+{
+	SpGistCache *cache;
+
+	/* Get cached static information about index */
+	cache = spgGetCache(index);
+
+	state->config = cache->config;
+	state->attType = cache->attType;
+	state->attPrefixType = cache->attPrefixType;
+	state->attLabelType = cache->attLabelType;
+
+	/* Redirection tuples we create are stamped with our XID */
+	state->myXid = GetTopTransactionIdIfAny();
+
+	/* No page hints until SpGistLoadHints is called */
+	state->lastInnerBlkno = InvalidBlockNumber;
+	state->lastLeafBlkno = InvalidBlockNumber;
+	state->hintsChanged = false;
+}
+
+/*
+ * Read the last-used-page hints from the metapage into *state.
+ *
+ * The caller should hold the index's insertion lock, so that concurrent
+ * inserters don't keep overwriting each other's hints.
+ */
+void
+SpGistLoadHints(Relation index, SpGistState *state)
+{
+	Buffer		metabuffer;
+	SpGistMetaPageData *meta;
+
+	metabuffer = ReadBuffer(index, SPGIST_METAPAGE_BLKNO);
+	LockBuffer(metabuffer, BUFFER_LOCK_SHARE);
+
+	meta = SpGistPageGetMeta(BufferGetPage(metabuffer));
+
+	if (meta->magicNumber != SPGIST_MAGIC_NUMBER)
+		elog(ERROR, "index \"%s\" is not an SP-GiST index",
+			 RelationGetRelationName(index));
+
+	state->lastInnerBlkno = meta->lastInnerBlkno;
+	state->lastLeafBlkno = meta->lastLeafBlkno;
+	state->hintsChanged = false;
+
+	UnlockReleaseBuffer(metabuffer);
+}
+
+/*
+ * Write the last-used-page hints back to the metapage, if they changed.
+ *
+ * The hints are not WAL-logged; like a hint-bit update, losing them is
+ * harmless, since they are only a starting point for finding free space.
+ */
+void
+SpGistSaveHints(Relation index, SpGistState *state)
+{
+	Buffer		metabuffer;
+	SpGistMetaPageData *meta;
+
+	if (!state->hintsChanged)
+		return;
+
+	metabuffer = ReadBuffer(index, SPGIST_METAPAGE_BLKNO);
+	LockBuffer(metabuffer, BUFFER_LOCK_EXCLUSIVE);
+
+	meta = SpGistPageGetMeta(BufferGetPage(metabuffer));
+	meta->lastInnerBlkno = state->lastInnerBlkno;
+	meta->lastLeafBlkno = state->lastLeafBlkno;
+
+	SetBufferCommitInfoNeedsSave(metabuffer);
+	UnlockReleaseBuffer(metabuffer);
+
+	state->hintsChanged = false;
+}
+
+/*
+ * Allocate a new page (by extending the index), and return it exclusively
+ * locked.  The caller is responsible for initializing the page.
+ *
+ * SP-GiST never recycles pages, so there is no free space map to consult.
+ */
+Buffer
+SpGistNewBuffer(Relation index)
+{
+	Buffer		buffer;
+	bool		needLock;
+
+	needLock = !RELATION_IS_LOCAL(index);
+
+	if (needLock)
+		LockRelationForExtension(index, ExclusiveLock);
+
+	buffer = ReadBuffer(index, P_NEW);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	if (needLock)
+		UnlockRelationForExtension(index, ExclusiveLock);
+
+	return buffer;
+}
+
+/*
+ * Get a buffer of the type and free space specified by flags and needSpace,
+ * exclusively locked.  needSpace includes the line pointers.
+ *
+ * We first try the last page of that type that we put tuples on, leaving
+ * the fillfactor's worth of free space there; otherwise the index is
+ * extended.  *isNew is set true if the page was freshly initialized.
+ *
+ * The hint page might already be locked by the caller, in which case the
+ * conditional lock fails and we just move on to a new page.
+ */
+Buffer
+SpGistGetBuffer(Relation index, SpGistState *state, uint16 flags,
+				int needSpace, bool *isNew)
+{
+	BlockNumber *hint;
+	Buffer		buffer;
+
+	hint = (flags & SPGIST_LEAF) ? &state->lastLeafBlkno :
+		&state->lastInnerBlkno;
+
+	/* Bail out if even an empty page wouldn't meet the demand */
+	if (needSpace > SPGIST_PAGE_CAPACITY)
+		elog(ERROR, "desired SPGiST tuple size is too big");
+
+	/* Leave fillfactor's worth of room on pages that are already in use */
+	needSpace += RelationGetTargetPageFreeSpace(index,
+												SPGIST_DEFAULT_FILLFACTOR);
+	needSpace = Min(needSpace, SPGIST_PAGE_CAPACITY);
+
+	*isNew = false;
+
+	if (*hint != InvalidBlockNumber &&
+		*hint > SPGIST_ROOT_BLKNO &&
+		*hint < RelationGetNumberOfBlocks(index))
+	{
+		buffer = ReadBuffer(index, *hint);
+
+		if (ConditionalLockBuffer(buffer))
+		{
+			Page		page = BufferGetPage(buffer);
+
+			if (!PageIsNew(page) &&
+				SpGistPageGetOpaque(page)->flags == flags &&
+				SpGistPageGetFreeSpace(page, 1) >= needSpace)
+				return buffer;
+
+			UnlockReleaseBuffer(buffer);
+		}
+		else
+			ReleaseBuffer(buffer);
+	}
+
+	/* No luck, so extend the index */
+	buffer = SpGistNewBuffer(index);
+	SpGistInitBuffer(buffer, flags);
+
+	*hint = BufferGetBlockNumber(buffer);
+	state->hintsChanged = true;
+	*isNew = true;
+
+	return buffer;
+}
+
+/*
+ * Initialize an SPGiST page to empty, with specified flags
+ */
+void
+SpGistInitPage(Page page, uint16 f)
+{
+	SpGistPageOpaque opaque;
+
+	PageInit(page, BLCKSZ, MAXALIGN(sizeof(SpGistPageOpaqueData)));
+	opaque = SpGistPageGetOpaque(page);
+	memset(opaque, 0, sizeof(SpGistPageOpaqueData));
+	opaque->flags = f;
+	opaque->spgist_page_id = SPGIST_PAGE_ID;
+}
+
+/*
+ * Initialize a buffer's page to empty, with specified flags
+ */
+void
+SpGistInitBuffer(Buffer b, uint16 f)
+{
+	Assert(BufferGetPageSize(b) == BLCKSZ);
+	SpGistInitPage(BufferGetPage(b), f);
+}
+
+/*
+ * Initialize metadata page
+ */
+void
+SpGistInitMetapage(Page page)
+{
+	SpGistMetaPageData *metadata;
+
+	SpGistInitPage(page, SPGIST_META);
+	metadata = SpGistPageGetMeta(page);
+	memset(metadata, 0, sizeof(SpGistMetaPageData));
+	metadata->magicNumber = SPGIST_MAGIC_NUMBER;
+	metadata->lastInnerBlkno = InvalidBlockNumber;
+	metadata->lastLeafBlkno = InvalidBlockNumber;
+
+	/* Set pd_lower just past the end of the metadata */
+	((PageHeader) page)->pd_lower =
+		((char *) metadata + sizeof(SpGistMetaPageData)) - (char *) page;
+}
+
+/*
+ * Get the space needed to store a non-null datum of the indicated type.
+ * Note the result is already rounded up to a MAXALIGN boundary.
+ * Also, we follow the SPGiST convention that pass-by-val types are
+ * just stored in their Datum representation (compare memcpyDatum).
+ */
+unsigned int
+SpGistGetTypeSize(SpGistTypeDesc *att, Datum datum)
+{
+	unsigned int size;
+
+	if (att->attbyval)
+		size = sizeof(Datum);
+	else if (att->attlen > 0)
+		size = att->attlen;
+	else
+		size = VARSIZE_ANY(datum);
+
+	return MAXALIGN(size);
+}
+
+/*
+ * Copy the given non-null datum to *target
+ */
+static void
+memcpyDatum(void *target, SpGistTypeDesc *att, Datum datum)
+{
+	unsigned int size;
+
+	if (att->attbyval)
+	{
+		memcpy(target, &datum, sizeof(Datum));
+	}
+	else
+	{
+		size = (att->attlen > 0) ? att->attlen : VARSIZE_ANY(datum);
+		memcpy(target, DatumGetPointer(datum), size);
+	}
+}
+
+/*
+ * Construct a leaf tuple containing the given heap TID and datum value
+ */
+SpGistLeafTuple
+spgFormLeafTuple(SpGistState *state, ItemPointer heapPtr, Datum datum)
+{
+	SpGistLeafTuple tup;
+	unsigned int size;
+
+	/* compute space needed (note result is already maxaligned) */
+	size = SGLTHDRSZ + SpGistGetTypeSize(&state->attType, datum);
+
+	/*
+	 * Ensure that we can replace the tuple with a dead tuple later.  This
+	 * test is unnecessary given current tuple layouts, but let's be safe.
+	 */
+	if (size < SGDTSIZE)
+		size = SGDTSIZE;
+
+	/* OK, form the tuple */
+	tup = (SpGistLeafTuple) palloc0(size);
+
+	tup->size = size;
+	tup->nextOffset = InvalidOffsetNumber;
+	tup->heapPtr = *heapPtr;
+	memcpyDatum(SGLTDATAPTR(tup), &state->attType, datum);
+
+	return tup;
+}
+
+/*
+ * Construct a node (to go into an inner tuple) containing the given label
+ *
+ * Note that the node's downlink is just set invalid here.  Caller will fill
+ * it in later.
+ */
+SpGistNodeTuple
+spgFormNodeTuple(SpGistState *state, Datum label, bool isnull)
+{
+	SpGistNodeTuple tup;
+	unsigned int size;
+	unsigned short infomask = 0;
+
+	/* compute space needed (note result is already maxaligned) */
+	size = SGNTHDRSZ;
+	if (!isnull)
+		size += SpGistGetTypeSize(&state->attLabelType, label);
+
+	/*
+	 * Here we make sure that the size will fit in the field reserved for it
+	 * in t_info.
+	 */
+	if ((size & INDEX_SIZE_MASK) != size)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("index row requires %lu bytes, maximum size is %lu",
+						(unsigned long) size,
+						(unsigned long) INDEX_SIZE_MASK)));
+
+	tup = (SpGistNodeTuple) palloc0(size);
+
+	if (isnull)
+		infomask |= INDEX_NULL_MASK;
+	/* we don't bother setting the INDEX_VAR_MASK bit */
+	infomask |= size;
+	tup->t_info = infomask;
+
+	/* The TID field will be filled in later */
+	ItemPointerSetInvalid(&tup->t_tid);
+
+	if (!isnull)
+		memcpyDatum(SGNTDATAPTR(tup), &state->attLabelType, label);
+
+	return tup;
+}
+
+/*
+ * Construct an inner tuple containing the given prefix and node array
+ */
+SpGistInnerTuple
+spgFormInnerTuple(SpGistState *state, bool hasPrefix, Datum prefix,
+				  int nNodes, SpGistNodeTuple *nodes)
+{
+	SpGistInnerTuple tup;
+	unsigned int size;
+	unsigned int prefixSize;
+	int			i;
+	char	   *ptr;
+
+	/* Compute size needed */
+	if (hasPrefix)
+		prefixSize = SpGistGetTypeSize(&state->attPrefixType, prefix);
+	else
+		prefixSize = 0;
+
+	size = SGITHDRSZ + prefixSize;
+
+	/* Note: we rely on node tuple sizes to be maxaligned already */
+	for (i = 0; i < nNodes; i++)
+		size += IndexTupleSize(nodes[i]);
+
+	/*
+	 * Ensure that we can replace the tuple with a dead tuple later.  This
+	 * test is unnecessary given current tuple layouts, but let's be safe.
+	 */
+	if (size < SGDTSIZE)
+		size = SGDTSIZE;
+
+	/*
+	 * Inner tuple should be small enough to fit on a page
+	 */
+	if (size > SPGIST_PAGE_CAPACITY - sizeof(ItemIdData))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("SP-GiST inner tuple size %lu exceeds maximum %lu",
+						(unsigned long) size,
+				(unsigned long) (SPGIST_PAGE_CAPACITY - sizeof(ItemIdData))),
+			errhint("Values larger than a buffer page cannot be indexed.")));
+
+	/*
+	 * Check for overflow of header fields --- probably can't fail if the
+	 * above succeeded, but let's be paranoid
+	 */
+	if (size > SGITMAXSIZE ||
+		prefixSize > SGITMAXPREFIXSIZE ||
+		nNodes > SGITMAXNNODES)
+		elog(ERROR, "SPGiST inner tuple header field is too small");
+
+	/* OK, form the tuple */
+	tup = (SpGistInnerTuple) palloc0(size);
+
+	tup->nNodes = nNodes;
+	tup->prefixSize = prefixSize;
+	tup->size = size;
+
+	if (hasPrefix)
+		memcpyDatum(_SGITDATA(tup), &state->attPrefixType, prefix);
+
+	ptr = (char *) SGITNODEPTR(tup);
+
+	for (i = 0; i < nNodes; i++)
+	{
+		SpGistNodeTuple node = nodes[i];
+
+		memcpy(ptr, node, IndexTupleSize(node));
+		ptr += IndexTupleSize(node);
+	}
+
+	return tup;
+}
+
+/*
+ * Construct a "dead" tuple to replace a tuple being deleted.
+ *
+ * The state can be SPGIST_REDIRECT, SPGIST_DEAD, or SPGIST_PLACEHOLDER.
+ * For a REDIRECT tuple, a pointer (blkno+offset) must be supplied, and
+ * the xid field is filled in automatically.
+ */
+SpGistDeadTuple
+spgFormDeadTuple(SpGistState *state, int tupstate,
+				 BlockNumber blkno, OffsetNumber offnum)
+{
+	SpGistDeadTuple tuple = (SpGistDeadTuple) palloc0(SGDTSIZE);
+
+	tuple->tupstate = tupstate;
+	tuple->size = SGDTSIZE;
+	tuple->nextOffset = InvalidOffsetNumber;
+
+	if (tupstate == SPGIST_REDIRECT)
+	{
+		ItemPointerSet(&tuple->pointer, blkno, offnum);
+		tuple->xid = state->myXid;
+	}
+	else
+	{
+		ItemPointerSetInvalid(&tuple->pointer);
+		tuple->xid = InvalidTransactionId;
+	}
+
+	return tuple;
+}
+
+/*
+ * Extract the label datums of the nodes within innerTuple
+ *
+ * Returns NULL if label datums are NULLs
+ */
+Datum *
+spgExtractNodeLabels(SpGistState *state, SpGistInnerTuple innerTuple)
+{
+	Datum	   *nodeLabels;
+	int			i;
+	SpGistNodeTuple node;
+
+	/* Either all the labels must be NULL, or none. */
+	node = SGITNODEPTR(innerTuple);
+	if (IndexTupleHasNulls(node))
+	{
+		SGITITERATE(innerTuple, i, node)
+		{
+			if (!IndexTupleHasNulls(node))
+				elog(ERROR, "some but not all node labels are null in SPGiST inner tuple");
+		}
+		/* They're all null, so just return NULL */
+		return NULL;
+	}
+	else
+	{
+		nodeLabels = (Datum *) palloc(sizeof(Datum) * innerTuple->nNodes);
+		SGITITERATE(innerTuple, i, node)
+		{
+			if (IndexTupleHasNulls(node))
+				elog(ERROR, "some but not all node labels are null in SPGiST inner tuple");
+			nodeLabels[i] = SGNTDATUM(node, state);
+		}
+		return nodeLabels;
+	}
+}
+
+/*
+ * Add a new item to the page, replacing a PLACEHOLDER item if possible.
+ * Return the location it's inserted at, or error out if it doesn't fit.
+ *
+ * Placeholders keep their line pointers only so that the offsets of later
+ * items don't change; reusing them keeps pages from filling up with them.
+ */
+OffsetNumber
+SpGistPageAddNewItem(Page page, Item item, Size size)
+{
+	SpGistPageOpaque opaque = SpGistPageGetOpaque(page);
+	OffsetNumber i,
+				maxoff,
+				offnum;
+
+	if (opaque->nPlaceholder > 0 &&
+		PageGetExactFreeSpace(page) + SGDTSIZE >= MAXALIGN(size))
+	{
+		/* Try to replace a placeholder */
+		maxoff = PageGetMaxOffsetNumber(page);
+		for (i = FirstOffsetNumber; i <= maxoff; i++)
+		{
+			SpGistDeadTuple it = (SpGistDeadTuple) PageGetItem(page,
+												   PageGetItemId(page, i));
+
+			if (it->tupstate == SPGIST_PLACEHOLDER)
+			{
+				SpGistPageReplaceItem(page, i, item, size);
+				return i;
+			}
+		}
+
+		/* Hm, no placeholder found? */
+		elog(ERROR, "failed to find placeholder on SPGiST index page");
+	}
+
+	offnum = PageAddItem(page, item, size, InvalidOffsetNumber, false, false);
+
+	if (offnum == InvalidOffsetNumber)
+		elog(ERROR, "failed to add item of size %u to SPGiST index page",
+			 (int) size);
+
+	return offnum;
+}
+
+/*
+ * Replace the item at offnum with a new one, keeping its offset.
+ *
+ * The page's redirection and placeholder counts are kept up to date.  The
+ * caller must have made sure that the new item fits.
+ */
+void
+SpGistPageReplaceItem(Page page, OffsetNumber offnum, Item item, Size size)
+{
+	SpGistPageOpaque opaque = SpGistPageGetOpaque(page);
+	SpGistDeadTuple oldtup;
+	int			oldstate;
+	int			newstate = ((SpGistDeadTuple) item)->tupstate;
+
+	oldtup = (SpGistDeadTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	oldstate = oldtup->tupstate;
+
+	if (oldstate == SPGIST_REDIRECT)
+		opaque->nRedirection--;
+	else if (oldstate == SPGIST_PLACEHOLDER)
+		opaque->nPlaceholder--;
+
+	PageIndexTupleDelete(page, offnum);
+	if (PageAddItem(page, item, size, offnum, false, false) != offnum)
+		elog(ERROR, "failed to add item of size %u to SPGiST index page",
+			 (int) size);
+
+	if (newstate == SPGIST_REDIRECT)
+		opaque->nRedirection++;
+	else if (newstate == SPGIST_PLACEHOLDER)
+		opaque->nPlaceholder++;
+}
+
+Datum
+spgoptions(PG_FUNCTION_ARGS)
+{
+	Datum		reloptions = PG_GETARG_DATUM(0);
+	bool		validate = PG_GETARG_BOOL(1);
+	bytea	   *result;
+
+	result = default_reloptions(reloptions, validate, RELOPT_KIND_SPGIST);
+
+	if (result)
+		PG_RETURN_BYTEA_P(result);
+	PG_RETURN_NULL();
+}
@@ -0,0 +1,610 @@
+/*-------------------------------------------------------------------------
+ *
+ * spgvacuum.c
+ *	  vacuum for SP-GiST
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			$PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/spgist_private.h"
+#include "access/transam.h"
+#include "commands/vacuum.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+
+
+/* local state for vacuum operations */
+typedef struct spgBulkDeleteState
+{
+	/* Parameters passed in to spgvacuumscan */
+	IndexVacuumInfo *info;
+	IndexBulkDeleteResult *stats;
+	IndexBulkDeleteCallback callback;
+	void	   *callback_state;
+
+	/* Additional working state */
+	SpGistState spgstate;		/* for SPGiST operations that need one */
+	List	   *pendingList;	/* redirect targets still to be visited */
+	TransactionId myXmin;		/* for detecting newly-added redirects */
+} spgBulkDeleteState;
+
+
+/*
+ * Rewrite the page with the given items, one per offset from 1 to max.
+ *
+ * Placeholders at the end of the page are dropped, since no offsets need
+ * preserving after them.  The page is WAL-logged as a full image.
+ */
+static void
+spgRewritePage(Relation index, Buffer buffer, Item *items,
+			   OffsetNumber max, TransactionId newestRedirectXid)
+{
+	Page		page = BufferGetPage(buffer);
+	Page		newpage;
+	SpGistPageOpaque opaque;
+	OffsetNumber i;
+
+	while (max >= FirstOffsetNumber &&
+		   ((SpGistDeadTuple) items[max])->tupstate == SPGIST_PLACEHOLDER)
+		max--;
+
+	newpage = PageGetTempPageCopySpecial(page);
+	opaque = SpGistPageGetOpaque(newpage);
+	opaque->nRedirection = 0;
+	opaque->nPlaceholder = 0;
+
+	for (i = FirstOffsetNumber; i <= max; i++)
+	{
+		SpGistDeadTuple dt = (SpGistDeadTuple) items[i];
+		Size		size;
+
+		/* inner tuples keep their size elsewhere, but all are maxaligned */
+		if (SpGistPageIsLeaf(page) || dt->tupstate != SPGIST_LIVE)
+			size = dt->size;
+		else
+			size = ((SpGistInnerTuple) dt)->size;
+
+		if (PageAddItem(newpage, items[i], size, i, false, false) != i)
+			elog(ERROR, "failed to add item of size %u to SPGiST index page",
+				 (int) size);
+
+		if (dt->tupstate == SPGIST_REDIRECT)
+			opaque->nRedirection++;
+		else if (dt->tupstate == SPGIST_PLACEHOLDER)
+			opaque->nPlaceholder++;
+	}
+
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+	MarkBufferDirty(buffer);
+
+	spgLogPages(index, &buffer, 1, newestRedirectXid);
+
+	END_CRIT_SECTION();
+}
+
+/*
+ * Check whether a redirection tuple can be turned into a placeholder: it
+ * can once no running transaction could have seen the old downlink.  If
+ * not, remember its target, since the tuples it leads to may have been
+ * moved there from a page we have already vacuumed.
+ */
+static bool
+vacuumRedirect(spgBulkDeleteState *bds, SpGistDeadTuple dt, bool isLeaf,
+			   TransactionId *newestRedirectXid)
+{
+	if (!TransactionIdIsValid(dt->xid) ||
+		TransactionIdPrecedes(dt->xid, bds->myXmin))
+	{
+		if (TransactionIdIsValid(dt->xid) &&
+			(!TransactionIdIsValid(*newestRedirectXid) ||
+			 TransactionIdPrecedes(*newestRedirectXid, dt->xid)))
+			*newestRedirectXid = dt->xid;
+		return true;
+	}
+
+	/*
+	 * A moved inner tuple keeps its children where they were, so only
+	 * redirections left by leaf chains need to be followed.
+	 */
+	if (isLeaf)
+	{
+		ItemPointer ptr = (ItemPointer) palloc(sizeof(ItemPointerData));
+
+		*ptr = dt->pointer;
+		bds->pendingList = lappend(bds->pendingList, ptr);
+	}
+	return false;
+}
+
+/*
+ * Vacuum the root page when it is a leaf: its tuples aren't chained, so
+ * the dead ones can simply be removed.
+ */
+static void
+vacuumLeafRoot(spgBulkDeleteState *bds, Relation index, Buffer buffer)
+{
+	Page		page = BufferGetPage(buffer);
+	OffsetNumber toDelete[MaxIndexTuplesPerPage];
+	OffsetNumber i,
+				max = PageGetMaxOffsetNumber(page);
+	int			nDelete = 0;
+
+	for (i = FirstOffsetNumber; i <= max; i++)
+	{
+		SpGistLeafTuple lt;
+
+		lt = (SpGistLeafTuple) PageGetItem(page, PageGetItemId(page, i));
+		if (lt->tupstate != SPGIST_LIVE)
+			elog(ERROR, "unexpected SPGiST tuple state: %d", lt->tupstate);
+
+		if (bds->callback(&lt->heapPtr, bds->callback_state))
+		{
+			bds->stats->tuples_removed += 1;
+			toDelete[nDelete++] = i;
+		}
+		else
+			bds->stats->num_index_tuples += 1;
+	}
+
+	if (nDelete == 0)
+		return;
+
+	START_CRIT_SECTION();
+
+	PageIndexMultiDelete(page, toDelete, nDelete);
+	MarkBufferDirty(buffer);
+
+	spgLogPages(index, &buffer, 1, InvalidTransactionId);
+
+	END_CRIT_SECTION();
+}
+
+/*
+ * Vacuum the chains on a regular leaf page, or just the one whose head is
+ * at onlyHead if that's valid.
+ *
+ * Dead tuples in the middle of a chain become placeholders.  The head's
+ * offset must not change because the parent's downlink points to it, so if
+ * the head itself is dead it's replaced by the next live tuple of the chain,
+ * or by a DEAD tuple if none remain.
+ */
+static void
+vacuumLeafPage(spgBulkDeleteState *bds, Relation index, Buffer buffer,
+			   OffsetNumber onlyHead, bool countLive)
+{
+	Page		page = BufferGetPage(buffer);
+	OffsetNumber max = PageGetMaxOffsetNumber(page);
+	Item		items[MaxIndexTuplesPerPage + 1];
+	bool		isHead[MaxIndexTuplesPerPage + 1];
+	OffsetNumber survivors[MaxIndexTuplesPerPage];
+	SpGistDeadTuple placeholder,
+				dead;
+	TransactionId newestRedirectXid = InvalidTransactionId;
+	bool		changed = false;
+	OffsetNumber i,
+				j;
+
+	placeholder = spgFormDeadTuple(&bds->spgstate, SPGIST_PLACEHOLDER,
+								   InvalidBlockNumber, InvalidOffsetNumber);
+	dead = spgFormDeadTuple(&bds->spgstate, SPGIST_DEAD,
+							InvalidBlockNumber, InvalidOffsetNumber);
+
+	/* Find the chain heads: live tuples nobody else links to */
+	for (i = FirstOffsetNumber; i <= max; i++)
+	{
+		items[i] = PageGetItem(page, PageGetItemId(page, i));
+		isHead[i] = true;
+	}
+	for (i = FirstOffsetNumber; i <= max; i++)
+	{
+		SpGistLeafTuple lt = (SpGistLeafTuple) items[i];
+
+		if (lt->tupstate == SPGIST_LIVE &&
+			lt->nextOffset != InvalidOffsetNumber)
+		{
+			Assert(lt->nextOffset <= max);
+			isHead[lt->nextOffset] = false;
+		}
+	}
+
+	for (i = FirstOffsetNumber; i <= max; i++)
+	{
+		SpGistLeafTuple head = (SpGistLeafTuple) items[i];
+		int			nSurvivors = 0;
+		int			nDeleted = 0;
+		int			k;
+
+		if (!isHead[i])
+			continue;
+		if (onlyHead != InvalidOffsetNumber && i != onlyHead)
+			continue;
+
+		if (head->tupstate == SPGIST_REDIRECT)
+		{
+			if (vacuumRedirect(bds, (SpGistDeadTuple) head, true,
+							   &newestRedirectXid))
+			{
+				items[i] = (Item) placeholder;
+				changed = true;
+			}
+			continue;
+		}
+
+		/* DEAD heads must stay, and placeholders are no chain at all */
+		if (head->tupstate != SPGIST_LIVE)
+			continue;
+
+		for (j = i; j != InvalidOffsetNumber;
+			 j = ((SpGistLeafTuple) PageGetItem(page,
+									  PageGetItemId(page, j)))->nextOffset)
+		{
+			SpGistLeafTuple lt = (SpGistLeafTuple) items[j];
+
+			if (lt->tupstate != SPGIST_LIVE)
+				elog(ERROR, "unexpected SPGiST tuple state: %d",
+					 lt->tupstate);
+
+			if (bds->callback(&lt->heapPtr, bds->callback_state))
+			{
+				bds->stats->tuples_removed += 1;
+				items[j] = (Item) placeholder;
+				nDeleted++;
+			}
+			else
+			{
+				if (countLive)
+					bds->stats->num_index_tuples += 1;
+				survivors[nSurvivors++] = j;
+			}
+		}
+
+		if (nDeleted == 0)
+			continue;
+		changed = true;
+
+		if (nSurvivors == 0)
+		{
+			items[i] = (Item) dead;
+			continue;
+		}
+
+		/* Move the first survivor into the head's slot, if it isn't there */
+		if (survivors[0] != i)
+		{
+			items[i] = items[survivors[0]];
+			items[survivors[0]] = (Item) placeholder;
+			survivors[0] = i;
+		}
+
+		/* Relink the survivors, working on copies of them */
+		for (k = 0; k < nSurvivors; k++)
+		{
+			SpGistLeafTuple lt = (SpGistLeafTuple) items[survivors[k]];
+			SpGistLeafTuple copy = (SpGistLeafTuple) palloc(lt->size);
+
+			memcpy(copy, lt, lt->size);
+			copy->nextOffset = (k + 1 < nSurvivors) ?
+				survivors[k + 1] : InvalidOffsetNumber;
+			items[survivors[k]] = (Item) copy;
+		}
+	}
+
+	if (changed)
+		spgRewritePage(index, buffer, items, max, newestRedirectXid);
+}
+
+/*
+ * Vacuum an inner page: only old redirection tuples need attention
+ */
+static void
+vacuumInnerPage(spgBulkDeleteState *bds, Relation index, Buffer buffer)
+{
+	Page		page = BufferGetPage(buffer);
+	OffsetNumber max = PageGetMaxOffsetNumber(page);
+	Item		items[MaxIndexTuplesPerPage + 1];
+	SpGistDeadTuple placeholder;
+	TransactionId newestRedirectXid = InvalidTransactionId;
+	bool		changed = false;
+	OffsetNumber i;
+
+	if (SpGistPageGetOpaque(page)->nRedirection == 0)
+		return;
+
+	placeholder = spgFormDeadTuple(&bds->spgstate, SPGIST_PLACEHOLDER,
+								   InvalidBlockNumber, InvalidOffsetNumber);
+
+	for (i = FirstOffsetNumber; i <= max; i++)
+	{
+		SpGistDeadTuple dt;
+
+		items[i] = PageGetItem(page, PageGetItemId(page, i));
+		dt = (SpGistDeadTuple) items[i];
+
+		if (dt->tupstate == SPGIST_REDIRECT &&
+			vacuumRedirect(bds, dt, false, &newestRedirectXid))
+		{
+			items[i] = (Item) placeholder;
+			changed = true;
+		}
+	}
+
+	if (changed)
+		spgRewritePage(index, buffer, items, max, newestRedirectXid);
+}
+
+/*
+ * Process the targets of recent redirections found so far.  A chain that
+ * was moved is vacuumed at its new home; a chain that was split is now an
+ * inner tuple, all of whose subtrees are visited.  Nothing can be missed:
+ * the moves themselves happened under the insertion lock, and a subtree
+ * visited here twice does no harm.
+ */
+static void
+spgprocesspending(spgBulkDeleteState *bds)
+{
+	Relation	index = bds->info->index;
+
+	while (bds->pendingList != NIL)
+	{
+		ItemPointer ptr = (ItemPointer) linitial(bds->pendingList);
+		BlockNumber blkno = ItemPointerGetBlockNumber(ptr);
+		OffsetNumber offnum = ItemPointerGetOffsetNumber(ptr);
+		Buffer		buffer;
+		Page		page;
+
+		bds->pendingList = list_delete_first(bds->pendingList);
+		pfree(ptr);
+
+		vacuum_delay_point();
+
+		LockPage(index, SPGIST_METAPAGE_BLKNO, ExclusiveLock);
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno,
+									RBM_NORMAL, bds->info->strategy);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (PageIsNew(page) || SpGistPageIsMeta(page) ||
+			offnum > PageGetMaxOffsetNumber(page))
+		{
+			/* nothing there any more */
+		}
+		else if (SpGistPageIsLeaf(page))
+		{
+			if (blkno != SPGIST_ROOT_BLKNO)
+				vacuumLeafPage(bds, index, buffer, offnum, false);
+		}
+		else
+		{
+			SpGistInnerTuple innerTuple;
+
+			innerTuple = (SpGistInnerTuple) PageGetItem(page,
+												PageGetItemId(page, offnum));
+			if (innerTuple->tupstate == SPGIST_LIVE)
+			{
+				SpGistNodeTuple node;
+				int			i;
+
+				SGITITERATE(innerTuple, i, node)
+				{
+					if (ItemPointerIsValid(&node->t_tid))
+					{
+						ItemPointer child = palloc(sizeof(ItemPointerData));
+
+						*child = node->t_tid;
+						bds->pendingList = lappend(bds->pendingList, child);
+					}
+				}
+			}
+			else if (innerTuple->tupstate == SPGIST_REDIRECT)
+			{
+				ItemPointer next = palloc(sizeof(ItemPointerData));
+
+				*next = ((SpGistDeadTuple) innerTuple)->pointer;
+				bds->pendingList = lappend(bds->pendingList, next);
+			}
+		}
+
+		UnlockReleaseBuffer(buffer);
+		UnlockPage(index, SPGIST_METAPAGE_BLKNO, ExclusiveLock);
+	}
+}
+
+/*
+ * Process one page during a bulkdelete scan
+ */
+static void
+spgvacuumpage(spgBulkDeleteState *bds, BlockNumber blkno)
+{
+	Relation	index = bds->info->index;
+	Buffer		buffer;
+	Page		page;
+
+	/* call vacuum_delay_point while not holding any buffer lock */
+	vacuum_delay_point();
+
+	/* keep inserters out while we rearrange the page; see spginsert */
+	LockPage(index, SPGIST_METAPAGE_BLKNO, ExclusiveLock);
+
+	buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno,
+								RBM_NORMAL, bds->info->strategy);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	page = BufferGetPage(buffer);
+
+	if (PageIsNew(page))
+	{
+		/*
+		 * An all-zeroes page could be left over if a backend extends the
+		 * relation but crashes before initializing the page.  Such pages are
+		 * never reused, since SP-GiST doesn't recycle pages, so just skip it.
+		 */
+	}
+	else if (SpGistPageIsLeaf(page))
+	{
+		if (blkno == SPGIST_ROOT_BLKNO)
+			vacuumLeafRoot(bds, index, buffer);
+		else
+			vacuumLeafPage(bds, index, buffer, InvalidOffsetNumber, true);
+	}
+	else
+		vacuumInnerPage(bds, index, buffer);
+
+	UnlockReleaseBuffer(buffer);
+	UnlockPage(index, SPGIST_METAPAGE_BLKNO, ExclusiveLock);
+
+	spgprocesspending(bds);
+}
+
+/*
+ * Perform a bulkdelete scan
+ */
+static void
+spgvacuumscan(spgBulkDeleteState *bds)
+{
+	Relation	index = bds->info->index;
+	bool		needLock;
+	BlockNumber num_pages,
+				blkno;
+
+	/* Finish setting up spgBulkDeleteState */
+	initSpGistState(&bds->spgstate, index);
+	bds->pendingList = NIL;
+	bds->myXmin = GetOldestXmin(false, true);
+
+	/*
+	 * Reset counts that will be incremented during the scan; needed in case
+	 * of multiple scans during a single VACUUM command
+	 */
+	bds->stats->estimated_count = false;
+	bds->stats->num_index_tuples = 0;
+	bds->stats->pages_deleted = 0;
+	bds->stats->pages_free = 0;
+
+	/*
+	 * The outer loop iterates over all index pages except the metapage, in
+	 * physical order (we hope the kernel will cooperate in providing
+	 * read-ahead for speed).  It is critical that we visit all leaf pages,
+	 * including ones added after we start the scan, else we might fail to
+	 * delete some deletable tuples.  See more extensive comments about this
+	 * in btvacuumscan().
+	 */
+	needLock = !RELATION_IS_LOCAL(index);
+
+	blkno = SPGIST_ROOT_BLKNO;
+	for (;;)
+	{
+		/* Get the current relation length */
+		if (needLock)
+			LockRelationForExtension(index, ExclusiveLock);
+		num_pages = RelationGetNumberOfBlocks(index);
+		if (needLock)
+			UnlockRelationForExtension(index, ExclusiveLock);
+
+		/* Quit if we've scanned the whole relation */
+		if (blkno >= num_pages)
+			break;
+		/* Iterate over pages, then loop back to recheck length */
+		for (; blkno < num_pages; blkno++)
+			spgvacuumpage(bds, blkno);
+	}
+
+	/* Propagate local info into stats */
+	bds->stats->num_pages = num_pages;
+}
+
+/*
+ * Bulk deletion of all index entries pointing to a set of heap tuples.
+ * The set of target tuples is specified via a callback routine that tells
+ * whether any given heap tuple (identified by ItemPointer) is being deleted.
+ *
+ * Result: a palloc'd struct containing statistical info for VACUUM displays.
+ */
+Datum
+spgbulkdelete(PG_FUNCTION_ARGS)
+{
+	IndexVacuumInfo *info = (IndexVacuumInfo *) PG_GETARG_POINTER(0);
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+	IndexBulkDeleteCallback callback = (IndexBulkDeleteCallback) PG_GETARG_POINTER(2);
+	void	   *callback_state = (void *) PG_GETARG_POINTER(3);
+	spgBulkDeleteState bds;
+
+	/* allocate stats if first time through, else re-use existing struct */
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+	bds.info = info;
+	bds.stats = stats;
+	bds.callback = callback;
+	bds.callback_state = callback_state;
+
+	spgvacuumscan(&bds);
+
+	PG_RETURN_POINTER(stats);
+}
+
+/* Dummy callback to delete no tuples during spgvacuumcleanup */
+static bool
+dummy_callback(ItemPointer itemptr, void *state)
+{
+	return false;
+}
+
+/*
+ * Post-VACUUM cleanup.
+ *
+ * Result: a palloc'd struct containing statistical info for VACUUM displays.
+ */
+Datum
+spgvacuumcleanup(PG_FUNCTION_ARGS)
+{
+	IndexVacuumInfo *info = (IndexVacuumInfo *) PG_GETARG_POINTER(0);
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+	spgBulkDeleteState bds;
+
+	/* No-op in ANALYZE ONLY mode */
+	if (info->analyze_only)
+		PG_RETURN_POINTER(stats);
+
+	/*
+	 * We don't need to scan the index if there was a preceding bulkdelete
+	 * pass.  Otherwise, make a pass that won't delete any live tuples, but
+	 * might still accomplish useful stuff with redirect/placeholder cleanup,
+	 * and in any case will provide stats.
+	 */
+	if (stats == NULL)
+	{
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+		bds.info = info;
+		bds.stats = stats;
+		bds.callback = dummy_callback;
+		bds.callback_state = NULL;
+
+		spgvacuumscan(&bds);
+	}
+
+	/*
+	 * It's quite possible for us to be fooled by concurrent tuple moves into
+	 * double-counting some index tuples, so disbelieve any total that exceeds
+	 * the underlying heap's count ... if we know that accurately.  Otherwise
+	 * this might just make matters worse.
+	 */
+	if (!info->estimated_count)
+	{
+		if (stats->num_index_tuples > info->num_heap_tuples)
+			stats->num_index_tuples = info->num_heap_tuples;
+	}
+
+	PG_RETURN_POINTER(stats);
+}
@@ -0,0 +1,355 @@
+/*-------------------------------------------------------------------------
+ *
+ * spgxlog.c
+ *	  WAL replay logic for SP-GiST
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			 $PostgreSQL$
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/spgist_private.h"
+#include "access/transam.h"
+#include "access/xlogutils.h"
+#include "storage/bufmgr.h"
+#include "storage/standby.h"
+
+
+/*
+ * Write an XLOG_SPGIST_PAGES record holding full images of the given pages,
+ * and stamp them with its LSN.  The buffers must be distinct, exclusively
+ * locked, and already marked dirty; the caller must be inside the critical
+ * section in which the pages were changed.
+ *
+ * Logging whole pages keeps the structural operations simple to replay:
+ * they can move tuples among up to SPGIST_MAX_XLOG_PAGES pages at once,
+ * but happen far less often than plain leaf insertions.
+ */
+void
+spgLogPages(Relation index, Buffer *buffers, int nbuffers,
+			TransactionId newestRedirectXid)
+{
+	spgxlogPages xlrec;
+	spgxlogPageImage images[SPGIST_MAX_XLOG_PAGES];
+	XLogRecData rdata[1 + 3 * SPGIST_MAX_XLOG_PAGES];
+	XLogRecData *last;
+	XLogRecPtr	recptr;
+	int			i;
+
+	if (index->rd_istemp)
+		return;
+
+	Assert(nbuffers > 0 && nbuffers <= SPGIST_MAX_XLOG_PAGES);
+
+	xlrec.node = index->rd_node;
+	xlrec.newestRedirectXid = newestRedirectXid;
+	xlrec.nPages = nbuffers;
+
+	rdata[0].data = (char *) &xlrec;
+	rdata[0].len = sizeof(spgxlogPages);
+	rdata[0].buffer = InvalidBuffer;
+	rdata[0].next = NULL;
+	last = &rdata[0];
+
+	for (i = 0; i < nbuffers; i++)
+	{
+		Page		page = BufferGetPage(buffers[i]);
+		uint16		lower = ((PageHeader) page)->pd_lower;
+		uint16		upper = ((PageHeader) page)->pd_upper;
+		XLogRecData *rd = &rdata[1 + 3 * i];
+
+		images[i].blkno = BufferGetBlockNumber(buffers[i]);
+
+		/* Omit the unused space between pd_lower and pd_upper */
+		if (lower >= SizeOfPageHeaderData &&
+			upper > lower &&
+			upper <= BLCKSZ)
+		{
+			images[i].hole_offset = lower;
+			images[i].hole_length = upper - lower;
+		}
+		else
+		{
+			/* No "hole" to compress out */
+			images[i].hole_offset = 0;
+			images[i].hole_length = 0;
+		}
+
+		rd[0].data = (char *) &images[i];
+		rd[0].len = sizeof(spgxlogPageImage);
+		rd[0].buffer = InvalidBuffer;
+		rd[0].next = &rd[1];
+
+		rd[1].data = (char *) page;
+		rd[1].buffer = InvalidBuffer;
+		if (images[i].hole_length == 0)
+		{
+			rd[1].len = BLCKSZ;
+			rd[1].next = NULL;
+			last->next = &rd[0];
+			last = &rd[1];
+		}
+		else
+		{
+			rd[1].len = images[i].hole_offset;
+			rd[1].next = &rd[2];
+
+			rd[2].data = (char *) page + (images[i].hole_offset +
+										  images[i].hole_length);
+			rd[2].len = BLCKSZ - (images[i].hole_offset +
+								  images[i].hole_length);
+			rd[2].buffer = InvalidBuffer;
+			rd[2].next = NULL;
+			last->next = &rd[0];
+			last = &rd[2];
+		}
+	}
+
+	recptr = XLogInsert(RM_SPGIST_ID, XLOG_SPGIST_PAGES, rdata);
+
+	for (i = 0; i < nbuffers; i++)
+	{
+		Page		page = BufferGetPage(buffers[i]);
+
+		PageSetLSN(page, recptr);
+		PageSetTLI(page, ThisTimeLineID);
+	}
+}
+
+static void
+spgRedoCreateIndex(XLogRecPtr lsn, XLogRecord *record)
+{
+	RelFileNode *node = (RelFileNode *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	buffer = XLogReadBuffer(*node, SPGIST_METAPAGE_BLKNO, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+	SpGistInitMetapage(page);
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+
+	buffer = XLogReadBuffer(*node, SPGIST_ROOT_BLKNO, true);
+	Assert(BufferIsValid(buffer));
+	SpGistInitBuffer(buffer, SPGIST_LEAF);
+	page = (Page) BufferGetPage(buffer);
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+spgRedoAddLeaf(XLogRecPtr lsn, XLogRecord *record)
+{
+	char	   *ptr = XLogRecGetData(record);
+	spgxlogAddLeaf *xldata = (spgxlogAddLeaf *) ptr;
+	SpGistLeafTupleData leafTupleHdr;
+	Buffer		buffer;
+	Page		page;
+	int			bbi = 0;
+
+	/* the leaf tuple is unaligned, so make a copy to access its header */
+	ptr += sizeof(spgxlogAddLeaf);
+	memcpy(&leafTupleHdr, ptr, sizeof(SpGistLeafTupleData));
+
+	/*
+	 * A freshly initialized leaf page isn't registered as a backup block,
+	 * since the record carries everything needed to reconstruct it.
+	 */
+	if (xldata->newPage)
+	{
+		buffer = XLogReadBuffer(xldata->node, xldata->blknoLeaf, true);
+		SpGistInitBuffer(buffer, SPGIST_LEAF);
+	}
+	else if (!(record->xl_info & XLR_SET_BKP_BLOCK(bbi++)))
+		buffer = XLogReadBuffer(xldata->node, xldata->blknoLeaf, false);
+	else
+		buffer = InvalidBuffer;
+
+	if (BufferIsValid(buffer))
+	{
+		page = BufferGetPage(buffer);
+
+		if (xldata->newPage || !XLByteLE(lsn, PageGetLSN(page)))
+		{
+			/* insert new tuple, replacing a placeholder or dead head */
+			if (xldata->offnumLeaf <= PageGetMaxOffsetNumber(page))
+				SpGistPageReplaceItem(page, xldata->offnumLeaf,
+									  (Item) ptr, leafTupleHdr.size);
+			else if (PageAddItem(page, (Item) ptr, leafTupleHdr.size,
+								 xldata->offnumLeaf, false, false) !=
+					 xldata->offnumLeaf)
+				elog(ERROR, "failed to add item of size %u to SPGiST index page",
+					 leafTupleHdr.size);
+
+			/* link it into its chain */
+			if (xldata->offnumHeadLeaf != InvalidOffsetNumber)
+			{
+				SpGistLeafTuple head;
+
+				head = (SpGistLeafTuple) PageGetItem(page,
+								PageGetItemId(page, xldata->offnumHeadLeaf));
+				head->nextOffset = xldata->offnumLeaf;
+			}
+
+			PageSetLSN(page, lsn);
+			PageSetTLI(page, ThisTimeLineID);
+			MarkBufferDirty(buffer);
+		}
+		UnlockReleaseBuffer(buffer);
+	}
+
+	/* update parent downlink if necessary */
+	if (xldata->blknoParent != InvalidBlockNumber &&
+		!(record->xl_info & XLR_SET_BKP_BLOCK(bbi)))
+	{
+		buffer = XLogReadBuffer(xldata->node, xldata->blknoParent, false);
+		if (BufferIsValid(buffer))
+		{
+			page = BufferGetPage(buffer);
+			if (!XLByteLE(lsn, PageGetLSN(page)))
+			{
+				SpGistInnerTuple tuple;
+
+				tuple = (SpGistInnerTuple) PageGetItem(page,
+								  PageGetItemId(page, xldata->offnumParent));
+
+				spgUpdateNodeLink(tuple, xldata->nodeI,
+								  xldata->blknoLeaf, xldata->offnumLeaf);
+
+				PageSetLSN(page, lsn);
+				PageSetTLI(page, ThisTimeLineID);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+static void
+spgRedoPages(XLogRecPtr lsn, XLogRecord *record)
+{
+	char	   *ptr = XLogRecGetData(record);
+	spgxlogPages *xldata = (spgxlogPages *) ptr;
+	int			i;
+
+	ptr += sizeof(spgxlogPages);
+
+	for (i = 0; i < xldata->nPages; i++)
+	{
+		spgxlogPageImage image;
+		Buffer		buffer;
+		Page		page;
+
+		/* page image headers are not aligned in the record */
+		memcpy(&image, ptr, sizeof(spgxlogPageImage));
+		ptr += sizeof(spgxlogPageImage);
+
+		/* Like a backup block, the image replaces the page wholesale */
+		buffer = XLogReadBuffer(xldata->node, image.blkno, true);
+		Assert(BufferIsValid(buffer));
+		page = (Page) BufferGetPage(buffer);
+
+		if (image.hole_length == 0)
+		{
+			memcpy((char *) page, ptr, BLCKSZ);
+		}
+		else
+		{
+			/* must zero-fill the hole */
+			MemSet((char *) page, 0, BLCKSZ);
+			memcpy((char *) page, ptr, image.hole_offset);
+			memcpy((char *) page + (image.hole_offset + image.hole_length),
+				   ptr + image.hole_offset,
+				   BLCKSZ - (image.hole_offset + image.hole_length));
+		}
+		ptr += BLCKSZ - image.hole_length;
+
+		PageSetLSN(page, lsn);
+		PageSetTLI(page, ThisTimeLineID);
+		MarkBufferDirty(buffer);
+		UnlockReleaseBuffer(buffer);
+	}
+}
+
+void
+spg_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	/*
+	 * If VACUUM removed redirection tuples that standby queries might still
+	 * be about to follow, those queries must be cancelled before the page
+	 * images are installed.
+	 */
+	if (InHotStandby && info == XLOG_SPGIST_PAGES)
+	{
+		spgxlogPages *xldata = (spgxlogPages *) XLogRecGetData(record);
+
+		if (TransactionIdIsValid(xldata->newestRedirectXid))
+			ResolveRecoveryConflictWithSnapshot(xldata->newestRedirectXid,
+												xldata->node);
+	}
+
+	RestoreBkpBlocks(lsn, record, false);
+
+	switch (info)
+	{
+		case XLOG_SPGIST_CREATE_INDEX:
+			spgRedoCreateIndex(lsn, record);
+			break;
+		case XLOG_SPGIST_ADD_LEAF:
+			spgRedoAddLeaf(lsn, record);
+			break;
+		case XLOG_SPGIST_PAGES:
+			spgRedoPages(lsn, record);
+			break;
+		default:
+			elog(PANIC, "spg_redo: unknown op code %u", info);
+	}
+}
+
+static void
+out_target(StringInfo buf, RelFileNode node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u ",
+					 node.spcNode, node.dbNode, node.relNode);
+}
+
+void
+spg_desc(StringInfo buf, uint8 xl_info, char *rec)
+{
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_SPGIST_CREATE_INDEX:
+			appendStringInfo(buf, "create_index: rel %u/%u/%u",
+							 ((RelFileNode *) rec)->spcNode,
+							 ((RelFileNode *) rec)->dbNode,
+							 ((RelFileNode *) rec)->relNode);
+			break;
+		case XLOG_SPGIST_ADD_LEAF:
+			out_target(buf, ((spgxlogAddLeaf *) rec)->node);
+			appendStringInfo(buf, "add leaf to page: %u",
+							 ((spgxlogAddLeaf *) rec)->blknoLeaf);
+			break;
+		case XLOG_SPGIST_PAGES:
+			out_target(buf, ((spgxlogPages *) rec)->node);
+			appendStringInfo(buf, "page images: %u",
+							 ((spgxlogPages *) rec)->nPages);
+			break;
+		default:
+			appendStringInfo(buf, "unknown spgist op code %u", info);
+			break;
+	}
+}
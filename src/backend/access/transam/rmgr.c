@@ -7,6 +7,7 @@
  */
 #include "postgres.h"
 
+#include "access/brin.h"
 #include "access/clog.h"
 #include "access/gin.h"
 #include "access/gist_private.h"
@@ -14,6 +15,7 @@
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
+#include "access/spgist.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "catalog/storage.h"
@@ -41,5 +43,7 @@ const RmgrData RmgrTable[RM_MAX_ID + 1] = {
 	{"Hash", hash_redo, hash_desc, NULL, NULL, NULL},
 	{"Gin", gin_redo, gin_desc, gin_xlog_startup, gin_xlog_cleanup, gin_safe_restartpoint},
 	{"Gist", gist_redo, gist_desc, gist_xlog_startup, gist_xlog_cleanup, gist_safe_restartpoint},
-	{"Sequence", seq_redo, seq_desc, NULL, NULL, NULL}
+	{"Sequence", seq_redo, seq_desc, NULL, NULL, NULL},
+	{"SPGist", spg_redo, spg_desc, NULL, NULL, NULL},
+	{"BRIN", brin_redo, brin_desc, NULL, NULL, NULL}
 };
@@ -2586,7 +2586,7 @@ reindex_relation(Oid relid, bool toast_too, bool heap_rebuilt)
 
 	/* Ensure rd_indexattr is valid; see comments for RelationSetIndexList */
 	if (is_pg_class)
-		(void) RelationGetIndexAttrBitmap(rel);
+		(void) RelationGetIndexAttrBitmap(rel, INDEX_ATTR_BITMAP_HOT_BLOCKING);
 
 	PG_TRY();
 	{
@@ -33,6 +33,7 @@
 #include "libpq/pqformat.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "optimizer/clauses.h"
 #include "optimizer/planner.h"
 #include "parser/parse_relation.h"
 #include "rewrite/rewriteHandler.h"
@@ -150,6 +151,7 @@ typedef struct CopyStateData
 	 */
 	StringInfoData line_buf;
 	bool		line_buf_converted;		/* converted to server encoding? */
+	bool		line_buf_valid;	/* contains the row being processed? */
 
 	/*
 	 * Finally, raw_buf holds raw data read from the data source (file or
@@ -248,6 +250,12 @@ static void CopyTo(CopyState cstate);
 static void CopyOneRowTo(CopyState cstate, Oid tupleOid,
 			 Datum *values, bool *nulls);
 static void CopyFrom(CopyState cstate);
+static void CopyFromInsertBatch(CopyState cstate, EState *estate,
+					CommandId mycid, int hi_options,
+					ResultRelInfo *resultRelInfo, TupleTableSlot *slot,
+					BulkInsertState bistate,
+					int nBufferedTuples, HeapTuple *bufferedTuples,
+					int *bufferedLineNos);
 static bool CopyReadLine(CopyState cstate);
 static bool CopyReadLineText(CopyState cstate);
 static int CopyReadAttributesText(CopyState cstate, int maxfields,
@@ -1596,7 +1604,17 @@ copy_in_error_callback(void *arg)
 		else
 		{
 			/* error is relevant to a particular line */
-			if (cstate->line_buf_converted || !cstate->need_transcoding)
+			if (!cstate->line_buf_valid)
+			{
+				/*
+				 * The row was buffered for a multi-insert and line_buf has
+				 * since been overwritten by later input lines, so we can
+				 * only report the line number.
+				 */
+				errcontext("COPY %s, line %d",
+						   cstate->cur_relname, cstate->cur_lineno);
+			}
+			else if (cstate->line_buf_converted || !cstate->need_transcoding)
 			{
 				char	   *lineval;
 
@@ -1657,6 +1675,13 @@ limit_printout_length(const char *str)
 	return res;
 }
 
+/*
+ * Maximum number of rows, and total size of their tuples, that CopyFrom
+ * buffers before handing them to heap_multi_insert.
+ */
+#define MAX_BUFFERED_TUPLES		1000
+#define MAX_BUFFERED_BYTES		65535
+
 /*
  * Copy FROM file to relation.
  */
@@ -1695,6 +1720,12 @@ CopyFrom(CopyState cstate)
 	CommandId	mycid = GetCurrentCommandId(true);
 	int			hi_options = 0; /* start with default heap_insert options */
 	BulkInsertState bistate;
+	bool		volatile_defexprs = false;
+	bool		useHeapMultiInsert;
+	HeapTuple  *bufferedTuples = NULL;
+	int			nBufferedTuples = 0;
+	Size		bufferedTuplesSize = 0;
+	int		   *bufferedLineNos = NULL;
 
 	Assert(cstate->rel);
 
@@ -1849,6 +1880,9 @@ CopyFrom(CopyState cstate)
 
 			if (defexpr != NULL)
 			{
+				/* a volatile default rules out buffering rows, see below */
+				if (contain_volatile_functions(defexpr))
+					volatile_defexprs = true;
 				defexprs[num_defaults] = ExecPrepareExpr((Expr *) defexpr,
 														 estate);
 				defmap[num_defaults] = attnum - 1;
@@ -1857,6 +1891,27 @@ CopyFrom(CopyState cstate)
 		}
 	}
 
+	/*
+	 * It's more efficient to collect a batch of tuples and insert them with
+	 * one heap_multi_insert() call, which fills each page under a single
+	 * buffer lock and writes one WAL record per page, than to call
+	 * heap_insert() for every row.  We can't do that if there are BEFORE ROW
+	 * triggers, since they may inspect the table and expect to see the rows
+	 * inserted so far, or if any default expression is volatile, since it
+	 * might likewise query the table (nextval() is also volatile, so tables
+	 * with serial columns miss out, unfortunately).  AFTER ROW triggers are
+	 * all right: their events are queued after each batch is stored and they
+	 * don't fire until the end of the statement anyway.
+	 */
+	useHeapMultiInsert = !volatile_defexprs &&
+		!(resultRelInfo->ri_TrigDesc &&
+		  resultRelInfo->ri_TrigDesc->n_before_row[TRIGGER_EVENT_INSERT] > 0);
+	if (useHeapMultiInsert)
+	{
+		bufferedTuples = (HeapTuple *) palloc(MAX_BUFFERED_TUPLES * sizeof(HeapTuple));
+		bufferedLineNos = (int *) palloc(MAX_BUFFERED_TUPLES * sizeof(int));
+	}
+
 	/* Prepare to catch AFTER triggers. */
 	AfterTriggerBeginQuery();
 
@@ -1930,6 +1985,7 @@ CopyFrom(CopyState cstate)
 	cstate->cur_lineno = 0;
 	cstate->cur_attname = NULL;
 	cstate->cur_attval = NULL;
+	cstate->line_buf_valid = true;
 
 	bistate = GetBulkInsertState();
 
@@ -1955,8 +2011,12 @@ CopyFrom(CopyState cstate)
 
 		cstate->cur_lineno++;
 
-		/* Reset the per-tuple exprcontext */
-		ResetPerTupleExprContext(estate);
+		/*
+		 * Reset the per-tuple exprcontext.  Buffered tuples live in it, so
+		 * we can only do this while the buffer is empty.
+		 */
+		if (nBufferedTuples == 0)
+			ResetPerTupleExprContext(estate);
 
 		/* Switch into its memory context */
 		MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
@@ -2156,18 +2216,44 @@ CopyFrom(CopyState cstate)
 			if (cstate->rel->rd_att->constr)
 				ExecConstraints(resultRelInfo, slot, estate);
 
-			/* OK, store the tuple and create index entries for it */
-			heap_insert(cstate->rel, tuple, mycid, hi_options, bistate);
+			if (useHeapMultiInsert)
+			{
+				/*
+				 * Add this tuple to the buffer, and flush it when full.  A
+				 * CSV row can span several lines, so remember the line
+				 * number of each row for error reports.
+				 */
+				bufferedLineNos[nBufferedTuples] = cstate->cur_lineno;
+				bufferedTuples[nBufferedTuples++] = tuple;
+				bufferedTuplesSize += tuple->t_len;
 
-			if (resultRelInfo->ri_NumIndices > 0)
-				recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
-													   estate);
+				if (nBufferedTuples == MAX_BUFFERED_TUPLES ||
+					bufferedTuplesSize > MAX_BUFFERED_BYTES)
+				{
+					CopyFromInsertBatch(cstate, estate, mycid, hi_options,
+										resultRelInfo, slot, bistate,
+										nBufferedTuples, bufferedTuples,
+										bufferedLineNos);
+					nBufferedTuples = 0;
+					bufferedTuplesSize = 0;
+				}
+			}
+			else
+			{
+				/* OK, store the tuple and create index entries for it */
+				heap_insert(cstate->rel, tuple, mycid, hi_options, bistate);
 
-			/* AFTER ROW INSERT Triggers */
-			ExecARInsertTriggers(estate, resultRelInfo, tuple,
-								 recheckIndexes);
+				if (resultRelInfo->ri_NumIndices > 0)
+					recheckIndexes = ExecInsertIndexTuples(slot,
+														   &(tuple->t_self),
+														   estate, false);
 
-			list_free(recheckIndexes);
+				/* AFTER ROW INSERT Triggers */
+				ExecARInsertTriggers(estate, resultRelInfo, tuple,
+									 recheckIndexes);
+
+				list_free(recheckIndexes);
+			}
 
 			/*
 			 * We count only tuples not suppressed by a BEFORE INSERT trigger;
@@ -2178,6 +2264,13 @@ CopyFrom(CopyState cstate)
 		}
 	}
 
+	/* Flush any remaining buffered tuples */
+	if (nBufferedTuples > 0)
+		CopyFromInsertBatch(cstate, estate, mycid, hi_options,
+							resultRelInfo, slot, bistate,
+							nBufferedTuples, bufferedTuples,
+							bufferedLineNos);
+
 	/* Done, clean up */
 	error_context_stack = errcontext.previous;
 
@@ -2199,6 +2292,10 @@ CopyFrom(CopyState cstate)
 	pfree(typioparams);
 	pfree(defmap);
 	pfree(defexprs);
+	if (bufferedTuples)
+		pfree(bufferedTuples);
+	if (bufferedLineNos)
+		pfree(bufferedLineNos);
 
 	ExecResetTupleTable(estate->es_tupleTable, false);
 
@@ -2223,6 +2320,69 @@ CopyFrom(CopyState cstate)
 		heap_sync(cstate->rel);
 }
 
+/*
+ * A subroutine of CopyFrom, to write the current batch of buffered heap
+ * tuples to the heap.  Also updates indexes and queues AFTER ROW triggers.
+ */
+static void
+CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
+					int hi_options, ResultRelInfo *resultRelInfo,
+					TupleTableSlot *slot, BulkInsertState bistate,
+					int nBufferedTuples, HeapTuple *bufferedTuples,
+					int *bufferedLineNos)
+{
+	MemoryContext oldcontext;
+	int			i;
+	int			save_cur_lineno;
+
+	/*
+	 * Errors from here on belong to an earlier row than the one in line_buf,
+	 * so make the error context callback report just the line number.
+	 */
+	save_cur_lineno = cstate->cur_lineno;
+	cstate->line_buf_valid = false;
+
+	/*
+	 * heap_multi_insert leaks memory, so switch to short-lived memory context
+	 * before calling it.
+	 */
+	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	heap_multi_insert(cstate->rel,
+					  bufferedTuples,
+					  nBufferedTuples,
+					  mycid,
+					  hi_options,
+					  bistate);
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * Now create index entries and queue AFTER ROW INSERT triggers for each
+	 * tuple, in the order the rows were read.
+	 */
+	for (i = 0; i < nBufferedTuples; i++)
+	{
+		List	   *recheckIndexes = NIL;
+
+		cstate->cur_lineno = bufferedLineNos[i];
+
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			ExecStoreTuple(bufferedTuples[i], slot, InvalidBuffer, false);
+			recheckIndexes = ExecInsertIndexTuples(slot,
+												   &(bufferedTuples[i]->t_self),
+												   estate, false);
+		}
+
+		ExecARInsertTriggers(estate, resultRelInfo, bufferedTuples[i],
+							 recheckIndexes);
+
+		list_free(recheckIndexes);
+	}
+
+	cstate->line_buf_valid = true;
+	cstate->cur_lineno = save_cur_lineno;
+}
+
 
 /*
  * Read the next input line and stash it in line_buf, with conversion to
@@ -71,10 +71,15 @@ static void show_scan_qual(List *qual, const char *qlabel,
 static void show_upper_qual(List *qual, const char *qlabel,
 							PlanState *planstate, List *ancestors,
 							ExplainState *es);
-static void show_sort_keys(SortState *sortstate, List *ancestors,
-						   ExplainState *es);
+static void show_sort_keys(PlanState *planstate, const char *qlabel,
+			   int nkeys, AttrNumber *keycols,
+			   List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
+static void show_incremental_sort_info(IncrementalSortState *sortstate,
+						   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_memoize_info(MemoizeState *mstate, List *ancestors,
+				  ExplainState *es);
 static const char *explain_get_index_name(Oid indexId);
 static void ExplainScanTarget(Scan *plan, ExplainState *es);
 static void ExplainMemberNodes(List *plans, PlanState **planstates,
@@ -700,9 +705,15 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Material:
 			pname = sname = "Materialize";
 			break;
+		case T_Memoize:
+			pname = sname = "Memoize";
+			break;
 		case T_Sort:
 			pname = sname = "Sort";
 			break;
+		case T_IncrementalSort:
+			pname = sname = "Incremental Sort";
+			break;
 		case T_Group:
 			pname = sname = "Group";
 			break;
@@ -1071,9 +1082,24 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
 			break;
 		case T_Sort:
-			show_sort_keys((SortState *) planstate, ancestors, es);
+			show_sort_keys(planstate, "Sort Key",
+						   ((Sort *) plan)->numCols,
+						   ((Sort *) plan)->sortColIdx,
+						   ancestors, es);
 			show_sort_info((SortState *) planstate, es);
 			break;
+		case T_IncrementalSort:
+			show_sort_keys(planstate, "Sort Key",
+						   ((IncrementalSort *) plan)->sort.numCols,
+						   ((IncrementalSort *) plan)->sort.sortColIdx,
+						   ancestors, es);
+			show_sort_keys(planstate, "Presorted Key",
+						   ((IncrementalSort *) plan)->presortedCols,
+						   ((IncrementalSort *) plan)->sort.sortColIdx,
+						   ancestors, es);
+			show_incremental_sort_info((IncrementalSortState *) planstate,
+									   es);
+			break;
 		case T_Result:
 			show_upper_qual((List *) ((Result *) plan)->resconstantqual,
 							"One-Time Filter", planstate, ancestors, es);
@@ -1082,6 +1108,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Hash:
 			show_hash_info((HashState *) planstate, es);
 			break;
+		case T_Memoize:
+			show_memoize_info((MemoizeState *) planstate, ancestors, es);
+			break;
 		default:
 			break;
 	}
@@ -1363,14 +1392,14 @@ show_upper_qual(List *qual, const char *qlabel,
 }
 
 /*
- * Show the sort keys for a Sort node.
+ * Show the sort keys for a Sort or IncrementalSort node.
  */
 static void
-show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
+show_sort_keys(PlanState *planstate, const char *qlabel,
+			   int nkeys, AttrNumber *keycols,
+			   List *ancestors, ExplainState *es)
 {
-	Sort	   *plan = (Sort *) sortstate->ss.ps.plan;
-	int			nkeys = plan->numCols;
-	AttrNumber *keycols = plan->sortColIdx;
+	Plan	   *plan = planstate->plan;
 	List	   *context;
 	List	   *result = NIL;
 	bool		useprefix;
@@ -1381,7 +1410,7 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 		return;
 
 	/* Set up deparsing context */
-	context = deparse_context_for_planstate((Node *) sortstate,
+	context = deparse_context_for_planstate((Node *) planstate,
 											ancestors,
 											es->rtable);
 	useprefix = (list_length(es->rtable) > 1 || es->verbose);
@@ -1390,7 +1419,7 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 	{
 		/* find key expression in tlist */
 		AttrNumber	keyresno = keycols[keyno];
-		TargetEntry *target = get_tle_by_resno(plan->plan.targetlist,
+		TargetEntry *target = get_tle_by_resno(plan->targetlist,
 											   keyresno);
 
 		if (!target)
@@ -1401,7 +1430,7 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 		result = lappend(result, exprstr);
 	}
 
-	ExplainPropertyList("Sort Key", result, es);
+	ExplainPropertyList(qlabel, result, es);
 }
 
 /*
@@ -1436,6 +1465,110 @@ show_sort_info(SortState *sortstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show how many groups an incremental sort had to
+ * sort, and the space used by the biggest of those sorts
+ */
+static void
+show_incremental_sort_info(IncrementalSortState *sortstate,
+						   ExplainState *es)
+{
+	long		spaceUsed = sortstate->max_space_used;
+	const char *spaceType = sortstate->max_space_type;
+
+	Assert(IsA(sortstate, IncrementalSortState));
+	if (!es->analyze)
+		return;
+
+	/* The last group's sort may still be open */
+	if (sortstate->tuplesortstate != NULL)
+	{
+		const char *sortMethod;
+		const char *curSpaceType;
+		long		curSpaceUsed;
+
+		tuplesort_get_stats((Tuplesortstate *) sortstate->tuplesortstate,
+							&sortMethod, &curSpaceType, &curSpaceUsed);
+		if (spaceType == NULL || curSpaceUsed > spaceUsed)
+		{
+			spaceUsed = curSpaceUsed;
+			spaceType = curSpaceType;
+		}
+	}
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		if (spaceType != NULL)
+			appendStringInfo(es->str,
+							 "Sort Groups: " INT64_FORMAT "  Peak %s: %ldkB\n",
+							 sortstate->groups_sorted, spaceType, spaceUsed);
+		else
+			appendStringInfo(es->str, "Sort Groups: " INT64_FORMAT "\n",
+							 sortstate->groups_sorted);
+	}
+	else
+	{
+		ExplainPropertyLong("Sort Groups", (long) sortstate->groups_sorted,
+							es);
+		if (spaceType != NULL)
+		{
+			ExplainPropertyLong("Peak Sort Space Used", spaceUsed, es);
+			ExplainPropertyText("Peak Sort Space Type", spaceType, es);
+		}
+	}
+}
+
+/*
+ * Show the cache key of a Memoize node, and for EXPLAIN ANALYZE, how well
+ * the cache worked
+ */
+static void
+show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
+{
+	Memoize    *plan = (Memoize *) mstate->ss.ps.plan;
+	List	   *context;
+	List	   *result = NIL;
+	bool		useprefix;
+	ListCell   *lc;
+	long		memPeakKb;
+
+	/* Set up deparsing context */
+	context = deparse_context_for_planstate((Node *) mstate,
+											ancestors,
+											es->rtable);
+	useprefix = (list_length(es->rtable) > 1 || es->verbose);
+
+	foreach(lc, plan->param_exprs)
+	{
+		result = lappend(result,
+						 deparse_expression((Node *) lfirst(lc), context,
+											useprefix, true));
+	}
+	ExplainPropertyList("Cache Key", result, es);
+
+	if (!es->analyze)
+		return;
+
+	memPeakKb = (mstate->mem_peak + 1023) / 1024;
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Hits: %ld  Misses: %ld  Evictions: %ld  Overflows: %ld  Memory Usage: %ldkB\n",
+						 mstate->hits, mstate->misses, mstate->evictions,
+						 mstate->overflows, memPeakKb);
+	}
+	else
+	{
+		ExplainPropertyLong("Cache Hits", mstate->hits, es);
+		ExplainPropertyLong("Cache Misses", mstate->misses, es);
+		ExplainPropertyLong("Cache Evictions", mstate->evictions, es);
+		ExplainPropertyLong("Cache Overflows", mstate->overflows, es);
+		ExplainPropertyLong("Peak Memory Usage", memPeakKb, es);
+	}
+}
+
 /*
  * Show information on hash buckets/batches.
  */
@@ -1458,6 +1591,8 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 			ExplainPropertyLong("Original Hash Batches",
 								hashtable->nbatch_original, es);
 			ExplainPropertyLong("Peak Memory Usage", spacePeakKb, es);
+			ExplainPropertyLong("Batches Joined in Chunks",
+								hashtable->nbatchFallback, es);
 		}
 		else if (hashtable->nbatch_original != hashtable->nbatch)
 		{
@@ -1475,6 +1610,33 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 							 hashtable->nbuckets, hashtable->nbatch,
 							 spacePeakKb);
 		}
+
+		if (hashtable->nbatchFallback > 0 && es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str,
+							 "Batches Joined in Chunks: %d\n",
+							 hashtable->nbatchFallback);
+		}
+
+		if (hashtable->bloomProbes > 0)
+		{
+			if (es->format != EXPLAIN_FORMAT_TEXT)
+			{
+				ExplainPropertyFloat("Bloom Filter Probes",
+									 hashtable->bloomProbes, 0, es);
+				ExplainPropertyFloat("Bloom Filter Rejections",
+									 hashtable->bloomRejected, 0, es);
+			}
+			else
+			{
+				appendStringInfoSpaces(es->str, es->indent * 2);
+				appendStringInfo(es->str,
+								 "Bloom Filter Probes: %.0f  Rejections: %.0f\n",
+								 hashtable->bloomProbes,
+								 hashtable->bloomRejected);
+			}
+		}
 	}
 }
 
@@ -4,24 +4,25 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead
+ * The major space usage for LAZY VACUUM is storage for the set of dead
  * tuple TIDs, with the next biggest need being storage for per-disk-page
  * free space info.  We want to ensure we can vacuum even the very largest
  * relations with finite memory space usage.  To do that, we set upper bounds
  * on the number of tuples and pages we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem memory space to keep
- * track of dead tuples.  We initially allocate an array of TIDs of that size,
- * with an upper limit that depends on table size (this limit ensures we don't
- * allocate a huge area uselessly for vacuuming small tables).	If the array
- * threatens to overflow, we suspend the heap scan phase and perform a pass of
+ * track of dead tuples.  The TIDs are kept in a TidStore (see
+ * lib/tidstore.c), which stores each heap page's dead tuples as a bitmap and
+ * allocates memory as it fills up, so vacuuming a small table doesn't
+ * allocate a huge area uselessly.  If the store threatens to outgrow
+ * maintenance_work_mem, we suspend the heap scan phase and perform a pass of
  * index cleanup and page compaction, then resume the heap scan with an empty
- * TID array.
+ * TID store.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * a TID store at all, just an array of the dead tuples on the current page.
  *
  *
  * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
@@ -44,6 +45,7 @@
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
 #include "commands/vacuum.h"
+#include "lib/tidstore.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
@@ -66,13 +68,6 @@
 #define REL_TRUNCATE_MINIMUM	1000
 #define REL_TRUNCATE_FRACTION	16
 
-/*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
- */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
-
 /*
  * Before we consider skipping a page that's marked as clean in
  * visibility map, we must've seen at least this many clean pages.
@@ -84,6 +79,7 @@ typedef struct LVRelStats
 	/* hasindex = true means two-pass strategy; false means one-pass */
 	bool		hasindex;
 	bool		scanned_all;	/* have we scanned all pages (this far)? */
+	bool		scanned_all_unfrozen;	/* ... all pages not all-frozen? */
 	/* Overall statistics about rel */
 	BlockNumber rel_pages;
 	double		old_rel_tuples; /* previous value of pg_class.reltuples */
@@ -91,11 +87,8 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* Set of TIDs of tuples we intend to delete (NULL if no indexes) */
+	TidStore   *dead_tuples;
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 } LVRelStats;
@@ -120,16 +113,17 @@ static void lazy_vacuum_index(Relation indrel,
 static void lazy_cleanup_index(Relation indrel,
 				   IndexBulkDeleteResult *stats,
 				   LVRelStats *vacrelstats);
-static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats);
+static void lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+				 OffsetNumber *deadoffsets, int ndeadoffsets,
+				 LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
-static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
+static bool lazy_tuple_is_frozen(HeapTupleHeader tuple);
+static void lazy_set_visible(Relation onerel, BlockNumber blkno, Page page,
+				 Buffer *vmbuffer, uint8 flags);
 
 
 /*
@@ -176,6 +170,7 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	vacrelstats = (LVRelStats *) palloc0(sizeof(LVRelStats));
 
 	vacrelstats->scanned_all = true;	/* will be cleared if we skip a page */
+	vacrelstats->scanned_all_unfrozen = true;
 	vacrelstats->old_rel_tuples = onerel->rd_rel->reltuples;
 	vacrelstats->num_index_scans = 0;
 
@@ -218,6 +213,18 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 							vacrelstats->hasindex,
 							FreezeLimit);
 
+	/*
+	 * If we skipped only pages marked all-frozen, we can't trust the tuple
+	 * count, but every tuple older than FreezeLimit has still been frozen, so
+	 * we can advance relfrozenxid while keeping the old relpages/reltuples.
+	 */
+	else if (vacrelstats->scanned_all_unfrozen)
+		vac_update_relstats(onerel,
+							onerel->rd_rel->relpages,
+							onerel->rd_rel->reltuples,
+							vacrelstats->hasindex,
+							FreezeLimit);
+
 	/* report results to the stats collector, too */
 	pgstat_report_vacuum(RelationGetRelid(onerel),
 						 onerel->rd_rel->relisshared,
@@ -343,12 +350,16 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
+		OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+		int			ndeadoffsets;
 		OffsetNumber frozen[MaxOffsetNumber];
 		int			nfrozen;
 		Size		freespace;
-		bool		all_visible_according_to_vm = false;
+		uint8		vmstatus;
+		bool		all_visible_according_to_vm;
+		bool		all_frozen_according_to_vm;
 		bool		all_visible;
+		bool		all_frozen;
 
 		/*
 		 * Skip pages that don't require vacuuming according to the visibility
@@ -357,26 +368,32 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * sequentially, the OS should be doing readahead for us and there's
 		 * no gain in skipping a page now and then. You need a longer run of
 		 * consecutive skipped pages before it's worthwhile. Also, skipping
-		 * even a single page means that we can't update relfrozenxid or
-		 * reltuples, so we only want to do it if there's a good chance to
-		 * skip a goodly number of pages.
+		 * even a single page means that we can't update reltuples, nor
+		 * relfrozenxid unless the page is marked all-frozen, so we only want
+		 * to do it if there's a good chance to skip a goodly number of pages.
+		 *
+		 * When scan_all is set, we must visit every page that might contain
+		 * xids older than FreezeLimit, so only pages marked all-frozen can be
+		 * skipped.  Such pages hold no unfrozen xids at all.
 		 */
-		if (!scan_all)
+		vmstatus = visibilitymap_get_status(onerel, blkno, &vmbuffer);
+		all_visible_according_to_vm =
+			(vmstatus & VISIBILITYMAP_ALL_VISIBLE) != 0;
+		all_frozen_according_to_vm =
+			(vmstatus & VISIBILITYMAP_ALL_FROZEN) != 0;
+		if (scan_all ? all_frozen_according_to_vm : all_visible_according_to_vm)
 		{
-			all_visible_according_to_vm =
-				visibilitymap_test(onerel, blkno, &vmbuffer);
-			if (all_visible_according_to_vm)
+			all_visible_streak++;
+			if (all_visible_streak >= SKIP_PAGES_THRESHOLD)
 			{
-				all_visible_streak++;
-				if (all_visible_streak >= SKIP_PAGES_THRESHOLD)
-				{
-					vacrelstats->scanned_all = false;
-					continue;
-				}
+				vacrelstats->scanned_all = false;
+				if (!all_frozen_according_to_vm)
+					vacrelstats->scanned_all_unfrozen = false;
+				continue;
 			}
-			else
-				all_visible_streak = 0;
 		}
+		else
+			all_visible_streak = 0;
 
 		vacuum_delay_point();
 
@@ -386,8 +403,9 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (vacrelstats->hasindex &&
+			tidstore_is_full(vacrelstats->dead_tuples) &&
+			tidstore_num_tids(vacrelstats->dead_tuples) > 0)
 		{
 			/* Log cleanup info before we touch indexes */
 			vacuum_log_cleanup_info(onerel, vacrelstats);
@@ -405,10 +423,19 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			tidstore_reset(vacrelstats->dead_tuples);
 			vacrelstats->num_index_scans++;
 		}
 
+		/*
+		 * Pin the visibility map page before locking the heap page, so that
+		 * we can set the page's bits without releasing the lock.  That is
+		 * needed for the all-frozen bit: a concurrent row lock could
+		 * otherwise store an xid on the page, and clear the bit, between our
+		 * freezing check and our setting the bit.
+		 */
+		visibilitymap_pin(onerel, blkno, &vmbuffer);
+
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
 								 RBM_NORMAL, vac_strategy);
 
@@ -470,19 +497,13 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				SetBufferCommitInfoNeedsSave(buf);
 			}
 
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-
-			/* Update the visibility map */
-			if (!all_visible_according_to_vm)
-			{
-				visibilitymap_pin(onerel, blkno, &vmbuffer);
-				LockBuffer(buf, BUFFER_LOCK_SHARE);
-				if (PageIsAllVisible(page))
-					visibilitymap_set(onerel, blkno, PageGetLSN(page), &vmbuffer);
-				LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			}
+			/* Update the visibility map; an empty page is all-frozen, too */
+			if (!all_frozen_according_to_vm)
+				lazy_set_visible(onerel, blkno, page, &vmbuffer,
+								 VISIBILITYMAP_ALL_VISIBLE |
+								 VISIBILITYMAP_ALL_FROZEN);
 
-			ReleaseBuffer(buf);
+			UnlockReleaseBuffer(buf);
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 			continue;
 		}
@@ -500,9 +521,10 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * requiring freezing.
 		 */
 		all_visible = true;
+		all_frozen = true;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
+		ndeadoffsets = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 		for (offnum = FirstOffsetNumber;
 			 offnum <= maxoff;
@@ -536,7 +558,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 */
 			if (ItemIdIsDead(itemid))
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
 				all_visible = false;
 				continue;
 			}
@@ -636,7 +658,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 			if (tupgone)
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
 				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
 											 &vacrelstats->latestRemovedXid);
 				tups_vacuumed += 1;
@@ -653,6 +675,9 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				if (heap_freeze_tuple(tuple.t_data, FreezeLimit,
 									  InvalidBuffer))
 					frozen[nfrozen++] = offnum;
+
+				if (all_frozen && !lazy_tuple_is_frozen(tuple.t_data))
+					all_frozen = false;
 			}
 		}						/* scan along page */
 
@@ -678,21 +703,21 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 		/*
 		 * If there are no indexes then we can vacuum the page right now
-		 * instead of doing a second scan.
+		 * instead of doing a second scan.  Otherwise remember the dead
+		 * tuples for the index scans and the second heap pass.
 		 */
-		if (nindexes == 0 &&
-			vacrelstats->num_dead_tuples > 0)
+		if (ndeadoffsets > 0)
 		{
-			/* Remove tuples from heap */
-			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats);
-
-			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
-			 */
-			vacrelstats->num_dead_tuples = 0;
-			vacuumed_pages++;
+			if (nindexes == 0)
+			{
+				/* Remove tuples from heap */
+				lazy_vacuum_page(onerel, blkno, buf,
+								 deadoffsets, ndeadoffsets, vacrelstats);
+				vacuumed_pages++;
+			}
+			else
+				tidstore_add_offsets(vacrelstats->dead_tuples, blkno,
+									 deadoffsets, ndeadoffsets);
 		}
 
 		freespace = PageGetHeapFreeSpace(page);
@@ -715,22 +740,31 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * updating the visibility map, but since this case shouldn't
 			 * happen anyway, don't worry about that.
 			 */
-			visibilitymap_clear(onerel, blkno);
+			visibilitymap_clear(onerel, blkno, VISIBILITYMAP_VALID_BITS);
+		}
+		else if (all_frozen_according_to_vm && all_visible && !all_frozen)
+		{
+			/*
+			 * A row lock taken since we read the map can leave the page like
+			 * this until the locker clears the bit; clearing it twice is
+			 * harmless.
+			 */
+			visibilitymap_clear(onerel, blkno, VISIBILITYMAP_ALL_FROZEN);
 		}
-
-		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 
 		/* Update the visibility map */
-		if (!all_visible_according_to_vm && all_visible)
+		if (all_visible)
 		{
-			visibilitymap_pin(onerel, blkno, &vmbuffer);
-			LockBuffer(buf, BUFFER_LOCK_SHARE);
-			if (PageIsAllVisible(page))
-				visibilitymap_set(onerel, blkno, PageGetLSN(page), &vmbuffer);
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+			if (all_frozen && !all_frozen_according_to_vm)
+				lazy_set_visible(onerel, blkno, page, &vmbuffer,
+								 VISIBILITYMAP_ALL_VISIBLE |
+								 VISIBILITYMAP_ALL_FROZEN);
+			else if (!all_visible_according_to_vm)
+				lazy_set_visible(onerel, blkno, page, &vmbuffer,
+								 VISIBILITYMAP_ALL_VISIBLE);
 		}
 
-		ReleaseBuffer(buf);
+		UnlockReleaseBuffer(buf);
 
 		/* Remember the location of the last page with nonremovable tuples */
 		if (hastup)
@@ -743,7 +777,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.	(This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
+		if (nindexes == 0 || ndeadoffsets == 0)
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
@@ -753,7 +787,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 	/* If any tuples need to be deleted, perform final vacuum cycle */
 	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	if (vacrelstats->hasindex &&
+		tidstore_num_tids(vacrelstats->dead_tuples) > 0)
 	{
 		/* Log cleanup info before we touch indexes */
 		vacuum_log_cleanup_info(onerel, vacrelstats);
@@ -815,28 +850,33 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	TidStoreIter *iter;
+	BlockNumber tblk;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+	int			ndeadoffsets;
+	double		ntuples;
 	int			npages;
 	PGRUsage	ru0;
 
 	pg_rusage_init(&ru0);
 	npages = 0;
+	ntuples = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	iter = tidstore_begin_iterate(vacrelstats->dead_tuples);
+	while (tidstore_iterate_next(iter, &tblk, deadoffsets, &ndeadoffsets))
 	{
-		BlockNumber tblk;
 		Buffer		buf;
 		Page		page;
 		Size		freespace;
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		LockBufferForCleanup(buf);
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats);
+		lazy_vacuum_page(onerel, tblk, buf, deadoffsets, ndeadoffsets,
+						 vacrelstats);
+		ntuples += ndeadoffsets;
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -846,11 +886,12 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 		RecordPageWithFreeSpace(onerel, tblk, freespace);
 		npages++;
 	}
+	tidstore_end_iterate(iter);
 
 	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
+			(errmsg("\"%s\": removed %.0f row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					ntuples, npages),
 			 errdetail("%s.",
 					   pg_rusage_show(&ru0))));
 }
@@ -861,33 +902,25 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * deadoffsets[] holds the offsets of the ndeadoffsets dead tuples of the
+ * page.
  */
-static int
+static void
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats)
+				 OffsetNumber *deadoffsets, int ndeadoffsets,
+				 LVRelStats *vacrelstats)
 {
 	Page		page = BufferGetPage(buffer);
-	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
+	int			i;
 
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < ndeadoffsets; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, deadoffsets[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -901,21 +934,19 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 		recptr = log_heap_clean(onerel, buffer,
 								NULL, 0, NULL, 0,
-								unused, uncnt,
+								deadoffsets, ndeadoffsets,
 								vacrelstats->latestRemovedXid);
 		PageSetLSN(page, recptr);
 		PageSetTLI(page, ThisTimeLineID);
 	}
 
 	END_CRIT_SECTION();
-
-	return tupindex;
 }
 
 /*
  *	lazy_vacuum_index() -- vacuum one index relation.
  *
- *		Delete all the index entries pointing to tuples listed in
+ *		Delete all the index entries pointing to tuples in
  *		vacrelstats->dead_tuples, and update running statistics.
  */
 static void
@@ -940,9 +971,9 @@ lazy_vacuum_index(Relation indrel,
 							   lazy_tid_reaped, (void *) vacrelstats);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
 					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
+					tidstore_num_tids(vacrelstats->dead_tuples)),
 			 errdetail("%s.", pg_rusage_show(&ru0))));
 }
 
@@ -1162,99 +1193,73 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 static void
 lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 {
-	long		maxtuples;
-
 	if (vacrelstats->hasindex)
-	{
-		maxtuples = (maintenance_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
-
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
-
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
-	}
+		vacrelstats->dead_tuples =
+			tidstore_create((Size) maintenance_work_mem * 1024L, relblocks);
 	else
-	{
-		maxtuples = MaxHeapTuplesPerPage;
-	}
-
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
-}
-
-/*
- * lazy_record_dead_tuple - remember one deletable tuple
- */
-static void
-lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr)
-{
-	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
-	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
-	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
-	}
+		vacrelstats->dead_tuples = NULL;
 }
 
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
-
-	return (res != NULL);
+	return tidstore_lookup(vacrelstats->dead_tuples, itemptr);
 }
 
 /*
- * Comparator routines for use with qsort() and bsearch().
+ * lazy_tuple_is_frozen() -- does a tuple hold no unfrozen xids?
+ *
+ * This is applied to tuples heap_freeze_tuple() has already processed, to
+ * decide whether their page can be marked all-frozen.
  */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
+static bool
+lazy_tuple_is_frozen(HeapTupleHeader tuple)
 {
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+	if (TransactionIdIsNormal(HeapTupleHeaderGetXmin(tuple)))
+		return false;
+
+	/*
+	 * Any xmax left behind counts, even if it's hinted invalid: the hint is
+	 * not WAL-logged, and heap_freeze_tuple only clears xmaxes older than
+	 * the cutoff, so an aborted updater's or locker's xid can remain.  Once
+	 * relfrozenxid advances past it, clog for it may be truncated.
+	 */
+	if (tuple->t_infomask & HEAP_XMAX_IS_MULTI)
+		return false;
+	if (TransactionIdIsNormal(HeapTupleHeaderGetXmax(tuple)))
+		return false;
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	if ((tuple->t_infomask & HEAP_MOVED) &&
+		TransactionIdIsNormal(HeapTupleHeaderGetXvac(tuple)))
+		return false;
 
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
+	return true;
+}
+
+/*
+ * lazy_set_visible() -- set visibility map bits for a heap page
+ *
+ * The caller must hold a lock on the heap page, which must have
+ * PD_ALL_VISIBLE set, and must have pinned the right map page in *vmbuffer.
+ * Setting the all-frozen bit is WAL-logged; see log_heap_visible.
+ */
+static void
+lazy_set_visible(Relation onerel, BlockNumber blkno, Page page,
+				 Buffer *vmbuffer, uint8 flags)
+{
+	XLogRecPtr	recptr = PageGetLSN(page);
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+	Assert(PageIsAllVisible(page));
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+	if ((flags & VISIBILITYMAP_ALL_FROZEN) && !onerel->rd_istemp)
+		recptr = log_heap_visible(onerel->rd_node, blkno, flags);
 
-	return 0;
+	visibilitymap_set(onerel, blkno, recptr, vmbuffer, flags);
 }
@@ -969,15 +969,17 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *		constraints that are deferred and that had
  *		potential (unconfirmed) conflicts.
  *
- *		CAUTION: this must not be called for a HOT update.
- *		We can't defend against that here for lack of info.
- *		Should we change the API to make it safer?
+ *		CAUTION: this must not be called for a HOT update, except
+ *		with onlySummarizing set, when heap_update() says the
+ *		summarizing indexes need the new tuple.  We can't defend
+ *		against that here for lack of info.
  * ----------------------------------------------------------------
  */
 List *
 ExecInsertIndexTuples(TupleTableSlot *slot,
 					  ItemPointer tupleid,
-					  EState *estate)
+					  EState *estate,
+					  bool onlySummarizing)
 {
 	List	   *result = NIL;
 	ResultRelInfo *resultRelInfo;
@@ -1027,6 +1029,10 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		/* Skip indexes that point at tuples, if told to */
+		if (onlySummarizing && !indexRelation->rd_am->amsummarizing)
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -39,6 +39,8 @@
 #include "utils/syscache.h"
 
 
+static void ExecHashMakeRoom(HashJoinTable hashtable);
+static void ExecHashDestageBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashBuildSkewHash(HashJoinTable hashtable, Hash *node,
 					  int mcvsToUse);
@@ -47,6 +49,9 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 						uint32 hashvalue,
 						int bucketNumber);
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
+static void ExecHashBuildBloomFilter(HashJoinTable hashtable, Plan *outerNode);
+static void ExecHashBloomAdd(HashJoinTable hashtable, uint32 hashvalue);
+static void ExecHashBloomDiscard(HashJoinTable hashtable);
 
 
 /* ----------------------------------------------------------------
@@ -110,6 +115,9 @@ MultiExecHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (hashtable->bloomFilter)
+				ExecHashBloomAdd(hashtable, hashvalue);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -126,6 +134,15 @@ MultiExecHash(HashState *node)
 		}
 	}
 
+	/*
+	 * If the inner relation turned out to be much bigger than estimated, the
+	 * bloom filter may be too full to reject anything much; don't waste
+	 * cycles probing it.
+	 */
+	if (hashtable->bloomFilter &&
+		hashtable->bloomBitsSet > hashtable->bloomMask / 2)
+		ExecHashBloomDiscard(hashtable);
+
 	/* must provide our own instrumentation support */
 	if (node->ps.instrument)
 		InstrStopNode(node->ps.instrument, hashtable->totalTuples);
@@ -228,10 +245,15 @@ ExecEndHash(HashState *node)
  *		ExecHashTableCreate
  *
  *		create an empty hashtable data structure for hashjoin.
+ *
+ *		If useBloomFilter is true, also build a bloom filter over the
+ *		inner tuples' hash values, which the caller can use to discard
+ *		outer tuples that cannot have a match.  This is only sensible
+ *		for join types that never emit unmatched outer tuples.
  * ----------------------------------------------------------------
  */
 HashJoinTable
-ExecHashTableCreate(Hash *node, List *hashOperators)
+ExecHashTableCreate(Hash *node, List *hashOperators, bool useBloomFilter)
 {
 	HashJoinTable hashtable;
 	Plan	   *outerNode;
@@ -286,12 +308,28 @@ ExecHashTableCreate(Hash *node, List *hashOperators)
 	hashtable->totalTuples = 0;
 	hashtable->innerBatchFile = NULL;
 	hashtable->outerBatchFile = NULL;
+	hashtable->batchSpace = NULL;
+	hashtable->batchResident = NULL;
+	hashtable->curbatchFallback = false;
+	hashtable->curbatchOverflow = false;
+	hashtable->curchunkLast = false;
+	hashtable->curchunk = 0;
+	hashtable->nbatchFallback = 0;
+	hashtable->outerTupleCount = 0;
+	hashtable->outerMatched = NULL;
+	hashtable->outerMatchedLen = 0;
 	hashtable->spaceUsed = 0;
 	hashtable->spacePeak = 0;
 	hashtable->spaceAllowed = work_mem * 1024L;
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
+	hashtable->spaceUsedBloom = 0;
+	hashtable->bloomFilter = NULL;
+	hashtable->bloomMask = 0;
+	hashtable->bloomBitsSet = 0;
+	hashtable->bloomProbes = 0;
+	hashtable->bloomRejected = 0;
 
 	/*
 	 * Get info about the hash functions to be used for each hash key. Also
@@ -348,11 +386,24 @@ ExecHashTableCreate(Hash *node, List *hashOperators)
 			palloc0(nbatch * sizeof(BufFile *));
 		hashtable->outerBatchFile = (BufFile **)
 			palloc0(nbatch * sizeof(BufFile *));
+		hashtable->batchSpace = (Size *) palloc0(nbatch * sizeof(Size));
+
+		/*
+		 * Every later batch starts out resident; we'll write batches out
+		 * only as memory runs short.  (Batch 0 is the current batch, which
+		 * is never considered resident.)
+		 */
+		hashtable->batchResident = (bool *) palloc(nbatch * sizeof(bool));
+		memset(hashtable->batchResident, true, nbatch * sizeof(bool));
+		hashtable->batchResident[0] = false;
 		/* The files will not be opened until needed... */
 		/* ... but make sure we have temp tablespaces established for them */
 		PrepareTempTablespaces();
 	}
 
+	if (useBloomFilter)
+		ExecHashBuildBloomFilter(hashtable, outerNode);
+
 	/*
 	 * Prepare context for the first-scan space allocations; allocate the
 	 * hashbucket array therein, and set each bucket "empty".
@@ -542,6 +593,254 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 	pfree(hashtable);
 }
 
+/*
+ * ExecHashBuildBloomFilter
+ *		allocate an empty bloom filter sized for the estimated number of
+ *		inner tuples
+ *
+ * The filter lives in hashCxt, since it covers all batches.  Its size is
+ * capped at 1/8th of work_mem; if the inner relation is bigger than that
+ * allows for, the filter will most likely be discarded as too full at the
+ * end of MultiExecHash.  Its space counts against the hash table's, for as
+ * long as we keep it.
+ */
+static void
+ExecHashBuildBloomFilter(HashJoinTable hashtable, Plan *outerNode)
+{
+	double		nbits;
+	double		maxbits;
+	int			log2_nbits;
+
+	nbits = outerNode->plan_rows * BLOOM_BITS_PER_TUPLE;
+	maxbits = Min((double) hashtable->spaceAllowed, (double) (1 << 30));
+
+	/* round up to a power of 2, within our limits */
+	log2_nbits = my_log2(BLOOM_MIN_BITS);
+	while ((double) (1 << log2_nbits) < nbits &&
+		   (double) (1 << log2_nbits) * 2 <= maxbits)
+		log2_nbits++;
+
+	hashtable->bloomMask = (1U << log2_nbits) - 1;
+	hashtable->spaceUsedBloom = ((Size) 1 << log2_nbits) / BITS_PER_BYTE;
+	hashtable->bloomFilter = (uint32 *) palloc0(hashtable->spaceUsedBloom);
+
+	hashtable->spaceUsed += hashtable->spaceUsedBloom;
+	if (hashtable->spaceUsed > hashtable->spacePeak)
+		hashtable->spacePeak = hashtable->spaceUsed;
+}
+
+/*
+ * ExecHashBloomDiscard
+ *		stop using the bloom filter, and give back its space
+ */
+static void
+ExecHashBloomDiscard(HashJoinTable hashtable)
+{
+	pfree(hashtable->bloomFilter);
+	hashtable->bloomFilter = NULL;
+	hashtable->spaceUsed -= hashtable->spaceUsedBloom;
+	hashtable->spaceUsedBloom = 0;
+}
+
+/*
+ * Compute the BLOOM_NUM_PROBES bit positions for a hash value, using the
+ * usual double-hashing trick.  The hash value has to be remixed first, since
+ * its low-order bits are what picks the bucket and batch; without that, all
+ * the inner tuples of a small batch would crowd into a few filter words.
+ */
+#define BLOOM_HASH1(hashvalue) \
+	(((hashvalue) ^ ((hashvalue) >> 16)) * 0x85ebca6bU)
+#define BLOOM_HASH2(h1) \
+	((((h1) >> 13) ^ ((h1) << 19) ^ 0x9e3779b9U) | 1)
+
+/*
+ * ExecHashBloomAdd
+ *		add an inner tuple's hash value to the bloom filter
+ */
+static void
+ExecHashBloomAdd(HashJoinTable hashtable, uint32 hashvalue)
+{
+	uint32		h1 = BLOOM_HASH1(hashvalue);
+	uint32		h2 = BLOOM_HASH2(h1);
+	int			i;
+
+	for (i = 0; i < BLOOM_NUM_PROBES; i++)
+	{
+		uint32		bit = (h1 + i * h2) & hashtable->bloomMask;
+		uint32		mask = (uint32) 1 << (bit % 32);
+
+		if (!(hashtable->bloomFilter[bit / 32] & mask))
+		{
+			hashtable->bloomFilter[bit / 32] |= mask;
+			hashtable->bloomBitsSet++;
+		}
+	}
+}
+
+/*
+ * ExecHashBloomCheck
+ *		check an outer tuple's hash value against the bloom filter
+ *
+ * Returns false if no inner tuple can have this hash value, in which case the
+ * outer tuple cannot have a join partner.  Returns true if it might.  The
+ * caller must have checked that hashtable->bloomFilter isn't NULL.
+ *
+ * If the filter isn't rejecting enough tuples to pay for itself, we throw it
+ * away after BLOOM_CHECK_PROBES probes.
+ */
+bool
+ExecHashBloomCheck(HashJoinTable hashtable, uint32 hashvalue)
+{
+	uint32		h1 = BLOOM_HASH1(hashvalue);
+	uint32		h2 = BLOOM_HASH2(h1);
+	bool		result = true;
+	int			i;
+
+	Assert(hashtable->bloomFilter != NULL);
+
+	for (i = 0; i < BLOOM_NUM_PROBES; i++)
+	{
+		uint32		bit = (h1 + i * h2) & hashtable->bloomMask;
+
+		if (!(hashtable->bloomFilter[bit / 32] & ((uint32) 1 << (bit % 32))))
+		{
+			result = false;
+			hashtable->bloomRejected += 1;
+			break;
+		}
+	}
+
+	hashtable->bloomProbes += 1;
+	if (hashtable->bloomProbes == BLOOM_CHECK_PROBES &&
+		hashtable->bloomRejected * BLOOM_MIN_REJECT_RATIO < BLOOM_CHECK_PROBES)
+		ExecHashBloomDiscard(hashtable);
+
+	return result;
+}
+
+/*
+ * ExecHashMakeRoom
+ *		get the space used by the hash table back under spaceAllowed, or
+ *		arrange to stop adding to it
+ *
+ * First we write out resident batches, then we try increasing nbatch.  If
+ * neither helps, the current batch has more tuples with identical hash values
+ * than will fit in memory; rather than keep eating memory, switch it to
+ * block-nested-loop processing.  While building from the inner plan, that
+ * means further tuples of the current batch are sent to its temp file, to be
+ * joined in later chunks; while loading a batch from its temp file, the
+ * caller notices curbatchFallback and simply stops reading.
+ */
+static void
+ExecHashMakeRoom(HashJoinTable hashtable)
+{
+	if (hashtable->batchResident != NULL)
+	{
+		ExecHashDestageBatches(hashtable);
+		if (hashtable->spaceUsed <= hashtable->spaceAllowed)
+			return;
+	}
+
+	ExecHashIncreaseNumBatches(hashtable);
+
+	if (!hashtable->growEnabled &&
+		hashtable->spaceUsed > hashtable->spaceAllowed &&
+		!hashtable->curbatchFallback)
+	{
+		hashtable->curbatchFallback = true;
+		hashtable->curchunkLast = false;
+		if (hashtable->curbatch == 0 && hashtable->curchunk == 0)
+			hashtable->curbatchOverflow = true;
+#ifdef HJDEBUG
+		printf("Falling back to block nested loop for batch %d\n",
+			   hashtable->curbatch);
+#endif
+	}
+}
+
+/*
+ * ExecHashDestageBatches
+ *		write out the largest resident batches until the hash table is
+ *		comfortably under spaceAllowed
+ *
+ * We aim for 3/4ths of spaceAllowed, so as not to come right back here on
+ * the next insertion.  If that can't be reached, every batch but the current
+ * one ends up destaged.
+ */
+static void
+ExecHashDestageBatches(HashJoinTable hashtable)
+{
+	int			nbatch = hashtable->nbatch;
+	int			curbatch = hashtable->curbatch;
+	Size		target = hashtable->spaceAllowed / 4 * 3;
+	Size		tofree = 0;
+	bool		anyDestaged = false;
+	int			i;
+
+	Assert(hashtable->batchResident != NULL);
+
+	/* Choose the victims, largest first */
+	while (hashtable->spaceUsed - tofree > target)
+	{
+		int			victim = -1;
+
+		for (i = 0; i < nbatch; i++)
+		{
+			if (i == curbatch || !hashtable->batchResident[i])
+				continue;
+			if (victim < 0 ||
+				hashtable->batchSpace[i] > hashtable->batchSpace[victim])
+				victim = i;
+		}
+		if (victim < 0)
+			break;				/* nothing left to destage */
+		hashtable->batchResident[victim] = false;
+		tofree += hashtable->batchSpace[victim];
+		anyDestaged = true;
+	}
+
+	if (!anyDestaged)
+		return;
+
+#ifdef HJDEBUG
+	printf("Destaging %lu bytes of resident batches, space = %lu\n",
+		   (unsigned long) tofree, (unsigned long) hashtable->spaceUsed);
+#endif
+
+	/* Now write their tuples out */
+	for (i = 0; i < hashtable->nbuckets; i++)
+	{
+		HashJoinTuple prevtuple = NULL;
+		HashJoinTuple tuple = hashtable->buckets[i];
+
+		while (tuple != NULL)
+		{
+			HashJoinTuple nexttuple = tuple->next;
+			int			bucketno;
+			int			batchno;
+
+			ExecHashGetBucketAndBatch(hashtable, tuple->hashvalue,
+									  &bucketno, &batchno);
+			if (batchno == curbatch || hashtable->batchResident[batchno])
+				prevtuple = tuple;
+			else
+			{
+				ExecHashJoinSaveTuple(HJTUPLE_MINTUPLE(tuple),
+									  tuple->hashvalue,
+									  &hashtable->innerBatchFile[batchno]);
+				if (prevtuple)
+					prevtuple->next = nexttuple;
+				else
+					hashtable->buckets[i] = nexttuple;
+				hashtable->spaceUsed -=
+					HJTUPLE_OVERHEAD + HJTUPLE_MINTUPLE(tuple)->t_len;
+				pfree(tuple);
+			}
+			tuple = nexttuple;
+		}
+	}
+}
+
 /*
  * ExecHashIncreaseNumBatches
  *		increase the original number of batches in order to reduce
@@ -583,6 +882,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 			palloc0(nbatch * sizeof(BufFile *));
 		hashtable->outerBatchFile = (BufFile **)
 			palloc0(nbatch * sizeof(BufFile *));
+		hashtable->batchSpace = (Size *) palloc0(nbatch * sizeof(Size));
 		/* time to establish the temp tablespaces, too */
 		PrepareTempTablespaces();
 	}
@@ -597,6 +897,31 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 			   (nbatch - oldnbatch) * sizeof(BufFile *));
 		MemSet(hashtable->outerBatchFile + oldnbatch, 0,
 			   (nbatch - oldnbatch) * sizeof(BufFile *));
+		hashtable->batchSpace = (Size *)
+			repalloc(hashtable->batchSpace, nbatch * sizeof(Size));
+
+		/*
+		 * We don't know how the tuples already written out for each old
+		 * batch will divide up; assume evenly.  The in-memory tuples are
+		 * accounted for exactly below.
+		 */
+		for (i = 0; i < oldnbatch; i++)
+		{
+			hashtable->batchSpace[i + oldnbatch] =
+				(i == curbatch) ? 0 : hashtable->batchSpace[i] / 2;
+			hashtable->batchSpace[i] -= hashtable->batchSpace[i + oldnbatch];
+		}
+		/*
+		 * We only get here once there are no resident batches left to
+		 * destage, so all the new batches start out non-resident.
+		 */
+		if (hashtable->batchResident)
+		{
+			hashtable->batchResident = (bool *)
+				repalloc(hashtable->batchResident, nbatch * sizeof(bool));
+			MemSet(hashtable->batchResident + oldnbatch, 0,
+				   (nbatch - oldnbatch) * sizeof(bool));
+		}
 	}
 
 	MemoryContextSwitchTo(oldcxt);
@@ -605,9 +930,11 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 
 	/*
 	 * Scan through the existing hash table entries and dump out any that are
-	 * no longer of the current batch.
+	 * no longer of the current batch.  Recount the current batch's space as
+	 * we go.
 	 */
 	ninmemory = nfreed = 0;
+	hashtable->batchSpace[curbatch] = 0;
 
 	for (i = 0; i < hashtable->nbuckets; i++)
 	{
@@ -623,15 +950,23 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 			HashJoinTuple nexttuple = tuple->next;
 			int			bucketno;
 			int			batchno;
+			Size		tupleSize;
 
 			ninmemory++;
 			ExecHashGetBucketAndBatch(hashtable, tuple->hashvalue,
 									  &bucketno, &batchno);
 			Assert(bucketno == i);
+			tupleSize = HJTUPLE_OVERHEAD + HJTUPLE_MINTUPLE(tuple)->t_len;
 			if (batchno == curbatch)
 			{
 				/* keep tuple */
 				prevtuple = tuple;
+				hashtable->batchSpace[curbatch] += tupleSize;
+			}
+			else if (HashBatchIsResident(hashtable, batchno))
+			{
+				/* keep tuple; its space is already accounted for */
+				prevtuple = tuple;
 			}
 			else
 			{
@@ -640,14 +975,14 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				ExecHashJoinSaveTuple(HJTUPLE_MINTUPLE(tuple),
 									  tuple->hashvalue,
 									  &hashtable->innerBatchFile[batchno]);
+				hashtable->batchSpace[batchno] += tupleSize;
 				/* and remove from hash table */
 				if (prevtuple)
 					prevtuple->next = nexttuple;
 				else
 					hashtable->buckets[i] = nexttuple;
 				/* prevtuple doesn't change */
-				hashtable->spaceUsed -=
-					HJTUPLE_OVERHEAD + HJTUPLE_MINTUPLE(tuple)->t_len;
+				hashtable->spaceUsed -= tupleSize;
 				pfree(tuple);
 				nfreed++;
 			}
@@ -702,9 +1037,11 @@ ExecHashTableInsert(HashJoinTable hashtable,
 							  &bucketno, &batchno);
 
 	/*
-	 * decide whether to put the tuple in the hash table or a temp file
+	 * decide whether to put the tuple in the hash table or a temp file.
+	 * Tuples of a resident batch go into the hash table, too.
 	 */
-	if (batchno == hashtable->curbatch)
+	if ((batchno == hashtable->curbatch && !hashtable->curbatchOverflow) ||
+		HashBatchIsResident(hashtable, batchno))
 	{
 		/*
 		 * put the tuple in hash table
@@ -713,6 +1050,8 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		int			hashTupleSize;
 
 		hashTupleSize = HJTUPLE_OVERHEAD + tuple->t_len;
+		if (hashtable->batchSpace)
+			hashtable->batchSpace[batchno] += hashTupleSize;
 		hashTuple = (HashJoinTuple) MemoryContextAlloc(hashtable->batchCxt,
 													   hashTupleSize);
 		hashTuple->hashvalue = hashvalue;
@@ -723,17 +1062,19 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
 		if (hashtable->spaceUsed > hashtable->spaceAllowed)
-			ExecHashIncreaseNumBatches(hashtable);
+			ExecHashMakeRoom(hashtable);
 	}
 	else
 	{
 		/*
-		 * put the tuple into a temp file for later batches
+		 * put the tuple into a temp file for later batches, or for a later
+		 * chunk of the current batch if it has overflowed
 		 */
-		Assert(batchno > hashtable->curbatch);
+		Assert(batchno >= hashtable->curbatch);
 		ExecHashJoinSaveTuple(tuple,
 							  hashvalue,
 							  &hashtable->innerBatchFile[batchno]);
+		hashtable->batchSpace[batchno] += HJTUPLE_OVERHEAD + tuple->t_len;
 	}
 }
 
@@ -955,7 +1296,8 @@ ExecHashTableReset(HashJoinTable hashtable)
 	hashtable->buckets = (HashJoinTuple *)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
 
-	hashtable->spaceUsed = 0;
+	/* the bloom filter, if any, covers all batches and so stays */
+	hashtable->spaceUsed = hashtable->spaceUsedBloom;
 
 	MemoryContextSwitchTo(oldcxt);
 }
@@ -1218,7 +1560,7 @@ ExecHashSkewTableInsert(HashJoinTable hashtable,
 
 	/* Check we are not over the total spaceAllowed, either */
 	if (hashtable->spaceUsed > hashtable->spaceAllowed)
-		ExecHashIncreaseNumBatches(hashtable);
+		ExecHashMakeRoom(hashtable);
 }
 
 /*
@@ -1267,13 +1609,15 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 		tupleSize = HJTUPLE_OVERHEAD + tuple->t_len;
 
 		/* Decide whether to put the tuple in the hash table or a temp file */
-		if (batchno == hashtable->curbatch)
+		if (batchno == hashtable->curbatch ||
+			HashBatchIsResident(hashtable, batchno))
 		{
 			/* Move the tuple to the main hash table */
 			hashTuple->next = hashtable->buckets[bucketno];
 			hashtable->buckets[bucketno] = hashTuple;
 			/* We have reduced skew space, but overall space doesn't change */
 			hashtable->spaceUsedSkew -= tupleSize;
+			hashtable->batchSpace[batchno] += tupleSize;
 		}
 		else
 		{
@@ -1281,6 +1625,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 			Assert(batchno > hashtable->curbatch);
 			ExecHashJoinSaveTuple(tuple, hashvalue,
 								  &hashtable->innerBatchFile[batchno]);
+			hashtable->batchSpace[batchno] += tupleSize;
 			pfree(hashTuple);
 			hashtable->spaceUsed -= tupleSize;
 			hashtable->spaceUsedSkew -= tupleSize;
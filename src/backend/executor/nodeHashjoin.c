@@ -33,6 +33,11 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 						  uint32 *hashvalue,
 						  TupleTableSlot *tupleSlot);
 static int	ExecHashJoinNewBatch(HashJoinState *hjstate);
+static bool ExecHashJoinLoadChunk(HashJoinState *hjstate, BufFile *innerFile);
+static bool ExecHashJoinNextChunk(HashJoinState *hjstate);
+static void ExecHashJoinEndFallback(HashJoinTable hashtable);
+static bool ExecHashJoinOuterMatched(HashJoinTable hashtable);
+static void ExecHashJoinSetOuterMatched(HashJoinTable hashtable);
 
 
 /* ----------------------------------------------------------------
@@ -141,10 +146,14 @@ ExecHashJoin(HashJoinState *node)
 			node->hj_FirstOuterTupleSlot = NULL;
 
 		/*
-		 * create the hash table
+		 * create the hash table.  Unless we have to emit unmatched outer
+		 * tuples, ask for a bloom filter too, so that outer tuples without
+		 * a partner can be thrown away before they are hashed into a bucket
+		 * search or written out to a batch file.
 		 */
 		hashtable = ExecHashTableCreate((Hash *) hashNode->ps.plan,
-										node->hj_HashOperators);
+										node->hj_HashOperators,
+										!HASHJOIN_IS_OUTER(node));
 		node->hj_HashTable = hashtable;
 
 		/*
@@ -211,22 +220,54 @@ ExecHashJoin(HashJoinState *node)
 			/*
 			 * Now we've got an outer tuple and the corresponding hash bucket,
 			 * but it might not belong to the current batch, or it might match
-			 * a skew bucket.
+			 * a skew bucket.  (If it belongs to a batch that is still wholly
+			 * in memory, we can join it right now.)
 			 */
 			if (batchno != hashtable->curbatch &&
-				node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
+				node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO &&
+				!HashBatchIsResident(hashtable, batchno))
 			{
 				/*
 				 * Need to postpone this outer tuple to a later batch. Save it
-				 * in the corresponding outer-batch file.
+				 * in the corresponding outer-batch file.  If we are rescanning
+				 * the outer batch for a later chunk, that's already been done.
 				 */
 				Assert(batchno > hashtable->curbatch);
-				ExecHashJoinSaveTuple(ExecFetchSlotMinimalTuple(outerTupleSlot),
-									  hashvalue,
-									  &hashtable->outerBatchFile[batchno]);
+				if (hashtable->curchunk == 0)
+					ExecHashJoinSaveTuple(ExecFetchSlotMinimalTuple(outerTupleSlot),
+										  hashvalue,
+										  &hashtable->outerBatchFile[batchno]);
 				node->hj_NeedNewOuter = true;
 				continue;		/* loop around for a new outer tuple */
 			}
+
+			/*
+			 * If the current batch is being joined in chunks, the outer tuple
+			 * may already have found its match in an earlier chunk.  In the
+			 * first pass over batch 0 we must also keep a copy of it for the
+			 * later chunks, since the outer plan can't be rescanned.
+			 */
+			if (hashtable->curbatchFallback &&
+				node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
+			{
+				if (hashtable->curbatch == 0 && hashtable->curchunk == 0)
+				{
+					ExecHashJoinSaveTuple(ExecFetchSlotMinimalTuple(outerTupleSlot),
+										  hashvalue,
+										  &hashtable->outerBatchFile[0]);
+					hashtable->outerTupleCount++;
+				}
+				if (ExecHashJoinOuterMatched(hashtable))
+				{
+					if (node->js.jointype == JOIN_SEMI ||
+						node->js.jointype == JOIN_ANTI)
+					{
+						node->hj_NeedNewOuter = true;
+						continue;	/* nothing more to do for this tuple */
+					}
+					node->hj_MatchedOuter = true;
+				}
+			}
 		}
 
 		/*
@@ -261,6 +302,12 @@ ExecHashJoin(HashJoinState *node)
 			{
 				node->hj_MatchedOuter = true;
 
+				/* remember the match for later chunks, if need be */
+				if (hashtable->curbatchFallback &&
+					node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO &&
+					node->js.jointype != JOIN_INNER)
+					ExecHashJoinSetOuterMatched(hashtable);
+
 				/* In an antijoin, we never return a matched tuple */
 				if (node->js.jointype == JOIN_ANTI)
 				{
@@ -301,12 +348,15 @@ ExecHashJoin(HashJoinState *node)
 		/*
 		 * Now the current outer tuple has run out of matches, so check
 		 * whether to emit a dummy outer-join tuple. If not, loop around to
-		 * get a new outer tuple.
+		 * get a new outer tuple.  When joining in chunks, a match could still
+		 * turn up in a later chunk, so wait for the last one.
 		 */
 		node->hj_NeedNewOuter = true;
 
 		if (!node->hj_MatchedOuter &&
-			HASHJOIN_IS_OUTER(node))
+			HASHJOIN_IS_OUTER(node) &&
+			(!hashtable->curbatchFallback || hashtable->curchunkLast ||
+			 node->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO))
 		{
 			/*
 			 * We are doing an outer join and there were no join matches for
@@ -549,7 +599,8 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
-	if (curbatch == 0)			/* if it is the first pass */
+	if (curbatch == 0 && hashtable->curchunk == 0)	/* if it is the first
+														 * pass */
 	{
 		/*
 		 * Check to see if first outer tuple was already fetched by
@@ -573,7 +624,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 									 hjstate->hj_OuterHashKeys,
 									 true,		/* outer tuple */
 									 HASHJOIN_IS_OUTER(hjstate),
-									 hashvalue))
+									 hashvalue) &&
+				(hashtable->bloomFilter == NULL ||
+				 ExecHashBloomCheck(hashtable, *hashvalue)))
 			{
 				/* remember outer relation is not empty for possible rescan */
 				hjstate->hj_OuterNotEmpty = true;
@@ -582,8 +635,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			}
 
 			/*
-			 * That tuple couldn't match because of a NULL, so discard it and
-			 * continue with the next one.
+			 * That tuple couldn't match because of a NULL, or because the
+			 * bloom filter says there's no inner tuple with its hash value,
+			 * so discard it and continue with the next one.
 			 */
 			slot = ExecProcNode(outerNode);
 		}
@@ -607,7 +661,11 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 										 hashvalue,
 										 hjstate->hj_OuterTupleSlot);
 		if (!TupIsNull(slot))
+		{
+			if (hashtable->curbatchFallback)
+				hashtable->outerTupleCount++;
 			return slot;
+		}
 		curbatch = ExecHashJoinNewBatch(hjstate);
 	}
 
@@ -629,24 +687,12 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	int			nbatch;
 	int			curbatch;
 	BufFile    *innerFile;
-	TupleTableSlot *slot;
-	uint32		hashvalue;
 
 start_over:
 	nbatch = hashtable->nbatch;
 	curbatch = hashtable->curbatch;
 
-	if (curbatch > 0)
-	{
-		/*
-		 * We no longer need the previous outer batch file; close it right
-		 * away to free disk space.
-		 */
-		if (hashtable->outerBatchFile[curbatch])
-			BufFileClose(hashtable->outerBatchFile[curbatch]);
-		hashtable->outerBatchFile[curbatch] = NULL;
-	}
-	else	/* we just finished the first batch */
+	if (curbatch == 0)			/* we just finished the first batch */
 	{
 		/*
 		 * Reset some of the skew optimization state variables, since we no
@@ -658,6 +704,39 @@ start_over:
 		hashtable->skewBucket = NULL;
 		hashtable->skewBucketNums = NULL;
 		hashtable->spaceUsedSkew = 0;
+
+		/*
+		 * Likewise, batches can only be resident during the first pass, and
+		 * any that were have been fully joined by now.
+		 */
+		if (hashtable->batchResident)
+		{
+			pfree(hashtable->batchResident);
+			hashtable->batchResident = NULL;
+		}
+		hashtable->curbatchOverflow = false;
+	}
+
+	/*
+	 * If the current batch is being joined in chunks, move on to its next
+	 * chunk if there is one.
+	 */
+	if (hashtable->curbatchFallback)
+	{
+		if (ExecHashJoinNextChunk(hjstate))
+			return curbatch;
+		ExecHashJoinEndFallback(hashtable);
+	}
+
+	/*
+	 * We no longer need the previous outer batch file; close it right away
+	 * to free disk space.  (Batch 0 only has one if it was joined in chunks,
+	 * and the arrays don't exist at all in a single-batch join.)
+	 */
+	if (hashtable->outerBatchFile && hashtable->outerBatchFile[curbatch])
+	{
+		BufFileClose(hashtable->outerBatchFile[curbatch]);
+		hashtable->outerBatchFile[curbatch] = NULL;
 	}
 
 	/*
@@ -710,6 +789,7 @@ start_over:
 	 * Reload the hash table with the new inner batch (which could be empty)
 	 */
 	ExecHashTableReset(hashtable);
+	hashtable->batchSpace[curbatch] = 0;
 
 	innerFile = hashtable->innerBatchFile[curbatch];
 
@@ -720,24 +800,16 @@ start_over:
 					(errcode_for_file_access(),
 				   errmsg("could not rewind hash-join temporary file: %m")));
 
-		while ((slot = ExecHashJoinGetSavedTuple(hjstate,
-												 innerFile,
-												 &hashvalue,
-												 hjstate->hj_HashTupleSlot)))
-		{
-			/*
-			 * NOTE: some tuples may be sent to future batches.  Also, it is
-			 * possible for hashtable->nbatch to be increased here!
-			 */
-			ExecHashTableInsert(hashtable, slot, hashvalue);
-		}
-
 		/*
 		 * after we build the hash table, the inner batch file is no longer
-		 * needed
+		 * needed --- unless it didn't all fit, in which case we keep reading
+		 * it a chunk at a time.
 		 */
-		BufFileClose(innerFile);
-		hashtable->innerBatchFile[curbatch] = NULL;
+		if (ExecHashJoinLoadChunk(hjstate, innerFile))
+		{
+			BufFileClose(innerFile);
+			hashtable->innerBatchFile[curbatch] = NULL;
+		}
 	}
 
 	/*
@@ -757,6 +829,184 @@ start_over:
 	return curbatch;
 }
 
+/*
+ * ExecHashJoinLoadChunk
+ *		load inner tuples from a batch file into the hash table
+ *
+ * Normally this loads the whole file, but if the batch turns out to be too
+ * big for memory and can't be split (see ExecHashMakeRoom), we stop as soon
+ * as the hash table is full, leaving the file positioned at the next tuple.
+ * Returns true if we reached the end of the file.
+ */
+static bool
+ExecHashJoinLoadChunk(HashJoinState *hjstate, BufFile *innerFile)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	TupleTableSlot *slot;
+	uint32		hashvalue;
+
+	for (;;)
+	{
+		if (hashtable->curbatchFallback &&
+			hashtable->spaceUsed > hashtable->spaceAllowed)
+			return false;
+
+		slot = ExecHashJoinGetSavedTuple(hjstate,
+										 innerFile,
+										 &hashvalue,
+										 hjstate->hj_HashTupleSlot);
+		if (TupIsNull(slot))
+			return true;
+
+		/*
+		 * NOTE: some tuples may be sent to future batches.  Also, it is
+		 * possible for hashtable->nbatch to be increased here!
+		 */
+		ExecHashTableInsert(hashtable, slot, hashvalue);
+	}
+}
+
+/*
+ * ExecHashJoinNextChunk
+ *		load the next chunk of a batch that is being joined in chunks
+ *
+ * Returns true if the outer batch needs to be scanned against the new chunk,
+ * in which case it has been rewound.  Returns false if the batch is done.
+ */
+static bool
+ExecHashJoinNextChunk(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	BufFile    *innerFile;
+
+	if (hashtable->curchunkLast ||
+		hashtable->outerBatchFile[curbatch] == NULL)
+		return false;
+
+	hashtable->curchunk++;
+	ExecHashTableReset(hashtable);
+
+	innerFile = hashtable->innerBatchFile[curbatch];
+
+	/*
+	 * Batch 0's leftover inner tuples were written while we built the hash
+	 * table from the inner plan, so its file must be rewound first.  For
+	 * other batches we just carry on reading where the last chunk stopped.
+	 */
+	if (innerFile != NULL && curbatch == 0 && hashtable->curchunk == 1)
+	{
+		if (BufFileSeek(innerFile, 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+				   errmsg("could not rewind hash-join temporary file: %m")));
+	}
+
+	if (innerFile == NULL || ExecHashJoinLoadChunk(hjstate, innerFile))
+	{
+		if (innerFile != NULL)
+			BufFileClose(innerFile);
+		hashtable->innerBatchFile[curbatch] = NULL;
+		hashtable->curchunkLast = true;
+	}
+
+	/*
+	 * There's no point in scanning the outer batch against an empty chunk,
+	 * unless it's the last one and we still have to emit the outer tuples
+	 * that never found a match.
+	 */
+	if (hashtable->spaceUsed == hashtable->spaceUsedBloom &&
+		!HASHJOIN_IS_OUTER(hjstate))
+		return false;
+
+	if (hashtable->curchunk == 1)
+		hashtable->nbatchFallback++;
+
+	if (BufFileSeek(hashtable->outerBatchFile[curbatch], 0, 0L, SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind hash-join temporary file: %m")));
+	hashtable->outerTupleCount = 0;
+
+	return true;
+}
+
+/*
+ * ExecHashJoinEndFallback
+ *		clean up after joining a batch in chunks
+ */
+static void
+ExecHashJoinEndFallback(HashJoinTable hashtable)
+{
+	int			curbatch = hashtable->curbatch;
+
+	if (hashtable->innerBatchFile[curbatch])
+	{
+		BufFileClose(hashtable->innerBatchFile[curbatch]);
+		hashtable->innerBatchFile[curbatch] = NULL;
+	}
+	if (hashtable->outerMatched)
+	{
+		pfree(hashtable->outerMatched);
+		hashtable->outerMatched = NULL;
+	}
+	hashtable->outerMatchedLen = 0;
+	hashtable->outerTupleCount = 0;
+	hashtable->curbatchFallback = false;
+	hashtable->curchunkLast = false;
+	hashtable->curchunk = 0;
+}
+
+/*
+ * ExecHashJoinOuterMatched
+ *		has the current outer tuple matched in an earlier chunk?
+ *
+ * The current outer tuple is the (outerTupleCount - 1)'th of its batch.
+ */
+static bool
+ExecHashJoinOuterMatched(HashJoinTable hashtable)
+{
+	long		tupno = hashtable->outerTupleCount - 1;
+
+	Assert(tupno >= 0);
+	if (tupno / BITS_PER_BYTE >= hashtable->outerMatchedLen)
+		return false;
+	return (hashtable->outerMatched[tupno / BITS_PER_BYTE] &
+			(1 << (tupno % BITS_PER_BYTE))) != 0;
+}
+
+/*
+ * ExecHashJoinSetOuterMatched
+ *		remember that the current outer tuple has found a match
+ */
+static void
+ExecHashJoinSetOuterMatched(HashJoinTable hashtable)
+{
+	long		tupno = hashtable->outerTupleCount - 1;
+	long		byteno = tupno / BITS_PER_BYTE;
+
+	Assert(tupno >= 0);
+	if (byteno >= hashtable->outerMatchedLen)
+	{
+		long		newlen = Max(hashtable->outerMatchedLen * 2, 1024);
+
+		while (newlen <= byteno)
+			newlen *= 2;
+		if (hashtable->outerMatched == NULL)
+			hashtable->outerMatched = (uint8 *)
+				MemoryContextAllocZero(hashtable->hashCxt, newlen);
+		else
+		{
+			hashtable->outerMatched = (uint8 *)
+				repalloc(hashtable->outerMatched, newlen);
+			MemSet(hashtable->outerMatched + hashtable->outerMatchedLen, 0,
+				   newlen - hashtable->outerMatchedLen);
+		}
+		hashtable->outerMatchedLen = newlen;
+	}
+	hashtable->outerMatched[byteno] |= (1 << (tupno % BITS_PER_BYTE));
+}
+
 /*
  * ExecHashJoinSaveTuple
  *		save a tuple to a batch file.
@@ -0,0 +1,338 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * An incremental sort is used when the input is already sorted by a prefix
+ * of the required sort keys.  We read the input one group of tuples at a
+ * time, where a group is a run of tuples that are equal on the presorted
+ * columns, and sort each group by the remaining columns only.  Compared to
+ * a full sort, this needs memory for only one group at a time, and it can
+ * return the first tuples as soon as the first group has been read, which
+ * is a big win underneath a LIMIT.
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/executor.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/tuplesort.h"
+
+
+static void finish_group_sort(IncrementalSortState *node);
+
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Returns the next tuple in sort order.  Each time the current
+ *		group is used up, the next one is read from the outer subtree
+ *		and sorted.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecIncrementalSort(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	int			presortedCols = plannode->presortedCols;
+	int			suffixCols = plannode->sort.numCols - presortedCols;
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *resultSlot = node->ss.ps.ps_ResultTupleSlot;
+	TupleTableSlot *pivot = node->group_pivot;
+	TupleTableSlot *slot;
+	Tuplesortstate *tuplesortstate;
+
+	for (;;)
+	{
+		/*
+		 * If we have a sorted group, return its next tuple.
+		 */
+		if (node->group_Done)
+		{
+			tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+			if (tuplesort_gettupleslot(tuplesortstate, true, resultSlot))
+			{
+				node->tuples_returned++;
+				return resultSlot;
+			}
+			node->group_Done = false;
+		}
+
+		if (node->finished)
+			return ExecClearTuple(resultSlot);
+
+		/*
+		 * Start the next group with the tuple that ended the last one, or
+		 * with the very first input tuple.
+		 */
+		if (TupIsNull(pivot))
+		{
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+			{
+				node->finished = true;
+				return ExecClearTuple(resultSlot);
+			}
+			ExecCopySlot(pivot, slot);
+		}
+
+		/*
+		 * If the very next tuple already belongs to a different group, the
+		 * current group has just one member, so it needn't be sorted at all.
+		 * That's common enough when the presorted columns are nearly unique
+		 * to be worth a special case.
+		 */
+		slot = ExecProcNode(outerNode);
+		if (TupIsNull(slot) ||
+			!execTuplesMatch(slot, pivot,
+							 presortedCols, plannode->sort.sortColIdx,
+							 node->eqfunctions, node->tempContext))
+		{
+			ExecCopySlot(resultSlot, pivot);
+			if (TupIsNull(slot))
+			{
+				node->finished = true;
+				ExecClearTuple(pivot);
+			}
+			else
+				ExecCopySlot(pivot, slot);
+			node->tuples_returned++;
+			return resultSlot;
+		}
+
+		/*
+		 * Otherwise feed the whole group to a new tuplesort, sorting on the
+		 * suffix columns only.
+		 */
+		if (node->tuplesortstate != NULL)
+			finish_group_sort(node);
+		tuplesortstate =
+			tuplesort_begin_heap(ExecGetResultType(outerNode),
+								 suffixCols,
+								 plannode->sort.sortColIdx + presortedCols,
+								 plannode->sort.sortOperators + presortedCols,
+								 plannode->sort.nullsFirst + presortedCols,
+								 work_mem,
+								 false);
+		if (node->bounded && node->bound > node->tuples_returned)
+			tuplesort_set_bound(tuplesortstate,
+								node->bound - node->tuples_returned);
+		node->tuplesortstate = (void *) tuplesortstate;
+
+		tuplesort_puttupleslot(tuplesortstate, pivot);
+		tuplesort_puttupleslot(tuplesortstate, slot);
+
+		for (;;)
+		{
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+			{
+				node->finished = true;
+				ExecClearTuple(pivot);
+				break;
+			}
+			if (!execTuplesMatch(slot, pivot,
+								 presortedCols, plannode->sort.sortColIdx,
+								 node->eqfunctions, node->tempContext))
+			{
+				/* first tuple of the next group */
+				ExecCopySlot(pivot, slot);
+				break;
+			}
+			tuplesort_puttupleslot(tuplesortstate, slot);
+		}
+
+		tuplesort_performsort(tuplesortstate);
+		node->groups_sorted++;
+		node->group_Done = true;
+	}
+}
+
+/*
+ * finish_group_sort
+ *
+ *		Release the tuplesort used for the previous group, remembering its
+ *		space consumption for EXPLAIN ANALYZE.
+ */
+static void
+finish_group_sort(IncrementalSortState *node)
+{
+	Tuplesortstate *tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+	const char *sortMethod;
+	const char *spaceType;
+	long		spaceUsed;
+
+	tuplesort_get_stats(tuplesortstate, &sortMethod, &spaceType, &spaceUsed);
+	if (node->max_space_type == NULL || spaceUsed > node->max_space_used)
+	{
+		node->max_space_used = spaceUsed;
+		node->max_space_type = spaceType;
+	}
+
+	tuplesort_end(tuplesortstate);
+	node->tuplesortstate = NULL;
+	node->group_Done = false;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental
+ *		sort node produced by the planner and initializes its outer
+ *		subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *sortstate;
+	Oid		   *eqOperators;
+	int			i;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	sortstate = makeNode(IncrementalSortState);
+	sortstate->ss.ps.plan = (Plan *) node;
+	sortstate->ss.ps.state = estate;
+
+	sortstate->bounded = false;
+	sortstate->bound = 0;
+	sortstate->tuples_returned = 0;
+	sortstate->finished = false;
+	sortstate->group_Done = false;
+	sortstate->tuplesortstate = NULL;
+	sortstate->groups_sorted = 0;
+	sortstate->max_space_used = 0;
+	sortstate->max_space_type = NULL;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * Like Sort, we never call ExecQual or ExecProject, but we do need a
+	 * per-tuple memory context for calling execTuplesMatch.
+	 */
+	sortstate->tempContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "IncrementalSort",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &sortstate->ss.ps);
+	ExecInitScanTupleSlot(estate, &sortstate->ss);
+	sortstate->group_pivot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * We shield the child node from the need to support REWIND, BACKWARD, or
+	 * MARK/RESTORE.
+	 */
+	eflags &= ~(EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK);
+
+	outerPlanState(sortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&sortstate->ss.ps);
+	ExecAssignScanTypeFromOuterPlan(&sortstate->ss);
+	ExecSetSlotDescriptor(sortstate->group_pivot,
+						  ExecGetResultType(outerPlanState(sortstate)));
+	sortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Precompute fmgr lookup data for comparing the presorted columns.  The
+	 * equality operators are the ones that go with the sort operators.
+	 */
+	eqOperators = (Oid *) palloc(node->presortedCols * sizeof(Oid));
+	for (i = 0; i < node->presortedCols; i++)
+	{
+		eqOperators[i] =
+			get_equality_op_for_ordering_op(node->sort.sortOperators[i],
+											NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "could not find equality operator for ordering operator %u",
+				 node->sort.sortOperators[i]);
+	}
+	sortstate->eqfunctions = execTuplesMatchPrepare(node->presortedCols,
+													eqOperators);
+
+	return sortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	MemoryContextDelete(node->tempContext);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	/*
+	 * We don't keep any results around once they've been returned, so a
+	 * rescan always has to start over from the beginning of the input.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+
+	if (node->tuplesortstate != NULL)
+		finish_group_sort(node);
+
+	node->tuples_returned = 0;
+	node->finished = false;
+	node->group_Done = false;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (node->ss.ps.lefttree->chgParam == NULL)
+		ExecReScan(node->ss.ps.lefttree);
+}
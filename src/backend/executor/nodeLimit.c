@@ -294,8 +294,8 @@ recompute_limits(LimitState *node)
 	node->lstate = LIMIT_RESCAN;
 
 	/*
-	 * If we have a COUNT, and our input is a Sort node, notify it that it can
-	 * use bounded sort.
+	 * If we have a COUNT, and our input is a Sort or IncrementalSort node,
+	 * notify it that it can use bounded sort.
 	 *
 	 * This is a bit of a kluge, but we don't have any more-abstract way of
 	 * communicating between the two nodes; and it doesn't seem worth trying
@@ -324,6 +324,21 @@ recompute_limits(LimitState *node)
 			sortState->bound = tuples_needed;
 		}
 	}
+	else if (IsA(outerPlanState(node), IncrementalSortState))
+	{
+		IncrementalSortState *sortState =
+		(IncrementalSortState *) outerPlanState(node);
+		int64		tuples_needed = node->count + node->offset;
+
+		/* same as above */
+		if (node->noCount || tuples_needed < 0)
+			sortState->bounded = false;
+		else
+		{
+			sortState->bounded = true;
+			sortState->bound = tuples_needed;
+		}
+	}
 }
 
 /* ----------------------------------------------------------------
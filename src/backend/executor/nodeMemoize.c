@@ -0,0 +1,538 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeMemoize.c
+ *	  Routines to handle caching of the results of parameterized subplans.
+ *
+ * A Memoize node sits on the inner side of a nestloop, above a subplan
+ * that depends on parameters supplied by the outer side (typically an
+ * inner indexscan).  When the same parameter values come around again,
+ * there's no need to run the subplan: we remember the tuples it returned
+ * the first time in a hash table keyed by the parameter values, and hand
+ * them out from there.
+ *
+ * The cache is bounded by work_mem.  Entries are kept on a list in order
+ * of last use, and when we run out of room we evict the least recently
+ * used ones.  If the result for a single key is too big to fit by itself,
+ * we give up on caching it and just pass the subplan's tuples through.
+ *
+ * An entry is only usable once the subplan has been run to completion for
+ * its key.  If the nestloop rescans us before that (as it does for semi
+ * and anti joins once a match has been found), the partial entry is
+ * thrown away.
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecMemoize			- return the next tuple for the current key
+ *		ExecInitMemoize		- initialize node and subnodes
+ *		ExecEndMemoize		- shutdown node and subnodes
+ *		ExecReScanMemoize	- prepare for a scan with new parameter values
+ */
+#include "postgres.h"
+
+#include "executor/executor.h"
+#include "executor/nodeMemoize.h"
+#include "miscadmin.h"
+#include "utils/memutils.h"
+
+
+/* values of MemoizeState->mstatus */
+#define MEMO_LOOKUP		0		/* must look up the current key first */
+#define MEMO_FETCHING	1		/* returning tuples from a cache entry */
+#define MEMO_FILLING	2		/* running the subplan, caching its output */
+#define MEMO_BYPASS		3		/* running the subplan without caching */
+#define MEMO_END		4		/* no more tuples for the current key */
+
+/* one cached tuple */
+typedef struct MemoizeTupleData
+{
+	MinimalTuple mintuple;
+	struct MemoizeTupleData *next;
+} MemoizeTupleData;
+
+typedef MemoizeTupleData *MemoizeTuple;
+
+/* one cache entry; the key is in shared.firstTuple */
+typedef struct MemoizeEntryData
+{
+	TupleHashEntryData shared;	/* common header for hash table entries */
+	MemoizeTuple tuples;		/* cached tuples, in subplan order */
+	MemoizeTuple last_tuple;	/* last element of the tuples list */
+	bool		complete;		/* did the subplan run to completion? */
+	Size		mem_used;		/* space used by this entry */
+	struct MemoizeEntryData *lru_prev;
+	struct MemoizeEntryData *lru_next;
+} MemoizeEntryData;
+
+typedef MemoizeEntryData *MemoizeEntry;
+
+
+static void build_hash_table(MemoizeState *node);
+static void memoize_lookup(MemoizeState *node);
+static void memoize_add_tuple(MemoizeState *node, TupleTableSlot *slot);
+static bool memoize_make_room(MemoizeState *node);
+static void memoize_remove_entry(MemoizeState *node, MemoizeEntry entry);
+
+
+/*
+ * Initialize the hash table to empty.
+ *
+ * The hash table and all cache entries live in tableContext, so the whole
+ * cache can be dropped by resetting that context and building a new table.
+ */
+static void
+build_hash_table(MemoizeState *node)
+{
+	Memoize    *plannode = (Memoize *) node->ss.ps.plan;
+	long		nbuckets;
+
+	nbuckets = Max(plannode->est_entries, 1);
+
+	node->hashtable = BuildTupleHashTable(node->numKeys,
+										  node->keyColIdx,
+										  node->eqfunctions,
+										  node->hashfunctions,
+										  nbuckets,
+										  sizeof(MemoizeEntryData),
+										  node->tableContext,
+										  node->tempContext);
+	node->lru_head = NULL;
+	node->lru_tail = NULL;
+	node->entry = NULL;
+	node->next_tuple = NULL;
+	node->mem_used = 0;
+}
+
+/*
+ * Look up the current parameter values in the cache.
+ *
+ * On a hit, set up to return the cached tuples; on a miss, make a new
+ * entry and set up to fill it from the subplan.
+ */
+static void
+memoize_lookup(MemoizeState *node)
+{
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	TupleTableSlot *probeslot = node->probeslot;
+	PlanState  *outerNode = outerPlanState(node);
+	MemoryContext oldContext;
+	MemoizeEntry entry;
+	ListCell   *lc;
+	bool		isnew;
+	int			i;
+
+	/* Form the cache key from the current values of the parameters */
+	ResetExprContext(econtext);
+	MemoryContextReset(node->tempContext);
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	ExecClearTuple(probeslot);
+	i = 0;
+	foreach(lc, node->param_exprs)
+	{
+		ExprState  *keyexpr = (ExprState *) lfirst(lc);
+
+		probeslot->tts_values[i] = ExecEvalExpr(keyexpr, econtext,
+												&probeslot->tts_isnull[i],
+												NULL);
+		i++;
+	}
+	ExecStoreVirtualTuple(probeslot);
+
+	MemoryContextSwitchTo(oldContext);
+
+	entry = (MemoizeEntry) LookupTupleHashEntry(node->hashtable, probeslot,
+												&isnew);
+
+	if (!isnew)
+	{
+		/* partial entries are removed on rescan, so this one's complete */
+		Assert(entry->complete);
+		node->hits++;
+
+		/* move it to the most-recently-used end of the list */
+		if (entry != node->lru_tail)
+		{
+			if (entry->lru_prev)
+				entry->lru_prev->lru_next = entry->lru_next;
+			else
+				node->lru_head = entry->lru_next;
+			entry->lru_next->lru_prev = entry->lru_prev;
+			entry->lru_prev = node->lru_tail;
+			entry->lru_next = NULL;
+			node->lru_tail->lru_next = entry;
+			node->lru_tail = entry;
+		}
+
+		node->entry = entry;
+		node->next_tuple = entry->tuples;
+		node->mstatus = MEMO_FETCHING;
+		return;
+	}
+
+	/* A miss: add the new entry at the most-recently-used end */
+	node->misses++;
+	entry->mem_used = sizeof(MemoizeEntryData) +
+		GetMemoryChunkSpace(entry->shared.firstTuple);
+	node->mem_used += entry->mem_used;
+	entry->lru_prev = node->lru_tail;
+	entry->lru_next = NULL;
+	if (node->lru_tail)
+		node->lru_tail->lru_next = entry;
+	else
+		node->lru_head = entry;
+	node->lru_tail = entry;
+	node->entry = entry;
+	node->mstatus = MEMO_FILLING;
+
+	if (!memoize_make_room(node))
+	{
+		node->overflows++;
+		memoize_remove_entry(node, entry);
+		node->entry = NULL;
+		node->mstatus = MEMO_BYPASS;
+	}
+
+	/*
+	 * Make sure the subplan starts over.  If any of its parameters changed,
+	 * ExecProcNode will take care of that; otherwise we must do it, unless
+	 * it hasn't been run since it was last (re)started.
+	 */
+	if (node->outer_used && outerNode->chgParam == NULL)
+		ExecReScan(outerNode);
+	node->outer_used = true;
+}
+
+/*
+ * Append a copy of a subplan tuple to the entry being filled.
+ */
+static void
+memoize_add_tuple(MemoizeState *node, TupleTableSlot *slot)
+{
+	MemoizeEntry entry = node->entry;
+	MemoryContext oldContext;
+	MemoizeTuple mtup;
+	Size		space;
+
+	oldContext = MemoryContextSwitchTo(node->tableContext);
+	mtup = (MemoizeTuple) palloc(sizeof(MemoizeTupleData));
+	mtup->mintuple = ExecCopySlotMinimalTuple(slot);
+	mtup->next = NULL;
+	MemoryContextSwitchTo(oldContext);
+
+	if (entry->last_tuple)
+		entry->last_tuple->next = mtup;
+	else
+		entry->tuples = mtup;
+	entry->last_tuple = mtup;
+
+	space = GetMemoryChunkSpace(mtup) + GetMemoryChunkSpace(mtup->mintuple);
+	entry->mem_used += space;
+	node->mem_used += space;
+
+	if (!memoize_make_room(node))
+	{
+		/* This result is too big to cache, even with the cache to itself */
+		node->overflows++;
+		memoize_remove_entry(node, entry);
+		node->entry = NULL;
+		node->mstatus = MEMO_BYPASS;
+	}
+}
+
+/*
+ * Evict least recently used entries until the cache fits in work_mem.
+ *
+ * The entry currently being filled is never evicted; if it's the only one
+ * left and we're still over the limit, return false.
+ */
+static bool
+memoize_make_room(MemoizeState *node)
+{
+	if (node->mem_used > node->mem_peak)
+		node->mem_peak = node->mem_used;
+
+	while (node->mem_used > node->mem_limit)
+	{
+		MemoizeEntry victim = node->lru_head;
+
+		if (victim == NULL || victim == node->entry)
+			return false;
+		memoize_remove_entry(node, victim);
+		node->evictions++;
+	}
+	return true;
+}
+
+/*
+ * Remove an entry from the cache and free its space.
+ */
+static void
+memoize_remove_entry(MemoizeState *node, MemoizeEntry entry)
+{
+	MinimalTuple key = entry->shared.firstTuple;
+	MemoizeTuple mtup;
+
+	/* unlink from the LRU list */
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		node->lru_head = entry->lru_next;
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		node->lru_tail = entry->lru_prev;
+
+	mtup = entry->tuples;
+	while (mtup != NULL)
+	{
+		MemoizeTuple next = mtup->next;
+
+		pfree(mtup->mintuple);
+		pfree(mtup);
+		mtup = next;
+	}
+	node->mem_used -= entry->mem_used;
+
+	/* the probe slot is free to hold the key while we remove the entry */
+	ExecStoreMinimalTuple(key, node->probeslot, false);
+	RemoveTupleHashEntry(node->hashtable, node->probeslot);
+	ExecClearTuple(node->probeslot);
+	pfree(key);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecMemoize
+ *
+ *		Returns the next tuple for the current parameter values, either
+ *		from the cache or from the subplan.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecMemoize(MemoizeState *node)
+{
+	TupleTableSlot *slot;
+
+	if (node->mstatus == MEMO_LOOKUP)
+		memoize_lookup(node);
+
+	switch (node->mstatus)
+	{
+		case MEMO_FETCHING:
+			{
+				MemoizeTuple mtup = node->next_tuple;
+
+				if (mtup == NULL)
+				{
+					node->mstatus = MEMO_END;
+					break;
+				}
+				node->next_tuple = mtup->next;
+				return ExecStoreMinimalTuple(mtup->mintuple,
+											 node->ss.ps.ps_ResultTupleSlot,
+											 false);
+			}
+
+		case MEMO_FILLING:
+		case MEMO_BYPASS:
+			slot = ExecProcNode(outerPlanState(node));
+			if (TupIsNull(slot))
+			{
+				if (node->mstatus == MEMO_FILLING)
+					node->entry->complete = true;
+				node->mstatus = MEMO_END;
+				break;
+			}
+			if (node->mstatus == MEMO_FILLING)
+				memoize_add_tuple(node, slot);
+			return slot;
+
+		case MEMO_END:
+			break;
+
+		default:
+			elog(ERROR, "unrecognized memoize state: %d", node->mstatus);
+			break;
+	}
+
+	return ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitMemoize
+ * ----------------------------------------------------------------
+ */
+MemoizeState *
+ExecInitMemoize(Memoize *node, EState *estate, int eflags)
+{
+	MemoizeState *mstate;
+	TupleDesc	keydesc;
+	ListCell   *lc;
+	int			i;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	mstate = makeNode(MemoizeState);
+	mstate->ss.ps.plan = (Plan *) node;
+	mstate->ss.ps.state = estate;
+
+	mstate->mstatus = MEMO_LOOKUP;
+	mstate->numKeys = node->numKeys;
+	mstate->outer_used = false;
+	mstate->mem_limit = work_mem * 1024L;
+	mstate->mem_peak = 0;
+	mstate->hits = 0;
+	mstate->misses = 0;
+	mstate->evictions = 0;
+	mstate->overflows = 0;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We need an expression context to evaluate the cache keys in, plus
+	 * one long-lived context for the cache and a short-lived one for the
+	 * hash and equality functions.
+	 */
+	ExecAssignExprContext(estate, &mstate->ss.ps);
+
+	mstate->tableContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "Memoize",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+	mstate->tempContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "Memoize hash temp context",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &mstate->ss.ps);
+	mstate->probeslot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * initialize child expressions and nodes
+	 */
+	mstate->param_exprs = (List *)
+		ExecInitExpr((Expr *) node->param_exprs, (PlanState *) mstate);
+
+	outerPlanState(mstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&mstate->ss.ps);
+	mstate->ss.ps.ps_ProjInfo = NULL;
+
+	keydesc = ExecTypeFromExprList(node->param_exprs);
+	ExecSetSlotDescriptor(mstate->probeslot, keydesc);
+
+	/*
+	 * Remember which params make up the cache key, so that ReScan can tell
+	 * whether anything else has changed.
+	 */
+	mstate->keyparamids = NULL;
+	foreach(lc, node->param_exprs)
+	{
+		Param	   *param = (Param *) lfirst(lc);
+
+		Assert(IsA(param, Param) && param->paramkind == PARAM_EXEC);
+		mstate->keyparamids = bms_add_member(mstate->keyparamids,
+											 param->paramid);
+	}
+
+	/*
+	 * Set up the hash table, keyed on all the columns of the probe slot
+	 */
+	mstate->keyColIdx = (AttrNumber *)
+		palloc(node->numKeys * sizeof(AttrNumber));
+	for (i = 0; i < node->numKeys; i++)
+		mstate->keyColIdx[i] = i + 1;
+	execTuplesHashPrepare(node->numKeys,
+						  node->hashOperators,
+						  &mstate->eqfunctions,
+						  &mstate->hashfunctions);
+	build_hash_table(mstate);
+
+	return mstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndMemoize
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndMemoize(MemoizeState *node)
+{
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->probeslot);
+
+	/*
+	 * Release the cache
+	 */
+	MemoryContextDelete(node->tableContext);
+	MemoryContextDelete(node->tempContext);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+void
+ExecReScanMemoize(MemoizeState *node)
+{
+	Bitmapset  *chgParam = node->ss.ps.chgParam;
+
+	/* must drop pointer to cached tuple before freeing anything */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+
+	/* a partly filled entry is of no use to anyone */
+	if (node->mstatus == MEMO_FILLING)
+		memoize_remove_entry(node, node->entry);
+
+	node->entry = NULL;
+	node->next_tuple = NULL;
+	node->mstatus = MEMO_LOOKUP;
+
+	/*
+	 * The cached results remain valid as long as nothing but the cache key
+	 * has changed.  If some other parameter the subplan depends on changed,
+	 * we have to throw the whole cache away.
+	 */
+	if (chgParam != NULL && !bms_is_subset(chgParam, node->keyparamids))
+	{
+		MemoryContextReset(node->tableContext);
+		build_hash_table(node);
+	}
+
+	/*
+	 * The subplan is not rescanned until we actually need it to produce an
+	 * entry for a key we haven't got.
+	 */
+}
@@ -249,7 +249,7 @@ ExecInsert(TupleTableSlot *slot,
 	 */
 	if (resultRelInfo->ri_NumIndices > 0)
 		recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
-											   estate);
+											   estate, false);
 
 	/* AFTER ROW INSERT Triggers */
 	ExecARInsertTriggers(estate, resultRelInfo, tuple, recheckIndexes);
@@ -429,6 +429,7 @@ ExecUpdate(ItemPointer tupleid,
 	HTSU_Result result;
 	ItemPointerData update_ctid;
 	TransactionId update_xmax;
+	bool		summarized_update;
 	List	   *recheckIndexes = NIL;
 
 	/*
@@ -505,7 +506,8 @@ lreplace:;
 						 &update_ctid, &update_xmax,
 						 estate->es_output_cid,
 						 estate->es_crosscheck_snapshot,
-						 true /* wait for commit */ );
+						 true /* wait for commit */ ,
+						 &summarized_update);
 	switch (result)
 	{
 		case HeapTupleSelfUpdated:
@@ -562,11 +564,14 @@ lreplace:;
 	 * Note: heap_update returns the tid (location) of the new tuple in the
 	 * t_self field.
 	 *
-	 * If it's a HOT update, we mustn't insert new index entries.
+	 * If it's a HOT update, we mustn't insert new index entries, except
+	 * into summarizing indexes whose columns changed.
 	 */
-	if (resultRelInfo->ri_NumIndices > 0 && !HeapTupleIsHeapOnly(tuple))
+	if (resultRelInfo->ri_NumIndices > 0 &&
+		(!HeapTupleIsHeapOnly(tuple) || summarized_update))
 		recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
-											   estate);
+											   estate,
+											   HeapTupleIsHeapOnly(tuple) != 0);
 
 	/* AFTER ROW UPDATE Triggers */
 	ExecARUpdateTriggers(estate, resultRelInfo, tupleid, tuple,
@@ -0,0 +1,411 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.c
+ *	  Compact in-memory set of heap tuple TIDs.
+ *
+ * This is used by lazy VACUUM to remember the dead tuples found in the heap,
+ * and to look up each index entry's TID in that set while scanning the
+ * indexes.  Compared to a sorted array of ItemPointerData, which costs six
+ * bytes per TID and a binary search per lookup, it stores the TIDs of each
+ * heap block as a bitmap of offset numbers, and finds a block's bitmap
+ * with a fixed number of steps.
+ *
+ * The set is a radix tree keyed by block number, with three levels:
+ *
+ * - The directory is an array of pointers to chunks, indexed by the high
+ *	 bits of the block number.  It is sized for the relation when the store
+ *	 is created, and enlarged if a block beyond that is added.
+ *
+ * - A chunk is an array of TIDSTORE_CHUNK_LEAVES leaves.  Chunks are only
+ *	 allocated for block ranges that have some TIDs.
+ *
+ * - A leaf covers TIDSTORE_LEAF_BLOCKS consecutive blocks.  It has a bitmask
+ *	 of the blocks that have TIDs, and a pointer to the entries for those
+ *	 blocks, stored back to back in block order.
+ *
+ * Each block's entry is two bytes followed by a bitmap of offset numbers:
+ * the first byte is the index of the first bitmap byte (that is, the
+ * smallest offset divided by 8, since bitmap bytes before it would be all
+ * zeroes), and the second is the number of bitmap bytes.  Heap offset
+ * numbers never exceed MaxHeapTuplesPerPage, so both always fit in a byte.
+ * A block with a single dead tuple takes three bytes, and a block with many
+ * dead tuples less than a bit per line pointer.  To find a block's entry,
+ * we skip over the entries of the blocks before it in the same leaf, of
+ * which there are at most TIDSTORE_LEAF_BLOCKS - 1.
+ *
+ * Entries are carved out of large segments.  Since blocks must be added
+ * in ascending order, only the last leaf is ever added to, so each leaf's
+ * entries are contiguous; when the current segment fills up, the entries
+ * of the last leaf so far are copied to the new segment.  Nothing is ever
+ * freed individually, so the whole store is kept in its own memory context
+ * and reset in one go.  Since no single allocation is larger than a
+ * segment or a chunk (or the directory, which is at most 512kB), the store
+ * isn't limited by MaxAllocSize.
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup.h"
+#include "lib/tidstore.h"
+#include "storage/bufpage.h"
+#include "utils/memutils.h"
+
+
+#define TIDSTORE_LEAF_BITS		6
+#define TIDSTORE_LEAF_BLOCKS	(1 << TIDSTORE_LEAF_BITS)
+#define TIDSTORE_CHUNK_BITS		10
+#define TIDSTORE_CHUNK_LEAVES	(1 << TIDSTORE_CHUNK_BITS)
+#define TIDSTORE_CHUNK_SHIFT	(TIDSTORE_LEAF_BITS + TIDSTORE_CHUNK_BITS)
+
+#define TIDSTORE_SEGMENT_SIZE	(64 * 1024)
+
+/* size of a block's entry, given its first and last bitmap byte */
+#define TIDSTORE_ENTRY_SIZE(firstbyte, lastbyte)	(2 + (lastbyte) - (firstbyte) + 1)
+
+typedef struct TidStoreLeaf
+{
+	uint64		present;		/* bit N is set if block N of the leaf has
+								 * an entry */
+	unsigned char *data;		/* the entries of those blocks */
+} TidStoreLeaf;
+
+struct TidStore
+{
+	MemoryContext cxt;			/* holds everything but this struct */
+	Size		max_bytes;		/* memory limit, see tidstore_is_full */
+	Size		mem_used;		/* memory allocated in cxt */
+	double		num_tids;		/* number of TIDs in the store */
+
+	TidStoreLeaf **chunks;		/* the directory */
+	uint32		nchunks;		/* allocated length of the directory */
+
+	/* state for adding blocks */
+	BlockNumber last_blkno;		/* last block added, or InvalidBlockNumber */
+	TidStoreLeaf *cur_leaf;		/* leaf of last_blkno */
+	Size		cur_leaf_len;	/* length of cur_leaf's entries */
+	unsigned char *seg_free;	/* free space in current segment */
+	Size		seg_avail;		/* bytes available at seg_free */
+};
+
+struct TidStoreIter
+{
+	TidStore   *ts;
+	uint32		chunkno;		/* position of the next block to return */
+	uint32		leafno;
+	int			bitno;
+	unsigned char *ptr;			/* its entry, if bitno > 0 */
+};
+
+
+/*
+ * Allocate an empty directory covering nchunks chunks.
+ */
+static void
+tidstore_init_directory(TidStore *ts, uint32 nchunks)
+{
+	ts->nchunks = nchunks;
+	ts->chunks = (TidStoreLeaf **)
+		MemoryContextAllocZero(ts->cxt, nchunks * sizeof(TidStoreLeaf *));
+	ts->mem_used = nchunks * sizeof(TidStoreLeaf *);
+	ts->num_tids = 0;
+
+	ts->last_blkno = InvalidBlockNumber;
+	ts->cur_leaf = NULL;
+	ts->cur_leaf_len = 0;
+	ts->seg_free = NULL;
+	ts->seg_avail = 0;
+}
+
+/*
+ * Create an empty TidStore, for a relation of nblocks blocks, that will
+ * use up to max_bytes of memory.
+ */
+TidStore *
+tidstore_create(Size max_bytes, BlockNumber nblocks)
+{
+	TidStore   *ts;
+
+	ts = (TidStore *) palloc0(sizeof(TidStore));
+	ts->cxt = AllocSetContextCreate(CurrentMemoryContext,
+									"TID store",
+									ALLOCSET_DEFAULT_MINSIZE,
+									ALLOCSET_DEFAULT_INITSIZE,
+									ALLOCSET_DEFAULT_MAXSIZE);
+	ts->max_bytes = max_bytes;
+	tidstore_init_directory(ts, (nblocks >> TIDSTORE_CHUNK_SHIFT) + 1);
+
+	return ts;
+}
+
+void
+tidstore_free(TidStore *ts)
+{
+	MemoryContextDelete(ts->cxt);
+	pfree(ts);
+}
+
+/*
+ * Forget all the TIDs in the store.
+ */
+void
+tidstore_reset(TidStore *ts)
+{
+	uint32		nchunks = ts->nchunks;
+
+	MemoryContextReset(ts->cxt);
+	tidstore_init_directory(ts, nchunks);
+}
+
+/*
+ * Add the TIDs of one heap block.  The offsets must be in ascending order,
+ * and the block must come after all the blocks already added.
+ */
+void
+tidstore_add_offsets(TidStore *ts, BlockNumber blkno,
+					 OffsetNumber *offsets, int noffsets)
+{
+	uint32		chunkno;
+	TidStoreLeaf *chunk;
+	TidStoreLeaf *leaf;
+	int			firstbyte;
+	int			lastbyte;
+	Size		entrysize;
+	unsigned char *entry;
+	int			i;
+
+	Assert(noffsets > 0);
+
+	if (BlockNumberIsValid(ts->last_blkno) && blkno <= ts->last_blkno)
+		elog(ERROR, "TIDs must be added in ascending block order");
+	if (offsets[0] < FirstOffsetNumber ||
+		offsets[noffsets - 1] > MaxHeapTuplesPerPage)
+		elog(ERROR, "invalid offset number for TID store");
+
+	/* Find the block's chunk, enlarging the directory if needed */
+	chunkno = blkno >> TIDSTORE_CHUNK_SHIFT;
+	if (chunkno >= ts->nchunks)
+	{
+		uint32		newnchunks = Max(chunkno + 1, ts->nchunks * 2);
+
+		ts->chunks = (TidStoreLeaf **)
+			repalloc(ts->chunks, newnchunks * sizeof(TidStoreLeaf *));
+		MemSet(ts->chunks + ts->nchunks, 0,
+			   (newnchunks - ts->nchunks) * sizeof(TidStoreLeaf *));
+		ts->mem_used += (newnchunks - ts->nchunks) * sizeof(TidStoreLeaf *);
+		ts->nchunks = newnchunks;
+	}
+	chunk = ts->chunks[chunkno];
+	if (chunk == NULL)
+	{
+		chunk = (TidStoreLeaf *)
+			MemoryContextAllocZero(ts->cxt,
+							   TIDSTORE_CHUNK_LEAVES * sizeof(TidStoreLeaf));
+		ts->mem_used += TIDSTORE_CHUNK_LEAVES * sizeof(TidStoreLeaf);
+		ts->chunks[chunkno] = chunk;
+	}
+
+	leaf = &chunk[(blkno >> TIDSTORE_LEAF_BITS) & (TIDSTORE_CHUNK_LEAVES - 1)];
+	if (leaf != ts->cur_leaf)
+	{
+		Assert(leaf->present == 0);
+		ts->cur_leaf = leaf;
+		ts->cur_leaf_len = 0;
+	}
+
+	/*
+	 * Make room for the entry, moving the leaf's earlier entries along to a
+	 * new segment if it doesn't fit in the current one.
+	 */
+	firstbyte = offsets[0] / BITS_PER_BYTE;
+	lastbyte = offsets[noffsets - 1] / BITS_PER_BYTE;
+	entrysize = TIDSTORE_ENTRY_SIZE(firstbyte, lastbyte);
+
+	if (entrysize > ts->seg_avail)
+	{
+		unsigned char *seg;
+
+		seg = (unsigned char *) MemoryContextAlloc(ts->cxt,
+												   TIDSTORE_SEGMENT_SIZE);
+		ts->mem_used += TIDSTORE_SEGMENT_SIZE;
+		if (ts->cur_leaf_len > 0)
+		{
+			memcpy(seg, leaf->data, ts->cur_leaf_len);
+			leaf->data = seg;
+		}
+		ts->seg_free = seg + ts->cur_leaf_len;
+		ts->seg_avail = TIDSTORE_SEGMENT_SIZE - ts->cur_leaf_len;
+	}
+	if (ts->cur_leaf_len == 0)
+		leaf->data = ts->seg_free;
+
+	entry = ts->seg_free;
+	entry[0] = (unsigned char) firstbyte;
+	entry[1] = (unsigned char) (lastbyte - firstbyte + 1);
+	MemSet(entry + 2, 0, entrysize - 2);
+	for (i = 0; i < noffsets; i++)
+	{
+		Assert(i == 0 || offsets[i] > offsets[i - 1]);
+		entry[2 + offsets[i] / BITS_PER_BYTE - firstbyte] |=
+			1 << (offsets[i] % BITS_PER_BYTE);
+	}
+
+	ts->seg_free += entrysize;
+	ts->seg_avail -= entrysize;
+	ts->cur_leaf_len += entrysize;
+
+	leaf->present |= UINT64CONST(1) << (blkno & (TIDSTORE_LEAF_BLOCKS - 1));
+	ts->last_blkno = blkno;
+	ts->num_tids += noffsets;
+}
+
+/*
+ * Is the given TID in the store?
+ */
+bool
+tidstore_lookup(TidStore *ts, ItemPointer tid)
+{
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber off = ItemPointerGetOffsetNumber(tid);
+	uint32		chunkno = blkno >> TIDSTORE_CHUNK_SHIFT;
+	TidStoreLeaf *leaf;
+	uint64		bit;
+	uint64		earlier;
+	unsigned char *entry;
+	int			byteno;
+
+	if (chunkno >= ts->nchunks || ts->chunks[chunkno] == NULL)
+		return false;
+
+	leaf = &ts->chunks[chunkno][(blkno >> TIDSTORE_LEAF_BITS) &
+								(TIDSTORE_CHUNK_LEAVES - 1)];
+	bit = UINT64CONST(1) << (blkno & (TIDSTORE_LEAF_BLOCKS - 1));
+	if ((leaf->present & bit) == 0)
+		return false;
+
+	/* skip the entries of the earlier blocks in the leaf */
+	entry = leaf->data;
+	earlier = leaf->present & (bit - 1);
+	while (earlier != 0)
+	{
+		entry += TIDSTORE_ENTRY_SIZE(0, entry[1] - 1);
+		earlier &= earlier - 1;
+	}
+
+	byteno = off / BITS_PER_BYTE - entry[0];
+	if (byteno < 0 || byteno >= entry[1])
+		return false;
+	return (entry[2 + byteno] & (1 << (off % BITS_PER_BYTE))) != 0;
+}
+
+/*
+ * Has the store used up its memory?  We return true when another block
+ * might not fit, allowing for it to need a new chunk and a new segment.
+ */
+bool
+tidstore_is_full(TidStore *ts)
+{
+	return ts->mem_used + TIDSTORE_CHUNK_LEAVES * sizeof(TidStoreLeaf) +
+		TIDSTORE_SEGMENT_SIZE > ts->max_bytes;
+}
+
+double
+tidstore_num_tids(TidStore *ts)
+{
+	return ts->num_tids;
+}
+
+Size
+tidstore_memory_usage(TidStore *ts)
+{
+	return ts->mem_used;
+}
+
+/*
+ * Prepare to read back the contents of the store, in block order.  The
+ * store mustn't be modified until tidstore_end_iterate is called.
+ */
+TidStoreIter *
+tidstore_begin_iterate(TidStore *ts)
+{
+	TidStoreIter *iter;
+
+	iter = (TidStoreIter *) palloc0(sizeof(TidStoreIter));
+	iter->ts = ts;
+
+	return iter;
+}
+
+/*
+ * Return the next block of the store, and its offsets in ascending order.
+ * offsets must have room for MaxHeapTuplesPerPage entries.  Returns false
+ * when there are no more blocks.
+ */
+bool
+tidstore_iterate_next(TidStoreIter *iter, BlockNumber *blkno,
+					  OffsetNumber *offsets, int *noffsets)
+{
+	TidStore   *ts = iter->ts;
+
+	for (; iter->chunkno < ts->nchunks; iter->chunkno++, iter->leafno = 0)
+	{
+		TidStoreLeaf *chunk = ts->chunks[iter->chunkno];
+
+		if (chunk == NULL)
+			continue;
+
+		for (; iter->leafno < TIDSTORE_CHUNK_LEAVES;
+			 iter->leafno++, iter->bitno = 0)
+		{
+			TidStoreLeaf *leaf = &chunk[iter->leafno];
+
+			if (iter->bitno == 0)
+				iter->ptr = leaf->data;
+
+			for (; iter->bitno < TIDSTORE_LEAF_BLOCKS; iter->bitno++)
+			{
+				unsigned char *entry = iter->ptr;
+				int			n = 0;
+				int			i;
+
+				if ((leaf->present & (UINT64CONST(1) << iter->bitno)) == 0)
+					continue;
+
+				for (i = 0; i < entry[1]; i++)
+				{
+					unsigned char byte = entry[2 + i];
+					int			j;
+
+					for (j = 0; byte != 0; j++, byte >>= 1)
+					{
+						if (byte & 1)
+							offsets[n++] = (entry[0] + i) * BITS_PER_BYTE + j;
+					}
+				}
+
+				*blkno = (iter->chunkno << TIDSTORE_CHUNK_SHIFT) |
+					(iter->leafno << TIDSTORE_LEAF_BITS) | iter->bitno;
+				*noffsets = n;
+
+				iter->ptr += TIDSTORE_ENTRY_SIZE(0, entry[1] - 1);
+				iter->bitno++;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void
+tidstore_end_iterate(TidStoreIter *iter)
+{
+	pfree(iter);
+}
@@ -112,11 +112,15 @@ bool		enable_indexscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
+bool		enable_memoize = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_partitionwise_join = false;
+bool		enable_partitionwise_aggregate = false;
 
 typedef struct
 {
@@ -129,6 +133,7 @@ static MergeScanSelCache *cached_scansel(PlannerInfo *root,
 			   PathKey *pathkey);
 static void cost_rescan(PlannerInfo *root, Path *path,
 			Cost *rescan_startup_cost, Cost *rescan_total_cost);
+static double nestloop_inner_path_rows(Path *path);
 static bool cost_qual_eval_walker(Node *node, cost_qual_eval_context *context);
 static bool adjust_semi_join(PlannerInfo *root, JoinPath *path,
 				 SpecialJoinInfo *sjinfo,
@@ -138,6 +143,8 @@ static bool adjust_semi_join(PlannerInfo *root, JoinPath *path,
 static double approx_tuple_count(PlannerInfo *root, JoinPath *path,
 				   List *quals);
 static void set_rel_width(PlannerInfo *root, RelOptInfo *rel);
+static void cost_tuplesort(Cost *startup_cost, Cost *run_cost,
+			   double tuples, int width, double limit_tuples);
 static double relation_byte_size(double tuples, int width);
 static double page_size(double tuples, int width);
 
@@ -1114,14 +1121,142 @@ cost_sort(Path *path, PlannerInfo *root,
 {
 	Cost		startup_cost = input_cost;
 	Cost		run_cost = 0;
+
+	if (!enable_sort)
+		startup_cost += disable_cost;
+
+	cost_tuplesort(&startup_cost, &run_cost, tuples, width, limit_tuples);
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of an incremental sort, that is, of
+ *	  sorting input that is already sorted on the first 'presorted_keys'
+ *	  of the given pathkeys, including the cost of reading the input data.
+ *
+ * The input is divided into groups of tuples having equal values of the
+ * presorted keys, and each group is sorted separately on the remaining
+ * keys.  We estimate the number of groups with estimate_num_groups and
+ * assume they are all of equal size.  Startup cost covers reading and
+ * sorting the first group only; the other groups are charged to run cost,
+ * which is the whole point of the exercise when there's a LIMIT above us.
+ * On top of the sorting itself we charge one operator eval per presorted
+ * key per input tuple, for comparing each tuple against the group pivot.
+ *
+ * 'pathkeys' is the list of sort keys
+ * 'presorted_keys' is the number of leading pathkeys the input is sorted by
+ * 'input_startup_cost', 'input_total_cost' are the costs of the input path
+ * 'input_tuples' is the number of tuples in the input
+ * 'width' is the average tuple width in bytes
+ * 'limit_tuples' is the bound on the number of output tuples; -1 if no bound
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double input_tuples, int width, double limit_tuples)
+{
+	Cost		startup_cost = input_startup_cost;
+	Cost		run_cost = input_total_cost - input_startup_cost;
+	Cost		group_startup_cost = 0;
+	Cost		group_run_cost = 0;
+	List	   *presortedExprs = NIL;
+	ListCell   *l;
+	double		num_groups;
+	double		group_tuples;
+	double		group_limit;
+	int			i = 0;
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	if (!enable_incrementalsort)
+		startup_cost += disable_cost;
+
+	if (input_tuples < 2.0)
+		input_tuples = 2.0;
+
+	/*
+	 * Collect an expression for each presorted key, so we can estimate the
+	 * number of groups.  Any non-constant member of the key's equivalence
+	 * class will do, since they're all equal anyway; child members are
+	 * skipped because estimate_num_groups wants Vars of the parent rels.
+	 */
+	foreach(l, pathkeys)
+	{
+		PathKey    *key = (PathKey *) lfirst(l);
+		EquivalenceMember *member = NULL;
+		ListCell   *lc;
+
+		if (i++ >= presorted_keys)
+			break;
+
+		foreach(lc, key->pk_eclass->ec_members)
+		{
+			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc);
+
+			if (!em->em_is_const && !em->em_is_child)
+			{
+				member = em;
+				break;
+			}
+		}
+		if (member != NULL)
+			presortedExprs = lappend(presortedExprs, member->em_expr);
+	}
+
+	if (presortedExprs != NIL)
+		num_groups = estimate_num_groups(root, presortedExprs, input_tuples);
+	else
+		num_groups = 1.0;
+	num_groups = clamp_row_est(Min(num_groups, input_tuples));
+	group_tuples = input_tuples / num_groups;
+
+	/*
+	 * Within a group, a LIMIT lets us bound the sort only if the limit falls
+	 * inside the first group; otherwise each group is sorted in full.
+	 */
+	if (limit_tuples > 0 && limit_tuples < group_tuples)
+		group_limit = limit_tuples;
+	else
+		group_limit = -1.0;
+
+	cost_tuplesort(&group_startup_cost, &group_run_cost,
+				   group_tuples, width, group_limit);
+
+	/*
+	 * Before returning anything we must read the first group and sort it.
+	 * The rest of the groups are read and sorted as we go.
+	 */
+	startup_cost += run_cost / num_groups + group_startup_cost;
+	run_cost -= run_cost / num_groups;
+	run_cost += group_run_cost + (num_groups - 1.0) *
+		(group_startup_cost + group_run_cost);
+
+	/* group boundary detection */
+	run_cost += cpu_operator_cost * input_tuples * presorted_keys;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
+/*
+ * cost_tuplesort
+ *	  Adds the cost of sorting 'tuples' tuples of the given width to
+ *	  *startup_cost and *run_cost, not counting the cost of the input.
+ *	  Shared by cost_sort and cost_incremental_sort, q.v.
+ */
+static void
+cost_tuplesort(Cost *startup_cost, Cost *run_cost,
+			   double tuples, int width, double limit_tuples)
+{
 	double		input_bytes = relation_byte_size(tuples, width);
 	double		output_bytes;
 	double		output_tuples;
 	long		work_mem_bytes = work_mem * 1024L;
 
-	if (!enable_sort)
-		startup_cost += disable_cost;
-
 	/*
 	 * We want to be sure the cost of a sort is never estimated as zero, even
 	 * if passed-in tuple count is zero.  Besides, mustn't do log(0)...
@@ -1158,7 +1293,7 @@ cost_sort(Path *path, PlannerInfo *root,
 		 * Assume about two operator evals per tuple comparison and N log2 N
 		 * comparisons
 		 */
-		startup_cost += 2.0 * cpu_operator_cost * tuples * LOG2(tuples);
+		*startup_cost += 2.0 * cpu_operator_cost * tuples * LOG2(tuples);
 
 		/* Disk costs */
 
@@ -1169,7 +1304,7 @@ cost_sort(Path *path, PlannerInfo *root,
 			log_runs = 1.0;
 		npageaccesses = 2.0 * npages * log_runs;
 		/* Assume 3/4ths of accesses are sequential, 1/4th are not */
-		startup_cost += npageaccesses *
+		*startup_cost += npageaccesses *
 			(seq_page_cost * 0.75 + random_page_cost * 0.25);
 	}
 	else if (tuples > 2 * output_tuples || input_bytes > work_mem_bytes)
@@ -1180,12 +1315,12 @@ cost_sort(Path *path, PlannerInfo *root,
 		 * factor is a bit higher than for quicksort.  Tweak it so that the
 		 * cost curve is continuous at the crossover point.
 		 */
-		startup_cost += 2.0 * cpu_operator_cost * tuples * LOG2(2.0 * output_tuples);
+		*startup_cost += 2.0 * cpu_operator_cost * tuples * LOG2(2.0 * output_tuples);
 	}
 	else
 	{
 		/* We'll use plain quicksort on all the input tuples */
-		startup_cost += 2.0 * cpu_operator_cost * tuples * LOG2(tuples);
+		*startup_cost += 2.0 * cpu_operator_cost * tuples * LOG2(tuples);
 	}
 
 	/*
@@ -1196,10 +1331,7 @@ cost_sort(Path *path, PlannerInfo *root,
 	 * here --- the upper LIMIT will pro-rate the run cost so we'd be double
 	 * counting the LIMIT otherwise.
 	 */
-	run_cost += cpu_operator_cost * tuples;
-
-	path->startup_cost = startup_cost;
-	path->total_cost = startup_cost + run_cost;
+	*run_cost += cpu_operator_cost * tuples;
 }
 
 /*
@@ -1255,6 +1387,51 @@ cost_material(Path *path,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_memoize
+ *	  Determines and returns the cost of a first scan of a Memoize node,
+ *	  and estimates how well the cache will work on rescans.
+ *
+ * The first scan costs the same as the subpath, plus a little for copying
+ * the tuples into the cache.  What we're really interested in is the hit
+ * ratio, which cost_rescan uses to blend the cost of answering from the
+ * cache with the cost of running the subpath.  We expect one miss per
+ * distinct key value among the 'calls' rescans, and beyond that, that a
+ * lookup finds its entry still in the cache with probability equal to the
+ * fraction of the distinct keys that fit in work_mem at once.
+ *
+ * 'path' is already filled in except for the cost and estimate fields
+ */
+void
+cost_memoize(MemoizePath *path, PlannerInfo *root)
+{
+	Path	   *subpath = path->subpath;
+	double		calls = path->calls;
+	double		tuples = nestloop_inner_path_rows(subpath);
+	double		ndistinct;
+	double		entry_bytes;
+	double		max_entries;
+
+	if (calls < 1.0)
+		calls = 1.0;
+
+	ndistinct = estimate_num_groups(root, path->param_exprs, calls);
+	ndistinct = clamp_row_est(Min(ndistinct, calls));
+
+	/* one entry holds the key and all the tuples for it */
+	entry_bytes = relation_byte_size(tuples + 1.0, path->path.parent->width);
+	max_entries = floor((work_mem * 1024.0) / entry_bytes);
+	path->est_entries = Max(Min(ndistinct, max_entries), 1.0);
+
+	path->hit_ratio = ((calls - ndistinct) / calls) *
+		(path->est_entries / ndistinct);
+	path->hit_ratio = Max(Min(path->hit_ratio, 1.0), 0.0);
+
+	path->path.startup_cost = subpath->startup_cost;
+	path->path.total_cost = subpath->total_cost +
+		cpu_operator_cost * tuples;
+}
+
 /*
  * cost_agg
  *		Determines and returns the cost of performing an Agg plan node,
@@ -1409,6 +1586,8 @@ nestloop_inner_path_rows(Path *path)
 		result = ((IndexPath *) path)->rows;
 	else if (IsA(path, BitmapHeapPath))
 		result = ((BitmapHeapPath *) path)->rows;
+	else if (IsA(path, MemoizePath))
+		result = nestloop_inner_path_rows(((MemoizePath *) path)->subpath);
 	else if (IsA(path, AppendPath))
 	{
 		ListCell   *l;
@@ -2430,6 +2609,32 @@ cost_rescan(PlannerInfo *root, Path *path,
 				*rescan_total_cost = run_cost;
 			}
 			break;
+		case T_Memoize:
+			{
+				/*
+				 * A cache hit costs a hash lookup plus cpu_operator_cost per
+				 * returned tuple, as for Material; a miss costs a rescan of
+				 * the subpath, plus the work of caching its output.  The
+				 * lookup is paid either way.
+				 */
+				MemoizePath *mpath = (MemoizePath *) path;
+				Path	   *subpath = mpath->subpath;
+				double		hit_ratio = mpath->hit_ratio;
+				Cost		hit_cost;
+				Cost		sub_rescan_startup;
+				Cost		sub_rescan_total;
+
+				cost_rescan(root, subpath,
+							&sub_rescan_startup, &sub_rescan_total);
+				hit_cost = cpu_operator_cost *
+					nestloop_inner_path_rows(subpath);
+
+				*rescan_startup_cost = cpu_tuple_cost +
+					(1.0 - hit_ratio) * sub_rescan_startup;
+				*rescan_total_cost = cpu_tuple_cost + hit_cost +
+					(1.0 - hit_ratio) * sub_rescan_total;
+			}
+			break;
 		default:
 			*rescan_startup_cost = path->startup_cost;
 			*rescan_total_cost = path->total_cost;
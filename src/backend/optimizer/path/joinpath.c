@@ -17,9 +17,12 @@
 #include <math.h>
 
 #include "executor/executor.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
+#include "optimizer/restrictinfo.h"
+#include "utils/lsyscache.h"
 
 
 static void sort_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
@@ -36,6 +39,8 @@ static void hash_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 					 JoinType jointype, SpecialJoinInfo *sjinfo);
 static Path *best_appendrel_indexscan(PlannerInfo *root, RelOptInfo *rel,
 						 RelOptInfo *outer_rel, JoinType jointype);
+static Path *get_memoize_path(PlannerInfo *root, RelOptInfo *innerrel,
+				 RelOptInfo *outerrel, Path *inner_path);
 static List *select_mergejoin_clauses(PlannerInfo *root,
 						 RelOptInfo *joinrel,
 						 RelOptInfo *outerrel,
@@ -342,11 +347,12 @@ sort_inner_and_outer(PlannerInfo *root,
  *	  only outer paths that are already ordered well enough for merging).
  *
  * We always generate a nestloop path for each available outer path.
- * In fact we may generate as many as five: one on the cheapest-total-cost
+ * In fact we may generate as many as six: one on the cheapest-total-cost
  * inner path, one on the same with materialization, one on the
  * cheapest-startup-cost inner path (if different), one on the
- * cheapest-total inner-indexscan path (if any), and one on the
- * cheapest-startup inner-indexscan path (if different).
+ * cheapest-total inner-indexscan path (if any), one on the same with a
+ * Memoize node to cache its results, and one on the cheapest-startup
+ * inner-indexscan path (if different).
  *
  * We also consider mergejoins if mergejoin clauses are available.	We have
  * two ways to generate the inner path for a mergejoin: sort the cheapest
@@ -386,6 +392,7 @@ match_unsorted_outer(PlannerInfo *root,
 	Path	   *matpath = NULL;
 	Path	   *index_cheapest_startup = NULL;
 	Path	   *index_cheapest_total = NULL;
+	Path	   *memo_path = NULL;
 	ListCell   *l;
 
 	/*
@@ -462,6 +469,14 @@ match_unsorted_outer(PlannerInfo *root,
 									 &index_cheapest_startup,
 									 &index_cheapest_total);
 		}
+
+		/*
+		 * Consider caching the results of the cheapest innerjoin indexpath,
+		 * in case the outer rel presents the same join keys repeatedly.
+		 */
+		if (index_cheapest_total != NULL)
+			memo_path = get_memoize_path(root, innerrel, outerrel,
+										 index_cheapest_total);
 	}
 
 	foreach(l, outerrel->pathlist)
@@ -545,6 +560,16 @@ match_unsorted_outer(PlannerInfo *root,
 											  index_cheapest_total,
 											  restrictlist,
 											  merge_pathkeys));
+			if (memo_path != NULL)
+				add_path(joinrel, (Path *)
+						 create_nestloop_path(root,
+											  joinrel,
+											  jointype,
+											  sjinfo,
+											  outerpath,
+											  memo_path,
+											  restrictlist,
+											  merge_pathkeys));
 			if (index_cheapest_startup != NULL &&
 				index_cheapest_startup != index_cheapest_total)
 				add_path(joinrel, (Path *)
@@ -958,6 +983,112 @@ best_appendrel_indexscan(PlannerInfo *root, RelOptInfo *rel,
 	return (Path *) create_append_path(rel, append_paths);
 }
 
+/*
+ * get_memoize_path
+ *	  Build a MemoizePath to cache the results of the given innerjoin
+ *	  indexpath for each distinct value of the outer Vars it uses.
+ *
+ * Returns NULL if memoization isn't possible or isn't expected to produce
+ * any cache hits.  We only handle plain indexpaths: their join clauses
+ * tell us exactly which outer Vars the scan depends on.
+ *
+ * Two outer values that share a cache entry must select the same inner rows,
+ * so each join clause must be a hashable equality comparing a bare outer Var
+ * with the inner side, and the cache compares that Var's values using the
+ * same-type equality operator from the clause's own hash opfamily.  Values
+ * that are merely equal under the type's default "=" could still select
+ * different rows: for instance, if the clause is "inner.txt = outer.num::text",
+ * 1.0 and 1.00 are equal numerics but produce different strings.
+ */
+static Path *
+get_memoize_path(PlannerInfo *root, RelOptInfo *innerrel,
+				 RelOptInfo *outerrel, Path *inner_path)
+{
+	IndexPath  *ipath = (IndexPath *) inner_path;
+	List	   *param_exprs = NIL;
+	List	   *hash_operators = NIL;
+	ListCell   *l;
+	MemoizePath *mpath;
+
+	if (!enable_memoize)
+		return NULL;
+	if (!IsA(inner_path, IndexPath) || !ipath->isjoininner)
+		return NULL;
+	/* no point unless the inner side is going to be rescanned */
+	if (outerrel->rows < 2.0)
+		return NULL;
+
+	foreach(l, ipath->indexclauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(l);
+		OpExpr	   *clause = (OpExpr *) rinfo->clause;
+		Node	   *outerarg;
+		Var		   *var;
+		Oid			lefteq;
+		Oid			righteq;
+		Oid			eqop;
+		ListCell   *lp;
+		ListCell   *lo;
+
+		/* restriction clauses of the inner rel don't matter */
+		if (!bms_overlap(rinfo->clause_relids, outerrel->relids))
+			continue;
+
+		if (!is_opclause(clause) || list_length(clause->args) != 2 ||
+			!op_hashjoinable(clause->opno))
+			return NULL;
+
+		if (bms_is_subset(rinfo->left_relids, outerrel->relids) &&
+			!bms_overlap(rinfo->right_relids, outerrel->relids))
+			outerarg = (Node *) linitial(clause->args);
+		else if (bms_is_subset(rinfo->right_relids, outerrel->relids) &&
+				 !bms_overlap(rinfo->left_relids, outerrel->relids))
+			outerarg = (Node *) lsecond(clause->args);
+		else
+			return NULL;
+
+		/* nestloop params can only be made from plain Vars */
+		if (!IsA(outerarg, Var))
+			return NULL;
+		var = (Var *) outerarg;
+
+		if (!get_compatible_hash_operators(clause->opno, &lefteq, &righteq))
+			return NULL;
+		eqop = (outerarg == linitial(clause->args)) ? lefteq : righteq;
+
+		/*
+		 * If the Var is already a key, it had better be compared the same way
+		 * as before; otherwise give up rather than guess which equality
+		 * governs.
+		 */
+		forboth(lp, param_exprs, lo, hash_operators)
+		{
+			if (equal(lfirst(lp), var))
+			{
+				if (lfirst_oid(lo) != eqop)
+					return NULL;
+				break;
+			}
+		}
+		if (lp != NULL)
+			continue;
+
+		param_exprs = lappend(param_exprs, var);
+		hash_operators = lappend_oid(hash_operators, eqop);
+	}
+
+	if (param_exprs == NIL)
+		return NULL;
+
+	mpath = create_memoize_path(root, innerrel, inner_path,
+								param_exprs, hash_operators,
+								outerrel->rows);
+	if (mpath->hit_ratio <= 0.0)
+		return NULL;
+
+	return (Path *) mpath;
+}
+
 /*
  * select_mergejoin_clauses
  *	  Select mergejoin clauses that are usable for a particular join.
@@ -14,9 +14,31 @@
  */
 #include "postgres.h"
 
+#include "access/nbtree.h"
+#include "catalog/pg_am.h"
+#include "commands/defrem.h"
+#include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/joininfo.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
+#include "optimizer/plancat.h"
+#include "optimizer/predtest.h"
+#include "optimizer/prep.h"
+#include "parser/parsetree.h"
+#include "utils/lsyscache.h"
+
+
+/*
+ * One inheritance member rel considered by try_partitionwise_join, with its
+ * CHECK constraints on the join key columns.
+ */
+typedef struct PartitionwiseMember
+{
+	RelOptInfo *rel;			/* the member rel */
+	AppendRelInfo *appinfo;		/* its translation from the parent rel */
+	List	   *keyquals;		/* key constraints, in terms of parent vars */
+} PartitionwiseMember;
 
 
 static void make_rels_by_clause_joins(PlannerInfo *root,
@@ -30,6 +52,13 @@ static bool has_legal_joinclause(PlannerInfo *root, RelOptInfo *rel);
 static bool is_dummy_rel(RelOptInfo *rel);
 static void mark_dummy_rel(RelOptInfo *rel);
 static bool restriction_is_constant_false(List *restrictlist);
+static void try_partitionwise_join(PlannerInfo *root, RelOptInfo *joinrel,
+					   RelOptInfo *rel1, RelOptInfo *rel2,
+					   SpecialJoinInfo *sjinfo, List *restrictlist);
+static bool is_inheritance_appendrel(PlannerInfo *root, RelOptInfo *rel);
+static bool is_default_equality_op(Oid opno, Oid datatype);
+static List *get_partitionwise_members(PlannerInfo *root, RelOptInfo *rel,
+						  List *keys, List *parentkeys);
 
 
 /*
@@ -623,6 +652,9 @@ make_join_rel(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
 			add_paths_to_joinrel(root, joinrel, rel2, rel1,
 								 JOIN_INNER, sjinfo,
 								 restrictlist);
+			if (enable_partitionwise_join)
+				try_partitionwise_join(root, joinrel, rel1, rel2,
+									   sjinfo, restrictlist);
 			break;
 		case JOIN_LEFT:
 			if (is_dummy_rel(rel1))
@@ -977,3 +1009,267 @@ restriction_is_constant_false(List *restrictlist)
 	}
 	return false;
 }
+
+
+/*
+ * try_partitionwise_join
+ *	  Consider joining two inheritance trees child-by-child.
+ *
+ * When rel1 and rel2 are both inheritance appendrels joined on equality of a
+ * column of each, a pair of member rels whose CHECK constraints on those
+ * columns contradict each other cannot produce any join rows.  If excluding
+ * such pairs leaves a number of pairs that is only linear in the number of
+ * members, as it does for two trees partitioned on the same key ranges, we
+ * can join each surviving pair separately and Append the results, instead of
+ * joining the two complete Appends.  Each member join is much smaller, so it
+ * is much more likely to fit in work_mem.  The Append is offered to add_path
+ * as just another path for the joinrel, so it is used only if cheaper.
+ *
+ * Only plain inner joins are handled: an outer join would have to null-extend
+ * the rows of a member rel whose partners were all excluded.
+ */
+static void
+try_partitionwise_join(PlannerInfo *root, RelOptInfo *joinrel,
+					   RelOptInfo *rel1, RelOptInfo *rel2,
+					   SpecialJoinInfo *sjinfo, List *restrictlist)
+{
+	List	   *keys1 = NIL;
+	List	   *keys2 = NIL;
+	List	   *members1;
+	List	   *members2;
+	List	   *pairs = NIL;
+	List	   *subpaths = NIL;
+	int			maxpairs;
+	ListCell   *lc;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	if (!is_inheritance_appendrel(root, rel1) ||
+		!is_inheritance_appendrel(root, rel2))
+		return;
+
+	/* Row marks would have to be taken through the member joins too */
+	if (root->rowMarks != NIL)
+		return;
+
+	/*
+	 * The member joins' tlists are translated from the joinrel's, which is
+	 * only guaranteed to work for plain Vars.
+	 */
+	foreach(lc, joinrel->reltargetlist)
+	{
+		if (!IsA(lfirst(lc), Var))
+			return;
+	}
+
+	/*
+	 * Collect the join clauses that equate a column of rel1 to a column of
+	 * rel2.  We insist on the datatype's default btree equality, since we are
+	 * going to reason about both columns using the same CHECK constraints.
+	 */
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		OpExpr	   *opexpr;
+		Var		   *leftvar;
+		Var		   *rightvar;
+
+		if (!rinfo->can_join || rinfo->mergeopfamilies == NIL)
+			continue;
+		opexpr = (OpExpr *) rinfo->clause;
+		leftvar = (Var *) get_leftop((Expr *) opexpr);
+		rightvar = (Var *) get_rightop((Expr *) opexpr);
+		if (!IsA(leftvar, Var) || !IsA(rightvar, Var) ||
+			leftvar->varlevelsup != 0 || rightvar->varlevelsup != 0 ||
+			leftvar->varattno <= 0 || rightvar->varattno <= 0)
+			continue;
+		if (leftvar->vartype != rightvar->vartype ||
+			!is_default_equality_op(opexpr->opno, leftvar->vartype))
+			continue;
+
+		if (leftvar->varno == rel1->relid && rightvar->varno == rel2->relid)
+		{
+			keys1 = lappend(keys1, leftvar);
+			keys2 = lappend(keys2, rightvar);
+		}
+		else if (leftvar->varno == rel2->relid &&
+				 rightvar->varno == rel1->relid)
+		{
+			keys1 = lappend(keys1, rightvar);
+			keys2 = lappend(keys2, leftvar);
+		}
+	}
+	if (keys1 == NIL)
+		return;
+
+	/*
+	 * Fetch each member's constraints on the key columns.  Both sides are
+	 * expressed in terms of rel1's key Vars, so that they can be compared.
+	 */
+	members1 = get_partitionwise_members(root, rel1, keys1, keys1);
+	members2 = get_partitionwise_members(root, rel2, keys2, keys1);
+	if (members1 == NIL || members2 == NIL)
+		return;
+
+	/*
+	 * Pair up the members.  Rows of a pair that survive the join have
+	 * non-null keys, so each side's key constraints are known true for them,
+	 * and if either side's constraints refute the other's the pair can be
+	 * skipped.  Members with no usable constraints, such as the parent table
+	 * itself, pair with everything; that is fine so long as the total stays
+	 * linear.
+	 */
+	maxpairs = 2 * (list_length(members1) + list_length(members2));
+	foreach(lc1, members1)
+	{
+		PartitionwiseMember *m1 = (PartitionwiseMember *) lfirst(lc1);
+
+		foreach(lc2, members2)
+		{
+			PartitionwiseMember *m2 = (PartitionwiseMember *) lfirst(lc2);
+
+			if (m1->keyquals != NIL && m2->keyquals != NIL &&
+				(predicate_refuted_by(m2->keyquals, m1->keyquals) ||
+				 predicate_refuted_by(m1->keyquals, m2->keyquals)))
+				continue;
+			pairs = lappend(pairs, list_make2(m1, m2));
+			if (list_length(pairs) > maxpairs)
+				return;
+		}
+	}
+
+	/*
+	 * Now build a joinrel for each pair, and plan it just as make_join_rel
+	 * would.
+	 */
+	foreach(lc, pairs)
+	{
+		PartitionwiseMember *m1 = (PartitionwiseMember *) linitial(lfirst(lc));
+		PartitionwiseMember *m2 = (PartitionwiseMember *) lsecond(lfirst(lc));
+		SpecialJoinInfo *child_sjinfo;
+		List	   *child_restrictlist;
+		RelOptInfo *child_joinrel;
+
+		child_sjinfo = makeNode(SpecialJoinInfo);
+		memcpy(child_sjinfo, sjinfo, sizeof(SpecialJoinInfo));
+		child_sjinfo->min_lefthand = m1->rel->relids;
+		child_sjinfo->min_righthand = m2->rel->relids;
+		child_sjinfo->syn_lefthand = m1->rel->relids;
+		child_sjinfo->syn_righthand = m2->rel->relids;
+
+		child_restrictlist = (List *)
+			adjust_appendrel_attrs((Node *) restrictlist, m1->appinfo);
+		child_restrictlist = (List *)
+			adjust_appendrel_attrs((Node *) child_restrictlist, m2->appinfo);
+
+		child_joinrel = build_child_join_rel(root, joinrel,
+											 m1->rel, m2->rel,
+											 m1->appinfo, m2->appinfo,
+											 child_sjinfo,
+											 child_restrictlist);
+
+		add_paths_to_joinrel(root, child_joinrel, m1->rel, m2->rel,
+							 JOIN_INNER, child_sjinfo,
+							 child_restrictlist);
+		add_paths_to_joinrel(root, child_joinrel, m2->rel, m1->rel,
+							 JOIN_INNER, child_sjinfo,
+							 child_restrictlist);
+		set_cheapest(child_joinrel);
+
+		subpaths = lappend(subpaths, child_joinrel->cheapest_total_path);
+	}
+
+	add_path(joinrel, (Path *) create_append_path(joinrel, subpaths));
+}
+
+/*
+ * is_inheritance_appendrel
+ *		Is rel an inheritance tree that is planned as an Append of its
+ *		members?
+ */
+static bool
+is_inheritance_appendrel(PlannerInfo *root, RelOptInfo *rel)
+{
+	if (rel->reloptkind != RELOPT_BASEREL ||
+		rel->rtekind != RTE_RELATION ||
+		!planner_rt_fetch(rel->relid, root)->inh)
+		return false;
+	return (rel->cheapest_total_path != NULL &&
+			IsA(rel->cheapest_total_path, AppendPath));
+}
+
+/*
+ * is_default_equality_op
+ *		Is opno the equality operator of datatype's default btree opclass?
+ */
+static bool
+is_default_equality_op(Oid opno, Oid datatype)
+{
+	Oid			opclass;
+	Oid			opfamily;
+
+	opclass = GetDefaultOpClass(datatype, BTREE_AM_OID);
+	if (!OidIsValid(opclass))
+		return false;
+	opfamily = get_opclass_family(opclass);
+	return get_opfamily_member(opfamily, datatype, datatype,
+							   BTEqualStrategyNumber) == opno;
+}
+
+/*
+ * get_partitionwise_members
+ *		Build a PartitionwiseMember for each live member of appendrel rel.
+ *
+ * keys are the join key Vars of rel; parentkeys are the corresponding Vars
+ * in terms of which the constraints are to be expressed.  Members that have
+ * been excluded can't produce any inner-join rows and are omitted.
+ */
+static List *
+get_partitionwise_members(PlannerInfo *root, RelOptInfo *rel,
+						  List *keys, List *parentkeys)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+		RelOptInfo *childrel;
+		PartitionwiseMember *member;
+		ListCell   *lck;
+		ListCell   *lcp;
+
+		if (appinfo->parent_relid != rel->relid)
+			continue;
+
+		childrel = find_base_rel(root, appinfo->child_relid);
+		if (is_dummy_rel(childrel))
+			continue;
+
+		member = (PartitionwiseMember *) palloc(sizeof(PartitionwiseMember));
+		member->rel = childrel;
+		member->appinfo = appinfo;
+		member->keyquals = NIL;
+
+		forboth(lck, keys, lcp, parentkeys)
+		{
+			Var		   *childkey;
+			bool		key_notnull;
+
+			childkey = (Var *) adjust_appendrel_attrs((Node *) lfirst(lck),
+													  appinfo);
+			if (!IsA(childkey, Var))
+				continue;
+			member->keyquals =
+				list_concat(member->keyquals,
+							get_relation_key_constraints(root, childrel,
+														 childkey,
+														 (Expr *) lfirst(lcp),
+														 &key_notnull));
+		}
+
+		result = lappend(result, member);
+	}
+
+	return result;
+}
@@ -388,6 +388,29 @@ pathkeys_contained_in(List *keys1, List *keys2)
 	return false;
 }
 
+/*
+ * pathkeys_common_prefix
+ *	  Returns the number of leading pathkeys that keys1 and keys2 have in
+ *	  common.  If this is less than list_length(keys1), a path sorted by
+ *	  keys2 can still be brought into keys1 order by an incremental sort.
+ */
+int
+pathkeys_common_prefix(List *keys1, List *keys2)
+{
+	int			n = 0;
+	ListCell   *key1,
+			   *key2;
+
+	forboth(key1, keys1, key2, keys2)
+	{
+		/* canonical pathkeys can be compared by pointer, as above */
+		if (lfirst(key1) != lfirst(key2))
+			break;
+		n++;
+	}
+	return n;
+}
+
 /*
  * get_cheapest_path_for_pathkeys
  *	  Find the cheapest path (according to the specified criterion) that
@@ -24,6 +24,8 @@
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/plancat.h"
 #include "optimizer/planmain.h"
 #include "optimizer/predtest.h"
@@ -46,6 +48,7 @@ static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path);
+static Memoize *create_memoize_plan(PlannerInfo *root, MemoizePath *best_path);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path);
 static SeqScan *create_seqscan_plan(PlannerInfo *root, Path *best_path,
 					List *tlist, List *scan_clauses);
@@ -130,10 +133,19 @@ static MergeJoin *make_mergejoin(List *tlist,
 			   bool *mergenullsfirst,
 			   Plan *lefttree, Plan *righttree,
 			   JoinType jointype);
+static Plan *prepare_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree,
+						   List *pathkeys, int npresorted,
+						   int *p_numsortkeys, AttrNumber **p_sortColIdx,
+						   Oid **p_sortOperators, bool **p_nullsFirst,
+						   int *p_presortedCols);
+static IncrementalSort *make_incrementalsort(Plan *lefttree, Sort *sort,
+					 int presortedCols, Path *incr_path);
 static Sort *make_sort(PlannerInfo *root, Plan *lefttree, int numCols,
 		  AttrNumber *sortColIdx, Oid *sortOperators, bool *nullsFirst,
 		  double limit_tuples);
 static Material *make_material(Plan *lefttree);
+static Memoize *make_memoize(Plan *lefttree, List *param_exprs,
+			 List *hash_operators, long est_entries);
 
 
 /*
@@ -210,6 +222,10 @@ create_plan_recurse(PlannerInfo *root, Path *best_path)
 			plan = (Plan *) create_material_plan(root,
 												 (MaterialPath *) best_path);
 			break;
+		case T_Memoize:
+			plan = (Plan *) create_memoize_plan(root,
+												(MemoizePath *) best_path);
+			break;
 		case T_Unique:
 			plan = create_unique_plan(root,
 									  (UniquePath *) best_path);
@@ -667,6 +683,42 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path)
 	return plan;
 }
 
+/*
+ * create_memoize_plan
+ *	  Create a Memoize plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static Memoize *
+create_memoize_plan(PlannerInfo *root, MemoizePath *best_path)
+{
+	Memoize    *plan;
+	Plan	   *subplan;
+	List	   *param_exprs;
+
+	subplan = create_plan_recurse(root, best_path->subpath);
+
+	/* We don't want any excess columns in the cached tuples */
+	disuse_physical_tlist(subplan, best_path->subpath);
+
+	/*
+	 * The cache key Vars come from the enclosing nestloop's outer rel, so
+	 * they turn into the same nestloop Params the subplan uses for them.
+	 */
+	param_exprs = (List *)
+		replace_nestloop_params(root, (Node *) best_path->param_exprs);
+
+	plan = make_memoize(subplan, param_exprs, best_path->hash_operators,
+						(long) Min(best_path->est_entries, (double) LONG_MAX));
+
+	copy_path_costsize(&plan->plan, (Path *) best_path);
+	/* but the row count is per scan, as for the subplan */
+	plan->plan.plan_rows = subplan->plan_rows;
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -3106,23 +3158,150 @@ add_sort_column(AttrNumber colIdx, Oid sortOp, bool nulls_first,
  *	  'pathkeys' is the list of pathkeys by which the result is to be sorted
  *	  'limit_tuples' is the bound on the number of output tuples;
  *				-1 if no bound
+ */
+Sort *
+make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree, List *pathkeys,
+						double limit_tuples)
+{
+	int			numsortkeys;
+	AttrNumber *sortColIdx;
+	Oid		   *sortOperators;
+	bool	   *nullsFirst;
+
+	lefttree = prepare_sort_from_pathkeys(root, lefttree, pathkeys, 0,
+										  &numsortkeys, &sortColIdx,
+										  &sortOperators, &nullsFirst,
+										  NULL);
+
+	return make_sort(root, lefttree, numsortkeys,
+					 sortColIdx, sortOperators, nullsFirst, limit_tuples);
+}
+
+/*
+ * make_sort_from_presorted_pathkeys
+ *	  Create a plan to sort according to given pathkeys, when the input is
+ *	  known to be sorted by 'input_pathkeys'
  *
- * We must convert the pathkey information into arrays of sort key column
- * numbers and sort operator OIDs.
+ * If the input ordering matches a leading part of the wanted pathkeys, we
+ * consider an IncrementalSort that sorts each group of tuples sharing the
+ * presorted keys separately, and use it if cost_incremental_sort thinks
+ * it's cheaper than a full Sort.  When there's a LIMIT, the comparison is
+ * made at the fraction of the input the LIMIT is expected to need, since
+ * the incremental sort's main advantage is its low startup cost.
+ * Otherwise this is the same as make_sort_from_pathkeys.
+ */
+Plan *
+make_sort_from_presorted_pathkeys(PlannerInfo *root, Plan *lefttree,
+								  List *pathkeys, List *input_pathkeys,
+								  double limit_tuples)
+{
+	int			npresorted = 0;
+	int			numsortkeys;
+	int			presortedCols;
+	AttrNumber *sortColIdx;
+	Oid		   *sortOperators;
+	bool	   *nullsFirst;
+	Sort	   *sort;
+	Path		sort_path;		/* dummy for comparing costs */
+	Path		incr_path;
+
+	if (enable_incrementalsort)
+		npresorted = pathkeys_common_prefix(pathkeys, input_pathkeys);
+
+	lefttree = prepare_sort_from_pathkeys(root, lefttree, pathkeys,
+										  npresorted,
+										  &numsortkeys, &sortColIdx,
+										  &sortOperators, &nullsFirst,
+										  &presortedCols);
+
+	sort = make_sort(root, lefttree, numsortkeys,
+					 sortColIdx, sortOperators, nullsFirst, limit_tuples);
+
+	/* no useful presorted prefix, or nothing left to sort? */
+	if (presortedCols == 0 || presortedCols >= numsortkeys ||
+		npresorted >= list_length(pathkeys))
+		return (Plan *) sort;
+
+	sort_path.startup_cost = sort->plan.startup_cost;
+	sort_path.total_cost = sort->plan.total_cost;
+	cost_incremental_sort(&incr_path, root, pathkeys, npresorted,
+						  lefttree->startup_cost, lefttree->total_cost,
+						  lefttree->plan_rows, lefttree->plan_width,
+						  limit_tuples);
+
+	if (limit_tuples > 0 && limit_tuples < lefttree->plan_rows)
+	{
+		if (compare_fractional_path_costs(&incr_path, &sort_path,
+									limit_tuples / lefttree->plan_rows) >= 0)
+			return (Plan *) sort;
+	}
+	else if (incr_path.total_cost >= sort_path.total_cost)
+		return (Plan *) sort;
+
+	return (Plan *) make_incrementalsort(lefttree, sort, presortedCols,
+										 &incr_path);
+}
+
+/*
+ * make_incrementalsort --- turn a finished Sort into an IncrementalSort
+ *
+ * The sort columns are the same; we just need to know how many of them
+ * the input is already sorted by, and the cost of doing it incrementally.
+ */
+static IncrementalSort *
+make_incrementalsort(Plan *lefttree, Sort *sort, int presortedCols,
+					 Path *incr_path)
+{
+	IncrementalSort *node = makeNode(IncrementalSort);
+	Plan	   *plan = &node->sort.plan;
+
+	copy_plan_costsize(plan, lefttree); /* only care about copying size */
+	plan->startup_cost = incr_path->startup_cost;
+	plan->total_cost = incr_path->total_cost;
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->sort.numCols = sort->numCols;
+	node->sort.sortColIdx = sort->sortColIdx;
+	node->sort.sortOperators = sort->sortOperators;
+	node->sort.nullsFirst = sort->nullsFirst;
+	node->presortedCols = presortedCols;
+
+	return node;
+}
+
+/*
+ * prepare_sort_from_pathkeys
+ *	  Prepare to sort according to given pathkeys
+ *
+ * This is common code for make_sort_from_pathkeys and
+ * make_sort_from_presorted_pathkeys.  We must convert the pathkey
+ * information into arrays of sort key column numbers and sort operator
+ * OIDs, which are returned in *p_sortColIdx etc.  The result is the
+ * (possibly modified) input plan.
  *
  * If the pathkeys include expressions that aren't simple Vars, we will
  * usually need to add resjunk items to the input plan's targetlist to
  * compute these expressions (since the Sort node itself won't do it).
  * If the input plan type isn't one that can do projections, this means
  * adding a Result node just to do the projection.
+ *
+ * If p_presortedCols isn't NULL, it receives the number of sort columns
+ * generated by the first 'npresorted' pathkeys.  That's not necessarily
+ * the same as npresorted, because duplicate columns are dropped.
  */
-Sort *
-make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree, List *pathkeys,
-						double limit_tuples)
+static Plan *
+prepare_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree, List *pathkeys,
+						   int npresorted,
+						   int *p_numsortkeys, AttrNumber **p_sortColIdx,
+						   Oid **p_sortOperators, bool **p_nullsFirst,
+						   int *p_presortedCols)
 {
 	List	   *tlist = lefttree->targetlist;
 	ListCell   *i;
 	int			numsortkeys;
+	int			npathkeys = 0;
 	AttrNumber *sortColIdx;
 	Oid		   *sortOperators;
 	bool	   *nullsFirst;
@@ -3285,12 +3464,22 @@ make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree, List *pathkeys,
 									  pathkey->pk_nulls_first,
 									  numsortkeys,
 									  sortColIdx, sortOperators, nullsFirst);
+
+		if (++npathkeys == npresorted && p_presortedCols)
+			*p_presortedCols = numsortkeys;
 	}
 
 	Assert(numsortkeys > 0);
 
-	return make_sort(root, lefttree, numsortkeys,
-					 sortColIdx, sortOperators, nullsFirst, limit_tuples);
+	if (npresorted == 0 && p_presortedCols)
+		*p_presortedCols = 0;
+
+	*p_numsortkeys = numsortkeys;
+	*p_sortColIdx = sortColIdx;
+	*p_sortOperators = sortOperators;
+	*p_nullsFirst = nullsFirst;
+
+	return lefttree;
 }
 
 /*
@@ -3417,6 +3606,33 @@ make_material(Plan *lefttree)
 	return node;
 }
 
+static Memoize *
+make_memoize(Plan *lefttree, List *param_exprs, List *hash_operators,
+			 long est_entries)
+{
+	Memoize    *node = makeNode(Memoize);
+	Plan	   *plan = &node->plan;
+	int			numKeys = list_length(param_exprs);
+	ListCell   *lc;
+	int			i;
+
+	/* cost should be inserted by caller */
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+
+	node->numKeys = numKeys;
+	node->hashOperators = (Oid *) palloc(numKeys * sizeof(Oid));
+	i = 0;
+	foreach(lc, hash_operators)
+		node->hashOperators[i++] = lfirst_oid(lc);
+	node->param_exprs = param_exprs;
+	node->est_entries = est_entries;
+
+	return node;
+}
+
 /*
  * materialize_finished_plan: stick a Material node atop a completed plan
  *
@@ -3988,7 +4204,9 @@ is_projection_capable_plan(Plan *plan)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_Memoize:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
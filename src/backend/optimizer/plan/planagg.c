@@ -14,18 +14,26 @@
  */
 #include "postgres.h"
 
+#include <limits.h>
+
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_type.h"
+#include "commands/defrem.h"
+#include "executor/nodeAgg.h"
+#include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
+#include "optimizer/plancat.h"
 #include "optimizer/planmain.h"
 #include "optimizer/predtest.h"
+#include "optimizer/prep.h"
 #include "optimizer/subselect.h"
+#include "optimizer/tlist.h"
 #include "parser/parse_clause.h"
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
@@ -44,6 +52,19 @@ typedef struct
 	Param	   *param;			/* param for subplan's output */
 } MinMaxAggInfo;
 
+typedef struct
+{
+	Path	   *path;			/* member of the Append being grouped */
+	List	   *keyquals;		/* its constraints on the grouping key */
+	int			component;		/* union-find link, or -1 if unconstrained */
+} GroupingMember;
+
+typedef struct
+{
+	List	   *parent_tlist;	/* Vars of the Append's parent rel */
+	List	   *member_tlist;	/* corresponding exprs of one member rel */
+} translate_member_context;
+
 static bool find_minmax_aggs_walker(Node *node, List **context);
 static bool build_minmax_path(PlannerInfo *root, RelOptInfo *rel,
 				  MinMaxAggInfo *info);
@@ -53,6 +74,18 @@ static void make_agg_subplan(PlannerInfo *root, MinMaxAggInfo *info);
 static void attach_notnull_index_qual(MinMaxAggInfo *info, IndexScan *iplan);
 static Node *replace_aggs_with_params_mutator(Node *node, List **context);
 static Oid	fetch_agg_sort_op(Oid aggfnoid);
+static List *get_grouping_members(PlannerInfo *root, AppendPath *apath,
+					 Var *keyvar);
+static int	find_grouping_component(GroupingMember *members, int i);
+static List *get_member_key_constraints(PlannerInfo *root, RelOptInfo *rel,
+						   Var *keyvar, bool *key_notnull);
+static Var *find_equated_member_var(PlannerInfo *root, Var *keyvar,
+						Index relid);
+static Plan *make_grouping_member_plan(PlannerInfo *root, Path *path,
+						  RelOptInfo *parent, List *sub_tlist,
+						  Expr *filter);
+static Node *translate_member_vars_mutator(Node *node,
+							  translate_member_context *context);
 
 
 /*
@@ -783,3 +816,512 @@ fetch_agg_sort_op(Oid aggfnoid)
 
 	return aggsortop;
 }
+
+
+/*
+ * partitionwise_grouping_plan - check for doing GROUP BY below an Append
+ *
+ * If the input to grouping is an Append over the members of an inheritance
+ * tree (or over the member joins of a partition-wise join), and the members'
+ * CHECK constraints on some grouping column prove that no group can draw
+ * rows from two different members, we can group each member separately and
+ * Append the results.  Every Agg then sees only a fraction of the input, so
+ * a hashed Agg is far more likely to fit in work_mem, and sorts are smaller.
+ *
+ * Members that the constraints can't be shown to keep apart are grouped
+ * together.  Members without usable constraints at all, typically the
+ * inheritance parent itself, are scanned once for each group of members with
+ * a filter selecting the rows that belong to it, and once more for rows that
+ * belong nowhere else.  Such members are normally empty, so that costs next
+ * to nothing.
+ *
+ * We are passed the query tlist, the subplan tlist made by grouping_planner
+ * and the grouping-column information that goes with it.  If we succeed, we
+ * return a Plan that produces the complete grouped output, unordered;
+ * otherwise NULL.
+ */
+Plan *
+partitionwise_grouping_plan(PlannerInfo *root, Path *best_path,
+							List *tlist, List *sub_tlist,
+							AttrNumber *groupColIdx, Oid *groupOperators,
+							double dNumGroups, AggClauseCounts *agg_counts)
+{
+	Query	   *parse = root->parse;
+	int			numGroupCols = list_length(parse->groupClause);
+	AppendPath *apath;
+	RelOptInfo *parent;
+	List	   *members = NIL;
+	GroupingMember *marray = NULL;
+	int			nmembers = 0;
+	int			ncomponents = 0;
+	int		   *compindex;
+	List	  **compmembers;
+	List	  **compfilters;
+	List	   *unconstrained = NIL;
+	List	   *aggplans = NIL;
+	bool		can_hash;
+	bool		can_sort;
+	Size		hashentrysize;
+	ListCell   *lc;
+	int			i;
+	int			c;
+
+	if (!IsA(best_path, AppendPath))
+		return NULL;
+	apath = (AppendPath *) best_path;
+	parent = apath->path.parent;
+	if (parent == NULL || list_length(apath->subpaths) < 2)
+		return NULL;
+
+	/* The Append must be over inheritance members, or joins of them */
+	if (parent->reloptkind == RELOPT_BASEREL)
+	{
+		RangeTblEntry *rte = planner_rt_fetch(parent->relid, root);
+
+		if (rte->rtekind != RTE_RELATION || !rte->inh)
+			return NULL;
+	}
+	else if (parent->reloptkind != RELOPT_JOINREL)
+		return NULL;
+
+	/* Members' tlists are translated positionally from the parent's */
+	foreach(lc, parent->reltargetlist)
+	{
+		if (!IsA(lfirst(lc), Var))
+			return NULL;
+	}
+
+	/* Copying SubPlans into each member's Agg is not worth the trouble */
+	if (contain_subplans((Node *) tlist) ||
+		contain_subplans(parse->havingQual))
+		return NULL;
+
+	can_hash = (agg_counts->numOrderedAggs == 0 &&
+				grouping_is_hashable(parse->groupClause));
+	can_sort = grouping_is_sortable(parse->groupClause);
+	if (!can_hash && !can_sort)
+		return NULL;
+
+	/*
+	 * Look for a grouping column that splits the members into at least two
+	 * independent components.
+	 */
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *grpcl = (SortGroupClause *) lfirst(lc);
+		Var		   *keyvar = (Var *) get_sortgroupclause_expr(grpcl, tlist);
+		ListCell   *lc2;
+
+		if (!IsA(keyvar, Var) || keyvar->varlevelsup != 0 ||
+			!bms_is_member(keyvar->varno, parent->relids))
+			continue;
+
+		members = get_grouping_members(root, apath, keyvar);
+		nmembers = list_length(members);
+		marray = (GroupingMember *) palloc(nmembers * sizeof(GroupingMember));
+		i = 0;
+		foreach(lc2, members)
+			marray[i++] = *((GroupingMember *) lfirst(lc2));
+
+		/*
+		 * Link together every pair of constrained members whose constraints
+		 * can't be proven mutually exclusive.
+		 */
+		for (i = 0; i < nmembers; i++)
+		{
+			int			j;
+
+			if (marray[i].component < 0)
+				continue;
+			for (j = i + 1; j < nmembers; j++)
+			{
+				int			ci;
+				int			cj;
+
+				if (marray[j].component < 0)
+					continue;
+				ci = find_grouping_component(marray, i);
+				cj = find_grouping_component(marray, j);
+				if (ci == cj)
+					continue;
+				if (predicate_refuted_by(marray[j].keyquals, marray[i].keyquals) ||
+					predicate_refuted_by(marray[i].keyquals, marray[j].keyquals))
+					continue;
+				marray[Max(ci, cj)].component = Min(ci, cj);
+			}
+		}
+
+		ncomponents = 0;
+		for (i = 0; i < nmembers; i++)
+		{
+			if (marray[i].component >= 0 &&
+				find_grouping_component(marray, i) == i)
+				ncomponents++;
+		}
+		if (ncomponents >= 2)
+			break;
+	}
+	if (ncomponents < 2)
+		return NULL;
+
+	/*
+	 * Collect the members of each component, and build the filter that
+	 * selects the rows of an unconstrained member belonging to it: the OR of
+	 * its members' constraints.  Members of a partition-wise join often have
+	 * the same constraints, so leave out duplicates.
+	 */
+	compindex = (int *) palloc(nmembers * sizeof(int));
+	compmembers = (List **) palloc0(ncomponents * sizeof(List *));
+	compfilters = (List **) palloc0(ncomponents * sizeof(List *));
+	c = 0;
+	for (i = 0; i < nmembers; i++)
+	{
+		if (marray[i].component < 0)
+		{
+			unconstrained = lappend(unconstrained, &marray[i]);
+			continue;
+		}
+		if (find_grouping_component(marray, i) == i)
+			compindex[i] = c++;
+		else
+			compindex[i] = compindex[find_grouping_component(marray, i)];
+		compmembers[compindex[i]] = lappend(compmembers[compindex[i]],
+											&marray[i]);
+		compfilters[compindex[i]] =
+			list_append_unique(compfilters[compindex[i]],
+							   make_ands_explicit(marray[i].keyquals));
+	}
+
+	/* Estimate per-hash-entry space as choose_hashed_grouping does */
+	hashentrysize = MAXALIGN(parent->width) + MAXALIGN(sizeof(MinimalTupleData));
+	hashentrysize += agg_counts->transitionSpace;
+	hashentrysize += hash_agg_entry_size(agg_counts->numAggs);
+
+	/*
+	 * Build an Agg over an Append for each component, plus one for the rows
+	 * of unconstrained members that fall in no component.
+	 */
+	for (c = 0; c <= ncomponents; c++)
+	{
+		List	   *subplans = NIL;
+		List	   *notinany = NIL;
+		Expr	   *filter;
+		double		rows = 0;
+		double		numGroups;
+		bool		use_hashed;
+		Plan	   *plan;
+		int			k;
+
+		if (c < ncomponents)
+		{
+			foreach(lc, compmembers[c])
+			{
+				GroupingMember *m = (GroupingMember *) lfirst(lc);
+
+				subplans = lappend(subplans,
+								   make_grouping_member_plan(root, m->path,
+															 parent,
+															 sub_tlist,
+															 NULL));
+				rows += m->path->parent->rows;
+			}
+			if (list_length(compfilters[c]) == 1)
+				filter = (Expr *) linitial(compfilters[c]);
+			else
+				filter = make_orclause(compfilters[c]);
+		}
+		else
+		{
+			if (unconstrained == NIL)
+				break;
+			for (k = 0; k < ncomponents; k++)
+			{
+				BooleanTest *btest = makeNode(BooleanTest);
+
+				if (list_length(compfilters[k]) == 1)
+					btest->arg = (Expr *) linitial(compfilters[k]);
+				else
+					btest->arg = make_orclause(compfilters[k]);
+				btest->booltesttype = IS_NOT_TRUE;
+				notinany = lappend(notinany, btest);
+			}
+			filter = make_ands_explicit(notinany);
+		}
+
+		foreach(lc, unconstrained)
+		{
+			GroupingMember *m = (GroupingMember *) lfirst(lc);
+
+			subplans = lappend(subplans,
+							   make_grouping_member_plan(root, m->path,
+														 parent,
+														 sub_tlist,
+														 filter));
+		}
+
+		plan = (Plan *) make_append(subplans, (List *) copyObject(sub_tlist));
+
+		if (parent->rows > 0)
+			numGroups = clamp_row_est(dNumGroups * rows / parent->rows);
+		else
+			numGroups = 1;
+
+		use_hashed = can_hash &&
+			(!can_sort ||
+			 (enable_hashagg && hashentrysize * numGroups <= work_mem * 1024L));
+		if (!use_hashed)
+			plan = (Plan *) make_sort_from_groupcols(root,
+													 parse->groupClause,
+													 groupColIdx,
+													 plan);
+
+		plan = (Plan *) make_agg(root,
+								 (List *) copyObject(tlist),
+								 (List *) copyObject(parse->havingQual),
+								 use_hashed ? AGG_HASHED : AGG_SORTED,
+								 numGroupCols,
+								 groupColIdx,
+								 groupOperators,
+								 (long) Min(numGroups, (double) LONG_MAX),
+								 agg_counts->numAggs,
+								 plan);
+		aggplans = lappend(aggplans, plan);
+	}
+
+	return (Plan *) make_append(aggplans, (List *) copyObject(tlist));
+}
+
+/*
+ * get_grouping_members
+ *		Build a GroupingMember for each member of the Append, with its
+ *		constraints on keyvar.
+ *
+ * A member counts as constrained only if its constraints are known to be
+ * true, not merely "not false", for all of its rows; that requires the key
+ * to be non-null.  Each constrained member starts out as a component of its
+ * own.
+ */
+static List *
+get_grouping_members(PlannerInfo *root, AppendPath *apath, Var *keyvar)
+{
+	List	   *result = NIL;
+	int			i = 0;
+	ListCell   *lc;
+
+	foreach(lc, apath->subpaths)
+	{
+		Path	   *path = (Path *) lfirst(lc);
+		GroupingMember *member;
+		bool		key_notnull;
+
+		member = (GroupingMember *) palloc(sizeof(GroupingMember));
+		member->path = path;
+		member->keyquals = get_member_key_constraints(root, path->parent,
+													  keyvar, &key_notnull);
+		if (member->keyquals != NIL && key_notnull)
+			member->component = i;
+		else
+			member->component = -1;
+		result = lappend(result, member);
+		i++;
+	}
+
+	return result;
+}
+
+/*
+ * find_grouping_component
+ *		Return the index of the member representing member i's component.
+ */
+static int
+find_grouping_component(GroupingMember *members, int i)
+{
+	while (members[i].component != i)
+		i = members[i].component;
+	return i;
+}
+
+/*
+ * get_member_key_constraints
+ *		Collect the constraints on keyvar of one member of the Append.
+ *
+ * rel is either an inheritance member rel or a join of such rels; in the
+ * latter case each of its component rels may contribute constraints, on
+ * keyvar itself or on a column known equal to it.  The constraints are
+ * expressed in terms of keyvar, without duplicates, since both sides of a
+ * member join usually have the same ones.  *key_notnull is set true if the
+ * key is known non-null in all of the member's rows; an equality join clause
+ * evaluated within the member guarantees that as well.
+ */
+static List *
+get_member_key_constraints(PlannerInfo *root, RelOptInfo *rel,
+						   Var *keyvar, bool *key_notnull)
+{
+	List	   *result = NIL;
+	Relids		tmprelids;
+	int			relid;
+
+	*key_notnull = false;
+
+	tmprelids = bms_copy(rel->relids);
+	while ((relid = bms_first_member(tmprelids)) >= 0)
+	{
+		RelOptInfo *childrel = find_base_rel(root, relid);
+		AppendRelInfo *appinfo = NULL;
+		Var		   *parentvar;
+		Node	   *childvar;
+		bool		notnull;
+		ListCell   *lc;
+
+		foreach(lc, root->append_rel_list)
+		{
+			appinfo = (AppendRelInfo *) lfirst(lc);
+			if (appinfo->child_relid == relid)
+				break;
+			appinfo = NULL;
+		}
+		if (appinfo == NULL)
+			continue;
+
+		if (appinfo->parent_relid == keyvar->varno)
+			parentvar = keyvar;
+		else
+		{
+			parentvar = find_equated_member_var(root, keyvar,
+												appinfo->parent_relid);
+			if (parentvar == NULL)
+				continue;
+			*key_notnull = true;
+		}
+
+		childvar = adjust_appendrel_attrs((Node *) parentvar, appinfo);
+		if (!IsA(childvar, Var))
+			continue;
+		result = list_concat_unique(result,
+									get_relation_key_constraints(root, childrel,
+															(Var *) childvar,
+															(Expr *) keyvar,
+																 &notnull));
+		if (notnull)
+			*key_notnull = true;
+	}
+	bms_free(tmprelids);
+
+	return result;
+}
+
+/*
+ * find_equated_member_var
+ *		Find a column of rel relid that an EquivalenceClass equates to
+ *		keyvar using the default btree equality of keyvar's type.
+ */
+static Var *
+find_equated_member_var(PlannerInfo *root, Var *keyvar, Index relid)
+{
+	Oid			opclass;
+	Oid			opfamily;
+	ListCell   *lc1;
+
+	opclass = GetDefaultOpClass(keyvar->vartype, BTREE_AM_OID);
+	if (!OidIsValid(opclass))
+		return NULL;
+	opfamily = get_opclass_family(opclass);
+
+	foreach(lc1, root->eq_classes)
+	{
+		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc1);
+		Var		   *found = NULL;
+		bool		haskey = false;
+		ListCell   *lc2;
+
+		if (ec->ec_has_volatile || ec->ec_below_outer_join ||
+			!list_member_oid(ec->ec_opfamilies, opfamily))
+			continue;
+
+		foreach(lc2, ec->ec_members)
+		{
+			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc2);
+			Var		   *var = (Var *) em->em_expr;
+
+			if (em->em_is_child || !IsA(var, Var))
+				continue;
+			if (equal(var, keyvar))
+				haskey = true;
+			else if (var->varno == relid && var->varlevelsup == 0 &&
+					 var->vartype == keyvar->vartype)
+				found = var;
+		}
+		if (haskey && found)
+			return found;
+	}
+	return NULL;
+}
+
+/*
+ * make_grouping_member_plan
+ *		Create the plan for one member of a partition-wise grouping Append.
+ *
+ * The plan is made to emit sub_tlist, translated to the member's Vars, so
+ * that the Agg above the Append finds its grouping columns where it expects.
+ * If filter isn't NULL, only rows satisfying it are returned.
+ */
+static Plan *
+make_grouping_member_plan(PlannerInfo *root, Path *path, RelOptInfo *parent,
+						  List *sub_tlist, Expr *filter)
+{
+	translate_member_context context;
+	List	   *member_tlist;
+	Plan	   *plan;
+
+	context.parent_tlist = parent->reltargetlist;
+	context.member_tlist = path->parent->reltargetlist;
+	member_tlist = (List *)
+		translate_member_vars_mutator((Node *) sub_tlist, &context);
+
+	plan = create_plan(root, path);
+	if (filter != NULL || !is_projection_capable_plan(plan))
+	{
+		plan = (Plan *) make_result(root, member_tlist, NULL, plan);
+		if (filter != NULL)
+		{
+			QualCost	qual_cost;
+
+			plan->qual = list_make1(translate_member_vars_mutator((Node *) filter,
+																  &context));
+			cost_qual_eval(&qual_cost, plan->qual, root);
+			plan->startup_cost += qual_cost.startup;
+			plan->total_cost += qual_cost.startup +
+				qual_cost.per_tuple * plan->plan_rows;
+		}
+	}
+	else
+		plan->targetlist = member_tlist;
+
+	return plan;
+}
+
+/*
+ * translate_member_vars_mutator
+ *		Replace Vars of the Append's parent rel by the matching expressions
+ *		of one member rel, relying on their tlists lining up.
+ */
+static Node *
+translate_member_vars_mutator(Node *node, translate_member_context *context)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var) && ((Var *) node)->varlevelsup == 0)
+	{
+		ListCell   *lp;
+		ListCell   *lm;
+
+		forboth(lp, context->parent_tlist, lm, context->member_tlist)
+		{
+			if (equal(node, lfirst(lp)))
+				return (Node *) copyObject(lfirst(lm));
+		}
+		elog(ERROR, "variable not found in appendrel member's targetlist");
+	}
+	return expression_tree_mutator(node, translate_member_vars_mutator,
+								   (void *) context);
+}
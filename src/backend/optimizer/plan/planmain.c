@@ -419,6 +419,57 @@ query_planner(PlannerInfo *root, List *tlist,
 		}
 	}
 
+	/*
+	 * If there's no suitable presorted path, see whether a path sorted by
+	 * just a leading part of the requested pathkeys would win once an
+	 * incremental sort is put on top of it.  That's only safe when the
+	 * query_pathkeys are the ORDER BY ordering and nothing else stands
+	 * between the scan/join result and the final sort, since only that sort
+	 * step in grouping_planner knows how to finish off such a path.
+	 */
+	if (sortedpath == NULL && enable_incrementalsort &&
+		root->query_pathkeys != NIL &&
+		!pathkeys_contained_in(root->query_pathkeys,
+							   cheapestpath->pathkeys) &&
+		parse->groupClause == NIL && !parse->hasAggs &&
+		!root->hasHavingQual && !parse->hasWindowFuncs &&
+		parse->distinctClause == NIL)
+	{
+		Path		sort_path;	/* dummy for result of cost_sort */
+		Path		incr_path;	/* dummy for result of cost_incremental_sort */
+
+		cost_sort(&sort_path, root, root->query_pathkeys,
+				  cheapestpath->total_cost,
+				  final_rel->rows, final_rel->width,
+				  limit_tuples);
+
+		foreach(lc, final_rel->pathlist)
+		{
+			Path	   *path = (Path *) lfirst(lc);
+			int			npresorted;
+
+			if (path == cheapestpath)
+				continue;
+			npresorted = pathkeys_common_prefix(root->query_pathkeys,
+												path->pathkeys);
+			if (npresorted == 0 ||
+				npresorted >= list_length(root->query_pathkeys))
+				continue;
+
+			cost_incremental_sort(&incr_path, root, root->query_pathkeys,
+								  npresorted,
+								  path->startup_cost, path->total_cost,
+								  final_rel->rows, final_rel->width,
+								  limit_tuples);
+			if (compare_fractional_path_costs(&incr_path, &sort_path,
+											  tuple_fraction) < 0)
+			{
+				sort_path = incr_path;
+				sortedpath = path;
+			}
+		}
+	}
+
 	*cheapest_path = cheapestpath;
 	*sorted_path = sortedpath;
 }
@@ -1181,11 +1181,29 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		result_plan = optimize_minmax_aggregates(root,
 												 tlist,
 												 best_path);
+
+		/*
+		 * Likewise, see if the grouping can be done separately for each
+		 * member of an inheritance tree.  That requires reading all the
+		 * input rows, so consider the cheapest-total path.
+		 */
+		if (result_plan == NULL && parse->groupClause &&
+			enable_partitionwise_aggregate)
+			result_plan = partitionwise_grouping_plan(root,
+													  cheapest_path,
+													  tlist,
+													  sub_tlist,
+													  groupColIdx,
+									extract_grouping_ops(parse->groupClause),
+													  dNumGroups,
+													  &agg_counts);
+
 		if (result_plan != NULL)
 		{
 			/*
-			 * optimize_minmax_aggregates generated the full plan, with the
-			 * right tlist, and it has no sort order.
+			 * optimize_minmax_aggregates or partitionwise_grouping_plan
+			 * generated the full plan, with the right tlist, and it has no
+			 * sort order.
 			 */
 			current_pathkeys = NIL;
 		}
@@ -1620,6 +1638,8 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 
 			if (!pathkeys_contained_in(needed_pathkeys, current_pathkeys))
 			{
+				List	   *input_pathkeys = current_pathkeys;
+
 				if (list_length(root->distinct_pathkeys) >=
 					list_length(root->sort_pathkeys))
 					current_pathkeys = root->distinct_pathkeys;
@@ -1631,10 +1651,11 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 												 current_pathkeys));
 				}
 
-				result_plan = (Plan *) make_sort_from_pathkeys(root,
-															   result_plan,
+				result_plan = make_sort_from_presorted_pathkeys(root,
+																result_plan,
 															current_pathkeys,
-															   -1.0);
+															input_pathkeys,
+																-1.0);
 			}
 
 			result_plan = (Plan *) make_unique(result_plan,
@@ -1652,10 +1673,11 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 	{
 		if (!pathkeys_contained_in(root->sort_pathkeys, current_pathkeys))
 		{
-			result_plan = (Plan *) make_sort_from_pathkeys(root,
-														   result_plan,
+			result_plan = make_sort_from_presorted_pathkeys(root,
+															result_plan,
 														 root->sort_pathkeys,
-														   limit_tuples);
+															current_pathkeys,
+															limit_tuples);
 			current_pathkeys = root->sort_pathkeys;
 		}
 	}
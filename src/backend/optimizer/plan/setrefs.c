@@ -404,7 +404,9 @@ set_plan_refs(PlannerGlobal *glob, Plan *plan, int rtoffset)
 
 		case T_Hash:
 		case T_Material:
+		case T_Memoize:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 
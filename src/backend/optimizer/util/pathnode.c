@@ -718,6 +718,37 @@ create_material_path(RelOptInfo *rel, Path *subpath)
 	return pathnode;
 }
 
+/*
+ * create_memoize_path
+ *	  Creates a path corresponding to a Memoize plan, returning the
+ *	  pathnode.
+ *
+ * 'subpath' is a nestloop inner path depending on the outer-relation
+ * Vars listed in 'param_exprs', whose hashable equality operators are in
+ * 'hash_operators'.  'calls' is the number of times we expect the nestloop
+ * to rescan it.
+ */
+MemoizePath *
+create_memoize_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+					List *param_exprs, List *hash_operators, double calls)
+{
+	MemoizePath *pathnode = makeNode(MemoizePath);
+
+	pathnode->path.pathtype = T_Memoize;
+	pathnode->path.parent = rel;
+
+	pathnode->path.pathkeys = subpath->pathkeys;
+
+	pathnode->subpath = subpath;
+	pathnode->param_exprs = param_exprs;
+	pathnode->hash_operators = hash_operators;
+	pathnode->calls = calls;
+
+	cost_memoize(pathnode, root);
+
+	return pathnode;
+}
+
 /*
  * create_unique_path
  *	  Creates a path representing elimination of distinct rows from the
@@ -557,6 +557,96 @@ get_relation_constraints(PlannerInfo *root,
 }
 
 
+/*
+ * get_relation_key_constraints
+ *
+ * Retrieve those CHECK constraints of an inheritance member rel that bound
+ * the single column "keyvar", for use by partition-wise planning.  In the
+ * returned clauses keyvar is replaced by "keyexpr", so that constraints of
+ * different member rels can be compared to each other with predtest.c.
+ *
+ * Only clauses of the form "keyvar op Const" are kept, where op is a btree
+ * comparison operator and the Const is not null.  Such a clause yields TRUE,
+ * not merely "not FALSE", for any row whose key is not null; so the result
+ * is a valid premise for predicate_refuted_by() as long as the caller knows
+ * the key to be non-null.  *key_notnull is set true if the constraints
+ * themselves guarantee that (via attnotnull or a CHECK constraint).
+ */
+List *
+get_relation_key_constraints(PlannerInfo *root, RelOptInfo *rel,
+							 Var *keyvar, Expr *keyexpr, bool *key_notnull)
+{
+	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+	List	   *result = NIL;
+	List	   *constraint_pred;
+	ListCell   *lc;
+
+	*key_notnull = false;
+
+	/* Only plain relations have constraints */
+	if (rte->rtekind != RTE_RELATION || rte->inh)
+		return NIL;
+
+	constraint_pred = get_relation_constraints(root, rte->relid, rel, true);
+
+	foreach(lc, constraint_pred)
+	{
+		Node	   *pred = (Node *) lfirst(lc);
+		OpExpr	   *opexpr;
+		OpExpr	   *newop;
+		Node	   *leftop;
+		Node	   *rightop;
+		List	   *opfamilies;
+		List	   *opstrats;
+
+		if (IsA(pred, NullTest))
+		{
+			NullTest   *ntest = (NullTest *) pred;
+
+			if (ntest->nulltesttype == IS_NOT_NULL &&
+				equal(ntest->arg, keyvar))
+				*key_notnull = true;
+			continue;
+		}
+
+		if (!is_opclause(pred) || list_length(((OpExpr *) pred)->args) != 2)
+			continue;
+		opexpr = (OpExpr *) pred;
+		leftop = get_leftop((Expr *) opexpr);
+		rightop = get_rightop((Expr *) opexpr);
+
+		if (equal(leftop, keyvar))
+		{
+			if (!IsA(rightop, Const) || ((Const *) rightop)->constisnull)
+				continue;
+		}
+		else if (equal(rightop, keyvar))
+		{
+			if (!IsA(leftop, Const) || ((Const *) leftop)->constisnull)
+				continue;
+		}
+		else
+			continue;
+
+		/* Must be a btree comparison, else it might yield NULL */
+		get_op_btree_interpretation(opexpr->opno, &opfamilies, &opstrats);
+		if (opfamilies == NIL)
+			continue;
+		if (contain_mutable_functions(pred))
+			continue;
+
+		newop = (OpExpr *) copyObject(opexpr);
+		if (equal(leftop, keyvar))
+			linitial(newop->args) = copyObject(keyexpr);
+		else
+			lsecond(newop->args) = copyObject(keyexpr);
+		result = lappend(result, newop);
+	}
+
+	return result;
+}
+
+
 /*
  * relation_excluded_by_constraints
  *
@@ -19,6 +19,7 @@
 #include "optimizer/paths.h"
 #include "optimizer/placeholder.h"
 #include "optimizer/plancat.h"
+#include "optimizer/prep.h"
 #include "optimizer/restrictinfo.h"
 #include "parser/parsetree.h"
 #include "utils/hsearch.h"
@@ -419,6 +420,70 @@ build_join_rel(PlannerInfo *root,
 	return joinrel;
 }
 
+/*
+ * build_child_join_rel
+ *	  Build the RelOptInfo for a join between two inheritance member rels,
+ *	  to serve as one arm of a partition-wise join of parent_joinrel.
+ *
+ * The child join's targetlist is the parent joinrel's, translated to refer
+ * to the member rels, so that it lines up column-for-column with the
+ * parent's tlist as an Append requires.  The caller passes the restrictlist
+ * already translated the same way.  The result is not entered into the
+ * join_rel_list, since it is never joined to anything else.
+ */
+RelOptInfo *
+build_child_join_rel(PlannerInfo *root,
+					 RelOptInfo *parent_joinrel,
+					 RelOptInfo *outer_rel,
+					 RelOptInfo *inner_rel,
+					 AppendRelInfo *outer_appinfo,
+					 AppendRelInfo *inner_appinfo,
+					 SpecialJoinInfo *sjinfo,
+					 List *restrictlist)
+{
+	RelOptInfo *joinrel;
+	List	   *tlist;
+
+	tlist = (List *) adjust_appendrel_attrs((Node *) parent_joinrel->reltargetlist,
+											outer_appinfo);
+	tlist = (List *) adjust_appendrel_attrs((Node *) tlist, inner_appinfo);
+
+	joinrel = makeNode(RelOptInfo);
+	joinrel->reloptkind = RELOPT_JOINREL;
+	joinrel->relids = bms_union(outer_rel->relids, inner_rel->relids);
+	joinrel->rows = 0;
+	joinrel->width = parent_joinrel->width;
+	joinrel->reltargetlist = tlist;
+	joinrel->pathlist = NIL;
+	joinrel->cheapest_startup_path = NULL;
+	joinrel->cheapest_total_path = NULL;
+	joinrel->cheapest_unique_path = NULL;
+	joinrel->relid = 0;			/* indicates not a baserel */
+	joinrel->rtekind = RTE_JOIN;
+	joinrel->min_attr = 0;
+	joinrel->max_attr = 0;
+	joinrel->attr_needed = NULL;
+	joinrel->attr_widths = NULL;
+	joinrel->indexlist = NIL;
+	joinrel->pages = 0;
+	joinrel->tuples = 0;
+	joinrel->subplan = NULL;
+	joinrel->subrtable = NIL;
+	joinrel->subrowmark = NIL;
+	joinrel->baserestrictinfo = NIL;
+	joinrel->baserestrictcost.startup = 0;
+	joinrel->baserestrictcost.per_tuple = 0;
+	joinrel->joininfo = NIL;
+	joinrel->has_eclass_joins = false;
+	joinrel->index_outer_relids = NULL;
+	joinrel->index_inner_paths = NIL;
+
+	set_joinrel_size_estimates(root, joinrel, outer_rel, inner_rel,
+							   sjinfo, restrictlist);
+
+	return joinrel;
+}
+
 /*
  * build_joinrel_tlist
  *	  Builds a join relation's target list from an input relation.
@@ -643,6 +643,10 @@ select_nonredundant_join_clauses(PlannerInfo *root,
 								 List *restrictinfo_list,
 								 Path *inner_path)
 {
+	/* a Memoize node enforces whatever its subpath enforces */
+	if (IsA(inner_path, MemoizePath))
+		inner_path = ((MemoizePath *) inner_path)->subpath;
+
 	if (IsA(inner_path, IndexPath))
 	{
 		/*
@@ -0,0 +1,545 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison interface for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_BASE_YY_GRAM_H_INCLUDED
+# define YY_BASE_YY_GRAM_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int base_yydebug;
+#endif
+
+/* Token kinds.  */
+#ifndef YYTOKENTYPE
+# define YYTOKENTYPE
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    IDENT = 258,                   /* IDENT  */
+    FCONST = 259,                  /* FCONST  */
+    SCONST = 260,                  /* SCONST  */
+    BCONST = 261,                  /* BCONST  */
+    XCONST = 262,                  /* XCONST  */
+    Op = 263,                      /* Op  */
+    ICONST = 264,                  /* ICONST  */
+    PARAM = 265,                   /* PARAM  */
+    TYPECAST = 266,                /* TYPECAST  */
+    DOT_DOT = 267,                 /* DOT_DOT  */
+    COLON_EQUALS = 268,            /* COLON_EQUALS  */
+    ABORT_P = 269,                 /* ABORT_P  */
+    ABSOLUTE_P = 270,              /* ABSOLUTE_P  */
+    ACCESS = 271,                  /* ACCESS  */
+    ACTION = 272,                  /* ACTION  */
+    ADD_P = 273,                   /* ADD_P  */
+    ADMIN = 274,                   /* ADMIN  */
+    AFTER = 275,                   /* AFTER  */
+    AGGREGATE = 276,               /* AGGREGATE  */
+    ALL = 277,                     /* ALL  */
+    ALSO = 278,                    /* ALSO  */
+    ALTER = 279,                   /* ALTER  */
+    ALWAYS = 280,                  /* ALWAYS  */
+    ANALYSE = 281,                 /* ANALYSE  */
+    ANALYZE = 282,                 /* ANALYZE  */
+    AND = 283,                     /* AND  */
+    ANY = 284,                     /* ANY  */
+    ARRAY = 285,                   /* ARRAY  */
+    AS = 286,                      /* AS  */
+    ASC = 287,                     /* ASC  */
+    ASSERTION = 288,               /* ASSERTION  */
+    ASSIGNMENT = 289,              /* ASSIGNMENT  */
+    ASYMMETRIC = 290,              /* ASYMMETRIC  */
+    AT = 291,                      /* AT  */
+    AUTHORIZATION = 292,           /* AUTHORIZATION  */
+    BACKWARD = 293,                /* BACKWARD  */
+    BEFORE = 294,                  /* BEFORE  */
+    BEGIN_P = 295,                 /* BEGIN_P  */
+    BETWEEN = 296,                 /* BETWEEN  */
+    BIGINT = 297,                  /* BIGINT  */
+    BINARY = 298,                  /* BINARY  */
+    BIT = 299,                     /* BIT  */
+    BOOLEAN_P = 300,               /* BOOLEAN_P  */
+    BOTH = 301,                    /* BOTH  */
+    BY = 302,                      /* BY  */
+    CACHE = 303,                   /* CACHE  */
+    CALLED = 304,                  /* CALLED  */
+    CASCADE = 305,                 /* CASCADE  */
+    CASCADED = 306,                /* CASCADED  */
+    CASE = 307,                    /* CASE  */
+    CAST = 308,                    /* CAST  */
+    CATALOG_P = 309,               /* CATALOG_P  */
+    CHAIN = 310,                   /* CHAIN  */
+    CHAR_P = 311,                  /* CHAR_P  */
+    CHARACTER = 312,               /* CHARACTER  */
+    CHARACTERISTICS = 313,         /* CHARACTERISTICS  */
+    CHECK = 314,                   /* CHECK  */
+    CHECKPOINT = 315,              /* CHECKPOINT  */
+    CLASS = 316,                   /* CLASS  */
+    CLOSE = 317,                   /* CLOSE  */
+    CLUSTER = 318,                 /* CLUSTER  */
+    COALESCE = 319,                /* COALESCE  */
+    COLLATE = 320,                 /* COLLATE  */
+    COLUMN = 321,                  /* COLUMN  */
+    COMMENT = 322,                 /* COMMENT  */
+    COMMENTS = 323,                /* COMMENTS  */
+    COMMIT = 324,                  /* COMMIT  */
+    COMMITTED = 325,               /* COMMITTED  */
+    COMPRESSION = 326,             /* COMPRESSION  */
+    CONCURRENTLY = 327,            /* CONCURRENTLY  */
+    CONFIGURATION = 328,           /* CONFIGURATION  */
+    CONNECTION = 329,              /* CONNECTION  */
+    CONSTRAINT = 330,              /* CONSTRAINT  */
+    CONSTRAINTS = 331,             /* CONSTRAINTS  */
+    CONTENT_P = 332,               /* CONTENT_P  */
+    CONTINUE_P = 333,              /* CONTINUE_P  */
+    CONVERSION_P = 334,            /* CONVERSION_P  */
+    COPY = 335,                    /* COPY  */
+    COST = 336,                    /* COST  */
+    CREATE = 337,                  /* CREATE  */
+    CREATEDB = 338,                /* CREATEDB  */
+    CREATEROLE = 339,              /* CREATEROLE  */
+    CREATEUSER = 340,              /* CREATEUSER  */
+    CROSS = 341,                   /* CROSS  */
+    CSV = 342,                     /* CSV  */
+    CURRENT_P = 343,               /* CURRENT_P  */
+    CURRENT_CATALOG = 344,         /* CURRENT_CATALOG  */
+    CURRENT_DATE = 345,            /* CURRENT_DATE  */
+    CURRENT_ROLE = 346,            /* CURRENT_ROLE  */
+    CURRENT_SCHEMA = 347,          /* CURRENT_SCHEMA  */
+    CURRENT_TIME = 348,            /* CURRENT_TIME  */
+    CURRENT_TIMESTAMP = 349,       /* CURRENT_TIMESTAMP  */
+    CURRENT_USER = 350,            /* CURRENT_USER  */
+    CURSOR = 351,                  /* CURSOR  */
+    CYCLE = 352,                   /* CYCLE  */
+    DATA_P = 353,                  /* DATA_P  */
+    DATABASE = 354,                /* DATABASE  */
+    DAY_P = 355,                   /* DAY_P  */
+    DEALLOCATE = 356,              /* DEALLOCATE  */
+    DEC = 357,                     /* DEC  */
+    DECIMAL_P = 358,               /* DECIMAL_P  */
+    DECLARE = 359,                 /* DECLARE  */
+    DEFAULT = 360,                 /* DEFAULT  */
+    DEFAULTS = 361,                /* DEFAULTS  */
+    DEFERRABLE = 362,              /* DEFERRABLE  */
+    DEFERRED = 363,                /* DEFERRED  */
+    DEFINER = 364,                 /* DEFINER  */
+    DELETE_P = 365,                /* DELETE_P  */
+    DELIMITER = 366,               /* DELIMITER  */
+    DELIMITERS = 367,              /* DELIMITERS  */
+    DESC = 368,                    /* DESC  */
+    DICTIONARY = 369,              /* DICTIONARY  */
+    DISABLE_P = 370,               /* DISABLE_P  */
+    DISCARD = 371,                 /* DISCARD  */
+    DISTINCT = 372,                /* DISTINCT  */
+    DO = 373,                      /* DO  */
+    DOCUMENT_P = 374,              /* DOCUMENT_P  */
+    DOMAIN_P = 375,                /* DOMAIN_P  */
+    DOUBLE_P = 376,                /* DOUBLE_P  */
+    DROP = 377,                    /* DROP  */
+    EACH = 378,                    /* EACH  */
+    ELSE = 379,                    /* ELSE  */
+    ENABLE_P = 380,                /* ENABLE_P  */
+    ENCODING = 381,                /* ENCODING  */
+    ENCRYPTED = 382,               /* ENCRYPTED  */
+    END_P = 383,                   /* END_P  */
+    ENUM_P = 384,                  /* ENUM_P  */
+    ESCAPE = 385,                  /* ESCAPE  */
+    EXCEPT = 386,                  /* EXCEPT  */
+    EXCLUDE = 387,                 /* EXCLUDE  */
+    EXCLUDING = 388,               /* EXCLUDING  */
+    EXCLUSIVE = 389,               /* EXCLUSIVE  */
+    EXECUTE = 390,                 /* EXECUTE  */
+    EXISTS = 391,                  /* EXISTS  */
+    EXPLAIN = 392,                 /* EXPLAIN  */
+    EXTERNAL = 393,                /* EXTERNAL  */
+    EXTRACT = 394,                 /* EXTRACT  */
+    FALSE_P = 395,                 /* FALSE_P  */
+    FAMILY = 396,                  /* FAMILY  */
+    FETCH = 397,                   /* FETCH  */
+    FIRST_P = 398,                 /* FIRST_P  */
+    FLOAT_P = 399,                 /* FLOAT_P  */
+    FOLLOWING = 400,               /* FOLLOWING  */
+    FOR = 401,                     /* FOR  */
+    FORCE = 402,                   /* FORCE  */
+    FOREIGN = 403,                 /* FOREIGN  */
+    FORWARD = 404,                 /* FORWARD  */
+    FREEZE = 405,                  /* FREEZE  */
+    FROM = 406,                    /* FROM  */
+    FULL = 407,                    /* FULL  */
+    FUNCTION = 408,                /* FUNCTION  */
+    FUNCTIONS = 409,               /* FUNCTIONS  */
+    GLOBAL = 410,                  /* GLOBAL  */
+    GRANT = 411,                   /* GRANT  */
+    GRANTED = 412,                 /* GRANTED  */
+    GREATEST = 413,                /* GREATEST  */
+    GROUP_P = 414,                 /* GROUP_P  */
+    HANDLER = 415,                 /* HANDLER  */
+    HAVING = 416,                  /* HAVING  */
+    HEADER_P = 417,                /* HEADER_P  */
+    HOLD = 418,                    /* HOLD  */
+    HOUR_P = 419,                  /* HOUR_P  */
+    IDENTITY_P = 420,              /* IDENTITY_P  */
+    IF_P = 421,                    /* IF_P  */
+    ILIKE = 422,                   /* ILIKE  */
+    IMMEDIATE = 423,               /* IMMEDIATE  */
+    IMMUTABLE = 424,               /* IMMUTABLE  */
+    IMPLICIT_P = 425,              /* IMPLICIT_P  */
+    IN_P = 426,                    /* IN_P  */
+    INCLUDING = 427,               /* INCLUDING  */
+    INCREMENT = 428,               /* INCREMENT  */
+    INDEX = 429,                   /* INDEX  */
+    INDEXES = 430,                 /* INDEXES  */
+    INHERIT = 431,                 /* INHERIT  */
+    INHERITS = 432,                /* INHERITS  */
+    INITIALLY = 433,               /* INITIALLY  */
+    INLINE_P = 434,                /* INLINE_P  */
+    INNER_P = 435,                 /* INNER_P  */
+    INOUT = 436,                   /* INOUT  */
+    INPUT_P = 437,                 /* INPUT_P  */
+    INSENSITIVE = 438,             /* INSENSITIVE  */
+    INSERT = 439,                  /* INSERT  */
+    INSTEAD = 440,                 /* INSTEAD  */
+    INT_P = 441,                   /* INT_P  */
+    INTEGER = 442,                 /* INTEGER  */
+    INTERSECT = 443,               /* INTERSECT  */
+    INTERVAL = 444,                /* INTERVAL  */
+    INTO = 445,                    /* INTO  */
+    INVOKER = 446,                 /* INVOKER  */
+    IS = 447,                      /* IS  */
+    ISNULL = 448,                  /* ISNULL  */
+    ISOLATION = 449,               /* ISOLATION  */
+    JOIN = 450,                    /* JOIN  */
+    KEY = 451,                     /* KEY  */
+    LANGUAGE = 452,                /* LANGUAGE  */
+    LARGE_P = 453,                 /* LARGE_P  */
+    LAST_P = 454,                  /* LAST_P  */
+    LC_COLLATE_P = 455,            /* LC_COLLATE_P  */
+    LC_CTYPE_P = 456,              /* LC_CTYPE_P  */
+    LEADING = 457,                 /* LEADING  */
+    LEAST = 458,                   /* LEAST  */
+    LEFT = 459,                    /* LEFT  */
+    LEVEL = 460,                   /* LEVEL  */
+    LIKE = 461,                    /* LIKE  */
+    LIMIT = 462,                   /* LIMIT  */
+    LISTEN = 463,                  /* LISTEN  */
+    LOAD = 464,                    /* LOAD  */
+    LOCAL = 465,                   /* LOCAL  */
+    LOCALTIME = 466,               /* LOCALTIME  */
+    LOCALTIMESTAMP = 467,          /* LOCALTIMESTAMP  */
+    LOCATION = 468,                /* LOCATION  */
+    LOCK_P = 469,                  /* LOCK_P  */
+    LOGIN_P = 470,                 /* LOGIN_P  */
+    MAPPING = 471,                 /* MAPPING  */
+    MATCH = 472,                   /* MATCH  */
+    MAXVALUE = 473,                /* MAXVALUE  */
+    MINUTE_P = 474,                /* MINUTE_P  */
+    MINVALUE = 475,                /* MINVALUE  */
+    MODE = 476,                    /* MODE  */
+    MONTH_P = 477,                 /* MONTH_P  */
+    MOVE = 478,                    /* MOVE  */
+    NAME_P = 479,                  /* NAME_P  */
+    NAMES = 480,                   /* NAMES  */
+    NATIONAL = 481,                /* NATIONAL  */
+    NATURAL = 482,                 /* NATURAL  */
+    NCHAR = 483,                   /* NCHAR  */
+    NEXT = 484,                    /* NEXT  */
+    NO = 485,                      /* NO  */
+    NOCREATEDB = 486,              /* NOCREATEDB  */
+    NOCREATEROLE = 487,            /* NOCREATEROLE  */
+    NOCREATEUSER = 488,            /* NOCREATEUSER  */
+    NOINHERIT = 489,               /* NOINHERIT  */
+    NOLOGIN_P = 490,               /* NOLOGIN_P  */
+    NONE = 491,                    /* NONE  */
+    NOSUPERUSER = 492,             /* NOSUPERUSER  */
+    NOT = 493,                     /* NOT  */
+    NOTHING = 494,                 /* NOTHING  */
+    NOTIFY = 495,                  /* NOTIFY  */
+    NOTNULL = 496,                 /* NOTNULL  */
+    NOWAIT = 497,                  /* NOWAIT  */
+    NULL_P = 498,                  /* NULL_P  */
+    NULLIF = 499,                  /* NULLIF  */
+    NULLS_P = 500,                 /* NULLS_P  */
+    NUMERIC = 501,                 /* NUMERIC  */
+    OBJECT_P = 502,                /* OBJECT_P  */
+    OF = 503,                      /* OF  */
+    OFF = 504,                     /* OFF  */
+    OFFSET = 505,                  /* OFFSET  */
+    OIDS = 506,                    /* OIDS  */
+    ON = 507,                      /* ON  */
+    ONLY = 508,                    /* ONLY  */
+    OPERATOR = 509,                /* OPERATOR  */
+    OPTION = 510,                  /* OPTION  */
+    OPTIONS = 511,                 /* OPTIONS  */
+    OR = 512,                      /* OR  */
+    ORDER = 513,                   /* ORDER  */
+    OUT_P = 514,                   /* OUT_P  */
+    OUTER_P = 515,                 /* OUTER_P  */
+    OVER = 516,                    /* OVER  */
+    OVERLAPS = 517,                /* OVERLAPS  */
+    OVERLAY = 518,                 /* OVERLAY  */
+    OWNED = 519,                   /* OWNED  */
+    OWNER = 520,                   /* OWNER  */
+    PARSER = 521,                  /* PARSER  */
+    PARTIAL = 522,                 /* PARTIAL  */
+    PARTITION = 523,               /* PARTITION  */
+    PASSING = 524,                 /* PASSING  */
+    PASSWORD = 525,                /* PASSWORD  */
+    PLACING = 526,                 /* PLACING  */
+    PLANS = 527,                   /* PLANS  */
+    POSITION = 528,                /* POSITION  */
+    PRECEDING = 529,               /* PRECEDING  */
+    PRECISION = 530,               /* PRECISION  */
+    PRESERVE = 531,                /* PRESERVE  */
+    PREPARE = 532,                 /* PREPARE  */
+    PREPARED = 533,                /* PREPARED  */
+    PRIMARY = 534,                 /* PRIMARY  */
+    PRIOR = 535,                   /* PRIOR  */
+    PRIVILEGES = 536,              /* PRIVILEGES  */
+    PROCEDURAL = 537,              /* PROCEDURAL  */
+    PROCEDURE = 538,               /* PROCEDURE  */
+    QUOTE = 539,                   /* QUOTE  */
+    RANGE = 540,                   /* RANGE  */
+    READ = 541,                    /* READ  */
+    REAL = 542,                    /* REAL  */
+    REASSIGN = 543,                /* REASSIGN  */
+    RECHECK = 544,                 /* RECHECK  */
+    RECURSIVE = 545,               /* RECURSIVE  */
+    REF = 546,                     /* REF  */
+    REFERENCES = 547,              /* REFERENCES  */
+    REINDEX = 548,                 /* REINDEX  */
+    RELATIVE_P = 549,              /* RELATIVE_P  */
+    RELEASE = 550,                 /* RELEASE  */
+    RENAME = 551,                  /* RENAME  */
+    REPEATABLE = 552,              /* REPEATABLE  */
+    REPLACE = 553,                 /* REPLACE  */
+    REPLICA = 554,                 /* REPLICA  */
+    RESET = 555,                   /* RESET  */
+    RESTART = 556,                 /* RESTART  */
+    RESTRICT = 557,                /* RESTRICT  */
+    RETURNING = 558,               /* RETURNING  */
+    RETURNS = 559,                 /* RETURNS  */
+    REVOKE = 560,                  /* REVOKE  */
+    RIGHT = 561,                   /* RIGHT  */
+    ROLE = 562,                    /* ROLE  */
+    ROLLBACK = 563,                /* ROLLBACK  */
+    ROW = 564,                     /* ROW  */
+    ROWS = 565,                    /* ROWS  */
+    RULE = 566,                    /* RULE  */
+    SAVEPOINT = 567,               /* SAVEPOINT  */
+    SCHEMA = 568,                  /* SCHEMA  */
+    SCROLL = 569,                  /* SCROLL  */
+    SEARCH = 570,                  /* SEARCH  */
+    SECOND_P = 571,                /* SECOND_P  */
+    SECURITY = 572,                /* SECURITY  */
+    SELECT = 573,                  /* SELECT  */
+    SEQUENCE = 574,                /* SEQUENCE  */
+    SEQUENCES = 575,               /* SEQUENCES  */
+    SERIALIZABLE = 576,            /* SERIALIZABLE  */
+    SERVER = 577,                  /* SERVER  */
+    SESSION = 578,                 /* SESSION  */
+    SESSION_USER = 579,            /* SESSION_USER  */
+    SET = 580,                     /* SET  */
+    SETOF = 581,                   /* SETOF  */
+    SHARE = 582,                   /* SHARE  */
+    SHOW = 583,                    /* SHOW  */
+    SIMILAR = 584,                 /* SIMILAR  */
+    SIMPLE = 585,                  /* SIMPLE  */
+    SMALLINT = 586,                /* SMALLINT  */
+    SOME = 587,                    /* SOME  */
+    STABLE = 588,                  /* STABLE  */
+    STANDALONE_P = 589,            /* STANDALONE_P  */
+    START = 590,                   /* START  */
+    STATEMENT = 591,               /* STATEMENT  */
+    STATISTICS = 592,              /* STATISTICS  */
+    STDIN = 593,                   /* STDIN  */
+    STDOUT = 594,                  /* STDOUT  */
+    STORAGE = 595,                 /* STORAGE  */
+    STRICT_P = 596,                /* STRICT_P  */
+    STRIP_P = 597,                 /* STRIP_P  */
+    SUBSTRING = 598,               /* SUBSTRING  */
+    SUPERUSER_P = 599,             /* SUPERUSER_P  */
+    SYMMETRIC = 600,               /* SYMMETRIC  */
+    SYSID = 601,                   /* SYSID  */
+    SYSTEM_P = 602,                /* SYSTEM_P  */
+    TABLE = 603,                   /* TABLE  */
+    TABLES = 604,                  /* TABLES  */
+    TABLESPACE = 605,              /* TABLESPACE  */
+    TEMP = 606,                    /* TEMP  */
+    TEMPLATE = 607,                /* TEMPLATE  */
+    TEMPORARY = 608,               /* TEMPORARY  */
+    TEXT_P = 609,                  /* TEXT_P  */
+    THEN = 610,                    /* THEN  */
+    TIME = 611,                    /* TIME  */
+    TIMESTAMP = 612,               /* TIMESTAMP  */
+    TO = 613,                      /* TO  */
+    TRAILING = 614,                /* TRAILING  */
+    TRANSACTION = 615,             /* TRANSACTION  */
+    TREAT = 616,                   /* TREAT  */
+    TRIGGER = 617,                 /* TRIGGER  */
+    TRIM = 618,                    /* TRIM  */
+    TRUE_P = 619,                  /* TRUE_P  */
+    TRUNCATE = 620,                /* TRUNCATE  */
+    TRUSTED = 621,                 /* TRUSTED  */
+    TYPE_P = 622,                  /* TYPE_P  */
+    UNBOUNDED = 623,               /* UNBOUNDED  */
+    UNCOMMITTED = 624,             /* UNCOMMITTED  */
+    UNENCRYPTED = 625,             /* UNENCRYPTED  */
+    UNION = 626,                   /* UNION  */
+    UNIQUE = 627,                  /* UNIQUE  */
+    UNKNOWN = 628,                 /* UNKNOWN  */
+    UNLISTEN = 629,                /* UNLISTEN  */
+    UNTIL = 630,                   /* UNTIL  */
+    UPDATE = 631,                  /* UPDATE  */
+    USER = 632,                    /* USER  */
+    USING = 633,                   /* USING  */
+    VACUUM = 634,                  /* VACUUM  */
+    VALID = 635,                   /* VALID  */
+    VALIDATOR = 636,               /* VALIDATOR  */
+    VALUE_P = 637,                 /* VALUE_P  */
+    VALUES = 638,                  /* VALUES  */
+    VARCHAR = 639,                 /* VARCHAR  */
+    VARIADIC = 640,                /* VARIADIC  */
+    VARYING = 641,                 /* VARYING  */
+    VERBOSE = 642,                 /* VERBOSE  */
+    VERSION_P = 643,               /* VERSION_P  */
+    VIEW = 644,                    /* VIEW  */
+    VOLATILE = 645,                /* VOLATILE  */
+    WHEN = 646,                    /* WHEN  */
+    WHERE = 647,                   /* WHERE  */
+    WHITESPACE_P = 648,            /* WHITESPACE_P  */
+    WINDOW = 649,                  /* WINDOW  */
+    WITH = 650,                    /* WITH  */
+    WITHOUT = 651,                 /* WITHOUT  */
+    WORK = 652,                    /* WORK  */
+    WRAPPER = 653,                 /* WRAPPER  */
+    WRITE = 654,                   /* WRITE  */
+    XML_P = 655,                   /* XML_P  */
+    XMLATTRIBUTES = 656,           /* XMLATTRIBUTES  */
+    XMLCONCAT = 657,               /* XMLCONCAT  */
+    XMLELEMENT = 658,              /* XMLELEMENT  */
+    XMLEXISTS = 659,               /* XMLEXISTS  */
+    XMLFOREST = 660,               /* XMLFOREST  */
+    XMLPARSE = 661,                /* XMLPARSE  */
+    XMLPI = 662,                   /* XMLPI  */
+    XMLROOT = 663,                 /* XMLROOT  */
+    XMLSERIALIZE = 664,            /* XMLSERIALIZE  */
+    YEAR_P = 665,                  /* YEAR_P  */
+    YES_P = 666,                   /* YES_P  */
+    ZONE = 667,                    /* ZONE  */
+    NULLS_FIRST = 668,             /* NULLS_FIRST  */
+    NULLS_LAST = 669,              /* NULLS_LAST  */
+    WITH_TIME = 670,               /* WITH_TIME  */
+    POSTFIXOP = 671,               /* POSTFIXOP  */
+    UMINUS = 672                   /* UMINUS  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
+#endif
+
+/* Value type.  */
+#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
+union YYSTYPE
+{
+#line 146 "gram.y"
+
+	core_YYSTYPE		core_yystype;
+	/* these fields must match core_YYSTYPE: */
+	int					ival;
+	char				*str;
+	const char			*keyword;
+
+	char				chr;
+	bool				boolean;
+	JoinType			jtype;
+	DropBehavior		dbehavior;
+	OnCommitAction		oncommit;
+	List				*list;
+	Node				*node;
+	Value				*value;
+	ObjectType			objtype;
+	TypeName			*typnam;
+	FunctionParameter   *fun_param;
+	FunctionParameterMode fun_param_mode;
+	FuncWithArgs		*funwithargs;
+	DefElem				*defelt;
+	SortBy				*sortby;
+	WindowDef			*windef;
+	JoinExpr			*jexpr;
+	IndexElem			*ielem;
+	Alias				*alias;
+	RangeVar			*range;
+	IntoClause			*into;
+	WithClause			*with;
+	A_Indices			*aind;
+	ResTarget			*target;
+	struct PrivTarget	*privtarget;
+	AccessPriv			*accesspriv;
+	InsertStmt			*istmt;
+	VariableSetStmt		*vsetstmt;
+
+#line 518 "gram.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
+# define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
+#endif
+
+/* Location type.  */
+#if ! defined YYLTYPE && ! defined YYLTYPE_IS_DECLARED
+typedef struct YYLTYPE YYLTYPE;
+struct YYLTYPE
+{
+  int first_line;
+  int first_column;
+  int last_line;
+  int last_column;
+};
+# define YYLTYPE_IS_DECLARED 1
+# define YYLTYPE_IS_TRIVIAL 1
+#endif
+
+
+
+
+int base_yyparse (core_yyscan_t yyscanner);
+
+
+#endif /* !YY_BASE_YY_GRAM_H_INCLUDED  */
@@ -0,0 +1 @@
+../../../src/backend/port/unix_latch.c
\ No newline at end of file
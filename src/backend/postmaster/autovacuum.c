@@ -10,7 +10,8 @@
  * parameter is set.  The launcher schedules autovacuum workers to be started
  * when appropriate.  The workers are the processes which execute the actual
  * vacuuming; they connect to a database as determined in the launcher, and
- * once connected they examine the catalogs to select the tables to vacuum.
+ * once connected they examine the catalogs to select the tables to vacuum,
+ * and process them in order of decreasing estimated benefit.
  *
  * The autovacuum launcher cannot start the worker processes by itself,
  * because doing so would cause robustness issues (namely, failure to shut
@@ -61,19 +62,24 @@
  */
 #include "postgres.h"
 
+#include <math.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "access/genam.h"
+#include "access/gin.h"
 #include "access/heapam.h"
 #include "access/reloptions.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/dependency.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_database.h"
+#include "catalog/pg_index.h"
 #include "commands/dbcommands.h"
 #include "commands/vacuum.h"
 #include "libpq/pqsignal.h"
@@ -84,6 +90,7 @@
 #include "postmaster/postmaster.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/lmgr.h"
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
 #include "storage/procsignal.h"
@@ -121,6 +128,13 @@ int			Log_autovacuum_min_duration = -1;
 /* the minimum allowed time between two awakenings of the launcher */
 #define MIN_AUTOVAC_SLEEPTIME 100.0		/* milliseconds */
 
+/*
+ * Priority given to a table whose relfrozenxid has got more than halfway from
+ * its freeze_max_age to the wraparound horizon; such tables are processed
+ * ahead of everything else, regardless of size.
+ */
+#define AUTOVAC_EMERGENCY_SCORE 1.0e9
+
 /* Flags to tell if we are in an autovacuum process */
 static bool am_autovacuum_launcher = false;
 static bool am_autovacuum_worker = false;
@@ -167,6 +181,13 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/* struct to keep track of tables to process, with their priority */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	double		ac_score;		/* estimated benefit of processing it now */
+} av_candidate;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -276,9 +297,12 @@ static void launch_worker(TimestampTz now);
 static List *get_database_list(void);
 static void rebuild_database_list(Oid newdb);
 static int	db_comparator(const void *a, const void *b);
+static double db_vacuum_score(PgStat_StatDBEntry *entry);
 static void autovac_balance_cost(void);
 
 static void do_autovacuum(void);
+static List *sort_candidate_tables(List *candidates);
+static int	candidate_comparator(const void *a, const void *b);
 static void FreeWorkerInfo(int code, Datum arg);
 
 static autovac_table *table_recheck_autovac(Oid relid, HTAB *table_toast_map,
@@ -286,7 +310,8 @@ static autovac_table *table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 						  Form_pg_class classForm,
 						  PgStat_StatTabEntry *tabentry,
-						  bool *dovacuum, bool *doanalyze, bool *wraparound);
+						  bool *dovacuum, bool *doanalyze, bool *wraparound,
+						  double *score);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 						  BufferAccessStrategy bstrategy);
@@ -296,6 +321,7 @@ static PgStat_StatTabEntry *get_pgstat_tabentry_relid(Oid relid, bool isshared,
 						  PgStat_StatDBEntry *shared,
 						  PgStat_StatDBEntry *dbentry);
 static void autovac_report_activity(autovac_table *tab);
+static void autovac_gin_cleanup(Oid indexoid);
 static void avl_sighup_handler(SIGNAL_ARGS);
 static void avl_sigusr2_handler(SIGNAL_ARGS);
 static void avl_sigterm_handler(SIGNAL_ARGS);
@@ -1049,6 +1075,64 @@ db_comparator(const void *a, const void *b)
 		return (((avl_dbase *) a)->adl_score < ((avl_dbase *) b)->adl_score) ? 1 : -1;
 }
 
+/*
+ * db_vacuum_score
+ *
+ * Estimate how urgently a database needs a worker, as the priority of its
+ * most urgent table.  The scale is the same as the one
+ * relation_needs_vacanalyze uses.  Returns 0 if no table seems to need
+ * anything.
+ *
+ * This is only an approximation of what the worker will decide.  The
+ * launcher is not connected to any database and so cannot read pg_class or
+ * the tables' reloptions.  We use the live tuple count known to pgstats in
+ * place of reltuples, and the global thresholds and scale factors for every
+ * table.  So a table with autovacuum_enabled = false, or with its own
+ * thresholds, is scored as if it had the defaults, and can raise its
+ * database's priority although the worker will then skip it or find it
+ * below its real threshold.  The cost of that is a wasted worker visit; the
+ * naptime skip rule in do_start_worker still keeps such a database from
+ * being picked more than once per autovacuum_naptime, so it cannot starve
+ * the others.  Tables with no pgstats entry are not seen at all.
+ */
+static double
+db_vacuum_score(PgStat_StatDBEntry *entry)
+{
+	HASH_SEQ_STATUS hstat;
+	PgStat_StatTabEntry *tabentry;
+	double		result = 0.0;
+
+	if (entry->tables == NULL)
+		return 0.0;
+
+	hash_seq_init(&hstat, entry->tables);
+	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		double		reltuples = tabentry->n_live_tuples;
+		double		vacthresh;
+		double		anlthresh;
+		double		benefit = 0.0;
+		double		score;
+
+		vacthresh = autovacuum_vac_thresh + autovacuum_vac_scale * reltuples;
+		anlthresh = autovacuum_anl_thresh + autovacuum_anl_scale * reltuples;
+
+		if (tabentry->n_dead_tuples > vacthresh)
+			benefit += tabentry->n_dead_tuples / Max(vacthresh, 1.0);
+		if (tabentry->changes_since_analyze > anlthresh)
+			benefit += tabentry->changes_since_analyze / Max(anlthresh, 1.0);
+		if (benefit == 0.0)
+			continue;
+
+		score = benefit /
+			(1.0 + log10(1.0 + reltuples + tabentry->n_dead_tuples));
+		if (score > result)
+			result = score;
+	}
+
+	return result;
+}
+
 /*
  * do_start_worker
  *
@@ -1068,6 +1152,7 @@ do_start_worker(void)
 	TransactionId xidForceLimit;
 	bool		for_xid_wrap;
 	avw_dbase  *avdb;
+	double		avdb_score = 0.0;
 	TimestampTz current_time;
 	bool		skipit = false;
 	Oid			retval = InvalidOid;
@@ -1112,23 +1197,20 @@ do_start_worker(void)
 		xidForceLimit -= FirstNormalTransactionId;
 
 	/*
-	 * Choose a database to connect to.  We pick the database that was least
-	 * recently auto-vacuumed, or one that needs vacuuming to prevent Xid
-	 * wraparound-related data loss.  If any db at risk of wraparound is
+	 * Choose a database to connect to.  If any db at risk of wraparound is
 	 * found, we pick the one with oldest datfrozenxid, independently of
-	 * autovacuum times.
+	 * anything else.  Otherwise we pick the database containing the table
+	 * that most urgently needs attention, as estimated from the pgstats data
+	 * for its tables (see db_vacuum_score); among databases that look
+	 * equally urgent, including those where nothing seems to need doing,
+	 * the one that was least recently auto-vacuumed wins.  A busy database
+	 * cannot starve the others, because a database processed less than
+	 * autovacuum_naptime seconds ago is skipped.
 	 *
 	 * Note that a database with no stats entry is not considered, except for
 	 * Xid wraparound purposes.  The theory is that if no one has ever
 	 * connected to it since the stats were last initialized, it doesn't need
 	 * vacuuming.
-	 *
-	 * XXX This could be improved if we had more info about whether it needs
-	 * vacuuming before connecting to it.  Perhaps look through the pgstats
-	 * data for the database's tables?  One idea is to keep track of the
-	 * number of new and dead tuples per database in pgstats.  However it
-	 * isn't clear how to construct a metric that measures that and not cause
-	 * starvation for less busy databases.
 	 */
 	avdb = NULL;
 	for_xid_wrap = false;
@@ -1137,6 +1219,7 @@ do_start_worker(void)
 	{
 		avw_dbase  *tmp = lfirst(cell);
 		Dlelem	   *elem;
+		double		score;
 
 		/* Check to see if this one is at risk of wraparound */
 		if (TransactionIdPrecedes(tmp->adw_frozenxid, xidForceLimit))
@@ -1195,12 +1278,18 @@ do_start_worker(void)
 			continue;
 
 		/*
-		 * Remember the db with oldest autovac time.  (If we are here, both
-		 * tmp->entry and db->entry must be non-null.)
+		 * Remember the db with the most urgent work, or the oldest autovac
+		 * time on a tie.  (If we are here, both tmp->entry and db->entry
+		 * must be non-null.)
 		 */
-		if (avdb == NULL ||
-			tmp->adw_entry->last_autovac_time < avdb->adw_entry->last_autovac_time)
+		score = db_vacuum_score(tmp->adw_entry);
+		if (avdb == NULL || score > avdb_score ||
+			(score == avdb_score &&
+			 tmp->adw_entry->last_autovac_time < avdb->adw_entry->last_autovac_time))
+		{
 			avdb = tmp;
+			avdb_score = score;
+		}
 	}
 
 	/* Found a database -- process it */
@@ -1820,7 +1909,9 @@ do_autovacuum(void)
 	HeapTuple	tuple;
 	HeapScanDesc relScan;
 	Form_pg_database dbForm;
-	List	   *table_oids = NIL;
+	List	   *candidates = NIL;
+	List	   *table_oids;
+	List	   *gin_oids = NIL;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
 	ListCell   *volatile cell;
@@ -1937,6 +2028,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		relid = HeapTupleGetOid(tuple);
 
@@ -1947,7 +2039,8 @@ do_autovacuum(void)
 
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &score);
 
 		/*
 		 * Check if it is a temp table (presumably, of some other backend's).
@@ -1994,9 +2087,15 @@ do_autovacuum(void)
 		}
 		else
 		{
-			/* relations that need work are added to table_oids */
+			/* relations that need work are added to the candidate list */
 			if (dovacuum || doanalyze)
-				table_oids = lappend_oid(table_oids, relid);
+			{
+				av_candidate *cand = palloc(sizeof(av_candidate));
+
+				cand->ac_relid = relid;
+				cand->ac_score = score;
+				candidates = lappend(candidates, cand);
+			}
 
 			/*
 			 * Remember the association for the second pass.  Note: we must do
@@ -2046,6 +2145,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
@@ -2075,16 +2175,49 @@ do_autovacuum(void)
 											 shared, dbentry);
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &score);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			av_candidate *cand = palloc(sizeof(av_candidate));
+
+			cand->ac_relid = relid;
+			cand->ac_score = score;
+			candidates = lappend(candidates, cand);
+		}
+	}
+
+	heap_endscan(relScan);
+
+	/* third pass: collect GIN indexes, whose pending lists we may flush */
+	ScanKeyInit(&key,
+				Anum_pg_class_relkind,
+				BTEqualStrategyNumber, F_CHAREQ,
+				CharGetDatum(RELKIND_INDEX));
+
+	relScan = heap_beginscan(classRel, SnapshotNow, 1, &key);
+	while ((tuple = heap_getnext(relScan, ForwardScanDirection)) != NULL)
+	{
+		Form_pg_class classForm = (Form_pg_class) GETSTRUCT(tuple);
+
+		if (classForm->relam == GIN_AM_OID && !classForm->relistemp)
+			gin_oids = lappend_oid(gin_oids, HeapTupleGetOid(tuple));
 	}
 
 	heap_endscan(relScan);
 	heap_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the tables in order of decreasing priority rather than in
+	 * pg_class order, so that a huge table that merely needs freezing does
+	 * not hold up small tables that are bloating quickly.  Every worker in
+	 * this database sorts the same way, and skips the tables the others are
+	 * working on, so together they drain the list from the top.
+	 */
+	table_oids = sort_candidate_tables(candidates);
+
 	/*
 	 * Create a buffer access strategy object for VACUUM to use.  We want to
 	 * use the same one across all the vacuum operations we perform, since the
@@ -2282,6 +2415,47 @@ deleted:
 		LWLockRelease(AutovacuumLock);
 	}
 
+	/*
+	 * Move the pending lists of GIN indexes that have grown past
+	 * gin_pending_list_limit into the main index structure, so that
+	 * inserting backends don't have to.  Each index is done in its own
+	 * transaction, and an error only skips that index.
+	 */
+	foreach(cell, gin_oids)
+	{
+		Oid			indexoid = lfirst_oid(cell);
+
+		CHECK_FOR_INTERRUPTS();
+
+		MemoryContextResetAndDeleteChildren(PortalContext);
+
+		PG_TRY();
+		{
+			MemoryContextSwitchTo(TopTransactionContext);
+			autovac_gin_cleanup(indexoid);
+			QueryCancelPending = false;
+		}
+		PG_CATCH();
+		{
+			HOLD_INTERRUPTS();
+			errcontext("automatic cleanup of GIN pending list of index with OID %u",
+					   indexoid);
+			EmitErrorReport();
+
+			AbortOutOfAnyTransaction();
+			FlushErrorState();
+			MemoryContextResetAndDeleteChildren(PortalContext);
+
+			StartTransactionCommand();
+			RESUME_INTERRUPTS();
+		}
+		PG_END_TRY();
+
+		/* release the locks taken by autovac_gin_cleanup */
+		CommitTransactionCommand();
+		StartTransactionCommand();
+	}
+
 	/*
 	 * We leak table_toast_map here (among other things), but since we're
 	 * going away soon, it's not a problem.
@@ -2297,6 +2471,59 @@ deleted:
 	CommitTransactionCommand();
 }
 
+/*
+ * sort_candidate_tables
+ *
+ * Given a list of av_candidate, return a list of the relids in order of
+ * decreasing score.  Ties are broken by OID, so that concurrent workers in
+ * the same database walk the tables in the same order.
+ */
+static List *
+sort_candidate_tables(List *candidates)
+{
+	av_candidate *cands;
+	List	   *result = NIL;
+	ListCell   *cell;
+	int			ncands;
+	int			i;
+
+	ncands = list_length(candidates);
+	if (ncands == 0)
+		return NIL;
+
+	cands = (av_candidate *) palloc(ncands * sizeof(av_candidate));
+	i = 0;
+	foreach(cell, candidates)
+		cands[i++] = *(av_candidate *) lfirst(cell);
+
+	qsort(cands, ncands, sizeof(av_candidate), candidate_comparator);
+
+	for (i = 0; i < ncands; i++)
+		result = lappend_oid(result, cands[i].ac_relid);
+
+	pfree(cands);
+
+	return result;
+}
+
+/* qsort comparator for av_candidate, highest score first */
+static int
+candidate_comparator(const void *a, const void *b)
+{
+	const av_candidate *ca = (const av_candidate *) a;
+	const av_candidate *cb = (const av_candidate *) b;
+
+	if (ca->ac_score > cb->ac_score)
+		return -1;
+	if (ca->ac_score < cb->ac_score)
+		return 1;
+	if (ca->ac_relid < cb->ac_relid)
+		return -1;
+	if (ca->ac_relid > cb->ac_relid)
+		return 1;
+	return 0;
+}
+
 /*
  * extract_autovac_opts
  *
@@ -2368,6 +2595,7 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	PgStat_StatDBEntry *shared;
 	PgStat_StatDBEntry *dbentry;
 	bool		wraparound;
+	double		score;
 	AutoVacOpts *avopts;
 
 	/* use fresh stats */
@@ -2403,7 +2631,7 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 										 shared, dbentry);
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
-							  &dovacuum, &doanalyze, &wraparound);
+							  &dovacuum, &doanalyze, &wraparound, &score);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -2471,7 +2699,8 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  *
  * Check whether a relation needs to be vacuumed or analyzed; return each into
  * "dovacuum" and "doanalyze", respectively.  Also return whether the vacuum is
- * being forced because of Xid wraparound.
+ * being forced because of Xid wraparound, and into "score" an estimate of how
+ * worthwhile processing the table now would be, used to order the work.
  *
  * relopts is a pointer to the AutoVacOpts options (either for itself in the
  * case of a plain table, or for either itself or its parent table in the case
@@ -2510,7 +2739,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *score)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -2534,6 +2764,9 @@ relation_needs_vacanalyze(Oid relid,
 	int			freeze_max_age;
 	TransactionId xidForceLimit;
 
+	/* priority estimate */
+	double		benefit = 0.0;
+
 	AssertArg(classForm != NULL);
 	AssertArg(OidIsValid(relid));
 
@@ -2574,6 +2807,7 @@ relation_needs_vacanalyze(Oid relid,
 					TransactionIdPrecedes(classForm->relfrozenxid,
 										  xidForceLimit));
 	*wraparound = force_vacuum;
+	*score = 0.0;
 
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!force_vacuum && !av_enabled)
@@ -2604,6 +2838,11 @@ relation_needs_vacanalyze(Oid relid,
 		/* Determine if this table needs vacuum or analyze. */
 		*dovacuum = force_vacuum || (vactuples > vacthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		if (vactuples > vacthresh)
+			benefit += vactuples / Max(vacthresh, 1.0);
+		if (*doanalyze)
+			benefit += anltuples / Max(anlthresh, 1.0);
 	}
 	else
 	{
@@ -2619,6 +2858,28 @@ relation_needs_vacanalyze(Oid relid,
 	/* ANALYZE refuses to work with pg_statistics */
 	if (relid == StatisticRelationId)
 		*doanalyze = false;
+
+	/*
+	 * Estimate the priority of processing this table now.  The benefit is
+	 * how far past its thresholds the table is, plus, when it must be
+	 * frozen, its relfrozenxid age as a fraction of freeze_max_age; this is
+	 * divided by a cost that grows with the logarithm of the table size, so
+	 * that small tables that are bloating quickly are not stuck behind one
+	 * huge table.  But once a table's age has got more than halfway from
+	 * freeze_max_age to the wraparound horizon, size no longer matters.
+	 */
+	if (force_vacuum)
+	{
+		double		age = (int32) (recentXid - classForm->relfrozenxid);
+
+		benefit += age / freeze_max_age;
+		if (age > ((double) freeze_max_age + MaxTransactionId / 2) / 2)
+		{
+			*score = AUTOVAC_EMERGENCY_SCORE + age;
+			return;
+		}
+	}
+	*score = benefit / (1.0 + log10(1.0 + classForm->relpages));
 }
 
 /*
@@ -2693,6 +2954,48 @@ autovac_report_activity(autovac_table *tab)
 	pgstat_report_activity(activity);
 }
 
+/*
+ * autovac_gin_cleanup
+ *		Flush the pending list of a GIN index, if it's long enough to need it.
+ *
+ * Pending list cleanup is safe to run concurrently with insertions and with
+ * other cleanups, so we take the same locks as an inserting backend.  If we
+ * can't get them right away, or the index has gone away, skip it; it will
+ * be looked at again in the next cycle.  The locks are held until the
+ * caller commits.
+ */
+static void
+autovac_gin_cleanup(Oid indexoid)
+{
+	HeapTuple	tuple;
+	Oid			heapoid;
+	Relation	index;
+
+	tuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexoid));
+	if (!HeapTupleIsValid(tuple))
+		return;
+	heapoid = ((Form_pg_index) GETSTRUCT(tuple))->indrelid;
+	ReleaseSysCache(tuple);
+
+	if (!ConditionalLockRelationOid(heapoid, RowExclusiveLock))
+		return;
+	if (!ConditionalLockRelationOid(indexoid, RowExclusiveLock))
+		return;
+
+	/* it might have been dropped before we got the lock */
+	if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(indexoid)))
+		return;
+
+	index = index_open(indexoid, NoLock);
+
+	if (index->rd_rel->relam == GIN_AM_OID &&
+		ginPendingListAutoCleanup(index))
+		elog(DEBUG2, "autovacuum: cleaned up pending list of index \"%s\"",
+			 RelationGetRelationName(index));
+
+	index_close(index, NoLock);
+}
+
 /*
  * AutoVacuumingActive
  *		Check GUC vars and report whether the autovacuum process should be
@@ -112,6 +112,7 @@ static Size fsm_space_cat_to_avail(uint8 cat);
 static int fsm_set_and_search(Relation rel, FSMAddress addr, uint16 slot,
 				   uint8 newValue, uint8 minValue);
 static BlockNumber fsm_search(Relation rel, uint8 min_cat);
+static void fsm_update_upper(Relation rel, FSMAddress addr, uint8 new_cat);
 static uint8 fsm_vacuum_page(Relation rel, FSMAddress addr, bool *eof);
 
 
@@ -192,6 +193,55 @@ RecordPageWithFreeSpace(Relation rel, BlockNumber heapBlk, Size spaceAvail)
 	fsm_set_and_search(rel, addr, slot, new_cat, 0);
 }
 
+/*
+ * RecordNewPagesWithFreeSpace - update info about a range of new pages.
+ *
+ * Like calling RecordPageWithFreeSpace for each of the heap blocks
+ * firstBlk..lastBlk with the same spaceAvail, except that the upper level
+ * pages are updated as well, so that searchers find the space right away.
+ * This is meant for pages just added to the relation in bulk, to hand them
+ * out to other backends.
+ */
+void
+RecordNewPagesWithFreeSpace(Relation rel, BlockNumber firstBlk,
+							BlockNumber lastBlk, Size spaceAvail)
+{
+	int			new_cat = fsm_space_avail_to_cat(spaceAvail);
+	BlockNumber blkno = firstBlk;
+
+	while (blkno <= lastBlk)
+	{
+		FSMAddress	addr;
+		uint16		slot;
+		Buffer		buf;
+		Page		page;
+		bool		dirty = false;
+		uint8		max_avail;
+
+		/* Set all the slots for our blocks on this FSM page */
+		addr = fsm_get_location(blkno, &slot);
+		buf = fsm_readbuf(rel, addr, true);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+
+		do
+		{
+			if (fsm_set_avail(page, slot, new_cat))
+				dirty = true;
+			blkno++;
+			slot++;
+		} while (blkno <= lastBlk && slot < SlotsPerFSMPage);
+
+		if (dirty)
+			MarkBufferDirty(buf);
+		max_avail = fsm_get_max_avail(page);
+		UnlockReleaseBuffer(buf);
+
+		/* And make the upper levels reflect the new space */
+		fsm_update_upper(rel, addr, max_avail);
+	}
+}
+
 /*
  * XLogRecordPageWithFreeSpace - like RecordPageWithFreeSpace, for use in
  *		WAL replay
@@ -724,6 +774,41 @@ fsm_search(Relation rel, uint8 min_cat)
 }
 
 
+/*
+ * Propagate an increase of the maximum free space on FSM page addr, now
+ * new_cat, up the tree.  We stop as soon as an upper level already shows at
+ * least that much, since its ancestors must then, too.
+ */
+static void
+fsm_update_upper(Relation rel, FSMAddress addr, uint8 new_cat)
+{
+	while (addr.level != FSM_ROOT_LEVEL)
+	{
+		FSMAddress	parent;
+		uint16		parentslot;
+		Buffer		buf;
+		Page		page;
+
+		parent = fsm_get_parent(addr, &parentslot);
+		buf = fsm_readbuf(rel, parent, true);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+
+		if (fsm_get_avail(page, parentslot) >= new_cat)
+		{
+			UnlockReleaseBuffer(buf);
+			break;
+		}
+
+		fsm_set_avail(page, parentslot, new_cat);
+		MarkBufferDirty(buf);
+		new_cat = fsm_get_max_avail(page);
+		UnlockReleaseBuffer(buf);
+
+		addr = parent;
+	}
+}
+
 /*
  * Recursive guts of FreeSpaceMapVacuum
  */
@@ -1895,6 +1895,46 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode)
 }
 
 
+/*
+ * LockWaiterCount
+ *
+ * Returns the number of processes currently waiting to acquire the lock
+ * identified by locktag.  This is only a snapshot; the count can change as
+ * soon as we release the partition lock.
+ */
+int
+LockWaiterCount(const LOCKTAG *locktag)
+{
+	LOCKMETHODID lockmethodid = locktag->locktag_lockmethodid;
+	LOCK	   *lock;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+	int			waiters = 0;
+
+	if (lockmethodid <= 0 || lockmethodid >= lengthof(LockMethods))
+		elog(ERROR, "unrecognized lock method: %d", lockmethodid);
+
+	hashcode = LockTagHashCode(locktag);
+	partitionLock = LockHashPartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+
+	lock = (LOCK *) hash_search_with_hash_value(LockMethodLockHash,
+												(void *) locktag,
+												hashcode,
+												HASH_FIND,
+												NULL);
+	if (lock)
+	{
+		Assert(lock->nRequested >= lock->nGranted);
+		waiters = lock->nRequested - lock->nGranted;
+	}
+
+	LWLockRelease(partitionLock);
+
+	return waiters;
+}
+
 /*
  * AtPrepare_Locks
  *		Do the preparatory work for a PREPARE: make 2PC state file records
@@ -0,0 +1,522 @@
+/* ----------
+ * pg_lz4compress.c -
+ *
+ *		This is an implementation of the LZ4 block format for PostgreSQL.
+ *		Compared to pg_lzcompress.c it trades some compression ratio for
+ *		speed: the compressor does a single hash table probe per input
+ *		position, and the decompressor copies whole literal runs and
+ *		matches with memcpy() rather than working a byte at a time.
+ *
+ *		Entry routines:
+ *
+ *			int32
+ *			pg_lz4_compress(const char *source, int32 slen,
+ *							char *dest, int32 dcapacity);
+ *
+ *				source is the input data to be compressed.
+ *
+ *				slen is the length of the input data.
+ *
+ *				dest is the output area for the compressed result.
+ *
+ *				dcapacity is the size of dest.  Compression is abandoned
+ *					as soon as it's clear that the result won't fit.
+ *
+ *				The return value is the length of the compressed data,
+ *				or -1 if it didn't fit in dcapacity bytes; in the latter
+ *				case the contents of dest are undefined.
+ *
+ *			int32
+ *			pg_lz4_decompress(const char *source, int32 slen,
+ *							  char *dest, int32 rawsize);
+ *
+ *				source is the compressed input, slen its length.
+ *
+ *				dest is the area where the uncompressed data will be
+ *					written to.  It must be rawsize bytes long.
+ *
+ *				The return value is the number of bytes written to dest,
+ *				or -1 if the input is corrupt.  The caller should check
+ *				that the result matches the expected raw size.  Unlike
+ *				pglz_decompress(), this never reads or writes outside the
+ *				given buffers, whatever the input.
+ *
+ *			bool
+ *			pg_lz4_decompress_partial(PG_LZ4_DecompressState *state,
+ *									  const char *source, int32 slen,
+ *									  bool complete,
+ *									  char *dest, int32 dlen);
+ *
+ *				Decompresses incrementally, like pglz_decompress_partial():
+ *				state comes from pg_lz4_decompress_init(), the first slen
+ *				bytes of source are available (all of it if complete),
+ *				and output stops once dest holds dlen bytes.  Returns
+ *				false if the input is corrupt.
+ *
+ *		The compression algorithm and internal data format:
+ *
+ *			The compressed data is a sequence of "sequences".  Each one
+ *			starts with a token byte: the high 4 bits give the number of
+ *			literal bytes that follow, the low 4 bits the length of the
+ *			match that follows them, minus 4.  A nibble value of 15 means
+ *			the length continues in the following bytes, each of which is
+ *			added to it, up to and including the first byte that isn't
+ *			255.  After the literal length come the literal bytes
+ *			themselves, then a 2-byte little-endian offset back into the
+ *			output, then the match length continuation bytes, if any.
+ *			The last sequence consists of literals only and ends the data.
+ *
+ *			This is the same layout as the LZ4 block format, and the
+ *			compressor obeys that format's end-of-block rules (the last
+ *			5 bytes are always literals, and no match starts in the last
+ *			12 bytes), so the output can be read by any LZ4 decoder.
+ *
+ *			The compressor hashes the 4 bytes at each position into a
+ *			table that remembers the most recent position with that hash.
+ *			If the remembered position is within reach of a 2-byte offset
+ *			and really starts with the same 4 bytes, it's a match, which
+ *			is then extended as far as it goes.  When no match is found
+ *			for a while, the compressor starts skipping ahead in bigger
+ *			and bigger steps, so that incompressible data costs little.
+ *
+ * Copyright (c) 1999-2010, PostgreSQL Global Development Group
+ *
+ * $PostgreSQL$
+ * ----------
+ */
+#include "postgres.h"
+
+#include "utils/pg_lz4compress.h"
+
+
+/* ----------
+ * Local definitions
+ * ----------
+ */
+#define LZ4_MIN_MATCH			4
+#define LZ4_LAST_LITERALS		5	/* last bytes that are always literals */
+#define LZ4_MF_LIMIT			12	/* no match may start this close to end */
+#define LZ4_MAX_OFFSET			65535
+#define LZ4_HASH_LOG			12
+#define LZ4_HASH_SIZE			(1 << LZ4_HASH_LOG)
+#define LZ4_SKIP_TRIGGER		6	/* log2 of misses before step grows */
+#define LZ4_RUN_MASK			15
+#define LZ4_MAX_LENGTH			0x3FFFFFFF	/* more than any varlena holds */
+
+#define LZ4_HASH(v) \
+	(((uint32) (v) * 2654435761U) >> (32 - LZ4_HASH_LOG))
+
+
+/* ----------
+ * lz4_read32 -
+ *
+ *		Fetch 4 possibly-unaligned bytes.  The byte order doesn't matter,
+ *		since the value is only hashed and compared.
+ * ----------
+ */
+static uint32
+lz4_read32(const unsigned char *p)
+{
+	uint32		v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+
+/* ----------
+ * lz4_match_length -
+ *
+ *		Count how many bytes at ip match those at match, stopping at limit.
+ * ----------
+ */
+static int32
+lz4_match_length(const unsigned char *ip, const unsigned char *match,
+				 const unsigned char *limit)
+{
+	const unsigned char *start = ip;
+
+	while (limit - ip >= (int) sizeof(uint32) &&
+		   lz4_read32(ip) == lz4_read32(match))
+	{
+		ip += sizeof(uint32);
+		match += sizeof(uint32);
+	}
+	while (ip < limit && *ip == *match)
+	{
+		ip++;
+		match++;
+	}
+
+	return ip - start;
+}
+
+
+/* ----------
+ * lz4_put_length -
+ *
+ *		Emit the continuation bytes of a literal or match length whose
+ *		nibble in the token is LZ4_RUN_MASK.
+ * ----------
+ */
+static unsigned char *
+lz4_put_length(unsigned char *op, int32 len)
+{
+	len -= LZ4_RUN_MASK;
+	while (len >= 255)
+	{
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (unsigned char) len;
+
+	return op;
+}
+
+
+/* ----------
+ * pg_lz4_compress -
+ * ----------
+ */
+int32
+pg_lz4_compress(const char *source, int32 slen, char *dest, int32 dcapacity)
+{
+	const unsigned char *base = (const unsigned char *) source;
+	const unsigned char *ip = base;
+	const unsigned char *anchor = base;
+	const unsigned char *iend = base + slen;
+	const unsigned char *mflimit = iend - LZ4_MF_LIMIT;
+	const unsigned char *matchlimit = iend - LZ4_LAST_LITERALS;
+	unsigned char *op = (unsigned char *) dest;
+	unsigned char *oend = op + dcapacity;
+	int32		hashtab[LZ4_HASH_SIZE];
+	int32		litlen;
+
+	if (slen > LZ4_MF_LIMIT)
+	{
+		/*
+		 * Zeroing the table makes every entry point at position 0, which is
+		 * just as good as hashing it; we begin looking at position 1.
+		 */
+		memset(hashtab, 0, sizeof(hashtab));
+		ip++;
+
+		while (ip <= mflimit)
+		{
+			const unsigned char *match;
+			int32		mlen;
+			int32		offset;
+			int			attempts = 1 << LZ4_SKIP_TRIGGER;
+			unsigned char *token;
+
+			/* Find a match, moving ahead faster the longer we fail */
+			for (;;)
+			{
+				uint32		h = LZ4_HASH(lz4_read32(ip));
+
+				match = base + hashtab[h];
+				hashtab[h] = ip - base;
+				if (ip - match <= LZ4_MAX_OFFSET &&
+					lz4_read32(match) == lz4_read32(ip))
+					break;
+				ip += attempts++ >> LZ4_SKIP_TRIGGER;
+				if (ip > mflimit)
+					goto last_literals;
+			}
+
+			/* Extend the match backwards over the pending literals */
+			while (ip > anchor && match > base && ip[-1] == match[-1])
+			{
+				ip--;
+				match--;
+			}
+
+			/* ... and forwards as far as it goes */
+			offset = ip - match;
+			mlen = lz4_match_length(ip + LZ4_MIN_MATCH,
+									match + LZ4_MIN_MATCH,
+									matchlimit);
+			litlen = ip - anchor;
+
+			/* Give up if the sequence won't fit */
+			if (oend - op < 1 + (litlen / 255 + 1) + litlen + 2 + (mlen / 255 + 1))
+				return -1;
+
+			token = op++;
+			*token = (Min(litlen, LZ4_RUN_MASK) << 4) | Min(mlen, LZ4_RUN_MASK);
+			if (litlen >= LZ4_RUN_MASK)
+				op = lz4_put_length(op, litlen);
+			memcpy(op, anchor, litlen);
+			op += litlen;
+
+			*op++ = (unsigned char) (offset & 0xFF);
+			*op++ = (unsigned char) (offset >> 8);
+			if (mlen >= LZ4_RUN_MASK)
+				op = lz4_put_length(op, mlen);
+
+			ip += LZ4_MIN_MATCH + mlen;
+			anchor = ip;
+
+			/* Remember a position inside the match, it's cheap and helps */
+			if (ip <= mflimit)
+				hashtab[LZ4_HASH(lz4_read32(ip - 2))] = ip - 2 - base;
+		}
+	}
+
+last_literals:
+	litlen = iend - anchor;
+	if (oend - op < 1 + (litlen / 255 + 1) + litlen)
+		return -1;
+
+	*op++ = Min(litlen, LZ4_RUN_MASK) << 4;
+	if (litlen >= LZ4_RUN_MASK)
+		op = lz4_put_length(op, litlen);
+	memcpy(op, anchor, litlen);
+	op += litlen;
+
+	return op - (unsigned char *) dest;
+}
+
+
+/* ----------
+ * pg_lz4_decompress -
+ * ----------
+ */
+int32
+pg_lz4_decompress(const char *source, int32 slen, char *dest, int32 rawsize)
+{
+	const unsigned char *ip = (const unsigned char *) source;
+	const unsigned char *iend = ip + slen;
+	unsigned char *op = (unsigned char *) dest;
+	unsigned char *oend = op + rawsize;
+
+	while (ip < iend)
+	{
+		unsigned char token = *ip++;
+		int32		len;
+		int32		offset;
+		const unsigned char *match;
+
+		/* Literal run */
+		len = token >> 4;
+		if (len == LZ4_RUN_MASK)
+		{
+			unsigned char b;
+
+			do
+			{
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+				if (len > rawsize)
+					return -1;
+			} while (b == 255);
+		}
+		if (len > iend - ip || len > oend - op)
+			return -1;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* The last sequence has no match part */
+		if (ip >= iend)
+			break;
+
+		/* Match */
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op - (unsigned char *) dest)
+			return -1;
+		match = op - offset;
+
+		len = token & LZ4_RUN_MASK;
+		if (len == LZ4_RUN_MASK)
+		{
+			unsigned char b;
+
+			do
+			{
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+				if (len > rawsize)
+					return -1;
+			} while (b == 255);
+		}
+		len += LZ4_MIN_MATCH;
+		if (len > oend - op)
+			return -1;
+
+		if (offset >= len)
+		{
+			memcpy(op, match, len);
+			op += len;
+		}
+		else
+		{
+			/* Overlapping copy, it repeats the last offset bytes */
+			while (len-- > 0)
+				*op++ = *match++;
+		}
+	}
+
+	return op - (unsigned char *) dest;
+}
+
+
+/* ----------
+ * lz4_get_length -
+ *
+ *		Read the continuation bytes of a length whose nibble was
+ *		LZ4_RUN_MASK, adding them to *len.  Returns the position after
+ *		them, or NULL if they run past iend or the length is absurd.
+ * ----------
+ */
+static const unsigned char *
+lz4_get_length(const unsigned char *ip, const unsigned char *iend, int32 *len)
+{
+	unsigned char b;
+
+	do
+	{
+		if (ip >= iend)
+			return NULL;
+		b = *ip++;
+		*len += b;
+		if (*len > LZ4_MAX_LENGTH)
+			return NULL;
+	} while (b == 255);
+
+	return ip;
+}
+
+
+/* ----------
+ * pg_lz4_decompress_init -
+ * ----------
+ */
+void
+pg_lz4_decompress_init(PG_LZ4_DecompressState *state)
+{
+	memset(state, 0, sizeof(PG_LZ4_DecompressState));
+}
+
+
+/* ----------
+ * pg_lz4_decompress_partial -
+ *
+ *		A sequence is only started once its token and literal length are
+ *		all available, and its match once the offset and match length are;
+ *		the literal bytes and the match itself can be copied piecemeal.
+ *		So when the input isn't complete, running out of it in the middle
+ *		of those headers just means stopping until there's more.
+ * ----------
+ */
+bool
+pg_lz4_decompress_partial(PG_LZ4_DecompressState *state,
+						  const char *source, int32 slen, bool complete,
+						  char *dest, int32 dlen)
+{
+	const unsigned char *ip = (const unsigned char *) source + state->srcpos;
+	const unsigned char *iend = (const unsigned char *) source + slen;
+	unsigned char *op = (unsigned char *) dest + state->dstpos;
+	unsigned char *oend = (unsigned char *) dest + dlen;
+	bool		result = true;
+
+	while (op < oend)
+	{
+		if (state->matchlen > 0)
+		{
+			/* Copy (more of) the current match */
+			int32		len = Min(state->matchlen, oend - op);
+			const unsigned char *match = op - state->matchoff;
+
+			state->matchlen -= len;
+			while (len-- > 0)
+				*op++ = *match++;
+		}
+		else if (!state->inseq)
+		{
+			/* Start a new sequence with its token and literal length */
+			const unsigned char *p = ip;
+			int32		len;
+
+			if (p >= iend)
+			{
+				if (complete)
+					result = false;
+				break;
+			}
+			state->token = *p++;
+			len = state->token >> 4;
+			if (len == LZ4_RUN_MASK &&
+				(p = lz4_get_length(p, iend, &len)) == NULL)
+			{
+				if (complete || len > LZ4_MAX_LENGTH)
+					result = false;
+				break;
+			}
+			ip = p;
+			state->litlen = len;
+			state->inseq = true;
+		}
+		else if (state->litlen > 0)
+		{
+			/* Copy as many of the literal bytes as we have and want */
+			int32		len = Min(state->litlen, Min(iend - ip, oend - op));
+
+			if (len == 0)
+			{
+				if (complete)
+					result = false;
+				break;
+			}
+			memcpy(op, ip, len);
+			op += len;
+			ip += len;
+			state->litlen -= len;
+		}
+		else
+		{
+			/* Literals done; the last sequence has no match part */
+			const unsigned char *p = ip;
+			int32		offset;
+			int32		len;
+
+			if (iend - p < 2)
+			{
+				if (complete && p != iend)
+					result = false;
+				break;
+			}
+			offset = p[0] | (p[1] << 8);
+			p += 2;
+			len = state->token & LZ4_RUN_MASK;
+			if (len == LZ4_RUN_MASK &&
+				(p = lz4_get_length(p, iend, &len)) == NULL)
+			{
+				if (complete || len > LZ4_MAX_LENGTH)
+					result = false;
+				break;
+			}
+			if (offset == 0 || offset > op - (unsigned char *) dest)
+			{
+				result = false;
+				break;
+			}
+			ip = p;
+			state->matchlen = len + LZ4_MIN_MATCH;
+			state->matchoff = offset;
+			state->inseq = false;
+		}
+	}
+
+	state->srcpos = ip - (const unsigned char *) source;
+	state->dstpos = op - (unsigned char *) dest;
+
+	return result;
+}
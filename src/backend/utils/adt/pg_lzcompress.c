@@ -40,6 +40,30 @@
  *					The data is written to buff exactly as it was handed
  *					to pglz_compress(). No terminating zero byte is added.
  *
+ *			void
+ *			pglz_decompress_partial(PGLZ_DecompressState *state,
+ *									const char *source, int32 slen,
+ *									bool complete, char *dest, int32 dlen)
+ *
+ *				Decompresses incrementally.  state must have been set up
+ *				with pglz_decompress_init(), and remembers how far a
+ *				previous call got.
+ *
+ *				source is the compressed data following the PGLZ_Header,
+ *					of which the first slen bytes are available.  complete
+ *					says whether that is all of it; if not, decompression
+ *					stops early rather than reading an item that might be
+ *					cut off, and can be resumed when more is available.
+ *
+ *				dest is the start of the output area, which must keep
+ *					its contents between calls since later data can
+ *					refer back to it.  Output stops when dlen bytes of it
+ *					have been produced, even in the middle of an item.
+ *
+ *				On return state->dstpos says how much output there is.
+ *				This is the building block for decompressing only a
+ *				prefix of a value, and for detoasting it piecemeal.
+ *
  *		The decompression algorithm and internal data format:
  *
  *			PGLZ_Header is defined as
@@ -740,3 +764,112 @@ pglz_decompress(const PGLZ_Header *source, char *dest)
 	 * That's it.
 	 */
 }
+
+
+/* ----------
+ * pglz_decompress_init -
+ *
+ *		Prepare to decompress a value with pglz_decompress_partial().
+ * ----------
+ */
+void
+pglz_decompress_init(PGLZ_DecompressState *state)
+{
+	memset(state, 0, sizeof(PGLZ_DecompressState));
+}
+
+
+/* ----------
+ * pglz_decompress_partial -
+ *
+ *		Decompresses the next part of source into dest.
+ * ----------
+ */
+void
+pglz_decompress_partial(PGLZ_DecompressState *state,
+						const char *source, int32 slen, bool complete,
+						char *dest, int32 dlen)
+{
+	const unsigned char *sp;
+	const unsigned char *srcend;
+	unsigned char *dp;
+	unsigned char *destend;
+
+	sp = ((const unsigned char *) source) + state->srcpos;
+	srcend = ((const unsigned char *) source) + slen;
+	dp = ((unsigned char *) dest) + state->dstpos;
+	destend = ((unsigned char *) dest) + dlen;
+
+	while (dp < destend)
+	{
+		/*
+		 * First finish any match that the previous call had to cut short.
+		 */
+		if (state->matchlen > 0)
+		{
+			int32		len = Min(state->matchlen, destend - dp);
+
+			state->matchlen -= len;
+			while (len--)
+			{
+				*dp = dp[-state->matchoff];
+				dp++;
+			}
+			continue;
+		}
+
+		/*
+		 * Read a new control byte when the last one's 8 items are done.
+		 */
+		if (state->ctrlc == 0)
+		{
+			if (sp >= srcend)
+				break;
+			state->ctrl = *sp++;
+			state->ctrlc = 8;
+		}
+
+		if (state->ctrl & 1)
+		{
+			int32		len;
+			int32		off;
+
+			/*
+			 * A tag is two bytes long, three if the length is extended.  If
+			 * it isn't all there yet, wait for more input.
+			 */
+			if (srcend - sp < 2 || ((sp[0] & 0x0f) == 0x0f && srcend - sp < 3))
+			{
+				if (complete)
+					elog(ERROR, "compressed data is corrupt");
+				break;
+			}
+
+			len = (sp[0] & 0x0f) + 3;
+			off = ((sp[0] & 0xf0) << 4) | sp[1];
+			sp += 2;
+			if (len == 18)
+				len += *sp++;
+
+			if (off == 0 || off > dp - (unsigned char *) dest)
+				elog(ERROR, "compressed data is corrupt");
+
+			/* The bytes are copied at the top of the loop */
+			state->matchlen = len;
+			state->matchoff = off;
+		}
+		else
+		{
+			/* Literal byte, unless we've reached the end of the input */
+			if (sp >= srcend)
+				break;
+			*dp++ = *sp++;
+		}
+
+		state->ctrl >>= 1;
+		state->ctrlc--;
+	}
+
+	state->srcpos = sp - (const unsigned char *) source;
+	state->dstpos = dp - (unsigned char *) dest;
+}
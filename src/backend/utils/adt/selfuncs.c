@@ -6235,6 +6235,117 @@ gistcostestimate(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+Datum
+spgcostestimate(PG_FUNCTION_ARGS)
+{
+	PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+	IndexOptInfo *index = (IndexOptInfo *) PG_GETARG_POINTER(1);
+	List	   *indexQuals = (List *) PG_GETARG_POINTER(2);
+	RelOptInfo *outer_rel = (RelOptInfo *) PG_GETARG_POINTER(3);
+	Cost	   *indexStartupCost = (Cost *) PG_GETARG_POINTER(4);
+	Cost	   *indexTotalCost = (Cost *) PG_GETARG_POINTER(5);
+	Selectivity *indexSelectivity = (Selectivity *) PG_GETARG_POINTER(6);
+	double	   *indexCorrelation = (double *) PG_GETARG_POINTER(7);
+
+	genericcostestimate(root, index, indexQuals, outer_rel, 0.0,
+						indexStartupCost, indexTotalCost,
+						indexSelectivity, indexCorrelation);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * BRIN has to read the whole index for any search, and it returns every
+ * heap page of each block range whose summary matches, so how many heap
+ * pages a search returns depends on how well the leading column's values
+ * follow the physical order of the table.  We use the column's correlation
+ * statistic to scale the selectivity between the estimate for the quals
+ * (perfectly correlated) and 1.0 (not correlated at all).
+ */
+Datum
+brincostestimate(PG_FUNCTION_ARGS)
+{
+	PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+	IndexOptInfo *index = (IndexOptInfo *) PG_GETARG_POINTER(1);
+	List	   *indexQuals = (List *) PG_GETARG_POINTER(2);
+	RelOptInfo *outer_rel = (RelOptInfo *) PG_GETARG_POINTER(3);
+	Cost	   *indexStartupCost = (Cost *) PG_GETARG_POINTER(4);
+	Cost	   *indexTotalCost = (Cost *) PG_GETARG_POINTER(5);
+	Selectivity *indexSelectivity = (Selectivity *) PG_GETARG_POINTER(6);
+	double	   *indexCorrelation = (double *) PG_GETARG_POINTER(7);
+	double		spc_seq_page_cost;
+	double		varCorrelation = 0.0;
+	VariableStatData vardata;
+
+	genericcostestimate(root, index, indexQuals, outer_rel, 0.0,
+						indexStartupCost, indexTotalCost,
+						indexSelectivity, indexCorrelation);
+
+	/* All of the index is read, sequentially, before anything is returned */
+	get_tablespace_page_costs(index->reltablespace,
+							  NULL,
+							  &spc_seq_page_cost);
+	*indexStartupCost += index->pages * spc_seq_page_cost;
+	*indexTotalCost += index->pages * spc_seq_page_cost;
+
+	MemSet(&vardata, 0, sizeof(vardata));
+
+	if (index->indexkeys[0] != 0)
+	{
+		/* Simple variable --- look to stats for the underlying table */
+		RangeTblEntry *rte = planner_rt_fetch(index->rel->relid, root);
+		AttrNumber	colnum = index->indexkeys[0];
+
+		Assert(rte->rtekind == RTE_RELATION);
+
+		if (get_relation_stats_hook &&
+			(*get_relation_stats_hook) (root, rte, colnum, &vardata))
+		{
+			/*
+			 * The hook took control of acquiring a stats tuple.  If it did
+			 * supply a tuple, it'd better have supplied a freefunc.
+			 */
+			if (HeapTupleIsValid(vardata.statsTuple) &&
+				!vardata.freefunc)
+				elog(ERROR, "no function provided to release variable stats with");
+		}
+		else
+		{
+			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
+												 ObjectIdGetDatum(rte->relid),
+												 Int16GetDatum(colnum),
+												 BoolGetDatum(rte->inh));
+			vardata.freefunc = ReleaseSysCache;
+		}
+	}
+
+	if (HeapTupleIsValid(vardata.statsTuple))
+	{
+		float4	   *numbers;
+		int			nnumbers;
+
+		if (get_attstatsslot(vardata.statsTuple, InvalidOid, 0,
+							 STATISTIC_KIND_CORRELATION,
+							 InvalidOid,
+							 NULL,
+							 NULL, NULL,
+							 &numbers, &nnumbers))
+		{
+			Assert(nnumbers == 1);
+			varCorrelation = fabs(numbers[0]);
+
+			free_attstatsslot(InvalidOid, NULL, 0, numbers, nnumbers);
+		}
+	}
+
+	ReleaseVariableStats(vardata);
+
+	*indexSelectivity += (1.0 - *indexSelectivity) * (1.0 - varCorrelation);
+	*indexCorrelation = 0.0;
+
+	PG_RETURN_VOID();
+}
+
 Datum
 gincostestimate(PG_FUNCTION_ARGS)
 {
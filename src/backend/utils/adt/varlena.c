@@ -753,36 +753,23 @@ text_substring(Datum str, int32 start, int32 length, bool length_not_specified)
 	else if (eml > 1)
 	{
 		/*
-		 * When encoding max length is > 1, we can't get LC without
-		 * detoasting, so we'll grab a conservatively large slice now and go
-		 * back later to do the right thing
+		 * When encoding max length is > 1, we can't know which byte offsets
+		 * the start and end positions correspond to without counting
+		 * characters from the start of the string.  So detoast it bit by bit
+		 * as we count, and stop once we reach the end position.
 		 */
-		int32		slice_start;
-		int32		slice_size;
-		int32		slice_strlen;
-		text	   *slice;
-		int32		E1;
+		DetoastIterator iter;
+		int32		E1;			/* end position, not included */
 		int32		i;
-		char	   *p;
-		char	   *s;
+		int32		startpos;	/* byte offsets of the substring */
+		int32		endpos;
 		text	   *ret;
 
-		/*
-		 * if S is past the end of the string, the tuple toaster will return a
-		 * zero-length string to us
-		 */
 		S1 = Max(S, 1);
 
-		/*
-		 * We need to start at position zero because there is no way to know
-		 * in advance which byte offset corresponds to the supplied start
-		 * position.
-		 */
-		slice_start = 0;
-
 		if (length_not_specified)		/* special case - get length to end of
 										 * string */
-			slice_size = L1 = -1;
+			E1 = -1;
 		else
 		{
 			int			E = S + length;
@@ -804,84 +791,46 @@ text_substring(Datum str, int32 start, int32 length, bool length_not_specified)
 			if (E < 1)
 				return cstring_to_text("");
 
-			/*
-			 * if E is past the end of the string, the tuple toaster will
-			 * truncate the length for us
-			 */
-			L1 = E - S1;
-
-			/*
-			 * Total slice size in bytes can't be any longer than the start
-			 * position plus substring length times the encoding max length.
-			 */
-			slice_size = (S1 + L1) * eml;
+			E1 = E;
 		}
 
-		/*
-		 * If we're working with an untoasted source, no need to do an extra
-		 * copying step.
-		 */
-		if (VARATT_IS_COMPRESSED(DatumGetPointer(str)) ||
-			VARATT_IS_EXTERNAL(DatumGetPointer(str)))
-			slice = DatumGetTextPSlice(str, slice_start, slice_size);
-		else
-			slice = (text *) DatumGetPointer(str);
-
-		/* see if we got back an empty string */
-		if (VARSIZE_ANY_EXHDR(slice) == 0)
-		{
-			if (slice != (text *) DatumGetPointer(str))
-				pfree(slice);
-			return cstring_to_text("");
-		}
-
-		/* Now we can get the actual length of the slice in MB characters */
-		slice_strlen = pg_mbstrlen_with_len(VARDATA_ANY(slice),
-											VARSIZE_ANY_EXHDR(slice));
+		iter = detoast_begin_iterate((struct varlena *) DatumGetPointer(str));
 
 		/*
-		 * Check that the start position wasn't > slice_strlen. If so, SQL99
-		 * says to return a zero-length string.
+		 * Find the start position; remember S1 is one based.  If it's past
+		 * the end of the string, we get a zero-length result, as SQL99 says.
 		 */
-		if (S1 > slice_strlen)
+		startpos = 0;
+		for (i = 1; i < S1 && startpos < iter->rawsize; i++)
 		{
-			if (slice != (text *) DatumGetPointer(str))
-				pfree(slice);
-			return cstring_to_text("");
+			detoast_iterate(iter, startpos + 1);
+			startpos += pg_mblen(iter->buf + startpos);
 		}
 
-		/*
-		 * Adjust L1 and E1 now that we know the slice string length. Again
-		 * remember that S1 is one based, and slice_start is zero based.
-		 */
-		if (L1 > -1)
-			E1 = Min(S1 + L1, slice_start + 1 + slice_strlen);
+		/* Likewise the end position, which may be past the end too */
+		if (E1 < 0)
+			endpos = iter->rawsize;
 		else
-			E1 = slice_start + 1 + slice_strlen;
-
-		/*
-		 * Find the start position in the slice; remember S1 is not zero based
-		 */
-		p = VARDATA_ANY(slice);
-		for (i = 0; i < S1 - 1; i++)
-			p += pg_mblen(p);
+		{
+			endpos = startpos;
+			for (; i < E1 && endpos < iter->rawsize; i++)
+			{
+				detoast_iterate(iter, endpos + 1);
+				endpos += pg_mblen(iter->buf + endpos);
+			}
+		}
 
-		/* hang onto a pointer to our start position */
-		s = p;
+		/* don't trust a truncated character at the very end */
+		startpos = Min(startpos, iter->rawsize);
+		endpos = Min(endpos, iter->rawsize);
 
-		/*
-		 * Count the actual bytes used by the substring of the requested
-		 * length.
-		 */
-		for (i = S1; i < E1; i++)
-			p += pg_mblen(p);
+		detoast_iterate(iter, endpos);
 
-		ret = (text *) palloc(VARHDRSZ + (p - s));
-		SET_VARSIZE(ret, VARHDRSZ + (p - s));
-		memcpy(VARDATA(ret), s, (p - s));
+		ret = (text *) palloc(VARHDRSZ + (endpos - startpos));
+		SET_VARSIZE(ret, VARHDRSZ + (endpos - startpos));
+		memcpy(VARDATA(ret), iter->buf + startpos, endpos - startpos);
 
-		if (slice != (text *) DatumGetPointer(str))
-			pfree(slice);
+		detoast_end_iterate(iter);
 
 		return ret;
 	}
@@ -1979,12 +1928,14 @@ byteapos(PG_FUNCTION_ARGS)
 Datum
 byteaGetByte(PG_FUNCTION_ARGS)
 {
-	bytea	   *v = PG_GETARG_BYTEA_PP(0);
+	DetoastIterator iter;
 	int32		n = PG_GETARG_INT32(1);
 	int			len;
 	int byte;
 
-	len = VARSIZE_ANY_EXHDR(v);
+	/* Detoast only as far as the byte we want */
+	iter = detoast_begin_iterate((struct varlena *) PG_GETARG_POINTER(0));
+	len = iter->rawsize;
 
 	if (n < 0 || n >= len)
 		ereport(ERROR,
@@ -1992,7 +1943,10 @@ byteaGetByte(PG_FUNCTION_ARGS)
 				 errmsg("index %d out of valid range, 0..%d",
 						n, len - 1)));
 
-	byte = ((unsigned char *) VARDATA_ANY(v))[n];
+	detoast_iterate(iter, n + 1);
+	byte = ((unsigned char *) iter->buf)[n];
+
+	detoast_end_iterate(iter);
 
 	PG_RETURN_INT32(byte);
 }
@@ -2008,14 +1962,16 @@ byteaGetByte(PG_FUNCTION_ARGS)
 Datum
 byteaGetBit(PG_FUNCTION_ARGS)
 {
-	bytea	   *v = PG_GETARG_BYTEA_PP(0);
+	DetoastIterator iter;
 	int32		n = PG_GETARG_INT32(1);
 	int			byteNo,
 				bitNo;
 	int			len;
 	int byte;
 
-	len = VARSIZE_ANY_EXHDR(v);
+	/* Detoast only as far as the byte we want */
+	iter = detoast_begin_iterate((struct varlena *) PG_GETARG_POINTER(0));
+	len = iter->rawsize;
 
 	if (n < 0 || n >= len * 8)
 		ereport(ERROR,
@@ -2026,7 +1982,10 @@ byteaGetBit(PG_FUNCTION_ARGS)
 	byteNo = n / 8;
 	bitNo = n % 8;
 
-	byte = ((unsigned char *) VARDATA_ANY(v))[byteNo];
+	detoast_iterate(iter, byteNo + 1);
+	byte = ((unsigned char *) iter->buf)[byteNo];
+
+	detoast_end_iterate(iter);
 
 	if (byte &(1 << bitNo))
 		PG_RETURN_INT32(1);
@@ -1817,6 +1817,7 @@ RelationDestroyRelation(Relation relation)
 		FreeTupleDesc(relation->rd_att);
 	list_free(relation->rd_indexlist);
 	bms_free(relation->rd_indexattr);
+	bms_free(relation->rd_summarizedattr);
 	FreeTriggerDesc(relation->trigdesc);
 	if (relation->rd_options)
 		pfree(relation->rd_options);
@@ -3442,7 +3443,8 @@ insert_ordered_oid(List *list, Oid datum)
  *
  * It is up to the caller to make sure the given list is correctly ordered.
  *
- * We deliberately do not change rd_indexattr here: even when operating
+ * We deliberately do not change rd_indexattr (nor rd_summarizedattr) here:
+ * even when operating
  * with a temporary partial index list, HOT-update decisions must be made
  * correctly with respect to the full index set.  It is up to the caller
  * to ensure that a correct rd_indexattr set has been cached before first
@@ -3641,9 +3643,17 @@ RelationGetIndexPredicate(Relation relation)
  * RelationGetIndexAttrBitmap -- get a bitmap of index attribute numbers
  *
  * The result has a bit set for each attribute used anywhere in the index
- * definitions of all the indexes on this relation.  (This includes not only
- * simple index keys, but attributes used in expressions and partial-index
- * predicates.)
+ * definitions of the indexes on this relation, of the kind requested:
+ *
+ *	INDEX_ATTR_BITMAP_HOT_BLOCKING: the indexes that point to individual
+ *		tuples, ie all but summarizing ones.  Changing any of these columns
+ *		means an update can't be HOT.
+ *	INDEX_ATTR_BITMAP_SUMMARIZED: the summarizing indexes (see amsummarizing
+ *		in pg_am).  A HOT update that changes any of these columns must
+ *		still be reported to those indexes.
+ *
+ * (This includes not only simple index keys, but attributes used in
+ * expressions and partial-index predicates.)
  *
  * Attribute numbers are offset by FirstLowInvalidHeapAttributeNumber so that
  * we can include system attributes (e.g., OID) in the bitmap representation.
@@ -3652,16 +3662,27 @@ RelationGetIndexPredicate(Relation relation)
  * be bms_free'd when not needed anymore.
  */
 Bitmapset *
-RelationGetIndexAttrBitmap(Relation relation)
+RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 {
 	Bitmapset  *indexattrs;
+	Bitmapset  *summarizedattrs;
 	List	   *indexoidlist;
 	ListCell   *l;
 	MemoryContext oldcxt;
 
 	/* Quick exit if we already computed the result. */
-	if (relation->rd_indexattr != NULL)
-		return bms_copy(relation->rd_indexattr);
+	if (relation->rd_indexattr != NULL || relation->rd_summarizedattr != NULL)
+	{
+		switch (attrKind)
+		{
+			case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+				return bms_copy(relation->rd_indexattr);
+			case INDEX_ATTR_BITMAP_SUMMARIZED:
+				return bms_copy(relation->rd_summarizedattr);
+			default:
+				elog(ERROR, "unknown attrKind %u", attrKind);
+		}
+	}
 
 	/* Fast path if definitely no indexes */
 	if (!RelationGetForm(relation)->relhasindex)
@@ -3677,14 +3698,17 @@ RelationGetIndexAttrBitmap(Relation relation)
 		return NULL;
 
 	/*
-	 * For each index, add referenced attributes to indexattrs.
+	 * For each index, add referenced attributes to indexattrs, or to
+	 * summarizedattrs for a summarizing index.
 	 */
 	indexattrs = NULL;
+	summarizedattrs = NULL;
 	foreach(l, indexoidlist)
 	{
 		Oid			indexOid = lfirst_oid(l);
 		Relation	indexDesc;
 		IndexInfo  *indexInfo;
+		Bitmapset **attrs;
 		int			i;
 
 		indexDesc = index_open(indexOid, AccessShareLock);
@@ -3692,34 +3716,57 @@ RelationGetIndexAttrBitmap(Relation relation)
 		/* Extract index key information from the index's pg_index row */
 		indexInfo = BuildIndexInfo(indexDesc);
 
+		if (indexDesc->rd_am->amsummarizing)
+			attrs = &summarizedattrs;
+		else
+			attrs = &indexattrs;
+
 		/* Collect simple attribute references */
 		for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
 		{
 			int			attrnum = indexInfo->ii_KeyAttrNumbers[i];
 
 			if (attrnum != 0)
-				indexattrs = bms_add_member(indexattrs,
+				*attrs = bms_add_member(*attrs,
 							   attrnum - FirstLowInvalidHeapAttributeNumber);
 		}
 
 		/* Collect all attributes used in expressions, too */
-		pull_varattnos((Node *) indexInfo->ii_Expressions, &indexattrs);
+		pull_varattnos((Node *) indexInfo->ii_Expressions, attrs);
 
 		/* Collect all attributes in the index predicate, too */
-		pull_varattnos((Node *) indexInfo->ii_Predicate, &indexattrs);
+		pull_varattnos((Node *) indexInfo->ii_Predicate, attrs);
 
 		index_close(indexDesc, AccessShareLock);
 	}
 
 	list_free(indexoidlist);
 
-	/* Now save a copy of the bitmap in the relcache entry. */
+	/*
+	 * A column used by both kinds of index blocks HOT anyway, so there's no
+	 * need to treat it as summarized.
+	 */
+	summarizedattrs = bms_del_members(summarizedattrs, indexattrs);
+
+	/* Now save copies of the bitmaps in the relcache entry. */
 	oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
 	relation->rd_indexattr = bms_copy(indexattrs);
+	relation->rd_summarizedattr = bms_copy(summarizedattrs);
 	MemoryContextSwitchTo(oldcxt);
 
 	/* We return our original working copy for caller to play with */
-	return indexattrs;
+	switch (attrKind)
+	{
+		case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+			bms_free(summarizedattrs);
+			return indexattrs;
+		case INDEX_ATTR_BITMAP_SUMMARIZED:
+			bms_free(indexattrs);
+			return summarizedattrs;
+		default:
+			elog(ERROR, "unknown attrKind %u", attrKind);
+			return NULL;
+	}
 }
 
 /*
@@ -4183,6 +4230,7 @@ load_relcache_init_file(bool shared)
 		rel->rd_indexvalid = 0;
 		rel->rd_indexlist = NIL;
 		rel->rd_indexattr = NULL;
+		rel->rd_summarizedattr = NULL;
 		rel->rd_oidindex = InvalidOid;
 		rel->rd_createSubid = InvalidSubTransactionId;
 		rel->rd_newRelfilenodeSubid = InvalidSubTransactionId;
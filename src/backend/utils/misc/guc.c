@@ -27,7 +27,9 @@
 #endif
 
 #include "access/gin.h"
+#include "access/heapam.h"
 #include "access/transam.h"
+#include "access/tuptoaster.h"
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
@@ -204,6 +206,12 @@ static const struct config_enum_entry bytea_output_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry toast_compression_options[] = {
+	{"pglz", TOAST_PGLZ_COMPRESSION, false},
+	{"lz4", TOAST_LZ4_COMPRESSION, false},
+	{NULL, 0, false}
+};
+
 /*
  * We have different sets for client and server message level options because
  * they sort slightly different (see "log" level)
@@ -659,6 +667,14 @@ static struct config_bool ConfigureNamesBool[] =
 		&enable_sort,
 		true, NULL, NULL
 	},
+	{
+		{"enable_incrementalsort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of incremental sort steps."),
+			NULL
+		},
+		&enable_incrementalsort,
+		true, NULL, NULL
+	},
 	{
 		{"enable_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of hashed aggregation plans."),
@@ -675,6 +691,14 @@ static struct config_bool ConfigureNamesBool[] =
 		&enable_material,
 		true, NULL, NULL
 	},
+	{
+		{"enable_memoize", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of memoization of nested-loop inner scans."),
+			NULL
+		},
+		&enable_memoize,
+		true, NULL, NULL
+	},
 	{
 		{"enable_nestloop", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of nested-loop join plans."),
@@ -699,6 +723,22 @@ static struct config_bool ConfigureNamesBool[] =
 		&enable_hashjoin,
 		true, NULL, NULL
 	},
+	{
+		{"enable_partitionwise_join", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of partition-wise join plans."),
+			NULL
+		},
+		&enable_partitionwise_join,
+		false, NULL, NULL
+	},
+	{
+		{"enable_partitionwise_aggregate", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of partition-wise grouping plans."),
+			NULL
+		},
+		&enable_partitionwise_aggregate,
+		false, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -1665,6 +1705,15 @@ static struct config_int ConfigureNamesInt[] =
 		50000000, 0, 1000000000, NULL, NULL
 	},
 
+	{
+		{"prune_freeze_min_age", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Minimum age at which page pruning should freeze a page's rows."),
+			gettext_noop("-1 disables freezing during pruning.")
+		},
+		&prune_freeze_min_age,
+		50000000, -1, 1000000000, NULL, NULL
+	},
+
 	{
 		{"vacuum_freeze_table_age", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Age at which VACUUM should scan whole table to freeze tuples."),
@@ -2080,6 +2129,18 @@ static struct config_int ConfigureNamesInt[] =
 		0, 0, INT_MAX, NULL, NULL
 	},
 
+	{
+		{"gin_pending_list_limit", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the size of a GIN pending list at which it is cleaned up."),
+			gettext_noop("Autovacuum moves a pending list this large into the main "
+						 "index structure; once a list is four times this large, "
+						 "new entries bypass it."),
+			GUC_UNIT_KB
+		},
+		&gin_pending_list_limit,
+		4096, 64, MAX_KILOBYTES, NULL, NULL
+	},
+
 	{
 		{"effective_cache_size", PGC_USERSET, QUERY_TUNING_COST,
 			gettext_noop("Sets the planner's assumption about the size of the disk cache."),
@@ -2729,6 +2790,15 @@ static struct config_enum ConfigureNamesEnum[] =
 		BYTEA_OUTPUT_HEX, bytea_output_options, NULL, NULL
 	},
 
+	{
+		{"default_toast_compression", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the default compression method for compressible values."),
+			gettext_noop("Columns with a \"compression\" option use that method instead.")
+		},
+		&default_toast_compression,
+		TOAST_PGLZ_COMPRESSION, toast_compression_options, NULL, NULL
+	},
+
 	{
 		{"client_min_messages", PGC_USERSET, LOGGING_WHEN,
 			gettext_noop("Sets the message levels that are sent to the client."),
@@ -461,6 +461,15 @@ static void readtup_index(Tuplesortstate *state, SortTuple *stup,
 			  int tapenum, unsigned int len);
 static void reversedirection_index_btree(Tuplesortstate *state);
 static void reversedirection_index_hash(Tuplesortstate *state);
+static int comparetup_index_gist(const SortTuple *a, const SortTuple *b,
+					  Tuplesortstate *state);
+static void copytup_index_gist(Tuplesortstate *state, SortTuple *stup,
+				   void *tup);
+static void writetup_index_gist(Tuplesortstate *state, int tapenum,
+					SortTuple *stup);
+static void readtup_index_gist(Tuplesortstate *state, SortTuple *stup,
+				   int tapenum, unsigned int len);
+static void reversedirection_index_gist(Tuplesortstate *state);
 static int comparetup_datum(const SortTuple *a, const SortTuple *b,
 				 Tuplesortstate *state);
 static void copytup_datum(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -703,6 +712,37 @@ tuplesort_begin_index_hash(Relation indexRel,
 	return state;
 }
 
+Tuplesortstate *
+tuplesort_begin_index_gist(Relation indexRel,
+						   int workMem, bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, randomAccess);
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: gist, workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = 1;			/* Only one sort column, the sort key */
+
+	state->comparetup = comparetup_index_gist;
+	state->copytup = copytup_index_gist;
+	state->writetup = writetup_index_gist;
+	state->readtup = readtup_index_gist;
+	state->reversedirection = reversedirection_index_gist;
+
+	state->indexRel = indexRel;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_datum(Oid datumType,
 					  Oid sortOperator, bool nullsFirstFlag,
@@ -945,6 +985,42 @@ tuplesort_putindextuple(Tuplesortstate *state, IndexTuple tuple)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Accept one index tuple and its sort key while collecting input data for
+ * a GiST index sort.
+ *
+ * The sort key is stored just after the tuple, in the same palloc chunk, so
+ * that it's carried along to tape and back with the tuple.  datum1 points
+ * at it; we can't store it in datum1 directly, since int64 may not fit in a
+ * Datum.
+ */
+void
+tuplesort_putgisttuple(Tuplesortstate *state, IndexTuple tuple, int64 sortkey)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->sortcontext);
+	SortTuple	stup;
+	unsigned int tuplen = IndexTupleSize(tuple);
+	IndexTuple	newtuple;
+	int64	   *keyptr;
+
+	Assert(state->comparetup == comparetup_index_gist);
+
+	/* copy the tuple and key into sort storage */
+	newtuple = (IndexTuple) palloc(MAXALIGN(tuplen) + sizeof(int64));
+	memcpy(newtuple, tuple, tuplen);
+	keyptr = (int64 *) ((char *) newtuple + MAXALIGN(tuplen));
+	*keyptr = sortkey;
+	USEMEM(state, GetMemoryChunkSpace(newtuple));
+
+	stup.tuple = (void *) newtuple;
+	stup.datum1 = PointerGetDatum(keyptr);
+	stup.isnull1 = false;
+
+	puttuple_common(state, &stup);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
 /*
  * Accept one Datum while collecting input data for sort.
  *
@@ -2967,6 +3043,112 @@ reversedirection_index_hash(Tuplesortstate *state)
 	elog(ERROR, "reversedirection_index_hash is not implemented");
 }
 
+/*
+ * Routines specialized for the GiST index case.  The tuples are stored
+ * followed by their sort key; see tuplesort_putgisttuple.
+ */
+
+static int
+comparetup_index_gist(const SortTuple *a, const SortTuple *b,
+					  Tuplesortstate *state)
+{
+	int64		key1;
+	int64		key2;
+	IndexTuple	tuple1;
+	IndexTuple	tuple2;
+
+	/* Allow interrupting long sorts */
+	CHECK_FOR_INTERRUPTS();
+
+	key1 = *((int64 *) DatumGetPointer(a->datum1));
+	key2 = *((int64 *) DatumGetPointer(b->datum1));
+
+	if (key1 > key2)
+		return 1;
+	else if (key1 < key2)
+		return -1;
+
+	/*
+	 * If the keys are equal, sort on ItemPointer, for the same reason as in
+	 * the hash case.
+	 */
+	tuple1 = (IndexTuple) a->tuple;
+	tuple2 = (IndexTuple) b->tuple;
+
+	{
+		BlockNumber blk1 = ItemPointerGetBlockNumber(&tuple1->t_tid);
+		BlockNumber blk2 = ItemPointerGetBlockNumber(&tuple2->t_tid);
+
+		if (blk1 != blk2)
+			return (blk1 < blk2) ? -1 : 1;
+	}
+	{
+		OffsetNumber pos1 = ItemPointerGetOffsetNumber(&tuple1->t_tid);
+		OffsetNumber pos2 = ItemPointerGetOffsetNumber(&tuple2->t_tid);
+
+		if (pos1 != pos2)
+			return (pos1 < pos2) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static void
+copytup_index_gist(Tuplesortstate *state, SortTuple *stup, void *tup)
+{
+	/* The sort key must be supplied, so tuplesort_putgisttuple is needed */
+	elog(ERROR, "copytup_index_gist is not implemented");
+}
+
+static void
+writetup_index_gist(Tuplesortstate *state, int tapenum, SortTuple *stup)
+{
+	IndexTuple	tuple = (IndexTuple) stup->tuple;
+	unsigned int datalen;
+	unsigned int tuplen;
+
+	datalen = MAXALIGN(IndexTupleSize(tuple)) + sizeof(int64);
+	tuplen = datalen + sizeof(tuplen);
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) &tuplen, sizeof(tuplen));
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) tuple, datalen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeWrite(state->tapeset, tapenum,
+						 (void *) &tuplen, sizeof(tuplen));
+
+	FREEMEM(state, GetMemoryChunkSpace(tuple));
+	pfree(tuple);
+}
+
+static void
+readtup_index_gist(Tuplesortstate *state, SortTuple *stup,
+				   int tapenum, unsigned int len)
+{
+	unsigned int datalen = len - sizeof(unsigned int);
+	IndexTuple	tuple = (IndexTuple) palloc(datalen);
+
+	USEMEM(state, GetMemoryChunkSpace(tuple));
+	if (LogicalTapeRead(state->tapeset, tapenum, (void *) tuple,
+						datalen) != datalen)
+		elog(ERROR, "unexpected end of data");
+	if (state->randomAccess)	/* need trailing length word? */
+		if (LogicalTapeRead(state->tapeset, tapenum, (void *) &len,
+							sizeof(len)) != sizeof(len))
+			elog(ERROR, "unexpected end of data");
+	stup->tuple = (void *) tuple;
+	stup->datum1 = PointerGetDatum((char *) tuple +
+								   MAXALIGN(IndexTupleSize(tuple)));
+	stup->isnull1 = false;
+}
+
+static void
+reversedirection_index_gist(Tuplesortstate *state)
+{
+	/* We don't support reversing direction in a GiST index sort */
+	elog(ERROR, "reversedirection_index_gist is not implemented");
+}
+
 
 /*
  * Routines specialized for DatumTuple case
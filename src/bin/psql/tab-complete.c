@@ -1075,7 +1075,7 @@ psql_completion(char *text, int start, int end)
 			 pg_strcasecmp(prev_wd, "SET") == 0)
 	{
 		static const char *const list_COLUMNSET[] =
-		{"(", "DEFAULT", "NOT NULL", "STATISTICS", "STORAGE", NULL};
+		{"(", "COMPRESSION", "DEFAULT", "NOT NULL", "STATISTICS", "STORAGE", NULL};
 
 		COMPLETE_WITH_LIST(list_COLUMNSET);
 	}
@@ -1087,7 +1087,7 @@ psql_completion(char *text, int start, int end)
 			 pg_strcasecmp(prev_wd, "(") == 0)
 	{
 		static const char *const list_COLUMNOPTIONS[] =
-		{"n_distinct", "n_distinct_inherited", NULL};
+		{"compression", "n_distinct", "n_distinct_inherited", NULL};
 
 		COMPLETE_WITH_LIST(list_COLUMNOPTIONS);
 	}
@@ -1103,6 +1103,18 @@ psql_completion(char *text, int start, int end)
 
 		COMPLETE_WITH_LIST(list_COLUMNSTORAGE);
 	}
+	/* ALTER TABLE ALTER [COLUMN] <foo> SET COMPRESSION */
+	else if (((pg_strcasecmp(prev5_wd, "ALTER") == 0 &&
+			   pg_strcasecmp(prev4_wd, "COLUMN") == 0) ||
+			  pg_strcasecmp(prev4_wd, "ALTER") == 0) &&
+			 pg_strcasecmp(prev2_wd, "SET") == 0 &&
+			 pg_strcasecmp(prev_wd, "COMPRESSION") == 0)
+	{
+		static const char *const list_COLUMNCOMPRESSION[] =
+		{"pglz", "lz4", NULL};
+
+		COMPLETE_WITH_LIST(list_COLUMNCOMPRESSION);
+	}
 	/* ALTER TABLE ALTER [COLUMN] <foo> DROP */
 	else if (((pg_strcasecmp(prev4_wd, "ALTER") == 0 &&
 			   pg_strcasecmp(prev3_wd, "COLUMN") == 0) ||
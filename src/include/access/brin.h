@@ -0,0 +1,69 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin.h
+ *	  Public header file for the block range index (BRIN) access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BRIN_H
+#define BRIN_H
+
+#include "access/xlog.h"
+#include "fmgr.h"
+
+
+/* reloption parameters */
+#define BRIN_DEFAULT_PAGES_PER_RANGE	128
+#define BRIN_MAX_PAGES_PER_RANGE		131072
+
+/*
+ * Storage type for BRIN's reloptions
+ */
+typedef struct BrinOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			pagesPerRange;	/* heap pages summarized by each entry */
+} BrinOptions;
+
+#define BrinGetPagesPerRange(relation) \
+	((relation)->rd_options ? \
+	 ((BrinOptions *) (relation)->rd_options)->pagesPerRange : \
+	 BRIN_DEFAULT_PAGES_PER_RANGE)
+
+/*
+ * BRIN opclass support function numbers.  The only support function is a
+ * btree-style three-way comparison function for the indexed data type; the
+ * operators are the usual btree strategies <, <=, =, >= and >.
+ */
+#define BRIN_COMPARE_PROC				1
+#define BRINNProcs						1
+
+
+/* brin.c */
+extern Datum brinbuild(PG_FUNCTION_ARGS);
+extern Datum brininsert(PG_FUNCTION_ARGS);
+extern Datum brinbulkdelete(PG_FUNCTION_ARGS);
+extern Datum brinvacuumcleanup(PG_FUNCTION_ARGS);
+
+/* brinscan.c */
+extern Datum brinbeginscan(PG_FUNCTION_ARGS);
+extern Datum brinrescan(PG_FUNCTION_ARGS);
+extern Datum brinendscan(PG_FUNCTION_ARGS);
+extern Datum brinmarkpos(PG_FUNCTION_ARGS);
+extern Datum brinrestrpos(PG_FUNCTION_ARGS);
+extern Datum bringetbitmap(PG_FUNCTION_ARGS);
+
+/* brinutil.c */
+extern Datum brinoptions(PG_FUNCTION_ARGS);
+
+/* brinxlog.c */
+extern void brin_redo(XLogRecPtr lsn, XLogRecord *record);
+extern void brin_desc(StringInfo buf, uint8 xl_info, char *rec);
+
+#endif   /* BRIN_H */
@@ -0,0 +1,213 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin_private.h
+ *	  Private declarations for the BRIN access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BRIN_PRIVATE_H
+#define BRIN_PRIVATE_H
+
+#include "access/brin.h"
+#include "access/skey.h"
+#include "storage/bufmgr.h"
+#include "storage/bufpage.h"
+#include "storage/relfilenode.h"
+#include "utils/rel.h"
+
+
+/* Page numbers of fixed-location pages */
+#define BRIN_METAPAGE_BLKNO		(0)
+#define BRIN_FIRST_SLOT_BLKNO	(1)
+
+/*
+ * Contents of page special space on BRIN index pages
+ */
+typedef struct BrinPageOpaqueData
+{
+	uint16		flags;			/* see bit definitions below */
+	uint16		brin_page_id;	/* for identification of BRIN indexes */
+} BrinPageOpaqueData;
+
+typedef BrinPageOpaqueData *BrinPageOpaque;
+
+/* Flag bits in page special space */
+#define BRIN_META			(1<<0)
+
+#define BrinPageGetOpaque(page) ((BrinPageOpaque) PageGetSpecialPointer(page))
+#define BrinPageIsMeta(page) (BrinPageGetOpaque(page)->flags & BRIN_META)
+
+/*
+ * The page ID is for the convenience of pg_filedump and similar utilities,
+ * which otherwise would have a hard time telling pages of different index
+ * types apart.  It should be the last 2 bytes on the page.
+ */
+#define BRIN_PAGE_ID		0xFF83
+
+/*
+ * Contents of metadata page.  None of these fields change after the index
+ * is built; they are kept here, rather than recomputed from the reloptions
+ * and tuple descriptor, so that ALTER INDEX SET (pages_per_range) can't
+ * invalidate an existing index.
+ */
+typedef struct BrinMetaPageData
+{
+	uint32		magicNumber;	/* for identity cross-check */
+	uint32		pagesPerRange;	/* heap pages covered by each slot */
+	uint16		slotSize;		/* bytes per slot, MAXALIGN'd */
+	uint16		slotsPerPage;	/* slots on each slot page */
+} BrinMetaPageData;
+
+#define BRIN_MAGIC_NUMBER	(0xB121ABCD)
+
+#define BrinPageGetMeta(p) \
+	((BrinMetaPageData *) PageGetContents(p))
+
+/*
+ * Every page after the metapage is a slot page: a plain array of
+ * fixed-size slots, one per block range, in block range order.  The slot
+ * for range N is therefore found by arithmetic alone, and never moves.
+ * pd_lower is set to the end of the array, so that the unused space
+ * before the special space is omitted from full-page images.
+ */
+#define BrinSlotArrayOffset		MAXALIGN(SizeOfPageHeaderData)
+
+#define BrinPageGetSlot(page, slotSize, slotno) \
+	((BrinSlot) ((char *) (page) + BrinSlotArrayOffset + \
+				 (Size) (slotno) * (slotSize)))
+
+#define BrinSlotsPerPage(slotSize) \
+	((BLCKSZ - BrinSlotArrayOffset - \
+	  MAXALIGN(sizeof(BrinPageOpaqueData))) / (slotSize))
+
+/*
+ * A slot starts with a one-byte state and one flag byte per index column,
+ * followed by the minimum and maximum of each column, each aligned per the
+ * column's type.  Only fixed-length types can be stored.  A slot of all
+ * zeroes is an unsummarized range, which is how slot pages start out.
+ */
+typedef char *BrinSlot;
+
+#define BrinSlotState(slot)				(((uint8 *) (slot))[0])
+#define BrinSlotColFlags(slot, attno)	(((uint8 *) (slot))[1 + (attno)])
+
+/* Slot states */
+#define BRIN_SLOT_UNSUMMARIZED	0	/* range not summarized yet */
+#define BRIN_SLOT_PLACEHOLDER	1	/* summarization in progress */
+#define BRIN_SLOT_SUMMARIZED	2	/* min/max are valid for the range */
+
+/* Per-column flag bits */
+#define BRIN_COL_HASVALUES		(1<<0)	/* min and max are set */
+#define BRIN_COL_HASNULLS		(1<<1)	/* range contains a null */
+
+/*
+ * Per-column information needed to read and update slots
+ */
+typedef struct BrinColumnDesc
+{
+	int16		attlen;			/* length of the column's type */
+	bool		attbyval;		/* is type pass-by-value? */
+	uint16		minOffset;		/* offset of the minimum within the slot */
+	uint16		maxOffset;		/* offset of the maximum within the slot */
+	FmgrInfo   *cmpFn;			/* opclass comparison function */
+} BrinColumnDesc;
+
+/*
+ * BrinDesc describes the slot layout of one index.  It's built once per
+ * relcache entry and kept in rd_amcache.
+ */
+typedef struct BrinDesc
+{
+	int			natts;			/* number of index columns */
+	BlockNumber pagesPerRange;	/* from the metapage */
+	uint16		slotSize;		/* from the metapage */
+	uint16		slotsPerPage;	/* from the metapage */
+	BlockNumber knownBlocks;	/* index pages known to exist */
+	BrinColumnDesc cols[INDEX_MAX_KEYS];
+} BrinDesc;
+
+/* Slot page and slot number holding the summary of a block range */
+#define BrinRangeGetBlkno(desc, range) \
+	((BlockNumber) (BRIN_FIRST_SLOT_BLKNO + (range) / (desc)->slotsPerPage))
+#define BrinRangeGetSlotno(desc, range) \
+	((int) ((range) % (desc)->slotsPerPage))
+
+/* Block range that holds a heap block */
+#define BrinHeapBlkGetRange(desc, heapBlk) \
+	((heapBlk) / (desc)->pagesPerRange)
+
+/*
+ * Private state of a BRIN scan
+ */
+typedef struct BrinScanOpaqueData
+{
+	BrinDesc   *desc;			/* index's slot layout */
+} BrinScanOpaqueData;
+
+typedef BrinScanOpaqueData *BrinScanOpaque;
+
+
+/*
+ * XLOG stuff
+ */
+
+/* XLOG record types for BRIN */
+#define XLOG_BRIN_CREATE_INDEX		0x00
+#define XLOG_BRIN_NEW_PAGE			0x10
+#define XLOG_BRIN_UPDATE_SLOT		0x20
+
+/*
+ * XLOG_BRIN_CREATE_INDEX and XLOG_BRIN_NEW_PAGE carry the layout needed to
+ * initialize the metapage or an empty slot page.
+ */
+typedef struct xl_brin_createidx
+{
+	RelFileNode node;
+	BrinMetaPageData meta;
+} xl_brin_createidx;
+
+typedef struct xl_brin_newpage
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	uint16		slotSize;
+	uint16		slotsPerPage;
+} xl_brin_newpage;
+
+/*
+ * XLOG_BRIN_UPDATE_SLOT replaces one slot wholesale; the new slot contents
+ * follow the header.
+ */
+typedef struct xl_brin_update
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	uint16		slotno;
+	uint16		slotSize;
+	/* slot contents follow */
+} xl_brin_update;
+
+
+/* brinutil.c */
+extern BrinDesc *brinGetDesc(Relation index);
+extern uint16 brinComputeSlotSize(TupleDesc tupdesc);
+extern void brinInitMetapage(Page page, BlockNumber pagesPerRange,
+				 uint16 slotSize);
+extern void brinInitSlotPage(Page page, uint16 slotSize, uint16 slotsPerPage);
+extern Buffer brinGetSlotBuffer(Relation index, BrinDesc *desc,
+				  BlockNumber blkno);
+extern bool brinSlotAddValue(BrinDesc *desc, BrinSlot slot, int attno,
+				 Datum value, bool isnull);
+extern bool brinSlotUnion(BrinDesc *desc, BrinSlot dst, BrinSlot src);
+extern bool brinSlotConsistent(BrinDesc *desc, BrinSlot slot,
+				   ScanKey keys, int nkeys);
+extern void brinWriteSlot(Relation index, BrinDesc *desc, Buffer buffer,
+			  int slotno, BrinSlot newslot);
+
+#endif   /* BRIN_PRIVATE_H */
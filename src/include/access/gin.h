@@ -38,10 +38,10 @@ typedef struct GinPageOpaqueData
 {
 	BlockNumber rightlink;		/* next page if any */
 	OffsetNumber maxoff;		/* number entries on GIN_DATA page; number of
-								 * heap ItemPointer on GIN_DATA|GIN_LEAF page
-								 * and number of records on GIN_DATA &
-								 * ~GIN_LEAF page. On GIN_LIST page, number of
-								 * heap tuples. */
+								 * heap ItemPointers in the compressed posting
+								 * list on GIN_DATA|GIN_LEAF page and number
+								 * of records on GIN_DATA & ~GIN_LEAF page. On
+								 * GIN_LIST page, number of heap tuples. */
 	uint16		flags;			/* see bit definitions below */
 } GinPageOpaqueData;
 
@@ -164,7 +164,7 @@ typedef struct
 
 #define GinGetOrigSizePosting(itup) GinItemPointerGetBlockNumber(&(itup)->t_tid)
 #define GinSetOrigSizePosting(itup,n)	ItemPointerSetBlockNumber(&(itup)->t_tid,(n))
-#define GinGetPosting(itup)			( (ItemPointer)(( ((char*)(itup)) + SHORTALIGN(GinGetOrigSizePosting(itup)) )) )
+#define GinGetPosting(itup)			( (Pointer)(( ((char*)(itup)) + SHORTALIGN(GinGetOrigSizePosting(itup)) )) )
 
 #define GinMaxItemSize \
 	MAXALIGN_DOWN(((BLCKSZ - SizeOfPageHeaderData - \
@@ -188,6 +188,25 @@ typedef struct
 	 - GinPageGetOpaque(page)->maxoff * GinSizeOfItem(page) \
 	 - MAXALIGN(sizeof(GinPageOpaqueData)))
 
+/*
+ * Leaf data pages hold a compressed posting list (see ginpostinglist.c)
+ * instead of an array of items.  It starts at GinDataPageGetData, pd_lower
+ * points just past its end, and maxoff is the number of items in it.  The
+ * macros above that address items by position don't apply to them.
+ */
+#define GinDataLeafMaxContentSize	\
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData) \
+	 - MAXALIGN(sizeof(ItemPointerData)) \
+	 - MAXALIGN(sizeof(GinPageOpaqueData)))
+#define GinDataLeafPageGetPostingListSize(page) \
+	(((PageHeader) (page))->pd_lower - \
+	 (GinDataPageGetData(page) - (char *) (page)))
+#define GinDataLeafPageGetFreeSpace(page) \
+	(GinDataLeafMaxContentSize - GinDataLeafPageGetPostingListSize(page))
+
+/* Upper limit on the size of a single item in a compressed posting list */
+#define GinPostingListMaxItemSize	7
+
 /*
  * List pages
  */
@@ -258,8 +277,8 @@ typedef struct ginxlogInsert
 	OffsetNumber nitem;
 
 	/*
-	 * follows: tuples or ItemPointerData or PostingItem or list of
-	 * ItemPointerData
+	 * follows: tuple, PostingItem, or the list of ItemPointerData merged
+	 * into a data leaf page
 	 */
 } ginxlogInsert;
 
@@ -283,7 +302,11 @@ typedef struct ginxlogSplit
 	BlockNumber updateBlkno;
 
 	ItemPointerData rightbound; /* used only in posting tree */
-	/* follows: list of tuple or ItemPointerData or PostingItem */
+
+	/*
+	 * follows: list of tuples or PostingItems, or the compressed posting
+	 * lists of the left and then the right data leaf page
+	 */
 } ginxlogSplit;
 
 #define XLOG_GIN_VACUUM_PAGE	0x40
@@ -439,7 +462,7 @@ extern void findParents(GinBtree btree, GinBtreeStack *stack, BlockNumber rootBl
 extern IndexTuple GinFormTuple(Relation index, GinState *ginstate,
 			 OffsetNumber attnum, Datum key,
 			 ItemPointerData *ipd, uint32 nipd, bool errorTooBig);
-extern void GinShortenTuple(IndexTuple itup, uint32 nipd);
+extern ItemPointer ginReadTuple(IndexTuple itup, uint32 *nitems);
 extern void prepareEntryScan(GinBtree btree, Relation index, OffsetNumber attnum,
 				 Datum value, GinState *ginstate);
 extern void entryFillRoot(GinBtree btree, Buffer root, Buffer lbuf, Buffer rbuf);
@@ -452,6 +475,9 @@ extern uint32 MergeItemPointers(ItemPointerData *dst,
 				  ItemPointerData *b, uint32 nb);
 
 extern void GinDataPageAddItem(Page page, void *data, OffsetNumber offset);
+extern uint32 GinDataLeafPageGetItems(Page page, ItemPointerData *items);
+extern void GinDataLeafPageSetItems(Page page, ItemPointerData *items,
+						uint32 nitems);
 extern void PageDeletePostingItem(Page page, OffsetNumber offset);
 
 typedef struct
@@ -468,6 +494,13 @@ extern Buffer scanBeginPostingTree(GinPostingTreeScan *gdi);
 extern void dataFillRoot(GinBtree btree, Buffer root, Buffer lbuf, Buffer rbuf);
 extern void prepareDataScan(GinBtree btree, Relation index);
 
+/* ginpostinglist.c */
+extern uint32 ginCompressPostingList(const ItemPointerData *ipd, uint32 nipd,
+					   char *dst, Size maxsize, Size *nbytes);
+extern char *ginDecompressPostingList(char *ptr, uint32 nipd,
+						 ItemPointerData *dst);
+extern char *ginDecodeItemPointer(char *ptr, ItemPointer item);
+
 /* ginscan.c */
 
 typedef struct GinScanEntryData *GinScanEntry;
@@ -609,6 +642,8 @@ typedef struct GinTupleCollector
 	uint32		sumsize;
 } GinTupleCollector;
 
+extern PGDLLIMPORT int gin_pending_list_limit;
+
 extern void ginHeapTupleFastInsert(Relation index, GinState *ginstate,
 					   GinTupleCollector *collector);
 extern uint32 ginHeapTupleFastCollect(Relation index, GinState *ginstate,
@@ -616,5 +651,7 @@ extern uint32 ginHeapTupleFastCollect(Relation index, GinState *ginstate,
 						OffsetNumber attnum, Datum value, ItemPointer item);
 extern void ginInsertCleanup(Relation index, GinState *ginstate,
 				 bool vac_delay, IndexBulkDeleteResult *stats);
+extern bool ginPendingListIsFull(Relation index);
+extern bool ginPendingListAutoCleanup(Relation index);
 
 #endif   /* GIN_H */
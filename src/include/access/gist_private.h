@@ -17,6 +17,8 @@
 #include "access/gist.h"
 #include "access/itup.h"
 #include "storage/bufmgr.h"
+#include "storage/buffile.h"
+#include "utils/hsearch.h"
 
 #define GIST_UNLOCK BUFFER_LOCK_UNLOCK
 #define GIST_SHARE	BUFFER_LOCK_SHARE
@@ -220,6 +222,120 @@ typedef struct
 	ItemPointerData key;
 } GISTInsertState;
 
+/*
+ * Node buffers, used by the buffering index build (see gistbuild.c and the
+ * README).
+ *
+ * The tuples in a node buffer are kept in a chain of pages in a temporary
+ * file, linked backwards by their prev-links.  Only the last page of each
+ * buffer is ever kept in memory, and that only while the buffer is being
+ * filled or emptied.  Tuples are added and removed at the end of the last
+ * page, so a buffer is really a stack of tuples.
+ */
+typedef struct
+{
+	BlockNumber prev;			/* previous page of the buffer, or Invalid */
+	uint32		freespace;		/* free space left on the page */
+	char		tupledata[1];	/* the tuples, stored at the end */
+} GISTNodeBufferPage;
+
+#define BUFFER_PAGE_DATA_OFFSET MAXALIGN(offsetof(GISTNodeBufferPage, tupledata))
+/* Returns free space in node buffer page */
+#define PAGE_FREE_SPACE(nbp) ((nbp)->freespace)
+/* Checks if node buffer page is empty */
+#define PAGE_IS_EMPTY(nbp) ((nbp)->freespace == BLCKSZ - BUFFER_PAGE_DATA_OFFSET)
+/* Checks if node buffer page doesn't have enough space for the index tuple */
+#define PAGE_NO_SPACE(nbp, itup) (PAGE_FREE_SPACE(nbp) < \
+								  MAXALIGN(IndexTupleSize(itup)))
+
+typedef struct
+{
+	BlockNumber nodeBlocknum;	/* index block # this buffer is for (hash key) */
+	int32		blocksCount;	/* current # of pages occupied by buffer */
+
+	BlockNumber pageBlocknum;	/* temp file block # of the last page, if it
+								 * isn't in memory */
+	GISTNodeBufferPage *pageBuffer;		/* in-memory copy of the last page */
+
+	bool		queuedForEmptying;		/* is it in the emptying queue? */
+	bool		isTemp;			/* is it a temporary copy, not in the hash
+								 * table? */
+
+	int			level;			/* level of the node, counting up from the
+								 * leaves (0) */
+} GISTNodeBuffer;
+
+/*
+ * Does the specified level have buffers?  (Beware of multiple evaluation of
+ * arguments.)
+ */
+#define LEVEL_HAS_BUFFERS(nlevel, gfbb) \
+	((nlevel) != 0 && (nlevel) % (gfbb)->levelStep == 0 && \
+	 (nlevel) != (gfbb)->rootlevel)
+
+/* Is specified buffer at least half-filled (should be queued for emptying)? */
+#define BUFFER_HALF_FILLED(nodeBuffer, gfbb) \
+	((nodeBuffer)->blocksCount > (gfbb)->pagesPerBuffer / 2)
+
+/*
+ * Is specified buffer full?  Our buffers can actually grow indefinitely,
+ * beyond the "maximum" size, so this just means whether the buffer has grown
+ * beyond the nominal maximum size.
+ */
+#define BUFFER_OVERFLOWED(nodeBuffer, gfbb) \
+	((nodeBuffer)->blocksCount > (gfbb)->pagesPerBuffer)
+
+/* Working state of the buffering build */
+typedef struct
+{
+	/* Persistent memory context for the buffers and their metadata */
+	MemoryContext context;
+
+	BufFile    *pfile;			/* temporary file to store buffers in */
+	long		nFileBlocks;	/* current size of the temporary file */
+
+	/* Array of free blocks in the temporary file */
+	long	   *freeBlocks;
+	int			nFreeBlocks;	/* # of currently free blocks in the array */
+	int			freeBlocksLen;	/* current allocated length of the array */
+
+	/* Hash table mapping index block numbers to their node buffers */
+	HTAB	   *nodeBuffersTab;
+
+	/* Stack of buffers that are queued for emptying */
+	List	   *bufferEmptyingQueue;
+
+	/*
+	 * Parameters of the buffering build: buffers are attached to every
+	 * levelStep'th level of the tree, counting from the leaves, and each
+	 * is considered full once it holds pagesPerBuffer pages.
+	 */
+	int			levelStep;
+	int			pagesPerBuffer;
+
+	/* Lists of all the node buffers on each level, for the final emptying */
+	List	  **buffersOnLevels;
+	int			buffersOnLevelsLen;
+
+	/* Buffers whose last page is currently loaded in memory */
+	GISTNodeBuffer **loadedBuffers;
+	int			loadedBuffersCount;		/* # of entries in loadedBuffers */
+	int			loadedBuffersLen;		/* allocated size of loadedBuffers */
+
+	/* Level of the current root node (= height of the index tree - 1) */
+	int			rootlevel;
+} GISTBuildBuffers;
+
+/*
+ * Storage type for GiST's reloptions
+ */
+typedef struct GiSTOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			fillfactor;		/* page fill factor in percent (0..100) */
+	int			bufferingModeOffset;	/* use buffering build? */
+} GiSTOptions;
+
 /* root page of a gist index */
 #define GIST_ROOT_BLKNO				0
 
@@ -234,9 +350,10 @@ typedef struct
 #define  GistTupleSetInvalid(itup)	ItemPointerSetOffsetNumber( &((itup)->t_tid), TUPLE_IS_INVALID )
 
 /* gist.c */
-extern Datum gistbuild(PG_FUNCTION_ARGS);
 extern Datum gistinsert(PG_FUNCTION_ARGS);
 extern MemoryContext createTempGistContext(void);
+extern void gistdoinsert(Relation r, IndexTuple itup, Size freespace,
+			 GISTSTATE *giststate);
 extern void initGISTstate(GISTSTATE *giststate, Relation index);
 extern void freeGISTstate(GISTSTATE *giststate);
 extern void gistmakedeal(GISTInsertState *state, GISTSTATE *giststate);
@@ -308,6 +425,7 @@ extern void gistcentryinit(GISTSTATE *giststate, int nkey,
 			   OffsetNumber o, bool l, bool isNull);
 
 extern void GISTInitBuffer(Buffer b, uint32 f);
+extern void gistinitpage(Page page, uint32 f);
 extern void gistdentryinit(GISTSTATE *giststate, int nkey, GISTENTRY *e,
 			   Datum k, Relation r, Page pg, OffsetNumber o,
 			   bool l, bool isNull);
@@ -330,6 +448,27 @@ extern void gistMakeUnionKey(GISTSTATE *giststate, int attno,
 extern Datum gistbulkdelete(PG_FUNCTION_ARGS);
 extern Datum gistvacuumcleanup(PG_FUNCTION_ARGS);
 
+/* gistbuild.c */
+extern Datum gistbuild(PG_FUNCTION_ARGS);
+extern void gistValidateBufferingOption(char *value);
+
+/* gistbuildbuffers.c */
+extern GISTBuildBuffers *gistInitBuildBuffers(int pagesPerBuffer, int levelStep,
+					 int maxLevel);
+extern GISTNodeBuffer *gistGetNodeBuffer(GISTBuildBuffers *gfbb,
+				  GISTSTATE *giststate,
+				  BlockNumber blkno, int level);
+extern void gistPushItupToNodeBuffer(GISTBuildBuffers *gfbb,
+						 GISTNodeBuffer *nodeBuffer, IndexTuple item);
+extern bool gistPopItupFromNodeBuffer(GISTBuildBuffers *gfbb,
+						  GISTNodeBuffer *nodeBuffer, IndexTuple *item);
+extern void gistFreeBuildBuffers(GISTBuildBuffers *gfbb);
+extern void gistRelocateBuildBuffersOnSplit(GISTBuildBuffers *gfbb,
+								GISTSTATE *giststate, Relation r,
+								int level, Buffer buffer,
+								SplitedPageLayout *dist);
+extern void gistUnloadNodeBuffers(GISTBuildBuffers *gfbb);
+
 /* gistsplit.c */
 extern void gistSplitByKey(Relation r, Page page, IndexTuple *itup,
 			   int len, GISTSTATE *giststate,
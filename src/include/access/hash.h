@@ -50,6 +50,21 @@ typedef uint32 Bucket;
 #define LH_BUCKET_PAGE			(1 << 1)
 #define LH_BITMAP_PAGE			(1 << 2)
 #define LH_META_PAGE			(1 << 3)
+#define LH_BUCKET_BEING_POPULATED	(1 << 4)
+#define LH_BUCKET_BEING_SPLIT	(1 << 5)
+
+#define LH_PAGE_TYPE \
+	(LH_OVERFLOW_PAGE | LH_BUCKET_PAGE | LH_BITMAP_PAGE | LH_META_PAGE)
+
+/*
+ * While a bucket is being split, its primary page is marked
+ * LH_BUCKET_BEING_SPLIT and the primary page of the new bucket is marked
+ * LH_BUCKET_BEING_POPULATED.  Both marks are cleared when all the tuples
+ * that belong in the new bucket have been moved.  If the split is
+ * interrupted, the marks stay behind, and the split is finished later by
+ * VACUUM or by the next attempt to split either bucket; until then, scans
+ * of the new bucket must look at the old bucket too.  See README.
+ */
 
 typedef struct HashPageOpaqueData
 {
@@ -91,6 +106,17 @@ typedef struct HashScanOpaqueData
 	 */
 	BlockNumber hashso_bucket_blkno;
 
+	/*
+	 * If the bucket is still being populated by an interrupted split, some
+	 * of its tuples may not have been moved from the old bucket yet, so we
+	 * share-lock the old bucket too, and scan it after the new one.
+	 * hashso_old_bucket_blkno is zero if there's no such bucket;
+	 * hashso_in_old_bucket tells whether the scan has moved on to it.
+	 */
+	Bucket		hashso_old_bucket;
+	BlockNumber hashso_old_bucket_blkno;
+	bool		hashso_in_old_bucket;
+
 	/*
 	 * We also want to remember which buffer we're currently examining in the
 	 * scan. We keep the buffer pinned (but not locked) across hashgettuple
@@ -238,6 +264,132 @@ typedef HashMetaPageData *HashMetaPage;
  */
 #define HASHPROC		1
 
+/*
+ * XLOG records for hash operations
+ */
+#define XLOG_HASH_INIT_META_PAGE	0x00	/* initialize an empty index */
+#define XLOG_HASH_INIT_BITMAP_PAGE	0x10	/* add a bitmap page */
+#define XLOG_HASH_UPDATE_META_PAGE	0x20	/* replace metapage contents */
+#define XLOG_HASH_INSERT			0x30	/* add a tuple to a page */
+#define XLOG_HASH_ADD_OVFL_PAGE		0x40	/* chain a new overflow page */
+#define XLOG_HASH_FREE_OVFL_PAGE	0x50	/* unchain and free an overflow
+											 * page */
+#define XLOG_HASH_ALLOC_BITMAP_BIT	0x60	/* mark an overflow page in use */
+#define XLOG_HASH_MOVE_TUPLES		0x70	/* move tuples between pages */
+#define XLOG_HASH_DELETE			0x80	/* delete tuples from a page */
+#define XLOG_HASH_SPLIT_BEGIN		0x90	/* start splitting a bucket */
+#define XLOG_HASH_SPLIT_COMPLETE	0xA0	/* finish splitting a bucket */
+
+/*
+ * Metapage contents, for XLOG_HASH_INIT_META_PAGE and
+ * XLOG_HASH_UPDATE_META_PAGE.  The metapage is always rebuilt wholesale
+ * from the record, so these don't need a full-page image.
+ * XLOG_HASH_INIT_META_PAGE also initializes the first num_buckets bucket
+ * pages.
+ */
+typedef struct xl_hash_metapage
+{
+	RelFileNode node;
+	uint32		num_buckets;
+	HashMetaPageData meta;
+} xl_hash_metapage;
+
+/* A bitmap page, with all bits set */
+typedef struct xl_hash_init_bitmap
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	uint16		bmsize;
+} xl_hash_init_bitmap;
+
+/* Set one bit in a bitmap page */
+typedef struct xl_hash_alloc_bitmap_bit
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	uint32		bitno;			/* bit number within the page */
+} xl_hash_alloc_bitmap_bit;
+
+/*
+ * An insertion also increments the metapage's tuple count, which is the
+ * second buffer referenced by the record.
+ */
+typedef struct xl_hash_insert
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	OffsetNumber offnum;
+	/* INDEX TUPLE FOLLOWS AT END OF STRUCT */
+} xl_hash_insert;
+
+typedef struct xl_hash_add_ovfl_page
+{
+	RelFileNode node;
+	BlockNumber ovflblkno;		/* the new overflow page */
+	BlockNumber prevblkno;		/* the page it is chained after */
+	Bucket		bucket;
+} xl_hash_add_ovfl_page;
+
+/*
+ * Freeing an overflow page fixes the sibling links of the pages before and
+ * after it, and clears its bit in the bitmap page, atomically.
+ */
+typedef struct xl_hash_free_ovfl_page
+{
+	RelFileNode node;
+	BlockNumber ovflblkno;
+	BlockNumber prevblkno;
+	BlockNumber nextblkno;		/* or InvalidBlockNumber */
+	BlockNumber mapblkno;
+	uint32		bitno;			/* bit number within the bitmap page */
+} xl_hash_free_ovfl_page;
+
+/*
+ * Tuples moved from one page to another, by a bucket split or by squeezing
+ * a bucket.  The tuples are added to wblkno and deleted from rblkno in the
+ * same record, so that a crash can't leave a tuple in both places or in
+ * neither.
+ */
+typedef struct xl_hash_move_tuples
+{
+	RelFileNode node;
+	BlockNumber wblkno;
+	BlockNumber rblkno;
+	uint16		ntups;
+	/* MAXALIGN'd TUPLES, THEN THEIR OFFSET NUMBERS ON rblkno, FOLLOW */
+} xl_hash_move_tuples;
+
+typedef struct xl_hash_delete
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	/* TARGET OFFSET NUMBERS FOLLOW AT THE END */
+} xl_hash_delete;
+
+/*
+ * Beginning a split updates the metapage, marks the old bucket, and
+ * initializes the new bucket's primary page.  If a new splitpoint's worth of
+ * bucket pages was allocated, lastblkno is the last of them, else it's
+ * InvalidBlockNumber.
+ */
+typedef struct xl_hash_split_begin
+{
+	RelFileNode node;
+	Bucket		old_bucket;
+	Bucket		new_bucket;
+	BlockNumber oblkno;
+	BlockNumber nblkno;
+	BlockNumber lastblkno;
+	HashMetaPageData meta;
+} xl_hash_split_begin;
+
+typedef struct xl_hash_split_complete
+{
+	RelFileNode node;
+	BlockNumber oblkno;
+	BlockNumber nblkno;
+} xl_hash_split_complete;
+
 
 /* public routines */
 
@@ -285,6 +437,8 @@ extern Datum hash_uint32(uint32 k);
 extern void _hash_doinsert(Relation rel, IndexTuple itup);
 extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 			   Size itemsize, IndexTuple itup);
+extern void _hash_move_tuples(Relation rel, Buffer wbuf, Buffer rbuf,
+				  IndexTuple *itups, OffsetNumber *offsets, uint16 ntups);
 
 /* hashovfl.c */
 extern Buffer _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf);
@@ -309,12 +463,15 @@ extern Buffer _hash_getbuf_with_strategy(Relation rel, BlockNumber blkno,
 						   BufferAccessStrategy bstrategy);
 extern void _hash_relbuf(Relation rel, Buffer buf);
 extern void _hash_dropbuf(Relation rel, Buffer buf);
-extern void _hash_wrtbuf(Relation rel, Buffer buf);
 extern void _hash_chgbufaccess(Relation rel, Buffer buf, int from_access,
 				   int to_access);
 extern uint32 _hash_metapinit(Relation rel, double num_tuples);
+extern void _hash_log_metapage(Relation rel, Buffer metabuf);
 extern void _hash_pageinit(Page page, Size size);
 extern void _hash_expandtable(Relation rel, Buffer metabuf);
+extern void _hash_finish_split(Relation rel, Buffer metabuf,
+				   Bucket obucket, Bucket nbucket,
+				   BufferAccessStrategy bstrategy);
 
 /* hashscan.c */
 extern void _hash_regscan(IndexScanDesc scan);
@@ -342,6 +499,8 @@ extern uint32 _hash_datum2hashkey_type(Relation rel, Datum key, Oid keytype);
 extern Bucket _hash_hashkey2bucket(uint32 hashkey, uint32 maxbucket,
 					 uint32 highmask, uint32 lowmask);
 extern uint32 _hash_log2(uint32 num);
+extern Bucket _hash_get_oldbucket(Bucket new_bucket);
+extern Bucket _hash_get_newbucket(Bucket old_bucket, uint32 maxbucket);
 extern void _hash_checkpage(Relation rel, Buffer buf, int flags);
 extern uint32 _hash_get_indextuple_hashkey(IndexTuple itup);
 extern IndexTuple _hash_form_tuple(Relation index,
@@ -349,7 +508,7 @@ extern IndexTuple _hash_form_tuple(Relation index,
 extern OffsetNumber _hash_binsearch(Page page, uint32 hash_value);
 extern OffsetNumber _hash_binsearch_last(Page page, uint32 hash_value);
 
-/* hash.c */
+/* hashxlog.c */
 extern void hash_redo(XLogRecPtr lsn, XLogRecord *record);
 extern void hash_desc(StringInfo buf, uint8 xl_info, char *rec);
 
@@ -152,8 +152,13 @@ typedef struct BTMetaPageData
 	( (i1).ip_blkid.bi_hi == (i2).ip_blkid.bi_hi && \
 	  (i1).ip_blkid.bi_lo == (i2).ip_blkid.bi_lo && \
 	  (i1).ip_posid == (i2).ip_posid )
+/*
+ *	Downlinks are matched by block number alone, since the offset number
+ *	field of a truncated pivot tuple holds its attribute count.
+ */
 #define BTEntrySame(i1, i2) \
-	BTTidSame((i1)->t_tid, (i2)->t_tid)
+	( (i1)->t_tid.ip_blkid.bi_hi == (i2)->t_tid.ip_blkid.bi_hi && \
+	  (i1)->t_tid.ip_blkid.bi_lo == (i2)->t_tid.ip_blkid.bi_lo )
 
 
 /*
@@ -201,6 +206,121 @@ typedef struct BTMetaPageData
 #define P_FIRSTKEY			((OffsetNumber) 2)
 #define P_FIRSTDATAKEY(opaque)	(P_RIGHTMOST(opaque) ? P_HIKEY : P_FIRSTKEY)
 
+/*
+ *	Posting list tuples.
+ *
+ *	To save space, a run of leaf items with identical keys can be merged
+ *	("deduplicated") into a single posting list tuple, which stores the key
+ *	once followed by a sorted array of the heap TIDs of all the merged
+ *	items.  A posting list tuple has INDEX_ALT_TID_MASK set in t_info, and
+ *	BT_IS_POSTING set in the offset number field of t_tid.  Its t_tid does
+ *	not point at a heap tuple; instead the block number field holds the
+ *	byte offset of the posting list within the tuple, and the rest of the
+ *	offset number field holds the number of heap TIDs in it.  The key part
+ *	of the tuple is laid out exactly as in a plain tuple, so index_getattr()
+ *	works unchanged.
+ *
+ *	Posting list tuples appear only on leaf pages, never as high keys or
+ *	downlinks: whenever a leaf item is copied to become a high key, the
+ *	posting list is stripped off again (see _bt_strip_posting).
+ *
+ *	Pivot tuples (high keys and the items of internal pages) may be
+ *	truncated to fewer than the index's number of attributes; see
+ *	_bt_truncate.  A truncated pivot tuple has INDEX_ALT_TID_MASK set in
+ *	t_info but not BT_IS_POSTING, and the offset number field of t_tid holds
+ *	the number of attributes that remain.  The truncated attributes are
+ *	treated as "minus infinity" by _bt_compare.  The block number field is
+ *	the downlink, as usual.  Pivot tuples that kept all of their attributes
+ *	look just like they always have.
+ *
+ *	Duplicate keys are not kept in any particular heap TID order in the
+ *	index, so a run of equal keys may consist of any mix of plain and
+ *	posting list tuples; only the TIDs within one posting list are sorted.
+ */
+#define INDEX_ALT_TID_MASK		INDEX_AM_RESERVED_BIT
+
+/* Flag and mask for the offset number field of an alternative t_tid */
+#define BT_IS_POSTING			0x2000
+#define BT_OFFSET_MASK			0x1FFF
+
+#define BTreeTupleIsPosting(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 ((itup)->t_tid.ip_posid & BT_IS_POSTING) != 0)
+#define BTreeTupleIsTruncated(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 ((itup)->t_tid.ip_posid & BT_IS_POSTING) == 0)
+#define BTreeTupleGetNPosting(itup) \
+	((int) ((itup)->t_tid.ip_posid & BT_OFFSET_MASK))
+#define BTreeTupleSetPosting(itup, nhtids, off) \
+	do { \
+		(itup)->t_info |= INDEX_ALT_TID_MASK; \
+		BlockIdSet(&(itup)->t_tid.ip_blkid, (off)); \
+		(itup)->t_tid.ip_posid = (OffsetNumber) ((nhtids) | BT_IS_POSTING); \
+	} while (0)
+#define BTreeTupleGetPostingOffset(itup) \
+	((Size) BlockIdGetBlockNumber(&(itup)->t_tid.ip_blkid))
+#define BTreeTupleGetPosting(itup) \
+	((ItemPointer) ((char *) (itup) + BTreeTupleGetPostingOffset(itup)))
+#define BTreeTupleGetPostingN(itup, n) \
+	(BTreeTupleGetPosting(itup) + (n))
+#define BTreeTupleGetNHeapTids(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1)
+#define BTreeTupleGetHeapTidN(itup, n) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPostingN(itup, n) : &(itup)->t_tid)
+#define BTreeTupleGetKeySize(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPostingOffset(itup) : \
+	 IndexTupleSize(itup))
+
+/*
+ * Accessors for pivot tuples.  BTreeTupleGetNAtts works on any btree tuple;
+ * only truncated pivot tuples have fewer than all attributes.
+ * BTreeTupleSetDownLink keeps the attribute count of a truncated pivot tuple
+ * intact.
+ */
+#define BTreeTupleGetNAtts(itup, rel) \
+	(BTreeTupleIsTruncated(itup) ? \
+	 (int) ((itup)->t_tid.ip_posid & BT_OFFSET_MASK) : \
+	 RelationGetNumberOfAttributes(rel))
+#define BTreeTupleSetNAtts(itup, natts) \
+	do { \
+		(itup)->t_info |= INDEX_ALT_TID_MASK; \
+		(itup)->t_tid.ip_posid = (OffsetNumber) (natts); \
+	} while (0)
+#define BTreeTupleSetDownLink(itup, blkno) \
+	do { \
+		ItemPointerSetBlockNumber(&(itup)->t_tid, (blkno)); \
+		if (!BTreeTupleIsTruncated(itup)) \
+			ItemPointerSetOffsetNumber(&(itup)->t_tid, P_HIKEY); \
+	} while (0)
+
+/*
+ * Maximum size of a posting list tuple.  We keep these well below
+ * BTMaxItemSize, so that a page holding a few of them can still be split
+ * reasonably evenly.
+ */
+#define BTMaxPostingSize(page) \
+	MAXALIGN_DOWN(BTMaxItemSize(page) / 2)
+
+/*
+ * Upper bound on the number of heap TIDs that can be stored on one leaf
+ * page, counting every entry of every posting list.  Used to size
+ * per-page arrays of heap TIDs.
+ */
+#define MaxBTreeTIDsPerPage \
+	((int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
+			sizeof(ItemPointerData)))
+
+/*
+ * A run of consecutive items on a leaf page that are merged into a single
+ * posting list tuple by deduplication.  The WAL record for deduplication
+ * carries an array of these; see _bt_dedup_one_page.
+ */
+typedef struct BTDedupInterval
+{
+	OffsetNumber baseoff;		/* offset of first item in the run */
+	uint16		nitems;			/* number of items in the run */
+} BTDedupInterval;
+
 /*
  * XLOG records for btree operations
  *
@@ -224,6 +344,7 @@ typedef struct BTMetaPageData
 										 * vacuum */
 #define XLOG_BTREE_REUSE_PAGE	0xD0	/* old page is about to be reused from
 										 * FSM */
+#define XLOG_BTREE_DEDUP		0xE0	/* merge duplicates into posting lists */
 
 /*
  * All that we need to find changed index tuple
@@ -291,10 +412,10 @@ typedef struct xl_btree_split
 	 * than BlockNumber for alignment reasons: SizeOfBtreeSplit is only 16-bit
 	 * aligned.)
 	 *
-	 * If level > 0, an IndexTuple representing the HIKEY of the left page
-	 * follows.  We don't need this on leaf pages, because it's the same as
-	 * the leftmost key in the new right page.	Also, it's suppressed if
-	 * XLogInsert chooses to store the left page's whole page image.
+	 * Next, an IndexTuple representing the HIKEY of the left page follows.
+	 * On leaf pages this is a truncated copy of the leftmost key in the new
+	 * right page (see _bt_truncate).  It's suppressed if XLogInsert chooses
+	 * to store the left page's whole page image.
 	 *
 	 * In the _L variants, next are OffsetNumber newitemoff and the new item.
 	 * (In the _R variants, the new item is one of the right page's tuples.)
@@ -363,11 +484,15 @@ typedef struct xl_btree_vacuum
 	RelFileNode node;
 	BlockNumber block;
 	BlockNumber lastBlockVacuumed;
+	uint16		ndeleted;		/* number of items removed */
+	uint16		nupdated;		/* number of posting lists shrunk */
 
-	/* TARGET OFFSET NUMBERS FOLLOW */
+	/* DELETED TARGET OFFSET NUMBERS FOLLOW */
+	/* UPDATED TARGET OFFSET NUMBERS FOLLOW */
+	/* UPDATED INDEX TUPLES FOLLOW AT END OF STRUCT */
 } xl_btree_vacuum;
 
-#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, lastBlockVacuumed) + sizeof(BlockNumber))
+#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, nupdated) + sizeof(uint16))
 
 /*
  * This is what we need to know about deletion of a btree page.  The target
@@ -405,6 +530,22 @@ typedef struct xl_btree_newroot
 
 #define SizeOfBtreeNewroot	(offsetof(xl_btree_newroot, level) + sizeof(uint32))
 
+/*
+ * This is what we need to know about deduplication of a leaf page.  The
+ * intervals say which runs of items were merged into posting list tuples;
+ * replay merges the same runs again.
+ */
+typedef struct xl_btree_dedup
+{
+	RelFileNode node;
+	BlockNumber block;
+	uint16		nintervals;
+
+	/* BTDedupInterval ARRAY FOLLOWS */
+} xl_btree_dedup;
+
+#define SizeOfBtreeDedup	(offsetof(xl_btree_dedup, nintervals) + sizeof(uint16))
+
 
 /*
  *	Operator strategy numbers for B-tree have been moved to access/skey.h,
@@ -497,7 +638,9 @@ typedef struct BTScanPosData
 
 	/*
 	 * The items array is always ordered in index order (ie, increasing
-	 * indexoffset).  When scanning backwards it is convenient to fill the
+	 * indexoffset, and for the entries of one posting list tuple, increasing
+	 * heap TID).  There is one entry per heap TID, so a posting list tuple
+	 * takes several consecutive entries.  When scanning backwards it is convenient to fill the
 	 * array back-to-front, so we start at the last slot and fill downwards.
 	 * Hence we need both a first-valid-entry and a last-valid-entry counter.
 	 * itemIndex is a cursor showing which entry was last returned to caller.
@@ -506,7 +649,7 @@ typedef struct BTScanPosData
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
+	BTScanPosItem items[MaxBTreeTIDsPerPage];	/* MUST BE LAST */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -576,6 +719,17 @@ extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, int access);
 extern void _bt_insert_parent(Relation rel, Buffer buf, Buffer rbuf,
 				  BTStack stack, bool is_root, bool is_only);
 
+/*
+ * prototypes for functions in nbtdedup.c
+ */
+extern bool _bt_dedup_one_page(Relation rel, Buffer buf);
+extern Page _bt_dedup_page(Page page, BTDedupInterval *intervals,
+			   int nintervals);
+extern bool _bt_keys_identical(IndexTuple itup1, IndexTuple itup2);
+extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
+				 int nhtids);
+extern IndexTuple _bt_strip_posting(IndexTuple itup);
+
 /*
  * prototypes for functions in nbtpage.c
  */
@@ -592,7 +746,9 @@ extern bool _bt_page_recyclable(Page page);
 extern void _bt_delitems_delete(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems, Relation heapRel);
 extern void _bt_delitems_vacuum(Relation rel, Buffer buf,
-		   OffsetNumber *itemnos, int nitems, BlockNumber lastBlockVacuumed);
+					OffsetNumber *itemnos, int nitems,
+					OffsetNumber *updatenos, IndexTuple *updated,
+					int nupdated, BlockNumber lastBlockVacuumed);
 extern int	_bt_pagedel(Relation rel, Buffer buf, BTStack stack);
 
 /*
@@ -623,6 +779,10 @@ extern bool _bt_checkkeys(IndexScanDesc scan,
 			  Page page, OffsetNumber offnum,
 			  ScanDirection dir, bool *continuescan);
 extern void _bt_killitems(IndexScanDesc scan, bool haveLock);
+extern int	_bt_keep_natts(Relation rel, IndexTuple lastleft,
+			   IndexTuple firstright);
+extern IndexTuple _bt_truncate(Relation rel, IndexTuple lastleft,
+			 IndexTuple firstright);
 extern BTCycleId _bt_vacuum_cycleid(Relation rel);
 extern BTCycleId _bt_start_vacuum(Relation rel);
 extern void _bt_end_vacuum(Relation rel);
@@ -32,6 +32,8 @@ typedef uint8 RmgrId;
 #define RM_GIN_ID				13
 #define RM_GIST_ID				14
 #define RM_SEQ_ID				15
-#define RM_MAX_ID				RM_SEQ_ID
+#define RM_SPGIST_ID			16
+#define RM_BRIN_ID				17
+#define RM_MAX_ID				RM_BRIN_ID
 
 #endif   /* RMGR_H */
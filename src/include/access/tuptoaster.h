@@ -23,6 +23,17 @@
  */
 #define TOAST_INDEX_HACK
 
+/*
+ * Compression methods for compressed-in-line datums.  The method is kept in
+ * the top bits of the datum's raw size word (see VARCOMPRESSMETHOD_4B_C in
+ * postgres.h), so there can be at most four, and the values must never be
+ * changed once used on disk.
+ */
+#define TOAST_PGLZ_COMPRESSION		0
+#define TOAST_LZ4_COMPRESSION		1
+
+/* GUC variable */
+extern int	default_toast_compression;
 
 /*
  * Find the maximum size of a tuple if there are to be N tuples per page.
@@ -144,6 +155,33 @@ extern struct varlena *heap_tuple_untoast_attr_slice(struct varlena * attr,
 							  int32 sliceoffset,
 							  int32 slicelength);
 
+/* ----------
+ * DetoastIterator -
+ *
+ *	State for detoasting a value piece by piece, for callers that may not
+ *	need all of it.  The first avail bytes of buf hold the start of the
+ *	value's raw data, which is rawsize bytes long in all.
+ *
+ *	detoast_begin_iterate() sets one up; detoast_iterate(iter, n) makes
+ *	sure at least n bytes are available (fewer only if the value is
+ *	shorter), fetching and decompressing no more than it must; and
+ *	detoast_end_iterate() releases everything.
+ * ----------
+ */
+typedef struct DetoastIteratorData
+{
+	char	   *buf;			/* raw data */
+	int32		avail;			/* number of valid bytes at start of buf */
+	int32		rawsize;		/* total length of the raw data */
+	struct DetoastIteratorState *state; /* private; NULL if all in memory */
+} DetoastIteratorData;
+
+typedef DetoastIteratorData *DetoastIterator;
+
+extern DetoastIterator detoast_begin_iterate(struct varlena * attr);
+extern void detoast_iterate(DetoastIterator iter, int32 upto);
+extern void detoast_end_iterate(DetoastIterator iter);
+
 /* ----------
  * toast_flatten_tuple_attribute -
  *
@@ -162,7 +200,23 @@ extern Datum toast_flatten_tuple_attribute(Datum value,
  *	Create a compressed version of a varlena datum, if possible
  * ----------
  */
-extern Datum toast_compress_datum(Datum value);
+extern Datum toast_compress_datum(Datum value, int method);
+
+/* ----------
+ * toast_compression_method -
+ *
+ *	Look up a compression method by name; -1 if there's no such method
+ * ----------
+ */
+extern int	toast_compression_method(const char *name);
+
+/* ----------
+ * toast_validate_compression_option -
+ *
+ *	Validator for the "compression" attribute option
+ * ----------
+ */
+extern void toast_validate_compression_option(char *value);
 
 /* ----------
  * toast_raw_datum_size -
@@ -694,4 +694,87 @@ DATA(insert (	3683   3615 3615 5	 3679 403 ));
 DATA(insert (	3702   3615 3615 7	3693 783 ));
 DATA(insert (	3702   3615 3615 8	3694 783 ));
 
+/*
+ * SP-GiST quad_point_ops
+ */
+DATA(insert (	4015   600 600 11 506 4000 ));
+DATA(insert (	4015   600 600 1  507 4000 ));
+DATA(insert (	4015   600 600 5  508 4000 ));
+DATA(insert (	4015   600 600 10 509 4000 ));
+DATA(insert (	4015   600 600 6  510 4000 ));
+DATA(insert (	4015   600 603 8  511 4000 ));
+
+/*
+ * SP-GiST kd_point_ops
+ */
+DATA(insert (	4016   600 600 11 506 4000 ));
+DATA(insert (	4016   600 600 1  507 4000 ));
+DATA(insert (	4016   600 600 5  508 4000 ));
+DATA(insert (	4016   600 600 10 509 4000 ));
+DATA(insert (	4016   600 600 6  510 4000 ));
+DATA(insert (	4016   600 603 8  511 4000 ));
+
+/*
+ * SP-GiST text_ops
+ */
+DATA(insert (	4017   25 25 1 2314 4000 ));
+DATA(insert (	4017   25 25 2 2315 4000 ));
+DATA(insert (	4017   25 25 3 98	4000 ));
+DATA(insert (	4017   25 25 4 2317 4000 ));
+DATA(insert (	4017   25 25 5 2318 4000 ));
+
+/*
+ * BRIN int4_minmax_ops
+ */
+DATA(insert (	4045   23 23 1 97	4032 ));
+DATA(insert (	4045   23 23 2 523	4032 ));
+DATA(insert (	4045   23 23 3 96	4032 ));
+DATA(insert (	4045   23 23 4 525	4032 ));
+DATA(insert (	4045   23 23 5 521	4032 ));
+
+/*
+ * BRIN int8_minmax_ops
+ */
+DATA(insert (	4046   20 20 1 412	4032 ));
+DATA(insert (	4046   20 20 2 414	4032 ));
+DATA(insert (	4046   20 20 3 410	4032 ));
+DATA(insert (	4046   20 20 4 415	4032 ));
+DATA(insert (	4046   20 20 5 413	4032 ));
+
+/*
+ * BRIN float8_minmax_ops
+ */
+DATA(insert (	4047   701 701 1 672	4032 ));
+DATA(insert (	4047   701 701 2 673	4032 ));
+DATA(insert (	4047   701 701 3 670	4032 ));
+DATA(insert (	4047   701 701 4 675	4032 ));
+DATA(insert (	4047   701 701 5 674	4032 ));
+
+/*
+ * BRIN date_minmax_ops
+ */
+DATA(insert (	4048   1082 1082 1 1095	4032 ));
+DATA(insert (	4048   1082 1082 2 1096	4032 ));
+DATA(insert (	4048   1082 1082 3 1093	4032 ));
+DATA(insert (	4048   1082 1082 4 1098	4032 ));
+DATA(insert (	4048   1082 1082 5 1097	4032 ));
+
+/*
+ * BRIN timestamp_minmax_ops
+ */
+DATA(insert (	4049   1114 1114 1 2062	4032 ));
+DATA(insert (	4049   1114 1114 2 2063	4032 ));
+DATA(insert (	4049   1114 1114 3 2060	4032 ));
+DATA(insert (	4049   1114 1114 4 2065	4032 ));
+DATA(insert (	4049   1114 1114 5 2064	4032 ));
+
+/*
+ * BRIN timestamptz_minmax_ops
+ */
+DATA(insert (	4050   1184 1184 1 1322	4032 ));
+DATA(insert (	4050   1184 1184 2 1323	4032 ));
+DATA(insert (	4050   1184 1184 3 1320	4032 ));
+DATA(insert (	4050   1184 1184 4 1325	4032 ));
+DATA(insert (	4050   1184 1184 5 1324	4032 ));
+
 #endif   /* PG_AMOP_H */
@@ -212,5 +212,14 @@ DATA(insert (	783		tsvector_ops		PGNSP PGUID 3655  3614 t 3642 ));
 DATA(insert (	2742	tsvector_ops		PGNSP PGUID 3659  3614 t 25 ));
 DATA(insert (	403		tsquery_ops			PGNSP PGUID 3683  3615 t 0 ));
 DATA(insert (	783		tsquery_ops			PGNSP PGUID 3702  3615 t 20 ));
+DATA(insert (	4000	quad_point_ops		PGNSP PGUID 4015  600 t 0 ));
+DATA(insert (	4000	kd_point_ops		PGNSP PGUID 4016  600 f 0 ));
+DATA(insert (	4000	text_ops			PGNSP PGUID 4017  25 t 0 ));
+DATA(insert (	4032	int4_minmax_ops	PGNSP PGUID 4045  23 t 0 ));
+DATA(insert (	4032	int8_minmax_ops	PGNSP PGUID 4046  20 t 0 ));
+DATA(insert (	4032	float8_minmax_ops	PGNSP PGUID 4047  701 t 0 ));
+DATA(insert (	4032	date_minmax_ops	PGNSP PGUID 4048  1082 t 0 ));
+DATA(insert (	4032	timestamp_minmax_ops	PGNSP PGUID 4049  1114 t 0 ));
+DATA(insert (	4032	timestamptz_minmax_ops	PGNSP PGUID 4050  1184 t 0 ));
 
 #endif   /* PG_OPCLASS_H */
@@ -138,5 +138,14 @@ DATA(insert OID = 3655 (	783		tsvector_ops	PGNSP PGUID ));
 DATA(insert OID = 3659 (	2742	tsvector_ops	PGNSP PGUID ));
 DATA(insert OID = 3683 (	403		tsquery_ops		PGNSP PGUID ));
 DATA(insert OID = 3702 (	783		tsquery_ops		PGNSP PGUID ));
+DATA(insert OID = 4015 (	4000	quad_point_ops	PGNSP PGUID ));
+DATA(insert OID = 4016 (	4000	kd_point_ops	PGNSP PGUID ));
+DATA(insert OID = 4017 (	4000	text_ops		PGNSP PGUID ));
+DATA(insert OID = 4045 (	4032	int4_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4046 (	4032	int8_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4047 (	4032	float8_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4048 (	4032	date_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4049 (	4032	timestamp_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4050 (	4032	timestamptz_minmax_ops	PGNSP PGUID ));
 
 #endif   /* PG_OPFAMILY_H */
@@ -138,6 +138,40 @@ typedef struct HashJoinTableData
 	BufFile   **innerBatchFile; /* buffered virtual temp file per batch */
 	BufFile   **outerBatchFile; /* buffered virtual temp file per batch */
 
+	/*
+	 * batchSpace[i] is the space taken by inner tuples assigned to batch i,
+	 * whether in memory or in its temp file.  It is allocated whenever the
+	 * file arrays are.
+	 *
+	 * During the first pass, batchResident[i] is true if batch i has never
+	 * been written out, so that all of its inner tuples are in the in-memory
+	 * hash table alongside those of batch 0.  Outer tuples belonging to a
+	 * resident batch are joined immediately instead of being written out.
+	 * When we run out of space, the biggest resident batches are destaged to
+	 * their temp files before we resort to increasing nbatch.  The array is
+	 * NULL when no batch can be resident, in particular after the first pass.
+	 */
+	Size	   *batchSpace;		/* inner space per batch */
+	bool	   *batchResident;	/* is batch held entirely in memory? */
+
+	/*
+	 * If a batch's inner tuples don't fit in spaceAllowed and we can't split
+	 * the batch any further, we fall back to a block nested loop: the inner
+	 * batch is loaded one work_mem-sized chunk at a time, and the outer batch
+	 * is rescanned for each chunk.  For anything but an inner join, we must
+	 * remember which outer tuples have found a match in earlier chunks; they
+	 * are identified by their ordinal position in the outer batch file.
+	 */
+	bool		curbatchFallback;	/* is curbatch being joined in chunks? */
+	bool		curbatchOverflow;	/* send more curbatch tuples to its file? */
+	bool		curchunkLast;	/* is the current chunk the last one? */
+	int			curchunk;		/* chunk # within curbatch; 0 for first */
+	int			nbatchFallback; /* # of batches that needed > 1 chunk */
+	long		outerTupleCount;	/* # outer tuples of curbatch seen in
+									 * this chunk */
+	uint8	   *outerMatched;	/* bitmap of outer tuples matched so far */
+	long		outerMatchedLen;	/* allocated length of outerMatched */
+
 	/*
 	 * Info about the datatype-specific hash functions for the datatypes being
 	 * hashed. These are arrays of the same length as the number of hash join
@@ -147,14 +181,43 @@ typedef struct HashJoinTableData
 	FmgrInfo   *inner_hashfunctions;	/* lookup data for hash functions */
 	bool	   *hashStrict;		/* is each hash join operator strict? */
 
-	Size		spaceUsed;		/* memory space currently used by tuples */
+	Size		spaceUsed;		/* memory space currently used by tuples
+								 * and the bloom filter */
 	Size		spaceAllowed;	/* upper limit for space used */
 	Size		spacePeak;		/* peak space used */
 	Size		spaceUsedSkew;	/* skew hash table's current space usage */
 	Size		spaceAllowedSkew;		/* upper limit for skew hashtable */
+	Size		spaceUsedBloom; /* bloom filter's share of spaceUsed */
 
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
+
+	/*
+	 * Bloom filter over the hash values of all inner tuples, or NULL if we
+	 * aren't using one.  See notes at ExecHashBloomAdd.
+	 */
+	uint32	   *bloomFilter;	/* bit array, bloomMask + 1 bits long */
+	uint32		bloomMask;		/* # bits in filter - 1 (a power of 2 - 1) */
+	uint32		bloomBitsSet;	/* # bits currently set in filter */
+	double		bloomProbes;	/* # outer tuples checked against filter */
+	double		bloomRejected;	/* # outer tuples rejected by filter */
 } HashJoinTableData;
 
+/*
+ * Parameters for the inner-side bloom filter.  We aim for about
+ * BLOOM_BITS_PER_TUPLE bits per (estimated) inner tuple and set
+ * BLOOM_NUM_PROBES bits per hash value, giving a false positive rate of
+ * around 3% when the estimate is right.  The filter is dropped if it ends up
+ * more than half full, or if it isn't rejecting at least 1 in
+ * BLOOM_MIN_REJECT_RATIO of the first BLOOM_CHECK_PROBES outer tuples.
+ */
+#define BLOOM_BITS_PER_TUPLE	8
+#define BLOOM_NUM_PROBES		3
+#define BLOOM_MIN_BITS			(1 << 13)
+#define BLOOM_CHECK_PROBES		1000
+#define BLOOM_MIN_REJECT_RATIO	20
+
+#define HashBatchIsResident(hashtable, batchno) \
+	((hashtable)->batchResident != NULL && (hashtable)->batchResident[batchno])
+
 #endif   /* HASHJOIN_H */
@@ -0,0 +1,41 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.h
+ *	  Compact in-memory set of heap tuple TIDs.
+ *
+ *	  A TidStore is filled one heap block at a time, in ascending block
+ *	  order, and can then be probed for any TID in constant time, or read
+ *	  back block by block.  See tidstore.c for the representation.
+ *
+ *
+ * Portions Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * $PostgreSQL$
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TIDSTORE_H
+#define TIDSTORE_H
+
+#include "storage/itemptr.h"
+
+typedef struct TidStore TidStore;		/* opaque */
+typedef struct TidStoreIter TidStoreIter;		/* opaque */
+
+extern TidStore *tidstore_create(Size max_bytes, BlockNumber nblocks);
+extern void tidstore_free(TidStore *ts);
+extern void tidstore_reset(TidStore *ts);
+extern void tidstore_add_offsets(TidStore *ts, BlockNumber blkno,
+					 OffsetNumber *offsets, int noffsets);
+extern bool tidstore_lookup(TidStore *ts, ItemPointer tid);
+extern bool tidstore_is_full(TidStore *ts);
+extern double tidstore_num_tids(TidStore *ts);
+extern Size tidstore_memory_usage(TidStore *ts);
+
+extern TidStoreIter *tidstore_begin_iterate(TidStore *ts);
+extern bool tidstore_iterate_next(TidStoreIter *iter, BlockNumber *blkno,
+					  OffsetNumber *offsets, int *noffsets);
+extern void tidstore_end_iterate(TidStoreIter *iter);
+
+#endif   /* TIDSTORE_H */
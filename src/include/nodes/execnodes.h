@@ -1508,6 +1508,44 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+/* ----------------
+ *	 MemoizeState information
+ *
+ *		memoize nodes keep a hash table mapping cache key values to the
+ *		tuples the subplan returned for them.  The entries are also kept
+ *		on a doubly-linked list in least-recently-used order, so that the
+ *		oldest ones can be evicted when the cache outgrows work_mem.  The
+ *		entry and tuple structs are private to nodeMemoize.c.
+ * ----------------
+ */
+typedef struct MemoizeState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			mstatus;		/* current state, see nodeMemoize.c */
+	int			numKeys;		/* number of cache key columns */
+	List	   *param_exprs;	/* ExprStates for the cache keys */
+	Bitmapset  *keyparamids;	/* paramids of the cache keys */
+	AttrNumber *keyColIdx;		/* key columns of probeslot: 1..numKeys */
+	FmgrInfo   *eqfunctions;	/* per-key equality fns */
+	FmgrInfo   *hashfunctions;	/* per-key hash fns */
+	TupleTableSlot *probeslot;	/* holds a cache key for hash lookups */
+	MemoryContext tableContext; /* holds hash table and cached tuples */
+	MemoryContext tempContext;	/* short-term context for hashing */
+	TupleHashTable hashtable;	/* the cache */
+	struct MemoizeEntryData *lru_head;	/* least recently used entry */
+	struct MemoizeEntryData *lru_tail;	/* most recently used entry */
+	struct MemoizeEntryData *entry; /* entry being read or filled */
+	struct MemoizeTupleData *next_tuple;	/* next cached tuple to return */
+	bool		outer_used;		/* subplan run since its last rescan? */
+	Size		mem_used;		/* memory used by cache entries */
+	Size		mem_limit;		/* work_mem, in bytes */
+	Size		mem_peak;		/* peak of mem_used, for EXPLAIN */
+	long		hits;			/* # lookups answered from the cache */
+	long		misses;			/* # lookups that had to run the subplan */
+	long		evictions;		/* # entries evicted to make room */
+	long		overflows;		/* # results too big to cache at all */
+} MemoizeState;
+
 /* ----------------
  *	 SortState information
  * ----------------
@@ -1524,6 +1562,31 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *		group_pivot holds the first tuple of the next group to be sorted
+ *		(we have to read one tuple past the end of each group to find it).
+ *		A group of a single tuple is returned directly, without sorting.
+ * ----------------
+ */
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	int64		tuples_returned;	/* # tuples returned so far */
+	bool		finished;		/* have we read all the input? */
+	bool		group_Done;		/* is the current group sorted yet? */
+	FmgrInfo   *eqfunctions;	/* equality fns for presorted columns */
+	MemoryContext tempContext;	/* short-term context for comparisons */
+	TupleTableSlot *group_pivot;	/* first tuple of next group */
+	void	   *tuplesortstate; /* tuplesort.c state for current group */
+	int64		groups_sorted;	/* # groups that needed a sort */
+	long		max_space_used; /* biggest sort's space use, in kB */
+	const char *max_space_type; /* "Memory" or "Disk" for max_space_used */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * -------------------------
@@ -492,6 +492,24 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		memoize node
+ *
+ * Memoize caches the output of its subplan for each distinct value of a
+ * cache key, which is a list of PARAM_EXEC Params set by an enclosing
+ * nestloop.  A rescan with a key that has been seen before returns the
+ * cached tuples instead of running the subplan again.
+ * ----------------
+ */
+typedef struct Memoize
+{
+	Plan		plan;
+	int			numKeys;		/* number of cache key columns */
+	Oid		   *hashOperators;	/* hashable equality operators for keys */
+	List	   *param_exprs;	/* cache keys, as Params */
+	long		est_entries;	/* estimated number of distinct keys */
+} Memoize;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -505,6 +523,20 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is already sorted by the first presortedCols of the sort keys,
+ * so we need only sort each group of tuples that are equal on those columns
+ * by the remaining keys.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			presortedCols;	/* number of presorted leading sort keys */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
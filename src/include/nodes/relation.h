@@ -780,6 +780,26 @@ typedef struct MaterialPath
 	Path	   *subpath;
 } MaterialPath;
 
+/*
+ * MemoizePath represents use of a Memoize plan node, i.e., caching of the
+ * results of a parameterized nestloop inner path for each distinct set of
+ * parameter values.  param_exprs are the outer-relation Vars that make up
+ * the cache key, and hash_operators their hashable equality operators.
+ * calls is the expected number of rescans (outer rows); est_entries and
+ * hit_ratio are the estimated number of cache entries and the fraction of
+ * rescans expected to be answered from the cache.
+ */
+typedef struct MemoizePath
+{
+	Path		path;
+	Path	   *subpath;
+	List	   *param_exprs;	/* cache keys */
+	List	   *hash_operators; /* equality operators for the keys */
+	double		calls;			/* expected number of rescans */
+	double		est_entries;	/* expected number of cache entries */
+	double		hit_ratio;		/* expected fraction of cache hits */
+} MemoizePath;
+
 /*
  * UniquePath represents elimination of distinct rows from the output of
  * its subpath.
@@ -34,6 +34,9 @@ extern void estimate_rel_size(Relation rel, int32 *attr_widths,
 extern bool relation_excluded_by_constraints(PlannerInfo *root,
 								 RelOptInfo *rel, RangeTblEntry *rte);
 
+extern List *get_relation_key_constraints(PlannerInfo *root, RelOptInfo *rel,
+							 Var *keyvar, Expr *keyexpr, bool *key_notnull);
+
 extern List *build_physical_tlist(PlannerInfo *root, RelOptInfo *rel);
 
 extern bool has_unique_index(RelOptInfo *rel, AttrNumber attno);
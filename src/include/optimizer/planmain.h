@@ -16,6 +16,7 @@
 
 #include "nodes/plannodes.h"
 #include "nodes/relation.h"
+#include "optimizer/clauses.h"
 
 /* GUC parameters */
 #define DEFAULT_CURSOR_TUPLE_FRACTION 0.1
@@ -34,6 +35,10 @@ extern void query_planner(PlannerInfo *root, List *tlist,
  */
 extern Plan *optimize_minmax_aggregates(PlannerInfo *root, List *tlist,
 						   Path *best_path);
+extern Plan *partitionwise_grouping_plan(PlannerInfo *root, Path *best_path,
+							List *tlist, List *sub_tlist,
+							AttrNumber *groupColIdx, Oid *groupOperators,
+							double dNumGroups, AggClauseCounts *agg_counts);
 
 /*
  * prototypes for plan/createplan.c
@@ -49,6 +54,9 @@ extern RecursiveUnion *make_recursive_union(List *tlist,
 					 List *distinctList, long numGroups);
 extern Sort *make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree,
 						List *pathkeys, double limit_tuples);
+extern Plan *make_sort_from_presorted_pathkeys(PlannerInfo *root,
+								  Plan *lefttree, List *pathkeys,
+								  List *input_pathkeys, double limit_tuples);
 extern Sort *make_sort_from_sortclauses(PlannerInfo *root, List *sortcls,
 						   Plan *lefttree);
 extern Sort *make_sort_from_groupcols(PlannerInfo *root, List *groupcls,
@@ -91,7 +91,8 @@ typedef union
 	struct						/* Compressed-in-line format */
 	{
 		uint32		va_header;
-		uint32		va_rawsize; /* Original data size (excludes header) */
+		uint32		va_rawsize; /* Original data size (excludes header) and
+								 * compression method; see below */
 		char		va_data[1]; /* Compressed data */
 	}			va_compressed;
 } varattrib_4b;
@@ -222,8 +223,22 @@ typedef struct
 #define VARDATA_1B(PTR)		(((varattrib_1b *) (PTR))->va_data)
 #define VARDATA_1B_E(PTR)	(((varattrib_1b_e *) (PTR))->va_data)
 
+/*
+ * The raw size of a compressed-in-line datum can't exceed 1GB, so only the
+ * low 30 bits of va_rawsize are needed for it.  The top two bits say which
+ * compression method was used (see tuptoaster.h); they are zero for data
+ * compressed with pglz, which was the only method in older releases.
+ */
+#define VARRAWSIZE_BITS		30
+#define VARRAWSIZE_MASK		((1U << VARRAWSIZE_BITS) - 1)
+
 #define VARRAWSIZE_4B_C(PTR) \
-	(((varattrib_4b *) (PTR))->va_compressed.va_rawsize)
+	(((varattrib_4b *) (PTR))->va_compressed.va_rawsize & VARRAWSIZE_MASK)
+#define VARCOMPRESSMETHOD_4B_C(PTR) \
+	(((varattrib_4b *) (PTR))->va_compressed.va_rawsize >> VARRAWSIZE_BITS)
+#define SET_VARRAWSIZE_4B_C(PTR, len, method) \
+	(((varattrib_4b *) (PTR))->va_compressed.va_rawsize = \
+	 ((uint32) (len)) | ((uint32) (method) << VARRAWSIZE_BITS))
 
 /* Externally visible macros */
 
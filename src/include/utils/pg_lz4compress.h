@@ -0,0 +1,56 @@
+/* ----------
+ * pg_lz4compress.h -
+ *
+ *	Definitions for the builtin LZ4-format compressor
+ *
+ * $PostgreSQL$
+ * ----------
+ */
+
+#ifndef _PG_LZ4COMPRESS_H_
+#define _PG_LZ4COMPRESS_H_
+
+
+/* ----------
+ * PG_LZ4_MIN_INPUT_SIZE -
+ *
+ *		Inputs shorter than this are not worth compressing; the result is
+ *		practically never enough smaller to pay for the compressed header.
+ * ----------
+ */
+#define PG_LZ4_MIN_INPUT_SIZE			32
+
+
+/* ----------
+ * PG_LZ4_DecompressState -
+ *
+ *		Progress of an incremental decompression, see
+ *		pg_lz4_decompress_partial().
+ * ----------
+ */
+typedef struct PG_LZ4_DecompressState
+{
+	int32		srcpos;			/* bytes of compressed data consumed */
+	int32		dstpos;			/* bytes of output produced */
+	bool		inseq;			/* token read, match part not yet? */
+	unsigned char token;		/* token of the current sequence */
+	int32		litlen;			/* literal bytes not yet copied */
+	int32		matchlen;		/* match bytes not yet copied */
+	int32		matchoff;		/* and how far back they come from */
+} PG_LZ4_DecompressState;
+
+
+/* ----------
+ * Global function declarations
+ * ----------
+ */
+extern int32 pg_lz4_compress(const char *source, int32 slen,
+				char *dest, int32 dcapacity);
+extern int32 pg_lz4_decompress(const char *source, int32 slen,
+				  char *dest, int32 rawsize);
+extern void pg_lz4_decompress_init(PG_LZ4_DecompressState *state);
+extern bool pg_lz4_decompress_partial(PG_LZ4_DecompressState *state,
+						  const char *source, int32 slen, bool complete,
+						  char *dest, int32 dlen);
+
+#endif   /* _PG_LZ4COMPRESS_H_ */
@@ -101,6 +101,24 @@ extern const PGLZ_Strategy *const PGLZ_strategy_default;
 extern const PGLZ_Strategy *const PGLZ_strategy_always;
 
 
+/* ----------
+ * PGLZ_DecompressState -
+ *
+ *		Progress of an incremental decompression, see
+ *		pglz_decompress_partial().
+ * ----------
+ */
+typedef struct PGLZ_DecompressState
+{
+	int32		srcpos;			/* bytes of compressed data consumed */
+	int32		dstpos;			/* bytes of output produced */
+	unsigned char ctrl;			/* remaining bits of the control byte */
+	int			ctrlc;			/* number of items they still cover */
+	int32		matchlen;		/* bytes of a match not yet copied */
+	int32		matchoff;		/* and how far back they come from */
+} PGLZ_DecompressState;
+
+
 /* ----------
  * Global function declarations
  * ----------
@@ -108,5 +126,9 @@ extern const PGLZ_Strategy *const PGLZ_strategy_always;
 extern bool pglz_compress(const char *source, int32 slen, PGLZ_Header *dest,
 			  const PGLZ_Strategy *strategy);
 extern void pglz_decompress(const PGLZ_Header *source, char *dest);
+extern void pglz_decompress_init(PGLZ_DecompressState *state);
+extern void pglz_decompress_partial(PGLZ_DecompressState *state,
+						const char *source, int32 slen, bool complete,
+						char *dest, int32 dlen);
 
 #endif   /* _PG_LZCOMPRESS_H_ */
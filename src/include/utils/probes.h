@@ -0,0 +1 @@
+../../../src/backend/utils/probes.h
\ No newline at end of file
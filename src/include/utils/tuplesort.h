@@ -43,10 +43,12 @@ typedef struct Tuplesortstate Tuplesortstate;
  * rather than forming actual HeapTuples (which'd have to be converted to
  * MinimalTuples).
  *
- * The IndexTuple case is itself broken into two subcases, one for btree
- * indexes and one for hash indexes; the latter variant actually sorts
- * the tuples by hash code.  The API is the same except for the "begin"
- * routine.
+ * The IndexTuple case is itself broken into three subcases, one for btree
+ * indexes, one for hash indexes and one for GiST indexes.  The hash variant
+ * actually sorts the tuples by hash code, and the GiST variant by a 64-bit
+ * sort key that the caller computes for each tuple.  The API is the same
+ * except for the "begin" routine, and that GiST tuples are passed in with
+ * tuplesort_putgisttuple.
  *
  * Yet another slightly different interface supports sorting bare Datums.
  */
@@ -61,6 +63,8 @@ extern Tuplesortstate *tuplesort_begin_index_btree(Relation indexRel,
 extern Tuplesortstate *tuplesort_begin_index_hash(Relation indexRel,
 						   uint32 hash_mask,
 						   int workMem, bool randomAccess);
+extern Tuplesortstate *tuplesort_begin_index_gist(Relation indexRel,
+						   int workMem, bool randomAccess);
 extern Tuplesortstate *tuplesort_begin_datum(Oid datumType,
 					  Oid sortOperator, bool nullsFirstFlag,
 					  int workMem, bool randomAccess);
@@ -70,6 +74,8 @@ extern void tuplesort_set_bound(Tuplesortstate *state, int64 bound);
 extern void tuplesort_puttupleslot(Tuplesortstate *state,
 					   TupleTableSlot *slot);
 extern void tuplesort_putindextuple(Tuplesortstate *state, IndexTuple tuple);
+extern void tuplesort_putgisttuple(Tuplesortstate *state, IndexTuple tuple,
+					   int64 sortkey);
 extern void tuplesort_putdatum(Tuplesortstate *state, Datum val,
 				   bool isNull);
 
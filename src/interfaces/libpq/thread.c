@@ -0,0 +1 @@
+../../../src/port/thread.c
\ No newline at end of file
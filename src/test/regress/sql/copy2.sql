@@ -164,6 +164,31 @@ c\.d
 
 COPY testeoc TO stdout CSV;
 
+-- test rows buffered for multi-insert: index entries and error reporting
+CREATE TEMP TABLE testmulti (a int PRIMARY KEY, b text);
+
+COPY testmulti FROM stdin;
+1	one
+2	two
+3	three
+\.
+
+COPY testmulti FROM stdin;
+4	four
+2	two again
+5	five
+\.
+
+SELECT * FROM testmulti WHERE a = 2;
+
+-- a quoted CSV field spanning lines must not throw off the reported line
+COPY testmulti FROM stdin CSV;
+6,six
+7,"seven
+continued"
+7,seven again
+\.
+
 DROP TABLE x, y;
 DROP FUNCTION fn_x_before();
 DROP FUNCTION fn_x_after();
@@ -426,3 +426,329 @@ RESET enable_indexscan;
 RESET enable_bitmapscan;
  
 DROP TABLE onek_with_null;
+
+--
+-- Tests for b-tree indexes with many duplicates, which are stored as
+-- posting lists
+--
+CREATE TABLE dedup_tbl (a int4, c int4);
+INSERT INTO dedup_tbl SELECT i % 10, i FROM generate_series(1, 5000) i;
+CREATE INDEX dedup_tbl_a ON dedup_tbl (a);
+INSERT INTO dedup_tbl SELECT i % 10, i FROM generate_series(5001, 10000) i;
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+SELECT count(*) FROM dedup_tbl WHERE a = 3;
+SELECT count(*) FROM dedup_tbl WHERE a < 5;
+SELECT sum(c) FROM (SELECT c FROM dedup_tbl WHERE a = 5 ORDER BY a DESC) ss;
+
+DELETE FROM dedup_tbl WHERE a = 4 AND c % 3 = 0;
+VACUUM dedup_tbl;
+
+SELECT count(*) FROM dedup_tbl WHERE a = 4;
+SELECT count(*) FROM dedup_tbl WHERE a < 5;
+
+SET enable_indexscan = OFF;
+SET enable_bitmapscan = ON;
+
+SELECT count(*) FROM dedup_tbl WHERE a = 4;
+
+RESET enable_seqscan;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+
+DROP TABLE dedup_tbl;
+
+--
+-- Tests for b-tree indexes on wide multi-column keys, whose high keys and
+-- downlinks are truncated to the attributes needed to separate pages
+--
+CREATE TABLE trunc_tbl (a text, b text, c int4);
+CREATE INDEX trunc_tbl_abc ON trunc_tbl (a, b, c);
+INSERT INTO trunc_tbl
+  SELECT 'prefix-' || (i % 20), repeat('x', 100) || i, i
+  FROM generate_series(1, 5000) i;
+CREATE UNIQUE INDEX trunc_tbl_ca ON trunc_tbl (c, a);
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+SELECT count(*) FROM trunc_tbl WHERE a = 'prefix-7';
+SELECT count(*) FROM trunc_tbl
+  WHERE a = 'prefix-7' AND b = repeat('x', 100) || '4007';
+SELECT count(*) FROM trunc_tbl
+  WHERE a = 'prefix-7' AND b = repeat('x', 100) || '4007' AND c = 4007;
+SELECT c FROM trunc_tbl WHERE a = 'prefix-7' ORDER BY a DESC, b DESC LIMIT 3;
+SELECT count(*) FROM trunc_tbl WHERE c BETWEEN 100 AND 199;
+INSERT INTO trunc_tbl VALUES ('prefix-1', 'dup', 1);
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE trunc_tbl;
+
+--
+-- Tests for GiST indexes built with the buffering algorithm
+--
+CREATE TABLE gist_buffering_tbl (p point);
+INSERT INTO gist_buffering_tbl
+  SELECT point(i % 100, i / 100) FROM generate_series(0, 19999) i;
+CREATE INDEX gist_buffering_idx ON gist_buffering_tbl USING gist (p)
+  WITH (buffering = on, fillfactor = 10);
+INSERT INTO gist_buffering_tbl VALUES (point(5.5, 5.5));
+
+SET enable_seqscan = OFF;
+
+SELECT count(*) FROM gist_buffering_tbl WHERE p <@ box '(0,0),(9.5,9.5)';
+SELECT count(*) FROM gist_buffering_tbl WHERE p <@ box '(50,50),(59.5,149.5)';
+SELECT count(*) FROM gist_buffering_tbl WHERE p ~= point(99, 199);
+
+RESET enable_seqscan;
+
+CREATE INDEX gist_buffering_bad ON gist_buffering_tbl USING gist (p)
+  WITH (buffering = maybe);
+ALTER INDEX gist_buffering_idx SET (buffering = off);
+
+DROP TABLE gist_buffering_tbl;
+
+--
+-- Tests for GiST indexes built by sorting
+--
+CREATE TABLE gist_sorted_tbl (p point);
+INSERT INTO gist_sorted_tbl
+  SELECT point(i % 100, i / 100) FROM generate_series(0, 19999) i;
+INSERT INTO gist_sorted_tbl VALUES (NULL);
+CREATE INDEX gist_sorted_idx ON gist_sorted_tbl USING gist (p)
+  WITH (fillfactor = 10);
+INSERT INTO gist_sorted_tbl VALUES (point(5.5, 5.5));
+
+SET enable_seqscan = OFF;
+
+SELECT count(*) FROM gist_sorted_tbl WHERE p <@ box '(0,0),(9.5,9.5)';
+SELECT count(*) FROM gist_sorted_tbl WHERE p <@ box '(50,50),(59.5,149.5)';
+SELECT count(*) FROM gist_sorted_tbl WHERE p ~= point(99, 199);
+SELECT count(*) FROM gist_sorted_tbl WHERE p IS NULL;
+
+RESET enable_seqscan;
+
+DROP TABLE gist_sorted_tbl;
+
+--
+-- Tests for SP-GiST indexes
+--
+CREATE TABLE quad_point_tbl (p point);
+INSERT INTO quad_point_tbl
+  SELECT point(x, y) FROM generate_series(1, 100) x, generate_series(1, 100) y;
+INSERT INTO quad_point_tbl SELECT '(1000,1000)' FROM generate_series(1, 500);
+INSERT INTO quad_point_tbl VALUES (NULL), (NULL);
+CREATE INDEX sp_quad_ind ON quad_point_tbl USING spgist (p);
+INSERT INTO quad_point_tbl SELECT '(1000,1000)' FROM generate_series(1, 500);
+INSERT INTO quad_point_tbl
+  SELECT point(x + 0.5, 50.5) FROM generate_series(1, 100) x;
+
+CREATE TABLE kd_point_tbl AS SELECT * FROM quad_point_tbl;
+CREATE INDEX sp_kd_ind ON kd_point_tbl USING spgist (p kd_point_ops);
+
+CREATE TABLE suffix_text_tbl (t text);
+INSERT INTO suffix_text_tbl SELECT 'P' || i FROM generate_series(1, 1000) i;
+INSERT INTO suffix_text_tbl SELECT 'Lucky' FROM generate_series(1, 250);
+INSERT INTO suffix_text_tbl
+  SELECT 'Lorem ipsum dolor sit amet ' || i FROM generate_series(1, 200) i;
+INSERT INTO suffix_text_tbl VALUES (''), (NULL);
+CREATE INDEX sp_suff_ind ON suffix_text_tbl USING spgist (t);
+INSERT INTO suffix_text_tbl SELECT 'Lucky' FROM generate_series(1, 250);
+INSERT INTO suffix_text_tbl VALUES ('Lorem ipsum dolor sit amet'), ('P');
+
+SET enable_seqscan = OFF;
+
+SELECT count(*) FROM quad_point_tbl WHERE p <@ box '(1,1),(10,10)';
+SELECT count(*) FROM quad_point_tbl WHERE p << '(10,0)';
+SELECT count(*) FROM quad_point_tbl WHERE p >> '(90,0)';
+SELECT count(*) FROM quad_point_tbl WHERE p <^ '(0,50)';
+SELECT count(*) FROM quad_point_tbl WHERE p >^ '(0,50)';
+SELECT count(*) FROM quad_point_tbl WHERE p ~= '(1000,1000)';
+SELECT count(*) FROM quad_point_tbl WHERE p ~= '(42,42)';
+SELECT count(*) FROM quad_point_tbl WHERE p ~= '(4.5,50.5)';
+SELECT count(*) FROM quad_point_tbl
+  WHERE p <@ box '(45,45),(55,55)' AND p << '(50,0)';
+
+SELECT count(*) FROM kd_point_tbl WHERE p <@ box '(1,1),(10,10)';
+SELECT count(*) FROM kd_point_tbl WHERE p << '(10,0)';
+SELECT count(*) FROM kd_point_tbl WHERE p >> '(90,0)';
+SELECT count(*) FROM kd_point_tbl WHERE p <^ '(0,50)';
+SELECT count(*) FROM kd_point_tbl WHERE p >^ '(0,50)';
+SELECT count(*) FROM kd_point_tbl WHERE p ~= '(1000,1000)';
+SELECT count(*) FROM kd_point_tbl WHERE p ~= '(42,42)';
+SELECT count(*) FROM kd_point_tbl WHERE p ~= '(4.5,50.5)';
+SELECT count(*) FROM kd_point_tbl
+  WHERE p <@ box '(45,45),(55,55)' AND p << '(50,0)';
+
+SELECT count(*) FROM suffix_text_tbl WHERE t = 'Lucky';
+SELECT count(*) FROM suffix_text_tbl WHERE t = 'P1000';
+SELECT count(*) FROM suffix_text_tbl WHERE t = 'P0';
+SELECT count(*) FROM suffix_text_tbl WHERE t = 'P';
+SELECT count(*) FROM suffix_text_tbl WHERE t = '';
+SELECT count(*) FROM suffix_text_tbl WHERE t ~<~ 'P2';
+SELECT count(*) FROM suffix_text_tbl WHERE t ~>=~ 'P9';
+SELECT count(*) FROM suffix_text_tbl WHERE t ~>~ 'Lorem ipsum dolor sit amet 5';
+SELECT count(*) FROM suffix_text_tbl WHERE t ~<=~ 'Lorem ipsum dolor sit amet 5';
+SELECT count(*) FROM suffix_text_tbl WHERE t ~>=~ 'Lorem' AND t ~<~ 'Lorf';
+
+-- Repeat a few of them as plain index scans
+SET enable_bitmapscan = OFF;
+
+SELECT count(*) FROM quad_point_tbl WHERE p <@ box '(1,1),(10,10)';
+SELECT count(*) FROM quad_point_tbl WHERE p ~= '(1000,1000)';
+SELECT count(*) FROM kd_point_tbl WHERE p >> '(90,0)';
+SELECT count(*) FROM kd_point_tbl WHERE p ~= '(1000,1000)';
+SELECT count(*) FROM suffix_text_tbl WHERE t = 'Lucky';
+SELECT count(*) FROM suffix_text_tbl WHERE t ~>=~ 'Lorem' AND t ~<~ 'Lorf';
+
+RESET enable_bitmapscan;
+
+-- Check that VACUUM cleans up, and that the freed space can be reused
+DELETE FROM quad_point_tbl WHERE p <^ '(0,50)';
+VACUUM quad_point_tbl;
+
+SELECT count(*) FROM quad_point_tbl WHERE p <^ '(0,50)';
+SELECT count(*) FROM quad_point_tbl WHERE p << '(10,0)';
+SELECT count(*) FROM quad_point_tbl WHERE p >^ '(0,50)';
+
+INSERT INTO quad_point_tbl
+  SELECT point(x, y) FROM generate_series(1, 100) x, generate_series(1, 49) y;
+
+SELECT count(*) FROM quad_point_tbl WHERE p <^ '(0,50)';
+SELECT count(*) FROM quad_point_tbl WHERE p << '(10,0)';
+
+RESET enable_seqscan;
+
+DROP TABLE quad_point_tbl;
+DROP TABLE kd_point_tbl;
+DROP TABLE suffix_text_tbl;
+
+--
+-- Tests for BRIN indexes
+--
+CREATE TABLE brin_test_tbl (id int4, ts timestamp, val float8);
+INSERT INTO brin_test_tbl
+  SELECT i, timestamp '2010-01-01' + i * interval '1 minute', (i % 100)::float8
+  FROM generate_series(1, 10000) i;
+
+CREATE INDEX brin_test_id_idx ON brin_test_tbl USING brin (id)
+  WITH (pages_per_range = 4);
+CREATE INDEX brin_test_ts_val_idx ON brin_test_tbl USING brin (ts, val)
+  WITH (pages_per_range = 2);
+
+-- only fixed-length types with an ordering can be summarized
+CREATE INDEX brin_test_fail_idx ON brin_test_tbl USING brin ((id::text));
+CREATE INDEX brin_test_fail_idx ON brin_test_tbl USING brin (id)
+  WITH (pages_per_range = 0);
+
+SET enable_seqscan = OFF;
+
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM brin_test_tbl WHERE id = 5000;
+SELECT count(*) FROM brin_test_tbl WHERE id = 5000;
+SELECT count(*) FROM brin_test_tbl WHERE id < 100;
+SELECT count(*) FROM brin_test_tbl WHERE id >= 9990;
+SELECT count(*) FROM brin_test_tbl WHERE id > 2000 AND id <= 2100;
+SELECT count(*) FROM brin_test_tbl WHERE ts < '2010-01-01 01:00';
+SELECT count(*) FROM brin_test_tbl WHERE ts >= '2010-01-07' AND val = 7;
+SELECT count(*) FROM brin_test_tbl WHERE val > 98.5 AND ts < '2010-01-02';
+
+-- New rows widen summarized ranges, or land in ranges that VACUUM will
+-- summarize; either way they must be found
+INSERT INTO brin_test_tbl VALUES (-1, '2000-01-01', 0.5);
+INSERT INTO brin_test_tbl
+  SELECT i, timestamp '2010-01-01' + i * interval '1 minute', (i % 100)::float8
+  FROM generate_series(10001, 12000) i;
+
+SELECT count(*) FROM brin_test_tbl WHERE id < 0;
+SELECT count(*) FROM brin_test_tbl WHERE id > 11990;
+SELECT count(*) FROM brin_test_tbl WHERE ts < '2001-01-01' AND val = 0.5;
+
+DELETE FROM brin_test_tbl WHERE id > 11000;
+VACUUM brin_test_tbl;
+
+SELECT count(*) FROM brin_test_tbl WHERE id < 0;
+SELECT count(*) FROM brin_test_tbl WHERE id > 10990;
+SELECT count(*) FROM brin_test_tbl WHERE id BETWEEN 10500 AND 10600;
+
+-- Updates that change only BRIN-indexed columns can be HOT, but the BRIN
+-- index must still see the new values
+CREATE TABLE brin_hot_tbl (id int4, ts timestamp) WITH (fillfactor = 50);
+INSERT INTO brin_hot_tbl
+  SELECT i, timestamp '2010-01-01' + i * interval '1 minute'
+  FROM generate_series(1, 1000) i;
+CREATE INDEX brin_hot_id_idx ON brin_hot_tbl (id);
+CREATE INDEX brin_hot_ts_idx ON brin_hot_tbl USING brin (ts);
+BEGIN;
+UPDATE brin_hot_tbl SET ts = '2000-01-01' WHERE id = 500;
+SELECT pg_stat_get_xact_tuples_hot_updated('brin_hot_tbl'::regclass);
+COMMIT;
+SELECT id FROM brin_hot_tbl WHERE ts < '2001-01-01';
+DROP TABLE brin_hot_tbl;
+
+RESET enable_seqscan;
+
+DROP TABLE brin_test_tbl;
+
+--
+-- GIN pending list limit: once the list exceeds four times the limit, new
+-- entries go straight into the main structure
+--
+CREATE TABLE gin_pending_tbl (a int4[]);
+CREATE INDEX gin_pending_idx ON gin_pending_tbl USING gin (a) WITH (fastupdate = on);
+SET gin_pending_list_limit = 64;
+INSERT INTO gin_pending_tbl
+  SELECT ARRAY[i % 100, i % 7 + 200, 1000] FROM generate_series(1, 20000) i;
+
+SET enable_seqscan = OFF;
+SELECT count(*) FROM gin_pending_tbl WHERE a @> ARRAY[1000];
+SELECT count(*) FROM gin_pending_tbl WHERE a @> ARRAY[42];
+SELECT count(*) FROM gin_pending_tbl WHERE a @> ARRAY[42, 203];
+VACUUM gin_pending_tbl;
+SELECT count(*) FROM gin_pending_tbl WHERE a @> ARRAY[42, 203];
+RESET enable_seqscan;
+RESET gin_pending_list_limit;
+
+DROP TABLE gin_pending_tbl;
+
+--
+-- GIN compressed posting lists and posting trees: key 1 is in every row,
+-- so it gets a posting tree that splits both during the build and during
+-- later inserts; the rest are short compressed lists in entry tuples
+--
+CREATE TABLE gin_posting_tbl (a int4[]);
+INSERT INTO gin_posting_tbl
+  SELECT ARRAY[1, i % 3 + 10, i + 100] FROM generate_series(1, 30000) i;
+CREATE INDEX gin_posting_idx ON gin_posting_tbl USING gin (a) WITH (fastupdate = off);
+INSERT INTO gin_posting_tbl
+  SELECT ARRAY[1, i % 3 + 10, i + 100] FROM generate_series(30001, 40000) i;
+
+SET enable_seqscan = OFF;
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[1];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[11];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[1, 12];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[20100];
+
+-- delete most rows, leaving holes all through the posting trees
+DELETE FROM gin_posting_tbl WHERE (a[3] - 100) % 5 <> 0;
+VACUUM gin_posting_tbl;
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[1];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[11];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[1, 12];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[10];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[20100];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[20101];
+
+-- new rows reuse the freed heap space, so they land mid-tree
+INSERT INTO gin_posting_tbl
+  SELECT ARRAY[1, 10, i] FROM generate_series(1, 1000) i;
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[1];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[10];
+SELECT count(*) FROM gin_posting_tbl WHERE a @> ARRAY[1, 11];
+RESET enable_seqscan;
+
+DROP TABLE gin_posting_tbl;
@@ -373,3 +373,36 @@ SELECT a.attrelid::regclass, a.attname, a.attinhcount, e.expected
   ORDER BY a.attrelid::regclass::name, a.attnum;
 
 DROP TABLE t1, s1 CASCADE;
+
+-- Test partition-wise join and grouping
+CREATE TABLE pwj_a (k int NOT NULL, v int);
+CREATE TABLE pwj_a1 (CHECK (k >= 0 AND k < 10)) INHERITS (pwj_a);
+CREATE TABLE pwj_a2 (CHECK (k >= 10 AND k < 20)) INHERITS (pwj_a);
+CREATE TABLE pwj_b (k int NOT NULL, w int);
+CREATE TABLE pwj_b1 (CHECK (k >= 0 AND k < 10)) INHERITS (pwj_b);
+CREATE TABLE pwj_b2 (CHECK (k >= 10 AND k < 20)) INHERITS (pwj_b);
+INSERT INTO pwj_a1 SELECT i, i * 10 FROM generate_series(0, 9) i;
+INSERT INTO pwj_a2 SELECT i, i * 10 FROM generate_series(10, 19) i;
+INSERT INTO pwj_a VALUES (5, 1000), (15, 2000);		-- rows in the parent
+INSERT INTO pwj_b1 SELECT i % 10, i FROM generate_series(0, 19) i;
+INSERT INTO pwj_b2 SELECT 10 + i % 10, i FROM generate_series(0, 19) i;
+SET enable_partitionwise_join = on;
+SET enable_partitionwise_aggregate = on;
+-- pwj_a1 and pwj_b2, and pwj_a2 and pwj_b1, are never joined, since their
+-- CHECK constraints refute each other; the parent tables pair with everything
+SET enable_mergejoin = off;		-- keep the plans stable
+EXPLAIN (COSTS OFF)
+SELECT count(*), sum(a.v), sum(b.w) FROM pwj_a a JOIN pwj_b b ON a.k = b.k;
+SELECT count(*), sum(a.v), sum(b.w) FROM pwj_a a JOIN pwj_b b ON a.k = b.k;
+EXPLAIN (COSTS OFF)
+SELECT k, count(*), sum(v) FROM pwj_a GROUP BY k HAVING count(*) > 1 ORDER BY 1;
+SELECT k, count(*), sum(v) FROM pwj_a GROUP BY k HAVING count(*) > 1 ORDER BY 1;
+EXPLAIN (COSTS OFF)
+SELECT a.k, count(*), sum(b.w) FROM pwj_a a JOIN pwj_b b ON a.k = b.k
+  GROUP BY a.k HAVING count(*) > 2 ORDER BY 1;
+SELECT a.k, count(*), sum(b.w) FROM pwj_a a JOIN pwj_b b ON a.k = b.k
+  GROUP BY a.k HAVING count(*) > 2 ORDER BY 1;
+RESET enable_mergejoin;
+RESET enable_partitionwise_join;
+RESET enable_partitionwise_aggregate;
+DROP TABLE pwj_a1, pwj_a2, pwj_a, pwj_b1, pwj_b2, pwj_b;
@@ -627,3 +627,84 @@ SELECT * FROM b LEFT JOIN a ON (b.a_id = a.id) WHERE (a.id IS NULL OR a.id > 0);
 SELECT b.* FROM b LEFT JOIN a ON (b.a_id = a.id) WHERE (a.id IS NULL OR a.id > 0);
 
 rollback;
+
+-- outer tuples of semi and inner joins that have no partner are rejected
+-- by the inner side's bloom filter; left and anti joins must not use it
+create temp table bloom_inner as select g as k from generate_series(1, 1000) g;
+create temp table bloom_outer as select g as k from generate_series(1, 20000) g;
+analyze bloom_inner;
+analyze bloom_outer;
+set enable_mergejoin = off;
+set enable_nestloop = off;
+select count(*), sum(o.k) from bloom_outer o join bloom_inner i on o.k = i.k;
+select count(*), sum(o.k) from bloom_outer o
+  where exists (select 1 from bloom_inner i where i.k = o.k);
+select count(*), sum(o.k) from bloom_outer o
+  where not exists (select 1 from bloom_inner i where i.k = o.k);
+select count(*), count(i.k) from bloom_outer o
+  left join bloom_inner i on o.k = i.k;
+reset enable_mergejoin;
+reset enable_nestloop;
+
+--
+-- hash joins whose inner side has far more duplicates of one key than fit
+-- in work_mem: batches get written out, and the skewed batch is joined in
+-- chunks.  Compare with the results of other join methods.
+--
+create temp table hjskew_inner (k int, pad text);
+insert into hjskew_inner select 1, repeat('x', 20) from generate_series(1, 10000);
+insert into hjskew_inner select g, repeat('x', 20) from generate_series(2, 1001) g;
+create temp table hjskew_outer (k int);
+insert into hjskew_outer select 1 from generate_series(1, 10);
+insert into hjskew_outer select g from generate_series(2, 50000) g;
+analyze hjskew_inner;
+analyze hjskew_outer;
+set work_mem = '64kB';
+set enable_mergejoin = off;
+set enable_nestloop = off;
+select count(*) from hjskew_outer o join hjskew_inner i on o.k = i.k;
+select count(*) from hjskew_outer o left join hjskew_inner i on o.k = i.k;
+select count(*) from hjskew_outer o
+  where exists (select 1 from hjskew_inner i where i.k = o.k);
+select count(*) from hjskew_outer o
+  where not exists (select 1 from hjskew_inner i where i.k = o.k);
+reset enable_mergejoin;
+reset enable_nestloop;
+set enable_hashjoin = off;
+select count(*) from hjskew_outer o join hjskew_inner i on o.k = i.k;
+select count(*) from hjskew_outer o left join hjskew_inner i on o.k = i.k;
+select count(*) from hjskew_outer o
+  where exists (select 1 from hjskew_inner i where i.k = o.k);
+select count(*) from hjskew_outer o
+  where not exists (select 1 from hjskew_inner i where i.k = o.k);
+reset enable_hashjoin;
+reset work_mem;
+
+--
+-- nestloop inner indexscans with repeated outer keys, which may be memoized
+--
+SELECT count(*), sum(t2.unique1) FROM tenk1 t1
+  JOIN tenk1 t2 ON t2.unique1 = t1.hundred
+  WHERE t1.unique1 < 1000;
+SELECT count(*) FROM tenk1 t1
+  WHERE t1.unique1 < 1000 AND
+    EXISTS (SELECT 1 FROM tenk1 t2 WHERE t2.unique1 = t1.hundred * 10);
+
+-- the cache key must compare outer values the way the join clause does:
+-- 1.0 and 1.00 are equal numerics, but they match different strings
+create temp table memo_outer (num numeric);
+create temp table memo_inner (txt text primary key);
+insert into memo_outer
+  select case when g % 2 = 0 then 1.0 else 1.00 end
+  from generate_series(1, 10) g;
+insert into memo_inner select 'x' || g from generate_series(1, 1000) g;
+insert into memo_inner values ('1.0'), ('1.00');
+analyze memo_outer;
+analyze memo_inner;
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+select i.txt, count(*) from memo_outer o
+  join memo_inner i on i.txt = o.num::text
+  group by i.txt order by i.txt;
+reset enable_hashjoin;
+reset enable_mergejoin;
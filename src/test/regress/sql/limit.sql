@@ -39,3 +39,9 @@ SELECT
           (SELECT n FROM generate_series(1,10) AS n
              ORDER BY n LIMIT 1 OFFSET s-1) AS y) AS z
   FROM generate_series(1,10) AS s;
+
+-- Incremental sort: input ordered by an index on a leading sort key
+SELECT hundred, unique1 FROM tenk1
+		ORDER BY hundred, unique1 DESC LIMIT 3;
+SELECT thousand, unique1 FROM tenk1
+		ORDER BY thousand, unique1 DESC LIMIT 3 OFFSET 9;
@@ -0,0 +1,28 @@
+--
+-- Freezing during page pruning
+--
+-- This must not run concurrently with other transactions, which would hold
+-- back OldestXmin and keep the tuples from being old enough to freeze.
+--
+
+-- one page, filled so that a few HOT updates leave it short of space;
+-- the next scan then prunes it, and freezes what survives
+SET prune_freeze_min_age = 0;
+CREATE TABLE prunefrz (id int, val int) WITH (autovacuum_enabled = off);
+INSERT INTO prunefrz SELECT g, 0 FROM generate_series(1, 200) g;
+UPDATE prunefrz SET val = 1 WHERE id <= 10;
+SELECT count(*) FROM prunefrz;
+SELECT count(*) FROM prunefrz WHERE xmin = '2';
+SELECT sum(val) FROM prunefrz;
+DROP TABLE prunefrz;
+
+-- -1 disables freezing during pruning
+SET prune_freeze_min_age = -1;
+CREATE TABLE prunefrz (id int, val int) WITH (autovacuum_enabled = off);
+INSERT INTO prunefrz SELECT g, 0 FROM generate_series(1, 200) g;
+UPDATE prunefrz SET val = 1 WHERE id <= 10;
+SELECT count(*) FROM prunefrz;
+SELECT count(*) FROM prunefrz WHERE xmin = '2';
+DROP TABLE prunefrz;
+
+RESET prune_freeze_min_age;
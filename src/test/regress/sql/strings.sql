@@ -407,6 +407,35 @@ SELECT length(c), c::text FROM toasttest;
 SELECT c FROM toasttest;
 DROP TABLE toasttest;
 
+-- test the lz4 compression method, mixed with pglz-compressed values
+
+CREATE TABLE toasttest (f1 text);
+INSERT INTO toasttest VALUES(repeat('1234567890',1000));
+ALTER TABLE toasttest ALTER COLUMN f1 SET COMPRESSION lz4;
+INSERT INTO toasttest VALUES(repeat('1234567890',2000));
+INSERT INTO toasttest VALUES(repeat('1234567890',100000));
+ALTER TABLE toasttest ALTER COLUMN f1 SET COMPRESSION zstd;
+SELECT length(f1) AS len, f1 = repeat('1234567890', length(f1) / 10) AS same,
+       pg_column_size(f1) < length(f1) / 4 AS compressed
+  FROM toasttest ORDER BY 1;
+SELECT substr(f1, 999995) FROM toasttest WHERE length(f1) = 1000000;
+DROP TABLE toasttest;
+
+-- test taking slices of compressed values, which decompresses only a prefix
+
+CREATE TABLE toasttest (f1 text, f2 bytea);
+INSERT INTO toasttest VALUES(repeat('abcdefghij',50000),
+       decode(repeat('00010203',50000), 'hex'));
+ALTER TABLE toasttest ALTER COLUMN f1 SET COMPRESSION lz4,
+       ALTER COLUMN f2 SET COMPRESSION lz4;
+INSERT INTO toasttest VALUES(repeat('abcdefghij',50000),
+       decode(repeat('00010203',50000), 'hex'));
+SELECT substr(f1, 1, 12), substr(f1, 499995), substr(f1, 100001, 3),
+       get_byte(f2, 3) AS byte3, get_byte(f2, 199998) AS byte199998,
+       get_bit(f2, 8) AS bit8
+  FROM toasttest;
+DROP TABLE toasttest;
+
 --
 -- test length
 --
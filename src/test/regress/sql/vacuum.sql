@@ -55,3 +55,45 @@ VACUUM FULL vactst;
 
 DROP TABLE vaccluster;
 DROP TABLE vactst;
+
+-- an aborted deleter's xmax must keep its page out of the all-frozen set,
+-- or later vacuums would skip the page and advance relfrozenxid past it
+CREATE TABLE vacfrz (id int, pad text) WITH (autovacuum_enabled = off);
+INSERT INTO vacfrz SELECT g, repeat('x', 500) FROM generate_series(1, 600) g;
+VACUUM FREEZE vacfrz;
+BEGIN;
+DELETE FROM vacfrz WHERE id = 600;
+ROLLBACK;
+SELECT count(*) FROM vacfrz WHERE id = 600;
+VACUUM vacfrz;
+VACUUM FREEZE vacfrz;
+SELECT x.xmax = '0' OR age(x.xmax) <= age(c.relfrozenxid) AS ok
+  FROM vacfrz x, pg_class c
+  WHERE c.oid = 'vacfrz'::regclass AND x.id = 600;
+DROP TABLE vacfrz;
+
+-- scattered dead tuples across several 64-block leaves of VACUUM's dead
+-- tuple store, and some whole pages; afterwards the index must still agree
+-- with the heap, also once the freed line pointers are reused
+CREATE TABLE vactid (id int PRIMARY KEY, pad text) WITH (autovacuum_enabled = off);
+INSERT INTO vactid SELECT g, repeat('x', 200) FROM generate_series(1, 10000) g;
+DELETE FROM vactid WHERE id % 7 = 0 OR id % 97 < 3 OR id BETWEEN 2000 AND 2400;
+VACUUM vactid;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(id) FROM vactid WHERE id > 0;
+SET enable_seqscan = on;
+SET enable_indexscan = off;
+SELECT count(*), sum(id) FROM vactid WHERE id > 0;
+INSERT INTO vactid SELECT g, 'y' FROM generate_series(1, 10000) g
+  WHERE g % 7 = 0 OR g % 97 < 3 OR g BETWEEN 2000 AND 2400;
+SELECT count(*), sum(id) FROM vactid WHERE id > 0;
+SET enable_seqscan = off;
+SET enable_indexscan = on;
+SELECT count(*), sum(id) FROM vactid WHERE id > 0;
+SELECT count(*) FROM vactid
+  WHERE id > 0 AND (pad = 'y') <> (id % 7 = 0 OR id % 97 < 3 OR id BETWEEN 2000 AND 2400);
+RESET enable_seqscan;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+DROP TABLE vactid;